@@ -0,0 +1,260 @@
+/**
+ * flash_bench.cpp
+ * Flash cost and wear of ArduinoMCP's file API, on the simulator's page-level
+ * SPIFFS model (sim/include/sim_flash.h).
+ *
+ * ArduinoMCP runs on the host WebServer stand-in and every request goes
+ * through its real handler over loopback, so each row is what one
+ * /api/spiffs call costs on the device: modelled flash time, pages read and
+ * programmed, bytes programmed per payload byte, sector erases. A long append
+ * run with log rotation on a partly filled partition then shows how GC
+ * spreads the erases over the blocks.
+ *
+ * Before any numbers, the model is checked against the files on disk after
+ * every phase and a file written over HTTP must read back unchanged.
+ *
+ *   make -C host bench
+ */
+
+#include <ArduinoMCP.h>
+
+#include "sim_flash.h"
+#include "sim_host.h"
+
+#include <arpa/inet.h>
+#include <ftw.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr uint16_t kDevicePort = 80;
+constexpr uint64_t kEnduranceCycles = 100000;  // P/E cycles of the SPI NOR parts
+
+ArduinoMCP mcpServer;
+uint16_t gHostPort = 0;
+
+uint16_t freePort() {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    if (fd < 0 || bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len) != 0) {
+        perror("socket");
+        exit(1);
+    }
+    close(fd);
+    return ntohs(addr.sin_port);
+}
+
+// One request through ArduinoMCP::handle(); returns the status, body in *out
+int request(const char* method, const std::string& target, const std::string& body = "", std::string* out = nullptr) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(gHostPort);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        perror("connect");
+        exit(1);
+    }
+    std::string req = std::string(method) + " " + target + " HTTP/1.1\r\nHost: esp32\r\nContent-Type: text/plain\r\n" +
+                      "Content-Length: " + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+    if (send(fd, req.data(), req.size(), 0) != static_cast<ssize_t>(req.size())) {
+        perror("send");
+        exit(1);
+    }
+    mcpServer.handle();
+    std::string resp;
+    char buf[4096];
+    ssize_t n;
+    while ((n = recv(fd, buf, sizeof(buf), 0)) > 0) resp.append(buf, static_cast<size_t>(n));
+    close(fd);
+    if (out) {
+        size_t at = resp.find("\r\n\r\n");
+        *out = at == std::string::npos ? "" : resp.substr(at + 4);
+    }
+    return resp.size() > 12 ? atoi(resp.c_str() + 9) : 0;
+}
+
+std::string payload(size_t size, unsigned seed) {
+    srand(seed);
+    std::string s;
+    while (s.size() < size) {
+        s += "t=" + std::to_string(rand() % 100000) + ",rssi=-" + std::to_string(40 + rand() % 50) + ",ok;";
+    }
+    s.resize(size);
+    return s;
+}
+
+bool checkModel(const char* phase) {
+    std::string error;
+    if (sim::flash().check(sim::fsFiles(), error)) return true;
+    fprintf(stderr, "FAIL: flash model after %s: %s\n", phase, error.c_str());
+    return false;
+}
+
+struct Row {
+    const char* label;
+    size_t n;
+    size_t payloadBytes;  // per operation
+    sim::FlashStats total;
+    uint64_t maxUs;
+};
+
+sim::FlashStats diff(const sim::FlashStats& a, const sim::FlashStats& b) {
+    sim::FlashStats d = b;
+    d.pageReads -= a.pageReads;
+    d.pagePrograms -= a.pagePrograms;
+    d.bytesProgrammed -= a.bytesProgrammed;
+    d.pageDeletes -= a.pageDeletes;
+    d.erases -= a.erases;
+    d.gcRuns -= a.gcRuns;
+    d.gcMoves -= a.gcMoves;
+    d.busyUs -= a.busyUs;
+    return d;
+}
+
+// Runs op(i) n times, all answered 200; false on any other status
+template <typename Op>
+bool measure(std::vector<Row>& rows, const char* label, size_t n, size_t payloadBytes, Op op) {
+    Row row{label, n, payloadBytes, sim::FlashStats(), 0};
+    const sim::FlashStats start = sim::flash().stats();
+    for (size_t i = 0; i < n; ++i) {
+        const uint64_t before = sim::flash().stats().busyUs;
+        const int status = op(i);
+        if (status != 200) {
+            fprintf(stderr, "FAIL: %s #%zu answered %d\n", label, i, status);
+            return false;
+        }
+        row.maxUs = std::max(row.maxUs, sim::flash().stats().busyUs - before);
+    }
+    row.total = diff(start, sim::flash().stats());
+    rows.push_back(row);
+    return checkModel(label);
+}
+
+void printRow(const Row& r) {
+    const double n = static_cast<double>(r.n);
+    const double amp = r.payloadBytes ? r.total.bytesProgrammed / (n * r.payloadBytes) : 0.0;
+    printf("%-32s %5zu %9.2f %9.2f %8.1f %8.1f %8.2f %7.3f", r.label, r.n, r.total.busyUs / n / 1000.0,
+           r.maxUs / 1000.0, r.total.pageReads / n, r.total.pagePrograms / n, r.total.bytesProgrammed / n / 1024.0,
+           r.total.erases / n);
+    if (r.payloadBytes) printf(" %6.1fx\n", amp);
+    else printf("      -\n");
+}
+
+int removeEntry(const char* path, const struct stat*, int, struct FTW*) { return ::remove(path); }
+
+} // namespace
+
+int main() {
+    char tmpl[] = "/tmp/flash_bench.XXXXXX";
+    if (!mkdtemp(tmpl)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    sim::setFsRoot(tmpl);
+    gHostPort = freePort();
+    sim::setPortOffset(gHostPort - kDevicePort);
+    mcpServer.begin(kDevicePort);
+
+    // ---- Correctness ----
+    const std::string probe = payload(3000, 7);
+    std::string back;
+    if (request("POST", "/api/spiffs/write?path=/probe.txt", probe) != 200 ||
+        request("POST", "/api/spiffs/write?path=/probe.txt&append=1", probe) != 200 ||
+        request("GET", "/api/spiffs/read?path=/probe.txt", "", &back) != 200 ||
+        back.find(probe + probe) == std::string::npos ||
+        request("DELETE", "/api/spiffs/delete?path=/probe.txt") != 200) {
+        fprintf(stderr, "FAIL: /probe.txt does not read back what was written\n");
+        return 1;
+    }
+    if (!checkModel("write / append / delete")) return 1;
+
+    // ---- Per-operation cost ----
+    std::vector<Row> rows;
+    const std::string file2k = payload(2048, 1);
+    const std::string line = payload(64, 2);
+    auto path = [](const char* fmt, size_t i) {
+        char buf[32];
+        snprintf(buf, sizeof(buf), fmt, i);
+        return std::string(buf);
+    };
+    bool ok =
+        measure(rows, "write 2 KB, new file", 20, file2k.size(),
+                [&](size_t i) { return request("POST", "/api/spiffs/write?path=" + path("/w%02zu.txt", i), file2k); }) &&
+        measure(rows, "write 2 KB, replace", 20, file2k.size(),
+                [&](size_t i) { return request("POST", "/api/spiffs/write?path=" + path("/w%02zu.txt", i), file2k); }) &&
+        measure(rows, "append 64 B", 200, line.size(),
+                [&](size_t) { return request("POST", "/api/spiffs/write?path=/log.txt&append=1", line); }) &&
+        measure(rows, "append 64 B, compress=1", 200, line.size(),
+                [&](size_t) { return request("POST", "/api/spiffs/write?path=/log.z&append=1&compress=1", line); }) &&
+        measure(rows, "read 2 KB", 20, 0,
+                [&](size_t i) { return request("GET", "/api/spiffs/read?path=" + path("/w%02zu.txt", i)); }) &&
+        measure(rows, "list / (22 files)", 5, 0, [&](size_t) { return request("GET", "/api/spiffs/list?path=/"); }) &&
+        measure(rows, "delete 2 KB file", 20, 0,
+                [&](size_t i) { return request("DELETE", "/api/spiffs/delete?path=" + path("/w%02zu.txt", i)); });
+    if (!ok) return 1;
+
+    // ---- Wear: a rotating log next to static files ----
+    // 40 files of 20 KB (about 60% of the partition) stay put; a log gets
+    // 64 B appends and starts over at 16 KB.
+    const std::string file20k = payload(20000, 3);
+    for (size_t i = 0; i < 40 && ok; ++i) {
+        ok = request("POST", "/api/spiffs/write?path=" + path("/s%02zu.bin", i), file20k) == 200;
+    }
+    if (!ok || request("DELETE", "/api/spiffs/delete?path=/log.txt") != 200) {
+        fprintf(stderr, "FAIL: wear setup\n");
+        return 1;
+    }
+    const size_t appends = 30000;
+    const sim::FlashStats wearStart = sim::flash().stats();
+    const std::vector<uint32_t> erasesStart = sim::flash().wear();
+    size_t logSize = 0;
+    ok = measure(rows, "append 64 B, rotating, 60% full", appends, line.size(), [&](size_t) {
+        if (logSize + line.size() > 16384) {
+            if (request("DELETE", "/api/spiffs/delete?path=/log.txt") != 200) return 0;
+            logSize = 0;
+        }
+        logSize += line.size();
+        return request("POST", "/api/spiffs/write?path=/log.txt&append=1", line);
+    });
+    if (!ok) return 1;
+    printf("correctness: ok\n\n");
+
+    printf("%-32s %5s %9s %9s %8s %8s %8s %7s %7s\n", "per request", "n", "flash ms", "max ms", "reads", "programs",
+           "KB prog", "erases", "amplif");
+    for (const Row& r : rows) printRow(r);
+
+    const sim::FlashStats w = diff(wearStart, sim::flash().stats());
+    std::vector<uint32_t> erases = sim::flash().wear();
+    for (size_t b = 0; b < erases.size(); ++b) erases[b] -= erasesStart[b];
+    std::sort(erases.begin(), erases.end());
+    uint64_t sum = 0;
+    for (uint32_t e : erases) sum += e;
+    const size_t idle = static_cast<size_t>(std::count(erases.begin(), erases.end(), 0u));
+    printf("\nWear over %zu rotating appends: %llu erases in %llu GC runs (%llu live pages moved)\n", appends,
+           static_cast<unsigned long long>(w.erases), static_cast<unsigned long long>(w.gcRuns),
+           static_cast<unsigned long long>(w.gcMoves));
+    printf("  erases per block: min %u, median %u, mean %.1f, max %u; %zu of %zu blocks never erased\n", erases.front(),
+           erases[erases.size() / 2], static_cast<double>(sum) / erases.size(), erases.back(), idle, erases.size());
+    if (erases.back() > 0) {
+        const double perMax = static_cast<double>(appends) / erases.back();
+        printf("  at one append per second the most-erased block reaches %llu cycles in %.1f years\n",
+               static_cast<unsigned long long>(kEnduranceCycles), kEnduranceCycles * perMax / (365.0 * 86400.0));
+    }
+
+    nftw(tmpl, removeEntry, 16, FTW_DEPTH | FTW_PHYS);
+    return 0;
+}
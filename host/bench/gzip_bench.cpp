@@ -0,0 +1,248 @@
+/**
+ * gzip_bench.cpp
+ * Host benchmark for McpGzip (webhook request bodies, McpZFile blocks) and
+ * McpInflate.
+ *
+ * Every output is inflated with zlib and compared with the input first, for
+ * several write granularities (the firmware feeds it 512-byte pieces), so a
+ * broken stream fails loudly instead of posting a good ratio. Segments
+ * (Format::Segment, one per file block) must decode on their own with
+ * McpInflate and, concatenated, as one stream with zlib. Then ratio and
+ * throughput are compared with zlib's deflate on the same inputs.
+ *
+ *   make -C host bench
+ */
+
+#include "McpGzip.h"
+#include "McpInflate.h"
+
+#include <zlib.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// GzipStream times itself with esp_timer; the bench has no simulator clock.
+int64_t esp_timer_get_time(void) {
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+namespace {
+
+std::string makeInput(const char* kind, size_t size, unsigned seed) {
+    srand(seed);
+    std::string s;
+    if (strcmp(kind, "report") == 0) {
+        // Webhook JSON body: escaped Markdown report, like the firmware's.
+        s = "{\"username\":\"NetDiag\",\"content\":\"# ConnectionSummary\\n**Location:lab-3F**\\n";
+        while (s.size() < size) {
+            s += "- AP-";
+            s += std::to_string(rand() % 100);
+            s += " (ch";
+            s += std::to_string(1 + rand() % 13);
+            s += ", -";
+            s += std::to_string(40 + rand() % 50);
+            s += " dBm, WPA2-PSK)\\n";
+            if (rand() % 4 == 0) {
+                s += "- Gateway (192.168.1.1): ping ok ";
+                s += std::to_string(rand() % 20);
+                s += "ms; ports: 80=open, 443=open, 22=closed, 53=open\\n";
+            }
+        }
+    } else if (strcmp(kind, "json") == 0) {
+        while (s.size() < size) {
+            s += "{\"ssid\":\"cluster";
+            s += std::to_string(rand() % 8);
+            s += "\",\"ch\":";
+            s += std::to_string(1 + rand() % 13);
+            s += ",\"rssi\":-";
+            s += std::to_string(40 + rand() % 50);
+            s += "},";
+        }
+    } else if (strcmp(kind, "csv") == 0) {
+        // Logged samples, like SpiffsExplorer's /data.csv
+        s = "timestamp,rssi,latency_ms,heap\n";
+        unsigned long t = 1700000000;
+        while (s.size() < size) {
+            t += 60;
+            s += std::to_string(t) + ",-" + std::to_string(55 + rand() % 12) + "," + std::to_string(8 + rand() % 30) +
+                 "," + std::to_string(180000 + (rand() % 64) * 16) + "\n";
+        }
+    } else if (strcmp(kind, "random") == 0) {
+        while (s.size() < size) s += static_cast<char>(rand() & 0xFF);
+    } else if (strcmp(kind, "zeros") == 0) {
+        s.assign(size, '\0');
+    }
+    s.resize(size);
+    return s;
+}
+
+bool collect(void* ctx, const uint8_t* data, size_t len, bool) {
+    static_cast<std::string*>(ctx)->append(reinterpret_cast<const char*>(data), len);
+    return true;
+}
+
+mcp::GzipStream gz;  // ~11 KB: static, as in the firmware
+
+std::string compress(const std::string& in, size_t piece,
+                     mcp::GzipStream::Format format = mcp::GzipStream::Format::Gzip) {
+    std::string out;
+    gz.begin(collect, &out, format);
+    for (size_t off = 0; off < in.size(); off += piece) {
+        size_t n = std::min(piece, in.size() - off);
+        gz.write(reinterpret_cast<const uint8_t*>(in.data()) + off, n);
+    }
+    gz.finish();
+    return out;
+}
+
+// windowBits 16 + 15: gzip; -15: raw deflate
+bool gunzip(const std::string& in, std::string& out, int windowBits = 16 + MAX_WBITS) {
+    z_stream z{};
+    if (inflateInit2(&z, windowBits) != Z_OK) return false;
+    z.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in.data()));
+    z.avail_in = static_cast<uInt>(in.size());
+    int rc = Z_OK;
+    char buf[4096];
+    while (rc == Z_OK) {
+        z.next_out = reinterpret_cast<Bytef*>(buf);
+        z.avail_out = sizeof(buf);
+        rc = inflate(&z, Z_NO_FLUSH);
+        out.append(buf, sizeof(buf) - z.avail_out);
+    }
+    inflateEnd(&z);
+    return rc == Z_STREAM_END && z.avail_in == 0;
+}
+
+// McpZFile's encoding: one segment per block, each decoded on its own with
+// McpInflate; all of them plus an empty final block with zlib.
+bool segmentsRoundTrip(const std::string& in, size_t block, size_t& stored) {
+    std::string stream;
+    std::vector<uint8_t> raw(block);
+    for (size_t off = 0; off < in.size(); off += block) {
+        const std::string part = in.substr(off, block);
+        const std::string seg = compress(part, 512, mcp::GzipStream::Format::Segment);
+        size_t got = 0;
+        if (mcp::inflateRaw(reinterpret_cast<const uint8_t*>(seg.data()), seg.size(), raw.data(), raw.size(), got) !=
+                mcp::InflateResult::Ok ||
+            std::string(reinterpret_cast<const char*>(raw.data()), got) != part) {
+            return false;
+        }
+        stream += seg;
+    }
+    stored = stream.size();
+    std::string out;
+    return gunzip(stream + std::string("\x03\x00", 2), out, -MAX_WBITS) && out == in;
+}
+
+size_t zlibSize(const std::string& in, int level) {
+    z_stream z{};
+    deflateInit2(&z, level, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+    std::vector<unsigned char> out(deflateBound(&z, in.size()));
+    z.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in.data()));
+    z.avail_in = static_cast<uInt>(in.size());
+    z.next_out = out.data();
+    z.avail_out = static_cast<uInt>(out.size());
+    deflate(&z, Z_FINISH);
+    size_t n = z.total_out;
+    deflateEnd(&z);
+    return n;
+}
+
+using Clock = std::chrono::steady_clock;
+
+template <typename Fn>
+double mbPerSec(size_t bytes, Fn fn) {
+    size_t iters = 0;
+    size_t sink = 0;
+    auto start = Clock::now();
+    double elapsed = 0;
+    do {
+        sink += fn();
+        iters++;
+        elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    } while (elapsed < 0.25);
+    if (sink == 42) printf(" ");  // keep the work observable
+    return (static_cast<double>(bytes) * iters) / elapsed / 1e6;
+}
+
+} // namespace
+
+int main() {
+    const char* kinds[] = {"report", "json", "csv", "random", "zeros"};
+    const size_t sizes[] = {0, 1, 300, 2000, 65536};
+
+    // Correctness first: every input through zlib's inflate, at several
+    // write sizes (window slides and block flushes land everywhere).
+    for (const char* kind : kinds) {
+        for (size_t size : sizes) {
+            std::string in = makeInput(kind, size, 1);
+            for (size_t piece : {1u, 7u, 512u, 100000u}) {
+                if (size > 4096 && piece < 7) continue;
+                std::string out;
+                if (!gunzip(compress(in, piece), out) || out != in) {
+                    fprintf(stderr, "FAIL: '%s' %zu bytes, %zu-byte writes does not round-trip\n", kind, size, piece);
+                    return 1;
+                }
+            }
+            // McpInflate on a whole gzip body (header and trailer skipped)
+            const std::string body = compress(in, 512);
+            std::vector<uint8_t> raw(size + 1);
+            size_t got = 0;
+            if (mcp::inflateRaw(reinterpret_cast<const uint8_t*>(body.data()) + 10, body.size() - 18, raw.data(),
+                                raw.size(), got) != mcp::InflateResult::Ok ||
+                std::string(reinterpret_cast<const char*>(raw.data()), got) != in) {
+                fprintf(stderr, "FAIL: '%s' %zu bytes does not inflate with McpInflate\n", kind, size);
+                return 1;
+            }
+            size_t stored;
+            for (size_t block : {512u, 4096u}) {
+                if (!segmentsRoundTrip(in, block, stored)) {
+                    fprintf(stderr, "FAIL: '%s' %zu bytes in %zu-byte segments does not round-trip\n", kind, size,
+                            block);
+                    return 1;
+                }
+            }
+        }
+    }
+    printf("correctness: ok\n\n");
+
+    printf("%-8s %7s %9s %9s %9s %10s %10s\n", "input", "bytes", "gzstream", "zlib -1", "zlib -6", "gz MB/s",
+           "zlib-6 MB/s");
+    for (const char* kind : kinds) {
+        for (size_t size : {1100u, 2000u, 16384u}) {
+            std::string in = makeInput(kind, size, 7);
+            size_t ours = compress(in, 512).size();
+            double gzRate = mbPerSec(in.size(), [&] { return compress(in, 512).size(); });
+            double zRate = mbPerSec(in.size(), [&] { return zlibSize(in, 6); });
+            printf("%-8s %7zu %8.0f%% %8.0f%% %8.0f%% %10.1f %10.1f\n", kind, size, 100.0 * ours / size,
+                   100.0 * zlibSize(in, 1) / size, 100.0 * zlibSize(in, 6) / size, gzRate, zRate);
+        }
+    }
+
+    // McpZFile: 64 KB in independent blocks, and McpInflate's decode rate
+    printf("\n%-8s %9s %9s %9s %12s\n", "input", "512 B", "4 KB", "16 KB", "inflate MB/s");
+    for (const char* kind : kinds) {
+        std::string in = makeInput(kind, 65536, 7);
+        double ratio[3];
+        int i = 0;
+        for (size_t block : {512u, 4096u, 16384u}) {
+            size_t stored = 0;
+            segmentsRoundTrip(in, block, stored);
+            ratio[i++] = 100.0 * stored / in.size();
+        }
+        const std::string seg = compress(in.substr(0, 4096), 512, mcp::GzipStream::Format::Segment);
+        std::vector<uint8_t> raw(4096);
+        double rate = mbPerSec(4096, [&] {
+            size_t got = 0;
+            mcp::inflateRaw(reinterpret_cast<const uint8_t*>(seg.data()), seg.size(), raw.data(), raw.size(), got);
+            return got;
+        });
+        printf("%-8s %8.0f%% %8.0f%% %8.0f%% %12.1f\n", kind, ratio[0], ratio[1], ratio[2], rate);
+    }
+    return 0;
+}
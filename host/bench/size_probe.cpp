@@ -0,0 +1,22 @@
+/**
+ * size_probe.cpp
+ * Smallest sketch that links ArduinoMCP, for per-feature size figures.
+ *
+ * Built once with everything on and once per MCP_* feature switched off
+ * (see McpConfig.h); the differences in text / data / bss are what a feature
+ * costs. Host code (x86-64, sim stand-ins for the core) so the numbers are a
+ * proxy for flash and static RAM on the ESP32, good for comparing features,
+ * not for absolute sizes.
+ *
+ *   make -C host size
+ */
+
+#include <ArduinoMCP.h>
+
+ArduinoMCP mcpServer;
+
+int main() {
+    mcpServer.begin();
+    mcpServer.handle();
+    return 0;
+}
@@ -0,0 +1,172 @@
+#!/usr/bin/env python3
+"""
+fake_mqtt.py
+Tiny MQTT 3.1.1 broker for trying the firmware's MQTT mode without Mosquitto.
+
+Handles what a publisher needs: CONNECT (persistent sessions keyed by client
+id, so CONNACK reports session-present), PUBLISH QoS0/1 with PUBACK,
+retained messages, PINGREQ and DISCONNECT; the will is published when a
+client goes away without DISCONNECT. QoS1 is at-least-once: redelivered
+messages (DUP) are counted, not suppressed. There are no subscriptions:
+every message is logged on stdout instead.
+
+--drop-every N closes the connection instead of acknowledging every Nth QoS1
+publish, to exercise redelivery with DUP after the reconnect. With
+--refuse N the next N connects after such a drop get CONNACK 3 (server
+unavailable), an outage counted in attempts rather than seconds so it
+works against the simulator's virtual clock: snapshots pile up in the
+device's outbox and arrive as one batch.
+
+    python3 host/sim/fake_mqtt.py --port 18830 --drop-every 7 --refuse 12
+    host/build/mercury_sim host/sim/scenarios/mqtt.scn
+"""
+
+import argparse
+import socketserver
+import threading
+
+
+class Broker:
+    def __init__(self, args):
+        self.args = args
+        self.lock = threading.Lock()
+        self.sessions = set()  # client ids with a persistent session
+        self.retained = {}
+        self.qos1 = 0
+        self.redelivered = 0
+        self.refuse = 0
+
+
+def read_exact(sock_file, n):
+    data = sock_file.read(n)
+    if data is None or len(data) < n:
+        raise EOFError
+    return data
+
+
+def read_packet(sock_file):
+    header = read_exact(sock_file, 1)[0]
+    remaining = 0
+    multiplier = 1
+    while True:
+        digit = read_exact(sock_file, 1)[0]
+        remaining += (digit & 0x7F) * multiplier
+        multiplier *= 128
+        if not digit & 0x80:
+            break
+    return header, read_exact(sock_file, remaining) if remaining else b""
+
+
+def take_string(body, pos):
+    n = int.from_bytes(body[pos:pos + 2], "big")
+    return body[pos + 2:pos + 2 + n].decode(errors="replace"), pos + 2 + n
+
+
+class Handler(socketserver.StreamRequestHandler):
+    broker = None
+
+    def log(self, text):
+        print("[mqtt] %s" % text, flush=True)
+
+    def handle(self):
+        b = self.broker
+        client_id = "?"
+        will = None
+        try:
+            header, body = read_packet(self.rfile)
+            if header >> 4 != 1:
+                return
+            flags = body[7]
+            keepalive = int.from_bytes(body[8:10], "big")
+            client_id, pos = take_string(body, 10)
+            if flags & 0x04:
+                will_topic, pos = take_string(body, pos)
+                will_msg, pos = take_string(body, pos)
+                will = (will_topic, will_msg, bool(flags & 0x20))
+            clean = bool(flags & 0x02)
+            with b.lock:
+                refused = b.refuse > 0
+                b.refuse -= refused
+            if refused:
+                self.wfile.write(bytes([0x20, 0x02, 0, 3]))
+                self.log("CONNECT %s refused (server unavailable)" % client_id)
+                return
+            with b.lock:
+                present = not clean and client_id in b.sessions
+                if clean:
+                    b.sessions.discard(client_id)
+                else:
+                    b.sessions.add(client_id)
+            self.wfile.write(bytes([0x20, 0x02, 1 if present else 0, 0]))
+            self.log("CONNECT %s keepalive=%ds clean=%s session=%s" %
+                     (client_id, keepalive, clean, "resumed" if present else "new"))
+
+            while True:
+                header, body = read_packet(self.rfile)
+                kind = header >> 4
+                if kind == 3:
+                    qos = (header >> 1) & 3
+                    dup = bool(header & 0x08)
+                    retain = bool(header & 0x01)
+                    topic, pos = take_string(body, 0)
+                    packet_id = None
+                    if qos > 0:
+                        packet_id = int.from_bytes(body[pos:pos + 2], "big")
+                        pos += 2
+                    payload = body[pos:].decode(errors="replace")
+                    if retain:
+                        b.retained[topic] = payload
+                    if qos == 1:
+                        with b.lock:
+                            b.qos1 += 1
+                            b.redelivered += dup
+                            drop = b.args.drop_every and b.qos1 % b.args.drop_every == 0
+                            if drop:
+                                b.refuse = b.args.refuse
+                        if drop:
+                            self.log("dropping connection instead of PUBACK id=%d" % packet_id)
+                            break
+                        self.wfile.write(bytes([0x40, 0x02, packet_id >> 8, packet_id & 0xFF]))
+                    self.log("PUBLISH %s qos=%d%s%s %d bytes: %s" %
+                             (topic, qos, " id=%d" % packet_id if packet_id else "", " DUP" if dup else "",
+                              len(payload), payload[:b.args.show]))
+                elif kind == 12:
+                    self.wfile.write(bytes([0xD0, 0x00]))
+                elif kind == 14:
+                    will = None
+                    self.log("DISCONNECT %s" % client_id)
+                    break
+        except (EOFError, ConnectionError, OSError):
+            pass
+        if will:
+            topic, msg, retain = will
+            if retain:
+                b.retained[topic] = msg
+            self.log("%s gone; will %s = %s" % (client_id, topic, msg))
+
+
+class Server(socketserver.ThreadingTCPServer):
+    allow_reuse_address = True
+    daemon_threads = True
+
+
+def main():
+    p = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    p.add_argument("--port", type=int, default=1883)
+    p.add_argument("--drop-every", type=int, default=0, help="close instead of PUBACK on every Nth QoS1 publish")
+    p.add_argument("--refuse", type=int, default=0, help="refuse this many connects after each drop")
+    p.add_argument("--show", type=int, default=160, help="payload characters to print")
+    args = p.parse_args()
+
+    Handler.broker = Broker(args)
+    with Server(("127.0.0.1", args.port), Handler) as server:
+        print("[mqtt] listening on 127.0.0.1:%d" % args.port, flush=True)
+        try:
+            server.serve_forever()
+        except KeyboardInterrupt:
+            b = Handler.broker
+            print("[mqtt] %d QoS1 publishes, %d with DUP" % (b.qos1, b.redelivered))
+
+
+if __name__ == "__main__":
+    main()
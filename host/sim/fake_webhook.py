@@ -0,0 +1,187 @@
+#!/usr/bin/env python3
+"""
+fake_webhook.py
+Local stand-in for the Discord webhook, for mercury_sim --webhook.
+
+Speaks the subset of the API the firmware uses (execute with ?wait=true,
+PATCH /messages/<id>), enforces a per-webhook rate limit bucket with 429 +
+retry_after, rejects content over 2000 characters, and can be told to be
+slow or to fail every Nth request. Every request is logged on stdout.
+Chunked, "Content-Encoding: gzip" bodies (webhookGzip) are accepted and
+their compression ratio logged, which the real Discord API would refuse;
+--reject-gzip answers them with Discord's 400 instead (the firmware then
+resends uncompressed).
+
+    python3 host/sim/fake_webhook.py --port 8099 --slow-every 5 --slow-ms 8000
+    host/build/mercury_sim --webhook http://127.0.0.1:8099 host/sim/scenarios/office.scn
+"""
+
+import argparse
+import gzip
+import json
+import re
+import threading
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+MAX_CONTENT_CHARS = 2000
+
+
+class State:
+    def __init__(self, args):
+        self.args = args
+        self.lock = threading.Lock()
+        self.count = 0
+        self.recent = []
+        self.next_id = 1430000000000000000
+        self.messages = {}
+
+    def take_token(self):
+        """Returns (allowed, retry_after_seconds)."""
+        if self.args.rate_limit <= 0:
+            return True, 0.0
+        now = time.monotonic()
+        self.recent = [t for t in self.recent if t + self.args.rate_period > now]
+        if len(self.recent) >= self.args.rate_limit:
+            return False, self.recent[0] + self.args.rate_period - now
+        self.recent.append(now)
+        return True, 0.0
+
+
+class Handler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+    state = None
+
+    def log_message(self, fmt, *args):
+        print("[webhook] " + fmt % args, flush=True)
+
+    def reply(self, status, body=None, headers=None):
+        data = b"" if body is None else json.dumps(body, separators=(",", ":")).encode()
+        self.send_response(status)
+        self.send_header("Content-Type", "application/json")
+        self.send_header("Content-Length", str(len(data)))
+        for name, value in (headers or {}).items():
+            self.send_header(name, value)
+        self.end_headers()
+        self.wfile.write(data)
+
+    def read_body(self):
+        if "chunked" in self.headers.get("Transfer-Encoding", ""):
+            raw = b""
+            while True:
+                size = int(self.rfile.readline().split(b";")[0], 16)
+                if size == 0:
+                    self.rfile.readline()  # empty trailer
+                    break
+                raw += self.rfile.read(size)
+                self.rfile.readline()
+        else:
+            raw = self.rfile.read(int(self.headers.get("Content-Length", "0")))
+        if self.headers.get("Content-Encoding", "") == "gzip":
+            wire = len(raw)
+            raw = gzip.decompress(raw)
+            print("[webhook] gzip body %d -> %d bytes (%d%%)" % (len(raw), wire, wire * 100 // max(len(raw), 1)),
+                  flush=True)
+        return raw
+
+    def handle_write(self, edit):
+        st = self.state
+        try:
+            raw = self.read_body()
+        except (ValueError, OSError, EOFError):
+            self.reply(400, {"message": "Malformed request body", "code": 0})
+            return
+        with st.lock:
+            st.count += 1
+            n = st.count
+            allowed, retry_after = st.take_token()
+        args = st.args
+
+        if args.slow_every and n % args.slow_every == 0:
+            time.sleep(args.slow_ms / 1000.0)
+        elif args.latency_ms:
+            time.sleep(args.latency_ms / 1000.0)
+
+        limit = {
+            "X-RateLimit-Limit": str(args.rate_limit),
+            "X-RateLimit-Reset-After": "%.3f" % args.rate_period,
+        }
+        if not allowed:
+            limit["Retry-After"] = str(int(retry_after + 0.999))
+            self.reply(429, {"message": "You are being rate limited.", "retry_after": round(retry_after, 3),
+                             "global": False}, limit)
+            return
+        if args.fail_every and n % args.fail_every == 0:
+            self.reply(args.fail_status, {"message": "Simulated failure", "code": 0}, limit)
+            return
+
+        if args.reject_gzip and self.headers.get("Content-Encoding", "") == "gzip":
+            self.reply(400, {"message": "The request body contains invalid JSON.", "code": 50109}, limit)
+            return
+        try:
+            body = json.loads(raw)
+        except ValueError:
+            self.reply(400, {"message": "The request body contains invalid JSON.", "code": 50109}, limit)
+            return
+        content = body.get("content", "")
+        if len(content) > MAX_CONTENT_CHARS:
+            self.reply(400, {"content": ["Must be 2000 or fewer in length."]}, limit)
+            return
+
+        with st.lock:
+            if edit:
+                match = re.search(r"/messages/(\d+)", self.path)
+                msg_id = match.group(1) if match else ""
+                if msg_id not in st.messages:
+                    self.reply(404, {"message": "Unknown Message", "code": 10008}, limit)
+                    return
+            else:
+                if not content:
+                    self.reply(400, {"message": "Cannot send an empty message", "code": 50006}, limit)
+                    return
+                msg_id = str(st.next_id)
+                st.next_id += 1
+            st.messages[msg_id] = content
+
+        if not edit and "wait=true" not in self.path:
+            self.reply(204, None, limit)
+            return
+        self.reply(200, {"id": msg_id, "type": 0, "content": content, "channel_id": "1446680031261622000",
+                         "author": {"bot": True, "id": "1446680031261622303",
+                                    "username": body.get("username", "Captain Hook")},
+                         "edited_timestamp": None}, limit)
+
+    def do_POST(self):
+        self.handle_write(edit=False)
+
+    def do_PATCH(self):
+        self.handle_write(edit=True)
+
+    def do_GET(self):
+        self.reply(405, {"message": "405: Method Not Allowed", "code": 0})
+
+
+def main():
+    p = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    p.add_argument("--port", type=int, default=8099)
+    p.add_argument("--latency-ms", type=int, default=150, help="server time per request")
+    p.add_argument("--rate-limit", type=int, default=5, help="requests per period (0 = off)")
+    p.add_argument("--rate-period", type=float, default=2.0, help="rate limit period in seconds")
+    p.add_argument("--slow-every", type=int, default=0, help="make every Nth request slow")
+    p.add_argument("--slow-ms", type=int, default=8000)
+    p.add_argument("--fail-every", type=int, default=0, help="fail every Nth request")
+    p.add_argument("--fail-status", type=int, default=500)
+    p.add_argument("--reject-gzip", action="store_true", help="answer gzip bodies with 400, as Discord does")
+    args = p.parse_args()
+
+    Handler.state = State(args)
+    server = ThreadingHTTPServer(("127.0.0.1", args.port), Handler)
+    print("[webhook] listening on http://127.0.0.1:%d" % args.port, flush=True)
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
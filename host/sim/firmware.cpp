@@ -0,0 +1,9 @@
+/**
+ * firmware.cpp (host simulator)
+ * Compiles the unmodified sketch against the host stand-ins. The .ino is
+ * included as-is, the way the Arduino builder would after adding Arduino.h.
+ */
+
+#include "Arduino.h"
+
+#include "../../mercury_net_diag/mercury_net_diag.ino"
@@ -0,0 +1,107 @@
+/**
+ * Arduino.h (host stub)
+ * Just enough of the ESP32 Arduino core to build the firmware on Linux.
+ * Time is virtual (see sim_host.h); delay() advances it instantly.
+ */
+
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <ctype.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+
+#include "IPAddress.h"
+#include "Print.h"
+#include "WString.h"
+#include "esp_arduino_version.h"
+#include "esp_system.h"
+#include "esp_mac.h"
+#include "esp_timer.h"
+#include "esp_sleep.h"
+#include "esp32-hal-timer.h"
+
+#ifndef ARDUINO
+#define ARDUINO 10819
+#endif
+#define ARDUINO_ARCH_ESP32 1
+#define ESP32 1
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+
+#define IRAM_ATTR
+#define RTC_DATA_ATTR __attribute__((section("sim_rtc_data")))
+#define RTC_NOINIT_ATTR RTC_DATA_ATTR
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t value);
+
+long random(long max);
+long random(long min, long max);
+void randomSeed(unsigned long seed);
+
+// time.h helpers from esp32-hal-time
+void configTime(long gmtOffsetSec, int daylightOffsetSec, const char* server1,
+                const char* server2 = nullptr, const char* server3 = nullptr);
+bool getLocalTime(struct tm* info, uint32_t ms = 5000);
+
+class HardwareSerial : public Stream {
+public:
+    void begin(unsigned long baud) { (void)baud; }
+    void end() {}
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+    operator bool() const { return true; }
+};
+
+extern HardwareSerial Serial;
+
+class EspClass {
+public:
+    uint32_t getHeapSize();
+    uint32_t getFreeHeap();
+    uint32_t getMinFreeHeap();
+    uint32_t getMaxAllocHeap();
+    uint32_t getPsramSize();
+    uint32_t getFreePsram();
+    uint32_t getMinFreePsram();
+    uint32_t getMaxAllocPsram();
+    const char* getChipModel() { return "ESP32-D0WD-V3 (sim)"; }
+    uint8_t getChipRevision() { return 3; }
+    uint8_t getChipCores() { return 2; }
+    uint32_t getCpuFreqMHz() { return 240; }
+    const char* getSdkVersion() { return "host-sim"; }
+    uint32_t getFlashChipSize() { return 4 * 1024 * 1024; }
+    uint32_t getSketchSize() { return 1024 * 1024; }
+    uint32_t getFreeSketchSpace() { return 1310720; }
+    uint64_t getEfuseMac();
+    [[noreturn]] void restart();
+};
+
+extern EspClass ESP;
+
+#endif // HOST_ARDUINO_H
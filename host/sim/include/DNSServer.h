@@ -0,0 +1,46 @@
+/**
+ * DNSServer.h (host stub)
+ * The ESP32 core's captive-portal DNS responder. Answers A queries on a real
+ * UDP socket at 127.0.0.1 (port + offset, see sim::hostPortFor) so
+ * "dig @127.0.0.1 -p 8053 example.com" works against the host build.
+ */
+
+#ifndef HOST_DNSSERVER_H
+#define HOST_DNSSERVER_H
+
+#include "Arduino.h"
+#include "IPAddress.h"
+
+enum class DNSReplyCode : uint8_t {
+    NoError = 0,
+    FormError = 1,
+    ServerFailure = 2,
+    NonExistentDomain = 3,
+    NotImplemented = 4,
+    Refused = 5,
+};
+
+class DNSServer {
+public:
+    DNSServer();
+    ~DNSServer();
+
+    bool start(const uint16_t& port, const String& domainName, const IPAddress& resolvedIP);
+    void stop();
+    void processNextRequest();
+    void setErrorReplyCode(const DNSReplyCode& replyCode) { _errorCode = replyCode; }
+    void setTTL(const uint32_t& ttl) { _ttl = ttl; }
+
+    // Host-only: queries answered since start().
+    uint32_t answered() const { return _answered; }
+
+private:
+    int _fd;
+    char _domain[64];
+    IPAddress _ip;
+    DNSReplyCode _errorCode;
+    uint32_t _ttl;
+    uint32_t _answered;
+};
+
+#endif // HOST_DNSSERVER_H
@@ -0,0 +1,24 @@
+/**
+ * ESPmDNS.h (host stub)
+ */
+
+#ifndef HOST_ESPMDNS_H
+#define HOST_ESPMDNS_H
+
+#include "Arduino.h"
+
+class MDNSResponder {
+public:
+    bool begin(const char* hostName) { return hostName != nullptr; }
+    void end() {}
+    bool addService(const char* service, const char* proto, uint16_t port) {
+        (void)service;
+        (void)proto;
+        (void)port;
+        return true;
+    }
+};
+
+extern MDNSResponder MDNS;
+
+#endif // HOST_ESPMDNS_H
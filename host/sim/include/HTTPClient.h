@@ -0,0 +1,84 @@
+/**
+ * HTTPClient.h (host stub)
+ * Plain HTTP/1.1 over the simulated clients: https:// through a
+ * WiFiClientSecure reaches the webhook model (sim_webhook.h), http:// to a
+ * loopback address reaches a real local server.
+ */
+
+#ifndef HOST_HTTPCLIENT_H
+#define HOST_HTTPCLIENT_H
+
+#include <string>
+#include <vector>
+
+#include "Arduino.h"
+#include "WiFiClient.h"
+
+#define HTTPC_ERROR_CONNECTION_REFUSED (-1)
+#define HTTPC_ERROR_SEND_HEADER_FAILED (-2)
+#define HTTPC_ERROR_SEND_PAYLOAD_FAILED (-3)
+#define HTTPC_ERROR_NOT_CONNECTED (-4)
+#define HTTPC_ERROR_CONNECTION_LOST (-5)
+#define HTTPC_ERROR_NO_STREAM (-6)
+#define HTTPC_ERROR_NO_HTTP_SERVER (-7)
+#define HTTPC_ERROR_TOO_LESS_RAM (-8)
+#define HTTPC_ERROR_ENCODING (-9)
+#define HTTPC_ERROR_STREAM_WRITE (-10)
+#define HTTPC_ERROR_READ_TIMEOUT (-11)
+
+typedef enum {
+    HTTP_CODE_OK = 200,
+    HTTP_CODE_NO_CONTENT = 204,
+    HTTP_CODE_BAD_REQUEST = 400,
+    HTTP_CODE_NOT_FOUND = 404,
+    HTTP_CODE_TOO_MANY_REQUESTS = 429,
+    HTTP_CODE_INTERNAL_SERVER_ERROR = 500,
+} t_http_codes;
+
+class HTTPClient {
+public:
+    HTTPClient();
+    ~HTTPClient();
+
+    bool begin(WiFiClient& client, const String& url);
+    bool begin(const String& url);
+    void end();
+    bool connected();
+
+    void setReuse(bool reuse) { _reuse = reuse; }
+    void setTimeout(uint16_t timeoutMs) { _timeoutMs = timeoutMs; }
+    void setConnectTimeout(int32_t timeoutMs) { _connectTimeoutMs = timeoutMs; }
+    void addHeader(const String& name, const String& value, bool first = false, bool replace = true);
+    void collectHeaders(const char* headerKeys[], const size_t headerKeysCount);
+    String header(const char* name);
+    bool hasHeader(const char* name);
+
+    int GET();
+    int POST(const String& payload);
+    int POST(uint8_t* payload, size_t size);
+    int PATCH(const String& payload);
+    int PATCH(uint8_t* payload, size_t size);
+    int PUT(const String& payload);
+    int sendRequest(const char* type, const String& payload);
+    int sendRequest(const char* type, uint8_t* payload = nullptr, size_t size = 0);
+
+    int getSize() { return static_cast<int>(_response.size()); }
+    String getString();
+    WiFiClient& getStream();
+    static String errorToString(int error);
+
+private:
+    WiFiClient* _client;
+    WiFiClient* _ownedClient;  // begin(url) without a client
+    std::string _url;
+    std::vector<std::pair<std::string, std::string>> _headers;
+    std::vector<std::pair<std::string, std::string>> _responseHeaders;
+    std::vector<std::string> _collect;
+    std::string _response;
+    bool _began;
+    bool _reuse;
+    uint16_t _timeoutMs;
+    int32_t _connectTimeoutMs;
+};
+
+#endif // HOST_HTTPCLIENT_H
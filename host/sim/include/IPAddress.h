@@ -0,0 +1,35 @@
+/**
+ * IPAddress.h (host stub)
+ */
+
+#ifndef HOST_IPADDRESS_H
+#define HOST_IPADDRESS_H
+
+#include <stdint.h>
+
+#include "Print.h"
+#include "WString.h"
+
+class IPAddress : public Printable {
+public:
+    IPAddress() : _addr(0) {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+        : _addr(static_cast<uint32_t>(a) | (static_cast<uint32_t>(b) << 8) |
+                (static_cast<uint32_t>(c) << 16) | (static_cast<uint32_t>(d) << 24)) {}
+    IPAddress(uint32_t addr) : _addr(addr) {}
+
+    operator uint32_t() const { return _addr; }
+    uint8_t operator[](int index) const { return static_cast<uint8_t>(_addr >> (8 * index)); }
+    bool operator==(const IPAddress& other) const { return _addr == other._addr; }
+    bool operator!=(const IPAddress& other) const { return _addr != other._addr; }
+
+    bool fromString(const char* address);
+    bool fromString(const String& address) { return fromString(address.c_str()); }
+    String toString() const;
+    size_t printTo(Print& p) const override;
+
+private:
+    uint32_t _addr;  // network byte order as on the device (first octet in LSB)
+};
+
+#endif // HOST_IPADDRESS_H
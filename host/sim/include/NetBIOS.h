@@ -0,0 +1,18 @@
+/**
+ * NetBIOS.h (host stub)
+ */
+
+#ifndef HOST_NETBIOS_H
+#define HOST_NETBIOS_H
+
+#include "Arduino.h"
+
+class NetBIOS {
+public:
+    bool begin(const char* name) { return name != nullptr; }
+    void end() {}
+};
+
+extern NetBIOS NBNS;
+
+#endif // HOST_NETBIOS_H
@@ -0,0 +1,157 @@
+/**
+ * WString.h (host stub)
+ * Arduino String with the ESP32 core's API surface. Storage comes from the
+ * simulated device heap so fragmentation and allocation counts are real.
+ */
+
+#ifndef HOST_WSTRING_H
+#define HOST_WSTRING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <utility>
+
+class String {
+public:
+    String(const char* cstr = "");
+    String(const char* cstr, unsigned int length);
+    String(const String& other);
+    String(String&& other) noexcept;
+    explicit String(char c);
+    explicit String(unsigned char value, unsigned char base = 10);
+    explicit String(int value, unsigned char base = 10);
+    explicit String(unsigned int value, unsigned char base = 10);
+    explicit String(long value, unsigned char base = 10);
+    explicit String(unsigned long value, unsigned char base = 10);
+    explicit String(long long value, unsigned char base = 10);
+    explicit String(unsigned long long value, unsigned char base = 10);
+    explicit String(float value, unsigned int decimalPlaces = 2);
+    explicit String(double value, unsigned int decimalPlaces = 2);
+    ~String();
+
+    String& operator=(const String& rhs);
+    String& operator=(String&& rhs) noexcept;
+    String& operator=(const char* cstr);
+
+    bool reserve(unsigned int size);
+    unsigned int length() const { return _len; }
+    bool isEmpty() const { return _len == 0; }
+    void clear() { setLength(0); }
+
+    bool concat(const String& str) { return concat(str.c_str(), str.length()); }
+    bool concat(const char* cstr);
+    bool concat(const char* cstr, unsigned int length);
+    bool concat(char c) { return concat(&c, 1); }
+    bool concat(unsigned char num);
+    bool concat(int num);
+    bool concat(unsigned int num);
+    bool concat(long num);
+    bool concat(unsigned long num);
+    bool concat(long long num);
+    bool concat(unsigned long long num);
+    bool concat(float num);
+    bool concat(double num);
+
+    template <typename T>
+    String& operator+=(const T& rhs) {
+        concat(rhs);
+        return *this;
+    }
+    String& operator+=(const char* rhs) {
+        concat(rhs);
+        return *this;
+    }
+
+    int compareTo(const String& s) const;
+    bool equals(const String& s) const { return _len == s._len && memcmp(c_str(), s.c_str(), _len) == 0; }
+    bool equals(const char* cstr) const;
+    bool equalsIgnoreCase(const String& s) const;
+    bool operator==(const String& rhs) const { return equals(rhs); }
+    bool operator==(const char* cstr) const { return equals(cstr); }
+    bool operator!=(const String& rhs) const { return !equals(rhs); }
+    bool operator!=(const char* cstr) const { return !equals(cstr); }
+    bool operator<(const String& rhs) const { return compareTo(rhs) < 0; }
+    bool startsWith(const String& prefix) const;
+    bool startsWith(const String& prefix, unsigned int offset) const;
+    bool endsWith(const String& suffix) const;
+
+    char charAt(unsigned int index) const;
+    void setCharAt(unsigned int index, char c);
+    char operator[](unsigned int index) const { return charAt(index); }
+    char& operator[](unsigned int index);
+    void getBytes(unsigned char* buf, unsigned int bufsize, unsigned int index = 0) const;
+    void toCharArray(char* buf, unsigned int bufsize, unsigned int index = 0) const {
+        getBytes(reinterpret_cast<unsigned char*>(buf), bufsize, index);
+    }
+    const char* c_str() const { return _buf; }
+    char* begin() { return _buf; }
+    char* end() { return _buf + _len; }
+    const char* begin() const { return c_str(); }
+    const char* end() const { return c_str() + _len; }
+
+    int indexOf(char ch, unsigned int fromIndex = 0) const;
+    int indexOf(const String& str, unsigned int fromIndex = 0) const;
+    int indexOf(const char* str, unsigned int fromIndex = 0) const;
+    int lastIndexOf(char ch) const;
+    int lastIndexOf(const String& str) const;
+    String substring(unsigned int beginIndex) const { return substring(beginIndex, _len); }
+    String substring(unsigned int beginIndex, unsigned int endIndex) const;
+
+    void replace(char find, char replace);
+    void replace(const String& find, const String& replace);
+    void remove(unsigned int index);
+    void remove(unsigned int index, unsigned int count);
+    void toLowerCase();
+    void toUpperCase();
+    void trim();
+
+    long toInt() const;
+    float toFloat() const;
+    double toDouble() const;
+
+private:
+    // Small strings live inline like the ESP32 core's SSO buffer (10 chars).
+    static constexpr unsigned int kSsoCapacity = 10;
+
+    char* _buf;
+    unsigned int _len;
+    unsigned int _cap;
+    char _sso[kSsoCapacity + 1];
+
+    bool isHeap() const { return _buf != _sso; }
+    void initSso() {
+        _buf = _sso;
+        _len = 0;
+        _cap = kSsoCapacity;
+        _sso[0] = '\0';
+    }
+    void moveFrom(String& other);
+    void setLength(unsigned int len);
+    String& copy(const char* cstr, unsigned int length);
+};
+
+String operator+(const String& lhs, const String& rhs);
+String operator+(String&& lhs, const String& rhs);
+String operator+(const String& lhs, const char* rhs);
+String operator+(String&& lhs, const char* rhs);
+String operator+(const char* lhs, const String& rhs);
+String operator+(const char* lhs, String&& rhs);
+
+template <typename T>
+String operator+(const String& lhs, const T& rhs) {
+    String out(lhs);
+    out.concat(rhs);
+    return out;
+}
+
+template <typename T>
+String operator+(String&& lhs, const T& rhs) {
+    lhs.concat(rhs);
+    return std::move(lhs);
+}
+
+inline bool operator==(const char* lhs, const String& rhs) { return rhs.equals(lhs); }
+inline bool operator!=(const char* lhs, const String& rhs) { return !rhs.equals(lhs); }
+
+#endif // HOST_WSTRING_H
@@ -0,0 +1,150 @@
+/**
+ * WebServer.h (host stub)
+ * Synchronous single-connection HTTP server like the ESP32 core's, serving
+ * real sockets on 127.0.0.1 (port + SIM_PORT_OFFSET) so curl and load tools
+ * can talk to the host build. multipart/form-data bodies go to the route's
+ * upload handler part by part in HTTP_UPLOAD_BUFLEN chunks, as on the device.
+ */
+
+#ifndef HOST_WEBSERVER_H
+#define HOST_WEBSERVER_H
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "Arduino.h"
+#include "FS.h"
+#include "WiFi.h"
+
+typedef enum {
+    HTTP_ANY = 0,
+    HTTP_GET = 1 << 0,
+    HTTP_HEAD = 1 << 1,
+    HTTP_POST = 1 << 2,
+    HTTP_PUT = 1 << 3,
+    HTTP_PATCH = 1 << 4,
+    HTTP_DELETE = 1 << 5,
+    HTTP_OPTIONS = 1 << 6,
+} HTTPMethod;
+
+enum HTTPUploadStatus { UPLOAD_FILE_START, UPLOAD_FILE_WRITE, UPLOAD_FILE_END, UPLOAD_FILE_ABORTED };
+
+#define HTTP_UPLOAD_BUFLEN 1436
+#define CONTENT_LENGTH_UNKNOWN ((size_t)-1)
+#define CONTENT_LENGTH_NOT_SET ((size_t)-2)
+
+typedef struct {
+    HTTPUploadStatus status;
+    String filename;
+    String name;
+    String type;
+    size_t totalSize;
+    size_t currentSize;
+    uint8_t buf[HTTP_UPLOAD_BUFLEN];
+} HTTPUpload;
+
+class WebServer {
+public:
+    typedef std::function<void(void)> THandlerFunction;
+
+    WebServer(IPAddress addr, int port = 80);  // addr: the host build binds 127.0.0.1 anyway
+    WebServer(int port = 80);
+    ~WebServer();
+
+    void begin();
+    void begin(uint16_t port);
+    void handleClient();
+    void close();
+    void stop();
+
+    void on(const String& uri, THandlerFunction handler);
+    void on(const String& uri, HTTPMethod method, THandlerFunction fn);
+    void on(const String& uri, HTTPMethod method, THandlerFunction fn, THandlerFunction ufn);
+    void onNotFound(THandlerFunction fn) { _notFound = fn; }
+    void onFileUpload(THandlerFunction fn) { _fileUpload = fn; }
+
+    String uri() const { return String(_uri.c_str()); }
+    HTTPMethod method() const { return _method; }
+    WiFiClient client();  // the request's connection; a kept copy outlives the handler
+    HTTPUpload& upload() { return _upload; }
+
+    String pathArg(unsigned int i) const;
+    String arg(const String& name) const;
+    String arg(int i) const;
+    String argName(int i) const;
+    int args() const { return static_cast<int>(_args.size()); }
+    bool hasArg(const String& name) const;
+    void collectHeaders(const char* headerKeys[], const size_t headerKeysCount);
+    String header(const String& name) const;
+    String header(int i) const;
+    String headerName(int i) const;
+    int headers() const { return static_cast<int>(_reqHeaders.size()); }
+    bool hasHeader(const String& name) const;
+    String hostHeader() const { return header("Host"); }
+
+    void send(int code, const char* content_type = nullptr, const String& content = String(""));
+    void send(int code, char* content_type, const String& content) {
+        send(code, static_cast<const char*>(content_type), content);
+    }
+    void send(int code, const String& content_type, const String& content) {
+        send(code, content_type.c_str(), content);
+    }
+    void send(int code, const char* content_type, const char* content, size_t contentLength);
+    void send_P(int code, const char* content_type, const char* content) { send(code, content_type, String(content)); }
+    void send_P(int code, const char* content_type, const char* content, size_t contentLength) {
+        send(code, content_type, content, contentLength);
+    }
+
+    void setContentLength(const size_t contentLength) { _contentLength = contentLength; }
+    void sendHeader(const String& name, const String& value, bool first = false);
+    void sendContent(const String& content) { sendContent(content.c_str(), content.length()); }
+    void sendContent(const char* content, size_t contentLength);
+    void sendContent_P(const char* content) { sendContent(content, strlen(content)); }
+    void sendContent_P(const char* content, size_t size) { sendContent(content, size); }
+    size_t streamFile(File& file, const String& contentType);
+
+    static String urlDecode(const String& text);
+
+    // Host-only: port actually bound (port + SIM_PORT_OFFSET, or ephemeral).
+    uint16_t hostPort() const { return _hostPort; }
+
+private:
+    struct Route {
+        std::string uri;
+        HTTPMethod method;
+        THandlerFunction fn;
+        THandlerFunction ufn;
+    };
+
+    bool readRequest(int fd);
+    void parseArgs(const std::string& query);
+    void dispatch();
+    bool runUploads(const THandlerFunction& ufn);
+    void writeRaw(const char* data, size_t len);
+    void sendHeaderBlock(int code, const char* contentType, size_t contentLength);
+
+    int _port;
+    uint16_t _hostPort;
+    int _listenFd;
+    bool _loopback;  // bound to 127.0.0.1 on the device: no radio in between
+    int _fd;
+    std::vector<Route> _routes;
+    THandlerFunction _notFound;
+    THandlerFunction _fileUpload;
+    HTTPUpload _upload;
+
+    std::string _uri;
+    HTTPMethod _method;
+    std::vector<std::pair<std::string, std::string>> _args;
+    std::string _boundary;   // "--" + boundary of a multipart body, else empty
+    std::string _multipart;  // its body
+    std::vector<std::pair<std::string, std::string>> _reqHeaders;
+    std::vector<std::string> _collect;
+    std::vector<std::pair<std::string, std::string>> _respHeaders;
+    size_t _contentLength;
+    bool _chunked;
+    bool _headersSent;
+};
+
+#endif // HOST_WEBSERVER_H
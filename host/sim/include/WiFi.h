@@ -0,0 +1,218 @@
+/**
+ * WiFi.h (host stub)
+ * WiFiClass backed by the scriptable fake radio (sim_radio.h), plus a
+ * WiFiClient that either answers from the radio's host table (probe
+ * targets) or opens a real TCP socket to a loopback service (local broker,
+ * webhook stand-in), and a WiFiServer on a real loopback socket.
+ */
+
+#ifndef HOST_WIFI_H
+#define HOST_WIFI_H
+
+#include <functional>
+
+#include "Arduino.h"
+#include "esp_wifi.h"
+
+typedef enum {
+    WL_NO_SHIELD = 255,
+    WL_IDLE_STATUS = 0,
+    WL_NO_SSID_AVAIL = 1,
+    WL_SCAN_COMPLETED = 2,
+    WL_CONNECTED = 3,
+    WL_CONNECT_FAILED = 4,
+    WL_CONNECTION_LOST = 5,
+    WL_DISCONNECTED = 6
+} wl_status_t;
+
+#define WIFI_STA WIFI_MODE_STA
+#define WIFI_AP WIFI_MODE_AP
+#define WIFI_AP_STA WIFI_MODE_APSTA
+#define WIFI_OFF WIFI_MODE_NULL
+
+#define WIFI_SCAN_RUNNING (-1)
+#define WIFI_SCAN_FAILED (-2)
+
+typedef enum {
+    ARDUINO_EVENT_WIFI_READY = 0,
+    ARDUINO_EVENT_WIFI_SCAN_DONE,
+    ARDUINO_EVENT_WIFI_STA_START,
+    ARDUINO_EVENT_WIFI_STA_STOP,
+    ARDUINO_EVENT_WIFI_STA_CONNECTED,
+    ARDUINO_EVENT_WIFI_STA_DISCONNECTED,
+    ARDUINO_EVENT_WIFI_STA_AUTHMODE_CHANGE,
+    ARDUINO_EVENT_WIFI_STA_GOT_IP,
+    ARDUINO_EVENT_WIFI_STA_GOT_IP6,
+    ARDUINO_EVENT_WIFI_STA_LOST_IP,
+    ARDUINO_EVENT_WIFI_AP_START,
+    ARDUINO_EVENT_WIFI_AP_STOP,
+    ARDUINO_EVENT_WIFI_AP_STACONNECTED,
+    ARDUINO_EVENT_WIFI_AP_STADISCONNECTED,
+    ARDUINO_EVENT_MAX
+} arduino_event_id_t;
+
+typedef struct {
+    uint8_t ssid[33];
+    uint8_t ssid_len;
+    uint8_t bssid[6];
+    uint8_t reason;
+} wifi_event_sta_disconnected_t;
+
+typedef struct {
+    uint8_t ssid[33];
+    uint8_t ssid_len;
+    uint8_t bssid[6];
+    uint8_t channel;
+    wifi_auth_mode_t authmode;
+} wifi_event_sta_connected_t;
+
+typedef struct {
+    uint32_t ip;
+} ip_event_got_ip_t;
+
+typedef union {
+    wifi_event_sta_connected_t wifi_sta_connected;
+    wifi_event_sta_disconnected_t wifi_sta_disconnected;
+    ip_event_got_ip_t got_ip;
+} arduino_event_info_t;
+
+typedef struct {
+    arduino_event_id_t event_id;
+    arduino_event_info_t event_info;
+} arduino_event_t;
+
+typedef std::function<void(arduino_event_id_t event, arduino_event_info_t info)> WiFiEventFuncCb;
+typedef int wifi_event_id_t;
+
+class WiFiClass {
+public:
+    // Station
+    wl_status_t begin(const char* ssid, const char* passphrase = nullptr, int32_t channel = 0,
+                      const uint8_t* bssid = nullptr, bool connect = true);
+    bool disconnect(bool wifioff = false, bool eraseap = false);
+    bool reconnect();
+    wl_status_t status();
+    bool isConnected() { return status() == WL_CONNECTED; }
+    bool setAutoReconnect(bool autoReconnect);
+    bool getAutoReconnect();
+    bool config(IPAddress local, IPAddress gateway, IPAddress subnet,
+                IPAddress dns1 = IPAddress(), IPAddress dns2 = IPAddress());
+
+    String SSID() const;
+    String psk() const;
+    uint8_t* BSSID();
+    String BSSIDstr();
+    int8_t RSSI();
+    int32_t channel();
+    IPAddress localIP();
+    IPAddress gatewayIP();
+    IPAddress subnetMask();
+    IPAddress dnsIP(uint8_t dnsNo = 0);
+    IPAddress broadcastIP();
+    String macAddress();
+    uint8_t* macAddress(uint8_t* mac);
+    const char* getHostname();
+    bool setHostname(const char* hostname);
+
+    // Generic
+    bool mode(wifi_mode_t m);
+    void persistent(bool enabled) { (void)enabled; }
+    wifi_mode_t getMode();
+    bool setSleep(bool enabled);
+    bool getSleep();
+    int getTxPower() { return 78; }  // 19.5 dBm in 0.25 dBm units, as on the device
+    wifi_event_id_t onEvent(WiFiEventFuncCb cb, arduino_event_id_t event = ARDUINO_EVENT_MAX);
+    void removeEvent(wifi_event_id_t id);
+    int hostByName(const char* host, IPAddress& result);
+
+    // Scan
+    int16_t scanNetworks(bool async = false, bool show_hidden = false, bool passive = false,
+                         uint32_t max_ms_per_chan = 300, uint8_t channel = 0);
+    int16_t scanComplete();
+    void scanDelete();
+    void* getScanInfoByIndex(int i);
+    String SSID(uint8_t i);
+    int32_t RSSI(uint8_t i);
+    uint8_t* BSSID(uint8_t i);
+    String BSSIDstr(uint8_t i);
+    int32_t channel(uint8_t i);
+    wifi_auth_mode_t encryptionType(uint8_t i);
+
+    // Soft AP
+    bool softAP(const char* ssid, const char* passphrase = nullptr, int channel = 1,
+                int ssid_hidden = 0, int max_connection = 4);
+    bool softAPConfig(IPAddress local_ip, IPAddress gateway, IPAddress subnet);
+    bool softAPdisconnect(bool wifioff = false);
+    IPAddress softAPIP();
+    uint8_t softAPgetStationNum();
+};
+
+extern WiFiClass WiFi;
+
+class WiFiClient : public Stream {
+public:
+    WiFiClient();
+    explicit WiFiClient(int fd);  // accepted connection (WebServer)
+    virtual ~WiFiClient();
+    // Copies share the connection like the core's (socket handle held by
+    // shared_ptr): it closes when the last copy stops.
+    WiFiClient(const WiFiClient& other);
+    WiFiClient& operator=(const WiFiClient& other);
+
+    virtual int connect(IPAddress ip, uint16_t port);
+    virtual int connect(IPAddress ip, uint16_t port, int32_t timeoutMs);
+    virtual int connect(const char* host, uint16_t port);
+    virtual int connect(const char* host, uint16_t port, int32_t timeoutMs);
+    virtual void stop();
+    virtual uint8_t connected();
+    operator bool() { return connected(); }
+
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+    int available() override;
+    int read() override;
+    virtual int read(uint8_t* buffer, size_t size);
+    int peek() override;
+    void setNoDelay(bool) {}
+    IPAddress remoteIP() const { return _remote; }
+    uint16_t remotePort() const { return _remotePort; }
+
+protected:
+    // Real TCP connection to a local service (no Wi-Fi checks, no RX buffer).
+    int connectReal(uint32_t ip, uint16_t port);
+
+    int _fd;            // real socket, or -1
+    bool _simulated;    // connected to a scripted host (no payload)
+    IPAddress _remote;
+    uint16_t _remotePort;
+    int _peeked;
+    void* _rxBuf;       // stands in for the core's per-connection RX buffer
+};
+
+// TCP listener on 127.0.0.1 at (port + SIM_PORT_OFFSET), like the WebServer;
+// available() hands out accepted connections without waiting.
+class WiFiServer {
+public:
+    explicit WiFiServer(uint16_t port = 80, uint8_t maxClients = 4);
+    ~WiFiServer();
+    WiFiServer(const WiFiServer&) = delete;
+    WiFiServer& operator=(const WiFiServer&) = delete;
+
+    void begin(uint16_t port = 0);
+    void end();
+    void close() { end(); }
+    void stop() { end(); }
+    bool hasClient();
+    WiFiClient available();  // unconnected client when nobody is waiting
+    WiFiClient accept() { return available(); }
+    void setNoDelay(bool) {}
+    operator bool() const { return _listenFd >= 0; }
+
+private:
+    uint16_t _port;
+    int _listenFd;
+    int _waitingFd;  // accepted by hasClient(), not yet handed out
+};
+
+#endif // HOST_WIFI_H
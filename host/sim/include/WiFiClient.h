@@ -0,0 +1,10 @@
+/**
+ * WiFiClient.h (host stub)
+ */
+
+#ifndef HOST_WIFICLIENT_H
+#define HOST_WIFICLIENT_H
+
+#include "WiFi.h"
+
+#endif // HOST_WIFICLIENT_H
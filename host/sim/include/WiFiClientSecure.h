@@ -0,0 +1,70 @@
+/**
+ * WiFiClientSecure.h (host stub)
+ * TLS is modelled, not implemented: connect() charges the simulated heap with
+ * the buffers mbedTLS would hold for the session (and the transient handshake
+ * state), costs handshake round trips in virtual time, and fails the way the
+ * device does when no block is large enough for the 16 KB record buffer.
+ * Traffic then goes to the webhook model (sim_webhook.h) or its stand-in;
+ * sessions to 127.0.0.1 go unencrypted to that local port (e.g. a broker).
+ */
+
+#ifndef HOST_WIFI_CLIENT_SECURE_H
+#define HOST_WIFI_CLIENT_SECURE_H
+
+#include <string>
+
+#include "WiFiClient.h"
+
+class WiFiClientSecure : public WiFiClient {
+public:
+    WiFiClientSecure();
+    ~WiFiClientSecure() override;
+    WiFiClientSecure(const WiFiClientSecure&) = delete;  // owns the session state
+    WiFiClientSecure& operator=(const WiFiClientSecure&) = delete;
+
+    void setInsecure() { _insecure = true; }
+    void setCACert(const char* rootCA) { _caCert = rootCA; }
+    void setHandshakeTimeout(unsigned long seconds) { (void)seconds; }
+
+    int connect(IPAddress ip, uint16_t port) override;
+    int connect(IPAddress ip, uint16_t port, int32_t timeoutMs) override;
+    int connect(const char* host, uint16_t port) override;
+    int connect(const char* host, uint16_t port, int32_t timeoutMs) override;
+    void stop() override;
+    uint8_t connected() override;
+
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+    int available() override;
+    int read() override;
+    int read(uint8_t* buffer, size_t size) override;
+    int peek() override;
+
+private:
+    bool openSession();
+    void closeSession();
+    void onRequestBytes(const uint8_t* data, size_t len);
+    void onResponseBytes(const uint8_t* data, size_t len);
+
+    bool _insecure = false;
+    const char* _caCert = nullptr;
+
+    bool _session = false;   // TLS session up
+    bool _model = false;     // answered in-process (else stand-in socket)
+    bool _passthrough = false;  // loopback service, not the webhook
+    void* _sslContext = nullptr;
+    void* _inRecord = nullptr;
+    void* _outRecord = nullptr;
+
+    // Host-side bookkeeping (only touched inside sim::HostScope).
+    std::string _tx;         // request bytes not yet framed
+    std::string _rx;         // in-process response bytes
+    size_t _rxPos = 0;
+    uint64_t _rxReadyUs = 0;
+    bool _peerClosed = false;
+    std::string _statusLine; // response status line being sniffed
+    bool _wantStatus = false;
+};
+
+#endif // HOST_WIFI_CLIENT_SECURE_H
@@ -0,0 +1,68 @@
+/**
+ * WiFiUdp.h (host stub)
+ * The ESP32 core's WiFiUDP on a real host UDP socket.
+ *
+ * Multicast groups use their port as is (no port offset) on the loopback
+ * interface, with loopback delivery on, so several simulator processes on
+ * one machine are devices on the same LAN: each receives what the others
+ * send - and, like lwIP with IP_MULTICAST_LOOP, its own packets too.
+ * Unicast reaches 127.0.0.1 only; packets to other addresses are dropped,
+ * as is traffic while the station is not connected. The sender's address
+ * is always 127.0.0.1.
+ */
+
+#ifndef HOST_WIFIUDP_H
+#define HOST_WIFIUDP_H
+
+#include "Arduino.h"
+#include "IPAddress.h"
+
+class WiFiUDP : public Stream {
+public:
+    WiFiUDP();
+    ~WiFiUDP();
+    WiFiUDP(const WiFiUDP&) = delete;
+    WiFiUDP& operator=(const WiFiUDP&) = delete;
+
+    uint8_t begin(uint16_t port);  // 127.0.0.1 at the host port for port
+    uint8_t begin(IPAddress address, uint16_t port) { (void)address; return begin(port); }
+    uint8_t beginMulticast(IPAddress multicast, uint16_t port);
+    void stop();
+
+    int beginPacket(IPAddress ip, uint16_t port);
+    int beginPacket(const char* host, uint16_t port);
+    int beginMulticastPacket();  // to the group joined with beginMulticast()
+    int endPacket();
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+
+    int parsePacket();
+    int available() override;
+    int read() override;
+    int read(unsigned char* buffer, size_t len);
+    int read(char* buffer, size_t len) { return read(reinterpret_cast<unsigned char*>(buffer), len); }
+    int peek() override;
+    void flush();
+
+    IPAddress remoteIP() const { return _remoteIp; }
+    uint16_t remotePort() const { return _remotePort; }
+
+private:
+    int _fd;
+    IPAddress _group;
+    uint16_t _port;
+    uint8_t* _tx;       // 1460 bytes on the device heap, as the core's tx_buffer
+    size_t _txLen;
+    uint32_t _txIp;
+    uint16_t _txPort;
+    uint8_t* _rx;       // the current packet, on the device heap
+    size_t _rxLen;
+    size_t _rxPos;
+    IPAddress _remoteIp;
+    uint16_t _remotePort;
+
+    void dropRx();
+};
+
+#endif // HOST_WIFIUDP_H
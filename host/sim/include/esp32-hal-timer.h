@@ -0,0 +1,38 @@
+/**
+ * esp32-hal-timer.h (host stub)
+ * Arduino-ESP32 hardware timer API: the 2.x one, or the 3.x one when
+ * ESP_ARDUINO_VERSION_MAJOR >= 3 (timers by frequency, no number or
+ * divider; the 2.x calls are gone there). Alarms count host CPU time
+ * (ITIMER_PROF) and run the attached function from SIGPROF, in the middle of
+ * whatever the simulator was doing, like a timer interrupt; they exist for
+ * the sampling profiler. One alarm can be enabled at a time.
+ */
+
+#ifndef HOST_ESP32_HAL_TIMER_H
+#define HOST_ESP32_HAL_TIMER_H
+
+#include <stdint.h>
+
+#include "esp_arduino_version.h"
+
+struct hw_timer_s;
+typedef struct hw_timer_s hw_timer_t;
+
+#if ESP_ARDUINO_VERSION_MAJOR >= 3
+hw_timer_t* timerBegin(uint32_t frequency);
+void timerEnd(hw_timer_t* timer);
+void timerAttachInterrupt(hw_timer_t* timer, void (*fn)(void));
+void timerDetachInterrupt(hw_timer_t* timer);
+void timerAlarm(hw_timer_t* timer, uint64_t alarmValue, bool autoreload, uint64_t reloadCount);
+void timerStop(hw_timer_t* timer);
+#else
+hw_timer_t* timerBegin(uint8_t num, uint16_t divider, bool countUp);
+void timerEnd(hw_timer_t* timer);
+void timerAttachInterrupt(hw_timer_t* timer, void (*fn)(void), bool edge);
+void timerDetachInterrupt(hw_timer_t* timer);
+void timerAlarmWrite(hw_timer_t* timer, uint64_t alarmValue, bool autoreload);
+void timerAlarmEnable(hw_timer_t* timer);
+void timerAlarmDisable(hw_timer_t* timer);
+#endif
+
+#endif // HOST_ESP32_HAL_TIMER_H
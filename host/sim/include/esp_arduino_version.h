@@ -0,0 +1,21 @@
+/**
+ * esp_arduino_version.h (host stub)
+ * The simulator models Arduino-ESP32 2.x; build with
+ * -DESP_ARDUINO_VERSION_MAJOR=3 to compile against the 3.x timer API instead
+ * (esp32-hal-timer.h).
+ */
+
+#ifndef HOST_ESP_ARDUINO_VERSION_H
+#define HOST_ESP_ARDUINO_VERSION_H
+
+#ifndef ESP_ARDUINO_VERSION_MAJOR
+#define ESP_ARDUINO_VERSION_MAJOR 2
+#endif
+#define ESP_ARDUINO_VERSION_MINOR 0
+#define ESP_ARDUINO_VERSION_PATCH 17
+
+#define ESP_ARDUINO_VERSION_VAL(major, minor, patch) (((major) << 16) | ((minor) << 8) | (patch))
+#define ESP_ARDUINO_VERSION \
+    ESP_ARDUINO_VERSION_VAL(ESP_ARDUINO_VERSION_MAJOR, ESP_ARDUINO_VERSION_MINOR, ESP_ARDUINO_VERSION_PATCH)
+
+#endif // HOST_ESP_ARDUINO_VERSION_H
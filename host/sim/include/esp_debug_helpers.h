@@ -0,0 +1,25 @@
+/**
+ * esp_debug_helpers.h (host stub)
+ * Frame-pointer unwinding of the host stack (the simulator builds with
+ * -fno-omit-frame-pointer when profiling). Called from a timer interrupt
+ * (see esp32-hal-timer.h), esp_backtrace_get_start() starts at the
+ * interrupted code, as unwinding from the exception frame does on the device.
+ */
+
+#ifndef HOST_ESP_DEBUG_HELPERS_H
+#define HOST_ESP_DEBUG_HELPERS_H
+
+#include <stdint.h>
+
+// Host-width fields; the device's are uint32_t.
+typedef struct {
+    uintptr_t pc;       // PC of the current frame
+    uintptr_t sp;       // frame pointer of the current frame
+    uintptr_t next_pc;  // return address into the caller
+    const void* exc_frame;
+} esp_backtrace_frame_t;
+
+void esp_backtrace_get_start(uintptr_t* pc, uintptr_t* sp, uintptr_t* next_pc);
+bool esp_backtrace_get_next_frame(esp_backtrace_frame_t* frame);
+
+#endif // HOST_ESP_DEBUG_HELPERS_H
@@ -0,0 +1,21 @@
+/**
+ * esp_rom_crc.h (host stub)
+ * Same convention as the ROM routine: the running CRC is passed in and out
+ * uninverted, so esp_rom_crc32_le(0, ...) gives the zlib / gzip CRC-32.
+ */
+
+#ifndef HOST_ESP_ROM_CRC_H
+#define HOST_ESP_ROM_CRC_H
+
+#include <stdint.h>
+
+inline uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t* buf, uint32_t len) {
+    crc = ~crc;
+    while (len--) {
+        crc ^= *buf++;
+        for (int i = 0; i < 8; ++i) crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+    }
+    return ~crc;
+}
+
+#endif // HOST_ESP_ROM_CRC_H
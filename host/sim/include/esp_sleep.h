@@ -0,0 +1,36 @@
+/**
+ * esp_sleep.h (host stub)
+ * Deep sleep ends the current simulated boot; the driver advances the
+ * virtual clock by the armed timer (or to the next scripted button press)
+ * and boots again with RTC memory preserved.
+ */
+
+#ifndef HOST_ESP_SLEEP_H
+#define HOST_ESP_SLEEP_H
+
+#include <stdint.h>
+
+#include "esp_err.h"
+
+typedef enum {
+    ESP_SLEEP_WAKEUP_UNDEFINED = 0,
+    ESP_SLEEP_WAKEUP_ALL,
+    ESP_SLEEP_WAKEUP_EXT0,
+    ESP_SLEEP_WAKEUP_EXT1,
+    ESP_SLEEP_WAKEUP_TIMER,
+    ESP_SLEEP_WAKEUP_TOUCHPAD,
+    ESP_SLEEP_WAKEUP_ULP,
+    ESP_SLEEP_WAKEUP_GPIO,
+    ESP_SLEEP_WAKEUP_UART,
+} esp_sleep_wakeup_cause_t;
+
+typedef int gpio_num_t;
+#define GPIO_NUM_0 0
+
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t time_in_us);
+esp_err_t esp_sleep_enable_ext0_wakeup(int gpio_num, int level);
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause(void);
+[[noreturn]] void esp_deep_sleep_start(void);
+[[noreturn]] void esp_deep_sleep(uint64_t time_in_us);
+
+#endif // HOST_ESP_SLEEP_H
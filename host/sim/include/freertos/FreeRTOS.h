@@ -0,0 +1,26 @@
+/**
+ * freertos/FreeRTOS.h (host stub)
+ * Just enough of FreeRTOS for code that asks which task and core it runs on.
+ * The simulator runs the sketch as "loopTask" on core 1 and Wi-Fi event
+ * callbacks as "sys_evt" on core 0, like the Arduino core does.
+ */
+
+#ifndef HOST_FREERTOS_H
+#define HOST_FREERTOS_H
+
+#include <stdint.h>
+
+#define portNUM_PROCESSORS 2
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdPASS pdTRUE
+#define pdFAIL pdFALSE
+#define errCOULD_NOT_ALLOCATE_REQUIRED_MEMORY (-1)
+
+BaseType_t xPortGetCoreID(void);
+
+#endif // HOST_FREERTOS_H
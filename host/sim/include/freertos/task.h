@@ -0,0 +1,25 @@
+/**
+ * freertos/task.h (host stub)
+ */
+
+#ifndef HOST_FREERTOS_TASK_H
+#define HOST_FREERTOS_TASK_H
+
+#include "freertos/FreeRTOS.h"
+
+struct tskTaskControlBlock;
+typedef struct tskTaskControlBlock* TaskHandle_t;
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+// NULL: the calling task
+char* pcTaskGetName(TaskHandle_t task);
+
+typedef void (*TaskFunction_t)(void*);
+
+// No other tasks run here: creation fails, so callers take the path they
+// have for that (serving from loop(), ...).
+BaseType_t xTaskCreate(TaskFunction_t code, const char* name, uint32_t stackDepth, void* param,
+                       UBaseType_t priority, TaskHandle_t* created);
+void vTaskDelete(TaskHandle_t task);
+
+#endif // HOST_FREERTOS_TASK_H
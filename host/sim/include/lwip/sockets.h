@@ -0,0 +1,25 @@
+/**
+ * lwip/sockets.h (host stub)
+ * The lwip_* socket calls the firmware uses for TCP probes, answered by the
+ * fake radio's host table. Only connect-and-close probing is modelled.
+ */
+
+#ifndef HOST_LWIP_SOCKETS_H
+#define HOST_LWIP_SOCKETS_H
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+
+int lwip_socket(int domain, int type, int protocol);
+int lwip_connect(int s, const struct sockaddr* name, socklen_t namelen);
+int lwip_select(int maxfdp1, fd_set* readset, fd_set* writeset, fd_set* exceptset, struct timeval* timeout);
+int lwip_getsockopt(int s, int level, int optname, void* optval, socklen_t* optlen);
+int lwip_fcntl(int s, int cmd, int val);
+int lwip_close(int s);
+
+#endif // HOST_LWIP_SOCKETS_H
@@ -0,0 +1,11 @@
+/**
+ * mbedtls/ctr_drbg.h (host stub)
+ * Declared with the rest of the TLS stand-in in mbedtls/ssl.h.
+ */
+
+#ifndef HOST_MBEDTLS_CTR_DRBG_H
+#define HOST_MBEDTLS_CTR_DRBG_H
+
+#include "mbedtls/ssl.h"
+
+#endif // HOST_MBEDTLS_CTR_DRBG_H
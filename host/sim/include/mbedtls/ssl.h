@@ -0,0 +1,213 @@
+/**
+ * mbedtls/ssl.h (host stub)
+ * The server side of mbedTLS 2.28 (the ESP32 Arduino core 2.x version) that
+ * ArduinoMCP's TLS front uses, on top of the host's OpenSSL: handshakes,
+ * records, the session-ID cache and session tickets are real, so curl,
+ * Python and browsers connect, resume and keep sessions alive as they
+ * would with the device. TLS 1.2 only, like the device.
+ *
+ * What the device pays is modelled on top: the ssl context and its record
+ * buffers (16 KB in / 4 KB out) and the transient handshake state are
+ * charged to the simulated heap, cache entries too, and a full handshake
+ * (ECDHE + ECDSA signature with the P-256 key) or a resumed one (PRF only)
+ * costs virtual time.
+ *
+ * The session cache and the ticket callbacks are called the way mbedTLS
+ * calls them: f_set_cache after a full handshake that handed out a session
+ * ID, f_get_cache when a client offers one, f_ticket_parse when it offers a
+ * ticket; a resumption happens only when they return 0. Writes are taken
+ * whole (the memory BIO never blocks) and flushed on later calls if the
+ * socket would block.
+ */
+
+#ifndef HOST_MBEDTLS_SSL_H
+#define HOST_MBEDTLS_SSL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MBEDTLS_VERSION_MAJOR 2
+#define MBEDTLS_VERSION_MINOR 28
+#define MBEDTLS_VERSION_NUMBER 0x021C0300
+
+#define MBEDTLS_SSL_CACHE_C
+#define MBEDTLS_SSL_TICKET_C
+#define MBEDTLS_SSL_SESSION_TICKETS
+
+#define MBEDTLS_ERR_NET_RECV_FAILED -0x004C
+#define MBEDTLS_ERR_NET_SEND_FAILED -0x004E
+#define MBEDTLS_ERR_NET_CONN_RESET -0x0050
+#define MBEDTLS_ERR_SSL_BAD_INPUT_DATA -0x7100
+#define MBEDTLS_ERR_SSL_INVALID_MAC -0x7180
+#define MBEDTLS_ERR_SSL_CONN_EOF -0x7280
+#define MBEDTLS_ERR_SSL_FATAL_ALERT_MESSAGE -0x7780
+#define MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY -0x7880
+#define MBEDTLS_ERR_SSL_ALLOC_FAILED -0x7F00
+#define MBEDTLS_ERR_SSL_WANT_READ -0x6900
+#define MBEDTLS_ERR_SSL_WANT_WRITE -0x6880
+#define MBEDTLS_ERR_X509_INVALID_FORMAT -0x2180
+#define MBEDTLS_ERR_PK_KEY_INVALID_FORMAT -0x3D00
+
+#define MBEDTLS_SSL_IS_CLIENT 0
+#define MBEDTLS_SSL_IS_SERVER 1
+#define MBEDTLS_SSL_TRANSPORT_STREAM 0
+#define MBEDTLS_SSL_PRESET_DEFAULT 0
+
+#define MBEDTLS_SSL_CACHE_DEFAULT_TIMEOUT 86400
+#define MBEDTLS_SSL_CACHE_DEFAULT_MAX_ENTRIES 50
+
+typedef enum {
+    MBEDTLS_CIPHER_AES_128_GCM = 44,
+    MBEDTLS_CIPHER_AES_256_GCM = 46,
+} mbedtls_cipher_type_t;
+
+typedef int mbedtls_ssl_send_t(void* ctx, const unsigned char* buf, size_t len);
+typedef int mbedtls_ssl_recv_t(void* ctx, unsigned char* buf, size_t len);
+typedef int mbedtls_ssl_recv_timeout_t(void* ctx, unsigned char* buf, size_t len, uint32_t timeout);
+
+// ---- Entropy and DRBG (both draw from OpenSSL's RAND) ----
+
+typedef struct mbedtls_entropy_context {
+    int unused;
+} mbedtls_entropy_context;
+
+typedef struct mbedtls_ctr_drbg_context {
+    int seeded;
+} mbedtls_ctr_drbg_context;
+
+void mbedtls_entropy_init(mbedtls_entropy_context* ctx);
+void mbedtls_entropy_free(mbedtls_entropy_context* ctx);
+int mbedtls_entropy_func(void* data, unsigned char* output, size_t len);
+
+void mbedtls_ctr_drbg_init(mbedtls_ctr_drbg_context* ctx);
+void mbedtls_ctr_drbg_free(mbedtls_ctr_drbg_context* ctx);
+int mbedtls_ctr_drbg_seed(mbedtls_ctr_drbg_context* ctx, int (*f_entropy)(void*, unsigned char*, size_t),
+                          void* p_entropy, const unsigned char* custom, size_t len);
+int mbedtls_ctr_drbg_random(void* p_rng, unsigned char* output, size_t output_len);
+
+// ---- Certificate and key ----
+
+typedef struct mbedtls_x509_crt {
+    void* chain;   // STACK_OF(X509), leaf first
+    void* charge;  // simulated heap
+} mbedtls_x509_crt;
+
+typedef struct mbedtls_pk_context {
+    void* key;     // EVP_PKEY
+    void* charge;
+} mbedtls_pk_context;
+
+void mbedtls_x509_crt_init(mbedtls_x509_crt* crt);
+void mbedtls_x509_crt_free(mbedtls_x509_crt* crt);
+// PEM (buflen counts the terminating NUL) or DER; PEM may hold a chain
+int mbedtls_x509_crt_parse(mbedtls_x509_crt* chain, const unsigned char* buf, size_t buflen);
+
+void mbedtls_pk_init(mbedtls_pk_context* ctx);
+void mbedtls_pk_free(mbedtls_pk_context* ctx);
+int mbedtls_pk_parse_key(mbedtls_pk_context* ctx, const unsigned char* key, size_t keylen, const unsigned char* pwd,
+                         size_t pwdlen);
+
+// ---- Sessions ----
+
+typedef struct mbedtls_ssl_session {
+    int ciphersuite;
+    size_t id_len;
+    unsigned char id[32];
+    int64_t start;           // seconds of uptime
+    unsigned char* der;      // i2d_SSL_SESSION (host heap)
+    size_t der_len;
+    int ticket_ok;           // set while a ticket OpenSSL decrypted is offered to f_ticket_parse
+} mbedtls_ssl_session;
+
+void mbedtls_ssl_session_init(mbedtls_ssl_session* session);
+void mbedtls_ssl_session_free(mbedtls_ssl_session* session);
+
+// ---- Config ----
+
+typedef struct mbedtls_ssl_config {
+    void* ctx;               // SSL_CTX
+    void* charge;
+    int endpoint;
+    int (*f_rng)(void*, unsigned char*, size_t);
+    void* p_rng;
+    int (*f_get_cache)(void*, mbedtls_ssl_session*);
+    int (*f_set_cache)(void*, const mbedtls_ssl_session*);
+    void* p_cache;
+    int (*f_ticket_write)(void*, const mbedtls_ssl_session*, unsigned char*, const unsigned char*, size_t*,
+                          uint32_t*);
+    int (*f_ticket_parse)(void*, mbedtls_ssl_session*, unsigned char*, size_t);
+    void* p_ticket;
+} mbedtls_ssl_config;
+
+void mbedtls_ssl_config_init(mbedtls_ssl_config* conf);
+void mbedtls_ssl_config_free(mbedtls_ssl_config* conf);
+int mbedtls_ssl_config_defaults(mbedtls_ssl_config* conf, int endpoint, int transport, int preset);
+void mbedtls_ssl_conf_rng(mbedtls_ssl_config* conf, int (*f_rng)(void*, unsigned char*, size_t), void* p_rng);
+int mbedtls_ssl_conf_own_cert(mbedtls_ssl_config* conf, mbedtls_x509_crt* own_cert, mbedtls_pk_context* pk_key);
+void mbedtls_ssl_conf_session_cache(mbedtls_ssl_config* conf, void* p_cache,
+                                    int (*f_get_cache)(void*, mbedtls_ssl_session*),
+                                    int (*f_set_cache)(void*, const mbedtls_ssl_session*));
+void mbedtls_ssl_conf_session_tickets_cb(mbedtls_ssl_config* conf,
+                                         int (*f_ticket_write)(void*, const mbedtls_ssl_session*, unsigned char*,
+                                                               const unsigned char*, size_t*, uint32_t*),
+                                         int (*f_ticket_parse)(void*, mbedtls_ssl_session*, unsigned char*, size_t),
+                                         void* p_ticket);
+
+// ---- Connection ----
+
+typedef struct mbedtls_ssl_context {
+    const mbedtls_ssl_config* conf;
+    void* ssl;               // SSL, on two memory BIOs
+    void* pending;           // std::string of records not yet sent
+    void* charge[3];         // ssl context, in record, out record
+    void* handshake;         // transient handshake state, until it completes
+    mbedtls_ssl_send_t* f_send;
+    mbedtls_ssl_recv_t* f_recv;
+    void* p_bio;
+    int state;               // 0 idle, 1 handshaking, 2 open, 3 closed
+} mbedtls_ssl_context;
+
+void mbedtls_ssl_init(mbedtls_ssl_context* ssl);
+void mbedtls_ssl_free(mbedtls_ssl_context* ssl);
+int mbedtls_ssl_setup(mbedtls_ssl_context* ssl, const mbedtls_ssl_config* conf);
+int mbedtls_ssl_session_reset(mbedtls_ssl_context* ssl);
+void mbedtls_ssl_set_bio(mbedtls_ssl_context* ssl, void* p_bio, mbedtls_ssl_send_t* f_send,
+                         mbedtls_ssl_recv_t* f_recv, mbedtls_ssl_recv_timeout_t* f_recv_timeout);
+int mbedtls_ssl_handshake(mbedtls_ssl_context* ssl);
+int mbedtls_ssl_read(mbedtls_ssl_context* ssl, unsigned char* buf, size_t len);
+int mbedtls_ssl_write(mbedtls_ssl_context* ssl, const unsigned char* buf, size_t len);
+int mbedtls_ssl_close_notify(mbedtls_ssl_context* ssl);
+const char* mbedtls_ssl_get_ciphersuite(const mbedtls_ssl_context* ssl);
+const char* mbedtls_ssl_get_version(const mbedtls_ssl_context* ssl);
+
+// ---- Session cache (mbedtls/ssl_cache.h) ----
+
+typedef struct mbedtls_ssl_cache_context {
+    void* entries;           // host-side list
+    int timeout;             // seconds, 0: none
+    int max_entries;
+} mbedtls_ssl_cache_context;
+
+void mbedtls_ssl_cache_init(mbedtls_ssl_cache_context* cache);
+void mbedtls_ssl_cache_free(mbedtls_ssl_cache_context* cache);
+void mbedtls_ssl_cache_set_timeout(mbedtls_ssl_cache_context* cache, int timeout);
+void mbedtls_ssl_cache_set_max_entries(mbedtls_ssl_cache_context* cache, int max);
+int mbedtls_ssl_cache_get(void* data, mbedtls_ssl_session* session);
+int mbedtls_ssl_cache_set(void* data, const mbedtls_ssl_session* session);
+
+// ---- Session tickets (mbedtls/ssl_ticket.h) ----
+
+typedef struct mbedtls_ssl_ticket_context {
+    uint32_t ticket_lifetime;
+    int ready;
+} mbedtls_ssl_ticket_context;
+
+void mbedtls_ssl_ticket_init(mbedtls_ssl_ticket_context* ctx);
+void mbedtls_ssl_ticket_free(mbedtls_ssl_ticket_context* ctx);
+int mbedtls_ssl_ticket_setup(mbedtls_ssl_ticket_context* ctx, int (*f_rng)(void*, unsigned char*, size_t),
+                             void* p_rng, mbedtls_cipher_type_t cipher, uint32_t lifetime);
+int mbedtls_ssl_ticket_write(void* p_ticket, const mbedtls_ssl_session* session, unsigned char* start,
+                             const unsigned char* end, size_t* tlen, uint32_t* lifetime);
+int mbedtls_ssl_ticket_parse(void* p_ticket, mbedtls_ssl_session* session, unsigned char* buf, size_t len);
+
+#endif // HOST_MBEDTLS_SSL_H
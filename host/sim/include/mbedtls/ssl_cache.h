@@ -0,0 +1,11 @@
+/**
+ * mbedtls/ssl_cache.h (host stub)
+ * Declared with the rest of the TLS stand-in in mbedtls/ssl.h.
+ */
+
+#ifndef HOST_MBEDTLS_SSL_CACHE_H
+#define HOST_MBEDTLS_SSL_CACHE_H
+
+#include "mbedtls/ssl.h"
+
+#endif // HOST_MBEDTLS_SSL_CACHE_H
@@ -0,0 +1,11 @@
+/**
+ * mbedtls/ssl_ticket.h (host stub)
+ * Declared with the rest of the TLS stand-in in mbedtls/ssl.h.
+ */
+
+#ifndef HOST_MBEDTLS_SSL_TICKET_H
+#define HOST_MBEDTLS_SSL_TICKET_H
+
+#include "mbedtls/ssl.h"
+
+#endif // HOST_MBEDTLS_SSL_TICKET_H
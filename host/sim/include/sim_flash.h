@@ -0,0 +1,120 @@
+/**
+ * sim_flash.h
+ * Page-level model of the flash chip under SPIFFS: where every page of every
+ * file lives, what each filesystem call programs, erases and reads, and what
+ * that costs in time and wear.
+ *
+ * The host directory keeps the file contents (fs.cpp); this model only
+ * shadows their layout the way SPIFFS would lay them out on the default
+ * 1.375 MB partition: 4 KB blocks (one erase sector) of 16 pages of 256 B,
+ * the first page of each block holding the object lookup table. Data pages
+ * carry 251 bytes, an object index header page (plus index pages past 102
+ * data pages) maps them. Pages are never rewritten: changing data programs a
+ * new page and marks the old one deleted, appends fill the tail of the last
+ * page in place, and every size change rewrites the index header. Once 3 or
+ * fewer blocks are completely free, garbage collection picks a block (most
+ * deleted pages, fewest live ones, oldest erase), moves its live pages and
+ * erases it. Finding a file by name scans the lookup pages from block 0 and
+ * reads every index header on the way, as spiffs_open() does.
+ *
+ * Each call charges its modelled flash time to the virtual clock (settle()),
+ * so handler timings in mercury_sim and the benches include it:
+ *
+ *   page read        25 us    (256 B at 40 MHz DIO plus command)
+ *   page program     60 us + 2.5 us per byte (700 us for a full page)
+ *   mark deleted     two 1-2 byte programs (lookup entry, page flags)
+ *   sector erase     45 ms    (typical of the 4 MB SPI NOR parts on ESP32
+ *                             modules; the worst case is ~10x)
+ *
+ * fs.cpp hands writes over the way newlib's 128 byte stdio buffer would.
+ * Left out: SPIFFS's page cache (a handle only remembers the data page it
+ * read last), erase suspend, and the worst-case timings of an aged chip.
+ *
+ * State lives in shared memory like the NVS image, so it follows the files
+ * across boots; mount() builds it from the directory at the start of a run.
+ */
+
+#ifndef HOST_SIM_FLASH_H
+#define HOST_SIM_FLASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace sim {
+
+struct FlashStats {
+    uint64_t pageReads;
+    uint64_t pagePrograms;     // whole or partial pages (data, index, GC moves)
+    uint64_t bytesProgrammed;
+    uint64_t pageDeletes;      // pages marked deleted
+    uint64_t erases;           // 4 KB sector erases
+    uint64_t gcRuns;
+    uint64_t gcMoves;          // live pages copied out of a block before its erase
+    uint64_t busyUs;           // modelled flash time, all calls
+    uint64_t maxCallUs;        // longest single filesystem call
+    uint32_t freePages;
+    uint32_t usedPages;
+    uint32_t deletedPages;
+    uint32_t minErases;        // per block
+    uint32_t maxErases;
+    double meanErases;
+};
+
+class Flash {
+public:
+    static constexpr size_t kBlocks = 352;        // 1.375 MB partition
+    static constexpr size_t kPagesPerBlock = 16;
+    static constexpr size_t kPageBytes = 256;
+    static constexpr size_t kPageData = 251;      // page header: object id, span index, flags
+
+    // ---- Driver side ----
+
+    // Forgets everything and lays out the given files (path, size) back to
+    // back on a freshly erased chip, free of charge. Call before runBoots().
+    void mount(const std::vector<std::pair<std::string, size_t>>& files);
+
+    FlashStats stats() const;
+    std::vector<uint32_t> wear() const;  // erase count per block
+
+    // Model consistent with itself and with the given file sizes; the first
+    // problem found goes to error.
+    bool check(const std::vector<std::pair<std::string, size_t>>& files, std::string& error) const;
+
+    // ---- Filesystem side (fs.cpp) ----
+
+    bool has(const char* path) const;
+    void adopt(const char* path, size_t size);   // file that appeared behind the model's back
+
+    void scanLookup();                            // SPIFFS mount / readdir: every lookup page
+    bool find(const char* path);                  // spiffs_open() by name
+    bool create(const char* path);                // new file, or truncate an existing one
+    bool write(const char* path, size_t pos, size_t len);
+    void read(const char* path, size_t pos, size_t len, long& lastSpan);
+    void remove(const char* path);
+    void rename(const char* from, const char* to);
+    void format();
+
+    // Charges the time of the calls since the last settle() to the virtual
+    // clock. Separate from the calls so the model is consistent before the
+    // clock moves (a scripted reset can end the boot right there).
+    void settle();
+
+    struct State;  // in flash.cpp
+
+private:
+    State* state() const;
+    mutable State* _s = nullptr;
+};
+
+Flash& flash();
+
+// Files in the SPIFFS directory with their sizes, for Flash::check()
+std::vector<std::pair<std::string, size_t>> fsFiles();
+
+} // namespace sim
+
+#endif // HOST_SIM_FLASH_H
@@ -0,0 +1,210 @@
+/**
+ * sim_host.h
+ * Control surface of the host simulator: virtual clock, simulated device
+ * heap, and the knobs the stand-ins for WiFi / HTTP / FS expose to drivers.
+ * Firmware code never includes this; only the simulator drivers do.
+ */
+
+#ifndef HOST_SIM_HOST_H
+#define HOST_SIM_HOST_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#include <functional>
+#include <string>
+
+namespace sim {
+
+// ---- Virtual clock ----
+
+uint64_t nowUs();
+void advanceUs(uint64_t us);
+inline void advanceMs(uint64_t ms) { advanceUs(ms * 1000ULL); }
+
+// Time since the current boot started (what millis()/esp_timer report).
+uint64_t uptimeUs();
+
+// Virtual UTC wall clock (what NTP would return right now).
+time_t wallTime();
+
+// When set, delay() sleeps for real as well (interactive use with curl).
+void setRealtime(bool realtime);
+bool realtime();
+
+// Moves the clock forward by time already spent waiting on a real socket
+// (never sleeps, even in realtime mode).
+void creditRealWaitUs(uint64_t us);
+
+// Virtual time at which the firmware last entered delay(). Drivers use it to
+// split a loop() iteration into work and the trailing idle delay.
+uint64_t lastDelayAtUs();
+
+// ---- Simulated device heap ----
+
+struct HeapStats {
+    size_t total;
+    size_t free;
+    size_t largestFree;
+    size_t minFree;
+    uint64_t allocCount;       // successful firmware allocations
+    uint64_t stackAllocCount;  // allocations made by the modelled Wi-Fi / TLS stacks
+    uint64_t failCount;
+};
+
+void* heapAlloc(size_t size);
+void* heapRealloc(void* ptr, size_t size);
+void heapFree(void* ptr);
+bool heapOwns(const void* ptr);
+HeapStats heapStats();  // internal RAM
+
+// PSRAM: none unless set before the first boot (at most 4 MB).
+void setPsramBytes(size_t bytes);
+HeapStats psramStats();
+// heap_caps_malloc_extmem_enable(): malloc of limit bytes or more tries PSRAM first
+void setExtmemLimit(size_t limit);
+// heap_caps_malloc() for one pool
+void* heapAllocCaps(size_t size, bool psram);
+
+// Allocations inside a HostScope belong to the simulator itself and bypass
+// the device heap (containers holding scripts, FS contents, sockets...).
+class HostScope {
+public:
+    HostScope();
+    ~HostScope();
+    HostScope(const HostScope&) = delete;
+    HostScope& operator=(const HostScope&) = delete;
+};
+
+// Allocations inside a StackScope are charged to the device heap but counted
+// separately: they stand for what the Wi-Fi driver and mbedTLS allocate, which
+// the firmware cannot avoid (scan result arrays, TLS record buffers).
+class StackScope {
+public:
+    StackScope();
+    ~StackScope();
+    StackScope(const StackScope&) = delete;
+    StackScope& operator=(const StackScope&) = delete;
+};
+
+// Only code running between enterDevice()/leaveDevice() is charged to the
+// simulated heap; static initialisation and driver code use the host heap.
+void enterDevice();
+void leaveDevice();
+bool inDevice();
+
+// ---- Tasks ----
+//
+// The sketch runs as "loopTask" on core 1. Wi-Fi event callbacks run inside
+// an EventTaskScope, as "sys_evt" on core 0, which is what
+// xTaskGetCurrentTaskHandle() and xPortGetCoreID() report meanwhile.
+
+class EventTaskScope {
+public:
+    EventTaskScope();
+    ~EventTaskScope();
+    EventTaskScope(const EventTaskScope&) = delete;
+    EventTaskScope& operator=(const EventTaskScope&) = delete;
+private:
+    bool _outer;
+};
+
+// ---- Serial ----
+
+void setSerialEcho(bool echo);  // print firmware Serial output to stdout
+const std::string& serialLog(); // everything printed since clearSerialLog()
+void clearSerialLog();
+
+// ---- Flash filesystem ----
+//
+// SPIFFS is backed by a host directory; files persist across boots. The
+// page-level flash model under it (cost and wear) is in sim_flash.h.
+
+void setFsRoot(const std::string& dir);
+const std::string& fsRoot();
+
+// ---- NVS ----
+//
+// The nvs_* / Preferences stand-ins keep one serialized image in the shared
+// mapping: entries survive restarts, crashes and deep sleep for the rest of
+// the run, and every run starts with an empty NVS.
+
+struct NvsImage {
+    uint8_t* data;
+    uint32_t* length;
+    size_t capacity;
+};
+NvsImage nvsImage();
+
+// ---- Host ports ----
+//
+// Device TCP servers listen on 127.0.0.1 at (device port + offset), e.g. the
+// web UI on port 80 becomes 8080 with offset 8000. Negative = no listening.
+
+void setPortOffset(int offset);
+uint16_t hostPortFor(uint16_t devicePort);  // 0 when listening is disabled
+// Device servers listening right now (WebServer, WiFiServer): a loopback
+// connect from the firmware to one of these ports reaches that server at its
+// host port instead of a host service.
+void addDeviceListener(uint16_t devicePort);
+void removeDeviceListener(uint16_t devicePort);
+bool deviceListening(uint16_t devicePort);
+
+// ---- Boots ----
+//
+// Each simulated boot runs in a forked child so the firmware's globals start
+// from scratch, exactly as after a reset. The virtual clock, RTC memory
+// (RTC_DATA_ATTR variables) and counters shared with the driver live in a
+// shared mapping that survives the fork.
+
+enum class BootEnd : int {
+    Finished = 10,   // driver stopped the boot (time budget reached)
+    Restart = 11,    // ESP.restart() / esp_restart()
+    DeepSleep = 12,  // esp_deep_sleep_start()
+    Crashed = 13,    // uncaught exception / abort
+    Reset = 14,      // scripted reset (addReset)
+};
+
+// Thrown out of firmware code to end the current boot.
+struct BootEnded {
+    BootEnd reason;
+};
+
+[[noreturn]] void endBoot(BootEnd reason);
+
+int resetReason();           // esp_reset_reason_t of the current boot
+int wakeupCause();           // esp_sleep_wakeup_cause_t of the current boot
+void setWakeupCause(int cause);
+uint64_t sleepRequestUs();   // timer requested by the last deep sleep
+void setSleepRequestUs(uint64_t us);
+uint32_t bootCount();        // boots so far in this run, starting at 1
+
+// Scripted resets (scenario "reset" lines): once the clock reaches atUs the
+// running boot ends as if the chip had reset with `reason`
+// (esp_reset_reason_t); a deep sleep spanning atUs ends there too. Brownout
+// and power-on resets lose RTC memory, the others keep it. Add them before
+// runBoots().
+void addReset(uint64_t atUs, int reason);
+
+// Shared 64-bit counters the driver can read after every boot
+// (webhook requests, 429s, ...). Index constants live with their owners.
+uint64_t& counter(int index);
+constexpr int kMaxCounters = 32;
+
+struct Firmware {
+    std::function<void()> setup;
+    std::function<void()> loop;
+    // Called in the child after every loop(); return false to end the boot.
+    std::function<bool()> afterLoop;
+    // Called in the driver after every boot.
+    std::function<void(BootEnd)> onBootEnd;
+};
+
+// Boots the firmware repeatedly (restarts, deep-sleep wakes) until the
+// virtual clock reaches untilUs. Returns the number of crashed boots.
+int runBoots(const Firmware& fw, uint64_t untilUs);
+
+} // namespace sim
+
+#endif // HOST_SIM_HOST_H
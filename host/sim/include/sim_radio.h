@@ -0,0 +1,156 @@
+/**
+ * sim_radio.h
+ * Scriptable fake radio behind WiFi.h: access points with RSSI traces and
+ * per-phase join latencies, scheduled link drops, reachable hosts for TCP
+ * probes, and button presses (for wake-on-button).
+ */
+
+#ifndef HOST_SIM_RADIO_H
+#define HOST_SIM_RADIO_H
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "WiFi.h"
+
+namespace sim {
+
+struct SimAp {
+    std::string ssid;
+    std::string pass;  // empty = open network
+    uint8_t bssid[6];
+    int channel;
+    int rssi;
+    wifi_auth_mode_t auth;
+    std::vector<std::pair<uint64_t, int>> trace;  // (virtual us, dBm) breakpoints
+    uint32_t authMs = 8;
+    uint32_t assocMs = 12;
+    uint32_t handshakeMs = 45;
+    uint32_t dhcpMs = 900;
+};
+
+struct SimHost {
+    uint32_t ip;
+    std::vector<uint16_t> openPorts;
+    uint32_t latencyMs = 5;
+};
+
+struct LinkDrop {
+    uint64_t atUs;
+    uint64_t downUs;  // how long the AP stays invisible
+    int reason;
+};
+
+struct ButtonPress {
+    uint64_t atUs;
+    int pin;
+};
+
+struct NetConfig {
+    IPAddress ip = IPAddress(192, 168, 1, 123);
+    IPAddress gateway = IPAddress(192, 168, 1, 1);
+    IPAddress mask = IPAddress(255, 255, 255, 0);
+    IPAddress dns0 = IPAddress(192, 168, 1, 1);
+    IPAddress dns1 = IPAddress(8, 8, 8, 8);
+};
+
+class Radio {
+public:
+    Radio();
+
+    // ---- Scripting (driver side, see sim_scenario.h) ----
+    void setBaseMac(const uint8_t mac[6]);
+    void addAp(const SimAp& ap) { _aps.push_back(ap); }
+    SimAp* findAp(const uint8_t bssid[6]);
+    void addHost(const SimHost& host) { _hosts.push_back(host); }
+    void addDrop(const LinkDrop& drop);  // kept sorted by time
+    void addButtonPress(const ButtonPress& press) { _presses.push_back(press); }
+    NetConfig& net() { return _net; }
+    const std::vector<SimAp>& aps() const { return _aps; }
+
+    // ---- Device side ----
+    void poll();  // advance the connection state machine to the current virtual time
+    const uint8_t* baseMac() const { return _baseMac; }
+    int pinLevel(int pin) const;
+    void armButtonWake(int pin, int level);
+    uint64_t nextButtonPressUs(uint64_t fromUs, uint64_t toUs) const;
+
+    void begin(const char* ssid, const char* pass, int32_t channel, const uint8_t* bssid);
+    void disconnect();
+    void setStaticConfig(bool enabled) { _staticIp = enabled; }
+    void setAutoReconnect(bool enabled) { _autoReconnect = enabled; }
+    bool autoReconnect() const { return _autoReconnect; }
+    wl_status_t status();
+    const SimAp* currentAp() const { return _connected ? &_aps[_apIndex] : nullptr; }
+    uint32_t linkUps() const { return _linkUps; }  // GOT_IP count in this boot
+    int rssiNow(const SimAp& ap) const;
+    std::vector<const SimAp*> visibleAps(int channel = 0) const;
+    bool connectHost(uint32_t ip, uint16_t port, uint32_t timeoutMs, bool& known);
+
+    // Modem sleep: the station only listens at DTIM beacons (WIFI_PS_MIN_MODEM)
+    // or every listenInterval beacons (MAX_MODEM), so a packet for the device
+    // waits for the next one. 0 with power save off or in AP mode.
+    uint64_t rxWakeDelayUs() const;
+    // Let the clock run until the radio listens (an incoming connection)
+    void waitForRx();
+
+    wifi_event_id_t addListener(WiFiEventFuncCb cb, arduino_event_id_t event);
+    void removeListener(wifi_event_id_t id);
+
+    wifi_mode_t mode = WIFI_MODE_NULL;
+    bool sleepEnabled = true;
+    wifi_ps_type_t psType = WIFI_PS_MIN_MODEM;
+    uint8_t dtimPeriod = 1;      // beacons (102.4 ms) per DTIM, from the AP
+    uint8_t listenInterval = 3;  // beacons between listens with MAX_MODEM
+    std::string hostname;
+    std::string ssid;
+    std::string pass;
+    bool softApActive = false;
+    std::string softApSsid;
+
+private:
+    enum class Phase { Idle, Scan, Auth, Assoc, Handshake, Dhcp, Connected, Failed };
+
+    void enterPhase(Phase phase, uint64_t durationUs);
+    void fail(int reason, wl_status_t status);
+    void emit(arduino_event_id_t id, const arduino_event_info_t& info);
+    bool apDown(size_t index, uint64_t atUs) const;
+
+    struct Listener {
+        wifi_event_id_t id;
+        WiFiEventFuncCb cb;
+        arduino_event_id_t event;
+    };
+
+    uint8_t _baseMac[6];
+    NetConfig _net;
+    std::vector<SimAp> _aps;
+    std::vector<SimHost> _hosts;
+    std::vector<LinkDrop> _drops;
+    std::vector<ButtonPress> _presses;
+    std::vector<Listener> _listeners;
+    wifi_event_id_t _nextListenerId = 1;
+    int _wakePin = -1;
+
+    Phase _phase = Phase::Idle;
+    uint64_t _phaseEndUs = 0;
+    size_t _apIndex = 0;
+    bool _connected = false;
+    uint32_t _linkUps = 0;
+    bool _staticIp = false;
+    bool _autoReconnect = true;
+    bool _hintedChannel = false;
+    bool _wrongPass = false;
+    uint64_t _reconnectAtUs = 0;
+    size_t _nextDrop = 0;
+    wl_status_t _status = WL_IDLE_STATUS;
+    bool _polling = false;
+};
+
+Radio& radio();
+
+} // namespace sim
+
+#endif // HOST_SIM_RADIO_H
@@ -0,0 +1,53 @@
+/**
+ * sim_scenario.h
+ * Scenario files for the host simulator: one directive per line, '#' starts
+ * a comment. Times are virtual and accept ms/s/m/h/d suffixes, also combined
+ * ("90s", "2h10m", "7d").
+ *
+ *   duration 7d                                  default run length
+ *   mac 24:6F:28:5A:1C:30                        base MAC of the device
+ *   psram 4M                                     module with PSRAM (WROVER); none by default
+ *   dtim 3                                       DTIM period of the APs in beacons (1 by default);
+ *                                                with modem sleep a request waits for the next one
+ *   net IP GATEWAY MASK DNS0 [DNS1]              lease handed out by DHCP
+ *   ap SSID PASS|- BSSID CHANNEL RSSI [auth=WPA2_PSK] [auth_ms=] [assoc_ms=]
+ *      [handshake_ms=] [dhcp_ms=]                an access point
+ *   rssi BSSID AT DBM                            RSSI trace breakpoint (linear in between)
+ *   drop AT DOWN [REASON]                        link loss; APs invisible for DOWN
+ *   host IP [open=80,443] [latency=5]            probe target on the simulated network
+ *   button AT [PIN]                              button press (GPIO0 by default)
+ *   reset AT REASON                              chip reset: poweron, ext, panic, int_wdt,
+ *                                                task_wdt, wdt or brownout
+ *   webhook FROM TO [status=429] [latency=15000] webhook misbehaves in [FROM, TO)
+ *   webhook_latency MS                           default server time per request
+ *   webhook_rtt MS                               network round trip to the webhook
+ *   ratelimit COUNT PERIOD                       webhook rate limit bucket (0 = off)
+ *   file PATH CONTENT...                         SPIFFS file present before the first boot
+ */
+
+#ifndef HOST_SIM_SCENARIO_H
+#define HOST_SIM_SCENARIO_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+namespace sim {
+
+struct ScenarioInfo {
+    uint64_t durationUs = 0;  // 0 = not set by the scenario
+};
+
+// Parses "90", "90s", "250ms", "15m", "2h", "1d4h", "7d" into microseconds.
+bool parseDuration(const std::string& text, uint64_t& us);
+
+// Parses "4096", "64K", "4M" into bytes.
+bool parseSize(const std::string& text, size_t& bytes);
+
+bool loadScenario(const char* path, ScenarioInfo& info, std::string& error);
+bool parseScenarioLine(const std::string& line, ScenarioInfo& info, std::string& error);
+
+} // namespace sim
+
+#endif // HOST_SIM_SCENARIO_H
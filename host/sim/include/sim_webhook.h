@@ -0,0 +1,88 @@
+/**
+ * sim_webhook.h
+ * Stand-in for the Discord webhook (and any other HTTPS endpoint the
+ * firmware talks to through WiFiClientSecure).
+ *
+ * By default requests are answered in-process: POST ?wait=true returns a
+ * message object with a fresh id, PATCH /messages/<id> edits it, bodies over
+ * Discord's 2000 character limit get a 400, and a per-webhook rate limit
+ * bucket answers 429 with retry_after. Scenario windows add slowness or
+ * force a status for a stretch of virtual time. Unlike Discord, the model
+ * accepts chunked, "Content-Encoding: gzip" bodies, standing in for an
+ * endpoint that does.
+ *
+ * setStandIn() routes the same traffic over a real socket to a local HTTP
+ * server instead (host/sim/fake_webhook.py). TLS is modelled either way.
+ */
+
+#ifndef HOST_SIM_WEBHOOK_H
+#define HOST_SIM_WEBHOOK_H
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+namespace sim {
+
+struct WebhookWindow {
+    uint64_t fromUs;
+    uint64_t toUs;
+    int status;          // forced response status, 0 = answer normally
+    uint32_t latencyMs;  // server time per request, 0 = default
+};
+
+// Indices into sim::counter(), maintained by the TLS client model.
+enum WebhookCounter {
+    kCounterRequests = 0,   // complete HTTPS requests sent
+    kCounterOk,             // 2xx responses
+    kCounterRateLimited,    // 429 responses
+    kCounterFailed,         // other statuses
+    kCounterLastStatus,     // status of the latest response
+    kCounterBytesOut,       // request bytes (headers + body)
+    kCounterTlsHandshakes,
+    kCounterTlsFailures,    // handshakes that could not get their buffers
+    kCounterGzipRequests,   // requests with a gzip body (answered in-process)
+    kCounterGzipBodyBytes,  // their bodies, inflated
+    kCounterGzipWireBytes,  // their bodies as sent
+};
+
+class Webhook {
+public:
+    // ---- Scripting ----
+    void addWindow(const WebhookWindow& w) { _windows.push_back(w); }
+    void setLatencyMs(uint32_t ms) { _latencyMs = ms; }
+    void setRttMs(uint32_t ms) { _rttMs = ms; }
+    void setRateLimit(uint32_t requests, uint64_t periodUs);
+    bool setStandIn(const std::string& url, std::string& error);
+
+    // ---- Transport side ----
+    uint32_t rttMs() const { return _rttMs; }
+    bool hasStandIn() const { return _standInPort != 0; }
+    uint32_t standInIp() const { return _standInIp; }
+    uint16_t standInPort() const { return _standInPort; }
+
+    // Answers one complete HTTP/1.1 request. Returns the raw response and
+    // the server-side time it takes.
+    std::string respond(const std::string& request, uint32_t& latencyMs);
+
+private:
+    const WebhookWindow* activeWindow() const;
+    bool takeToken(double& retryAfterSec);
+
+    std::vector<WebhookWindow> _windows;
+    uint32_t _latencyMs = 180;
+    uint32_t _rttMs = 25;
+    uint32_t _bucketSize = 5;            // Discord: 5 requests per 2 s per webhook
+    uint64_t _bucketPeriodUs = 2000000;
+    std::vector<uint64_t> _recent;       // request times inside the current period
+    uint64_t _nextId = 0;                // next snowflake within the current millisecond
+    uint32_t _standInIp = 0;
+    uint16_t _standInPort = 0;
+};
+
+Webhook& webhook();
+
+} // namespace sim
+
+#endif // HOST_SIM_WEBHOOK_H
@@ -0,0 +1,404 @@
+/**
+ * main.cpp (host simulator)
+ * mercury_sim: runs the sketch against a scenario on the virtual clock and
+ * reports what every status report cost (time, heap allocations, largest
+ * free block) plus the webhook traffic it produced.
+ *
+ *   mercury_sim [options] SCENARIO
+ *     --duration T     run length (overrides the scenario, e.g. 6h, 7d)
+ *     --fs DIR         SPIFFS directory (default: fresh temp dir, removed)
+ *     --mac MAC        base MAC (overrides the scenario; one per instance when
+ *                      several run side by side, see WiFiUdp.h)
+ *     --http PORT      serve the web UI on 127.0.0.1:PORT
+ *     --realtime       delay() sleeps for real (implies --http 8080)
+ *     --webhook URL    send webhook traffic to a local stand-in server
+ *     --quiet          do not echo the firmware's Serial output
+ *     --csv FILE       write one line per report
+ *     --bench          print the per-report benchmark table
+ *     --soak           check for leaks / fragmentation, exit 1 on failure
+ */
+
+#include "sim_flash.h"
+#include "sim_host.h"
+#include "sim_radio.h"
+#include "sim_scenario.h"
+#include "sim_webhook.h"
+#include "WiFi.h"
+
+#include <ftw.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Sketch entry points and the report timestamp it keeps (firmware.cpp).
+void setup();
+void loop();
+extern unsigned long lastPost;
+
+namespace {
+
+constexpr uint64_t kDefaultDurationUs = 3600ULL * 1000000ULL;
+constexpr uint64_t kDayUs = 86400ULL * 1000000ULL;
+constexpr size_t kMaxSamples = 200000;
+constexpr size_t kFreeDriftBytes = 512;      // soak: allowed loss of free heap
+constexpr size_t kLargestDriftBytes = 1024;  // soak: allowed shrink of the largest block
+
+// One status report, written by the boot process into shared memory.
+struct Sample {
+    uint64_t atUs;
+    uint32_t cycleUs;       // start of the iteration to its idle delay (or sleep)
+    uint32_t allocs;        // firmware heap allocations during the cycle
+    uint32_t stackAllocs;   // Wi-Fi / TLS stack allocations during the cycle
+    uint32_t freeHeap;
+    uint32_t largestFree;
+    uint32_t heapFails;     // failed allocations so far in this boot
+    uint32_t boot;
+    uint16_t status;        // last webhook status
+    uint8_t fromSetup;      // report made during setup() (first boot, deep-sleep wake)
+    uint8_t reconnect;      // the link came up since the previous report (report follows a reconnect)
+    uint8_t indexInBoot;
+};
+
+struct SampleLog {
+    size_t count;
+    Sample samples[kMaxSamples];
+};
+
+SampleLog* gLog = nullptr;
+
+// Cycle bookkeeping inside the boot process.
+struct Cycle {
+    uint64_t startUs;
+    uint64_t allocs;
+    uint64_t stackAllocs;
+    unsigned long lastPost;
+    bool linkUp;
+    uint32_t linkUps;
+};
+Cycle gCycle;
+uint8_t gReportsThisBoot = 0;
+uint32_t gLinkUpsAtReport = 0;
+
+void beginCycle() {
+    sim::HeapStats h = sim::heapStats();
+    gCycle = {sim::nowUs(), h.allocCount, h.stackAllocCount, lastPost, WiFi.status() == WL_CONNECTED,
+              sim::radio().linkUps()};
+}
+
+void endCycle(bool fromSetup, bool interrupted) {
+    if (lastPost == gCycle.lastPost) return;
+    const uint64_t lastDelay = sim::lastDelayAtUs();
+    const uint64_t endUs = !interrupted && lastDelay >= gCycle.startUs ? lastDelay : sim::nowUs();
+    sim::HeapStats h = sim::heapStats();
+    if (gLog->count >= kMaxSamples) return;
+    Sample& s = gLog->samples[gLog->count++];
+    s.atUs = gCycle.startUs;
+    s.cycleUs = static_cast<uint32_t>(endUs - gCycle.startUs);
+    s.allocs = static_cast<uint32_t>(h.allocCount - gCycle.allocs);
+    s.stackAllocs = static_cast<uint32_t>(h.stackAllocCount - gCycle.stackAllocs);
+    s.freeHeap = static_cast<uint32_t>(h.free);
+    s.largestFree = static_cast<uint32_t>(h.largestFree);
+    s.heapFails = static_cast<uint32_t>(h.failCount);
+    s.boot = sim::bootCount();
+    s.status = static_cast<uint16_t>(sim::counter(sim::kCounterLastStatus));
+    s.fromSetup = fromSetup;
+    // The firmware may notice the link is back one iteration before it reports
+    // (portal retry), so compare with the link-up count at the last report.
+    s.reconnect = !fromSetup && (!gCycle.linkUp || gCycle.linkUps != gLinkUpsAtReport);
+    gLinkUpsAtReport = sim::radio().linkUps();
+    s.indexInBoot = gReportsThisBoot < 255 ? gReportsThisBoot++ : 255;
+}
+
+template <typename Fn>
+void measured(bool fromSetup, Fn fn) {
+    beginCycle();
+    try {
+        fn();
+    } catch (const sim::BootEnded&) {
+        endCycle(fromSetup, true);
+        throw;
+    }
+    endCycle(fromSetup, false);
+}
+
+// ---- Reporting ----
+
+template <typename T>
+T percentile(std::vector<T> v, double p) {
+    if (v.empty()) return T();
+    std::sort(v.begin(), v.end());
+    size_t i = static_cast<size_t>(p * (v.size() - 1) + 0.5);
+    return v[std::min(i, v.size() - 1)];
+}
+
+void printCycleRow(const char* label, const std::vector<const Sample*>& set) {
+    if (set.empty()) {
+        printf("  %-22s      -\n", label);
+        return;
+    }
+    std::vector<uint32_t> ms, allocs, stack;
+    for (const Sample* s : set) {
+        ms.push_back(s->cycleUs / 1000);
+        allocs.push_back(s->allocs);
+        stack.push_back(s->stackAllocs);
+    }
+    printf("  %-22s %6zu  %7u %7u %7u %7u   %5u %5u %5u   %5u\n", label, set.size(), percentile(ms, 0.0),
+           percentile(ms, 0.5), percentile(ms, 0.95), percentile(ms, 1.0), percentile(allocs, 0.0),
+           percentile(allocs, 0.5), percentile(allocs, 1.0), percentile(stack, 0.5));
+}
+
+void printBench(const std::vector<const Sample*>& all) {
+    std::vector<const Sample*> first, steady, boot, reconnect;
+    for (const Sample* s : all) {
+        if (s->fromSetup) boot.push_back(s);
+        else if (s->reconnect) reconnect.push_back(s);
+        else if (s->indexInBoot < 2) first.push_back(s);
+        else steady.push_back(s);
+    }
+    printf("\nPer-report cost                 n   cycle ms: min     p50     p95     max   allocs: min   p50   max   stack\n");
+    printCycleRow("first reports of boot", first);
+    printCycleRow("steady state", steady);
+    printCycleRow("after reconnect", reconnect);
+    printCycleRow("during setup()", boot);
+}
+
+void printDaily(const std::vector<const Sample*>& all) {
+    printf("\nDay  reports   2xx   429  other   cycle p95 ms  min free  min largest\n");
+    for (uint64_t day = 0; day * kDayUs <= (all.empty() ? 0 : all.back()->atUs); ++day) {
+        std::vector<uint32_t> ms;
+        unsigned ok = 0, limited = 0, other = 0;
+        uint32_t minFree = UINT32_MAX, minLargest = UINT32_MAX;
+        for (const Sample* s : all) {
+            if (s->atUs / kDayUs != day) continue;
+            ms.push_back(s->cycleUs / 1000);
+            if (s->status >= 200 && s->status < 300) ok++;
+            else if (s->status == 429) limited++;
+            else other++;
+            minFree = std::min(minFree, s->freeHeap);
+            minLargest = std::min(minLargest, s->largestFree);
+        }
+        if (ms.empty()) continue;
+        printf("%3u  %7zu %5u %5u %6u   %12u  %8u  %11u\n", static_cast<unsigned>(day + 1), ms.size(), ok, limited,
+               other, percentile(ms, 0.95), minFree, minLargest);
+    }
+}
+
+// Leak and fragmentation checks over the reports of each boot: after the
+// first two reports (lazy buffers, first TLS session) nothing may keep
+// growing, and reports that did not have to reconnect first must not
+// allocate at all. Returns the number of failed checks.
+int soakChecks(const std::vector<const Sample*>& all, int crashes) {
+    int failures = 0;
+    auto fail = [&](const char* what, unsigned long long value) {
+        printf("  FAIL %s: %llu\n", what, value);
+        failures++;
+    };
+    printf("\nSoak checks\n");
+    if (crashes) fail("crashed boots", crashes);
+    if (sim::counter(sim::kCounterTlsFailures)) fail("TLS sessions without memory", sim::counter(sim::kCounterTlsFailures));
+    if (all.empty()) fail("reports", 0);
+
+    for (size_t i = 0; i < all.size(); ++i) {
+        const Sample* s = all[i];
+        if (s->heapFails) {
+            fail("failed heap allocations in boot", s->boot);
+            break;
+        }
+    }
+    // Drift: compare the second report of each boot with its last one.
+    size_t begin = 0;
+    while (begin < all.size()) {
+        size_t end = begin;
+        while (end < all.size() && all[end]->boot == all[begin]->boot) end++;
+        if (end - begin >= 3) {
+            const Sample* ref = all[begin + 1];
+            const Sample* last = all[end - 1];
+            if (last->freeHeap + kFreeDriftBytes < ref->freeHeap) fail("free heap lost (bytes)", ref->freeHeap - last->freeHeap);
+            if (last->largestFree + kLargestDriftBytes < ref->largestFree) {
+                fail("largest free block shrank (bytes)", ref->largestFree - last->largestFree);
+            }
+            for (size_t i = begin + 2; i < end; ++i) {
+                if (all[i]->allocs && !all[i]->reconnect) {
+                    fail("steady-state report allocated (report index)", i);
+                    break;
+                }
+            }
+        }
+        begin = end;
+    }
+    if (!failures) printf("  ok\n");
+    return failures;
+}
+
+void writeCsv(const char* path, const std::vector<const Sample*>& all) {
+    FILE* f = fopen(path, "w");
+    if (!f) {
+        perror(path);
+        return;
+    }
+    fprintf(f, "at_s,boot,from_setup,reconnect,cycle_ms,allocs,stack_allocs,free,largest_free,heap_fails,status\n");
+    for (const Sample* s : all) {
+        fprintf(f, "%.3f,%u,%u,%u,%.3f,%u,%u,%u,%u,%u,%u\n", s->atUs / 1e6, s->boot, s->fromSetup, s->reconnect,
+                s->cycleUs / 1e3,
+                s->allocs, s->stackAllocs, s->freeHeap, s->largestFree, s->heapFails, s->status);
+    }
+    fclose(f);
+}
+
+int removeEntry(const char* path, const struct stat*, int, struct FTW*) { return ::remove(path); }
+
+void usage() {
+    fprintf(stderr,
+            "usage: mercury_sim [--duration T] [--fs DIR] [--mac MAC] [--http PORT] [--realtime] [--webhook URL]\n"
+            "                   [--quiet] [--csv FILE] [--bench] [--soak] SCENARIO\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const char* scenario = nullptr;
+    const char* csv = nullptr;
+    std::string fsDir;
+    std::string webhookUrl;
+    std::string mac;
+    uint64_t durationUs = 0;
+    int httpPort = 0;
+    bool realtime = false, quiet = false, bench = false, soak = false;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (a == "--duration" && hasValue) {
+            if (!sim::parseDuration(argv[++i], durationUs)) {
+                fprintf(stderr, "bad duration: %s\n", argv[i]);
+                return 2;
+            }
+        } else if (a == "--fs" && hasValue) {
+            fsDir = argv[++i];
+        } else if (a == "--mac" && hasValue) {
+            mac = argv[++i];
+        } else if (a == "--http" && hasValue) {
+            httpPort = atoi(argv[++i]);
+        } else if (a == "--webhook" && hasValue) {
+            webhookUrl = argv[++i];
+        } else if (a == "--csv" && hasValue) {
+            csv = argv[++i];
+        } else if (a == "--realtime") {
+            realtime = true;
+        } else if (a == "--quiet") {
+            quiet = true;
+        } else if (a == "--bench") {
+            bench = true;
+        } else if (a == "--soak") {
+            soak = true;
+        } else if (a[0] != '-' && !scenario) {
+            scenario = argv[i];
+        } else {
+            usage();
+            return 2;
+        }
+    }
+    if (!scenario) {
+        usage();
+        return 2;
+    }
+
+    bool tempFs = fsDir.empty();
+    if (tempFs) {
+        char tmpl[] = "/tmp/mercury_sim.XXXXXX";
+        if (!mkdtemp(tmpl)) {
+            perror("mkdtemp");
+            return 1;
+        }
+        fsDir = tmpl;
+    }
+    sim::setFsRoot(fsDir);
+
+    sim::ScenarioInfo info;
+    std::string error;
+    if (!sim::loadScenario(scenario, info, error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 2;
+    }
+    if (!mac.empty() && !sim::parseScenarioLine("mac " + mac, info, error)) {
+        fprintf(stderr, "--mac: %s\n", error.c_str());
+        return 2;
+    }
+    if (!webhookUrl.empty() && !sim::webhook().setStandIn(webhookUrl, error)) {
+        fprintf(stderr, "--webhook: %s\n", error.c_str());
+        return 2;
+    }
+    if (!durationUs) durationUs = info.durationUs ? info.durationUs : kDefaultDurationUs;
+    if (realtime && !httpPort) httpPort = 8080;
+    if (httpPort) sim::setPortOffset(httpPort - 80);
+    sim::setRealtime(realtime);
+    sim::setSerialEcho(!quiet);
+
+    void* mem = mmap(nullptr, sizeof(SampleLog), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+    gLog = static_cast<SampleLog*>(mem);
+    gLog->count = 0;
+
+    if (httpPort) printf("[sim] web UI on http://127.0.0.1:%d/\n", httpPort);
+
+    unsigned boots[4] = {0, 0, 0, 0};
+    sim::Firmware fw;
+    fw.setup = [] { measured(true, setup); };
+    fw.loop = [] { measured(false, loop); };
+    fw.onBootEnd = [&](sim::BootEnd reason) { boots[static_cast<int>(reason) - static_cast<int>(sim::BootEnd::Finished)]++; };
+    int crashes = sim::runBoots(fw, durationUs);
+
+    std::vector<const Sample*> all;
+    for (size_t i = 0; i < gLog->count; ++i) all.push_back(&gLog->samples[i]);
+
+    printf("\n==== mercury_sim: %s, %.1f h virtual ====\n", scenario, sim::nowUs() / 3.6e9);
+    printf("Boots: %u (restarts %u, deep-sleep wakes %u, crashes %d)\n", sim::bootCount(), boots[1], boots[2], crashes);
+    printf("Reports: %zu\n", all.size());
+    printf("Webhook requests: %llu (2xx %llu, 429 %llu, other %llu), %llu bytes out\n",
+           static_cast<unsigned long long>(sim::counter(sim::kCounterRequests)),
+           static_cast<unsigned long long>(sim::counter(sim::kCounterOk)),
+           static_cast<unsigned long long>(sim::counter(sim::kCounterRateLimited)),
+           static_cast<unsigned long long>(sim::counter(sim::kCounterFailed)),
+           static_cast<unsigned long long>(sim::counter(sim::kCounterBytesOut)));
+    if (uint64_t gz = sim::counter(sim::kCounterGzipRequests)) {
+        uint64_t raw = sim::counter(sim::kCounterGzipBodyBytes);
+        uint64_t wire = sim::counter(sim::kCounterGzipWireBytes);
+        printf("gzip bodies: %llu, %llu -> %llu bytes (%.0f%%)\n", static_cast<unsigned long long>(gz),
+               static_cast<unsigned long long>(raw), static_cast<unsigned long long>(wire),
+               raw ? 100.0 * wire / raw : 0.0);
+    }
+    printf("TLS handshakes: %llu (out of memory: %llu)\n",
+           static_cast<unsigned long long>(sim::counter(sim::kCounterTlsHandshakes)),
+           static_cast<unsigned long long>(sim::counter(sim::kCounterTlsFailures)));
+    const sim::FlashStats flash = sim::flash().stats();
+    printf("Flash: %llu page programs (%llu KB), %llu erases (%llu GC), %.1f s busy, longest call %.1f ms, "
+           "erases per block %u..%u\n",
+           static_cast<unsigned long long>(flash.pagePrograms),
+           static_cast<unsigned long long>(flash.bytesProgrammed / 1024),
+           static_cast<unsigned long long>(flash.erases), static_cast<unsigned long long>(flash.gcRuns),
+           flash.busyUs / 1e6, flash.maxCallUs / 1e3, flash.minErases, flash.maxErases);
+    if (!all.empty()) {
+        uint32_t minLargest = UINT32_MAX;
+        for (const Sample* s : all) minLargest = std::min(minLargest, s->largestFree);
+        printf("Largest free block after report: first %u, min %u, last %u\n", all.front()->largestFree, minLargest,
+               all.back()->largestFree);
+        printf("Free heap after report: first %u, last %u\n", all.front()->freeHeap, all.back()->freeHeap);
+    }
+
+    if (bench) printBench(all);
+    if (soak) printDaily(all);
+    int failures = soak ? soakChecks(all, crashes) : 0;
+    if (csv) writeCsv(csv, all);
+
+    if (tempFs) nftw(fsDir.c_str(), removeEntry, 16, FTW_DEPTH | FTW_PHYS);
+    return failures ? 1 : 0;
+}
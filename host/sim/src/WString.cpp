@@ -0,0 +1,457 @@
+/**
+ * WString.cpp (host stub)
+ * Arduino String backed by the simulated device heap. Growth follows the
+ * ESP32 core: reserve() reallocates to exactly the requested size.
+ */
+
+#include "WString.h"
+#include "sim_host.h"
+
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+
+namespace {
+
+void formatInteger(char* buf, size_t size, unsigned long long value, bool negative, unsigned char base) {
+    char tmp[72];
+    int pos = 0;
+    if (base < 2) base = 10;
+    do {
+        unsigned digit = value % base;
+        tmp[pos++] = static_cast<char>(digit < 10 ? '0' + digit : 'a' + digit - 10);
+        value /= base;
+    } while (value && pos < 70);
+    size_t out = 0;
+    if (negative && out + 1 < size) buf[out++] = '-';
+    while (pos > 0 && out + 1 < size) buf[out++] = tmp[--pos];
+    buf[out] = '\0';
+}
+
+void formatSigned(char* buf, size_t size, long long value, unsigned char base) {
+    if (base == 10 && value < 0) {
+        formatInteger(buf, size, 0ULL - static_cast<unsigned long long>(value), true, base);
+    } else {
+        formatInteger(buf, size, static_cast<unsigned long long>(value), false, base);
+    }
+}
+
+} // namespace
+
+String::String(const char* cstr) {
+    initSso();
+    if (cstr) copy(cstr, strlen(cstr));
+}
+
+String::String(const char* cstr, unsigned int length) {
+    initSso();
+    if (cstr) copy(cstr, length);
+}
+
+String::String(const String& other) {
+    initSso();
+    copy(other.c_str(), other._len);
+}
+
+String::String(String&& other) noexcept {
+    initSso();
+    moveFrom(other);
+}
+
+String::String(char c) {
+    initSso();
+    copy(&c, 1);
+}
+
+String::String(unsigned char value, unsigned char base) {
+    initSso();
+    char buf[72];
+    formatInteger(buf, sizeof(buf), value, false, base);
+    copy(buf, strlen(buf));
+}
+
+String::String(int value, unsigned char base) {
+    initSso();
+    char buf[72];
+    formatSigned(buf, sizeof(buf), value, base);
+    copy(buf, strlen(buf));
+}
+
+String::String(unsigned int value, unsigned char base) {
+    initSso();
+    char buf[72];
+    formatInteger(buf, sizeof(buf), value, false, base);
+    copy(buf, strlen(buf));
+}
+
+String::String(long value, unsigned char base) {
+    initSso();
+    char buf[72];
+    formatSigned(buf, sizeof(buf), value, base);
+    copy(buf, strlen(buf));
+}
+
+String::String(unsigned long value, unsigned char base) {
+    initSso();
+    char buf[72];
+    formatInteger(buf, sizeof(buf), value, false, base);
+    copy(buf, strlen(buf));
+}
+
+String::String(long long value, unsigned char base) {
+    initSso();
+    char buf[72];
+    formatSigned(buf, sizeof(buf), value, base);
+    copy(buf, strlen(buf));
+}
+
+String::String(unsigned long long value, unsigned char base) {
+    initSso();
+    char buf[72];
+    formatInteger(buf, sizeof(buf), value, false, base);
+    copy(buf, strlen(buf));
+}
+
+String::String(float value, unsigned int decimalPlaces) : String(static_cast<double>(value), decimalPlaces) {}
+
+String::String(double value, unsigned int decimalPlaces) {
+    initSso();
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%.*f", static_cast<int>(decimalPlaces), value);
+    copy(buf, strlen(buf));
+}
+
+String::~String() {
+    if (isHeap()) sim::heapFree(_buf);
+}
+
+void String::moveFrom(String& other) {
+    if (isHeap()) sim::heapFree(_buf);
+    if (other.isHeap()) {
+        _buf = other._buf;
+        _cap = other._cap;
+    } else {
+        _buf = _sso;
+        _cap = kSsoCapacity;
+        memcpy(_sso, other._sso, other._len + 1);
+    }
+    _len = other._len;
+    other.initSso();
+}
+
+String& String::operator=(const String& rhs) {
+    if (this != &rhs) copy(rhs.c_str(), rhs._len);
+    return *this;
+}
+
+String& String::operator=(String&& rhs) noexcept {
+    if (this != &rhs) moveFrom(rhs);
+    return *this;
+}
+
+String& String::operator=(const char* cstr) {
+    if (cstr) copy(cstr, strlen(cstr));
+    else setLength(0);
+    return *this;
+}
+
+bool String::reserve(unsigned int size) {
+    if (_cap >= size) return true;
+    char* p;
+    if (isHeap()) {
+        p = static_cast<char*>(sim::heapRealloc(_buf, size + 1));
+        if (!p) return false;
+    } else {
+        p = static_cast<char*>(sim::heapAlloc(size + 1));
+        if (!p) return false;
+        memcpy(p, _sso, _len + 1);
+    }
+    _buf = p;
+    _cap = size;
+    return true;
+}
+
+void String::setLength(unsigned int len) {
+    _len = len;
+    _buf[len] = '\0';
+}
+
+String& String::copy(const char* cstr, unsigned int length) {
+    if (!reserve(length)) {
+        setLength(0);
+        return *this;
+    }
+    memmove(_buf, cstr, length);
+    setLength(length);
+    return *this;
+}
+
+bool String::concat(const char* cstr) {
+    return cstr ? concat(cstr, strlen(cstr)) : false;
+}
+
+bool String::concat(const char* cstr, unsigned int length) {
+    if (!cstr) return false;
+    if (length == 0) return true;
+    // cstr may point into our own buffer; remember the offset across realloc.
+    const bool self = cstr >= _buf && cstr < _buf + _len;
+    const size_t offset = self ? static_cast<size_t>(cstr - _buf) : 0;
+    if (!reserve(_len + length)) return false;
+    if (self) cstr = _buf + offset;
+    memmove(_buf + _len, cstr, length);
+    setLength(_len + length);
+    return true;
+}
+
+bool String::concat(unsigned char num) {
+    char buf[8];
+    snprintf(buf, sizeof(buf), "%u", num);
+    return concat(buf);
+}
+
+bool String::concat(int num) {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%d", num);
+    return concat(buf);
+}
+
+bool String::concat(unsigned int num) {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%u", num);
+    return concat(buf);
+}
+
+bool String::concat(long num) {
+    char buf[24];
+    snprintf(buf, sizeof(buf), "%ld", num);
+    return concat(buf);
+}
+
+bool String::concat(unsigned long num) {
+    char buf[24];
+    snprintf(buf, sizeof(buf), "%lu", num);
+    return concat(buf);
+}
+
+bool String::concat(long long num) {
+    char buf[24];
+    snprintf(buf, sizeof(buf), "%lld", num);
+    return concat(buf);
+}
+
+bool String::concat(unsigned long long num) {
+    char buf[24];
+    snprintf(buf, sizeof(buf), "%llu", num);
+    return concat(buf);
+}
+
+bool String::concat(float num) {
+    return concat(static_cast<double>(num));
+}
+
+bool String::concat(double num) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%.2f", num);
+    return concat(buf);
+}
+
+int String::compareTo(const String& s) const {
+    return strcmp(c_str(), s.c_str());
+}
+
+bool String::equals(const char* cstr) const {
+    if (!cstr) return _len == 0;
+    return strcmp(c_str(), cstr) == 0;
+}
+
+bool String::equalsIgnoreCase(const String& s) const {
+    if (_len != s._len) return false;
+    for (unsigned int i = 0; i < _len; ++i) {
+        if (tolower(static_cast<unsigned char>(c_str()[i])) != tolower(static_cast<unsigned char>(s.c_str()[i]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool String::startsWith(const String& prefix) const {
+    return startsWith(prefix, 0);
+}
+
+bool String::startsWith(const String& prefix, unsigned int offset) const {
+    if (offset > _len || prefix._len > _len - offset) return false;
+    return strncmp(c_str() + offset, prefix.c_str(), prefix._len) == 0;
+}
+
+bool String::endsWith(const String& suffix) const {
+    if (suffix._len > _len) return false;
+    return strcmp(c_str() + _len - suffix._len, suffix.c_str()) == 0;
+}
+
+char String::charAt(unsigned int index) const {
+    return index < _len ? _buf[index] : '\0';
+}
+
+void String::setCharAt(unsigned int index, char c) {
+    if (index < _len) _buf[index] = c;
+}
+
+char& String::operator[](unsigned int index) {
+    static char dummy;
+    if (index >= _len) {
+        dummy = '\0';
+        return dummy;
+    }
+    return _buf[index];
+}
+
+void String::getBytes(unsigned char* buf, unsigned int bufsize, unsigned int index) const {
+    if (!bufsize || !buf) return;
+    if (index >= _len) {
+        buf[0] = '\0';
+        return;
+    }
+    unsigned int n = bufsize - 1;
+    if (n > _len - index) n = _len - index;
+    memcpy(buf, c_str() + index, n);
+    buf[n] = '\0';
+}
+
+int String::indexOf(char ch, unsigned int fromIndex) const {
+    if (fromIndex >= _len) return -1;
+    const char* p = static_cast<const char*>(memchr(c_str() + fromIndex, ch, _len - fromIndex));
+    return p ? static_cast<int>(p - c_str()) : -1;
+}
+
+int String::indexOf(const String& str, unsigned int fromIndex) const {
+    return indexOf(str.c_str(), fromIndex);
+}
+
+int String::indexOf(const char* str, unsigned int fromIndex) const {
+    if (fromIndex >= _len) return -1;
+    const char* p = strstr(c_str() + fromIndex, str);
+    return p ? static_cast<int>(p - c_str()) : -1;
+}
+
+int String::lastIndexOf(char ch) const {
+    const char* p = strrchr(c_str(), ch);
+    return p ? static_cast<int>(p - c_str()) : -1;
+}
+
+int String::lastIndexOf(const String& str) const {
+    if (str._len > _len) return -1;
+    for (int i = static_cast<int>(_len - str._len); i >= 0; --i) {
+        if (strncmp(c_str() + i, str.c_str(), str._len) == 0) return i;
+    }
+    return -1;
+}
+
+String String::substring(unsigned int beginIndex, unsigned int endIndex) const {
+    if (beginIndex > endIndex) {
+        unsigned int t = beginIndex;
+        beginIndex = endIndex;
+        endIndex = t;
+    }
+    if (beginIndex >= _len) return String();
+    if (endIndex > _len) endIndex = _len;
+    return String(c_str() + beginIndex, endIndex - beginIndex);
+}
+
+void String::replace(char find, char replace) {
+    for (unsigned int i = 0; i < _len; ++i) {
+        if (_buf[i] == find) _buf[i] = replace;
+    }
+}
+
+void String::replace(const String& find, const String& replace) {
+    if (_len == 0 || find._len == 0) return;
+    String out;
+    unsigned int pos = 0;
+    while (pos < _len) {
+        int hit = indexOf(find, pos);
+        if (hit < 0) break;
+        out.concat(c_str() + pos, hit - pos);
+        out.concat(replace);
+        pos = hit + find._len;
+    }
+    if (pos == 0) return;
+    out.concat(c_str() + pos, _len - pos);
+    *this = std::move(out);
+}
+
+void String::remove(unsigned int index) {
+    if (index < _len) setLength(index);
+}
+
+void String::remove(unsigned int index, unsigned int count) {
+    if (index >= _len) return;
+    if (count > _len - index) count = _len - index;
+    memmove(_buf + index, _buf + index + count, _len - index - count);
+    setLength(_len - count);
+}
+
+void String::toLowerCase() {
+    for (unsigned int i = 0; i < _len; ++i) _buf[i] = static_cast<char>(tolower(static_cast<unsigned char>(_buf[i])));
+}
+
+void String::toUpperCase() {
+    for (unsigned int i = 0; i < _len; ++i) _buf[i] = static_cast<char>(toupper(static_cast<unsigned char>(_buf[i])));
+}
+
+void String::trim() {
+    if (_len == 0) return;
+    unsigned int begin = 0;
+    while (begin < _len && isspace(static_cast<unsigned char>(_buf[begin]))) begin++;
+    unsigned int end = _len;
+    while (end > begin && isspace(static_cast<unsigned char>(_buf[end - 1]))) end--;
+    memmove(_buf, _buf + begin, end - begin);
+    setLength(end - begin);
+}
+
+long String::toInt() const {
+    return atol(c_str());
+}
+
+float String::toFloat() const {
+    return static_cast<float>(atof(c_str()));
+}
+
+double String::toDouble() const {
+    return atof(c_str());
+}
+
+String operator+(const String& lhs, const String& rhs) {
+    String out;
+    out.reserve(lhs.length() + rhs.length());
+    out.concat(lhs);
+    out.concat(rhs);
+    return out;
+}
+
+String operator+(String&& lhs, const String& rhs) {
+    lhs.concat(rhs);
+    return std::move(lhs);
+}
+
+String operator+(const String& lhs, const char* rhs) {
+    String out(lhs);
+    out.concat(rhs);
+    return out;
+}
+
+String operator+(String&& lhs, const char* rhs) {
+    lhs.concat(rhs);
+    return std::move(lhs);
+}
+
+String operator+(const char* lhs, const String& rhs) {
+    String out(lhs);
+    out.concat(rhs);
+    return out;
+}
+
+String operator+(const char* lhs, String&& rhs) {
+    String out(lhs);
+    out.concat(rhs);
+    return out;
+}
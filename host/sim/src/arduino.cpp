@@ -0,0 +1,568 @@
+/**
+ * arduino.cpp (host simulator)
+ * Virtual clock, Serial, ESP, time and the fork-per-boot runner.
+ */
+
+#include "Arduino.h"
+#include "ESPmDNS.h"
+#include "NetBIOS.h"
+#include "esp_mac.h"
+#include "esp_sleep.h"
+#include "esp_timer.h"
+#include "sim_host.h"
+#include "sim_radio.h"
+
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cstdarg>
+#include <algorithm>
+#include <cstdio>
+#include <exception>
+#include <vector>
+
+extern "C" {
+// Bounds of the RTC_DATA_ATTR section, provided by the GNU linker.
+extern uint8_t __start_sim_rtc_data[] __attribute__((weak));
+extern uint8_t __stop_sim_rtc_data[] __attribute__((weak));
+}
+
+HardwareSerial Serial;
+EspClass ESP;
+MDNSResponder MDNS;
+NetBIOS NBNS;
+
+namespace sim {
+
+namespace {
+
+constexpr size_t kRtcBytes = 8192;  // RTC slow memory on the ESP32
+constexpr size_t kSerialTail = 64 * 1024;
+constexpr size_t kNvsBytes = 40 * 1024;  // serialized image of the 20 KB nvs partition
+
+struct Shared {
+    uint64_t nowUs;
+    uint64_t bootStartUs;
+    uint64_t sleepUs;
+    uint32_t bootCount;
+    int resetReason;
+    int wakeupCause;
+    bool rtcValid;
+    uint32_t resetsFired;  // scripted resets already applied
+    int pendingReset;      // reason of the scripted reset ending this boot
+    uint8_t rtc[kRtcBytes];
+    uint64_t counters[kMaxCounters];
+    uint32_t nvsLength;
+    uint8_t nvs[kNvsBytes];
+};
+
+struct ScriptedReset {
+    uint64_t atUs;
+    int reason;
+};
+
+Shared* gShared = nullptr;
+bool gRealtime = false;
+int gPortOffset = -1;
+uint16_t gListeners[8] = {};  // device ports with a server listening (this boot)
+bool gSerialEcho = true;
+uint64_t gLastDelayAtUs = 0;
+std::string gSerialLog;
+std::vector<ScriptedReset> gResets;  // sorted by time; copied into every boot by fork()
+
+Shared* shared() {
+    if (!gShared) {
+        void* p = mmap(nullptr, sizeof(Shared), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED) {
+            perror("mmap");
+            abort();
+        }
+        gShared = static_cast<Shared*>(p);
+        gShared->bootCount = 0;
+        gShared->resetReason = ESP_RST_POWERON;
+        gShared->wakeupCause = ESP_SLEEP_WAKEUP_UNDEFINED;
+    }
+    return gShared;
+}
+
+size_t rtcSize() {
+    if (!__start_sim_rtc_data || !__stop_sim_rtc_data) return 0;
+    return static_cast<size_t>(__stop_sim_rtc_data - __start_sim_rtc_data);
+}
+
+} // namespace
+
+uint64_t nowUs() { return shared()->nowUs; }
+
+// Ends the boot when the clock has passed the next scripted reset.
+void checkScriptedReset() {
+    Shared* s = shared();
+    if (!inDevice() || s->resetsFired >= gResets.size() || gResets[s->resetsFired].atUs > s->nowUs) return;
+    s->pendingReset = gResets[s->resetsFired++].reason;
+    fflush(stdout);
+    endBoot(BootEnd::Reset);
+}
+
+void advanceUs(uint64_t us) {
+    shared()->nowUs += us;
+    if (gRealtime && us > 0) usleep(static_cast<useconds_t>(us));
+    checkScriptedReset();
+    radio().poll();
+}
+
+void creditRealWaitUs(uint64_t us) {
+    shared()->nowUs += us;
+    checkScriptedReset();
+    radio().poll();
+}
+
+void addReset(uint64_t atUs, int reason) {
+    HostScope host;
+    ScriptedReset r{atUs, reason};
+    gResets.insert(std::upper_bound(gResets.begin(), gResets.end(), r,
+                                    [](const ScriptedReset& a, const ScriptedReset& b) { return a.atUs < b.atUs; }),
+                   r);
+}
+
+// Next scripted reset in (fromUs, toUs], 0 if none.
+uint64_t nextResetUs(uint64_t fromUs, uint64_t toUs) {
+    Shared* s = shared();
+    for (size_t i = s->resetsFired; i < gResets.size(); i++) {
+        if (gResets[i].atUs > toUs) break;
+        if (gResets[i].atUs > fromUs) return gResets[i].atUs;
+    }
+    return 0;
+}
+
+NvsImage nvsImage() {
+    Shared* s = shared();
+    return NvsImage{s->nvs, &s->nvsLength, kNvsBytes};
+}
+
+void setRealtime(bool realtime) { gRealtime = realtime; }
+
+uint64_t lastDelayAtUs() { return gLastDelayAtUs; }
+
+void setPortOffset(int offset) { gPortOffset = offset; }
+
+uint16_t hostPortFor(uint16_t devicePort) {
+    if (gPortOffset < 0) return 0;
+    int port = devicePort + gPortOffset;
+    return port > 0 && port < 65536 ? static_cast<uint16_t>(port) : 0;
+}
+void addDeviceListener(uint16_t devicePort) {
+    for (uint16_t& p : gListeners) {
+        if (p == 0 || p == devicePort) {
+            p = devicePort;
+            return;
+        }
+    }
+}
+
+void removeDeviceListener(uint16_t devicePort) {
+    for (uint16_t& p : gListeners) {
+        if (p == devicePort) p = 0;
+    }
+}
+
+bool deviceListening(uint16_t devicePort) {
+    for (uint16_t p : gListeners) {
+        if (p != 0 && p == devicePort) return true;
+    }
+    return false;
+}
+
+bool realtime() { return gRealtime; }
+
+void setSerialEcho(bool echo) { gSerialEcho = echo; }
+const std::string& serialLog() { return gSerialLog; }
+void clearSerialLog() {
+    HostScope host;
+    gSerialLog.clear();
+}
+
+void appendSerial(const char* data, size_t len) {
+    if (gSerialEcho) fwrite(data, 1, len, stdout);
+    HostScope host;
+    gSerialLog.append(data, len);
+    if (gSerialLog.size() > kSerialTail) gSerialLog.erase(0, gSerialLog.size() - kSerialTail / 2);
+}
+
+void endBoot(BootEnd reason) {
+    throw BootEnded{reason};
+}
+
+int resetReason() { return shared()->resetReason; }
+int wakeupCause() { return shared()->wakeupCause; }
+void setWakeupCause(int cause) { shared()->wakeupCause = cause; }
+uint64_t sleepRequestUs() { return shared()->sleepUs; }
+void setSleepRequestUs(uint64_t us) { shared()->sleepUs = us; }
+uint32_t bootCount() { return shared()->bootCount; }
+
+uint64_t& counter(int index) { return shared()->counters[index]; }
+
+uint64_t uptimeUs() { return shared()->nowUs - shared()->bootStartUs; }
+
+int runBoots(const Firmware& fw, uint64_t untilUs) {
+    Shared* s = shared();
+    int crashes = 0;
+    const size_t rtcLen = rtcSize();
+
+    while (s->nowUs < untilUs) {
+        s->bootCount++;
+        fflush(stdout);
+        pid_t pid = fork();
+        if (pid < 0) {
+            perror("fork");
+            return crashes + 1;
+        }
+
+        if (pid == 0) {
+            // Child: one boot of the firmware.
+            s->bootStartUs = s->nowUs;
+            if (s->rtcValid && rtcLen > 0) memcpy(__start_sim_rtc_data, s->rtc, std::min(rtcLen, kRtcBytes));
+            BootEnd reason = BootEnd::Finished;
+            enterDevice();
+            try {
+                fw.setup();
+                while (nowUs() < untilUs) {
+                    fw.loop();
+                    if (fw.afterLoop && !fw.afterLoop()) break;
+                }
+            } catch (const BootEnded& e) {
+                reason = e.reason;
+            } catch (const std::exception& e) {
+                fprintf(stderr, "[sim] boot %u crashed: %s\n", s->bootCount, e.what());
+                reason = BootEnd::Crashed;
+            }
+            leaveDevice();
+            if (rtcLen > 0) {
+                memcpy(s->rtc, __start_sim_rtc_data, std::min(rtcLen, kRtcBytes));
+                s->rtcValid = true;
+            }
+            fflush(stdout);
+            fflush(stderr);
+            _exit(static_cast<int>(reason));
+        }
+
+        int status = 0;
+        waitpid(pid, &status, 0);
+        BootEnd reason = BootEnd::Crashed;
+        if (WIFEXITED(status)) reason = static_cast<BootEnd>(WEXITSTATUS(status));
+
+        if (fw.onBootEnd) fw.onBootEnd(reason);
+
+        switch (reason) {
+            case BootEnd::Finished:
+                return crashes;
+            case BootEnd::Restart:
+                s->resetReason = ESP_RST_SW;
+                s->wakeupCause = ESP_SLEEP_WAKEUP_UNDEFINED;
+                s->nowUs += 300 * 1000;  // ROM + bootloader before app_main
+                break;
+            case BootEnd::DeepSleep:
+                s->resetReason = ESP_RST_DEEPSLEEP;
+                s->wakeupCause = s->wakeupCause == ESP_SLEEP_WAKEUP_UNDEFINED ? ESP_SLEEP_WAKEUP_TIMER
+                                                                               : s->wakeupCause;
+                s->nowUs += s->sleepUs;
+                s->nowUs += 60 * 1000;  // deep-sleep wake stub is faster than a cold boot
+                break;
+            case BootEnd::Reset:
+                s->resetReason = s->pendingReset;
+                s->wakeupCause = ESP_SLEEP_WAKEUP_UNDEFINED;
+                // The supply dropped: RTC memory is gone as after power-on.
+                if (s->pendingReset == ESP_RST_BROWNOUT || s->pendingReset == ESP_RST_POWERON) s->rtcValid = false;
+                s->nowUs += 300 * 1000;
+                break;
+            default:
+                crashes++;
+                s->resetReason = ESP_RST_PANIC;
+                s->rtcValid = false;
+                s->nowUs += 300 * 1000;
+                break;
+        }
+    }
+    return crashes;
+}
+
+} // namespace sim
+
+// ---- Arduino core ----
+
+unsigned long millis() { return static_cast<unsigned long>(sim::uptimeUs() / 1000ULL); }
+unsigned long micros() { return static_cast<unsigned long>(sim::uptimeUs()); }
+void delay(uint32_t ms) {
+    sim::gLastDelayAtUs = sim::nowUs();
+    sim::advanceUs(static_cast<uint64_t>(ms) * 1000ULL);
+}
+void delayMicroseconds(uint32_t us) { sim::advanceUs(us); }
+void yield() { sim::radio().poll(); }
+
+int64_t esp_timer_get_time(void) { return static_cast<int64_t>(sim::uptimeUs()); }
+
+void pinMode(uint8_t pin, uint8_t mode) {
+    (void)pin;
+    (void)mode;
+}
+
+int digitalRead(uint8_t pin) { return sim::radio().pinLevel(pin); }
+void digitalWrite(uint8_t pin, uint8_t value) {
+    (void)pin;
+    (void)value;
+}
+
+long random(long max) { return max > 0 ? ::random() % max : 0; }
+long random(long min, long max) { return max > min ? min + ::random() % (max - min) : min; }
+void randomSeed(unsigned long seed) { srandom(static_cast<unsigned>(seed)); }
+
+// ---- Print / Stream ----
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+    size_t n = 0;
+    while (size--) n += write(*buffer++);
+    return n;
+}
+
+size_t Print::printf(const char* format, ...) {
+    char small[64];  // same stack buffer as the ESP32 core
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(small, sizeof(small), format, args);
+    va_end(args);
+    if (len < 0) return 0;
+    if (static_cast<size_t>(len) < sizeof(small)) return write(reinterpret_cast<uint8_t*>(small), len);
+
+    // Long output: the core mallocs a temporary buffer here, and so do we.
+    char* big = static_cast<char*>(sim::heapAlloc(len + 1));
+    if (!big) return 0;
+    va_start(args, format);
+    vsnprintf(big, len + 1, format, args);
+    va_end(args);
+    size_t n = write(reinterpret_cast<uint8_t*>(big), len);
+    sim::heapFree(big);
+    return n;
+}
+
+size_t Print::print(long n, int base) {
+    if (base == 10) return printf("%ld", n);
+    return print(static_cast<unsigned long>(n), base);
+}
+
+size_t Print::print(unsigned long n, int base) {
+    if (base == 16) return printf("%lX", n);
+    if (base == 8) return printf("%lo", n);
+    if (base == 2) {
+        char buf[8 * sizeof(long) + 1];
+        int pos = sizeof(buf) - 1;
+        buf[pos] = '\0';
+        do {
+            buf[--pos] = static_cast<char>('0' + (n & 1));
+            n >>= 1;
+        } while (n);
+        return write(buf + pos);
+    }
+    return printf("%lu", n);
+}
+
+size_t Print::print(long long n, int base) {
+    if (base == 10) return printf("%lld", n);
+    return print(static_cast<unsigned long long>(n), base);
+}
+
+size_t Print::print(unsigned long long n, int base) {
+    if (base == 16) return printf("%llX", n);
+    return printf("%llu", n);
+}
+
+size_t Print::print(double n, int digits) { return printf("%.*f", digits, n); }
+
+size_t Print::print(const Printable& p) { return p.printTo(*this); }
+
+size_t Stream::readBytes(uint8_t* buffer, size_t length) {
+    size_t count = 0;
+    while (count < length) {
+        int c = read();
+        if (c < 0) break;
+        *buffer++ = static_cast<uint8_t>(c);
+        count++;
+    }
+    return count;
+}
+
+String Stream::readString() {
+    String out;
+    int c;
+    while ((c = read()) >= 0) out += static_cast<char>(c);
+    return out;
+}
+
+String Stream::readStringUntil(char terminator) {
+    String out;
+    int c;
+    while ((c = read()) >= 0 && c != terminator) out += static_cast<char>(c);
+    return out;
+}
+
+// ---- Serial ----
+
+namespace sim {
+void appendSerial(const char* data, size_t len);
+}
+
+int HardwareSerial::available() { return 0; }
+int HardwareSerial::read() { return -1; }
+int HardwareSerial::peek() { return -1; }
+
+size_t HardwareSerial::write(uint8_t c) {
+    char ch = static_cast<char>(c);
+    sim::appendSerial(&ch, 1);
+    return 1;
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size) {
+    sim::appendSerial(reinterpret_cast<const char*>(buffer), size);
+    return size;
+}
+
+// ---- IPAddress ----
+
+bool IPAddress::fromString(const char* address) {
+    unsigned a, b, c, d;
+    char tail;
+    if (!address || sscanf(address, "%u.%u.%u.%u%c", &a, &b, &c, &d, &tail) != 4) return false;
+    if (a > 255 || b > 255 || c > 255 || d > 255) return false;
+    *this = IPAddress(a, b, c, d);
+    return true;
+}
+
+String IPAddress::toString() const {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%u.%u.%u.%u", (*this)[0], (*this)[1], (*this)[2], (*this)[3]);
+    return String(buf);
+}
+
+size_t IPAddress::printTo(Print& p) const {
+    return p.printf("%u.%u.%u.%u", (*this)[0], (*this)[1], (*this)[2], (*this)[3]);
+}
+
+// ---- ESP ----
+
+uint32_t EspClass::getHeapSize() { return static_cast<uint32_t>(sim::heapStats().total); }
+uint32_t EspClass::getFreeHeap() { return static_cast<uint32_t>(sim::heapStats().free); }
+uint32_t EspClass::getMinFreeHeap() { return static_cast<uint32_t>(sim::heapStats().minFree); }
+uint32_t EspClass::getMaxAllocHeap() { return static_cast<uint32_t>(sim::heapStats().largestFree); }
+uint32_t EspClass::getPsramSize() { return static_cast<uint32_t>(sim::psramStats().total); }
+uint32_t EspClass::getFreePsram() { return static_cast<uint32_t>(sim::psramStats().free); }
+uint32_t EspClass::getMinFreePsram() { return static_cast<uint32_t>(sim::psramStats().minFree); }
+uint32_t EspClass::getMaxAllocPsram() { return static_cast<uint32_t>(sim::psramStats().largestFree); }
+
+uint64_t EspClass::getEfuseMac() {
+    uint8_t mac[6];
+    esp_efuse_mac_get_default(mac);
+    uint64_t v = 0;
+    for (int i = 5; i >= 0; --i) v = (v << 8) | mac[i];
+    return v;
+}
+
+void EspClass::restart() { esp_restart(); }
+
+void esp_restart(void) {
+    fflush(stdout);
+    sim::endBoot(sim::BootEnd::Restart);
+}
+
+esp_reset_reason_t esp_reset_reason(void) { return static_cast<esp_reset_reason_t>(sim::resetReason()); }
+uint32_t esp_get_free_heap_size(void) { return ESP.getFreeHeap(); }
+uint32_t esp_get_minimum_free_heap_size(void) { return ESP.getMinFreeHeap(); }
+
+esp_err_t esp_efuse_mac_get_default(uint8_t* mac) {
+    const uint8_t* base = sim::radio().baseMac();
+    memcpy(mac, base, 6);
+    return ESP_OK;
+}
+
+esp_err_t esp_read_mac(uint8_t* mac, esp_mac_type_t type) {
+    esp_efuse_mac_get_default(mac);
+    mac[5] = static_cast<uint8_t>(mac[5] + static_cast<int>(type));  // STA +0, AP +1, BT +2
+    return ESP_OK;
+}
+
+// ---- Deep sleep ----
+
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t time_in_us) {
+    sim::setSleepRequestUs(time_in_us);
+    return ESP_OK;
+}
+
+esp_err_t esp_sleep_enable_ext0_wakeup(int gpio_num, int level) {
+    sim::radio().armButtonWake(gpio_num, level);
+    return ESP_OK;
+}
+
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause(void) {
+    return static_cast<esp_sleep_wakeup_cause_t>(sim::wakeupCause());
+}
+
+void esp_deep_sleep_start(void) {
+    fflush(stdout);
+    // A scripted reset during the sleep window ends the sleep as that reset.
+    uint64_t reset = sim::nextResetUs(sim::nowUs(), sim::nowUs() + sim::sleepRequestUs());
+    if (reset) sim::creditRealWaitUs(reset - sim::nowUs());
+    // A button press scheduled during the sleep window wakes the device early.
+    uint64_t press = sim::radio().nextButtonPressUs(sim::nowUs(), sim::nowUs() + sim::sleepRequestUs());
+    if (press) {
+        sim::setSleepRequestUs(press - sim::nowUs());
+        sim::setWakeupCause(ESP_SLEEP_WAKEUP_EXT0);
+    } else {
+        sim::setWakeupCause(ESP_SLEEP_WAKEUP_TIMER);
+    }
+    sim::endBoot(sim::BootEnd::DeepSleep);
+}
+
+void esp_deep_sleep(uint64_t time_in_us) {
+    esp_sleep_enable_timer_wakeup(time_in_us);
+    esp_deep_sleep_start();
+}
+
+// ---- time ----
+
+namespace {
+uint64_t gNtpRequestUs = 0;
+bool gNtpRequested = false;
+constexpr uint64_t kNtpRoundTripUs = 350 * 1000;
+}
+
+namespace sim {
+time_t wallTime() {
+    constexpr time_t kEpochAtStart = 1790000000;  // 2026-09-21, virtual time 0
+    return kEpochAtStart + static_cast<time_t>(nowUs() / 1000000ULL);
+}
+}
+
+void configTime(long gmtOffsetSec, int daylightOffsetSec, const char* server1, const char* server2,
+                const char* server3) {
+    (void)gmtOffsetSec;
+    (void)daylightOffsetSec;
+    (void)server1;
+    (void)server2;
+    (void)server3;
+    gNtpRequested = true;
+    gNtpRequestUs = sim::nowUs();
+}
+
+bool getLocalTime(struct tm* info, uint32_t ms) {
+    if (!gNtpRequested) return false;
+    uint64_t readyAt = gNtpRequestUs + kNtpRoundTripUs;
+    if (sim::nowUs() < readyAt) {
+        uint64_t waitUs = static_cast<uint64_t>(ms) * 1000ULL;
+        if (sim::nowUs() + waitUs < readyAt || !WiFi.isConnected()) {
+            sim::advanceUs(waitUs);
+            return false;
+        }
+        sim::advanceUs(readyAt - sim::nowUs());
+    }
+    time_t now = sim::wallTime();
+    localtime_r(&now, info);
+    return true;
+}
@@ -0,0 +1,114 @@
+/**
+ * dns.cpp (host simulator)
+ * Wildcard / single-name DNS responder for the captive portal.
+ */
+
+#include "DNSServer.h"
+#include "sim_host.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+constexpr size_t kHeaderBytes = 12;
+constexpr size_t kMaxPacket = 512;
+
+// Question name as dotted lower-case text; returns the offset after QNAME, 0 on error.
+size_t readName(const uint8_t* pkt, size_t len, char* out, size_t outLen) {
+    size_t pos = kHeaderBytes;
+    size_t w = 0;
+    while (pos < len && pkt[pos] != 0) {
+        size_t label = pkt[pos++];
+        if (label > 63 || pos + label > len) return 0;
+        if (w && w + 1 < outLen) out[w++] = '.';
+        for (size_t i = 0; i < label && w + 1 < outLen; ++i) out[w++] = static_cast<char>(tolower(pkt[pos + i]));
+        pos += label;
+    }
+    out[w] = '\0';
+    return pos < len ? pos + 1 : 0;
+}
+
+} // namespace
+
+DNSServer::DNSServer()
+    : _fd(-1), _domain{0}, _ip(), _errorCode(DNSReplyCode::NonExistentDomain), _ttl(60), _answered(0) {}
+
+DNSServer::~DNSServer() { stop(); }
+
+bool DNSServer::start(const uint16_t& port, const String& domainName, const IPAddress& resolvedIP) {
+    stop();
+    snprintf(_domain, sizeof(_domain), "%s", domainName.c_str());
+    for (char* p = _domain; *p; ++p) *p = static_cast<char>(tolower(*p));
+    _ip = resolvedIP;
+    _answered = 0;
+
+    uint16_t hostPort = sim::hostPortFor(port);
+    if (!hostPort) return true;  // listening disabled for this run
+    int fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) return false;
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(hostPort);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        fprintf(stderr, "[sim] DNSServer: cannot bind 127.0.0.1:%u\n", hostPort);
+        ::close(fd);
+        return false;
+    }
+    _fd = fd;
+    return true;
+}
+
+void DNSServer::stop() {
+    if (_fd >= 0) ::close(_fd);
+    _fd = -1;
+}
+
+void DNSServer::processNextRequest() {
+    if (_fd < 0) return;
+    uint8_t pkt[kMaxPacket];
+    sockaddr_in peer{};
+    socklen_t peerLen = sizeof(peer);
+    ssize_t n = recvfrom(_fd, pkt, sizeof(pkt), 0, reinterpret_cast<sockaddr*>(&peer), &peerLen);
+    if (n < static_cast<ssize_t>(kHeaderBytes)) return;
+    size_t len = static_cast<size_t>(n);
+    bool isQuery = (pkt[2] & 0x80) == 0 && (pkt[2] & 0x78) == 0;  // QR = 0, OPCODE = QUERY
+    uint16_t qdcount = static_cast<uint16_t>(pkt[4] << 8 | pkt[5]);
+    if (!isQuery || qdcount != 1) return;
+
+    char name[256];
+    size_t qEnd = readName(pkt, len, name, sizeof(name));
+    if (!qEnd || qEnd + 4 > len) return;
+    uint16_t qtype = static_cast<uint16_t>(pkt[qEnd] << 8 | pkt[qEnd + 1]);
+    size_t questionEnd = qEnd + 4;
+    bool match = strcmp(_domain, "*") == 0 || strcmp(_domain, name) == 0;
+
+    uint8_t out[kMaxPacket];
+    memcpy(out, pkt, questionEnd);
+    out[2] = static_cast<uint8_t>(0x80 | (pkt[2] & 0x01) | 0x04);  // QR, RD copied, AA
+    out[3] = 0x80;                                                  // RA
+    out[6] = out[7] = out[8] = out[9] = out[10] = out[11] = 0;
+    size_t w = questionEnd;
+    if (match && qtype == 1) {
+        const uint8_t answer[] = {0xC0, 0x0C, 0x00, 0x01, 0x00, 0x01,
+                                  static_cast<uint8_t>(_ttl >> 24), static_cast<uint8_t>(_ttl >> 16),
+                                  static_cast<uint8_t>(_ttl >> 8), static_cast<uint8_t>(_ttl),
+                                  0x00, 0x04, _ip[0], _ip[1], _ip[2], _ip[3]};
+        memcpy(out + w, answer, sizeof(answer));
+        w += sizeof(answer);
+        out[7] = 1;
+        _answered++;
+    } else {
+        out[3] = static_cast<uint8_t>(0x80 | static_cast<uint8_t>(match ? DNSReplyCode::NoError : _errorCode));
+    }
+    sendto(_fd, out, w, 0, reinterpret_cast<sockaddr*>(&peer), peerLen);
+}
@@ -0,0 +1,499 @@
+/**
+ * flash.cpp (host simulator)
+ * Page-level flash model under the SPIFFS stand-in, see sim_flash.h.
+ */
+
+#include "sim_flash.h"
+#include "sim_host.h"
+
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <set>
+#include <utility>
+
+namespace sim {
+
+namespace {
+
+constexpr size_t kPages = Flash::kBlocks * Flash::kPagesPerBlock;
+constexpr size_t kMaxFiles = 512;
+constexpr size_t kObjNameLen = 32;      // SPIFFS_OBJ_NAME_LEN incl. terminator
+constexpr size_t kHeaderSpans = 102;    // data pages mapped by the index header
+constexpr size_t kIndexSpans = 124;     // ... and by each further index page
+
+constexpr uint32_t kReadPageUs = 25;
+constexpr uint32_t kProgramBaseUs = 60;
+constexpr uint32_t kEraseUs = 45000;
+
+constexpr size_t kGcFreeBlocks = 3;     // GC runs once this few blocks are completely free
+constexpr int kGcMaxRuns = 5;           // SPIFFS_GC_MAX_RUNS
+constexpr long kGcWeightDeleted = 5;    // SPIFFS_GC_HEUR_W_DELET
+constexpr long kGcWeightUsed = -1;      // SPIFFS_GC_HEUR_W_USED
+constexpr long kGcWeightEraseAge = 50;  // SPIFFS_GC_HEUR_W_ERASE_AGE
+
+constexpr uint16_t kFree = 0;
+constexpr uint16_t kDeleted = 0xffff;
+
+enum Kind : uint8_t { kData, kHeader, kIndex };
+
+struct Entry {
+    char path[kObjNameLen];
+    uint32_t size;
+    bool used;
+};
+
+uint32_t programUs(size_t bytes) { return kProgramBaseUs + static_cast<uint32_t>(bytes * 5 / 2); }
+
+size_t dataPages(size_t size) { return (size + Flash::kPageData - 1) / Flash::kPageData; }
+
+size_t indexPages(size_t size) {
+    size_t n = dataPages(size);
+    return n <= kHeaderSpans ? 0 : (n - kHeaderSpans + kIndexSpans - 1) / kIndexSpans;
+}
+
+size_t indexOf(size_t span) { return span < kHeaderSpans ? 0 : 1 + (span - kHeaderSpans) / kIndexSpans; }
+
+bool isLookup(size_t page) { return page % Flash::kPagesPerBlock == 0; }
+
+} // namespace
+
+struct Flash::State {
+    uint16_t owner[kPages];  // kFree, kDeleted or file slot + 1
+    uint8_t kind[kPages];
+    uint16_t span[kPages];   // data span, or index page number
+    uint32_t erases[kBlocks];
+    Entry files[kMaxFiles];
+    uint32_t cursor;
+    uint32_t freePages;
+    uint32_t usedPages;
+    uint32_t deletedPages;
+    uint64_t pendingUs;
+    FlashStats stats;
+};
+
+namespace {
+
+using State = Flash::State;
+
+void charge(State& s, uint64_t us) {
+    s.pendingUs += us;
+    s.stats.busyUs += us;
+}
+
+void readPages(State& s, size_t n) {
+    s.stats.pageReads += n;
+    charge(s, n * kReadPageUs);
+}
+
+void program(State& s, size_t bytes) {
+    s.stats.pagePrograms++;
+    s.stats.bytesProgrammed += bytes;
+    charge(s, programUs(bytes));
+}
+
+void markDeleted(State& s, size_t page) {
+    s.owner[page] = kDeleted;
+    s.usedPages--;
+    s.deletedPages++;
+    s.stats.pageDeletes++;
+    charge(s, programUs(2) + programUs(1));  // lookup entry, then the page's flags
+}
+
+int slotOf(const State& s, const char* path) {
+    for (size_t i = 0; i < kMaxFiles; ++i) {
+        if (s.files[i].used && strcmp(s.files[i].path, path) == 0) return static_cast<int>(i);
+    }
+    return -1;
+}
+
+int newSlot(State& s, const char* path) {
+    for (size_t i = 0; i < kMaxFiles; ++i) {
+        if (s.files[i].used) continue;
+        snprintf(s.files[i].path, kObjNameLen, "%s", path);
+        s.files[i].size = 0;
+        s.files[i].used = true;
+        return static_cast<int>(i);
+    }
+    return -1;
+}
+
+int pageOf(const State& s, uint16_t id, Kind kind, size_t span) {
+    for (size_t p = 0; p < kPages; ++p) {
+        if (s.owner[p] == id && s.kind[p] == kind && s.span[p] == span) return static_cast<int>(p);
+    }
+    return -1;
+}
+
+// Next free page from the cursor on, as spiffs_obj_lu_find_free() walks
+int allocPage(State& s, uint16_t id, Kind kind, size_t span, size_t avoidBlock = SIZE_MAX) {
+    for (size_t i = 0; i < kPages; ++i) {
+        size_t p = (s.cursor + i) % kPages;
+        if (isLookup(p) || s.owner[p] != kFree || p / Flash::kPagesPerBlock == avoidBlock) continue;
+        s.owner[p] = id;
+        s.kind[p] = kind;
+        s.span[p] = static_cast<uint16_t>(span);
+        s.cursor = static_cast<uint32_t>(p + 1);
+        s.freePages--;
+        s.usedPages++;
+        return static_cast<int>(p);
+    }
+    return -1;
+}
+
+size_t freeBlocks(const State& s) {
+    size_t n = 0;
+    for (size_t b = 0; b < Flash::kBlocks; ++b) {
+        bool free = true;
+        for (size_t p = b * Flash::kPagesPerBlock + 1; free && p < (b + 1) * Flash::kPagesPerBlock; ++p) {
+            free = s.owner[p] == kFree;
+        }
+        n += free;
+    }
+    return n;
+}
+
+// Writes index page idx of a file to a new page (read, modify, program) and
+// deletes the old one; a new index page when the file grew into it.
+void rewriteIndex(State& s, uint16_t id, size_t idx) {
+    Kind kind = idx == 0 ? kHeader : kIndex;
+    int old = pageOf(s, id, kind, idx);
+    if (old >= 0) readPages(s, 1);
+    if (allocPage(s, id, kind, idx) < 0) return;
+    program(s, Flash::kPageBytes);
+    if (old >= 0) markDeleted(s, static_cast<size_t>(old));
+}
+
+// One GC round: the best candidate block's live pages move elsewhere, the
+// block is erased. False when no block has anything to reclaim.
+bool gcOne(State& s) {
+    uint32_t maxErases = *std::max_element(s.erases, s.erases + Flash::kBlocks);
+    long bestScore = 0;
+    size_t best = SIZE_MAX;
+    for (size_t b = 0; b < Flash::kBlocks; ++b) {
+        long used = 0, deleted = 0;
+        for (size_t p = b * Flash::kPagesPerBlock + 1; p < (b + 1) * Flash::kPagesPerBlock; ++p) {
+            if (s.owner[p] == kDeleted) deleted++;
+            else if (s.owner[p] != kFree) used++;
+        }
+        if (deleted == 0 || static_cast<uint32_t>(used) > s.freePages) continue;
+        long score = deleted * kGcWeightDeleted + used * kGcWeightUsed +
+                     static_cast<long>(maxErases - s.erases[b]) * kGcWeightEraseAge;
+        if (best == SIZE_MAX || score > bestScore) {
+            best = b;
+            bestScore = score;
+        }
+    }
+    if (best == SIZE_MAX) return false;
+
+    s.stats.gcRuns++;
+    std::set<std::pair<uint16_t, size_t>> indexes;  // index pages pointing at moved data pages
+    for (size_t p = best * Flash::kPagesPerBlock + 1; p < (best + 1) * Flash::kPagesPerBlock; ++p) {
+        uint16_t id = s.owner[p];
+        if (id == kFree || id == kDeleted) continue;
+        readPages(s, 1);
+        Kind kind = static_cast<Kind>(s.kind[p]);
+        if (allocPage(s, id, kind, s.span[p], best) < 0) break;
+        program(s, Flash::kPageBytes);
+        s.stats.gcMoves++;
+        markDeleted(s, p);
+        if (kind == kData) indexes.insert({id, indexOf(s.span[p])});
+    }
+    size_t reclaimed = 0;
+    for (size_t p = best * Flash::kPagesPerBlock + 1; p < (best + 1) * Flash::kPagesPerBlock; ++p) {
+        if (s.owner[p] == kDeleted) {
+            s.owner[p] = kFree;
+            reclaimed++;
+        }
+    }
+    s.deletedPages -= static_cast<uint32_t>(reclaimed);
+    s.freePages += static_cast<uint32_t>(reclaimed);
+    s.erases[best]++;
+    s.stats.erases++;
+    charge(s, kEraseUs);
+    for (const auto& ix : indexes) rewriteIndex(s, ix.first, ix.second);
+    return true;
+}
+
+// spiffs_gc_check(): collect while free blocks run short, up to the run limit
+bool ensureRoom(State& s, size_t pages) {
+    for (int run = 0; run < kGcMaxRuns; ++run) {
+        if (freeBlocks(s) > kGcFreeBlocks && s.freePages >= pages) break;
+        if (!gcOne(s)) break;
+    }
+    return s.freePages >= pages;
+}
+
+// Lays a file of the given size out in fresh pages, without cost (mount, adopt)
+void place(State& s, uint16_t id, size_t size) {
+    allocPage(s, id, kHeader, 0);
+    for (size_t span = 0; span < dataPages(size); ++span) allocPage(s, id, kData, span);
+    for (size_t idx = 1; idx <= indexPages(size); ++idx) allocPage(s, id, kIndex, idx);
+    s.files[id - 1].size = static_cast<uint32_t>(size);
+}
+
+void dropPages(State& s, uint16_t id, bool keepHeader) {
+    for (size_t p = 0; p < kPages; ++p) {
+        if (s.owner[p] == id && !(keepHeader && s.kind[p] == kHeader)) markDeleted(s, p);
+    }
+}
+
+} // namespace
+
+Flash::State* Flash::state() const {
+    if (!_s) {
+        void* p = mmap(nullptr, sizeof(State), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED) {
+            perror("mmap");
+            abort();
+        }
+        _s = static_cast<State*>(p);
+        _s->freePages = static_cast<uint32_t>(kPages - kBlocks);
+    }
+    return _s;
+}
+
+void Flash::mount(const std::vector<std::pair<std::string, size_t>>& files) {
+    HostScope host;
+    State& s = *state();
+    memset(&s, 0, sizeof(s));
+    s.freePages = static_cast<uint32_t>(kPages - kBlocks);
+    for (const auto& f : files) {
+        int slot = newSlot(s, f.first.c_str());
+        if (slot >= 0) place(s, static_cast<uint16_t>(slot + 1), f.second);
+    }
+}
+
+FlashStats Flash::stats() const {
+    const State& s = *state();
+    FlashStats out = s.stats;
+    out.freePages = s.freePages;
+    out.usedPages = s.usedPages;
+    out.deletedPages = s.deletedPages;
+    out.minErases = *std::min_element(s.erases, s.erases + kBlocks);
+    out.maxErases = *std::max_element(s.erases, s.erases + kBlocks);
+    uint64_t sum = 0;
+    for (uint32_t e : s.erases) sum += e;
+    out.meanErases = static_cast<double>(sum) / kBlocks;
+    return out;
+}
+
+std::vector<uint32_t> Flash::wear() const {
+    HostScope host;
+    const State& s = *state();
+    return std::vector<uint32_t>(s.erases, s.erases + kBlocks);
+}
+
+bool Flash::check(const std::vector<std::pair<std::string, size_t>>& files, std::string& error) const {
+    HostScope host;
+    const State& s = *state();
+    char buf[160];
+    uint32_t counts[3] = {0, 0, 0};  // free, used, deleted
+    for (size_t p = 0; p < kPages; ++p) {
+        if (isLookup(p)) continue;
+        counts[s.owner[p] == kFree ? 0 : s.owner[p] == kDeleted ? 2 : 1]++;
+        if (s.owner[p] != kFree && s.owner[p] != kDeleted && !s.files[s.owner[p] - 1].used) {
+            snprintf(buf, sizeof(buf), "page %zu belongs to a removed file", p);
+            error = buf;
+            return false;
+        }
+    }
+    if (counts[0] != s.freePages || counts[1] != s.usedPages || counts[2] != s.deletedPages) {
+        snprintf(buf, sizeof(buf), "page counts %u/%u/%u, pages say %u/%u/%u", s.freePages, s.usedPages,
+                 s.deletedPages, counts[0], counts[1], counts[2]);
+        error = buf;
+        return false;
+    }
+
+    size_t known = 0;
+    for (size_t i = 0; i < kMaxFiles; ++i) {
+        const Entry& e = s.files[i];
+        if (!e.used) continue;
+        known++;
+        auto f = std::find_if(files.begin(), files.end(), [&](const std::pair<std::string, size_t>& x) {
+            return x.first == e.path;
+        });
+        if (f == files.end() || f->second != e.size) {
+            snprintf(buf, sizeof(buf), "%s: model has %u bytes, directory %s", e.path, e.size,
+                     f == files.end() ? "has no file" : std::to_string(f->second).c_str());
+            error = buf;
+            return false;
+        }
+        std::vector<int> spans(dataPages(e.size), 0);
+        size_t headers = 0, index = 0;
+        for (size_t p = 0; p < kPages; ++p) {
+            if (s.owner[p] != i + 1) continue;
+            if (s.kind[p] == kHeader) headers++;
+            else if (s.kind[p] == kIndex) index++;
+            else if (s.span[p] < spans.size()) spans[s.span[p]]++;
+            else spans.push_back(2);  // page past the end
+        }
+        bool spansOk = std::all_of(spans.begin(), spans.end(), [](int n) { return n == 1; });
+        if (headers != 1 || index != indexPages(e.size) || !spansOk) {
+            snprintf(buf, sizeof(buf), "%s: %zu headers, %zu index pages, data spans %s", e.path, headers, index,
+                     spansOk ? "ok" : "missing or duplicated");
+            error = buf;
+            return false;
+        }
+    }
+    if (known != files.size()) {
+        snprintf(buf, sizeof(buf), "model knows %zu files, directory has %zu", known, files.size());
+        error = buf;
+        return false;
+    }
+    return true;
+}
+
+bool Flash::has(const char* path) const { return slotOf(*state(), path) >= 0; }
+
+void Flash::adopt(const char* path, size_t size) {
+    State& s = *state();
+    if (slotOf(s, path) >= 0) return;
+    int slot = newSlot(s, path);
+    if (slot >= 0) place(s, static_cast<uint16_t>(slot + 1), size);
+}
+
+void Flash::scanLookup() { readPages(*state(), kBlocks); }
+
+bool Flash::find(const char* path) {
+    State& s = *state();
+    int slot = slotOf(s, path);
+    for (size_t b = 0; b < kBlocks; ++b) {
+        readPages(s, 1);
+        for (size_t p = b * kPagesPerBlock + 1; p < (b + 1) * kPagesPerBlock; ++p) {
+            if (s.owner[p] == kFree || s.owner[p] == kDeleted || s.kind[p] != kHeader) continue;
+            readPages(s, 1);  // name compare
+            if (s.owner[p] == slot + 1) return true;
+        }
+    }
+    return false;
+}
+
+bool Flash::create(const char* path) {
+    HostScope host;
+    State& s = *state();
+    int slot = slotOf(s, path);
+    if (slot >= 0) {
+        // O_TRUNC: data and index pages go, the header is rewritten with size 0
+        dropPages(s, static_cast<uint16_t>(slot + 1), true);
+        s.files[slot].size = 0;
+        if (!ensureRoom(s, 1)) return false;
+        rewriteIndex(s, static_cast<uint16_t>(slot + 1), 0);
+        return true;
+    }
+    scanLookup();  // spiffs_obj_lu_find_free_obj_id()
+    slot = newSlot(s, path);
+    if (slot < 0 || !ensureRoom(s, 1)) return false;
+    if (allocPage(s, static_cast<uint16_t>(slot + 1), kHeader, 0) < 0) return false;
+    program(s, kPageBytes);
+    return true;
+}
+
+bool Flash::write(const char* path, size_t pos, size_t len) {
+    HostScope host;
+    State& s = *state();
+    int slot = slotOf(s, path);
+    if (slot < 0) slot = newSlot(s, path);
+    if (slot < 0 || len == 0) return slot >= 0;
+    const uint16_t id = static_cast<uint16_t>(slot + 1);
+    const size_t size = s.files[slot].size;
+    const size_t start = std::min(pos, size);  // a gap past the end is written as zeros
+    const size_t end = pos + len;
+    const size_t first = start / kPageData;
+    const size_t last = (end - 1) / kPageData;
+    if (!ensureRoom(s, last - first + 2 + indexPages(end))) return false;
+
+    std::vector<int> pages(last + 1, -1);
+    for (size_t p = 0; p < kPages; ++p) {
+        if (s.owner[p] == id && s.kind[p] == kData && s.span[p] <= last) pages[s.span[p]] = static_cast<int>(p);
+    }
+    std::set<size_t> indexes;
+    for (size_t span = first; span <= last; ++span) {
+        const size_t pageStart = span * kPageData;
+        const size_t existing = size > pageStart ? std::min(kPageData, size - pageStart) : 0;
+        const size_t from = std::max(start, pageStart) - pageStart;
+        const size_t to = std::min(end, pageStart + kPageData) - pageStart;
+        if (existing == 0 || pages[span] < 0) {
+            if (allocPage(s, id, kData, span) < 0) return false;
+            program(s, kPageBytes - kPageData + to - from);
+            indexes.insert(indexOf(span));
+        } else if (from >= existing) {
+            program(s, to - from);  // tail of the last page, in place
+        } else {
+            // Changed bytes: the page is copied with them to a new one
+            readPages(s, 1);
+            if (allocPage(s, id, kData, span) < 0) return false;
+            program(s, kPageBytes - kPageData + std::max(existing, to));
+            markDeleted(s, static_cast<size_t>(pages[span]));
+            indexes.insert(indexOf(span));
+        }
+    }
+    if (end > size) {
+        s.files[slot].size = static_cast<uint32_t>(end);
+        indexes.insert(0);  // the header holds the size
+    }
+    for (size_t idx : indexes) rewriteIndex(s, id, idx);
+    return true;
+}
+
+void Flash::read(const char* path, size_t pos, size_t len, long& lastSpan) {
+    State& s = *state();
+    int slot = slotOf(s, path);
+    if (slot < 0 || len == 0 || pos >= s.files[slot].size) return;
+    const size_t end = std::min<size_t>(pos + len, s.files[slot].size);
+    const long first = static_cast<long>(pos / kPageData);
+    const long last = static_cast<long>((end - 1) / kPageData);
+    readPages(s, static_cast<size_t>(last - first + 1 - (first == lastSpan)));
+    lastSpan = last;
+}
+
+void Flash::remove(const char* path) {
+    State& s = *state();
+    int slot = slotOf(s, path);
+    if (slot < 0) return;
+    dropPages(s, static_cast<uint16_t>(slot + 1), false);
+    s.files[slot].used = false;
+}
+
+void Flash::rename(const char* from, const char* to) {
+    State& s = *state();
+    int slot = slotOf(s, from);
+    if (slot < 0) return;
+    if (slotOf(s, to) >= 0) remove(to);
+    snprintf(s.files[slot].path, kObjNameLen, "%s", to);
+    if (ensureRoom(s, 1)) rewriteIndex(s, static_cast<uint16_t>(slot + 1), 0);
+}
+
+void Flash::format() {
+    State& s = *state();
+    for (size_t b = 0; b < kBlocks; ++b) {
+        s.erases[b]++;
+        s.stats.erases++;
+        charge(s, kEraseUs);
+    }
+    memset(s.owner, 0, sizeof(s.owner));
+    memset(s.files, 0, sizeof(s.files));
+    s.cursor = 0;
+    s.freePages = static_cast<uint32_t>(kPages - kBlocks);
+    s.usedPages = 0;
+    s.deletedPages = 0;
+}
+
+void Flash::settle() {
+    State& s = *state();
+    const uint64_t us = s.pendingUs;
+    if (us == 0) return;
+    s.pendingUs = 0;
+    s.stats.maxCallUs = std::max(s.stats.maxCallUs, us);
+    advanceUs(us);
+}
+
+Flash& flash() {
+    static Flash instance;
+    return instance;
+}
+
+} // namespace sim
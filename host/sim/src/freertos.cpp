@@ -0,0 +1,84 @@
+/**
+ * freertos.cpp (host simulator)
+ * The two tasks firmware code can observe: the Arduino loop task and the
+ * Wi-Fi event task; mutexes.
+ */
+
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "sim_host.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+struct SimSemaphore {
+    bool held;
+};
+
+struct tskTaskControlBlock {
+    char name[16];
+    BaseType_t core;
+};
+
+namespace {
+
+tskTaskControlBlock gLoopTask = {"loopTask", 1};
+tskTaskControlBlock gEventTask = {"sys_evt", 0};
+tskTaskControlBlock* gCurrent = &gLoopTask;
+
+} // namespace
+
+namespace sim {
+
+EventTaskScope::EventTaskScope() : _outer(gCurrent != &gEventTask) {
+    gCurrent = &gEventTask;
+}
+
+EventTaskScope::~EventTaskScope() {
+    if (_outer) gCurrent = &gLoopTask;
+}
+
+} // namespace sim
+
+BaseType_t xPortGetCoreID(void) {
+    return gCurrent->core;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) {
+    return gCurrent;
+}
+
+char* pcTaskGetName(TaskHandle_t task) {
+    return (task ? task : gCurrent)->name;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t, const char*, uint32_t, void*, UBaseType_t, TaskHandle_t* created) {
+    if (created) *created = nullptr;
+    return errCOULD_NOT_ALLOCATE_REQUIRED_MEMORY;
+}
+
+void vTaskDelete(TaskHandle_t) {}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+    return new SimSemaphore{false};
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticksToWait) {
+    if (sem->held) {
+        if (ticksToWait == 0) return pdFALSE;
+        fprintf(stderr, "[sim] xSemaphoreTake: mutex already held by this task (deadlock on the device)\n");
+        abort();
+    }
+    sem->held = true;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) {
+    if (!sem->held) return pdFALSE;
+    sem->held = false;
+    return pdTRUE;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t sem) {
+    delete sem;
+}
@@ -0,0 +1,434 @@
+/**
+ * fs.cpp (host simulator)
+ * SPIFFS over a host directory. Keeps the SPIFFS rules that bite on the
+ * device: flat namespace (opening "/" lists every file), 31 character object
+ * names, and a fixed partition size with page-granular usage. Every call also
+ * goes through the page-level flash model (sim_flash.h), which charges its
+ * program / erase / read time to the virtual clock.
+ */
+
+#include "FS.h"
+#include "SPIFFS.h"
+#include "sim_flash.h"
+#include "sim_host.h"
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+fs::SPIFFSFS SPIFFS;
+
+namespace fs {
+std::vector<std::pair<std::string, size_t>> filesWithSizes();
+}
+
+namespace sim {
+
+namespace {
+std::string gFsRoot;
+}
+
+void setFsRoot(const std::string& dir) {
+    HostScope host;
+    gFsRoot = dir;
+    while (gFsRoot.size() > 1 && gFsRoot.back() == '/') gFsRoot.pop_back();
+    flash().mount(fs::filesWithSizes());
+}
+
+const std::string& fsRoot() { return gFsRoot; }
+
+std::vector<std::pair<std::string, size_t>> fsFiles() { return fs::filesWithSizes(); }
+
+} // namespace sim
+
+namespace fs {
+
+namespace {
+
+constexpr size_t kObjNameLen = 32;             // SPIFFS_OBJ_NAME_LEN incl. terminator
+constexpr size_t kPartitionBytes = 1318001;    // totalBytes() of the default 1.375 MB partition
+constexpr size_t kPageBytes = 256;
+constexpr size_t kPageData = kPageBytes - 5;   // page header
+constexpr size_t kStdioBuf = 128;              // newlib's buffer over the VFS file
+
+size_t usageOf(size_t fileSize) {
+    return (1 + (fileSize + kPageData - 1) / kPageData) * kPageBytes;  // index page + data pages
+}
+
+std::string hostPath(const char* path) {
+    return sim::fsRoot() + (path[0] == '/' ? "" : "/") + path;
+}
+
+// Every file below the root as a SPIFFS path, sorted.
+std::vector<std::string> listFiles() {
+    std::vector<std::string> out;
+    std::vector<std::string> pending{""};
+    while (!pending.empty()) {
+        std::string rel = pending.back();
+        pending.pop_back();
+        DIR* d = opendir((sim::fsRoot() + rel).c_str());
+        if (!d) continue;
+        while (dirent* e = readdir(d)) {
+            std::string name = e->d_name;
+            if (name == "." || name == "..") continue;
+            std::string child = rel + "/" + name;
+            struct stat st;
+            if (stat((sim::fsRoot() + child).c_str(), &st) != 0) continue;
+            if (S_ISDIR(st.st_mode)) pending.push_back(child);
+            else out.push_back(child);
+        }
+        closedir(d);
+    }
+    std::sort(out.begin(), out.end());
+    return out;
+}
+
+size_t usedBytesNow() {
+    size_t used = 0;
+    for (const std::string& p : listFiles()) {
+        struct stat st;
+        if (stat((sim::fsRoot() + p).c_str(), &st) == 0) used += usageOf(static_cast<size_t>(st.st_size));
+    }
+    return used;
+}
+
+void makeParents(const std::string& full) {
+    for (size_t i = sim::fsRoot().size() + 1; i < full.size(); ++i) {
+        if (full[i] == '/') mkdir(full.substr(0, i).c_str(), 0755);
+    }
+}
+
+// Host file the flash model has not seen (put there by hand during the run)
+void adoptIfNew(const char* path, const std::string& full) {
+    struct stat st;
+    if (!sim::flash().has(path) && stat(full.c_str(), &st) == 0 && S_ISREG(st.st_mode)) {
+        sim::flash().adopt(path, static_cast<size_t>(st.st_size));
+    }
+}
+
+} // namespace
+
+std::vector<std::pair<std::string, size_t>> filesWithSizes() {
+    sim::HostScope host;
+    std::vector<std::pair<std::string, size_t>> out;
+    for (const std::string& p : listFiles()) {
+        struct stat st;
+        if (stat((sim::fsRoot() + p).c_str(), &st) == 0) out.push_back({p, static_cast<size_t>(st.st_size)});
+    }
+    return out;
+}
+
+// One open file or directory handle. Allocated on the device heap by open(),
+// with room for the stdio buffer newlib would allocate alongside it. Writes
+// reach the flash model the way they reach SPIFFS through that buffer: small
+// contiguous ones collect until it is full, or until flush / seek / read /
+// close.
+class FileImpl {
+public:
+    ~FileImpl() {
+        // A File dropped without close(): its time goes with the next call
+        commitWrites();
+        if (fp) fclose(fp);
+    }
+
+    void commitWrites() {
+        if (pendingLen == 0) return;
+        sim::flash().write(path, pendingPos, pendingLen);
+        pendingLen = 0;
+    }
+
+    FILE* fp = nullptr;
+    bool isDir = false;
+    bool writable = false;
+    size_t dirIndex = 0;
+    size_t pendingPos = 0;  // buffered writes not yet in the flash model
+    size_t pendingLen = 0;
+    long lastReadSpan = -1; // data page read last (SPIFFS keeps it cached)
+    char path[kObjNameLen + 32] = {0};
+    char stdioBuf[kStdioBuf];
+};
+
+size_t File::write(uint8_t c) { return write(&c, 1); }
+
+size_t File::write(const uint8_t* buf, size_t size) {
+    if (!_p || !_p->fp || !_p->writable) return 0;
+    sim::HostScope host;
+    long pos = ftell(_p->fp);
+    fseek(_p->fp, 0, SEEK_END);
+    long end = ftell(_p->fp);
+    fseek(_p->fp, pos, SEEK_SET);
+    size_t grow = pos + size > static_cast<size_t>(end) ? pos + size - end : 0;
+    if (grow && usedBytesNow() - usageOf(end) + usageOf(end + grow) > kPartitionBytes) return 0;  // full
+    size_t n = fwrite(buf, 1, size, _p->fp);
+    if (_p->pendingLen > 0 && static_cast<size_t>(pos) == _p->pendingPos + _p->pendingLen &&
+        _p->pendingLen + n < kStdioBuf) {
+        _p->pendingLen += n;
+        return n;
+    }
+    _p->commitWrites();
+    if (n < kStdioBuf) {
+        _p->pendingPos = static_cast<size_t>(pos);
+        _p->pendingLen = n;
+    } else {
+        sim::flash().write(_p->path, static_cast<size_t>(pos), n);
+    }
+    sim::flash().settle();
+    return n;
+}
+
+int File::available() {
+    if (!_p || !_p->fp) return 0;
+    return static_cast<int>(size() - position());
+}
+
+int File::read() {
+    uint8_t c;
+    return read(&c, 1) == 1 ? c : -1;
+}
+
+int File::peek() {
+    if (!_p || !_p->fp) return -1;
+    int c = fgetc(_p->fp);
+    if (c != EOF) ungetc(c, _p->fp);
+    return c == EOF ? -1 : c;
+}
+
+void File::flush() {
+    if (_p && _p->fp) {
+        fflush(_p->fp);
+        _p->commitWrites();
+        sim::flash().settle();
+    }
+}
+
+size_t File::read(uint8_t* buf, size_t size) {
+    if (!_p || !_p->fp) return 0;
+    _p->commitWrites();
+    size_t pos = static_cast<size_t>(ftell(_p->fp));
+    size_t n = fread(buf, 1, size, _p->fp);
+    sim::flash().read(_p->path, pos, n, _p->lastReadSpan);
+    sim::flash().settle();
+    return n;
+}
+
+bool File::seek(uint32_t pos, SeekMode mode) {
+    if (!_p || !_p->fp) return false;
+    _p->commitWrites();
+    int whence = mode == SeekSet ? SEEK_SET : mode == SeekCur ? SEEK_CUR : SEEK_END;
+    return fseek(_p->fp, pos, whence) == 0;
+}
+
+size_t File::position() const {
+    if (!_p || !_p->fp) return 0;
+    return static_cast<size_t>(ftell(_p->fp));
+}
+
+size_t File::size() const {
+    if (!_p || _p->isDir) return 0;
+    struct stat st;
+    if (_p->fp) fflush(_p->fp);
+    return stat(hostPath(_p->path).c_str(), &st) == 0 ? static_cast<size_t>(st.st_size) : 0;
+}
+
+void File::close() {
+    if (_p && _p->fp) {
+        _p->commitWrites();
+        fclose(_p->fp);
+        _p->fp = nullptr;
+    }
+    _p.reset();
+    sim::flash().settle();
+}
+
+File::operator bool() const { return _p && (_p->fp || _p->isDir); }
+
+time_t File::getLastWrite() {
+    struct stat st;
+    if (!_p || stat(hostPath(_p->path).c_str(), &st) != 0) return 0;
+    return st.st_mtime;
+}
+
+const char* File::path() const { return _p ? _p->path : nullptr; }
+
+const char* File::name() const {
+    if (!_p) return nullptr;
+    const char* slash = strrchr(_p->path, '/');
+    return slash ? slash + 1 : _p->path;
+}
+
+bool File::isDirectory() { return _p && _p->isDir; }
+
+File File::openNextFile(const char* mode) {
+    if (!_p || !_p->isDir) return File();
+    std::string next;
+    {
+        sim::HostScope host;
+        // readdir walks the lookup pages and reads each index header it meets
+        if (_p->dirIndex == 0) sim::flash().scanLookup();
+        std::string prefix = _p->path;
+        if (prefix.empty() || prefix.back() != '/') prefix += '/';
+        std::vector<std::string> files = listFiles();
+        size_t seen = 0;
+        for (const std::string& f : files) {
+            if (f.compare(0, prefix.size(), prefix) != 0) continue;
+            if (seen++ == _p->dirIndex) {
+                next = f;
+                break;
+            }
+        }
+    }
+    if (next.empty()) {
+        sim::flash().settle();
+        return File();
+    }
+    _p->dirIndex++;
+    return SPIFFS.open(next.c_str(), mode);
+}
+
+void File::rewindDirectory() {
+    if (_p) _p->dirIndex = 0;
+}
+
+String File::readString() {
+    String out;
+    uint8_t buf[128];
+    size_t n;
+    while ((n = read(buf, sizeof(buf))) > 0) out.concat(reinterpret_cast<const char*>(buf), n);
+    return out;
+}
+
+File FS::open(const char* path, const char* mode, const bool create) {
+    (void)create;
+    if (!path || path[0] != '/' || sim::fsRoot().empty()) return File();
+    std::string full;
+    bool isDir = false;
+    {
+        sim::HostScope host;
+        full = hostPath(path);
+        struct stat st;
+        isDir = strcmp(path, "/") == 0 || (stat(full.c_str(), &st) == 0 && S_ISDIR(st.st_mode));
+    }
+    const bool write = mode[0] == 'w' || mode[0] == 'a' || strchr(mode, '+');
+    if (!isDir && strlen(path) >= kObjNameLen) return File();  // SPIFFS_ERR_NAME_TOO_LONG
+    if (!isDir || write) {
+        // spiffs_open(): look the name up, then create or truncate
+        sim::HostScope host;
+        adoptIfNew(path, full);
+        bool found = sim::flash().find(path);
+        if (write && (mode[0] == 'w' || !found)) sim::flash().create(path);
+        sim::flash().settle();
+    }
+
+    FileImplPtr impl = std::make_shared<FileImpl>();
+    snprintf(impl->path, sizeof(impl->path), "%s", path);
+    impl->isDir = isDir && !write;
+    if (impl->isDir) return File(impl);
+
+    sim::HostScope host;
+    if (write) makeParents(full);
+    char fmode[4] = {mode[0], '\0', '\0', '\0'};
+    if (strchr(mode, '+')) strcat(fmode, "+");
+    strcat(fmode, "b");
+    impl->fp = fopen(full.c_str(), fmode);
+    if (!impl->fp) return File();
+    impl->writable = write;
+    return File(impl);
+}
+
+bool FS::exists(const char* path) {
+    if (!path || sim::fsRoot().empty()) return false;
+    bool found;
+    {
+        sim::HostScope host;
+        struct stat st;
+        std::string full = hostPath(path);
+        found = stat(full.c_str(), &st) == 0;
+        if (found && S_ISREG(st.st_mode)) {
+            adoptIfNew(path, full);
+            sim::flash().find(path);
+        } else if (!found) {
+            sim::flash().find(path);  // a miss scans every block
+        }
+    }
+    sim::flash().settle();
+    return found;
+}
+
+bool FS::remove(const char* path) {
+    if (!path || sim::fsRoot().empty()) return false;
+    bool ok;
+    {
+        sim::HostScope host;
+        std::string full = hostPath(path);
+        adoptIfNew(path, full);
+        sim::flash().find(path);
+        ok = ::unlink(full.c_str()) == 0;
+        if (ok) sim::flash().remove(path);
+    }
+    sim::flash().settle();
+    return ok;
+}
+
+bool FS::rename(const char* pathFrom, const char* pathTo) {
+    if (!pathFrom || !pathTo || sim::fsRoot().empty() || strlen(pathTo) >= kObjNameLen) return false;
+    bool ok;
+    {
+        sim::HostScope host;
+        std::string to = hostPath(pathTo);
+        adoptIfNew(pathFrom, hostPath(pathFrom));
+        sim::flash().find(pathTo);
+        sim::flash().find(pathFrom);
+        makeParents(to);
+        ok = ::rename(hostPath(pathFrom).c_str(), to.c_str()) == 0;
+        if (ok) sim::flash().rename(pathFrom, pathTo);
+    }
+    sim::flash().settle();
+    return ok;
+}
+
+SPIFFSFS::SPIFFSFS() : FS(FSImplPtr()) {}
+
+bool SPIFFSFS::begin(bool formatOnFail, const char* basePath, uint8_t maxOpenFiles, const char* partitionLabel) {
+    (void)formatOnFail;
+    (void)basePath;
+    (void)maxOpenFiles;
+    (void)partitionLabel;
+    if (sim::fsRoot().empty()) return false;
+    bool ok;
+    {
+        sim::HostScope host;
+        ::mkdir(sim::fsRoot().c_str(), 0755);
+        struct stat st;
+        ok = stat(sim::fsRoot().c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+        if (ok) sim::flash().scanLookup();  // spiffs_mount() checks every block
+    }
+    sim::flash().settle();
+    return ok;
+}
+
+bool SPIFFSFS::format() {
+    if (sim::fsRoot().empty()) return false;
+    {
+        sim::HostScope host;
+        for (const std::string& p : listFiles()) ::unlink((sim::fsRoot() + p).c_str());
+        sim::flash().format();
+    }
+    sim::flash().settle();  // every sector erased: seconds on the device
+    return true;
+}
+
+size_t SPIFFSFS::totalBytes() { return kPartitionBytes; }
+
+size_t SPIFFSFS::usedBytes() {
+    sim::HostScope host;
+    return usedBytesNow();
+}
+
+void SPIFFSFS::end() {}
+
+} // namespace fs
@@ -0,0 +1,426 @@
+/**
+ * heap.cpp (host simulator)
+ * Simulated ESP32 internal heap: a fixed arena with a first-fit allocator,
+ * boundary tags and coalescing, so fragmentation behaves like the device
+ * and "largest free block" means what it means on the device.
+ * The arena is split into regions like the ESP32's DRAM (free blocks never
+ * merge across a region boundary), so the largest block starts well below
+ * the free total, as it does on the device.
+ *
+ * An optional second pool stands for a WROVER's PSRAM (setPsramBytes()):
+ * heap_caps_malloc(MALLOC_CAP_SPIRAM) allocates from it, and so does malloc
+ * for blocks at or above heap_caps_malloc_extmem_enable()'s limit.
+ *
+ * Global operator new/delete are routed here while firmware code runs
+ * (between enterDevice/leaveDevice); everything else uses the host heap.
+ */
+
+#include "esp_heap_caps.h"
+#include "sim_host.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <malloc.h>
+#include <new>
+
+namespace sim {
+
+namespace {
+
+constexpr size_t kAlign = 8;
+constexpr size_t kMinBlock = 32;
+constexpr size_t kFence = kMinBlock;  // permanently used block between regions
+
+// Free internal heap after Wi-Fi init on an ESP32-D0WD with Arduino core 2.x.
+constexpr size_t kRegions[] = {13 * 1024, 31 * 1024, 44 * 1024, 113 * 1024};
+constexpr size_t kRegionCount = sizeof(kRegions) / sizeof(kRegions[0]);
+constexpr size_t kArenaSize = 13 * 1024 + 31 * 1024 + 44 * 1024 + 113 * 1024 + (kRegionCount - 1) * kFence;
+
+// A WROVER's PSRAM is 4 MB (8 MB parts map 4 MB at a time).
+constexpr size_t kPsramMax = 4 * 1024 * 1024;
+
+struct Header {
+    size_t size;      // whole block incl. header; bit 0 = free
+    size_t prevSize;  // size of the physically previous block (0 for first)
+};
+
+struct FreeLinks {
+    Header* next;
+    Header* prev;
+};
+
+// One heap: the internal DRAM regions, or the PSRAM behind them.
+struct Pool {
+    uint8_t* base;
+    size_t size;
+    Header* freeList;
+    size_t free;
+    size_t minFree;
+    uint64_t allocs;
+    uint64_t fails;
+};
+
+alignas(16) uint8_t gArena[kArenaSize];
+Pool gInternal = {gArena, kArenaSize, nullptr, 0, 0, 0, 0};
+Pool gPsram = {nullptr, 0, nullptr, 0, 0, 0, 0};  // base: host block from setPsramBytes()
+bool gReady = false;
+size_t gPsramSize = 0;
+size_t gExtmemLimit = SIZE_MAX;  // malloc of this much or more tries PSRAM first
+uint64_t gStackAllocs = 0;
+int gHostDepth = 0;
+int gStackDepth = 0;
+int gDeviceDepth = 0;
+
+constexpr size_t kHeader = sizeof(Header);
+
+inline size_t blockSize(const Header* h) { return h->size & ~size_t(1); }
+inline bool isFree(const Header* h) { return h->size & 1; }
+inline FreeLinks* links(Header* h) { return reinterpret_cast<FreeLinks*>(h + 1); }
+inline Header* nextBlock(const Pool& pool, Header* h) {
+    uint8_t* p = reinterpret_cast<uint8_t*>(h) + blockSize(h);
+    return p < pool.base + pool.size ? reinterpret_cast<Header*>(p) : nullptr;
+}
+inline Header* prevBlock(Header* h) {
+    return h->prevSize ? reinterpret_cast<Header*>(reinterpret_cast<uint8_t*>(h) - h->prevSize) : nullptr;
+}
+
+void unlinkFree(Pool& pool, Header* h) {
+    FreeLinks* l = links(h);
+    if (l->prev) links(l->prev)->next = l->next;
+    else pool.freeList = l->next;
+    if (l->next) links(l->next)->prev = l->prev;
+}
+
+void pushFree(Pool& pool, Header* h) {
+    h->size |= 1;
+    FreeLinks* l = links(h);
+    l->prev = nullptr;
+    l->next = pool.freeList;
+    if (pool.freeList) links(pool.freeList)->prev = h;
+    pool.freeList = h;
+}
+
+void setSize(const Pool& pool, Header* h, size_t size, bool free) {
+    h->size = size | (free ? 1 : 0);
+    Header* n = nextBlock(pool, h);
+    if (n) n->prevSize = size;
+}
+
+void initPool(Pool& pool, const size_t* regions, size_t count) {
+    pool.freeList = nullptr;
+    pool.free = 0;
+    uint8_t* p = pool.base;
+    size_t prev = 0;
+    for (size_t i = 0; i < count; ++i) {
+        Header* h = reinterpret_cast<Header*>(p);
+        h->prevSize = prev;
+        h->size = regions[i];
+        pushFree(pool, h);
+        pool.free += regions[i];
+        p += regions[i];
+        prev = regions[i];
+        if (i + 1 < count) {
+            Header* fence = reinterpret_cast<Header*>(p);
+            fence->prevSize = prev;
+            fence->size = kFence;  // used, never freed
+            p += kFence;
+            prev = kFence;
+        }
+    }
+    pool.minFree = pool.free;
+}
+
+void init() {
+    initPool(gInternal, kRegions, kRegionCount);
+    gPsram.size = gPsramSize;
+    if (gPsramSize) initPool(gPsram, &gPsramSize, 1);
+    gReady = true;
+}
+
+bool owns(const Pool& pool, const void* ptr) {
+    const uint8_t* p = static_cast<const uint8_t*>(ptr);
+    return pool.size && p >= pool.base && p < pool.base + pool.size;
+}
+
+Pool& poolOf(const void* ptr) {
+    return owns(gPsram, ptr) ? gPsram : gInternal;
+}
+
+void* poolAlloc(Pool& pool, size_t size) {
+    if (!gReady) init();
+    if (pool.size == 0) return nullptr;
+    size_t need = (size + kHeader + kAlign - 1) & ~(kAlign - 1);
+    if (need < kMinBlock) need = kMinBlock;
+
+    for (Header* h = pool.freeList; h; h = links(h)->next) {
+        size_t have = blockSize(h);
+        if (have < need) continue;
+        unlinkFree(pool, h);
+        if (have - need >= kMinBlock) {
+            setSize(pool, h, need, false);
+            Header* rest = nextBlock(pool, h);
+            rest->prevSize = need;
+            setSize(pool, rest, have - need, true);
+            pushFree(pool, rest);
+        } else {
+            setSize(pool, h, have, false);
+            need = have;
+        }
+        pool.free -= need;
+        if (pool.free < pool.minFree) pool.minFree = pool.free;
+        if (gStackDepth > 0) gStackAllocs++;
+        else pool.allocs++;
+        return h + 1;
+    }
+    pool.fails++;
+    return nullptr;
+}
+
+void poolFree(Pool& pool, void* ptr) {
+    Header* h = static_cast<Header*>(ptr) - 1;
+    size_t size = blockSize(h);
+    pool.free += size;
+    Header* n = nextBlock(pool, h);
+    if (n && isFree(n)) {
+        unlinkFree(pool, n);
+        size += blockSize(n);
+    }
+    Header* p = prevBlock(h);
+    if (p && isFree(p)) {
+        unlinkFree(pool, p);
+        size += blockSize(p);
+        h = p;
+    }
+    setSize(pool, h, size, true);
+    pushFree(pool, h);
+}
+
+// malloc(): blocks of gExtmemLimit bytes or more go to PSRAM first, the
+// rest to internal RAM first; each falls back to the other. The modelled
+// Wi-Fi / TLS stacks allocate internal RAM only.
+void* deviceAlloc(size_t size) {
+    if (gStackDepth > 0) return poolAlloc(gInternal, size);
+    if (size >= gExtmemLimit) {
+        void* p = poolAlloc(gPsram, size);
+        return p ? p : poolAlloc(gInternal, size);
+    }
+    void* p = poolAlloc(gInternal, size);
+    return p ? p : poolAlloc(gPsram, size);
+}
+
+bool useArena() {
+    return gDeviceDepth > 0 && gHostDepth == 0;
+}
+
+HeapStats statsOf(const Pool& pool) {
+    HeapStats s{};
+    s.total = pool.size;
+    if (&pool == &gInternal) s.total -= (kRegionCount - 1) * kFence;
+    s.free = pool.free;
+    s.minFree = pool.minFree;
+    s.allocCount = pool.allocs;
+    s.stackAllocCount = &pool == &gInternal ? gStackAllocs : 0;
+    s.failCount = pool.fails;
+    for (Header* h = pool.freeList; h; h = links(h)->next) {
+        size_t usable = blockSize(h) - kHeader;
+        if (usable > s.largestFree) s.largestFree = usable;
+    }
+    return s;
+}
+
+} // namespace
+
+bool heapOwns(const void* ptr) {
+    return owns(gInternal, ptr) || owns(gPsram, ptr);
+}
+
+void* heapAlloc(size_t size) {
+    if (!useArena()) return std::malloc(size ? size : 1);
+    return deviceAlloc(size);
+}
+
+void heapFree(void* ptr) {
+    if (!ptr) return;
+    if (heapOwns(ptr)) poolFree(poolOf(ptr), ptr);
+    else std::free(ptr);
+}
+
+void* heapRealloc(void* ptr, size_t size) {
+    if (!ptr) return heapAlloc(size);
+    if (!heapOwns(ptr)) {
+        if (!useArena()) return std::realloc(ptr, size);
+        // Host block handed to firmware code: move it onto the device heap.
+        void* out = deviceAlloc(size);
+        if (!out) return nullptr;
+        size_t have = malloc_usable_size(ptr);
+        std::memcpy(out, ptr, have < size ? have : size);
+        std::free(ptr);
+        return out;
+    }
+
+    Pool& pool = poolOf(ptr);
+    Header* h = static_cast<Header*>(ptr) - 1;
+    size_t have = blockSize(h) - kHeader;
+    if (size <= have) return ptr;
+
+    // Grow in place into a free neighbour when possible (what multi_heap does),
+    // unless the block should move to PSRAM now that it crossed the limit.
+    const bool move = &pool == &gInternal && size >= gExtmemLimit && gStackDepth == 0 && gPsram.size;
+    size_t need = (size + kHeader + kAlign - 1) & ~(kAlign - 1);
+    Header* n = nextBlock(pool, h);
+    if (!move && n && isFree(n) && blockSize(h) + blockSize(n) >= need) {
+        size_t total = blockSize(h) + blockSize(n);
+        unlinkFree(pool, n);
+        pool.free -= blockSize(n);
+        if (total - need >= kMinBlock) {
+            setSize(pool, h, need, false);
+            Header* rest = nextBlock(pool, h);
+            rest->prevSize = need;
+            setSize(pool, rest, total - need, true);
+            pushFree(pool, rest);
+            pool.free += total - need;
+        } else {
+            setSize(pool, h, total, false);
+        }
+        if (pool.free < pool.minFree) pool.minFree = pool.free;
+        return ptr;
+    }
+
+    void* out = deviceAlloc(size);
+    if (!out) return nullptr;
+    std::memcpy(out, ptr, have);
+    poolFree(pool, ptr);
+    return out;
+}
+
+HeapStats heapStats() {
+    if (!gReady) init();
+    return statsOf(gInternal);
+}
+
+void setPsramBytes(size_t bytes) {
+    gPsramSize = (bytes < kPsramMax ? bytes : kPsramMax) & ~(kAlign - 1);
+    std::free(gPsram.base);
+    gPsram.base = gPsramSize ? static_cast<uint8_t*>(std::malloc(gPsramSize)) : nullptr;
+    if (!gPsram.base) gPsramSize = 0;
+    gPsram.size = 0;
+    if (gReady) init();
+}
+
+HeapStats psramStats() {
+    if (!gReady) init();
+    return statsOf(gPsram);
+}
+
+void setExtmemLimit(size_t limit) {
+    gExtmemLimit = limit;
+}
+
+void* heapAllocCaps(size_t size, bool psram) {
+    if (!useArena()) return psram && gPsramSize == 0 ? nullptr : std::malloc(size ? size : 1);
+    return poolAlloc(psram ? gPsram : gInternal, size);
+}
+
+HostScope::HostScope() { gHostDepth++; }
+HostScope::~HostScope() { gHostDepth--; }
+StackScope::StackScope() { gStackDepth++; }
+StackScope::~StackScope() { gStackDepth--; }
+
+void enterDevice() { gDeviceDepth++; }
+void leaveDevice() { gDeviceDepth--; }
+bool inDevice() { return useArena(); }
+
+} // namespace sim
+
+// ---- Global operator new/delete ----
+
+void* operator new(size_t size) {
+    void* p = sim::heapAlloc(size);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](size_t size) {
+    void* p = sim::heapAlloc(size);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return sim::heapAlloc(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return sim::heapAlloc(size);
+}
+
+void operator delete(void* ptr) noexcept { sim::heapFree(ptr); }
+void operator delete[](void* ptr) noexcept { sim::heapFree(ptr); }
+void operator delete(void* ptr, size_t) noexcept { sim::heapFree(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { sim::heapFree(ptr); }
+
+// ---- heap_caps ----
+//
+// MALLOC_CAP_SPIRAM selects the PSRAM pool, MALLOC_CAP_INTERNAL / _DMA the
+// internal one; any other caps (8BIT, DEFAULT) cover both, internal first.
+
+namespace {
+
+enum class Caps { Internal, Psram, Any };
+
+Caps capsClass(uint32_t caps) {
+    if (caps & MALLOC_CAP_SPIRAM) return Caps::Psram;
+    if (caps & (MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA)) return Caps::Internal;
+    return Caps::Any;
+}
+
+} // namespace
+
+size_t heap_caps_get_total_size(uint32_t caps) {
+    switch (capsClass(caps)) {
+    case Caps::Internal: return sim::heapStats().total;
+    case Caps::Psram: return sim::psramStats().total;
+    default: return sim::heapStats().total + sim::psramStats().total;
+    }
+}
+
+size_t heap_caps_get_free_size(uint32_t caps) {
+    switch (capsClass(caps)) {
+    case Caps::Internal: return sim::heapStats().free;
+    case Caps::Psram: return sim::psramStats().free;
+    default: return sim::heapStats().free + sim::psramStats().free;
+    }
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps) {
+    const size_t internal = sim::heapStats().largestFree;
+    const size_t psram = sim::psramStats().largestFree;
+    switch (capsClass(caps)) {
+    case Caps::Internal: return internal;
+    case Caps::Psram: return psram;
+    default: return internal > psram ? internal : psram;
+    }
+}
+
+size_t heap_caps_get_minimum_free_size(uint32_t caps) {
+    switch (capsClass(caps)) {
+    case Caps::Internal: return sim::heapStats().minFree;
+    case Caps::Psram: return sim::psramStats().minFree;
+    default: return sim::heapStats().minFree + sim::psramStats().minFree;
+    }
+}
+
+void* heap_caps_malloc(size_t size, uint32_t caps) {
+    switch (capsClass(caps)) {
+    case Caps::Internal: return sim::heapAllocCaps(size, false);
+    case Caps::Psram: return sim::heapAllocCaps(size, true);
+    default: {
+        void* p = sim::heapAllocCaps(size, false);
+        return p ? p : sim::heapAllocCaps(size, true);
+    }
+    }
+}
+
+void heap_caps_free(void* ptr) { sim::heapFree(ptr); }
+
+void heap_caps_malloc_extmem_enable(size_t limit) { sim::setExtmemLimit(limit); }
@@ -0,0 +1,652 @@
+/**
+ * mbedtls.cpp (host simulator)
+ * The mbedTLS server API of mbedtls/ssl.h on OpenSSL memory BIOs, with the
+ * device's heap and handshake costs modelled on top.
+ */
+
+#include "mbedtls/ssl.h"
+#include "sim_host.h"
+
+#include <openssl/err.h>
+#include <openssl/pem.h>
+#include <openssl/rand.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+// mbedTLS footprint with the Arduino core's sdkconfig (asymmetric buffers,
+// as for WiFiClientSecure in net.cpp)
+constexpr size_t kConfigBytes = 1200;      // ssl_config + ctr_drbg + entropy
+constexpr size_t kCertBytes = 1100;        // one parsed certificate
+constexpr size_t kKeyBytes = 500;          // P-256 key pair
+constexpr size_t kSslBytes = 1500;         // ssl_context + session + transform
+constexpr size_t kInRecordBytes = 16384 + 325;
+constexpr size_t kOutRecordBytes = 4096 + 325;
+constexpr size_t kHandshakeBytes = 6500;   // handshake params, ECDHE context, checksums
+constexpr size_t kCacheEntryBytes = 200;   // cached session, no peer certificate
+constexpr size_t kMaxOutFragment = 4096;   // MBEDTLS_SSL_OUT_CONTENT_LEN
+
+// Server side at 240 MHz: ECDHE key pair + ECDSA P-256 signature + ECDH
+// secret; a resumed handshake only runs the PRF
+constexpr uint32_t kFullHandshakeMs = 150;
+constexpr uint32_t kResumedHandshakeMs = 3;
+
+enum State { kIdle = 0, kHandshaking = 1, kOpen = 2, kClosed = 3 };
+
+struct CacheEntry {
+    std::string id;
+    std::string der;
+    int64_t start;
+    void* charge;
+};
+
+typedef std::vector<CacheEntry> CacheEntries;
+
+void* charge(size_t bytes) {
+    sim::StackScope stack;
+    return sim::heapAlloc(bytes);
+}
+
+int64_t uptimeSeconds() { return static_cast<int64_t>(sim::uptimeUs() / 1000000ULL); }
+
+SSL* sslOf(const mbedtls_ssl_context* ssl) { return static_cast<SSL*>(ssl->ssl); }
+
+mbedtls_ssl_context* contextOf(SSL* s) { return static_cast<mbedtls_ssl_context*>(SSL_get_app_data(s)); }
+
+bool setDer(mbedtls_ssl_session* session, const unsigned char* der, size_t len) {
+    free(session->der);
+    session->der = static_cast<unsigned char*>(malloc(len ? len : 1));
+    if (!session->der) return false;
+    memcpy(session->der, der, len);
+    session->der_len = len;
+    return true;
+}
+
+// ---- OpenSSL callbacks, routed to the mbedTLS ones of the config ----
+
+// Full handshake done with a session ID (none when a ticket was issued)
+int onNewSession(SSL* s, SSL_SESSION* sess) {
+    const mbedtls_ssl_config* conf = contextOf(s)->conf;
+    unsigned int idLen = 0;
+    const unsigned char* id = SSL_SESSION_get_id(sess, &idLen);
+    if (!conf->f_set_cache || idLen == 0 || idLen > 32) return 0;
+    mbedtls_ssl_session session;
+    mbedtls_ssl_session_init(&session);
+    memcpy(session.id, id, idLen);
+    session.id_len = idLen;
+    session.start = uptimeSeconds();
+    session.ciphersuite = SSL_CIPHER_get_protocol_id(SSL_SESSION_get0_cipher(sess));
+    int len = i2d_SSL_SESSION(sess, nullptr);
+    if (len > 0) {
+        session.der = static_cast<unsigned char*>(malloc(static_cast<size_t>(len)));
+        unsigned char* p = session.der;
+        if (session.der && i2d_SSL_SESSION(sess, &p) == len) {
+            session.der_len = static_cast<size_t>(len);
+            conf->f_set_cache(conf->p_cache, &session);
+        }
+    }
+    mbedtls_ssl_session_free(&session);
+    return 0;
+}
+
+// Client offered a session ID
+SSL_SESSION* onGetSession(SSL* s, const unsigned char* id, int idLen, int* copy) {
+    *copy = 0;
+    const mbedtls_ssl_config* conf = contextOf(s)->conf;
+    if (!conf->f_get_cache || idLen <= 0 || idLen > 32) return nullptr;
+    mbedtls_ssl_session session;
+    mbedtls_ssl_session_init(&session);
+    memcpy(session.id, id, static_cast<size_t>(idLen));
+    session.id_len = static_cast<size_t>(idLen);
+    SSL_SESSION* found = nullptr;
+    if (conf->f_get_cache(conf->p_cache, &session) == 0 && session.der) {
+        const unsigned char* p = session.der;
+        found = d2i_SSL_SESSION(nullptr, &p, static_cast<long>(session.der_len));
+    }
+    mbedtls_ssl_session_free(&session);
+    return found;
+}
+
+int onTicketGenerate(SSL*, void*) { return 1; }
+
+// Client offered a ticket; OpenSSL has decrypted it (or not)
+SSL_TICKET_RETURN onTicketDecrypt(SSL* s, SSL_SESSION*, const unsigned char*, size_t, SSL_TICKET_STATUS status,
+                                  void*) {
+    const mbedtls_ssl_config* conf = contextOf(s)->conf;
+    switch (status) {
+    case SSL_TICKET_SUCCESS:
+    case SSL_TICKET_SUCCESS_RENEW:
+        break;
+    case SSL_TICKET_EMPTY:
+    case SSL_TICKET_NO_DECRYPT:
+        return SSL_TICKET_RETURN_IGNORE_RENEW;
+    case SSL_TICKET_NONE:
+        return SSL_TICKET_RETURN_IGNORE;
+    default:
+        return SSL_TICKET_RETURN_ABORT;
+    }
+    mbedtls_ssl_session session;
+    mbedtls_ssl_session_init(&session);
+    session.ticket_ok = 1;
+    int ret = conf->f_ticket_parse ? conf->f_ticket_parse(conf->p_ticket, &session, nullptr, 0) : -1;
+    mbedtls_ssl_session_free(&session);
+    if (ret != 0) return SSL_TICKET_RETURN_IGNORE_RENEW;
+    return status == SSL_TICKET_SUCCESS_RENEW ? SSL_TICKET_RETURN_USE_RENEW : SSL_TICKET_RETURN_USE;
+}
+
+// ---- Record I/O between the memory BIOs and the caller's callbacks ----
+
+// Sends what OpenSSL produced; 0 when all of it went out
+int flush(mbedtls_ssl_context* ssl) {
+    std::string& out = *static_cast<std::string*>(ssl->pending);
+    BIO* wbio = SSL_get_wbio(sslOf(ssl));
+    char buf[4096];
+    int n;
+    while ((n = BIO_read(wbio, buf, sizeof(buf))) > 0) {
+        sim::HostScope host;
+        out.append(buf, static_cast<size_t>(n));
+    }
+    while (!out.empty()) {
+        int sent = ssl->f_send(ssl->p_bio, reinterpret_cast<const unsigned char*>(out.data()), out.size());
+        if (sent < 0) return sent;
+        if (sent == 0) return MBEDTLS_ERR_NET_SEND_FAILED;
+        sim::HostScope host;
+        out.erase(0, static_cast<size_t>(sent));
+    }
+    return 0;
+}
+
+// Feeds received bytes to OpenSSL; > 0 when some arrived
+int fill(mbedtls_ssl_context* ssl) {
+    unsigned char buf[4096];
+    int n = ssl->f_recv(ssl->p_bio, buf, sizeof(buf));
+    if (n > 0) BIO_write(SSL_get_rbio(sslOf(ssl)), buf, n);
+    return n == 0 ? MBEDTLS_ERR_SSL_CONN_EOF : n;
+}
+
+// mbedTLS error for an OpenSSL call that returned ret; 0 when more input
+// arrived and the call should be repeated
+int translate(mbedtls_ssl_context* ssl, int ret) {
+    int err = SSL_get_error(sslOf(ssl), ret);
+    int sent = flush(ssl);  // alerts, handshake messages
+    if (sent != 0 && sent != MBEDTLS_ERR_SSL_WANT_WRITE) return sent;
+    switch (err) {
+    case SSL_ERROR_WANT_READ: {
+        int got = fill(ssl);
+        return got > 0 ? 0 : got;
+    }
+    case SSL_ERROR_WANT_WRITE:
+        return MBEDTLS_ERR_SSL_WANT_WRITE;
+    case SSL_ERROR_ZERO_RETURN:
+        ssl->state = kClosed;
+        return MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY;
+    default: {
+        unsigned long e = ERR_get_error();
+        if (e != 0) {
+            char text[160];
+            ERR_error_string_n(e, text, sizeof(text));
+            fprintf(stderr, "[sim] TLS: %s\n", text);
+        }
+        ERR_clear_error();
+        ssl->state = kClosed;
+        return MBEDTLS_ERR_SSL_FATAL_ALERT_MESSAGE;
+    }
+    }
+}
+
+} // namespace
+
+// ============================================================
+// Entropy and DRBG
+// ============================================================
+
+void mbedtls_entropy_init(mbedtls_entropy_context* ctx) { ctx->unused = 0; }
+
+void mbedtls_entropy_free(mbedtls_entropy_context* ctx) { (void)ctx; }
+
+int mbedtls_entropy_func(void* data, unsigned char* output, size_t len) {
+    (void)data;
+    return RAND_bytes(output, static_cast<int>(len)) == 1 ? 0 : -1;
+}
+
+void mbedtls_ctr_drbg_init(mbedtls_ctr_drbg_context* ctx) { ctx->seeded = 0; }
+
+void mbedtls_ctr_drbg_free(mbedtls_ctr_drbg_context* ctx) { ctx->seeded = 0; }
+
+int mbedtls_ctr_drbg_seed(mbedtls_ctr_drbg_context* ctx, int (*f_entropy)(void*, unsigned char*, size_t),
+                          void* p_entropy, const unsigned char* custom, size_t len) {
+    (void)custom;
+    (void)len;
+    unsigned char seed[32];
+    if (f_entropy(p_entropy, seed, sizeof(seed)) != 0) return -1;
+    ctx->seeded = 1;
+    return 0;
+}
+
+int mbedtls_ctr_drbg_random(void* p_rng, unsigned char* output, size_t output_len) {
+    if (!static_cast<mbedtls_ctr_drbg_context*>(p_rng)->seeded) return -1;
+    return RAND_bytes(output, static_cast<int>(output_len)) == 1 ? 0 : -1;
+}
+
+// ============================================================
+// Certificate and key
+// ============================================================
+
+void mbedtls_x509_crt_init(mbedtls_x509_crt* crt) { memset(crt, 0, sizeof(*crt)); }
+
+void mbedtls_x509_crt_free(mbedtls_x509_crt* crt) {
+    if (crt->chain) sk_X509_pop_free(static_cast<STACK_OF(X509)*>(crt->chain), X509_free);
+    sim::heapFree(crt->charge);
+    memset(crt, 0, sizeof(*crt));
+}
+
+int mbedtls_x509_crt_parse(mbedtls_x509_crt* chain, const unsigned char* buf, size_t buflen) {
+    if (!chain->chain) chain->chain = sk_X509_new_null();
+    STACK_OF(X509)* certs = static_cast<STACK_OF(X509)*>(chain->chain);
+    const int before = sk_X509_num(certs);
+    if (buflen > 0 && buf[buflen - 1] == '\0' && strstr(reinterpret_cast<const char*>(buf), "-----BEGIN")) {
+        BIO* in = BIO_new_mem_buf(buf, static_cast<int>(buflen - 1));
+        X509* cert;
+        while ((cert = PEM_read_bio_X509(in, nullptr, nullptr, nullptr)) != nullptr) sk_X509_push(certs, cert);
+        BIO_free(in);
+        ERR_clear_error();  // end of input
+    } else {
+        const unsigned char* p = buf;
+        X509* cert = d2i_X509(nullptr, &p, static_cast<long>(buflen));
+        if (cert) sk_X509_push(certs, cert);
+    }
+    const int count = sk_X509_num(certs);
+    if (count == before) return MBEDTLS_ERR_X509_INVALID_FORMAT;
+    sim::heapFree(chain->charge);
+    chain->charge = charge(kCertBytes * static_cast<size_t>(count));
+    return chain->charge ? 0 : MBEDTLS_ERR_SSL_ALLOC_FAILED;
+}
+
+void mbedtls_pk_init(mbedtls_pk_context* ctx) { memset(ctx, 0, sizeof(*ctx)); }
+
+void mbedtls_pk_free(mbedtls_pk_context* ctx) {
+    EVP_PKEY_free(static_cast<EVP_PKEY*>(ctx->key));
+    sim::heapFree(ctx->charge);
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+int mbedtls_pk_parse_key(mbedtls_pk_context* ctx, const unsigned char* key, size_t keylen, const unsigned char* pwd,
+                         size_t pwdlen) {
+    (void)pwdlen;
+    EVP_PKEY* pkey = nullptr;
+    if (keylen > 0 && key[keylen - 1] == '\0') {
+        BIO* in = BIO_new_mem_buf(key, static_cast<int>(keylen - 1));
+        pkey = PEM_read_bio_PrivateKey(in, nullptr, nullptr, const_cast<unsigned char*>(pwd));
+        BIO_free(in);
+    } else {
+        const unsigned char* p = key;
+        pkey = d2i_AutoPrivateKey(nullptr, &p, static_cast<long>(keylen));
+    }
+    if (!pkey) {
+        ERR_clear_error();
+        return MBEDTLS_ERR_PK_KEY_INVALID_FORMAT;
+    }
+    EVP_PKEY_free(static_cast<EVP_PKEY*>(ctx->key));
+    ctx->key = pkey;
+    if (!ctx->charge) ctx->charge = charge(kKeyBytes);
+    return ctx->charge ? 0 : MBEDTLS_ERR_SSL_ALLOC_FAILED;
+}
+
+// ============================================================
+// Sessions and config
+// ============================================================
+
+void mbedtls_ssl_session_init(mbedtls_ssl_session* session) { memset(session, 0, sizeof(*session)); }
+
+void mbedtls_ssl_session_free(mbedtls_ssl_session* session) {
+    free(session->der);
+    memset(session, 0, sizeof(*session));
+}
+
+void mbedtls_ssl_config_init(mbedtls_ssl_config* conf) { memset(conf, 0, sizeof(*conf)); }
+
+void mbedtls_ssl_config_free(mbedtls_ssl_config* conf) {
+    SSL_CTX_free(static_cast<SSL_CTX*>(conf->ctx));
+    sim::heapFree(conf->charge);
+    memset(conf, 0, sizeof(*conf));
+}
+
+int mbedtls_ssl_config_defaults(mbedtls_ssl_config* conf, int endpoint, int transport, int preset) {
+    (void)preset;
+    if (endpoint != MBEDTLS_SSL_IS_SERVER || transport != MBEDTLS_SSL_TRANSPORT_STREAM) {
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;  // the client side is WiFiClientSecure's model
+    }
+    if (!conf->charge) conf->charge = charge(kConfigBytes);
+    if (!conf->charge) return MBEDTLS_ERR_SSL_ALLOC_FAILED;
+    SSL_CTX* ctx = conf->ctx ? static_cast<SSL_CTX*>(conf->ctx) : SSL_CTX_new(TLS_server_method());
+    if (!ctx) return MBEDTLS_ERR_SSL_ALLOC_FAILED;
+    conf->ctx = ctx;
+    conf->endpoint = endpoint;
+    SSL_CTX_set_min_proto_version(ctx, TLS1_2_VERSION);
+    SSL_CTX_set_max_proto_version(ctx, TLS1_2_VERSION);
+    SSL_CTX_set_options(ctx, SSL_OP_NO_TICKET);
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_SERVER | SSL_SESS_CACHE_NO_INTERNAL);
+    SSL_CTX_sess_set_new_cb(ctx, onNewSession);
+    SSL_CTX_sess_set_get_cb(ctx, onGetSession);
+    SSL_CTX_set_session_id_context(ctx, reinterpret_cast<const unsigned char*>("mbedtls"), 7);
+    SSL_CTX_set_timeout(ctx, MBEDTLS_SSL_CACHE_DEFAULT_TIMEOUT);
+    return 0;
+}
+
+void mbedtls_ssl_conf_rng(mbedtls_ssl_config* conf, int (*f_rng)(void*, unsigned char*, size_t), void* p_rng) {
+    conf->f_rng = f_rng;
+    conf->p_rng = p_rng;
+}
+
+int mbedtls_ssl_conf_own_cert(mbedtls_ssl_config* conf, mbedtls_x509_crt* own_cert, mbedtls_pk_context* pk_key) {
+    SSL_CTX* ctx = static_cast<SSL_CTX*>(conf->ctx);
+    STACK_OF(X509)* certs = static_cast<STACK_OF(X509)*>(own_cert->chain);
+    if (!ctx || !certs || sk_X509_num(certs) == 0 || !pk_key->key) return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    bool ok = SSL_CTX_use_certificate(ctx, sk_X509_value(certs, 0)) == 1 &&
+              SSL_CTX_use_PrivateKey(ctx, static_cast<EVP_PKEY*>(pk_key->key)) == 1 &&
+              SSL_CTX_check_private_key(ctx) == 1;
+    for (int i = 1; ok && i < sk_X509_num(certs); ++i) ok = SSL_CTX_add1_chain_cert(ctx, sk_X509_value(certs, i)) == 1;
+    ERR_clear_error();
+    return ok ? 0 : MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+}
+
+void mbedtls_ssl_conf_session_cache(mbedtls_ssl_config* conf, void* p_cache,
+                                    int (*f_get_cache)(void*, mbedtls_ssl_session*),
+                                    int (*f_set_cache)(void*, const mbedtls_ssl_session*)) {
+    conf->p_cache = p_cache;
+    conf->f_get_cache = f_get_cache;
+    conf->f_set_cache = f_set_cache;
+}
+
+void mbedtls_ssl_conf_session_tickets_cb(mbedtls_ssl_config* conf,
+                                         int (*f_ticket_write)(void*, const mbedtls_ssl_session*, unsigned char*,
+                                                               const unsigned char*, size_t*, uint32_t*),
+                                         int (*f_ticket_parse)(void*, mbedtls_ssl_session*, unsigned char*, size_t),
+                                         void* p_ticket) {
+    conf->f_ticket_write = f_ticket_write;
+    conf->f_ticket_parse = f_ticket_parse;
+    conf->p_ticket = p_ticket;
+    SSL_CTX* ctx = static_cast<SSL_CTX*>(conf->ctx);
+    if (!ctx) return;
+    if (!f_ticket_write || !f_ticket_parse) {
+        SSL_CTX_set_options(ctx, SSL_OP_NO_TICKET);
+        return;
+    }
+    // OpenSSL encrypts the tickets with its own key; the lifetime is the
+    // ticket context's (the callbacks may be wrapped, p_ticket is not)
+    SSL_CTX_clear_options(ctx, SSL_OP_NO_TICKET);
+    SSL_CTX_set_session_ticket_cb(ctx, onTicketGenerate, onTicketDecrypt, nullptr);
+    const mbedtls_ssl_ticket_context* ticket = static_cast<const mbedtls_ssl_ticket_context*>(p_ticket);
+    if (ticket && ticket->ticket_lifetime) SSL_CTX_set_timeout(ctx, ticket->ticket_lifetime);
+}
+
+// ============================================================
+// Connection
+// ============================================================
+
+void mbedtls_ssl_init(mbedtls_ssl_context* ssl) { memset(ssl, 0, sizeof(*ssl)); }
+
+void mbedtls_ssl_free(mbedtls_ssl_context* ssl) {
+    SSL_free(sslOf(ssl));  // and its BIOs
+    {
+        sim::HostScope host;
+        delete static_cast<std::string*>(ssl->pending);
+    }
+    for (void* p : ssl->charge) sim::heapFree(p);
+    sim::heapFree(ssl->handshake);
+    memset(ssl, 0, sizeof(*ssl));
+}
+
+int mbedtls_ssl_setup(mbedtls_ssl_context* ssl, const mbedtls_ssl_config* conf) {
+    if (!conf->ctx) return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    ssl->charge[0] = charge(kSslBytes);
+    ssl->charge[1] = ssl->charge[0] ? charge(kInRecordBytes) : nullptr;
+    ssl->charge[2] = ssl->charge[1] ? charge(kOutRecordBytes) : nullptr;
+    if (!ssl->charge[2]) {
+        for (void*& p : ssl->charge) {
+            sim::heapFree(p);
+            p = nullptr;
+        }
+        return MBEDTLS_ERR_SSL_ALLOC_FAILED;
+    }
+    SSL* s = SSL_new(static_cast<SSL_CTX*>(conf->ctx));
+    if (!s) return MBEDTLS_ERR_SSL_ALLOC_FAILED;
+    SSL_set_bio(s, BIO_new(BIO_s_mem()), BIO_new(BIO_s_mem()));
+    SSL_set_accept_state(s);
+    SSL_set_app_data(s, ssl);
+    ssl->conf = conf;
+    ssl->ssl = s;
+    ssl->state = kIdle;
+    sim::HostScope host;
+    ssl->pending = new std::string();
+    return 0;
+}
+
+int mbedtls_ssl_session_reset(mbedtls_ssl_context* ssl) {
+    SSL* s = sslOf(ssl);
+    if (!s) return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    SSL_clear(s);
+    SSL_set_accept_state(s);
+    BIO_reset(SSL_get_rbio(s));
+    BIO_reset(SSL_get_wbio(s));
+    {
+        sim::HostScope host;
+        static_cast<std::string*>(ssl->pending)->clear();
+    }
+    sim::heapFree(ssl->handshake);
+    ssl->handshake = nullptr;
+    ssl->state = kIdle;
+    return 0;
+}
+
+void mbedtls_ssl_set_bio(mbedtls_ssl_context* ssl, void* p_bio, mbedtls_ssl_send_t* f_send,
+                         mbedtls_ssl_recv_t* f_recv, mbedtls_ssl_recv_timeout_t* f_recv_timeout) {
+    (void)f_recv_timeout;
+    ssl->p_bio = p_bio;
+    ssl->f_send = f_send;
+    ssl->f_recv = f_recv;
+}
+
+int mbedtls_ssl_handshake(mbedtls_ssl_context* ssl) {
+    if (!ssl->ssl || !ssl->f_send || !ssl->f_recv) return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    if (ssl->state == kOpen) return 0;
+    if (ssl->state == kClosed) return MBEDTLS_ERR_SSL_CONN_EOF;
+    if (ssl->state == kIdle) {
+        ssl->handshake = charge(kHandshakeBytes);
+        if (!ssl->handshake) return MBEDTLS_ERR_SSL_ALLOC_FAILED;
+        ssl->state = kHandshaking;
+    }
+    for (;;) {
+        int ret = SSL_do_handshake(sslOf(ssl));
+        if (ret == 1) break;
+        int err = translate(ssl, ret);
+        if (err != 0) return err;
+    }
+    sim::heapFree(ssl->handshake);
+    ssl->handshake = nullptr;
+    ssl->state = kOpen;
+    sim::advanceMs(SSL_session_reused(sslOf(ssl)) ? kResumedHandshakeMs : kFullHandshakeMs);
+    int sent = flush(ssl);  // Finished, when the server speaks last (resumption)
+    return sent == MBEDTLS_ERR_SSL_WANT_WRITE ? 0 : sent;
+}
+
+int mbedtls_ssl_read(mbedtls_ssl_context* ssl, unsigned char* buf, size_t len) {
+    if (ssl->state != kOpen) {
+        int ret = mbedtls_ssl_handshake(ssl);
+        if (ret != 0) return ret;
+    }
+    int sent = flush(ssl);
+    if (sent != 0 && sent != MBEDTLS_ERR_SSL_WANT_WRITE) return sent;
+    for (;;) {
+        int ret = SSL_read(sslOf(ssl), buf, static_cast<int>(len));
+        if (ret > 0) return ret;
+        int err = translate(ssl, ret);
+        if (err != 0) return err;
+    }
+}
+
+int mbedtls_ssl_write(mbedtls_ssl_context* ssl, const unsigned char* buf, size_t len) {
+    if (ssl->state != kOpen) {
+        int ret = mbedtls_ssl_handshake(ssl);
+        if (ret != 0) return ret;
+    }
+    if (len > kMaxOutFragment) len = kMaxOutFragment;
+    int ret = SSL_write(sslOf(ssl), buf, static_cast<int>(len));
+    if (ret <= 0) {
+        int err = translate(ssl, ret);
+        return err != 0 ? err : MBEDTLS_ERR_SSL_WANT_READ;
+    }
+    int sent = flush(ssl);  // what does not fit the socket now goes on the next call
+    return sent != 0 && sent != MBEDTLS_ERR_SSL_WANT_WRITE ? sent : ret;
+}
+
+int mbedtls_ssl_close_notify(mbedtls_ssl_context* ssl) {
+    if (!ssl->ssl || ssl->state != kOpen) return 0;
+    SSL_shutdown(sslOf(ssl));
+    ERR_clear_error();
+    ssl->state = kClosed;
+    return flush(ssl);
+}
+
+const char* mbedtls_ssl_get_ciphersuite(const mbedtls_ssl_context* ssl) {
+    static char name[64];
+    const SSL_CIPHER* cipher = ssl->ssl ? SSL_get_current_cipher(sslOf(ssl)) : nullptr;
+    if (!cipher) return nullptr;
+    snprintf(name, sizeof(name), "%s", SSL_CIPHER_standard_name(cipher));
+    for (char* p = name; *p; ++p) {
+        if (*p == '_') *p = '-';
+    }
+    return name;
+}
+
+const char* mbedtls_ssl_get_version(const mbedtls_ssl_context* ssl) {
+    return ssl->ssl ? SSL_get_version(sslOf(ssl)) : "unknown";
+}
+
+// ============================================================
+// Session cache
+// ============================================================
+
+void mbedtls_ssl_cache_init(mbedtls_ssl_cache_context* cache) {
+    cache->entries = nullptr;
+    cache->timeout = MBEDTLS_SSL_CACHE_DEFAULT_TIMEOUT;
+    cache->max_entries = MBEDTLS_SSL_CACHE_DEFAULT_MAX_ENTRIES;
+}
+
+void mbedtls_ssl_cache_free(mbedtls_ssl_cache_context* cache) {
+    CacheEntries* entries = static_cast<CacheEntries*>(cache->entries);
+    if (entries) {
+        for (CacheEntry& e : *entries) sim::heapFree(e.charge);
+        sim::HostScope host;
+        delete entries;
+    }
+    cache->entries = nullptr;
+}
+
+void mbedtls_ssl_cache_set_timeout(mbedtls_ssl_cache_context* cache, int timeout) {
+    cache->timeout = timeout < 0 ? 0 : timeout;
+}
+
+void mbedtls_ssl_cache_set_max_entries(mbedtls_ssl_cache_context* cache, int max) {
+    cache->max_entries = max < 0 ? 0 : max;
+}
+
+int mbedtls_ssl_cache_get(void* data, mbedtls_ssl_session* session) {
+    mbedtls_ssl_cache_context* cache = static_cast<mbedtls_ssl_cache_context*>(data);
+    CacheEntries* entries = static_cast<CacheEntries*>(cache->entries);
+    if (!entries) return 1;
+    const int64_t now = uptimeSeconds();
+    for (const CacheEntry& e : *entries) {
+        if (cache->timeout != 0 && now - e.start > cache->timeout) continue;
+        if (e.id.size() != session->id_len || memcmp(e.id.data(), session->id, session->id_len) != 0) continue;
+        if (!setDer(session, reinterpret_cast<const unsigned char*>(e.der.data()), e.der.size())) return 1;
+        session->start = e.start;
+        return 0;
+    }
+    return 1;
+}
+
+int mbedtls_ssl_cache_set(void* data, const mbedtls_ssl_session* session) {
+    mbedtls_ssl_cache_context* cache = static_cast<mbedtls_ssl_cache_context*>(data);
+    if (cache->max_entries == 0 || session->id_len == 0) return 1;
+    sim::HostScope host;
+    if (!cache->entries) cache->entries = new CacheEntries();
+    CacheEntries& entries = *static_cast<CacheEntries*>(cache->entries);
+    const int64_t now = uptimeSeconds();
+    const std::string id(reinterpret_cast<const char*>(session->id), session->id_len);
+    // Same ID, else an expired entry, else a new one, else the oldest
+    CacheEntry* slot = nullptr;
+    for (CacheEntry& e : entries) {
+        if (e.id == id) slot = &e;
+    }
+    for (size_t i = 0; !slot && i < entries.size(); ++i) {
+        if (cache->timeout != 0 && now - entries[i].start > cache->timeout) slot = &entries[i];
+    }
+    if (!slot && entries.size() < static_cast<size_t>(cache->max_entries)) {
+        entries.push_back(CacheEntry{std::string(), std::string(), 0, nullptr});
+        slot = &entries.back();
+    }
+    if (!slot) {
+        slot = &entries.front();
+        for (CacheEntry& e : entries) {
+            if (e.start < slot->start) slot = &e;
+        }
+    }
+    if (!slot->charge) {
+        sim::StackScope stack;
+        slot->charge = sim::heapAlloc(kCacheEntryBytes);
+        if (!slot->charge) {
+            if (slot == &entries.back() && slot->id.empty()) entries.pop_back();
+            return MBEDTLS_ERR_SSL_ALLOC_FAILED;
+        }
+    }
+    slot->id = id;
+    slot->der.assign(reinterpret_cast<const char*>(session->der), session->der_len);
+    slot->start = now;
+    return 0;
+}
+
+// ============================================================
+// Session tickets
+// ============================================================
+
+void mbedtls_ssl_ticket_init(mbedtls_ssl_ticket_context* ctx) { memset(ctx, 0, sizeof(*ctx)); }
+
+void mbedtls_ssl_ticket_free(mbedtls_ssl_ticket_context* ctx) { memset(ctx, 0, sizeof(*ctx)); }
+
+int mbedtls_ssl_ticket_setup(mbedtls_ssl_ticket_context* ctx, int (*f_rng)(void*, unsigned char*, size_t),
+                             void* p_rng, mbedtls_cipher_type_t cipher, uint32_t lifetime) {
+    (void)cipher;
+    unsigned char key[32];
+    if (!f_rng || f_rng(p_rng, key, sizeof(key)) != 0) return -1;
+    ctx->ticket_lifetime = lifetime;
+    ctx->ready = 1;
+    return 0;
+}
+
+// OpenSSL writes the ticket itself (onTicketGenerate); only the callback
+// pointer matters
+int mbedtls_ssl_ticket_write(void* p_ticket, const mbedtls_ssl_session* session, unsigned char* start,
+                             const unsigned char* end, size_t* tlen, uint32_t* lifetime) {
+    (void)session;
+    (void)start;
+    (void)end;
+    const mbedtls_ssl_ticket_context* ctx = static_cast<const mbedtls_ssl_ticket_context*>(p_ticket);
+    if (tlen) *tlen = 0;
+    if (lifetime) *lifetime = ctx->ticket_lifetime;
+    return ctx->ready ? 0 : MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+}
+
+int mbedtls_ssl_ticket_parse(void* p_ticket, mbedtls_ssl_session* session, unsigned char* buf, size_t len) {
+    (void)buf;
+    (void)len;
+    const mbedtls_ssl_ticket_context* ctx = static_cast<const mbedtls_ssl_ticket_context*>(p_ticket);
+    return ctx->ready && session->ticket_ok ? 0 : MBEDTLS_ERR_SSL_INVALID_MAC;
+}
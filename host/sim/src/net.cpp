@@ -0,0 +1,856 @@
+/**
+ * net.cpp (host simulator)
+ * WiFiClient, WiFiServer, the modelled WiFiClientSecure, the lwip_* socket
+ * calls used for TCP probes, and HTTPClient on top of the client classes.
+ */
+
+#include "HTTPClient.h"
+#include "WiFi.h"
+#include "WiFiClientSecure.h"
+#include "lwip/sockets.h"
+#include "sim_host.h"
+#include "sim_radio.h"
+#include "sim_webhook.h"
+
+#include <fcntl.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+// Per-connection RX buffer the core's WiFiClient allocates (one TCP MSS).
+constexpr size_t kClientRxBufBytes = 1436;
+
+// mbedTLS footprint with the Arduino core's sdkconfig (asymmetric buffers:
+// 16 KB in / 4 KB out content length, plus record overhead).
+constexpr size_t kSslContextBytes = 2600;   // ssl + config + ctr_drbg + entropy
+constexpr size_t kInRecordBytes = 16384 + 325;
+constexpr size_t kOutRecordBytes = 4096 + 325;
+constexpr size_t kHandshakeBytes = 9000;    // peer chain parse + ECDHE, freed after the handshake
+constexpr uint32_t kHandshakeCryptoMs = 220;  // ECDHE P-256 + signature check at 240 MHz
+
+// How long one empty poll of a real socket may wait (host time).
+constexpr int kRealPollMs = 2;
+
+uint64_t hostNowUs() {
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+// Waits briefly for data on a real socket and moves the virtual clock by the
+// time actually spent, so timeouts in firmware code stay meaningful.
+void waitReadable(int fd) {
+    pollfd p{fd, POLLIN, 0};
+    uint64_t start = hostNowUs();
+    ::poll(&p, 1, kRealPollMs);
+    sim::creditRealWaitUs(hostNowUs() - start);
+}
+
+bool startsWithIgnoreCase(const std::string& s, size_t pos, const char* prefix) {
+    for (; *prefix; ++prefix, ++pos) {
+        if (pos >= s.size() || tolower(static_cast<unsigned char>(s[pos])) != *prefix) return false;
+    }
+    return true;
+}
+
+// Value of a header in a raw header block, or "" (name in lower case).
+std::string headerValue(const std::string& head, const char* name) {
+    size_t pos = 0;
+    while ((pos = head.find("\r\n", pos)) != std::string::npos) {
+        pos += 2;
+        if (startsWithIgnoreCase(head, pos, name)) {
+            size_t start = pos + strlen(name);
+            while (start < head.size() && head[start] == ' ') start++;
+            size_t end = head.find("\r\n", start);
+            return head.substr(start, end == std::string::npos ? std::string::npos : end - start);
+        }
+    }
+    return std::string();
+}
+
+void countResponse(int status) {
+    using namespace sim;
+    counter(kCounterLastStatus) = static_cast<uint64_t>(status);
+    if (status >= 200 && status < 300) counter(kCounterOk)++;
+    else if (status == 429) counter(kCounterRateLimited)++;
+    else counter(kCounterFailed)++;
+}
+
+} // namespace
+
+// ============================================================
+// WiFiClient
+// ============================================================
+
+WiFiClient::WiFiClient() : _fd(-1), _simulated(false), _remotePort(0), _peeked(-1), _rxBuf(nullptr) {}
+
+WiFiClient::WiFiClient(int fd) : _fd(fd), _simulated(false), _remotePort(0), _peeked(-1), _rxBuf(nullptr) {}
+
+WiFiClient::WiFiClient(const WiFiClient& other) : WiFiClient() { *this = other; }
+
+WiFiClient& WiFiClient::operator=(const WiFiClient& other) {
+    if (this == &other) return *this;
+    stop();
+    // dup() stands in for the shared handle: each copy closes its own
+    // descriptor, the connection stays up until the last one does. The RX
+    // buffer stand-in stays with the original (one per connection).
+    _fd = other._fd >= 0 ? fcntl(other._fd, F_DUPFD_CLOEXEC, 0) : -1;
+    _simulated = other._simulated;
+    _remote = other._remote;
+    _remotePort = other._remotePort;
+    _peeked = other._peeked;
+    return *this;
+}
+
+WiFiClient::~WiFiClient() { WiFiClient::stop(); }
+
+int WiFiClient::connect(IPAddress ip, uint16_t port) { return connect(ip, port, 3000); }
+
+int WiFiClient::connect(IPAddress ip, uint16_t port, int32_t timeoutMs) {
+    stop();
+    _remote = ip;
+    _remotePort = port;
+    const bool loopback = ip == IPAddress(127, 0, 0, 1);
+    if (!WiFi.isConnected() && !loopback) return 0;
+
+    bool known = false;
+    if (sim::radio().connectHost(ip, port, timeoutMs, known)) {
+        _simulated = true;
+    } else if (known) {
+        return 0;
+    } else if (!loopback) {
+        // Unknown host on the simulated network: the SYN goes unanswered.
+        sim::advanceMs(timeoutMs);
+        return 0;
+    } else if (!connectReal(ip, sim::deviceListening(port) ? sim::hostPortFor(port) : port)) {
+        return 0;
+    }
+    _rxBuf = sim::heapAlloc(kClientRxBufBytes);
+    return 1;
+}
+
+int WiFiClient::connect(const char* host, uint16_t port) { return connect(host, port, 3000); }
+
+int WiFiClient::connect(const char* host, uint16_t port, int32_t timeoutMs) {
+    IPAddress ip;
+    if (!WiFi.hostByName(host, ip)) return 0;
+    return connect(ip, port, timeoutMs);
+}
+
+int WiFiClient::connectReal(uint32_t ip, uint16_t port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return 0;
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = ip;
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        ::close(fd);
+        sim::advanceMs(1);
+        return 0;
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    _fd = fd;
+    return 1;
+}
+
+void WiFiClient::stop() {
+    if (_fd >= 0) ::close(_fd);
+    _fd = -1;
+    _simulated = false;
+    _peeked = -1;
+    sim::heapFree(_rxBuf);
+    _rxBuf = nullptr;
+}
+
+uint8_t WiFiClient::connected() {
+    if (_simulated) return 1;
+    if (_fd < 0) return 0;
+    char c;
+    ssize_t n = recv(_fd, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+    if (n == 0) return _peeked >= 0 ? 1 : 0;
+    if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) return 0;
+    return 1;
+}
+
+size_t WiFiClient::write(uint8_t c) { return write(&c, 1); }
+
+size_t WiFiClient::write(const uint8_t* buffer, size_t size) {
+    if (_simulated) return size;
+    if (_fd < 0) return 0;
+    size_t sent = 0;
+    while (sent < size) {
+        ssize_t n = send(_fd, buffer + sent, size - sent, MSG_NOSIGNAL);
+        if (n <= 0) break;
+        sent += static_cast<size_t>(n);
+    }
+    return sent;
+}
+
+int WiFiClient::available() {
+    if (_fd < 0) return _peeked >= 0 ? 1 : 0;
+    int extra = _peeked >= 0 ? 1 : 0;
+    char buf[512];
+    ssize_t n = recv(_fd, buf, sizeof(buf), MSG_PEEK | MSG_DONTWAIT);
+    if (n <= 0 && !extra) {
+        waitReadable(_fd);
+        n = recv(_fd, buf, sizeof(buf), MSG_PEEK | MSG_DONTWAIT);
+    }
+    return (n > 0 ? static_cast<int>(n) : 0) + extra;
+}
+
+int WiFiClient::read() {
+    if (_peeked >= 0) {
+        int c = _peeked;
+        _peeked = -1;
+        return c;
+    }
+    if (_fd < 0) return -1;
+    uint8_t c;
+    ssize_t n = recv(_fd, &c, 1, MSG_DONTWAIT);
+    return n == 1 ? c : -1;
+}
+
+int WiFiClient::read(uint8_t* buffer, size_t size) {
+    if (size == 0) return 0;
+    size_t got = 0;
+    if (_peeked >= 0) {
+        buffer[got++] = static_cast<uint8_t>(_peeked);
+        _peeked = -1;
+    }
+    if (_fd < 0) return got ? static_cast<int>(got) : -1;
+    ssize_t n = recv(_fd, buffer + got, size - got, MSG_DONTWAIT);
+    if (n > 0) got += static_cast<size_t>(n);
+    return got ? static_cast<int>(got) : -1;
+}
+
+int WiFiClient::peek() {
+    if (_peeked < 0) _peeked = read();
+    return _peeked;
+}
+
+// ============================================================
+// WiFiServer
+// ============================================================
+
+WiFiServer::WiFiServer(uint16_t port, uint8_t maxClients) : _port(port), _listenFd(-1), _waitingFd(-1) {
+    (void)maxClients;
+}
+
+WiFiServer::~WiFiServer() { end(); }
+
+void WiFiServer::begin(uint16_t port) {
+    end();
+    if (port) _port = port;
+    uint16_t hostPort = sim::hostPortFor(_port);
+    if (!hostPort) return;  // listening disabled for this run
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) return;
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(hostPort);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(fd, 8) != 0) {
+        fprintf(stderr, "[sim] WiFiServer: cannot listen on 127.0.0.1:%u (%s)\n", hostPort, strerror(errno));
+        ::close(fd);
+        return;
+    }
+    _listenFd = fd;
+    sim::addDeviceListener(_port);
+}
+
+void WiFiServer::end() {
+    if (_waitingFd >= 0) ::close(_waitingFd);
+    if (_listenFd >= 0) {
+        ::close(_listenFd);
+        sim::removeDeviceListener(_port);
+    }
+    _waitingFd = _listenFd = -1;
+}
+
+bool WiFiServer::hasClient() {
+    if (_waitingFd < 0 && _listenFd >= 0) _waitingFd = accept4(_listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+    return _waitingFd >= 0;
+}
+
+WiFiClient WiFiServer::available() {
+    if (!hasClient()) return WiFiClient();
+    int fd = _waitingFd;
+    _waitingFd = -1;
+    sim::radio().waitForRx();
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return WiFiClient(fd);
+}
+
+// ============================================================
+// WiFiClientSecure
+// ============================================================
+
+WiFiClientSecure::WiFiClientSecure() {}
+
+WiFiClientSecure::~WiFiClientSecure() { closeSession(); }
+
+int WiFiClientSecure::connect(IPAddress ip, uint16_t port) { return connect(ip, port, 3000); }
+
+int WiFiClientSecure::connect(IPAddress ip, uint16_t port, int32_t timeoutMs) {
+    (void)timeoutMs;
+    closeSession();
+    _remote = ip;
+    _remotePort = port;
+    return openSession() ? 1 : 0;
+}
+
+int WiFiClientSecure::connect(const char* host, uint16_t port) { return connect(host, port, 3000); }
+
+int WiFiClientSecure::connect(const char* host, uint16_t port, int32_t timeoutMs) {
+    closeSession();
+    IPAddress ip;
+    if (!WiFi.hostByName(host, ip)) return 0;
+    return connect(ip, port, timeoutMs);
+}
+
+bool WiFiClientSecure::openSession() {
+    if (!WiFi.isConnected()) return false;
+    sim::Webhook& hook = sim::webhook();
+    sim::advanceMs(hook.rttMs());  // TCP handshake
+
+    void* handshake = nullptr;
+    {
+        sim::StackScope stack;
+        _sslContext = sim::heapAlloc(kSslContextBytes);
+        _inRecord = _sslContext ? sim::heapAlloc(kInRecordBytes) : nullptr;
+        _outRecord = _inRecord ? sim::heapAlloc(kOutRecordBytes) : nullptr;
+        handshake = _outRecord ? sim::heapAlloc(kHandshakeBytes) : nullptr;
+    }
+    if (!handshake) {
+        fprintf(stderr, "[sim] TLS: out of memory for the handshake (free %u, largest block %u)\n",
+                static_cast<unsigned>(sim::heapStats().free), static_cast<unsigned>(sim::heapStats().largestFree));
+        sim::counter(sim::kCounterTlsFailures)++;
+        closeSession();
+        return false;
+    }
+    sim::advanceMs(2 * hook.rttMs() + kHandshakeCryptoMs);
+    sim::heapFree(handshake);
+    sim::counter(sim::kCounterTlsHandshakes)++;
+
+    // A loopback destination is a local service (e.g. an MQTT broker): after the
+    // modelled handshake the bytes go to it unencrypted and are not framed as HTTP.
+    _passthrough = _remote == IPAddress(127, 0, 0, 1);
+    if (_passthrough) {
+        _model = false;
+        if (!connectReal(_remote, _remotePort)) {
+            closeSession();
+            return false;
+        }
+        _session = true;
+        return true;
+    }
+    _model = !hook.hasStandIn();
+    if (!_model && !connectReal(hook.standInIp(), hook.standInPort())) {
+        fprintf(stderr, "[sim] TLS: webhook stand-in is not reachable\n");
+        closeSession();
+        return false;
+    }
+    _session = true;
+    return true;
+}
+
+void WiFiClientSecure::closeSession() {
+    WiFiClient::stop();
+    sim::heapFree(_sslContext);
+    sim::heapFree(_inRecord);
+    sim::heapFree(_outRecord);
+    _sslContext = _inRecord = _outRecord = nullptr;
+    _session = false;
+    _passthrough = false;
+    _peerClosed = false;
+    _wantStatus = false;
+    sim::HostScope host;
+    _tx.clear();
+    _rx.clear();
+    _rxPos = 0;
+    _statusLine.clear();
+}
+
+void WiFiClientSecure::stop() { closeSession(); }
+
+uint8_t WiFiClientSecure::connected() {
+    if (!_session || !WiFi.isConnected()) return 0;
+    if (!_model) return WiFiClient::connected();
+    return !_peerClosed || _rxPos < _rx.size();
+}
+
+size_t WiFiClientSecure::write(const uint8_t* buffer, size_t size) {
+    if (!connected()) return 0;
+    size_t n = size;
+    if (!_model) n = WiFiClient::write(buffer, size);
+    if (!_passthrough) onRequestBytes(buffer, n);
+    return n;
+}
+
+int WiFiClientSecure::available() {
+    if (!_session) return 0;
+    if (!_model) return WiFiClient::available();
+    if (sim::nowUs() < _rxReadyUs) return 0;
+    return static_cast<int>(_rx.size() - _rxPos);
+}
+
+int WiFiClientSecure::read() {
+    uint8_t c;
+    return read(&c, 1) == 1 ? c : -1;
+}
+
+int WiFiClientSecure::read(uint8_t* buffer, size_t size) {
+    if (!_session) return -1;
+    if (!_model) {
+        int n = WiFiClient::read(buffer, size);
+        if (n > 0 && !_passthrough) onResponseBytes(buffer, n);
+        return n;
+    }
+    int avail = available();
+    if (avail <= 0) return -1;
+    size_t n = std::min(size, static_cast<size_t>(avail));
+    memcpy(buffer, _rx.data() + _rxPos, n);
+    _rxPos += n;
+    return static_cast<int>(n);
+}
+
+int WiFiClientSecure::peek() {
+    if (!_model) return WiFiClient::peek();
+    return available() > 0 ? static_cast<uint8_t>(_rx[_rxPos]) : -1;
+}
+
+// Frames outgoing HTTP/1.1 requests (Content-Length or chunked bodies) so
+// each complete request is counted and, in-process, answered by the webhook
+// model. Chunked bodies are passed on de-chunked, with a Content-Length.
+void WiFiClientSecure::onRequestBytes(const uint8_t* data, size_t len) {
+    sim::HostScope host;
+    _tx.append(reinterpret_cast<const char*>(data), len);
+    for (;;) {
+        size_t headEnd = _tx.find("\r\n\r\n");
+        if (headEnd == std::string::npos) return;
+        std::string head = _tx.substr(0, headEnd + 2);
+        std::string request;
+        size_t total;
+        if (headerValue(head, "transfer-encoding:").find("chunked") != std::string::npos) {
+            std::string body;
+            size_t pos = headEnd + 4;
+            bool complete = false;
+            for (;;) {
+                size_t lineEnd = _tx.find("\r\n", pos);
+                if (lineEnd == std::string::npos) break;
+                size_t size = strtoul(_tx.c_str() + pos, nullptr, 16);
+                if (size == 0) {
+                    if (_tx.size() < lineEnd + 4) break;  // empty trailer
+                    pos = lineEnd + 4;
+                    complete = true;
+                    break;
+                }
+                if (_tx.size() < lineEnd + 2 + size + 2) break;
+                body.append(_tx, lineEnd + 2, size);
+                pos = lineEnd + 2 + size + 2;
+            }
+            if (!complete) return;
+            total = pos;
+            char length[40];
+            snprintf(length, sizeof(length), "Content-Length: %u\r\n\r\n", static_cast<unsigned>(body.size()));
+            request = head + length + body;
+        } else {
+            size_t bodyLen = strtoul(headerValue(head, "content-length:").c_str(), nullptr, 10);
+            total = headEnd + 4 + bodyLen;
+            if (_tx.size() < total) return;
+            request = _tx.substr(0, total);
+        }
+        _tx.erase(0, total);
+        sim::counter(sim::kCounterRequests)++;
+        sim::counter(sim::kCounterBytesOut) += total;
+        _wantStatus = true;
+        _statusLine.clear();
+        if (!_model) continue;
+
+        uint32_t latencyMs = 0;
+        std::string response = sim::webhook().respond(request, latencyMs);
+        _rx.erase(0, _rxPos);
+        _rxPos = 0;
+        _rx += response;
+        _rxReadyUs = sim::nowUs() + (static_cast<uint64_t>(sim::webhook().rttMs()) + latencyMs) * 1000ULL;
+        size_t respHeadEnd = response.find("\r\n\r\n");
+        std::string connection = headerValue(response.substr(0, respHeadEnd + 2), "connection:");
+        _peerClosed = connection.find("close") != std::string::npos;
+        onResponseBytes(reinterpret_cast<const uint8_t*>(response.data()), response.size());
+    }
+}
+
+// Picks the status code out of the response status line.
+void WiFiClientSecure::onResponseBytes(const uint8_t* data, size_t len) {
+    if (!_wantStatus) return;
+    sim::HostScope host;
+    for (size_t i = 0; i < len && _wantStatus; ++i) {
+        if (data[i] == '\n') {
+            _wantStatus = false;
+            const char* sp = strchr(_statusLine.c_str(), ' ');
+            countResponse(sp ? atoi(sp + 1) : 0);
+        } else if (_statusLine.size() < 64) {
+            _statusLine += static_cast<char>(data[i]);
+        }
+    }
+}
+
+// ============================================================
+// lwip sockets (TCP probes)
+// ============================================================
+
+namespace {
+
+constexpr int kLwipSocketOffset = 54;  // LWIP_SOCKET_OFFSET on the ESP32
+constexpr int kLwipMaxSockets = 10;    // CONFIG_LWIP_MAX_SOCKETS
+
+struct ProbeSocket {
+    bool used;
+    bool nonBlocking;
+    bool connecting;
+    uint32_t ip;
+    uint16_t port;
+    int soError;
+};
+
+ProbeSocket gSockets[kLwipMaxSockets];
+
+ProbeSocket* probeSocket(int s) {
+    int i = s - kLwipSocketOffset;
+    if (i < 0 || i >= kLwipMaxSockets || !gSockets[i].used) return nullptr;
+    return &gSockets[i];
+}
+
+// Resolves a pending connect against the radio's host table. Returns false
+// when the SYN would go unanswered.
+bool resolveConnect(ProbeSocket& sock, uint32_t timeoutMs) {
+    bool known = false;
+    bool open = sim::radio().connectHost(sock.ip, sock.port, timeoutMs, known);
+    if (!known) return false;
+    sock.connecting = false;
+    sock.soError = open ? 0 : (WiFi.isConnected() ? ECONNREFUSED : EHOSTUNREACH);
+    return true;
+}
+
+} // namespace
+
+int lwip_socket(int domain, int type, int protocol) {
+    (void)protocol;
+    if (domain != AF_INET || type != SOCK_STREAM) {
+        errno = EINVAL;
+        return -1;
+    }
+    for (int i = 0; i < kLwipMaxSockets; ++i) {
+        if (!gSockets[i].used) {
+            gSockets[i] = ProbeSocket{true, false, false, 0, 0, 0};
+            return kLwipSocketOffset + i;
+        }
+    }
+    errno = ENFILE;
+    return -1;
+}
+
+int lwip_fcntl(int s, int cmd, int val) {
+    ProbeSocket* sock = probeSocket(s);
+    if (!sock) {
+        errno = EBADF;
+        return -1;
+    }
+    if (cmd == F_GETFL) return sock->nonBlocking ? O_NONBLOCK : 0;
+    if (cmd == F_SETFL) {
+        sock->nonBlocking = (val & O_NONBLOCK) != 0;
+        return 0;
+    }
+    errno = EINVAL;
+    return -1;
+}
+
+int lwip_connect(int s, const struct sockaddr* name, socklen_t namelen) {
+    ProbeSocket* sock = probeSocket(s);
+    if (!sock || namelen < sizeof(sockaddr_in)) {
+        errno = EBADF;
+        return -1;
+    }
+    const sockaddr_in* addr = reinterpret_cast<const sockaddr_in*>(name);
+    sock->ip = addr->sin_addr.s_addr;
+    sock->port = ntohs(addr->sin_port);
+    if (!WiFi.isConnected()) {
+        errno = EHOSTUNREACH;
+        return -1;
+    }
+    sock->connecting = true;
+    if (sock->nonBlocking) {
+        errno = EINPROGRESS;
+        return -1;
+    }
+    // Blocking connect: lwIP gives up after its SYN retries.
+    if (!resolveConnect(*sock, 18000)) {
+        sim::advanceMs(18000);
+        errno = ETIMEDOUT;
+        return -1;
+    }
+    if (sock->soError) {
+        errno = sock->soError;
+        return -1;
+    }
+    return 0;
+}
+
+int lwip_select(int maxfdp1, fd_set* readset, fd_set* writeset, fd_set* exceptset, struct timeval* timeout) {
+    (void)exceptset;
+    uint32_t timeoutMs = timeout ? static_cast<uint32_t>(timeout->tv_sec * 1000 + timeout->tv_usec / 1000) : 18000;
+    fd_set ready;
+    FD_ZERO(&ready);
+    int count = 0;
+    bool waited = false;
+    for (int fd = kLwipSocketOffset; fd < maxfdp1 && fd < kLwipSocketOffset + kLwipMaxSockets; ++fd) {
+        if (!writeset || !FD_ISSET(fd, writeset)) continue;
+        ProbeSocket* sock = probeSocket(fd);
+        if (!sock) continue;
+        if (sock->connecting && !resolveConnect(*sock, timeoutMs)) {
+            if (!waited) sim::advanceMs(timeoutMs);  // all pending probes share the wait
+            waited = true;
+            continue;
+        }
+        FD_SET(fd, &ready);
+        count++;
+    }
+    if (readset) FD_ZERO(readset);
+    if (writeset) *writeset = ready;
+    return count;
+}
+
+int lwip_getsockopt(int s, int level, int optname, void* optval, socklen_t* optlen) {
+    ProbeSocket* sock = probeSocket(s);
+    if (!sock) {
+        errno = EBADF;
+        return -1;
+    }
+    if (level == SOL_SOCKET && optname == SO_ERROR && optval && optlen && *optlen >= sizeof(int)) {
+        *static_cast<int*>(optval) = sock->soError;
+        *optlen = sizeof(int);
+        return 0;
+    }
+    errno = ENOPROTOOPT;
+    return -1;
+}
+
+int lwip_close(int s) {
+    ProbeSocket* sock = probeSocket(s);
+    if (!sock) {
+        errno = EBADF;
+        return -1;
+    }
+    sock->used = false;
+    return 0;
+}
+
+// ============================================================
+// HTTPClient
+// ============================================================
+
+HTTPClient::HTTPClient()
+    : _client(nullptr), _ownedClient(nullptr), _began(false), _reuse(true), _timeoutMs(5000),
+      _connectTimeoutMs(5000) {}
+
+HTTPClient::~HTTPClient() {
+    end();
+}
+
+bool HTTPClient::begin(WiFiClient& client, const String& url) {
+    sim::HostScope host;
+    _client = &client;
+    _url = url.c_str();
+    _began = _url.compare(0, 7, "http://") == 0 || _url.compare(0, 8, "https://") == 0;
+    return _began;
+}
+
+bool HTTPClient::begin(const String& url) {
+    sim::HostScope host;
+    std::string u = url.c_str();
+    if (u.compare(0, 8, "https://") == 0) return false;  // the core needs a WiFiClientSecure for https
+    delete _ownedClient;
+    _ownedClient = new WiFiClient();
+    return begin(*_ownedClient, url);
+}
+
+void HTTPClient::end() {
+    if (_client) _client->stop();
+    sim::HostScope host;
+    delete _ownedClient;
+    _ownedClient = nullptr;
+    _client = nullptr;
+    _headers.clear();
+    _response.clear();
+    _responseHeaders.clear();
+    _began = false;
+}
+
+bool HTTPClient::connected() { return _client && _client->connected(); }
+
+void HTTPClient::addHeader(const String& name, const String& value, bool first, bool replace) {
+    (void)replace;
+    sim::HostScope host;
+    std::pair<std::string, std::string> h(name.c_str(), value.c_str());
+    if (first) _headers.insert(_headers.begin(), h);
+    else _headers.push_back(h);
+}
+
+void HTTPClient::collectHeaders(const char* headerKeys[], const size_t headerKeysCount) {
+    sim::HostScope host;
+    _collect.clear();
+    for (size_t i = 0; i < headerKeysCount; ++i) _collect.push_back(headerKeys[i]);
+}
+
+String HTTPClient::header(const char* name) {
+    for (const auto& h : _responseHeaders) {
+        if (strcasecmp(h.first.c_str(), name) == 0) return String(h.second.c_str());
+    }
+    return String();
+}
+
+bool HTTPClient::hasHeader(const char* name) {
+    for (const auto& h : _responseHeaders) {
+        if (strcasecmp(h.first.c_str(), name) == 0) return true;
+    }
+    return false;
+}
+
+int HTTPClient::GET() { return sendRequest("GET"); }
+int HTTPClient::POST(const String& payload) { return sendRequest("POST", payload); }
+int HTTPClient::POST(uint8_t* payload, size_t size) { return sendRequest("POST", payload, size); }
+int HTTPClient::PATCH(const String& payload) { return sendRequest("PATCH", payload); }
+int HTTPClient::PATCH(uint8_t* payload, size_t size) { return sendRequest("PATCH", payload, size); }
+int HTTPClient::PUT(const String& payload) { return sendRequest("PUT", payload); }
+
+int HTTPClient::sendRequest(const char* type, const String& payload) {
+    return sendRequest(type, reinterpret_cast<uint8_t*>(const_cast<char*>(payload.c_str())), payload.length());
+}
+
+int HTTPClient::sendRequest(const char* type, uint8_t* payload, size_t size) {
+    if (!_began || !_client) return HTTPC_ERROR_NOT_CONNECTED;
+
+    std::string hostName, path, request;
+    uint16_t port;
+    {
+        sim::HostScope host;
+        bool https = _url.compare(0, 8, "https://") == 0;
+        size_t start = https ? 8 : 7;
+        size_t slash = _url.find('/', start);
+        std::string authority = _url.substr(start, slash == std::string::npos ? std::string::npos : slash - start);
+        path = slash == std::string::npos ? "/" : _url.substr(slash);
+        port = https ? 443 : 80;
+        size_t colon = authority.find(':');
+        hostName = authority.substr(0, colon);
+        if (colon != std::string::npos) port = static_cast<uint16_t>(atoi(authority.c_str() + colon + 1));
+
+        request = std::string(type) + " " + path + " HTTP/1.1\r\nHost: " + hostName + "\r\n";
+        for (const auto& h : _headers) request += h.first + ": " + h.second + "\r\n";
+        request += "User-Agent: ESP32HTTPClient\r\nConnection: " + std::string(_reuse ? "keep-alive" : "close") +
+                   "\r\n";
+        if (payload && size) request += "Content-Length: " + std::to_string(size) + "\r\n";
+        request += "\r\n";
+    }
+
+    if (!_client->connected() && !_client->connect(hostName.c_str(), port, _connectTimeoutMs)) {
+        return HTTPC_ERROR_CONNECTION_REFUSED;
+    }
+    if (_client->write(reinterpret_cast<const uint8_t*>(request.data()), request.size()) != request.size()) {
+        return HTTPC_ERROR_SEND_HEADER_FAILED;
+    }
+    if (payload && size && _client->write(payload, size) != size) return HTTPC_ERROR_SEND_PAYLOAD_FAILED;
+
+    // Read the whole response (status line, headers, Content-Length / chunked / close body).
+    sim::HostScope host;
+    std::string raw;
+    const unsigned long deadline = millis() + _timeoutMs;
+    size_t headEnd = std::string::npos;
+    long bodyLen = -1;
+    bool chunked = false;
+    for (;;) {
+        uint8_t buf[512];
+        int n = _client->available() > 0 ? _client->read(buf, sizeof(buf)) : 0;
+        if (n > 0) {
+            raw.append(reinterpret_cast<char*>(buf), n);
+        } else if (!_client->connected()) {
+            break;
+        } else if (static_cast<long>(millis() - deadline) >= 0) {
+            return HTTPC_ERROR_READ_TIMEOUT;
+        } else {
+            delay(2);
+        }
+        if (headEnd == std::string::npos && (headEnd = raw.find("\r\n\r\n")) != std::string::npos) {
+            std::string head = raw.substr(0, headEnd + 2);
+            std::string cl = headerValue(head, "content-length:");
+            if (!cl.empty()) bodyLen = atol(cl.c_str());
+            chunked = headerValue(head, "transfer-encoding:").find("chunked") != std::string::npos;
+        }
+        if (headEnd == std::string::npos) continue;
+        if (bodyLen >= 0 && raw.size() >= headEnd + 4 + static_cast<size_t>(bodyLen)) break;
+        if (chunked && raw.find("\r\n0\r\n\r\n", headEnd) != std::string::npos) break;
+    }
+    if (headEnd == std::string::npos) return HTTPC_ERROR_CONNECTION_LOST;
+
+    const char* sp = strchr(raw.c_str(), ' ');
+    int status = sp ? atoi(sp + 1) : HTTPC_ERROR_NO_HTTP_SERVER;
+    _responseHeaders.clear();
+    for (const std::string& key : _collect) {
+        std::string lower = key;
+        for (char& c : lower) c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+        lower += ":";
+        std::string v = headerValue(raw.substr(0, headEnd + 2), lower.c_str());
+        if (!v.empty()) _responseHeaders.push_back({key, v});
+    }
+
+    std::string body = raw.substr(headEnd + 4);
+    if (chunked) {
+        std::string out;
+        size_t pos = 0;
+        for (;;) {
+            size_t eol = body.find("\r\n", pos);
+            if (eol == std::string::npos) break;
+            size_t len = strtoul(body.c_str() + pos, nullptr, 16);
+            if (len == 0) break;
+            out += body.substr(eol + 2, len);
+            pos = eol + 2 + len + 2;
+        }
+        body = out;
+    } else if (bodyLen >= 0) {
+        body.resize(std::min(body.size(), static_cast<size_t>(bodyLen)));
+    }
+    _response = body;
+    if (!_reuse) _client->stop();
+    return status;
+}
+
+String HTTPClient::getString() { return String(_response.c_str()); }
+
+WiFiClient& HTTPClient::getStream() { return *_client; }
+
+String HTTPClient::errorToString(int error) {
+    switch (error) {
+        case HTTPC_ERROR_CONNECTION_REFUSED: return String("connection refused");
+        case HTTPC_ERROR_SEND_HEADER_FAILED: return String("send header failed");
+        case HTTPC_ERROR_SEND_PAYLOAD_FAILED: return String("send payload failed");
+        case HTTPC_ERROR_NOT_CONNECTED: return String("not connected");
+        case HTTPC_ERROR_CONNECTION_LOST: return String("connection lost");
+        case HTTPC_ERROR_NO_STREAM: return String("no stream");
+        case HTTPC_ERROR_NO_HTTP_SERVER: return String("no HTTP server");
+        case HTTPC_ERROR_TOO_LESS_RAM: return String("too less ram");
+        case HTTPC_ERROR_ENCODING: return String("Transfer-Encoding not supported");
+        case HTTPC_ERROR_STREAM_WRITE: return String("Stream write error");
+        case HTTPC_ERROR_READ_TIMEOUT: return String("read Timeout");
+        default: return String();
+    }
+}
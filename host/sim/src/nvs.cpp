@@ -0,0 +1,387 @@
+/**
+ * nvs.cpp (host simulator)
+ * Non-volatile storage for nvs_* and Preferences. Keeps the NVS rules that
+ * bite on the device: 15 character namespace and key names, typed entries (a
+ * get with another type does not find the key), a read-only open of a
+ * namespace that was never written fails, and a fixed number of 32-byte
+ * entries in the 20 KB default partition, one page of which stays free for
+ * garbage collection.
+ */
+
+#include "nvs.h"
+#include "sim_host.h"
+
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr size_t kPageEntries = 126;
+constexpr size_t kTotalEntries = 5 * kPageEntries;  // 0x5000 partition, 4 KB pages
+constexpr size_t kUsableEntries = kTotalEntries - kPageEntries;
+constexpr size_t kEntryBytes = 32;
+constexpr size_t kMaxStrLen = 4000;  // terminator included
+constexpr uint8_t kNamespaceMarker = 0;
+
+struct Item {
+    std::string ns;
+    std::string key;  // empty for the namespace marker
+    uint8_t type;
+    std::string data;
+};
+
+struct Handle {
+    std::string ns;
+    bool readOnly;
+};
+
+std::map<nvs_handle_t, Handle> gHandles;
+nvs_handle_t gNextHandle = 1;
+
+size_t entriesOf(const Item& item) {
+    size_t spans = (item.data.size() + kEntryBytes - 1) / kEntryBytes;
+    switch (item.type) {
+        case NVS_TYPE_STR:
+            return 1 + spans;
+        case NVS_TYPE_BLOB:
+            return 2 + spans;  // blob index + data chunk header
+        default:
+            return 1;
+    }
+}
+
+std::vector<Item> load() {
+    sim::NvsImage img = sim::nvsImage();
+    std::vector<Item> items;
+    size_t at = 0;
+    while (at < *img.length) {
+        Item item;
+        uint8_t len = img.data[at++];
+        item.ns.assign(reinterpret_cast<const char*>(img.data + at), len);
+        at += len;
+        len = img.data[at++];
+        item.key.assign(reinterpret_cast<const char*>(img.data + at), len);
+        at += len;
+        item.type = img.data[at++];
+        uint32_t size;
+        memcpy(&size, img.data + at, sizeof(size));
+        at += sizeof(size);
+        item.data.assign(reinterpret_cast<const char*>(img.data + at), size);
+        at += size;
+        items.push_back(std::move(item));
+    }
+    return items;
+}
+
+esp_err_t save(const std::vector<Item>& items) {
+    size_t entries = 0;
+    std::string out;
+    for (const Item& item : items) {
+        entries += entriesOf(item);
+        out += static_cast<char>(item.ns.size());
+        out += item.ns;
+        out += static_cast<char>(item.key.size());
+        out += item.key;
+        out += static_cast<char>(item.type);
+        uint32_t size = static_cast<uint32_t>(item.data.size());
+        out.append(reinterpret_cast<const char*>(&size), sizeof(size));
+        out += item.data;
+    }
+    sim::NvsImage img = sim::nvsImage();
+    if (entries > kUsableEntries || out.size() > img.capacity) return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+    memcpy(img.data, out.data(), out.size());
+    *img.length = static_cast<uint32_t>(out.size());
+    return ESP_OK;
+}
+
+bool validName(const char* name) {
+    return name && name[0] && strlen(name) < NVS_KEY_NAME_MAX_SIZE;
+}
+
+Item* find(std::vector<Item>& items, const std::string& ns, const char* key) {
+    for (Item& item : items) {
+        if (item.type != kNamespaceMarker && item.ns == ns && item.key == key) return &item;
+    }
+    return nullptr;
+}
+
+esp_err_t setItem(nvs_handle_t handle, const char* key, uint8_t type, const void* data, size_t size) {
+    sim::HostScope host;
+    auto h = gHandles.find(handle);
+    if (h == gHandles.end()) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (h->second.readOnly) return ESP_ERR_NVS_READ_ONLY;
+    if (!key || !key[0]) return ESP_ERR_NVS_INVALID_NAME;
+    if (strlen(key) >= NVS_KEY_NAME_MAX_SIZE) return ESP_ERR_NVS_KEY_TOO_LONG;
+    std::vector<Item> items = load();
+    // Writing a key with another type replaces it.
+    Item* item = find(items, h->second.ns, key);
+    if (!item) {
+        items.push_back(Item{h->second.ns, key, type, ""});
+        item = &items.back();
+    }
+    item->type = type;
+    item->data.assign(static_cast<const char*>(data), size);
+    return save(items);
+}
+
+esp_err_t getItem(nvs_handle_t handle, const char* key, uint8_t type, std::string& data) {
+    sim::HostScope host;
+    auto h = gHandles.find(handle);
+    if (h == gHandles.end()) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (!validName(key)) return ESP_ERR_NVS_NOT_FOUND;
+    std::vector<Item> items = load();
+    Item* item = find(items, h->second.ns, key);
+    if (!item || item->type != type) return ESP_ERR_NVS_NOT_FOUND;
+    data = item->data;
+    return ESP_OK;
+}
+
+template <typename T>
+esp_err_t getValue(nvs_handle_t handle, const char* key, uint8_t type, T* out) {
+    std::string data;
+    esp_err_t err = getItem(handle, key, type, data);
+    if (err == ESP_OK) memcpy(out, data.data(), sizeof(T));
+    return err;
+}
+
+esp_err_t getVariable(nvs_handle_t handle, const char* key, uint8_t type, void* out, size_t* length) {
+    sim::HostScope host;
+    if (!length) return ESP_ERR_INVALID_ARG;
+    std::string data;
+    esp_err_t err = getItem(handle, key, type, data);
+    if (err != ESP_OK) return err;
+    if (!out) {
+        *length = data.size();
+        return ESP_OK;
+    }
+    if (*length < data.size()) {
+        *length = data.size();
+        return ESP_ERR_NVS_INVALID_LENGTH;
+    }
+    memcpy(out, data.data(), data.size());
+    *length = data.size();
+    return ESP_OK;
+}
+
+} // namespace
+
+esp_err_t nvs_open(const char* name, nvs_open_mode_t open_mode, nvs_handle_t* out_handle) {
+    return nvs_open_from_partition(NVS_DEFAULT_PART_NAME, name, open_mode, out_handle);
+}
+
+esp_err_t nvs_open_from_partition(const char* part_name, const char* name, nvs_open_mode_t open_mode,
+                                  nvs_handle_t* out_handle) {
+    sim::HostScope host;
+    if (!part_name || strcmp(part_name, NVS_DEFAULT_PART_NAME) != 0) return ESP_ERR_NVS_NOT_INITIALIZED;
+    if (!validName(name)) return ESP_ERR_NVS_INVALID_NAME;
+    std::vector<Item> items = load();
+    bool known = false;
+    for (const Item& item : items) {
+        if (item.type == kNamespaceMarker && item.ns == name) known = true;
+    }
+    if (!known) {
+        if (open_mode == NVS_READONLY) return ESP_ERR_NVS_NOT_FOUND;
+        items.push_back(Item{name, "", kNamespaceMarker, ""});
+        esp_err_t err = save(items);
+        if (err != ESP_OK) return err;
+    }
+    nvs_handle_t handle = gNextHandle++;
+    gHandles[handle] = Handle{name, open_mode == NVS_READONLY};
+    *out_handle = handle;
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t handle) {
+    sim::HostScope host;
+    gHandles.erase(handle);
+}
+
+esp_err_t nvs_set_i8(nvs_handle_t handle, const char* key, int8_t value) {
+    return setItem(handle, key, NVS_TYPE_I8, &value, sizeof(value));
+}
+esp_err_t nvs_set_u8(nvs_handle_t handle, const char* key, uint8_t value) {
+    return setItem(handle, key, NVS_TYPE_U8, &value, sizeof(value));
+}
+esp_err_t nvs_set_i16(nvs_handle_t handle, const char* key, int16_t value) {
+    return setItem(handle, key, NVS_TYPE_I16, &value, sizeof(value));
+}
+esp_err_t nvs_set_u16(nvs_handle_t handle, const char* key, uint16_t value) {
+    return setItem(handle, key, NVS_TYPE_U16, &value, sizeof(value));
+}
+esp_err_t nvs_set_i32(nvs_handle_t handle, const char* key, int32_t value) {
+    return setItem(handle, key, NVS_TYPE_I32, &value, sizeof(value));
+}
+esp_err_t nvs_set_u32(nvs_handle_t handle, const char* key, uint32_t value) {
+    return setItem(handle, key, NVS_TYPE_U32, &value, sizeof(value));
+}
+esp_err_t nvs_set_i64(nvs_handle_t handle, const char* key, int64_t value) {
+    return setItem(handle, key, NVS_TYPE_I64, &value, sizeof(value));
+}
+esp_err_t nvs_set_u64(nvs_handle_t handle, const char* key, uint64_t value) {
+    return setItem(handle, key, NVS_TYPE_U64, &value, sizeof(value));
+}
+
+esp_err_t nvs_set_str(nvs_handle_t handle, const char* key, const char* value) {
+    size_t size = strlen(value) + 1;
+    if (size > kMaxStrLen) return ESP_ERR_NVS_VALUE_TOO_LONG;
+    return setItem(handle, key, NVS_TYPE_STR, value, size);
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char* key, const void* value, size_t length) {
+    return setItem(handle, key, NVS_TYPE_BLOB, value, length);
+}
+
+esp_err_t nvs_get_i8(nvs_handle_t handle, const char* key, int8_t* out_value) {
+    return getValue(handle, key, NVS_TYPE_I8, out_value);
+}
+esp_err_t nvs_get_u8(nvs_handle_t handle, const char* key, uint8_t* out_value) {
+    return getValue(handle, key, NVS_TYPE_U8, out_value);
+}
+esp_err_t nvs_get_i16(nvs_handle_t handle, const char* key, int16_t* out_value) {
+    return getValue(handle, key, NVS_TYPE_I16, out_value);
+}
+esp_err_t nvs_get_u16(nvs_handle_t handle, const char* key, uint16_t* out_value) {
+    return getValue(handle, key, NVS_TYPE_U16, out_value);
+}
+esp_err_t nvs_get_i32(nvs_handle_t handle, const char* key, int32_t* out_value) {
+    return getValue(handle, key, NVS_TYPE_I32, out_value);
+}
+esp_err_t nvs_get_u32(nvs_handle_t handle, const char* key, uint32_t* out_value) {
+    return getValue(handle, key, NVS_TYPE_U32, out_value);
+}
+esp_err_t nvs_get_i64(nvs_handle_t handle, const char* key, int64_t* out_value) {
+    return getValue(handle, key, NVS_TYPE_I64, out_value);
+}
+esp_err_t nvs_get_u64(nvs_handle_t handle, const char* key, uint64_t* out_value) {
+    return getValue(handle, key, NVS_TYPE_U64, out_value);
+}
+
+esp_err_t nvs_get_str(nvs_handle_t handle, const char* key, char* out_value, size_t* length) {
+    return getVariable(handle, key, NVS_TYPE_STR, out_value, length);
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char* key, void* out_value, size_t* length) {
+    return getVariable(handle, key, NVS_TYPE_BLOB, out_value, length);
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char* key) {
+    sim::HostScope host;
+    auto h = gHandles.find(handle);
+    if (h == gHandles.end()) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (h->second.readOnly) return ESP_ERR_NVS_READ_ONLY;
+    std::vector<Item> items = load();
+    Item* item = validName(key) ? find(items, h->second.ns, key) : nullptr;
+    if (!item) return ESP_ERR_NVS_NOT_FOUND;
+    items.erase(items.begin() + (item - items.data()));
+    return save(items);
+}
+
+esp_err_t nvs_erase_all(nvs_handle_t handle) {
+    sim::HostScope host;
+    auto h = gHandles.find(handle);
+    if (h == gHandles.end()) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (h->second.readOnly) return ESP_ERR_NVS_READ_ONLY;
+    std::vector<Item> items = load();
+    std::vector<Item> kept;
+    for (Item& item : items) {
+        if (item.type == kNamespaceMarker || item.ns != h->second.ns) kept.push_back(std::move(item));
+    }
+    return save(kept);
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle) {
+    sim::HostScope host;
+    // Writes are in the image as soon as they return.
+    return gHandles.count(handle) ? ESP_OK : ESP_ERR_NVS_INVALID_HANDLE;
+}
+
+esp_err_t nvs_get_stats(const char* part_name, nvs_stats_t* nvs_stats) {
+    sim::HostScope host;
+    if (!part_name) part_name = NVS_DEFAULT_PART_NAME;
+    if (strcmp(part_name, NVS_DEFAULT_PART_NAME) != 0) return ESP_ERR_NVS_NOT_INITIALIZED;
+    if (!nvs_stats) return ESP_ERR_INVALID_ARG;
+    std::vector<Item> items = load();
+    size_t used = 0;
+    size_t namespaces = 0;
+    for (const Item& item : items) {
+        used += entriesOf(item);
+        if (item.type == kNamespaceMarker) namespaces++;
+    }
+    nvs_stats->used_entries = used;
+    nvs_stats->free_entries = kTotalEntries - used;  // like ESP-IDF, counts the reserved page
+    nvs_stats->total_entries = kTotalEntries;
+    nvs_stats->namespace_count = namespaces;
+    return ESP_OK;
+}
+
+// Iterators own a snapshot of the matching entries, taken by nvs_entry_find().
+struct nvs_opaque_iterator_t {
+    std::vector<nvs_entry_info_t> entries;
+    size_t at;
+};
+
+nvs_iterator_t nvs_entry_find(const char* part_name, const char* namespace_name, nvs_type_t type) {
+    sim::HostScope host;
+    if (!part_name || strcmp(part_name, NVS_DEFAULT_PART_NAME) != 0) return nullptr;
+    auto* it = new nvs_opaque_iterator_t{{}, 0};
+    for (const Item& item : load()) {
+        if (item.type == kNamespaceMarker) continue;
+        if (namespace_name && item.ns != namespace_name) continue;
+        if (type != NVS_TYPE_ANY && item.type != type) continue;
+        nvs_entry_info_t info{};
+        memcpy(info.namespace_name, item.ns.c_str(), item.ns.size() + 1);
+        memcpy(info.key, item.key.c_str(), item.key.size() + 1);
+        info.type = static_cast<nvs_type_t>(item.type);
+        it->entries.push_back(info);
+    }
+    if (it->entries.empty()) {
+        delete it;
+        return nullptr;
+    }
+    return it;
+}
+
+nvs_iterator_t nvs_entry_next(nvs_iterator_t iterator) {
+    sim::HostScope host;
+    if (!iterator) return nullptr;
+    if (++iterator->at < iterator->entries.size()) return iterator;
+    delete iterator;
+    return nullptr;
+}
+
+void nvs_entry_info(nvs_iterator_t iterator, nvs_entry_info_t* out_info) {
+    *out_info = iterator->entries[iterator->at];
+}
+
+void nvs_release_iterator(nvs_iterator_t iterator) {
+    sim::HostScope host;
+    delete iterator;
+}
+
+// Lives here because most of the codes the simulated APIs return are NVS ones
+const char* esp_err_to_name(esp_err_t code) {
+    switch (code) {
+        case ESP_OK: return "ESP_OK";
+        case ESP_FAIL: return "ESP_FAIL";
+        case ESP_ERR_NO_MEM: return "ESP_ERR_NO_MEM";
+        case ESP_ERR_INVALID_ARG: return "ESP_ERR_INVALID_ARG";
+        case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+        case ESP_ERR_INVALID_SIZE: return "ESP_ERR_INVALID_SIZE";
+        case ESP_ERR_NOT_FOUND: return "ESP_ERR_NOT_FOUND";
+        case ESP_ERR_NOT_SUPPORTED: return "ESP_ERR_NOT_SUPPORTED";
+        case ESP_ERR_TIMEOUT: return "ESP_ERR_TIMEOUT";
+        case ESP_ERR_NVS_NOT_INITIALIZED: return "ESP_ERR_NVS_NOT_INITIALIZED";
+        case ESP_ERR_NVS_NOT_FOUND: return "ESP_ERR_NVS_NOT_FOUND";
+        case ESP_ERR_NVS_TYPE_MISMATCH: return "ESP_ERR_NVS_TYPE_MISMATCH";
+        case ESP_ERR_NVS_READ_ONLY: return "ESP_ERR_NVS_READ_ONLY";
+        case ESP_ERR_NVS_NOT_ENOUGH_SPACE: return "ESP_ERR_NVS_NOT_ENOUGH_SPACE";
+        case ESP_ERR_NVS_INVALID_NAME: return "ESP_ERR_NVS_INVALID_NAME";
+        case ESP_ERR_NVS_INVALID_HANDLE: return "ESP_ERR_NVS_INVALID_HANDLE";
+        case ESP_ERR_NVS_KEY_TOO_LONG: return "ESP_ERR_NVS_KEY_TOO_LONG";
+        case ESP_ERR_NVS_INVALID_LENGTH: return "ESP_ERR_NVS_INVALID_LENGTH";
+        case ESP_ERR_NVS_VALUE_TOO_LONG: return "ESP_ERR_NVS_VALUE_TOO_LONG";
+        default: return "UNKNOWN ERROR";
+    }
+}
@@ -0,0 +1,165 @@
+/**
+ * preferences.cpp (host simulator)
+ * Preferences over the nvs.h stand-in, following the Arduino-ESP32 library:
+ * puts return the bytes written (0 on failure), gets return the default when
+ * the key is missing or has another type.
+ */
+
+#include "Preferences.h"
+#include "nvs.h"
+
+#include <vector>
+
+Preferences::Preferences() : _handle(0), _started(false), _readOnly(false) {}
+
+Preferences::~Preferences() { end(); }
+
+bool Preferences::begin(const char* name, bool readOnly, const char* partition_label) {
+    if (_started) return false;
+    _readOnly = readOnly;
+    nvs_handle_t handle = 0;
+    esp_err_t err = nvs_open_from_partition(partition_label ? partition_label : NVS_DEFAULT_PART_NAME, name,
+                                            readOnly ? NVS_READONLY : NVS_READWRITE, &handle);
+    if (err != ESP_OK) return false;
+    _handle = handle;
+    _started = true;
+    return true;
+}
+
+void Preferences::end() {
+    if (!_started) return;
+    nvs_close(_handle);
+    _started = false;
+}
+
+bool Preferences::clear() {
+    if (!_started || _readOnly) return false;
+    return nvs_erase_all(_handle) == ESP_OK && nvs_commit(_handle) == ESP_OK;
+}
+
+bool Preferences::remove(const char* key) {
+    if (!_started || !key || _readOnly) return false;
+    return nvs_erase_key(_handle, key) == ESP_OK && nvs_commit(_handle) == ESP_OK;
+}
+
+#define PREFS_PUT(name, type, setter)                                                      \
+    size_t Preferences::name(const char* key, type value) {                                \
+        if (!_started || !key || _readOnly) return 0;                                      \
+        if (setter(_handle, key, value) != ESP_OK || nvs_commit(_handle) != ESP_OK) return 0; \
+        return sizeof(value);                                                              \
+    }
+
+PREFS_PUT(putChar, int8_t, nvs_set_i8)
+PREFS_PUT(putUChar, uint8_t, nvs_set_u8)
+PREFS_PUT(putShort, int16_t, nvs_set_i16)
+PREFS_PUT(putUShort, uint16_t, nvs_set_u16)
+PREFS_PUT(putInt, int32_t, nvs_set_i32)
+PREFS_PUT(putUInt, uint32_t, nvs_set_u32)
+PREFS_PUT(putLong, int32_t, nvs_set_i32)
+PREFS_PUT(putULong, uint32_t, nvs_set_u32)
+PREFS_PUT(putLong64, int64_t, nvs_set_i64)
+PREFS_PUT(putULong64, uint64_t, nvs_set_u64)
+
+#undef PREFS_PUT
+
+size_t Preferences::putBool(const char* key, bool value) { return putUChar(key, value ? 1 : 0); }
+
+size_t Preferences::putString(const char* key, const char* value) {
+    if (!_started || !key || !value || _readOnly) return 0;
+    if (nvs_set_str(_handle, key, value) != ESP_OK || nvs_commit(_handle) != ESP_OK) return 0;
+    return strlen(value);
+}
+
+size_t Preferences::putString(const char* key, const String& value) { return putString(key, value.c_str()); }
+
+size_t Preferences::putBytes(const char* key, const void* value, size_t len) {
+    if (!_started || !key || !value || !len || _readOnly) return 0;
+    if (nvs_set_blob(_handle, key, value, len) != ESP_OK || nvs_commit(_handle) != ESP_OK) return 0;
+    return len;
+}
+
+PreferenceType Preferences::getType(const char* key) {
+    if (!_started || !key || strlen(key) >= NVS_KEY_NAME_MAX_SIZE) return PT_INVALID;
+    int8_t i8;
+    uint8_t u8;
+    int16_t i16;
+    uint16_t u16;
+    int32_t i32;
+    uint32_t u32;
+    int64_t i64;
+    uint64_t u64;
+    size_t len = 0;
+    if (nvs_get_i8(_handle, key, &i8) == ESP_OK) return PT_I8;
+    if (nvs_get_u8(_handle, key, &u8) == ESP_OK) return PT_U8;
+    if (nvs_get_i16(_handle, key, &i16) == ESP_OK) return PT_I16;
+    if (nvs_get_u16(_handle, key, &u16) == ESP_OK) return PT_U16;
+    if (nvs_get_i32(_handle, key, &i32) == ESP_OK) return PT_I32;
+    if (nvs_get_u32(_handle, key, &u32) == ESP_OK) return PT_U32;
+    if (nvs_get_i64(_handle, key, &i64) == ESP_OK) return PT_I64;
+    if (nvs_get_u64(_handle, key, &u64) == ESP_OK) return PT_U64;
+    if (nvs_get_str(_handle, key, nullptr, &len) == ESP_OK) return PT_STR;
+    if (nvs_get_blob(_handle, key, nullptr, &len) == ESP_OK) return PT_BLOB;
+    return PT_INVALID;
+}
+
+bool Preferences::isKey(const char* key) { return getType(key) != PT_INVALID; }
+
+#define PREFS_GET(name, type, getter)                            \
+    type Preferences::name(const char* key, type defaultValue) { \
+        type value = defaultValue;                               \
+        if (!_started || !key) return value;                     \
+        getter(_handle, key, &value);                            \
+        return value;                                            \
+    }
+
+PREFS_GET(getChar, int8_t, nvs_get_i8)
+PREFS_GET(getUChar, uint8_t, nvs_get_u8)
+PREFS_GET(getShort, int16_t, nvs_get_i16)
+PREFS_GET(getUShort, uint16_t, nvs_get_u16)
+PREFS_GET(getInt, int32_t, nvs_get_i32)
+PREFS_GET(getUInt, uint32_t, nvs_get_u32)
+PREFS_GET(getLong, int32_t, nvs_get_i32)
+PREFS_GET(getULong, uint32_t, nvs_get_u32)
+PREFS_GET(getLong64, int64_t, nvs_get_i64)
+PREFS_GET(getULong64, uint64_t, nvs_get_u64)
+
+#undef PREFS_GET
+
+bool Preferences::getBool(const char* key, bool defaultValue) {
+    return getUChar(key, defaultValue ? 1 : 0) == 1;
+}
+
+size_t Preferences::getString(const char* key, char* value, size_t maxLen) {
+    size_t len = 0;
+    if (!_started || !key || !value || !maxLen) return 0;
+    if (nvs_get_str(_handle, key, nullptr, &len) != ESP_OK || len > maxLen) return 0;
+    if (nvs_get_str(_handle, key, value, &len) != ESP_OK) return 0;
+    return len;
+}
+
+String Preferences::getString(const char* key, String defaultValue) {
+    size_t len = 0;
+    if (!_started || !key || nvs_get_str(_handle, key, nullptr, &len) != ESP_OK) return defaultValue;
+    std::vector<char> buf(len);  // the library mallocs it from the device heap as well
+    if (nvs_get_str(_handle, key, buf.data(), &len) != ESP_OK) return defaultValue;
+    return String(buf.data());
+}
+
+size_t Preferences::getBytesLength(const char* key) {
+    size_t len = 0;
+    if (!_started || !key || nvs_get_blob(_handle, key, nullptr, &len) != ESP_OK) return 0;
+    return len;
+}
+
+size_t Preferences::getBytes(const char* key, void* buf, size_t maxLen) {
+    size_t len = getBytesLength(key);
+    if (!len || !buf || !maxLen || len > maxLen) return 0;
+    if (nvs_get_blob(_handle, key, buf, &len) != ESP_OK) return 0;
+    return len;
+}
+
+size_t Preferences::freeEntries() {
+    nvs_stats_t stats;
+    if (nvs_get_stats(nullptr, &stats) != ESP_OK) return 0;
+    return stats.free_entries;
+}
@@ -0,0 +1,263 @@
+/**
+ * scenario.cpp (host simulator)
+ * Scenario file parser; see sim_scenario.h for the format.
+ */
+
+#include "sim_scenario.h"
+#include "sim_host.h"
+#include "sim_radio.h"
+#include "sim_webhook.h"
+#include "esp_system.h"
+
+#include <sys/stat.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+namespace sim {
+
+namespace {
+
+bool parseMac(const std::string& text, uint8_t mac[6]) {
+    unsigned v[6];
+    if (sscanf(text.c_str(), "%x:%x:%x:%x:%x:%x", &v[0], &v[1], &v[2], &v[3], &v[4], &v[5]) != 6) return false;
+    for (int i = 0; i < 6; ++i) mac[i] = static_cast<uint8_t>(v[i]);
+    return true;
+}
+
+bool parseIp(const std::string& text, IPAddress& ip) {
+    return ip.fromString(text.c_str());
+}
+
+wifi_auth_mode_t parseAuth(const std::string& text) {
+    if (text == "OPEN") return WIFI_AUTH_OPEN;
+    if (text == "WEP") return WIFI_AUTH_WEP;
+    if (text == "WPA_PSK") return WIFI_AUTH_WPA_PSK;
+    if (text == "WPA_WPA2_PSK") return WIFI_AUTH_WPA_WPA2_PSK;
+    if (text == "WPA2_ENTERPRISE") return WIFI_AUTH_WPA2_ENTERPRISE;
+    if (text == "WPA3_PSK") return WIFI_AUTH_WPA3_PSK;
+    if (text == "WPA2_WPA3_PSK") return WIFI_AUTH_WPA2_WPA3_PSK;
+    return WIFI_AUTH_WPA2_PSK;
+}
+
+// esp_reset_reason_t for a "reset" line, -1 if unknown.
+int parseResetReason(const std::string& text) {
+    if (text == "poweron") return ESP_RST_POWERON;
+    if (text == "ext") return ESP_RST_EXT;
+    if (text == "panic") return ESP_RST_PANIC;
+    if (text == "int_wdt") return ESP_RST_INT_WDT;
+    if (text == "task_wdt") return ESP_RST_TASK_WDT;
+    if (text == "wdt") return ESP_RST_WDT;
+    if (text == "brownout") return ESP_RST_BROWNOUT;
+    return -1;
+}
+
+// Value of a "key=value" token, or the fallback.
+std::string option(const std::vector<std::string>& tokens, const char* key, const std::string& fallback) {
+    std::string prefix = std::string(key) + "=";
+    for (const std::string& t : tokens) {
+        if (t.compare(0, prefix.size(), prefix) == 0) return t.substr(prefix.size());
+    }
+    return fallback;
+}
+
+// "#" starts a comment at the beginning of a line or after whitespace, so
+// JSON in "file" lines may contain it.
+std::string stripComment(const std::string& line) {
+    for (size_t i = 0; i < line.size(); ++i) {
+        if (line[i] == '#' && (i == 0 || line[i - 1] == ' ' || line[i - 1] == '\t')) return line.substr(0, i);
+    }
+    return line;
+}
+
+bool writeFsFile(const std::string& path, const std::string& content, std::string& error) {
+    if (fsRoot().empty() || path.empty() || path[0] != '/') {
+        error = "file needs an absolute SPIFFS path and a filesystem root";
+        return false;
+    }
+    std::string full = fsRoot() + path;
+    for (size_t i = fsRoot().size() + 1; i < full.size(); ++i) {
+        if (full[i] == '/') mkdir(full.substr(0, i).c_str(), 0755);
+    }
+    std::ofstream out(full, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        error = "cannot write " + full;
+        return false;
+    }
+    std::string text;
+    for (size_t i = 0; i < content.size(); ++i) {
+        if (content[i] == '\\' && i + 1 < content.size() && content[i + 1] == 'n') {
+            text += '\n';
+            i++;
+        } else {
+            text += content[i];
+        }
+    }
+    out << text;
+    return true;
+}
+
+} // namespace
+
+bool parseDuration(const std::string& text, uint64_t& us) {
+    if (text.empty()) return false;
+    double total = 0;
+    const char* p = text.c_str();
+    while (*p) {
+        char* end = nullptr;
+        double v = strtod(p, &end);
+        if (end == p || v < 0) return false;
+        double scale;
+        if (strncmp(end, "ms", 2) == 0) scale = 1e3, end += 2;
+        else if (*end == 's') scale = 1e6, end++;
+        else if (*end == 'm') scale = 60e6, end++;
+        else if (*end == 'h') scale = 3600e6, end++;
+        else if (*end == 'd') scale = 86400e6, end++;
+        else if (*end == '\0' && p == text.c_str()) scale = 1e6;  // bare number = seconds
+        else return false;
+        total += v * scale;
+        p = end;
+    }
+    us = static_cast<uint64_t>(total);
+    return true;
+}
+
+bool parseSize(const std::string& text, size_t& bytes) {
+    char* end = nullptr;
+    unsigned long long v = strtoull(text.c_str(), &end, 10);
+    if (end == text.c_str()) return false;
+    if (*end == 'K' || *end == 'k') v <<= 10, end++;
+    else if (*end == 'M' || *end == 'm') v <<= 20, end++;
+    if (*end != '\0') return false;
+    bytes = static_cast<size_t>(v);
+    return true;
+}
+
+bool loadScenario(const char* path, ScenarioInfo& info, std::string& error) {
+    HostScope host;
+    std::ifstream in(path);
+    if (!in) {
+        error = std::string("cannot open ") + path;
+        return false;
+    }
+    std::string line;
+    int lineNo = 0;
+    while (std::getline(in, line)) {
+        lineNo++;
+        if (!parseScenarioLine(line, info, error)) {
+            error = std::string(path) + ":" + std::to_string(lineNo) + ": " + error;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool parseScenarioLine(const std::string& raw, ScenarioInfo& info, std::string& error) {
+    HostScope host;
+    std::string line = stripComment(raw);
+    std::istringstream ss(line);
+    std::vector<std::string> t;
+    std::string tok;
+    while (ss >> tok) t.push_back(tok);
+    if (t.empty()) return true;
+
+    Radio& r = radio();
+    const std::string& kind = t[0];
+    if (kind == "duration" && t.size() >= 2) {
+        if (!parseDuration(t[1], info.durationUs)) return error = "bad duration", false;
+    } else if (kind == "mac" && t.size() >= 2) {
+        uint8_t mac[6];
+        if (!parseMac(t[1], mac)) return error = "bad mac", false;
+        r.setBaseMac(mac);
+    } else if (kind == "psram" && t.size() >= 2) {
+        size_t bytes;
+        if (!parseSize(t[1], bytes)) return error = "bad psram size", false;
+        setPsramBytes(bytes);
+    } else if (kind == "dtim" && t.size() >= 2) {
+        const int period = atoi(t[1].c_str());
+        if (period < 1 || period > 255) return error = "bad dtim period", false;
+        r.dtimPeriod = (uint8_t)period;
+    } else if (kind == "net" && t.size() >= 5) {
+        NetConfig& n = r.net();
+        if (!parseIp(t[1], n.ip) || !parseIp(t[2], n.gateway) || !parseIp(t[3], n.mask) || !parseIp(t[4], n.dns0)) {
+            return error = "bad address in net line", false;
+        }
+        if (t.size() >= 6 && !parseIp(t[5], n.dns1)) return error = "bad dns1", false;
+    } else if (kind == "ap" && t.size() >= 6) {
+        SimAp ap;
+        ap.ssid = t[1];
+        ap.pass = t[2] == "-" ? "" : t[2];
+        if (!parseMac(t[3], ap.bssid)) return error = "bad bssid", false;
+        ap.channel = atoi(t[4].c_str());
+        ap.rssi = atoi(t[5].c_str());
+        ap.auth = ap.pass.empty() ? WIFI_AUTH_OPEN : parseAuth(option(t, "auth", "WPA2_PSK"));
+        ap.authMs = atoi(option(t, "auth_ms", "8").c_str());
+        ap.assocMs = atoi(option(t, "assoc_ms", "12").c_str());
+        ap.handshakeMs = atoi(option(t, "handshake_ms", "45").c_str());
+        ap.dhcpMs = atoi(option(t, "dhcp_ms", "900").c_str());
+        r.addAp(ap);
+    } else if (kind == "rssi" && t.size() >= 4) {
+        uint8_t bssid[6];
+        uint64_t at;
+        if (!parseMac(t[1], bssid) || !parseDuration(t[2], at)) return error = "bad rssi line", false;
+        SimAp* ap = r.findAp(bssid);
+        if (!ap) return error = "rssi for an unknown bssid (declare the ap first)", false;
+        ap->trace.push_back({at, atoi(t[3].c_str())});
+    } else if (kind == "drop" && t.size() >= 3) {
+        LinkDrop d;
+        if (!parseDuration(t[1], d.atUs) || !parseDuration(t[2], d.downUs)) return error = "bad drop line", false;
+        d.reason = t.size() >= 4 ? atoi(t[3].c_str()) : WIFI_REASON_BEACON_TIMEOUT;
+        r.addDrop(d);
+    } else if (kind == "host" && t.size() >= 2) {
+        SimHost h;
+        IPAddress ip;
+        if (!parseIp(t[1], ip)) return error = "bad host ip", false;
+        h.ip = ip;
+        h.latencyMs = atoi(option(t, "latency", "5").c_str());
+        std::istringstream ps(option(t, "open", ""));
+        std::string p;
+        while (std::getline(ps, p, ',')) {
+            if (!p.empty()) h.openPorts.push_back(static_cast<uint16_t>(atoi(p.c_str())));
+        }
+        r.addHost(h);
+    } else if (kind == "button" && t.size() >= 2) {
+        ButtonPress b;
+        if (!parseDuration(t[1], b.atUs)) return error = "bad button time", false;
+        b.pin = t.size() >= 3 ? atoi(t[2].c_str()) : 0;
+        r.addButtonPress(b);
+    } else if (kind == "reset" && t.size() >= 3) {
+        uint64_t at;
+        int reason = parseResetReason(t[2]);
+        if (!parseDuration(t[1], at) || reason < 0) return error = "bad reset line", false;
+        addReset(at, reason);
+    } else if (kind == "webhook" && t.size() >= 3) {
+        WebhookWindow w;
+        if (!parseDuration(t[1], w.fromUs) || !parseDuration(t[2], w.toUs)) return error = "bad webhook window", false;
+        w.status = atoi(option(t, "status", "0").c_str());
+        w.latencyMs = atoi(option(t, "latency", "0").c_str());
+        webhook().addWindow(w);
+    } else if (kind == "webhook_latency" && t.size() >= 2) {
+        webhook().setLatencyMs(atoi(t[1].c_str()));
+    } else if (kind == "webhook_rtt" && t.size() >= 2) {
+        webhook().setRttMs(atoi(t[1].c_str()));
+    } else if (kind == "ratelimit" && t.size() >= 3) {
+        uint64_t period;
+        if (!parseDuration(t[2], period)) return error = "bad ratelimit period", false;
+        webhook().setRateLimit(atoi(t[1].c_str()), period);
+    } else if (kind == "file" && t.size() >= 3) {
+        // Content is the rest of the raw line after the path ("\n" = newline).
+        size_t at = raw.find(t[1]) + t[1].size();
+        while (at < raw.size() && (raw[at] == ' ' || raw[at] == '\t')) at++;
+        if (!writeFsFile(t[1], raw.substr(at), error)) return false;
+    } else {
+        error = "unknown or incomplete line: " + raw;
+        return false;
+    }
+    return true;
+}
+
+} // namespace sim
@@ -0,0 +1,180 @@
+/**
+ * timer.cpp (host simulator)
+ * Hardware timer alarms on SIGPROF, and the frame-pointer unwinder the
+ * sampling profiler uses from them.
+ */
+
+#include "esp32-hal-timer.h"
+#include "esp_debug_helpers.h"
+
+#include <pthread.h>
+#include <signal.h>
+#include <sys/time.h>
+#include <ucontext.h>
+
+#include <cstring>
+
+struct hw_timer_s {
+    uint16_t divider;
+    uint64_t alarm;
+    void (*fn)(void);
+    bool enabled;
+    bool used;  // between timerBegin() and timerEnd()
+};
+
+namespace {
+
+constexpr int kTimers = 4;
+constexpr uint32_t kApbHz = 80000000;
+
+hw_timer_s gTimers[kTimers];
+hw_timer_s* gArmed = nullptr;          // the timer behind ITIMER_PROF
+const ucontext_t* gInterrupted = nullptr;  // set while an alarm runs
+uintptr_t gStackLow = 0;
+uintptr_t gStackHigh = 0;
+
+void onSigprof(int, siginfo_t*, void* context) {
+    hw_timer_s* t = gArmed;
+    if (!t || !t->fn) return;
+    gInterrupted = static_cast<const ucontext_t*>(context);
+    t->fn();
+    gInterrupted = nullptr;
+}
+
+void setInterval(uint64_t us) {
+    itimerval it{};
+    it.it_interval.tv_sec = static_cast<time_t>(us / 1000000);
+    it.it_interval.tv_usec = static_cast<suseconds_t>(us % 1000000);
+    it.it_value = it.it_interval;
+    setitimer(ITIMER_PROF, &it, nullptr);
+}
+
+// Frame pointers are only followed inside the sampled thread's stack.
+bool onStack(uintptr_t fp) {
+    return fp >= gStackLow && fp + 2 * sizeof(uintptr_t) <= gStackHigh && fp % sizeof(uintptr_t) == 0;
+}
+
+void findStack() {
+    pthread_attr_t attr;
+    if (pthread_getattr_np(pthread_self(), &attr) != 0) return;
+    void* addr = nullptr;
+    size_t size = 0;
+    pthread_attr_getstack(&attr, &addr, &size);
+    pthread_attr_destroy(&attr);
+    gStackLow = reinterpret_cast<uintptr_t>(addr);
+    gStackHigh = gStackLow + size;
+}
+
+hw_timer_s* begin(uint8_t num, uint16_t divider) {
+    if (num >= kTimers || divider == 0) return nullptr;
+    hw_timer_s* t = &gTimers[num];
+    *t = hw_timer_s{divider, 0, nullptr, false, true};
+    return t;
+}
+
+void arm(hw_timer_s* timer) {
+    if (gArmed && gArmed != timer) return;  // one ITIMER_PROF per process
+    uint64_t us = timer->alarm * timer->divider / (kApbHz / 1000000);
+    if (us == 0) us = 1;
+    findStack();
+    struct sigaction sa{};
+    sa.sa_sigaction = onSigprof;
+    sa.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGPROF, &sa, nullptr);
+    timer->enabled = true;
+    gArmed = timer;
+    setInterval(us);
+}
+
+void disarm(hw_timer_s* timer) {
+    if (!timer->enabled) return;
+    timer->enabled = false;
+    if (gArmed != timer) return;
+    setInterval(0);
+    gArmed = nullptr;
+}
+
+} // namespace
+
+void timerEnd(hw_timer_t* timer) {
+    disarm(timer);
+    timer->fn = nullptr;
+    timer->used = false;
+}
+
+void timerDetachInterrupt(hw_timer_t* timer) {
+    timer->fn = nullptr;
+}
+
+#if ESP_ARDUINO_VERSION_MAJOR >= 3
+// 3.x picks a free timer and the divider from the frequency
+hw_timer_t* timerBegin(uint32_t frequency) {
+    if (frequency == 0 || frequency > kApbHz / 2 || kApbHz / frequency > 0xffff) return nullptr;
+    for (uint8_t num = 0; num < kTimers; num++) {
+        if (!gTimers[num].used) return begin(num, kApbHz / frequency);
+    }
+    return nullptr;
+}
+
+void timerAttachInterrupt(hw_timer_t* timer, void (*fn)(void)) {
+    timer->fn = fn;
+}
+
+void timerAlarm(hw_timer_t* timer, uint64_t alarmValue, bool, uint64_t) {
+    timer->alarm = alarmValue;
+    arm(timer);
+}
+
+void timerStop(hw_timer_t* timer) {
+    disarm(timer);
+}
+#else
+hw_timer_t* timerBegin(uint8_t num, uint16_t divider, bool) {
+    return begin(num, divider);
+}
+
+void timerAttachInterrupt(hw_timer_t* timer, void (*fn)(void), bool) {
+    timer->fn = fn;
+}
+
+void timerAlarmWrite(hw_timer_t* timer, uint64_t alarmValue, bool) {
+    timer->alarm = alarmValue;
+}
+
+void timerAlarmEnable(hw_timer_t* timer) {
+    arm(timer);
+}
+
+void timerAlarmDisable(hw_timer_t* timer) {
+    disarm(timer);
+}
+#endif
+
+void esp_backtrace_get_start(uintptr_t* pc, uintptr_t* sp, uintptr_t* next_pc) {
+    *pc = *sp = *next_pc = 0;
+    if (!gInterrupted) return;
+#if defined(__linux__) && defined(__x86_64__)
+    *pc = static_cast<uintptr_t>(gInterrupted->uc_mcontext.gregs[REG_RIP]);
+    *sp = static_cast<uintptr_t>(gInterrupted->uc_mcontext.gregs[REG_RBP]);
+#elif defined(__linux__) && defined(__aarch64__)
+    *pc = static_cast<uintptr_t>(gInterrupted->uc_mcontext.pc);
+    *sp = static_cast<uintptr_t>(gInterrupted->uc_mcontext.regs[29]);
+#else
+    return;  // no unwinding on this host
+#endif
+    // Frame record: [fp] = caller's fp, [fp + 8] = return address
+    if (onStack(*sp)) *next_pc = reinterpret_cast<const uintptr_t*>(*sp)[1];
+}
+
+bool esp_backtrace_get_next_frame(esp_backtrace_frame_t* frame) {
+    if (!onStack(frame->sp)) return false;
+    const uintptr_t callerFp = reinterpret_cast<const uintptr_t*>(frame->sp)[0];
+    frame->pc = frame->next_pc;
+    frame->next_pc = 0;
+    if (callerFp > frame->sp && onStack(callerFp)) {
+        frame->next_pc = reinterpret_cast<const uintptr_t*>(callerFp)[1];
+    }
+    frame->sp = callerFp;
+    return frame->pc != 0;
+}
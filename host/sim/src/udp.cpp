@@ -0,0 +1,203 @@
+/**
+ * udp.cpp (host simulator)
+ * WiFiUDP on real host sockets; multicast between simulator processes over
+ * the loopback interface.
+ */
+
+#include "WiFiUdp.h"
+#include "WiFi.h"
+#include "sim_host.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+constexpr size_t kTxBufBytes = 1460;  // the core's tx_buffer
+constexpr size_t kMaxPacket = 1500;
+
+bool isMulticast(uint32_t ip) {
+    const uint8_t first = static_cast<uint8_t>(ip);  // first octet in the LSB
+    return first >= 224 && first <= 239;
+}
+
+int openSocket() {
+    int fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+    return fd;
+}
+
+} // namespace
+
+WiFiUDP::WiFiUDP()
+    : _fd(-1), _group(), _port(0), _tx(nullptr), _txLen(0), _txIp(0), _txPort(0), _rx(nullptr), _rxLen(0),
+      _rxPos(0), _remoteIp(), _remotePort(0) {}
+
+WiFiUDP::~WiFiUDP() { stop(); }
+
+uint8_t WiFiUDP::begin(uint16_t port) {
+    stop();
+    uint16_t hostPort = sim::hostPortFor(port);
+    if (!hostPort) return 0;
+    int fd = openSocket();
+    if (fd < 0) return 0;
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(hostPort);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        fprintf(stderr, "[sim] WiFiUDP: cannot bind 127.0.0.1:%u\n", hostPort);
+        ::close(fd);
+        return 0;
+    }
+    _fd = fd;
+    _port = port;
+    return 1;
+}
+
+uint8_t WiFiUDP::beginMulticast(IPAddress multicast, uint16_t port) {
+    stop();
+    if (!isMulticast(multicast)) return 0;
+    int fd = openSocket();
+    if (fd < 0) return 0;
+    // Bound to the group itself, so only its datagrams arrive on this socket.
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = static_cast<uint32_t>(multicast);
+    ip_mreq mreq{};
+    mreq.imr_multiaddr.s_addr = static_cast<uint32_t>(multicast);
+    mreq.imr_interface.s_addr = htonl(INADDR_LOOPBACK);
+    in_addr ifAddr{};
+    ifAddr.s_addr = htonl(INADDR_LOOPBACK);
+    unsigned char loop = 1;
+    if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) != 0 ||
+        setsockopt(fd, IPPROTO_IP, IP_MULTICAST_IF, &ifAddr, sizeof(ifAddr)) != 0 ||
+        setsockopt(fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop)) != 0) {
+        fprintf(stderr, "[sim] WiFiUDP: cannot join %s:%u on loopback\n", multicast.toString().c_str(), port);
+        ::close(fd);
+        return 0;
+    }
+    _fd = fd;
+    _group = multicast;
+    _port = port;
+    return 1;
+}
+
+void WiFiUDP::stop() {
+    if (_fd >= 0) ::close(_fd);
+    _fd = -1;
+    _group = IPAddress();
+    _port = 0;
+    if (_tx) sim::heapFree(_tx);
+    _tx = nullptr;
+    _txLen = 0;
+    dropRx();
+}
+
+int WiFiUDP::beginPacket(IPAddress ip, uint16_t port) {
+    if (!_tx) {
+        _tx = static_cast<uint8_t*>(sim::heapAlloc(kTxBufBytes));
+        if (!_tx) return 0;
+    }
+    _txLen = 0;
+    _txIp = ip;
+    _txPort = port;
+    return 1;
+}
+
+int WiFiUDP::beginPacket(const char* host, uint16_t port) {
+    IPAddress ip;
+    if (!WiFi.hostByName(host, ip)) return 0;
+    return beginPacket(ip, port);
+}
+
+int WiFiUDP::beginMulticastPacket() {
+    if (_fd < 0 || !isMulticast(_group)) return 0;
+    return beginPacket(_group, _port);
+}
+
+size_t WiFiUDP::write(uint8_t c) { return write(&c, 1); }
+
+size_t WiFiUDP::write(const uint8_t* buffer, size_t size) {
+    if (!_tx) return 0;
+    size_t n = std::min(size, kTxBufBytes - _txLen);
+    memcpy(_tx + _txLen, buffer, n);
+    _txLen += n;
+    return n;
+}
+
+int WiFiUDP::endPacket() {
+    if (!_tx) return 0;
+    const bool loopback = IPAddress(_txIp) == IPAddress(127, 0, 0, 1);
+    if (!loopback && !WiFi.isConnected()) return 0;
+    if (!loopback && !isMulticast(_txIp)) return 1;  // sent into the simulated LAN: nobody there
+    int fd = _fd >= 0 ? _fd : openSocket();
+    if (fd < 0) return 0;
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(_txPort);
+    addr.sin_addr.s_addr = _txIp;
+    if (isMulticast(_txIp) && fd != _fd) {
+        in_addr ifAddr{};
+        ifAddr.s_addr = htonl(INADDR_LOOPBACK);
+        setsockopt(fd, IPPROTO_IP, IP_MULTICAST_IF, &ifAddr, sizeof(ifAddr));
+    }
+    ssize_t sent = sendto(fd, _tx, _txLen, 0, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    if (fd != _fd) ::close(fd);
+    _txLen = 0;
+    return sent >= 0 ? 1 : 0;
+}
+
+int WiFiUDP::parsePacket() {
+    dropRx();
+    if (_fd < 0) return 0;
+    uint8_t pkt[kMaxPacket];
+    for (;;) {
+        sockaddr_in peer{};
+        socklen_t peerLen = sizeof(peer);
+        ssize_t n = recvfrom(_fd, pkt, sizeof(pkt), 0, reinterpret_cast<sockaddr*>(&peer), &peerLen);
+        if (n <= 0) return 0;
+        // Off the air while the station is not associated (loopback unicast still works)
+        if (isMulticast(_group) && !WiFi.isConnected()) continue;
+        _rx = static_cast<uint8_t*>(sim::heapAlloc(static_cast<size_t>(n)));
+        if (!_rx) return 0;  // the core drops the packet when its cbuf cannot be allocated
+        memcpy(_rx, pkt, static_cast<size_t>(n));
+        _rxLen = static_cast<size_t>(n);
+        _rxPos = 0;
+        _remoteIp = IPAddress(peer.sin_addr.s_addr);
+        _remotePort = ntohs(peer.sin_port);
+        return static_cast<int>(n);
+    }
+}
+
+int WiFiUDP::available() { return static_cast<int>(_rxLen - _rxPos); }
+
+int WiFiUDP::read() { return _rxPos < _rxLen ? _rx[_rxPos++] : -1; }
+
+int WiFiUDP::read(unsigned char* buffer, size_t len) {
+    size_t n = std::min(len, _rxLen - _rxPos);
+    if (n) memcpy(buffer, _rx + _rxPos, n);
+    _rxPos += n;
+    return static_cast<int>(n);
+}
+
+int WiFiUDP::peek() { return _rxPos < _rxLen ? _rx[_rxPos] : -1; }
+
+void WiFiUDP::flush() { dropRx(); }
+
+void WiFiUDP::dropRx() {
+    if (_rx) sim::heapFree(_rx);
+    _rx = nullptr;
+    _rxLen = _rxPos = 0;
+}
@@ -0,0 +1,264 @@
+/**
+ * webhook.cpp (host simulator)
+ * In-process model of the Discord webhook API (execute / edit message).
+ */
+
+#include "sim_webhook.h"
+#include "sim_host.h"
+
+#include <arpa/inet.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+namespace sim {
+
+namespace {
+
+constexpr size_t kMaxContentChars = 2000;  // Discord message limit
+constexpr uint64_t kFirstMessageId = 1430000000000000000ULL;
+
+// Snowflake-style ids derived from the virtual clock, so ids handed out in
+// earlier boots (each boot is a separate process) stay editable.
+uint64_t snowflakeFloor() { return kFirstMessageId + ((nowUs() / 1000) << 22); }
+
+const char* reasonPhrase(int status) {
+    switch (status) {
+        case 200: return "OK";
+        case 204: return "No Content";
+        case 400: return "Bad Request";
+        case 401: return "Unauthorized";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 429: return "Too Many Requests";
+        case 500: return "Internal Server Error";
+        case 502: return "Bad Gateway";
+        case 503: return "Service Unavailable";
+        default: return "Unknown";
+    }
+}
+
+// Body of a "Content-Encoding: gzip" request; false if it does not inflate.
+bool gunzip(const std::string& in, std::string& out) {
+    z_stream z{};
+    if (inflateInit2(&z, 16 + MAX_WBITS) != Z_OK) return false;
+    z.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in.data()));
+    z.avail_in = static_cast<uInt>(in.size());
+    int rc = Z_OK;
+    char buf[4096];
+    while (rc == Z_OK) {
+        z.next_out = reinterpret_cast<Bytef*>(buf);
+        z.avail_out = sizeof(buf);
+        rc = inflate(&z, Z_NO_FLUSH);
+        out.append(buf, sizeof(buf) - z.avail_out);
+    }
+    inflateEnd(&z);
+    return rc == Z_STREAM_END && z.avail_in == 0;
+}
+
+// Raw JSON string value (quotes included, escapes untouched) of "key", or "".
+std::string rawJsonString(const std::string& body, const char* key) {
+    std::string pattern = std::string("\"") + key + "\":\"";
+    size_t start = body.find(pattern);
+    if (start == std::string::npos) return std::string();
+    start += pattern.size() - 1;
+    for (size_t i = start + 1; i < body.size(); ++i) {
+        if (body[i] == '\\') {
+            i++;
+        } else if (body[i] == '"') {
+            return body.substr(start, i - start + 1);
+        }
+    }
+    return std::string();
+}
+
+// Characters in a raw JSON string once decoded (escapes count as one,
+// multi-byte UTF-8 sequences count as one).
+size_t decodedLength(const std::string& raw) {
+    size_t n = 0;
+    for (size_t i = 1; i + 1 < raw.size(); ++i) {
+        unsigned char c = static_cast<unsigned char>(raw[i]);
+        if (c == '\\') {
+            i += raw[i + 1] == 'u' ? 5 : 1;
+            n++;
+        } else if ((c & 0xC0) != 0x80) {
+            n++;
+        }
+    }
+    return n;
+}
+
+std::string isoTimestamp() {
+    time_t now = wallTime();
+    struct tm t;
+    gmtime_r(&now, &t);
+    char buf[40];
+    strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S.000000+00:00", &t);
+    return buf;
+}
+
+std::string httpResponse(int status, const std::string& body, const std::string& extraHeaders) {
+    char head[256];
+    snprintf(head, sizeof(head),
+             "HTTP/1.1 %d %s\r\nContent-Type: application/json\r\nContent-Length: %u\r\n"
+             "Connection: keep-alive\r\n",
+             status, reasonPhrase(status), static_cast<unsigned>(body.size()));
+    return head + extraHeaders + "\r\n" + body;
+}
+
+} // namespace
+
+Webhook& webhook() {
+    static Webhook instance;
+    return instance;
+}
+
+void Webhook::setRateLimit(uint32_t requests, uint64_t periodUs) {
+    _bucketSize = requests;
+    _bucketPeriodUs = periodUs;
+}
+
+bool Webhook::setStandIn(const std::string& url, std::string& error) {
+    if (url.compare(0, 7, "http://") != 0) {
+        error = "stand-in URL must start with http://";
+        return false;
+    }
+    std::string authority = url.substr(7, url.find('/', 7) - 7);
+    size_t colon = authority.find(':');
+    std::string hostName = authority.substr(0, colon);
+    if (hostName == "localhost") hostName = "127.0.0.1";
+    in_addr addr;
+    if (inet_pton(AF_INET, hostName.c_str(), &addr) != 1) {
+        error = "stand-in host must be an IPv4 address or localhost";
+        return false;
+    }
+    int port = colon == std::string::npos ? 80 : atoi(authority.c_str() + colon + 1);
+    if (port <= 0 || port > 65535) {
+        error = "bad stand-in port";
+        return false;
+    }
+    _standInIp = addr.s_addr;
+    _standInPort = static_cast<uint16_t>(port);
+    return true;
+}
+
+const WebhookWindow* Webhook::activeWindow() const {
+    uint64_t now = nowUs();
+    for (const WebhookWindow& w : _windows) {
+        if (now >= w.fromUs && now < w.toUs) return &w;
+    }
+    return nullptr;
+}
+
+bool Webhook::takeToken(double& retryAfterSec) {
+    if (_bucketSize == 0) return true;
+    uint64_t now = nowUs();
+    _recent.erase(std::remove_if(_recent.begin(), _recent.end(),
+                                 [&](uint64_t t) { return t + _bucketPeriodUs <= now; }),
+                  _recent.end());
+    if (_recent.size() >= _bucketSize) {
+        retryAfterSec = double(_recent.front() + _bucketPeriodUs - now) / 1e6;
+        return false;
+    }
+    _recent.push_back(now);
+    return true;
+}
+
+std::string Webhook::respond(const std::string& request, uint32_t& latencyMs) {
+    HostScope host;
+    const WebhookWindow* window = activeWindow();
+    latencyMs = window && window->latencyMs ? window->latencyMs : _latencyMs;
+
+    size_t lineEnd = request.find("\r\n");
+    size_t headEnd = request.find("\r\n\r\n");
+    std::string line = request.substr(0, lineEnd);
+    std::string method = line.substr(0, line.find(' '));
+    size_t targetStart = method.size() + 1;
+    std::string target = line.substr(targetStart, line.rfind(' ') - targetStart);
+    std::string body = headEnd == std::string::npos ? std::string() : request.substr(headEnd + 4);
+    std::string head = request.substr(0, headEnd);
+    std::transform(head.begin(), head.end(), head.begin(), [](unsigned char c) { return std::tolower(c); });
+    bool gzipped = head.find("\r\ncontent-encoding: gzip") != std::string::npos;
+
+    char limitHeaders[160];
+    double retryAfter = 0;
+    bool allowed = takeToken(retryAfter);
+    snprintf(limitHeaders, sizeof(limitHeaders),
+             "X-RateLimit-Limit: %u\r\nX-RateLimit-Remaining: %u\r\nX-RateLimit-Reset-After: %.3f\r\n",
+             _bucketSize, _bucketSize > _recent.size() ? unsigned(_bucketSize - _recent.size()) : 0u,
+             double(_bucketPeriodUs) / 1e6);
+
+    int forced = window ? window->status : 0;
+    if (!allowed || forced == 429) {
+        if (allowed) retryAfter = double(window->toUs - nowUs()) / 1e6;
+        char json[160];
+        snprintf(json, sizeof(json),
+                 "{\"message\": \"You are being rate limited.\", \"retry_after\": %.3f, \"global\": false}",
+                 retryAfter);
+        char extra[64];
+        snprintf(extra, sizeof(extra), "Retry-After: %u\r\n", static_cast<unsigned>(retryAfter + 0.999));
+        return httpResponse(429, json, std::string(limitHeaders) + extra);
+    }
+    if (forced) {
+        return httpResponse(forced, "{\"message\": \"Simulated failure\", \"code\": 0}", limitHeaders);
+    }
+
+    bool isEdit = method == "PATCH";
+    if (method != "POST" && !isEdit) return httpResponse(405, "{\"message\": \"405: Method Not Allowed\", \"code\": 0}", "");
+
+    uint64_t id = 0;
+    if (isEdit) {
+        size_t pos = target.find("/messages/");
+        if (pos != std::string::npos) id = strtoull(target.c_str() + pos + 10, nullptr, 10);
+        if (id < kFirstMessageId || id >= snowflakeFloor() + (1ULL << 22)) {
+            return httpResponse(404, "{\"message\": \"Unknown Message\", \"code\": 10008}", limitHeaders);
+        }
+    }
+
+    if (gzipped) {
+        std::string inflated;
+        if (!gunzip(body, inflated)) {
+            return httpResponse(400, "{\"message\": \"Malformed gzip body\", \"code\": 0}", limitHeaders);
+        }
+        counter(kCounterGzipRequests)++;
+        counter(kCounterGzipWireBytes) += body.size();
+        counter(kCounterGzipBodyBytes) += inflated.size();
+        body.swap(inflated);
+    }
+
+    std::string content = rawJsonString(body, "content");
+    std::string username = rawJsonString(body, "username");
+    if (body.empty() || body.front() != '{' || body.back() != '}') {
+        return httpResponse(400, "{\"message\": \"The request body contains invalid JSON.\", \"code\": 50109}", limitHeaders);
+    }
+    if (!content.empty() && decodedLength(content) > kMaxContentChars) {
+        return httpResponse(400, "{\"content\": [\"Must be 2000 or fewer in length.\"]}", limitHeaders);
+    }
+    if (content.empty() && !isEdit) {
+        return httpResponse(400, "{\"message\": \"Cannot send an empty message\", \"code\": 50006}", limitHeaders);
+    }
+
+    if (!isEdit) {
+        id = std::max(_nextId, snowflakeFloor());
+        _nextId = id + 1;
+        if (target.find("wait=true") == std::string::npos) return httpResponse(204, "", limitHeaders);
+    }
+
+    std::string idText = std::to_string(id);
+    std::string json = "{\"id\":\"" + idText + "\",\"type\":0,\"content\":" + (content.empty() ? "\"\"" : content) +
+                       ",\"channel_id\":\"1446680031261622000\",\"author\":{\"bot\":true,"
+                       "\"id\":\"1446680031261622303\",\"username\":" +
+                       (username.empty() ? "\"Captain Hook\"" : username) +
+                       ",\"avatar\":null,\"discriminator\":\"0000\"},\"attachments\":[],\"embeds\":[],"
+                       "\"mentions\":[],\"mention_roles\":[],\"pinned\":false,\"mention_everyone\":false,"
+                       "\"tts\":false,\"timestamp\":\"" + isoTimestamp() + "\",\"edited_timestamp\":" +
+                       (isEdit ? "\"" + isoTimestamp() + "\"" : std::string("null")) +
+                       ",\"flags\":0,\"components\":[],\"webhook_id\":\"1446680031261622303\"}";
+    return httpResponse(200, json, limitHeaders);
+}
+
+} // namespace sim
@@ -0,0 +1,487 @@
+/**
+ * webserver.cpp (host simulator)
+ * WebServer on a real loopback socket: one request per connection, handled
+ * synchronously inside handleClient() like the ESP32 core's server.
+ * Request parsing is host-side bookkeeping; handler code (and the Strings it
+ * builds) runs on the simulated device heap.
+ */
+
+#include "WebServer.h"
+#include "sim_host.h"
+#include "sim_radio.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+
+namespace {
+
+constexpr int kRequestTimeoutMs = 3000;  // HTTP_MAX_DATA_WAIT on the device is 5 s
+constexpr size_t kMaxRequestBytes = 2 * 1024 * 1024;  // the device streams bodies; this is host-side only
+
+uint64_t hostNowUs() {
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+const char* reasonPhrase(int code) {
+    switch (code) {
+        case 200: return "OK";
+        case 204: return "No Content";
+        case 301: return "Moved Permanently";
+        case 302: return "Found";
+        case 304: return "Not Modified";
+        case 400: return "Bad Request";
+        case 401: return "Unauthorized";
+        case 403: return "Forbidden";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 409: return "Conflict";
+        case 413: return "Payload Too Large";
+        case 500: return "Internal Server Error";
+        case 503: return "Service Unavailable";
+        default: return "";
+    }
+}
+
+HTTPMethod parseMethod(const std::string& m) {
+    if (m == "GET") return HTTP_GET;
+    if (m == "HEAD") return HTTP_HEAD;
+    if (m == "POST") return HTTP_POST;
+    if (m == "PUT") return HTTP_PUT;
+    if (m == "PATCH") return HTTP_PATCH;
+    if (m == "DELETE") return HTTP_DELETE;
+    if (m == "OPTIONS") return HTTP_OPTIONS;
+    return HTTP_ANY;
+}
+
+std::string decode(const std::string& text) {
+    std::string out;
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (text[i] == '+') {
+            out += ' ';
+        } else if (text[i] == '%' && i + 2 < text.size() && isxdigit(static_cast<unsigned char>(text[i + 1])) &&
+                   isxdigit(static_cast<unsigned char>(text[i + 2]))) {
+            out += static_cast<char>(strtol(text.substr(i + 1, 2).c_str(), nullptr, 16));
+            i += 2;
+        } else {
+            out += text[i];
+        }
+    }
+    return out;
+}
+
+} // namespace
+
+WebServer::WebServer(int port)
+    : _port(port), _hostPort(0), _listenFd(-1), _loopback(false), _fd(-1), _upload(), _method(HTTP_ANY), _contentLength(CONTENT_LENGTH_NOT_SET),
+      _chunked(false), _headersSent(false) {}
+
+WebServer::WebServer(IPAddress addr, int port) : WebServer(port) {
+    // Always 127.0.0.1 on the host; on the device only the loopback skips the radio
+    _loopback = addr == IPAddress(127, 0, 0, 1);
+}
+
+WebServer::~WebServer() { close(); }
+
+void WebServer::begin() {
+    close();
+    _hostPort = sim::hostPortFor(static_cast<uint16_t>(_port));
+    if (!_hostPort) return;  // listening disabled for this run
+
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) return;
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(_hostPort);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(fd, 8) != 0) {
+        fprintf(stderr, "[sim] WebServer: cannot listen on 127.0.0.1:%u (%s)\n", _hostPort, strerror(errno));
+        ::close(fd);
+        _hostPort = 0;
+        return;
+    }
+    _listenFd = fd;
+    sim::addDeviceListener(static_cast<uint16_t>(_port));
+}
+
+void WebServer::begin(uint16_t port) {
+    _port = port;
+    begin();
+}
+
+void WebServer::close() {
+    if (_listenFd >= 0) {
+        ::close(_listenFd);
+        sim::removeDeviceListener(static_cast<uint16_t>(_port));
+    }
+    _listenFd = -1;
+}
+
+void WebServer::stop() { close(); }
+
+void WebServer::handleClient() {
+    if (_listenFd < 0) return;
+    int fd = accept4(_listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+    if (fd < 0) return;
+    if (!_loopback) sim::radio().waitForRx();
+
+    _fd = fd;
+    if (readRequest(fd)) {
+        dispatch();
+        if (_chunked) writeRaw("0\r\n\r\n", 5);
+    }
+    ::close(fd);
+    _fd = -1;
+
+    sim::HostScope host;
+    _args.clear();
+    _reqHeaders.clear();
+    _respHeaders.clear();
+    _boundary.clear();
+    _multipart.clear();
+}
+
+bool WebServer::readRequest(int fd) {
+    sim::HostScope host;
+    std::string raw;
+    size_t headEnd = std::string::npos;
+    size_t bodyLen = 0;
+    const uint64_t start = hostNowUs();
+    for (;;) {
+        if (headEnd != std::string::npos && raw.size() >= headEnd + 4 + bodyLen) break;
+        uint64_t waited = (hostNowUs() - start) / 1000;
+        if (waited >= static_cast<uint64_t>(kRequestTimeoutMs) || raw.size() > kMaxRequestBytes) break;
+        pollfd p{fd, POLLIN, 0};
+        int ready = ::poll(&p, 1, static_cast<int>(kRequestTimeoutMs - waited));
+        if (ready < 0 && errno == EINTR) continue;  // profiler alarm (SIGPROF)
+        if (ready <= 0) break;
+        char buf[4096];
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        if (n <= 0) break;
+        raw.append(buf, static_cast<size_t>(n));
+        if (headEnd == std::string::npos && (headEnd = raw.find("\r\n\r\n")) != std::string::npos) {
+            size_t pos = 0;
+            std::string head = raw.substr(0, headEnd + 2);
+            while ((pos = head.find("\r\n", pos)) != std::string::npos) {
+                pos += 2;
+                if (strncasecmp(head.c_str() + pos, "content-length:", 15) == 0) bodyLen = strtoul(head.c_str() + pos + 15, nullptr, 10);
+            }
+        }
+    }
+    // Socket reads happen in real time; the device clock moves with them.
+    if (!sim::realtime()) sim::creditRealWaitUs(hostNowUs() - start);
+    if (headEnd == std::string::npos) return false;
+
+    size_t lineEnd = raw.find("\r\n");
+    std::string line = raw.substr(0, lineEnd);
+    size_t sp1 = line.find(' ');
+    size_t sp2 = line.rfind(' ');
+    if (sp1 == std::string::npos || sp2 == sp1) return false;
+    _method = parseMethod(line.substr(0, sp1));
+    std::string target = line.substr(sp1 + 1, sp2 - sp1 - 1);
+    size_t q = target.find('?');
+    _uri = decode(target.substr(0, q));
+
+    _reqHeaders.clear();
+    std::string contentType;
+    size_t pos = lineEnd + 2;
+    while (pos < headEnd) {
+        size_t eol = raw.find("\r\n", pos);
+        std::string h = raw.substr(pos, eol - pos);
+        size_t colon = h.find(':');
+        if (colon != std::string::npos) {
+            std::string name = h.substr(0, colon);
+            std::string value = h.substr(colon + 1);
+            while (!value.empty() && value[0] == ' ') value.erase(0, 1);
+            if (strcasecmp(name.c_str(), "Content-Type") == 0) contentType = value;
+            _reqHeaders.push_back({name, value});
+        }
+        pos = eol + 2;
+    }
+
+    _args.clear();
+    if (q != std::string::npos) parseArgs(target.substr(q + 1));
+    std::string body = raw.substr(headEnd + 4, bodyLen);
+    _boundary.clear();
+    _multipart.clear();
+    size_t b = contentType.find("boundary=");
+    if (contentType.compare(0, 19, "multipart/form-data") == 0 && b != std::string::npos) {
+        std::string boundary = contentType.substr(b + 9);
+        boundary = boundary.substr(0, boundary.find(';'));
+        if (boundary.size() >= 2 && boundary.front() == '"') boundary = boundary.substr(1, boundary.size() - 2);
+        _boundary = "--" + boundary;
+        _multipart.swap(body);
+    } else if (!body.empty()) {
+        if (contentType.compare(0, 33, "application/x-www-form-urlencoded") == 0) parseArgs(body);
+        else _args.push_back({"plain", body});
+    }
+    _respHeaders.clear();
+    _contentLength = CONTENT_LENGTH_NOT_SET;
+    _chunked = false;
+    _headersSent = false;
+    return true;
+}
+
+void WebServer::parseArgs(const std::string& query) {
+    size_t pos = 0;
+    while (pos <= query.size()) {
+        size_t amp = query.find('&', pos);
+        std::string pair = query.substr(pos, amp == std::string::npos ? std::string::npos : amp - pos);
+        if (!pair.empty()) {
+            size_t eq = pair.find('=');
+            _args.push_back({decode(pair.substr(0, eq)), eq == std::string::npos ? "" : decode(pair.substr(eq + 1))});
+        }
+        if (amp == std::string::npos) break;
+        pos = amp + 1;
+    }
+}
+
+void WebServer::dispatch() {
+    for (const Route& r : _routes) {
+        if (r.uri != _uri) continue;
+        if (r.method != HTTP_ANY && r.method != _method) continue;
+        // A body cut short fails the request: no handler, no response.
+        if (!_boundary.empty() && !runUploads(r.ufn ? r.ufn : _fileUpload)) return;
+        r.fn();
+        return;
+    }
+    if (_notFound) {
+        _notFound();
+        return;
+    }
+    send(404, "text/plain", String("Not found: ") + _uri.c_str());
+}
+
+namespace {
+
+// name="..." / filename="..." of a Content-Disposition header; false if absent
+bool dispositionParam(const std::string& headers, const char* key, std::string& value) {
+    const std::string needle = std::string(" ") + key + "=\"";
+    size_t at = headers.find(needle);
+    if (at == std::string::npos) at = headers.find(std::string(";") + key + "=\"");
+    if (at == std::string::npos) return false;
+    at += needle.size();
+    value = headers.substr(at, headers.find('"', at) - at);
+    return true;
+}
+
+} // namespace
+
+// Like the core's _parseForm(): fields become args, each file part is handed
+// to ufn as START, WRITE per HTTP_UPLOAD_BUFLEN bytes and END (ABORTED if the
+// body ends inside it, and false is returned).
+bool WebServer::runUploads(const THandlerFunction& ufn) {
+    size_t pos = _multipart.find(_boundary);
+    while (pos != std::string::npos) {
+        pos += _boundary.size();
+        if (_multipart.compare(pos, 2, "--") == 0) return true;  // closing delimiter
+        pos += 2;                                            // CRLF after the delimiter
+        const size_t headEnd = _multipart.find("\r\n\r\n", pos);
+        if (headEnd == std::string::npos) return false;
+        std::string name, filename, type;
+        size_t next;
+        bool isFile;
+        {
+            sim::HostScope host;
+            const std::string headers = _multipart.substr(pos, headEnd - pos);
+            next = _multipart.find("\r\n" + _boundary, headEnd + 4);
+            isFile = dispositionParam(headers, "filename", filename);
+            dispositionParam(headers, "name", name);
+            size_t ct = headers.find("Content-Type:");
+            if (ct == std::string::npos) ct = headers.find("content-type:");
+            if (ct != std::string::npos) {
+                type = headers.substr(ct + 13, headers.find("\r\n", ct) - ct - 13);
+                while (!type.empty() && type[0] == ' ') type.erase(0, 1);
+            }
+        }
+        const size_t dataStart = headEnd + 4;
+        const size_t dataEnd = next == std::string::npos ? _multipart.size() : next;
+
+        if (!isFile) {
+            sim::HostScope host;
+            if (next != std::string::npos) _args.push_back({name, _multipart.substr(dataStart, dataEnd - dataStart)});
+        } else if (ufn) {
+            _upload.status = UPLOAD_FILE_START;
+            _upload.name = String(name.c_str());
+            _upload.filename = String(filename.c_str());
+            _upload.type = String(type.c_str());
+            _upload.totalSize = 0;
+            _upload.currentSize = 0;
+            ufn();
+            for (size_t at = dataStart; at < dataEnd; at += HTTP_UPLOAD_BUFLEN) {
+                const size_t n = dataEnd - at < HTTP_UPLOAD_BUFLEN ? dataEnd - at : HTTP_UPLOAD_BUFLEN;
+                memcpy(_upload.buf, _multipart.data() + at, n);
+                _upload.currentSize = n;
+                _upload.totalSize += n;
+                _upload.status = UPLOAD_FILE_WRITE;
+                ufn();
+            }
+            _upload.currentSize = 0;
+            _upload.status = next == std::string::npos ? UPLOAD_FILE_ABORTED : UPLOAD_FILE_END;
+            ufn();
+        }
+        if (next == std::string::npos) return false;
+        pos = next + 2;
+    }
+    return false;  // no closing delimiter
+}
+
+void WebServer::on(const String& uri, THandlerFunction handler) { on(uri, HTTP_ANY, handler); }
+
+void WebServer::on(const String& uri, HTTPMethod method, THandlerFunction fn) {
+    on(uri, method, fn, THandlerFunction());
+}
+
+void WebServer::on(const String& uri, HTTPMethod method, THandlerFunction fn, THandlerFunction ufn) {
+    sim::HostScope host;
+    _routes.push_back({uri.c_str(), method, fn, ufn});
+}
+
+String WebServer::pathArg(unsigned int i) const {
+    (void)i;
+    return String();
+}
+
+String WebServer::arg(const String& name) const {
+    for (const auto& a : _args) {
+        if (a.first == name.c_str()) return String(a.second.c_str());
+    }
+    return String();
+}
+
+String WebServer::arg(int i) const {
+    return i >= 0 && i < args() ? String(_args[i].second.c_str()) : String();
+}
+
+String WebServer::argName(int i) const {
+    return i >= 0 && i < args() ? String(_args[i].first.c_str()) : String();
+}
+
+bool WebServer::hasArg(const String& name) const {
+    for (const auto& a : _args) {
+        if (a.first == name.c_str()) return true;
+    }
+    return false;
+}
+
+void WebServer::collectHeaders(const char* headerKeys[], const size_t headerKeysCount) {
+    sim::HostScope host;
+    _collect.clear();
+    for (size_t i = 0; i < headerKeysCount; ++i) _collect.push_back(headerKeys[i]);
+}
+
+String WebServer::header(const String& name) const {
+    for (const auto& h : _reqHeaders) {
+        if (strcasecmp(h.first.c_str(), name.c_str()) == 0) return String(h.second.c_str());
+    }
+    return String();
+}
+
+String WebServer::header(int i) const {
+    return i >= 0 && i < headers() ? String(_reqHeaders[i].second.c_str()) : String();
+}
+
+String WebServer::headerName(int i) const {
+    return i >= 0 && i < headers() ? String(_reqHeaders[i].first.c_str()) : String();
+}
+
+WiFiClient WebServer::client() {
+    // Its own descriptor: handleClient() still closes _fd after the handler.
+    return WiFiClient(_fd >= 0 ? fcntl(_fd, F_DUPFD_CLOEXEC, 0) : -1);
+}
+
+bool WebServer::hasHeader(const String& name) const {
+    for (const auto& h : _reqHeaders) {
+        if (strcasecmp(h.first.c_str(), name.c_str()) == 0) return true;
+    }
+    return false;
+}
+
+void WebServer::sendHeader(const String& name, const String& value, bool first) {
+    sim::HostScope host;
+    std::pair<std::string, std::string> h(name.c_str(), value.c_str());
+    if (first) _respHeaders.insert(_respHeaders.begin(), h);
+    else _respHeaders.push_back(h);
+}
+
+void WebServer::writeRaw(const char* data, size_t len) {
+    if (_fd < 0) return;
+    size_t sent = 0;
+    while (sent < len) {
+        ssize_t n = ::send(_fd, data + sent, len - sent, MSG_NOSIGNAL);
+        if (n <= 0) return;
+        sent += static_cast<size_t>(n);
+    }
+}
+
+void WebServer::sendHeaderBlock(int code, const char* contentType, size_t contentLength) {
+    sim::HostScope host;
+    std::string head = "HTTP/1.1 " + std::to_string(code) + " " + reasonPhrase(code) + "\r\n";
+    head += "Content-Type: " + std::string(contentType ? contentType : "text/html") + "\r\n";
+    if (contentLength == CONTENT_LENGTH_UNKNOWN) {
+        head += "Transfer-Encoding: chunked\r\n";
+        _chunked = true;
+    } else {
+        head += "Content-Length: " + std::to_string(contentLength) + "\r\n";
+    }
+    for (const auto& h : _respHeaders) head += h.first + ": " + h.second + "\r\n";
+    head += "Connection: close\r\n\r\n";
+    writeRaw(head.data(), head.size());
+    _headersSent = true;
+}
+
+void WebServer::send(int code, const char* content_type, const String& content) {
+    send(code, content_type, content.c_str(), content.length());
+}
+
+void WebServer::send(int code, const char* content_type, const char* content, size_t contentLength) {
+    size_t length = _contentLength == CONTENT_LENGTH_NOT_SET ? contentLength : _contentLength;
+    sendHeaderBlock(code, content_type, length);
+    if (_method != HTTP_HEAD && contentLength) sendContent(content, contentLength);
+}
+
+void WebServer::sendContent(const char* content, size_t contentLength) {
+    if (!_headersSent || contentLength == 0) return;
+    if (_chunked) {
+        char size[16];
+        int n = snprintf(size, sizeof(size), "%zx\r\n", contentLength);
+        writeRaw(size, n);
+        writeRaw(content, contentLength);
+        writeRaw("\r\n", 2);
+    } else {
+        writeRaw(content, contentLength);
+    }
+}
+
+size_t WebServer::streamFile(File& file, const String& contentType) {
+    size_t size = file.size();
+    setContentLength(size);
+    send(200, contentType.c_str(), "", 0);
+    uint8_t buf[1460];
+    size_t total = 0;
+    size_t n;
+    while ((n = file.read(buf, sizeof(buf))) > 0) {
+        writeRaw(reinterpret_cast<char*>(buf), n);
+        total += n;
+    }
+    return total;
+}
+
+String WebServer::urlDecode(const String& text) {
+    std::string out;
+    {
+        sim::HostScope host;
+        out = decode(text.c_str());
+    }
+    return String(out.c_str());
+}
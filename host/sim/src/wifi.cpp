@@ -0,0 +1,657 @@
+/**
+ * wifi.cpp (host simulator)
+ * Fake radio, WiFiClass, WiFiClient and the esp_wifi calls built on them.
+ */
+
+#include "WiFi.h"
+#include "esp_wifi.h"
+#include "sim_host.h"
+#include "sim_radio.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+
+WiFiClass WiFi;
+
+namespace sim {
+
+namespace {
+
+constexpr int kInvisibleDbm = -95;
+constexpr int kBeaconLossDbm = -92;
+constexpr uint32_t kScanPerChannelMs = 120;
+constexpr uint32_t kWrongPassFailMs = 3000;
+constexpr uint64_t kAutoReconnectUs = 3 * 1000 * 1000;
+
+// Small deterministic jitter so RSSI looks alive between trace points.
+int jitter(const uint8_t* bssid, uint64_t us) {
+    uint64_t x = (us / 2000000ULL) * 0x9E3779B97F4A7C15ULL ^ bssid[5] ^ (uint64_t(bssid[4]) << 8);
+    x ^= x >> 29;
+    return static_cast<int>(x % 5) - 2;
+}
+
+} // namespace
+
+Radio& radio() {
+    static Radio instance;
+    return instance;
+}
+
+Radio::Radio() {
+    const uint8_t mac[6] = {0x24, 0x6F, 0x28, 0x5A, 0x1C, 0x30};
+    memcpy(_baseMac, mac, 6);
+}
+
+void Radio::setBaseMac(const uint8_t mac[6]) {
+    memcpy(_baseMac, mac, 6);
+}
+
+SimAp* Radio::findAp(const uint8_t bssid[6]) {
+    for (SimAp& ap : _aps) {
+        if (memcmp(ap.bssid, bssid, 6) == 0) return &ap;
+    }
+    return nullptr;
+}
+
+void Radio::addDrop(const LinkDrop& drop) {
+    auto at = std::upper_bound(_drops.begin(), _drops.end(), drop,
+                               [](const LinkDrop& a, const LinkDrop& b) { return a.atUs < b.atUs; });
+    _drops.insert(at, drop);
+}
+
+int Radio::pinLevel(int pin) const {
+    // Buttons are active-low and read as pressed for 500 ms after a scripted press.
+    uint64_t now = nowUs();
+    for (const ButtonPress& b : _presses) {
+        if (b.pin == pin && now >= b.atUs && now < b.atUs + 500000ULL) return LOW;
+    }
+    return HIGH;
+}
+
+void Radio::armButtonWake(int pin, int level) {
+    (void)level;
+    _wakePin = pin;
+}
+
+uint64_t Radio::nextButtonPressUs(uint64_t fromUs, uint64_t toUs) const {
+    if (_wakePin < 0) return 0;
+    uint64_t best = 0;
+    for (const ButtonPress& b : _presses) {
+        if (b.pin == _wakePin && b.atUs > fromUs && b.atUs < toUs && (!best || b.atUs < best)) best = b.atUs;
+    }
+    return best;
+}
+
+bool Radio::apDown(size_t index, uint64_t atUs) const {
+    (void)index;
+    for (const LinkDrop& d : _drops) {
+        if (atUs >= d.atUs && atUs < d.atUs + d.downUs) return true;
+    }
+    return false;
+}
+
+int Radio::rssiNow(const SimAp& ap) const {
+    uint64_t now = nowUs();
+    int base = ap.rssi;
+    if (!ap.trace.empty()) {
+        if (now <= ap.trace.front().first) {
+            base = ap.trace.front().second;
+        } else if (now >= ap.trace.back().first) {
+            base = ap.trace.back().second;
+        } else {
+            for (size_t i = 1; i < ap.trace.size(); ++i) {
+                if (now < ap.trace[i].first) {
+                    const auto& a = ap.trace[i - 1];
+                    const auto& b = ap.trace[i];
+                    double f = double(now - a.first) / double(b.first - a.first);
+                    base = static_cast<int>(a.second + f * (b.second - a.second));
+                    break;
+                }
+            }
+        }
+    }
+    return base + jitter(ap.bssid, now);
+}
+
+uint64_t Radio::rxWakeDelayUs() const {
+    constexpr uint64_t kBeaconUs = 102400;
+    if (psType == WIFI_PS_NONE || mode == WIFI_MODE_AP || mode == WIFI_MODE_APSTA) return 0;
+    const uint64_t period = (psType == WIFI_PS_MAX_MODEM ? listenInterval : dtimPeriod) * kBeaconUs;
+    if (period == 0) return 0;
+    return period - nowUs() % period;
+}
+
+void Radio::waitForRx() {
+    const uint64_t us = rxWakeDelayUs();
+    if (us) advanceUs(us);
+}
+
+std::vector<const SimAp*> Radio::visibleAps(int channel) const {
+    std::vector<const SimAp*> out;
+    uint64_t now = nowUs();
+    for (size_t i = 0; i < _aps.size(); ++i) {
+        if (channel && _aps[i].channel != channel) continue;
+        if (apDown(i, now) || rssiNow(_aps[i]) <= kInvisibleDbm) continue;
+        out.push_back(&_aps[i]);
+    }
+    std::sort(out.begin(), out.end(),
+              [this](const SimAp* a, const SimAp* b) { return rssiNow(*a) > rssiNow(*b); });
+    return out;
+}
+
+wifi_event_id_t Radio::addListener(WiFiEventFuncCb cb, arduino_event_id_t event) {
+    HostScope host;
+    _listeners.push_back({_nextListenerId, cb, event});
+    return _nextListenerId++;
+}
+
+void Radio::removeListener(wifi_event_id_t id) {
+    HostScope host;
+    _listeners.erase(std::remove_if(_listeners.begin(), _listeners.end(),
+                                    [id](const Listener& l) { return l.id == id; }),
+                     _listeners.end());
+}
+
+void Radio::emit(arduino_event_id_t id, const arduino_event_info_t& info) {
+    EventTaskScope task;
+    for (const Listener& l : _listeners) {
+        if (l.event == ARDUINO_EVENT_MAX || l.event == id) l.cb(id, info);
+    }
+}
+
+void Radio::begin(const char* ssidArg, const char* passArg, int32_t channel, const uint8_t* bssid) {
+    HostScope host;
+    ssid = ssidArg ? ssidArg : "";
+    pass = passArg ? passArg : "";
+    _connected = false;
+    _reconnectAtUs = 0;
+    _status = WL_DISCONNECTED;
+    _hintedChannel = channel > 0;
+
+    // Strongest visible AP with that SSID (or the pinned BSSID).
+    int best = -1;
+    int bestRssi = -1000;
+    uint64_t now = nowUs();
+    for (size_t i = 0; i < _aps.size(); ++i) {
+        const SimAp& ap = _aps[i];
+        if (ap.ssid != ssid) continue;
+        if (bssid && memcmp(bssid, ap.bssid, 6) != 0) continue;
+        if (apDown(i, now)) continue;
+        int r = rssiNow(ap);
+        if (r > kInvisibleDbm && r > bestRssi) {
+            best = static_cast<int>(i);
+            bestRssi = r;
+        }
+    }
+
+    if (best < 0) {
+        // Full all-channel scan before giving up.
+        _apIndex = 0;
+        _wrongPass = false;
+        enterPhase(Phase::Scan, 13ULL * kScanPerChannelMs * 1000ULL);
+        _phase = Phase::Failed;  // resolved as NO_AP_FOUND when the scan ends
+        return;
+    }
+    _apIndex = static_cast<size_t>(best);
+    _wrongPass = _aps[_apIndex].pass != pass;
+    uint64_t scanUs = _hintedChannel ? 0 : uint64_t(_aps[_apIndex].channel) * kScanPerChannelMs * 1000ULL;
+    enterPhase(Phase::Scan, scanUs);
+}
+
+void Radio::disconnect() {
+    bool was = _connected;
+    _connected = false;
+    _phase = Phase::Idle;
+    _status = WL_DISCONNECTED;
+    _reconnectAtUs = 0;
+    if (was) {
+        arduino_event_info_t info{};
+        info.wifi_sta_disconnected.reason = WIFI_REASON_ASSOC_LEAVE;
+        emit(ARDUINO_EVENT_WIFI_STA_DISCONNECTED, info);
+    }
+}
+
+void Radio::enterPhase(Phase phase, uint64_t durationUs) {
+    _phase = phase;
+    _phaseEndUs = nowUs() + durationUs;
+}
+
+void Radio::fail(int reason, wl_status_t status) {
+    _phase = Phase::Idle;
+    _connected = false;
+    _status = status;
+    arduino_event_info_t info{};
+    info.wifi_sta_disconnected.reason = static_cast<uint8_t>(reason);
+    emit(ARDUINO_EVENT_WIFI_STA_DISCONNECTED, info);
+    if (_autoReconnect && !ssid.empty()) _reconnectAtUs = nowUs() + kAutoReconnectUs;
+}
+
+void Radio::poll() {
+    if (_polling) return;  // listeners may call back into WiFi
+    _polling = true;
+    uint64_t now = nowUs();
+
+    // Scheduled link drops and beacon loss on the current AP.
+    while (_nextDrop < _drops.size() && _drops[_nextDrop].atUs <= now) {
+        const LinkDrop& d = _drops[_nextDrop++];
+        if (_connected || _phase != Phase::Idle) fail(d.reason, WL_CONNECTION_LOST);
+    }
+    if (_connected && rssiNow(_aps[_apIndex]) <= kBeaconLossDbm) fail(WIFI_REASON_BEACON_TIMEOUT, WL_CONNECTION_LOST);
+
+    // Connection state machine.
+    bool progressed = true;
+    while (progressed && _phase != Phase::Idle && _phase != Phase::Connected && now >= _phaseEndUs) {
+        progressed = true;
+        const uint64_t at = _phaseEndUs;
+        switch (_phase) {
+            case Phase::Failed:
+                fail(WIFI_REASON_NO_AP_FOUND, WL_NO_SSID_AVAIL);
+                break;
+            case Phase::Scan:
+                _phase = Phase::Auth;
+                _phaseEndUs = at + _aps[_apIndex].authMs * 1000ULL;
+                break;
+            case Phase::Auth:
+                _phase = Phase::Assoc;
+                _phaseEndUs = at + _aps[_apIndex].assocMs * 1000ULL;
+                break;
+            case Phase::Assoc:
+                _phase = Phase::Handshake;
+                _phaseEndUs = at + (_wrongPass ? kWrongPassFailMs : _aps[_apIndex].handshakeMs) * 1000ULL;
+                break;
+            case Phase::Handshake: {
+                if (_wrongPass) {
+                    fail(WIFI_REASON_4WAY_HANDSHAKE_TIMEOUT, WL_CONNECT_FAILED);
+                    break;
+                }
+                // ESP-IDF posts STA_CONNECTED once the 4-way handshake has installed the keys.
+                arduino_event_info_t info{};
+                const SimAp& ap = _aps[_apIndex];
+                memcpy(info.wifi_sta_connected.bssid, ap.bssid, 6);
+                info.wifi_sta_connected.channel = static_cast<uint8_t>(ap.channel);
+                info.wifi_sta_connected.authmode = ap.auth;
+                emit(ARDUINO_EVENT_WIFI_STA_CONNECTED, info);
+                _phase = Phase::Dhcp;
+                _phaseEndUs = at + (_staticIp ? 0 : ap.dhcpMs * 1000ULL);
+                break;
+            }
+            case Phase::Dhcp: {
+                _phase = Phase::Connected;
+                _connected = true;
+                _status = WL_CONNECTED;
+                _linkUps++;
+                arduino_event_info_t info{};
+                info.got_ip.ip = _net.ip;
+                emit(ARDUINO_EVENT_WIFI_STA_GOT_IP, info);
+                break;
+            }
+            default:
+                progressed = false;
+                break;
+        }
+    }
+
+    if (!_connected && _phase == Phase::Idle && _reconnectAtUs && now >= _reconnectAtUs) {
+        _reconnectAtUs = 0;
+        std::string s = ssid;
+        std::string p = pass;
+        begin(s.c_str(), p.c_str(), 0, nullptr);
+    }
+    _polling = false;
+}
+
+wl_status_t Radio::status() {
+    poll();
+    return _status;
+}
+
+bool Radio::connectHost(uint32_t ip, uint16_t port, uint32_t timeoutMs, bool& known) {
+    known = false;
+    for (const SimHost& h : _hosts) {
+        if (h.ip != ip) continue;
+        known = true;
+        if (!_connected) return false;
+        advanceMs(h.latencyMs);
+        return std::find(h.openPorts.begin(), h.openPorts.end(), port) != h.openPorts.end();
+    }
+    return false;
+    (void)timeoutMs;
+}
+
+} // namespace sim
+
+// ============================================================
+// WiFiClass
+// ============================================================
+
+wl_status_t WiFiClass::begin(const char* ssid, const char* passphrase, int32_t channel, const uint8_t* bssid,
+                             bool connect) {
+    if (sim::radio().mode == WIFI_MODE_NULL) sim::radio().mode = WIFI_MODE_STA;
+    if (connect) sim::radio().begin(ssid, passphrase, channel, bssid);
+    return status();
+}
+
+bool WiFiClass::disconnect(bool wifioff, bool eraseap) {
+    (void)eraseap;
+    sim::radio().disconnect();
+    if (wifioff) sim::radio().mode = WIFI_MODE_NULL;
+    return true;
+}
+
+bool WiFiClass::reconnect() {
+    sim::Radio& r = sim::radio();
+    std::string s = r.ssid;
+    std::string p = r.pass;
+    r.begin(s.c_str(), p.c_str(), 0, nullptr);
+    return true;
+}
+
+wl_status_t WiFiClass::status() { return sim::radio().status(); }
+bool WiFiClass::setAutoReconnect(bool autoReconnect) {
+    sim::radio().setAutoReconnect(autoReconnect);
+    return true;
+}
+bool WiFiClass::getAutoReconnect() { return sim::radio().autoReconnect(); }
+
+bool WiFiClass::config(IPAddress local, IPAddress gateway, IPAddress subnet, IPAddress dns1, IPAddress dns2) {
+    sim::NetConfig& n = sim::radio().net();
+    bool enable = static_cast<uint32_t>(local) != 0;
+    if (enable) {
+        n.ip = local;
+        n.gateway = gateway;
+        n.mask = subnet;
+        if (static_cast<uint32_t>(dns1)) n.dns0 = dns1;
+        if (static_cast<uint32_t>(dns2)) n.dns1 = dns2;
+    }
+    sim::radio().setStaticConfig(enable);
+    return true;
+}
+
+String WiFiClass::SSID() const {
+    const sim::SimAp* ap = sim::radio().currentAp();
+    return ap ? String(ap->ssid.c_str()) : String();
+}
+
+String WiFiClass::psk() const { return String(sim::radio().pass.c_str()); }
+
+uint8_t* WiFiClass::BSSID() {
+    const sim::SimAp* ap = sim::radio().currentAp();
+    return ap ? const_cast<uint8_t*>(ap->bssid) : nullptr;
+}
+
+String WiFiClass::BSSIDstr() {
+    uint8_t* b = BSSID();
+    if (!b) return String();
+    char buf[18];
+    snprintf(buf, sizeof(buf), "%02X:%02X:%02X:%02X:%02X:%02X", b[0], b[1], b[2], b[3], b[4], b[5]);
+    return String(buf);
+}
+
+int8_t WiFiClass::RSSI() {
+    const sim::SimAp* ap = sim::radio().currentAp();
+    return ap ? static_cast<int8_t>(sim::radio().rssiNow(*ap)) : 0;
+}
+
+int32_t WiFiClass::channel() {
+    const sim::SimAp* ap = sim::radio().currentAp();
+    return ap ? ap->channel : 0;
+}
+
+IPAddress WiFiClass::localIP() { return isConnected() ? sim::radio().net().ip : IPAddress(); }
+IPAddress WiFiClass::gatewayIP() { return isConnected() ? sim::radio().net().gateway : IPAddress(); }
+IPAddress WiFiClass::subnetMask() { return isConnected() ? sim::radio().net().mask : IPAddress(); }
+IPAddress WiFiClass::dnsIP(uint8_t dnsNo) {
+    if (!isConnected()) return IPAddress();
+    return dnsNo == 0 ? sim::radio().net().dns0 : sim::radio().net().dns1;
+}
+IPAddress WiFiClass::broadcastIP() {
+    if (!isConnected()) return IPAddress();
+    const sim::NetConfig& n = sim::radio().net();
+    return IPAddress(static_cast<uint32_t>(n.ip) | ~static_cast<uint32_t>(n.mask));
+}
+
+String WiFiClass::macAddress() {
+    uint8_t mac[6];
+    macAddress(mac);
+    char buf[18];
+    snprintf(buf, sizeof(buf), "%02X:%02X:%02X:%02X:%02X:%02X", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    return String(buf);
+}
+
+uint8_t* WiFiClass::macAddress(uint8_t* mac) {
+    memcpy(mac, sim::radio().baseMac(), 6);
+    return mac;
+}
+
+const char* WiFiClass::getHostname() { return sim::radio().hostname.c_str(); }
+
+bool WiFiClass::setHostname(const char* hostname) {
+    sim::HostScope host;
+    sim::radio().hostname = hostname ? hostname : "";
+    return true;
+}
+
+bool WiFiClass::mode(wifi_mode_t m) {
+    sim::radio().mode = m;
+    return true;
+}
+
+wifi_mode_t WiFiClass::getMode() { return sim::radio().mode; }
+
+bool WiFiClass::setSleep(bool enabled) {
+    sim::radio().sleepEnabled = enabled;
+    sim::radio().psType = enabled ? WIFI_PS_MIN_MODEM : WIFI_PS_NONE;
+    return true;
+}
+
+bool WiFiClass::getSleep() { return sim::radio().sleepEnabled; }
+
+wifi_event_id_t WiFiClass::onEvent(WiFiEventFuncCb cb, arduino_event_id_t event) {
+    return sim::radio().addListener(cb, event);
+}
+
+void WiFiClass::removeEvent(wifi_event_id_t id) { sim::radio().removeListener(id); }
+
+int WiFiClass::hostByName(const char* host, IPAddress& result) {
+    if (!isConnected()) return 0;
+    if (result.fromString(host)) return 1;
+    sim::advanceMs(15);  // one DNS round trip to the resolver
+    if (strcmp(host, "localhost") == 0) {
+        result = IPAddress(127, 0, 0, 1);
+        return 1;
+    }
+    // Stable fake address per name in 203.0.113.0/24 (TEST-NET-3).
+    uint32_t h = 2166136261u;
+    for (const char* p = host; *p; ++p) h = (h ^ static_cast<uint8_t>(*p)) * 16777619u;
+    result = IPAddress(203, 0, 113, static_cast<uint8_t>(1 + h % 254));
+    return 1;
+}
+
+namespace {
+// Like the core's WiFiScanClass: the record array is allocated when the scan
+// completes (SCAN_DONE) and lives until scanDelete() or the next scan.
+struct ScanState {
+    wifi_ap_record_t* records = nullptr;
+    int16_t count = 0;
+    uint64_t doneAtUs = 0;
+    int channel = 0;
+    bool running = false;
+};
+ScanState gScan;
+
+void freeScanRecords() {
+    sim::heapFree(gScan.records);
+    gScan.records = nullptr;
+    gScan.count = 0;
+}
+
+const wifi_ap_record_t* scanRecord(uint8_t i) {
+    return i < gScan.count ? &gScan.records[i] : nullptr;
+}
+}
+
+int16_t WiFiClass::scanNetworks(bool async, bool show_hidden, bool passive, uint32_t max_ms_per_chan,
+                                uint8_t channel) {
+    (void)show_hidden;
+    uint32_t perChan = passive ? max_ms_per_chan : std::min<uint32_t>(max_ms_per_chan, uint32_t(120));
+    uint32_t channels = channel ? 1 : 13;
+    uint64_t durationUs = uint64_t(perChan) * channels * 1000ULL;
+
+    freeScanRecords();
+    gScan.running = true;
+    gScan.doneAtUs = sim::nowUs() + durationUs;
+    gScan.channel = channel;
+    if (async) return WIFI_SCAN_RUNNING;
+    sim::advanceUs(durationUs);
+    return scanComplete();
+}
+
+int16_t WiFiClass::scanComplete() {
+    if (!gScan.running) return gScan.count > 0 ? gScan.count : WIFI_SCAN_FAILED;
+    if (sim::nowUs() < gScan.doneAtUs) return WIFI_SCAN_RUNNING;
+    gScan.running = false;
+
+    std::vector<const sim::SimAp*> visible;
+    {
+        sim::HostScope host;
+        visible = sim::radio().visibleAps(gScan.channel);
+    }
+    if (visible.empty()) return WIFI_SCAN_FAILED;
+    {
+        sim::StackScope stack;
+        gScan.records = static_cast<wifi_ap_record_t*>(sim::heapAlloc(visible.size() * sizeof(wifi_ap_record_t)));
+    }
+    if (!gScan.records) return WIFI_SCAN_FAILED;
+    gScan.count = static_cast<int16_t>(visible.size());
+    for (size_t i = 0; i < visible.size(); ++i) {
+        const sim::SimAp& ap = *visible[i];
+        wifi_ap_record_t& r = gScan.records[i];
+        memset(&r, 0, sizeof(r));
+        memcpy(r.bssid, ap.bssid, 6);
+        strncpy(reinterpret_cast<char*>(r.ssid), ap.ssid.c_str(), 32);
+        r.primary = static_cast<uint8_t>(ap.channel);
+        r.rssi = static_cast<int8_t>(sim::radio().rssiNow(ap));
+        r.authmode = ap.auth;
+        r.pairwise_cipher = ap.auth == WIFI_AUTH_OPEN ? WIFI_CIPHER_TYPE_NONE : WIFI_CIPHER_TYPE_CCMP;
+        r.group_cipher = r.pairwise_cipher;
+    }
+    {
+        sim::HostScope host;
+        visible.clear();
+        visible.shrink_to_fit();
+    }
+    return gScan.count;
+}
+
+void WiFiClass::scanDelete() {
+    freeScanRecords();
+    gScan.running = false;
+}
+
+void* WiFiClass::getScanInfoByIndex(int i) {
+    return i >= 0 && i < gScan.count ? &gScan.records[i] : nullptr;
+}
+
+String WiFiClass::SSID(uint8_t i) {
+    const wifi_ap_record_t* r = scanRecord(i);
+    return r ? String(reinterpret_cast<const char*>(r->ssid)) : String();
+}
+
+int32_t WiFiClass::RSSI(uint8_t i) {
+    const wifi_ap_record_t* r = scanRecord(i);
+    return r ? r->rssi : 0;
+}
+
+uint8_t* WiFiClass::BSSID(uint8_t i) {
+    const wifi_ap_record_t* r = scanRecord(i);
+    return r ? const_cast<uint8_t*>(r->bssid) : nullptr;
+}
+
+String WiFiClass::BSSIDstr(uint8_t i) {
+    uint8_t* b = BSSID(i);
+    if (!b) return String();
+    char buf[18];
+    snprintf(buf, sizeof(buf), "%02X:%02X:%02X:%02X:%02X:%02X", b[0], b[1], b[2], b[3], b[4], b[5]);
+    return String(buf);
+}
+
+int32_t WiFiClass::channel(uint8_t i) {
+    const wifi_ap_record_t* r = scanRecord(i);
+    return r ? r->primary : 0;
+}
+
+wifi_auth_mode_t WiFiClass::encryptionType(uint8_t i) {
+    const wifi_ap_record_t* r = scanRecord(i);
+    return r ? r->authmode : WIFI_AUTH_OPEN;
+}
+
+bool WiFiClass::softAP(const char* ssid, const char* passphrase, int channel, int ssid_hidden, int max_connection) {
+    (void)passphrase;
+    (void)channel;
+    (void)ssid_hidden;
+    (void)max_connection;
+    sim::HostScope host;
+    sim::Radio& r = sim::radio();
+    r.softApActive = true;
+    r.softApSsid = ssid ? ssid : "";
+    if (r.mode == WIFI_MODE_STA) r.mode = WIFI_MODE_APSTA;
+    else if (r.mode == WIFI_MODE_NULL) r.mode = WIFI_MODE_AP;
+    return true;
+}
+
+bool WiFiClass::softAPConfig(IPAddress local_ip, IPAddress gateway, IPAddress subnet) {
+    (void)local_ip;
+    (void)gateway;
+    (void)subnet;
+    return true;
+}
+
+bool WiFiClass::softAPdisconnect(bool wifioff) {
+    sim::Radio& r = sim::radio();
+    r.softApActive = false;
+    if (r.mode == WIFI_MODE_APSTA) r.mode = WIFI_MODE_STA;
+    else if (r.mode == WIFI_MODE_AP) r.mode = wifioff ? WIFI_MODE_NULL : WIFI_MODE_NULL;
+    return true;
+}
+
+IPAddress WiFiClass::softAPIP() { return sim::radio().softApActive ? IPAddress(192, 168, 4, 1) : IPAddress(); }
+uint8_t WiFiClass::softAPgetStationNum() { return 0; }
+
+// ============================================================
+// esp_wifi
+// ============================================================
+
+esp_err_t esp_wifi_sta_get_ap_info(wifi_ap_record_t* info) {
+    const sim::SimAp* ap = sim::radio().currentAp();
+    if (!ap || !WiFi.isConnected()) return ESP_FAIL;
+    memset(info, 0, sizeof(*info));
+    memcpy(info->bssid, ap->bssid, 6);
+    strncpy(reinterpret_cast<char*>(info->ssid), ap->ssid.c_str(), 32);
+    info->primary = static_cast<uint8_t>(ap->channel);
+    info->rssi = static_cast<int8_t>(sim::radio().rssiNow(*ap));
+    info->authmode = ap->auth;
+    info->pairwise_cipher = ap->auth == WIFI_AUTH_OPEN ? WIFI_CIPHER_TYPE_NONE : WIFI_CIPHER_TYPE_CCMP;
+    info->group_cipher = info->pairwise_cipher;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_ps(wifi_ps_type_t type) {
+    sim::radio().psType = type;
+    sim::radio().sleepEnabled = type != WIFI_PS_NONE;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_get_ps(wifi_ps_type_t* type) {
+    *type = sim::radio().psType;
+    return ESP_OK;
+}
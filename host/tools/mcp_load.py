@@ -0,0 +1,516 @@
+#!/usr/bin/env python3
+"""
+mcp_load.py
+Concurrent load generator for the ArduinoMCP endpoints, with a latency
+report and pass/fail gates.
+
+Several workers send a weighted mix of list / read / write / info requests
+to a device or to mercury_sim, either as fast as the device answers (closed
+loop) or at a fixed total rate (open loop). With --rate, latency is counted
+from the moment a request was due, not from when a worker got to send it,
+so a stalled server shows up in the percentiles instead of silently slowing
+the load down.
+
+    python3 host/tools/mcp_load.py http://192.168.1.50 --mix list=4,read=3,write=2,info=1 \\
+        --concurrency 4 --rate 10 --seconds 60
+    python3 host/tools/mcp_load.py http://127.0.0.1:8080 --seconds 20 --json run.json \\
+        --max-errors 1 --max-p95 1500 --max-heap-drop 2048 --baseline last.json
+
+HTTPS URLs go through TLS (the library's beginSecure(), McpTls.h). With
+--keep-alive every worker keeps its connection between requests, as a
+browser or the Console would; --reconnect-every N opens a new one after N
+requests, offering the last TLS session (ticket or session ID) so the
+handshake can be resumed. The report then adds client-side handshake
+counts (full / resumed), resumption ratio and handshake times, and, from
+GET /api/tls/stats, the device's own counts and request latency over the
+run; --min-resumption gates the ratio.
+
+    python3 host/tools/mcp_load.py https://192.168.1.50 --insecure --reconnect-every 20 \\
+        --seconds 60 --min-resumption 0.9
+
+Both API flavours are understood and told apart by GET /api/device/info:
+the ArduinoMCP library (raw write body, heap from /api/device/info) and
+the mercury_net_diag sketch (content= form field, heap from /api/status).
+Before the run the tool writes its own files under --dir (a file to read
+and one per write slot) and removes them afterwards; list is of --dir.
+
+The report gives per-operation count, errors, p50 / p95 / p99 / max latency,
+overall throughput and error breakdown, and free heap before and after
+(read while the device is idle). --json writes the same numbers; gates
+(--max-*, --baseline) make the exit status 1 when a limit is broken, so
+the tool can guard server-side changes (make -C host load).
+"""
+
+import argparse
+import http.client
+import json
+import random
+import socket
+import ssl
+import sys
+import threading
+import time
+import urllib.parse
+
+OPS = ("list", "read", "write", "info")
+
+
+class TlsConnection(http.client.HTTPSConnection):
+    """HTTPS connection that offers the target's last TLS session and times its handshake"""
+
+    def __init__(self, target):
+        super().__init__(target.host, target.port, timeout=target.timeout, context=target.tls)
+        self.target = target
+
+    def connect(self):
+        t = self.target
+        sock = socket.create_connection((self.host, self.port), self.timeout)
+        sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        started = time.monotonic()
+        try:
+            self.sock = self._context.wrap_socket(sock, server_hostname=self.host,
+                                                  session=t.session if t.resume else None)
+        except BaseException:
+            sock.close()
+            raise
+        t.handshake(self.sock, time.monotonic() - started)
+
+
+class Target:
+    def __init__(self, url, timeout, keep_alive=False, reconnect_every=0, resume=True, tls=None):
+        u = urllib.parse.urlsplit(url if "//" in url else "http://" + url)
+        self.https = u.scheme == "https"
+        self.host = u.hostname
+        self.port = u.port or (443 if self.https else 80)
+        self.base = url.rstrip("/")
+        self.timeout = timeout
+        self.flavour = None
+        self.keep_alive = keep_alive or reconnect_every > 0
+        self.reconnect_every = reconnect_every
+        self.resume = resume
+        self.tls = tls
+        self.session = None  # last TLS session, offered on reconnects
+        self.local = threading.local()  # each worker's connection
+        self.lock = threading.Lock()
+        self.handshakes = []  # (resumed, seconds)
+
+    def handshake(self, sock, seconds):
+        with self.lock:
+            self.handshakes.append((sock.session_reused, seconds))
+            self.session = sock.session
+
+    def connection(self):
+        conn = getattr(self.local, "conn", None)
+        if conn is not None and self.reconnect_every and self.local.used >= self.reconnect_every:
+            conn.close()
+            conn = None
+        if conn is None:
+            if self.https:
+                conn = TlsConnection(self)
+            else:
+                conn = http.client.HTTPConnection(self.host, self.port, timeout=self.timeout)
+            self.local.conn = conn
+            self.local.used = 0
+        return conn
+
+    def drop(self):
+        conn = getattr(self.local, "conn", None)
+        if conn is not None:
+            conn.close()
+        self.local.conn = None
+
+    def request(self, method, path, body=None, headers=None):
+        """(status, body text); raises on connection errors and timeouts"""
+        headers = dict(headers or {})
+        if not self.keep_alive:
+            headers["Connection"] = "close"
+        for attempt in (0, 1):
+            conn = self.connection()
+            reused = self.local.used > 0
+            try:
+                conn.request(method, path, body=body, headers=headers)
+                resp = conn.getresponse()
+                text = resp.read().decode("utf-8", "replace")
+            except (http.client.RemoteDisconnected, ConnectionResetError, BrokenPipeError, ssl.SSLEOFError):
+                # A kept connection the server closed while idle: once more on a new one
+                self.drop()
+                if reused and attempt == 0:
+                    continue
+                raise
+            except BaseException:
+                self.drop()
+                raise
+            self.local.used += 1
+            if not self.keep_alive or resp.will_close:
+                self.drop()
+            return resp.status, text
+
+    def detect(self):
+        try:
+            status, _ = self.request("GET", "/api/device/info")
+        except OSError as e:
+            sys.exit("%s: %s" % (self.base, e))
+        self.flavour = "library" if status == 200 else "sketch"
+
+    def write(self, path, content, append=False):
+        q = {"path": path}
+        if append:
+            q["append"] = "1"
+        if self.flavour == "library":
+            return self.request("POST", "/api/spiffs/write?" + urllib.parse.urlencode(q), content.encode(),
+                                {"Content-Type": "text/plain"})
+        q["content"] = content
+        return self.request("POST", "/api/spiffs/write", urllib.parse.urlencode(q).encode(),
+                            {"Content-Type": "application/x-www-form-urlencoded"})
+
+    def delete(self, path):
+        method = "DELETE" if self.flavour == "library" else "POST"
+        return self.request(method, "/api/spiffs/delete?" + urllib.parse.urlencode({"path": path}))
+
+    def heap(self):
+        path = "/api/device/info" if self.flavour == "library" else "/api/status"
+        status, body = self.request("GET", path)
+        if status != 200:
+            return {}
+        doc = json.loads(body)
+        doc = doc.get("device", doc)
+        return {k: doc[k] for k in ("freeHeap", "minFreeHeap", "heapSize") if k in doc}
+
+    def tls_stats(self):
+        """GET /api/tls/stats, {} when the device has none"""
+        if not self.https or self.flavour != "library":
+            return {}
+        try:
+            status, body = self.request("GET", "/api/tls/stats")
+        except OSError:
+            return {}
+        return json.loads(body) if status == 200 else {}
+
+
+def failed(status, body):
+    """Error label of a response, None when it succeeded"""
+    if status >= 400:
+        return "HTTP %d" % status
+    try:
+        doc = json.loads(body)
+    except ValueError:
+        return None
+    if isinstance(doc, dict) and (doc.get("success") is False or doc.get("ok") is False):
+        return "HTTP %d, %s" % (status, doc.get("error", "failed"))
+    return None
+
+
+def parse_mix(text):
+    mix = {}
+    for part in text.split(","):
+        name, _, weight = part.partition("=")
+        name = name.strip()
+        if name not in OPS:
+            sys.exit("--mix: unknown operation %r (known: %s)" % (name, ", ".join(OPS)))
+        mix[name] = float(weight or 1)
+    if sum(mix.values()) <= 0:
+        sys.exit("--mix: all weights are zero")
+    return mix
+
+
+def percentile(sorted_values, p):
+    if not sorted_values:
+        return 0.0
+    i = int(round(p / 100.0 * (len(sorted_values) - 1)))
+    return sorted_values[min(i, len(sorted_values) - 1)]
+
+
+class Run:
+    def __init__(self, target, args):
+        self.t = target
+        self.args = args
+        self.mix = parse_mix(args.mix)
+        self.rng = random.Random(args.seed)
+        self.lock = threading.Lock()
+        self.issued = 0
+        self.results = []  # (op, latency s, error label or None)
+        self.read_path = args.dir + "/r.txt"
+        self.payload = ("0123456789abcdef" * (args.write_bytes // 16 + 1))[:args.write_bytes]
+
+    def next_job(self, start, end):
+        """(op, due time) of the next request, None when the run is over"""
+        with self.lock:
+            i = self.issued
+            if (self.args.requests and i >= self.args.requests) or time.monotonic() >= end:
+                return None
+            self.issued += 1
+            ops = list(self.mix)
+            op = self.rng.choices(ops, weights=[self.mix[o] for o in ops])[0]
+        due = start + i / self.args.rate if self.args.rate else time.monotonic()
+        return op, due, i
+
+    def send(self, op, i):
+        t = self.t
+        if op == "list":
+            return t.request("GET", "/api/spiffs/list?" + urllib.parse.urlencode({"path": self.args.dir}))
+        if op == "read":
+            return t.request("GET", "/api/spiffs/read?" + urllib.parse.urlencode({"path": self.read_path}))
+        if op == "write":
+            return t.write("%s/w%d.txt" % (self.args.dir, i % self.args.write_files), self.payload)
+        return t.request("GET", "/api/spiffs/info")
+
+    def worker(self, start, end):
+        while True:
+            job = self.next_job(start, end)
+            if job is None:
+                self.t.drop()
+                return
+            op, due, i = job
+            wait = due - time.monotonic()
+            if wait > 0:
+                time.sleep(wait)
+            sent = time.monotonic()
+            try:
+                status, body = self.send(op, i)
+                error = failed(status, body)
+            except OSError as e:
+                error = "timeout" if isinstance(e, TimeoutError) or "timed out" in str(e) else type(e).__name__
+            latency = time.monotonic() - (due if self.args.rate else sent)
+            with self.lock:
+                self.results.append((op, latency, error))
+
+    def setup(self):
+        status, body = self.t.write(self.read_path, self.payload[:self.args.read_bytes].ljust(self.args.read_bytes, "."))
+        if failed(status, body):
+            sys.exit("setup: writing %s: %s" % (self.read_path, failed(status, body)))
+
+    def cleanup(self):
+        for path in [self.read_path] + ["%s/w%d.txt" % (self.args.dir, n) for n in range(self.args.write_files)]:
+            try:
+                self.t.delete(path)
+            except OSError:
+                pass
+
+    def run(self):
+        start = time.monotonic()
+        end = start + self.args.seconds
+        threads = [threading.Thread(target=self.worker, args=(start, end), daemon=True)
+                   for _ in range(self.args.concurrency)]
+        for th in threads:
+            th.start()
+        for th in threads:
+            th.join()
+        return time.monotonic() - start
+
+
+def summarize(results, elapsed):
+    def stats(rows):
+        lat = sorted(r[1] * 1000.0 for r in rows)
+        errors = sum(1 for r in rows if r[2])
+        return {
+            "n": len(rows),
+            "errors": errors,
+            "error_pct": 100.0 * errors / len(rows) if rows else 0.0,
+            "p50_ms": percentile(lat, 50),
+            "p95_ms": percentile(lat, 95),
+            "p99_ms": percentile(lat, 99),
+            "max_ms": lat[-1] if lat else 0.0,
+        }
+
+    out = {"ops": {}, "elapsed_s": elapsed}
+    for op in OPS:
+        rows = [r for r in results if r[0] == op]
+        if rows:
+            out["ops"][op] = stats(rows)
+    out["all"] = stats(results)
+    out["throughput_rps"] = len(results) / elapsed if elapsed > 0 else 0.0
+    breakdown = {}
+    for r in results:
+        if r[2]:
+            breakdown[r[2]] = breakdown.get(r[2], 0) + 1
+    out["error_breakdown"] = breakdown
+    return out
+
+
+def summarize_tls(handshakes, before, after):
+    """Client-side handshake numbers and the device's counters over the run"""
+    full = [s * 1000.0 for resumed, s in handshakes if not resumed]
+    resumed = [s * 1000.0 for r, s in handshakes if r]
+    out = {
+        "handshakes": len(handshakes),
+        "full": len(full),
+        "resumed": len(resumed),
+        "resumption_ratio": len(resumed) / len(handshakes) if handshakes else 0.0,
+        "full_ms_avg": sum(full) / len(full) if full else 0.0,
+        "resumed_ms_avg": sum(resumed) / len(resumed) if resumed else 0.0,
+    }
+    if before and after:
+        hb, ha = before["handshakes"], after["handshakes"]
+        out["device"] = {
+            "full": ha["full"] - hb["full"],
+            "resumedTicket": ha["resumedTicket"] - hb["resumedTicket"],
+            "resumedCache": ha["resumedCache"] - hb["resumedCache"],
+            "failed": ha["failed"] - hb["failed"],
+            "requests": after["requests"] - before["requests"],
+            "keepAliveRequests": after["keepAliveRequests"] - before["keepAliveRequests"],
+            "evicted": after["evicted"] - before["evicted"],
+            # since begin(): the device keeps no per-run histogram
+            "handshakeMs": after["handshakeMs"],
+            "requestMs": after["requestMs"],
+        }
+    return out
+
+
+def print_report(summary, target, args):
+    rate = "%g/s" % args.rate if args.rate else "closed loop"
+    conn = "keep-alive" if target.keep_alive else "connection per request"
+    if args.reconnect_every:
+        conn += ", reconnect every %d" % args.reconnect_every
+    print("%s (%s), %.1f s, concurrency %d, %s, %s, mix %s" % (target.base, target.flavour, summary["elapsed_s"],
+                                                               args.concurrency, rate, conn, args.mix))
+    print("%-6s %6s %6s %7s %8s %8s %8s %8s" % ("op", "n", "errors", "err%", "p50 ms", "p95 ms", "p99 ms", "max ms"))
+    rows = list(summary["ops"].items()) + [("all", summary["all"])]
+    for name, s in rows:
+        print("%-6s %6d %6d %6.1f%% %8.1f %8.1f %8.1f %8.1f" % (name, s["n"], s["errors"], s["error_pct"], s["p50_ms"],
+                                                               s["p95_ms"], s["p99_ms"], s["max_ms"]))
+    print("throughput %.1f req/s" % summary["throughput_rps"])
+    for label, count in sorted(summary["error_breakdown"].items(), key=lambda kv: -kv[1]):
+        print("  %5d  %s" % (count, label))
+    before, after = summary["heap"]["before"], summary["heap"]["after"]
+    for key in ("freeHeap", "minFreeHeap"):
+        if key in before and key in after:
+            print("%s: %d -> %d (%+d)" % (key, before[key], after[key], after[key] - before[key]))
+    tls = summary.get("tls")
+    if tls:
+        print("tls: %d handshakes, %d full (avg %.1f ms), %d resumed (avg %.1f ms), resumption %.1f%%" % (
+            tls["handshakes"], tls["full"], tls["full_ms_avg"], tls["resumed"], tls["resumed_ms_avg"],
+            100.0 * tls["resumption_ratio"]))
+        d = tls.get("device")
+        if d:
+            print("device: %d full, %d ticket, %d cache, %d failed; %d requests, %d on kept connections, "
+                  "%d evicted" % (d["full"], d["resumedTicket"], d["resumedCache"], d["failed"], d["requests"],
+                                  d["keepAliveRequests"], d["evicted"]))
+            print("device (since begin): handshake ms full avg %d max %d, resumed avg %d max %d; "
+                  "request ms p50 %d p95 %d p99 %d max %d" % (
+                      d["handshakeMs"]["fullAvg"], d["handshakeMs"]["fullMax"], d["handshakeMs"]["resumedAvg"],
+                      d["handshakeMs"]["resumedMax"], d["requestMs"]["p50"], d["requestMs"]["p95"],
+                      d["requestMs"]["p99"], d["requestMs"]["max"]))
+
+
+def gates(summary, args):
+    """Broken limits, as messages"""
+    broken = []
+    s = summary["all"]
+    if args.max_errors is not None and s["error_pct"] > args.max_errors:
+        broken.append("error rate %.1f%% > %g%%" % (s["error_pct"], args.max_errors))
+    for key, limit in (("p95_ms", args.max_p95), ("p99_ms", args.max_p99)):
+        if limit is not None and s[key] > limit:
+            broken.append("%s %.1f > %g" % (key, s[key], limit))
+    if args.min_rps is not None and summary["throughput_rps"] < args.min_rps:
+        broken.append("throughput %.1f req/s < %g" % (summary["throughput_rps"], args.min_rps))
+    before, after = summary["heap"]["before"], summary["heap"]["after"]
+    if args.max_heap_drop is not None and "freeHeap" in before and "freeHeap" in after:
+        drop = before["freeHeap"] - after["freeHeap"]
+        if drop > args.max_heap_drop:
+            broken.append("free heap dropped %d bytes > %d" % (drop, args.max_heap_drop))
+    tls = summary.get("tls")
+    if args.min_resumption is not None and tls and tls["resumption_ratio"] < args.min_resumption:
+        broken.append("resumption ratio %.3f < %g" % (tls["resumption_ratio"], args.min_resumption))
+    if args.baseline:
+        with open(args.baseline) as f:
+            base = json.load(f)
+        slack = 1.0 + args.tolerance / 100.0
+        for op, s in summary["ops"].items():
+            b = base.get("ops", {}).get(op)
+            if b and b["p95_ms"] > 0 and s["p95_ms"] > b["p95_ms"] * slack:
+                broken.append("%s p95 %.1f ms > baseline %.1f ms + %g%%" % (op, s["p95_ms"], b["p95_ms"],
+                                                                            args.tolerance))
+        if base.get("throughput_rps") and summary["throughput_rps"] * slack < base["throughput_rps"]:
+            broken.append("throughput %.1f req/s < baseline %.1f - %g%%" % (summary["throughput_rps"],
+                                                                            base["throughput_rps"], args.tolerance))
+    return broken
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("url", help="device base URL, e.g. http://192.168.1.50 or http://127.0.0.1:8080")
+    parser.add_argument("--mix", default="list=4,read=3,write=2,info=1",
+                        help="weights of %s (default list=4,read=3,write=2,info=1)" % ", ".join(OPS))
+    parser.add_argument("--concurrency", type=int, default=4, help="workers, each with one request in flight")
+    parser.add_argument("--rate", type=float, default=0.0, help="total requests per second (0: closed loop)")
+    parser.add_argument("--seconds", type=float, default=30.0, help="run length")
+    parser.add_argument("--requests", type=int, default=0, help="stop after this many requests (0: no limit)")
+    parser.add_argument("--timeout", type=float, default=10.0, help="per request, seconds")
+    parser.add_argument("--dir", default="/load", help="directory for the tool's files")
+    parser.add_argument("--read-bytes", type=int, default=1024, help="size of the file read")
+    parser.add_argument("--write-bytes", type=int, default=512, help="body of each write")
+    parser.add_argument("--write-files", type=int, default=8, help="files the writes cycle through")
+    parser.add_argument("--keep-alive", action="store_true", help="each worker keeps its connection open")
+    parser.add_argument("--reconnect-every", type=int, default=0,
+                        help="new connection after this many requests (implies --keep-alive)")
+    parser.add_argument("--no-resume", action="store_true", help="never offer a TLS session for resumption")
+    parser.add_argument("--insecure", action="store_true", help="do not verify the device's certificate")
+    parser.add_argument("--cafile", help="CA or self-signed certificate to verify the device with")
+    parser.add_argument("--seed", type=int, default=1, help="seed of the operation sequence")
+    parser.add_argument("--keep", action="store_true", help="leave the tool's files on the device")
+    parser.add_argument("--json", help="write the results here")
+    g = parser.add_argument_group("gates (exit status 1 when broken)")
+    g.add_argument("--max-errors", type=float, help="error rate, percent")
+    g.add_argument("--max-p95", type=float, help="p95 latency of all requests, ms")
+    g.add_argument("--max-p99", type=float, help="p99 latency of all requests, ms")
+    g.add_argument("--min-rps", type=float, help="throughput, requests per second")
+    g.add_argument("--max-heap-drop", type=int, help="free heap lost over the run, bytes")
+    g.add_argument("--min-resumption", type=float, help="resumed / all TLS handshakes, 0..1")
+    g.add_argument("--baseline", help="--json output of an earlier run: per-op p95 and throughput")
+    g.add_argument("--tolerance", type=float, default=25.0, help="allowed regression against --baseline, percent")
+    args = parser.parse_args()
+    if args.concurrency < 1:
+        parser.error("--concurrency must be at least 1")
+
+    tls = None
+    if args.url.startswith("https:"):
+        tls = ssl.SSLContext(ssl.PROTOCOL_TLS_CLIENT)
+        if args.insecure:
+            tls.check_hostname = False
+            tls.verify_mode = ssl.CERT_NONE
+        elif args.cafile:
+            tls.load_verify_locations(args.cafile)
+        else:
+            tls.load_default_certs()
+    target = Target(args.url, args.timeout, args.keep_alive, args.reconnect_every, not args.no_resume, tls)
+    target.detect()
+    run = Run(target, args)
+    run.setup()
+    heap_before = target.heap()
+    tls_before = target.tls_stats()
+    target.drop()
+    target.handshakes = []
+    elapsed = run.run()
+    time.sleep(0.5)  # let the device finish whatever the last requests started
+    target.drop()
+    handshakes = target.handshakes
+    tls_after = target.tls_stats()
+    heap_after = target.heap()
+    if not args.keep:
+        run.cleanup()
+
+    summary = summarize(run.results, elapsed)
+    summary["heap"] = {"before": heap_before, "after": heap_after}
+    if target.https:
+        summary["tls"] = summarize_tls(handshakes, tls_before, tls_after)
+    summary["config"] = {"url": args.url, "flavour": target.flavour, "mix": args.mix, "concurrency": args.concurrency,
+                         "rate": args.rate, "seconds": args.seconds, "write_bytes": args.write_bytes,
+                         "read_bytes": args.read_bytes, "keep_alive": target.keep_alive,
+                         "reconnect_every": args.reconnect_every}
+    print_report(summary, target, args)
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump(summary, f, indent=2)
+            f.write("\n")
+
+    broken = gates(summary, args)
+    for msg in broken:
+        print("gate: FAIL %s" % msg)
+    if any(v is not None for v in (args.max_errors, args.max_p95, args.max_p99, args.min_rps,
+                                   args.max_heap_drop, args.min_resumption)) or args.baseline:
+        print("gate: %s" % ("FAIL" if broken else "ok"))
+    sys.exit(1 if broken else 0)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,264 @@
+#!/usr/bin/env python3
+"""
+mcp_profile.py
+Host side of the McpProfiler sampling profiler (MCP_PROFILE=1 builds).
+
+record: starts the profiler on a device (or mercury_sim), drains
+/api/profile/samples every --interval seconds for --seconds, stops it and
+writes the raw samples (one "task pc pc ..." line each, leaf first).
+
+report: symbolizes the samples against the ELF with addr2line and writes
+folded stacks (flamegraph.pl / speedscope / inferno input), a self-contained
+SVG flamegraph, and a table of the hottest functions on stdout.
+
+    python3 host/tools/mcp_profile.py record http://192.168.1.50 --hz 200 --seconds 30 -o samples.txt
+    python3 host/tools/mcp_profile.py report samples.txt --elf build/mercury_net_diag.ino.elf --svg flame.svg
+
+The ELF comes from `arduino-cli compile --output-dir build ...` of the exact
+build that is running. xtensa-esp32-elf-addr2line is looked up on PATH and in
+the Arduino15 tool directories; host ELFs (mercury_sim) use plain addr2line.
+"""
+
+import argparse
+import collections
+import glob
+import html
+import os
+import shutil
+import subprocess
+import sys
+import time
+import urllib.request
+
+EM_XTENSA = 94
+
+
+def http(method, url, timeout=10):
+    req = urllib.request.Request(url, method=method, data=b"" if method == "POST" else None)
+    with urllib.request.urlopen(req, timeout=timeout) as resp:
+        return resp.read().decode("utf-8", "replace")
+
+
+# ---- record ----
+
+def record(args):
+    base = args.url.rstrip("/")
+    print(http("POST", "%s/api/profile/start?hz=%d" % (base, args.hz)).strip(), file=sys.stderr)
+    lines = []
+    header = ""
+    try:
+        end = time.monotonic() + args.seconds
+        while True:
+            time.sleep(args.interval)
+            for line in http("GET", base + "/api/profile/samples").splitlines():
+                if line.startswith("#"):
+                    header = line
+                elif line.strip():
+                    lines.append(line)
+            if time.monotonic() >= end:
+                break
+    finally:
+        print(http("POST", base + "/api/profile/stop").strip(), file=sys.stderr)
+    # Samples taken between the last drain and the stop
+    for line in http("GET", base + "/api/profile/samples").splitlines():
+        if line.startswith("#"):
+            header = line
+        elif line.strip():
+            lines.append(line)
+    with open(args.output, "w") as f:
+        if header:
+            f.write(header + "\n")
+        f.write("\n".join(lines) + ("\n" if lines else ""))
+    print("%d samples -> %s (%s)" % (len(lines), args.output, header.lstrip("# ")), file=sys.stderr)
+
+
+# ---- symbolize ----
+
+def elf_machine(path):
+    with open(path, "rb") as f:
+        ident = f.read(20)
+    if ident[:4] != b"\x7fELF":
+        sys.exit("%s is not an ELF file" % path)
+    return int.from_bytes(ident[18:20], "little" if ident[5] == 1 else "big")
+
+
+def find_addr2line(elf):
+    if elf_machine(elf) != EM_XTENSA:
+        return shutil.which("addr2line") or sys.exit("addr2line not found")
+    name = "xtensa-esp32-elf-addr2line"
+    found = shutil.which(name)
+    if found:
+        return found
+    home = os.path.expanduser("~")
+    for root in (".arduino15", "Library/Arduino15", "AppData/Local/Arduino15"):
+        hits = sorted(glob.glob(os.path.join(home, root, "packages/esp32/tools/*/*/bin", name)))
+        if hits:
+            return hits[-1]
+    sys.exit("%s not found; pass --addr2line" % name)
+
+
+def symbolize(addr2line, elf, addrs, xtensa):
+    """Returns {addr: function name} for the given int addresses."""
+    if not addrs:
+        return {}
+    out = subprocess.run([addr2line, "-f", "-C", "-e", elf], input="\n".join("%x" % a for a in addrs),
+                         capture_output=True, text=True, check=True).stdout.splitlines()
+    names = {}
+    for i, addr in enumerate(addrs):
+        func = out[2 * i] if 2 * i < len(out) else "??"  # the next line is file:line
+        if func != "??":
+            names[addr] = func
+        elif xtensa and 0x40000000 <= addr < 0x40070000:
+            names[addr] = "[rom]"  # mask ROM: not in the ELF
+        else:
+            names[addr] = "[unknown]"  # host: shared libraries
+    return names
+
+
+def load_samples(path):
+    samples = []
+    header = ""
+    with open(path) as f:
+        for line in f:
+            if line.startswith("#"):
+                header = line.strip()
+                continue
+            fields = line.split()
+            if len(fields) >= 2:
+                samples.append((fields[0], [int(pc, 16) for pc in fields[1:]]))
+    return header, samples
+
+
+# ---- flamegraph ----
+
+class Node:
+    __slots__ = ("name", "count", "children")
+
+    def __init__(self, name):
+        self.name = name
+        self.count = 0
+        self.children = collections.OrderedDict()
+
+
+def build_tree(folded):
+    root = Node("all")
+    for stack, count in folded.items():
+        root.count += count
+        node = root
+        for name in stack.split(";"):
+            node = node.children.setdefault(name, Node(name))
+            node.count += count
+    return root
+
+
+def color(name):
+    h = 0
+    for c in name:
+        h = (h * 31 + ord(c)) & 0xFFFFFFFF
+    return "rgb(%d,%d,%d)" % (205 + h % 50, 80 + (h >> 8) % 130, 40 + (h >> 16) % 50)
+
+
+def write_svg(path, folded, title):
+    width, row, font = 1200, 17, 12
+    root = build_tree(folded)
+
+    def depth(node):
+        return 1 + max((depth(c) for c in node.children.values()), default=0)
+
+    rows = depth(root)
+    height = rows * row + 50
+    scale = (width - 20) / max(root.count, 1)
+    parts = [
+        '<svg xmlns="http://www.w3.org/2000/svg" width="%d" height="%d" font-family="monospace" '
+        'font-size="%d">' % (width, height, font),
+        '<rect width="100%%" height="100%%" fill="#fdfdf6"/>',
+        '<text x="%d" y="20" text-anchor="middle" font-size="15">%s</text>' % (width // 2, html.escape(title)),
+    ]
+
+    def draw(node, x, level):
+        w = node.count * scale
+        if w < 0.5:
+            return
+        y = height - 10 - (level + 1) * row
+        pct = 100.0 * node.count / max(root.count, 1)
+        label = "%s (%d samples, %.1f%%)" % (node.name, node.count, pct)
+        parts.append('<g><title>%s</title><rect x="%.1f" y="%d" width="%.1f" height="%d" fill="%s" rx="2"/>'
+                     % (html.escape(label), x, y, w, row - 1, color(node.name)))
+        chars = int((w - 6) / (font * 0.6))
+        if chars >= 3:
+            text = node.name if len(node.name) <= chars else node.name[:chars - 2] + ".."
+            parts.append('<text x="%.1f" y="%d">%s</text>' % (x + 3, y + row - 5, html.escape(text)))
+        parts.append("</g>")
+        cx = x
+        for child in node.children.values():
+            draw(child, cx, level + 1)
+            cx += child.count * scale
+
+    draw(root, 10, 0)
+    parts.append("</svg>")
+    with open(path, "w") as f:
+        f.write("\n".join(parts) + "\n")
+
+
+# ---- report ----
+
+def report(args):
+    header, samples = load_samples(args.samples)
+    if not samples:
+        sys.exit("no samples in %s" % args.samples)
+    addr2line = args.addr2line or find_addr2line(args.elf)
+    addrs = sorted({pc for _, pcs in samples for pc in pcs})
+    names = symbolize(addr2line, args.elf, addrs, elf_machine(args.elf) == EM_XTENSA)
+
+    folded = collections.Counter()
+    self_count = collections.Counter()
+    total_count = collections.Counter()
+    for task, pcs in samples:
+        frames = [names[pc] for pc in pcs]
+        # Recursion or inlining can repeat a function; count it once per sample.
+        for name in set(frames):
+            total_count[name] += 1
+        self_count[frames[0]] += 1
+        folded[";".join([task] + frames[::-1])] += 1
+
+    if args.folded:
+        with open(args.folded, "w") as f:
+            for stack, count in sorted(folded.items()):
+                f.write("%s %d\n" % (stack, count))
+    if args.svg:
+        write_svg(args.svg, folded, "%s - %d samples" % (header.lstrip("# ") or args.samples, len(samples)))
+
+    n = len(samples)
+    print("%s, %d samples" % (header.lstrip("# ") or args.samples, n))
+    print("%7s %7s  %s" % ("self%", "total%", "function"))
+    for name, count in self_count.most_common(args.top):
+        print("%6.1f%% %6.1f%%  %s" % (100.0 * count / n, 100.0 * total_count[name] / n, name))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest="cmd", required=True)
+
+    p = sub.add_parser("record", help="collect samples from a device")
+    p.add_argument("url", help="device base URL, e.g. http://192.168.1.50")
+    p.add_argument("--hz", type=int, default=100, help="sampling rate (1-1000, default 100)")
+    p.add_argument("--seconds", type=float, default=10.0)
+    p.add_argument("--interval", type=float, default=0.5, help="drain period; keep hz * interval under 256")
+    p.add_argument("-o", "--output", default="samples.txt")
+    p.set_defaults(func=record)
+
+    p = sub.add_parser("report", help="symbolize samples and draw a flamegraph")
+    p.add_argument("samples")
+    p.add_argument("--elf", required=True, help="ELF of the running build")
+    p.add_argument("--addr2line", help="addr2line to use (default: found from the ELF type)")
+    p.add_argument("--folded", help="write folded stacks here")
+    p.add_argument("--svg", help="write an SVG flamegraph here")
+    p.add_argument("--top", type=int, default=25, help="functions in the table (by self time)")
+    p.set_defaults(func=report)
+
+    args = parser.parse_args()
+    args.func(args)
+
+
+if __name__ == "__main__":
+    main()
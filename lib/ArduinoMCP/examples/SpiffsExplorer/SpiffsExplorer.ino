@@ -29,13 +29,15 @@
 
 #include <WiFi.h>
 #include <ArduinoMCP.h>
+#include <McpZFile.h>
 
 // WiFi credentials
 const char* ssid = "YOUR_WIFI_SSID";
 const char* password = "YOUR_WIFI_PASSWORD";
 
-// ArduinoMCP instance
-ArduinoMCP mcp;
+// ArduinoMCP instance (not "mcp": the helpers such as McpZFile.h live in
+// namespace mcp)
+ArduinoMCP mcpServer;
 
 void setup() {
     Serial.begin(115200);
@@ -70,23 +72,23 @@ void setup() {
 
     // Initialize ArduinoMCP
     // Option 1: Use default port 80
-    if (mcp.begin()) {
+    if (mcpServer.begin()) {
         Serial.println("ArduinoMCP initialized successfully!");
     } else {
         Serial.println("ArduinoMCP initialization failed!");
     }
 
     // Option 2: Use custom port
-    // mcp.begin(8080);
+    // mcpServer.begin(8080);
 
     // Option 3: Use existing WebServer
     // WebServer server(80);
-    // mcp.begin(&server);
+    // mcpServer.begin(&server);
     // server.begin();
 
     // Optional: Set device name and type
-    mcp.setDeviceName("My ESP32 Device");
-    mcp.setDeviceType("ESP32-WROOM-32");
+    mcpServer.setDeviceName("My ESP32 Device");
+    mcpServer.setDeviceType("ESP32-WROOM-32");
 
     // Create a sample file if SPIFFS is empty
     createSampleFiles();
@@ -115,7 +117,7 @@ void setup() {
 
 void loop() {
     // Handle incoming HTTP requests
-    mcp.handle();
+    mcpServer.handle();
 
     // Your other code here...
 }
@@ -173,9 +175,10 @@ void createSampleFiles() {
         Serial.println("  Created /readme.txt");
     }
 
-    // Create data.csv
-    File dataFile = SPIFFS.open("/data.csv", "w");
-    if (dataFile) {
+    // Create data.csv as a compressed file (McpZFile); /api/spiffs/read
+    // returns it decompressed, or as gzip to browsers
+    mcp::zfile::Writer dataFile;
+    if (dataFile.open(SPIFFS, "/data.csv")) {
         dataFile.println("timestamp,temperature,humidity");
         dataFile.println("1000,25.5,60");
         dataFile.println("2000,26.1,58");
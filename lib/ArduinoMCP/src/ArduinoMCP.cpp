@@ -8,6 +8,60 @@
  */
 
 #include "ArduinoMCP.h"
+#include "McpArena.h"
+#include "McpChanges.h"
+#include "McpEscape.h"
+#include "McpKv.h"
+#include "McpMem.h"
+#include "McpPowerSave.h"
+#include "McpProfiler.h"
+#include "McpTls.h"
+#include "McpTrace.h"
+#include "McpUpload.h"
+#include "McpZFile.h"
+
+#if MCP_ZFILE
+// McpZFile sinks for /api/spiffs/read
+static bool appendToText(void* ctx, const uint8_t* data, size_t len) {
+    mcp::arena::Text& text = *static_cast<mcp::arena::Text*>(ctx);
+    text.append(reinterpret_cast<const char*>(data), len);
+    return !text.failed();
+}
+
+static bool sendToClient(void* ctx, const uint8_t* data, size_t len) {
+    static_cast<WebServer*>(ctx)->sendContent(reinterpret_cast<const char*>(data), len);
+    return true;
+}
+#endif
+
+#if MCP_SPIFFS
+// Change feed entry for a mutation (nothing without MCP_CHANGES)
+static void recordChange(mcp::changes::Op op, const char* path, size_t size = 0, const char* from = nullptr) {
+#if MCP_CHANGES
+    mcp::changes::record(op, path, size, from);
+#else
+    (void)op;
+    (void)path;
+    (void)size;
+    (void)from;
+#endif
+}
+
+// [offset, offset + length) of a plain file
+static bool readRange(File& file, size_t offset, size_t length, mcp::arena::Text& content) {
+    if (offset >= file.size()) return true;
+    if (length > file.size() - offset) length = file.size() - offset;
+    if (!file.seek(offset) || !content.reserve(length)) return false;
+    uint8_t buf[256];
+    while (length > 0) {
+        size_t n = file.read(buf, length < sizeof(buf) ? length : sizeof(buf));
+        if (n == 0) return false;
+        content.append(reinterpret_cast<const char*>(buf), n);
+        length -= n;
+    }
+    return true;
+}
+#endif
 
 // Constructor
 ArduinoMCP::ArduinoMCP()
@@ -25,6 +79,16 @@ ArduinoMCP::~ArduinoMCP() {
     end();
 }
 
+// State shared by every begin()
+static void beginModules() {
+    mcp::mem::begin();
+    mcp::arena::begin();
+#if MCP_POWERSAVE
+    // A sketch may have started it first, with its own mode
+    if (!mcp::powersave::running()) mcp::powersave::begin();
+#endif
+}
+
 // Initialize with existing WebServer
 bool ArduinoMCP::begin(WebServer* server, bool mountSpiffs) {
     if (_initialized) {
@@ -38,14 +102,10 @@ bool ArduinoMCP::begin(WebServer* server, bool mountSpiffs) {
 
     _server = server;
     _ownsServer = false;
+    beginModules();
 
-    // Mount SPIFFS if requested
-    if (mountSpiffs) {
-        if (!SPIFFS.begin(true)) {
-            Serial.println("[ArduinoMCP] Error: Failed to mount SPIFFS");
-            return false;
-        }
-        Serial.println("[ArduinoMCP] SPIFFS mounted");
+    if (!mountFs(mountSpiffs)) {
+        return false;
     }
 
     setupRoutes();
@@ -60,18 +120,14 @@ bool ArduinoMCP::begin(uint16_t port, bool mountSpiffs) {
         return true;
     }
 
-    // Mount SPIFFS if requested
-    if (mountSpiffs) {
-        if (!SPIFFS.begin(true)) {
-            Serial.println("[ArduinoMCP] Error: Failed to mount SPIFFS");
-            return false;
-        }
-        Serial.println("[ArduinoMCP] SPIFFS mounted");
+    if (!mountFs(mountSpiffs)) {
+        return false;
     }
 
     // Create new WebServer
     _server = new WebServer(port);
     _ownsServer = true;
+    beginModules();
 
     setupRoutes();
     _server->begin();
@@ -81,15 +137,75 @@ bool ArduinoMCP::begin(uint16_t port, bool mountSpiffs) {
     return true;
 }
 
+#if MCP_TLS
+// Initialize with new WebServer on loopback, behind the HTTPS front
+bool ArduinoMCP::beginSecure(const char* certPem, const char* keyPem, uint16_t port, uint16_t httpPort,
+                             bool mountSpiffs) {
+    if (_initialized) {
+        return true;
+    }
+
+    if (!mountFs(mountSpiffs)) {
+        return false;
+    }
+
+    // Only the front reaches it
+    _server = new WebServer(IPAddress(127, 0, 0, 1), httpPort);
+    _ownsServer = true;
+    beginModules();
+
+    setupRoutes();
+    _server->begin();
+
+    if (!mcp::tls::begin(port, httpPort, certPem, keyPem)) {
+        Serial.println("[ArduinoMCP] Error: HTTPS setup failed");
+        end();
+        return false;
+    }
+
+    _initialized = true;
+    Serial.printf("[ArduinoMCP] Initialized on port %d (HTTPS)\n", port);
+    return true;
+}
+#endif
+
+// Mount SPIFFS if requested
+bool ArduinoMCP::mountFs(bool mountSpiffs) {
+#if MCP_SPIFFS
+    if (mountSpiffs) {
+        if (!SPIFFS.begin(true)) {
+            Serial.println("[ArduinoMCP] Error: Failed to mount SPIFFS");
+            return false;
+        }
+        Serial.println("[ArduinoMCP] SPIFFS mounted");
+    }
+#else
+    (void)mountSpiffs;
+#endif
+    return true;
+}
+
 // Handle incoming requests
 void ArduinoMCP::handle() {
     if (_initialized && _server != nullptr) {
         _server->handleClient();
+#if MCP_CHANGES
+        mcp::changes::poll();
+#endif
+#if MCP_TLS
+        mcp::tls::poll();
+#endif
+#if MCP_POWERSAVE
+        mcp::powersave::poll();
+#endif
     }
 }
 
 // Stop and cleanup
 void ArduinoMCP::end() {
+#if MCP_TLS
+    mcp::tls::end();
+#endif
     if (_ownsServer && _server != nullptr) {
         _server->stop();
         delete _server;
@@ -97,72 +213,158 @@ void ArduinoMCP::end() {
     _server = nullptr;
     _ownsServer = false;
     _initialized = false;
+    mcp::arena::end();
 }
 
 // Setup API routes
 void ArduinoMCP::setupRoutes() {
     if (_server == nullptr) return;
 
-    // SPIFFS API endpoints
-    _server->on("/api/spiffs/list", HTTP_GET, [this]() { handleSpiffsList(); });
-    _server->on("/api/spiffs/read", HTTP_GET, [this]() { handleSpiffsRead(); });
-    _server->on("/api/spiffs/write", HTTP_POST, [this]() { handleSpiffsWrite(); });
-    _server->on("/api/spiffs/delete", HTTP_DELETE, [this]() { handleSpiffsDelete(); });
-    _server->on("/api/spiffs/info", HTTP_GET, [this]() { handleSpiffsInfo(); });
+#if MCP_SPIFFS
+#if MCP_ZFILE
+    // Accept-Encoding decides whether compressed files go out as gzip. The
+    // WebServer keeps only the headers named here: a sketch that calls
+    // collectHeaders() itself must list Accept-Encoding too.
+    static const char* kHeaders[] = {"Accept-Encoding"};
+    _server->collectHeaders(kHeaders, 1);
+#endif
 
+    // SPIFFS API endpoints
+    addRoute("/api/spiffs/list", HTTP_GET, [this]() { handleSpiffsList(); });
+    addRoute("/api/spiffs/read", HTTP_GET, [this]() { handleSpiffsRead(); });
+    addRoute("/api/spiffs/write", HTTP_POST, [this]() { handleSpiffsWrite(); });
+#if MCP_UPLOAD
+    const uint8_t upload = mcp::arena::addRoute("/api/spiffs/upload", "POST");
+    _server->on("/api/spiffs/upload", HTTP_POST, [this, upload]() {
+            mcp::arena::Scope scope(upload);
+#if MCP_POWERSAVE
+            mcp::powersave::Hold hold;
+#endif
+            handleSpiffsUpload();
+        },
+        [this]() {
+#if MCP_POWERSAVE
+            mcp::powersave::Hold hold;
+#endif
+            mcp::upload::handleData(*_server);
+        });
+    addPreflight("/api/spiffs/upload");
+#endif
+    addRoute("/api/spiffs/delete", HTTP_DELETE, [this]() { handleSpiffsDelete(); });
+#if MCP_CHANGES
+    addRoute("/api/spiffs/changes", HTTP_GET, [this]() { handleSpiffsChanges(); });
+#endif
+    addRoute("/api/spiffs/info", HTTP_GET, [this]() { handleSpiffsInfo(); });
+#endif
+
+#if MCP_DEVICE
     // Device API endpoints
-    _server->on("/api/device/info", HTTP_GET, [this]() { handleDeviceInfo(); });
-    _server->on("/api/device/restart", HTTP_POST, [this]() { handleDeviceRestart(); });
-
-    // CORS preflight
-    _server->on("/api/spiffs/list", HTTP_OPTIONS, [this]() { handleOptions(); });
-    _server->on("/api/spiffs/read", HTTP_OPTIONS, [this]() { handleOptions(); });
-    _server->on("/api/spiffs/write", HTTP_OPTIONS, [this]() { handleOptions(); });
-    _server->on("/api/spiffs/delete", HTTP_OPTIONS, [this]() { handleOptions(); });
-    _server->on("/api/spiffs/info", HTTP_OPTIONS, [this]() { handleOptions(); });
-    _server->on("/api/device/info", HTTP_OPTIONS, [this]() { handleOptions(); });
-    _server->on("/api/device/restart", HTTP_OPTIONS, [this]() { handleOptions(); });
+    addRoute("/api/device/info", HTTP_GET, [this]() { handleDeviceInfo(); });
+    addRoute("/api/device/restart", HTTP_POST, [this]() { handleDeviceRestart(); });
+#endif
+
+#if MCP_KV
+    // Key/value API endpoints (NVS)
+    addRoute("/api/kv/get", HTTP_GET, [this]() { handleKvGet(); });
+    addRoute("/api/kv/set", HTTP_POST, [this]() { handleKvSet(); });
+    addRoute("/api/kv/delete", HTTP_DELETE, [this]() { handleKvDelete(); });
+    addRoute("/api/kv/list", HTTP_GET, [this]() { handleKvList(); });
+#endif
+#if MCP_TRACE
+    addRoute("/api/trace", HTTP_GET, [this]() { handleTrace(); });
+#endif
+#if MCP_PROFILE
+    addRoute("/api/profile/start", HTTP_POST, [this]() { handleProfileStart(); });
+    addRoute("/api/profile/stop", HTTP_POST, [this]() { handleProfileStop(); });
+    addRoute("/api/profile/samples", HTTP_GET, [this]() { handleProfileSamples(); });
+#endif
+#if MCP_TLS
+    addRoute("/api/tls/stats", HTTP_GET, [this]() { handleTlsStats(); });
+#endif
+#if MCP_ARENA_STATS
+    addRoute("/api/arena/stats", HTTP_GET, [this]() { handleArenaStats(); });
+#endif
+#if MCP_MEM_STATS
+    addRoute("/api/mem/stats", HTTP_GET, [this]() { handleMemStats(); });
+#endif
+#if MCP_POWERSAVE
+    addRoute("/api/power/stats", HTTP_GET, [this]() { handlePowerStats(); });
+#endif
 
     Serial.println("[ArduinoMCP] API routes registered");
 }
 
+static const char* methodName(HTTPMethod method) {
+    switch (method) {
+        case HTTP_GET: return "GET";
+        case HTTP_POST: return "POST";
+        case HTTP_PUT: return "PUT";
+        case HTTP_DELETE: return "DELETE";
+        default: return "ANY";
+    }
+}
+
+// Register a route and its CORS preflight; its temporaries come from the
+// request arena (McpArena.h), reset when the handler returns, and Wi-Fi
+// power save stays off while it runs (McpPowerSave.h)
+void ArduinoMCP::addRoute(const char* uri, HTTPMethod method, WebServer::THandlerFunction fn) {
+    const uint8_t route = mcp::arena::addRoute(uri, methodName(method));
+    _server->on(uri, method, [fn, route]() {
+        mcp::arena::Scope scope(route);
+#if MCP_POWERSAVE
+        mcp::powersave::Hold hold;
+#endif
+        fn();
+    });
+    addPreflight(uri);
+}
+
+// OPTIONS route for uri (one shared handler)
+void ArduinoMCP::addPreflight(const char* uri) {
+#if MCP_CORS
+    _server->on(uri, HTTP_OPTIONS, [this]() { handleOptions(); });
+#else
+    (void)uri;
+#endif
+}
+
 // Add CORS headers
 void ArduinoMCP::addCorsHeaders() {
+#if MCP_CORS
     if (_corsEnabled && _server != nullptr) {
         _server->sendHeader("Access-Control-Allow-Origin", "*");
         _server->sendHeader("Access-Control-Allow-Methods", "GET, POST, DELETE, OPTIONS");
         _server->sendHeader("Access-Control-Allow-Headers", "Content-Type");
     }
+#endif
 }
 
+#if MCP_CORS
 // Handle OPTIONS request (CORS preflight)
 void ArduinoMCP::handleOptions() {
     addCorsHeaders();
     _server->send(204, "text/plain", "");
 }
+#endif
 
 // Send JSON response
-void ArduinoMCP::sendJsonResponse(int code, const String& json) {
+void ArduinoMCP::sendJsonResponse(int code, const char* json, size_t len) {
     addCorsHeaders();
-    _server->send(code, "application/json", json);
+    _server->send_P(code, "application/json", json, len);
 }
 
 // Send JSON error response
-void ArduinoMCP::sendJsonError(int code, const String& message) {
-    String json = "{\"ok\":false,\"error\":\"" + message + "\"}";
-    sendJsonResponse(code, json);
+void ArduinoMCP::sendJsonError(int code, const char* message) {
+    mcp::arena::Text json(32 + strlen(message));
+    json.append("{\"ok\":false,\"error\":\"").appendJson(message).append("\"}");
+    sendJsonResponse(code, json.c_str(), json.length());
 }
 
+#if MCP_SPIFFS
 // Handle /api/spiffs/list
 void ArduinoMCP::handleSpiffsList() {
-    String path = "/";
-    if (_server->hasArg("path")) {
-        path = _server->arg("path");
-    }
-
-    if (!path.startsWith("/")) {
-        path = "/" + path;
-    }
+    MCP_TRACE_SCOPE("mcp.spiffs.list");
+    const char* path = _server->hasArg("path") ? mcp::arena::path(_server->arg("path")) : "/";
 
     File root = SPIFFS.open(path);
     if (!root) {
@@ -170,45 +372,52 @@ void ArduinoMCP::handleSpiffsList() {
         return;
     }
 
-    String json = "{\"ok\":true,\"path\":\"" + path + "\",\"files\":[";
+    mcp::arena::Text json(512);
+    json.append("{\"ok\":true,\"path\":\"").appendJson(path).append("\",\"files\":[");
     bool first = true;
 
     // SPIFFS doesn't have real directories, list all files
     File file = root.openNextFile();
     while (file) {
-        if (!first) json += ",";
+        if (!first) json.append(',');
         first = false;
 
-        String fileName = file.name();
+        const char* fileName = file.name();
         // Remove leading slash for display
-        if (fileName.startsWith("/")) {
-            fileName = fileName.substring(1);
+        if (fileName[0] == '/') fileName++;
+
+        json.append("{\"name\":\"").appendJson(fileName);
+        json.append("\",\"size\":").appendUInt(file.size());
+        json.append(",\"isDir\":").append(file.isDirectory() ? "true" : "false");
+#if MCP_ZFILE
+        mcp::zfile::Info info;
+        if (!file.isDirectory() && mcp::zfile::stat(file, info)) {
+            json.append(",\"compressed\":true,\"rawSize\":").appendUInt(info.rawSize);
         }
-
-        json += "{\"name\":\"" + fileName + "\"";
-        json += ",\"size\":" + String(file.size());
-        json += ",\"isDir\":" + String(file.isDirectory() ? "true" : "false");
-        json += "}";
+#endif
+        json.append('}');
 
         file = file.openNextFile();
     }
     root.close();
 
-    json += "]}";
-    sendJsonResponse(200, json);
+    json.append("]}");
+    if (json.failed()) {
+        sendJsonError(500, "Out of memory");
+        return;
+    }
+    sendJsonResponse(200, json.c_str(), json.length());
 }
 
 // Handle /api/spiffs/read
 void ArduinoMCP::handleSpiffsRead() {
+    MCP_TRACE_SCOPE("mcp.spiffs.read");
     if (!_server->hasArg("path")) {
         sendJsonError(400, "path parameter required");
         return;
     }
 
-    String path = _server->arg("path");
-    if (!path.startsWith("/")) {
-        path = "/" + path;
-    }
+    const char* path = mcp::arena::path(_server->arg("path"));
 
     if (!SPIFFS.exists(path)) {
         sendJsonError(404, "File not found");
@@ -221,53 +430,111 @@ void ArduinoMCP::handleSpiffsRead() {
         return;
     }
 
-    String content = file.readString();
-    file.close();
+    // Optional byte range (of the decompressed contents for compressed files)
+    const bool ranged = _server->hasArg("offset") || _server->hasArg("length");
+    const size_t offset = strtoul(_server->arg("offset").c_str(), nullptr, 10);
+    const size_t length = _server->hasArg("length") ? strtoul(_server->arg("length").c_str(), nullptr, 10) : SIZE_MAX;
 
     // Determine content type
-    String contentType = getContentType(path);
+    const char* contentType = getContentType(path);
+    const bool isJson = strcmp(contentType, "application/json") == 0;
+
+    mcp::arena::Text content;
+    bool ok = true;
+#if MCP_ZFILE
+    const bool compressed = mcp::zfile::isCompressed(file);
+    if (compressed && !isJson) {
+        sendCompressedFile(file, contentType, offset, length, ranged);
+        file.close();
+        return;
+    }
+    if (compressed) {
+        ok = mcp::zfile::read(file, offset, length, appendToText, &content);
+    } else
+#else
+    const bool compressed = false;
+#endif
+    {
+        ok = readRange(file, ranged ? offset : 0, length, content);
+    }
+    file.close();
+    if (!ok || content.failed()) {
+        sendJsonError(500, compressed ? "Corrupt compressed file or out of memory" : "Failed to read file");
+        return;
+    }
 
     addCorsHeaders();
 
-    if (contentType == "application/json") {
+    if (isJson) {
         // Return as JSON wrapped response
-        // Escape special characters in content
-        String escapedContent = "";
-        for (size_t i = 0; i < content.length(); i++) {
-            char c = content.charAt(i);
-            if (c == '"') escapedContent += "\\\"";
-            else if (c == '\\') escapedContent += "\\\\";
-            else if (c == '\n') escapedContent += "\\n";
-            else if (c == '\r') escapedContent += "\\r";
-            else if (c == '\t') escapedContent += "\\t";
-            else escapedContent += c;
-        }
-        String json = "{\"ok\":true,\"path\":\"" + path + "\",\"content\":\"" + escapedContent + "\"}";
-        _server->send(200, "application/json", json);
+        mcp::arena::Text json(strlen(path) + content.length() + 48);
+        json.append("{\"ok\":true,\"path\":\"").appendJson(path);
+        json.append("\",\"content\":\"").appendJson(content.c_str(), content.length());
+        json.append("\"}");
+        _server->send_P(200, "application/json", json.c_str(), json.length());
     } else {
         // Return raw content
-        _server->send(200, contentType, content);
+        _server->send_P(200, contentType, content.c_str(), content.length());
     }
 }
 
 // Handle /api/spiffs/write
 void ArduinoMCP::handleSpiffsWrite() {
+    MCP_TRACE_SCOPE("mcp.spiffs.write");
     if (!_server->hasArg("path")) {
         sendJsonError(400, "path parameter required");
         return;
     }
 
-    String path = _server->arg("path");
-    if (!path.startsWith("/")) {
-        path = "/" + path;
-    }
+    const char* path = mcp::arena::path(_server->arg("path"));
 
     String content = _server->arg("plain");
     if (content.length() == 0 && _server->hasArg("content")) {
         content = _server->arg("content");
     }
 
-    File file = SPIFFS.open(path, "w");
+    // append=1 keeps the file's format; compress=1 creates a compressed file
+    const bool append = _server->arg("append") == "1";
+    mcp::arena::Text json(64 + strlen(path));
+#if MCP_ZFILE
+    bool compress = _server->arg("compress") == "1";
+    if (append && SPIFFS.exists(path)) {
+        File existing = SPIFFS.open(path, "r");
+        const bool isCompressed = existing && mcp::zfile::isCompressed(existing);
+        existing.close();
+        if (compress && !isCompressed) {
+            sendJsonError(409, "File exists and is not compressed");
+            return;
+        }
+        compress = isCompressed;
+    }
+
+    if (compress) {
+        mcp::zfile::Writer writer;
+        if (!writer.open(SPIFFS, path, append)) {
+            sendJsonError(500, "Failed to open compressed file");
+            return;
+        }
+        writer.print(content);
+        if (!writer.close()) {
+            sendJsonError(500, "Failed to write file");
+            return;
+        }
+        recordChange(append ? mcp::changes::Op::Append : mcp::changes::Op::Write, path, writer.rawBytes());
+        json.append("{\"ok\":true,\"path\":\"").appendJson(path);
+        json.append("\",\"written\":").appendUInt(writer.rawBytes());
+        json.append(",\"stored\":").appendUInt(writer.storedBytes()).append(",\"compressed\":true}");
+        sendJsonResponse(200, json.c_str(), json.length());
+        return;
+    }
+#else
+    if (_server->arg("compress") == "1") {
+        sendJsonError(501, "Built without compressed files (MCP_ZFILE)");
+        return;
+    }
+#endif
+
+    File file = SPIFFS.open(path, append ? "a" : "w");
     if (!file) {
         sendJsonError(500, "Failed to create file");
         return;
@@ -275,22 +542,55 @@ void ArduinoMCP::handleSpiffsWrite() {
 
     size_t written = file.print(content);
     file.close();
+    recordChange(append ? mcp::changes::Op::Append : mcp::changes::Op::Write, path, written);
 
-    String json = "{\"ok\":true,\"path\":\"" + path + "\",\"written\":" + String(written) + "}";
-    sendJsonResponse(200, json);
+    json.append("{\"ok\":true,\"path\":\"").appendJson(path);
+    json.append("\",\"written\":").appendUInt(written).append('}');
+    sendJsonResponse(200, json.c_str(), json.length());
 }
 
+#if MCP_UPLOAD
+// Handle /api/spiffs/upload (after the parts went through mcp::upload::handleData)
+void ArduinoMCP::handleSpiffsUpload() {
+    MCP_TRACE_SCOPE("mcp.spiffs.upload");
+    addCorsHeaders();
+    mcp::upload::handleDone(*_server);
+}
+#endif
+
+#if MCP_ZFILE
+// Send a compressed file: as stored (gzip) when the client accepts it and
+// wants all of it, otherwise decompressed
+void ArduinoMCP::sendCompressedFile(File& file, const char* contentType, size_t offset, size_t length,
+                                    bool ranged) {
+    addCorsHeaders();
+    String accept = _server->header("Accept-Encoding");
+    if (!ranged && accept.indexOf("gzip") >= 0 && accept.indexOf("gzip;q=0") < 0) {
+        mcp::zfile::sendGzip(*_server, file, contentType);
+        return;
+    }
+
+    mcp::zfile::Info info;
+    mcp::zfile::stat(file, info);
+    size_t n = 0;
+    if (offset < info.rawSize) n = length < info.rawSize - offset ? length : info.rawSize - offset;
+    _server->sendHeader("Vary", "Accept-Encoding");
+    _server->setContentLength(n);
+    _server->send(200, contentType, "");
+    // A corrupt block ends the body early; the client sees it as truncated.
+    mcp::zfile::read(file, offset, n, sendToClient, _server);
+}
+#endif
+
 // Handle /api/spiffs/delete
 void ArduinoMCP::handleSpiffsDelete() {
+    MCP_TRACE_SCOPE("mcp.spiffs.delete");
     if (!_server->hasArg("path")) {
         sendJsonError(400, "path parameter required");
         return;
     }
 
-    String path = _server->arg("path");
-    if (!path.startsWith("/")) {
-        path = "/" + path;
-    }
+    const char* path = mcp::arena::path(_server->arg("path"));
 
     if (!SPIFFS.exists(path)) {
         sendJsonError(404, "File not found");
@@ -298,43 +598,63 @@ void ArduinoMCP::handleSpiffsDelete() {
     }
 
     if (SPIFFS.remove(path)) {
-        String json = "{\"ok\":true,\"path\":\"" + path + "\"}";
-        sendJsonResponse(200, json);
+        recordChange(mcp::changes::Op::Delete, path);
+        mcp::arena::Text json(32 + strlen(path));
+        json.append("{\"ok\":true,\"path\":\"").appendJson(path).append("\"}");
+        sendJsonResponse(200, json.c_str(), json.length());
     } else {
         sendJsonError(500, "Failed to delete file");
     }
 }
 
+#if MCP_CHANGES
+// Handle /api/spiffs/changes (may answer later, from handle())
+void ArduinoMCP::handleSpiffsChanges() {
+    MCP_TRACE_SCOPE("mcp.spiffs.changes");
+    addCorsHeaders();
+    mcp::changes::handleGet(*_server, _corsEnabled && MCP_CORS);
+}
+#endif
+
 // Handle /api/spiffs/info
 void ArduinoMCP::handleSpiffsInfo() {
+    MCP_TRACE_SCOPE("mcp.spiffs.info");
     size_t totalBytes = SPIFFS.totalBytes();
     size_t usedBytes = SPIFFS.usedBytes();
     size_t freeBytes = totalBytes - usedBytes;
 
-    String json = "{\"ok\":true";
-    json += ",\"totalBytes\":" + String(totalBytes);
-    json += ",\"usedBytes\":" + String(usedBytes);
-    json += ",\"freeBytes\":" + String(freeBytes);
-    json += "}";
+    mcp::arena::Text json(96);
+    json.append("{\"ok\":true");
+    json.append(",\"totalBytes\":").appendUInt(totalBytes);
+    json.append(",\"usedBytes\":").appendUInt(usedBytes);
+    json.append(",\"freeBytes\":").appendUInt(freeBytes);
+    json.append('}');
 
-    sendJsonResponse(200, json);
+    sendJsonResponse(200, json.c_str(), json.length());
 }
 
+#endif // MCP_SPIFFS
+
+#if MCP_DEVICE
 // Handle /api/device/info
 void ArduinoMCP::handleDeviceInfo() {
-    String json = "{\"ok\":true";
-    json += ",\"name\":\"" + String(_deviceName) + "\"";
-    json += ",\"type\":\"" + String(_deviceType) + "\"";
-    json += ",\"chipModel\":\"" + String(ESP.getChipModel()) + "\"";
-    json += ",\"chipRevision\":" + String(ESP.getChipRevision());
-    json += ",\"cpuFreqMHz\":" + String(ESP.getCpuFreqMHz());
-    json += ",\"heapSize\":" + String(ESP.getHeapSize());
-    json += ",\"freeHeap\":" + String(ESP.getFreeHeap());
-    json += ",\"minFreeHeap\":" + String(ESP.getMinFreeHeap());
-    json += ",\"sdkVersion\":\"" + String(ESP.getSdkVersion()) + "\"";
-    json += ",\"flashChipSize\":" + String(ESP.getFlashChipSize());
-    json += ",\"sketchSize\":" + String(ESP.getSketchSize());
-    json += ",\"freeSketchSpace\":" + String(ESP.getFreeSketchSpace());
+    MCP_TRACE_SCOPE("mcp.device.info");
+    mcp::arena::Text json(384);
+    json.append("{\"ok\":true");
+    json.append(",\"name\":\"").appendJson(_deviceName).append('"');
+    json.append(",\"type\":\"").appendJson(_deviceType).append('"');
+    json.append(",\"chipModel\":\"").appendJson(ESP.getChipModel()).append('"');
+    json.append(",\"chipRevision\":").appendUInt(ESP.getChipRevision());
+    json.append(",\"cpuFreqMHz\":").appendUInt(ESP.getCpuFreqMHz());
+    json.append(",\"heapSize\":").appendUInt(ESP.getHeapSize());
+    json.append(",\"freeHeap\":").appendUInt(ESP.getFreeHeap());
+    json.append(",\"minFreeHeap\":").appendUInt(ESP.getMinFreeHeap());
+    json.append(",\"psramSize\":").appendUInt(ESP.getPsramSize());
+    json.append(",\"freePsram\":").appendUInt(ESP.getFreePsram());
+    json.append(",\"sdkVersion\":\"").appendJson(ESP.getSdkVersion()).append('"');
+    json.append(",\"flashChipSize\":").appendUInt(ESP.getFlashChipSize());
+    json.append(",\"sketchSize\":").appendUInt(ESP.getSketchSize());
+    json.append(",\"freeSketchSpace\":").appendUInt(ESP.getFreeSketchSpace());
 
     // MAC address
     uint8_t mac[6];
@@ -342,35 +662,132 @@ void ArduinoMCP::handleDeviceInfo() {
     char macStr[18];
     snprintf(macStr, sizeof(macStr), "%02X:%02X:%02X:%02X:%02X:%02X",
              mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
-    json += ",\"macAddress\":\"" + String(macStr) + "\"";
+    json.append(",\"macAddress\":\"").append(macStr).append('"');
 
     // Uptime
-    json += ",\"uptimeMs\":" + String(millis());
+    json.append(",\"uptimeMs\":").appendUInt(millis());
 
-    json += "}";
-    sendJsonResponse(200, json);
+    json.append('}');
+    sendJsonResponse(200, json.c_str(), json.length());
 }
 
 // Handle /api/device/restart
 void ArduinoMCP::handleDeviceRestart() {
-    String json = "{\"ok\":true,\"message\":\"Restarting in 1 second...\"}";
-    sendJsonResponse(200, json);
+    MCP_TRACE_SCOPE("mcp.device.restart");
+    static const char kJson[] = "{\"ok\":true,\"message\":\"Restarting in 1 second...\"}";
+    sendJsonResponse(200, kJson, sizeof(kJson) - 1);
 
     delay(1000);
     ESP.restart();
 }
 
+#endif // MCP_DEVICE
+
+#if MCP_KV
+// Handle /api/kv/get
+void ArduinoMCP::handleKvGet() {
+    addCorsHeaders();
+    mcp::kv::handleGet(*_server);
+}
+
+// Handle /api/kv/set
+void ArduinoMCP::handleKvSet() {
+    addCorsHeaders();
+    mcp::kv::handleSet(*_server);
+}
+
+// Handle /api/kv/delete
+void ArduinoMCP::handleKvDelete() {
+    addCorsHeaders();
+    mcp::kv::handleDelete(*_server);
+}
+
+// Handle /api/kv/list
+void ArduinoMCP::handleKvList() {
+    addCorsHeaders();
+    mcp::kv::handleList(*_server);
+}
+#endif // MCP_KV
+
+#if MCP_TRACE
+// Handle /api/trace
+void ArduinoMCP::handleTrace() {
+    addCorsHeaders();
+    mcp::trace::sendChromeJson(*_server);
+}
+#endif
+
+#if MCP_PROFILE
+// Handle /api/profile/start
+void ArduinoMCP::handleProfileStart() {
+    addCorsHeaders();
+    mcp::profiler::handleStart(*_server);
+}
+
+// Handle /api/profile/stop
+void ArduinoMCP::handleProfileStop() {
+    addCorsHeaders();
+    mcp::profiler::handleStop(*_server);
+}
+
+// Handle /api/profile/samples
+void ArduinoMCP::handleProfileSamples() {
+    addCorsHeaders();
+    mcp::profiler::sendSamples(*_server);
+}
+#endif
+
+#if MCP_TLS
+// Handle /api/tls/stats
+void ArduinoMCP::handleTlsStats() {
+    addCorsHeaders();
+    mcp::tls::handleStats(*_server);
+}
+#endif
+
+#if MCP_ARENA_STATS
+// Handle /api/arena/stats
+void ArduinoMCP::handleArenaStats() {
+    addCorsHeaders();
+    mcp::arena::handleStats(*_server);
+}
+#endif
+
+#if MCP_MEM_STATS
+// Handle /api/mem/stats
+void ArduinoMCP::handleMemStats() {
+    addCorsHeaders();
+    mcp::mem::handleStats(*_server);
+}
+#endif
+
+#if MCP_POWERSAVE
+// Handle /api/power/stats
+void ArduinoMCP::handlePowerStats() {
+    addCorsHeaders();
+    mcp::powersave::handleStats(*_server);
+}
+#endif
+
+#if MCP_SPIFFS
 // Get content type from filename
-String ArduinoMCP::getContentType(const String& filename) {
-    if (filename.endsWith(".json")) return "application/json";
-    if (filename.endsWith(".html") || filename.endsWith(".htm")) return "text/html";
-    if (filename.endsWith(".css")) return "text/css";
-    if (filename.endsWith(".js")) return "application/javascript";
-    if (filename.endsWith(".txt")) return "text/plain";
-    if (filename.endsWith(".xml")) return "text/xml";
-    if (filename.endsWith(".png")) return "image/png";
-    if (filename.endsWith(".jpg") || filename.endsWith(".jpeg")) return "image/jpeg";
-    if (filename.endsWith(".gif")) return "image/gif";
-    if (filename.endsWith(".ico")) return "image/x-icon";
+static bool endsWith(const char* s, size_t len, const char* suffix) {
+    const size_t n = strlen(suffix);
+    return len >= n && strcmp(s + len - n, suffix) == 0;
+}
+
+const char* ArduinoMCP::getContentType(const char* filename) {
+    const size_t len = strlen(filename);
+    if (endsWith(filename, len, ".json")) return "application/json";
+    if (endsWith(filename, len, ".html") || endsWith(filename, len, ".htm")) return "text/html";
+    if (endsWith(filename, len, ".css")) return "text/css";
+    if (endsWith(filename, len, ".js")) return "application/javascript";
+    if (endsWith(filename, len, ".txt")) return "text/plain";
+    if (endsWith(filename, len, ".xml")) return "text/xml";
+    if (endsWith(filename, len, ".png")) return "image/png";
+    if (endsWith(filename, len, ".jpg") || endsWith(filename, len, ".jpeg")) return "image/jpeg";
+    if (endsWith(filename, len, ".gif")) return "image/gif";
+    if (endsWith(filename, len, ".ico")) return "image/x-icon";
     return "text/plain";
 }
+#endif
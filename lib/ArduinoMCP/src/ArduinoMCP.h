@@ -7,27 +7,60 @@
  * Usage:
  *   #include <ArduinoMCP.h>
  *
- *   ArduinoMCP mcp;
+ *   ArduinoMCP mcpServer;  // not "mcp": the helpers live in namespace mcp
  *
  *   void setup() {
  *     // Initialize WiFi first...
- *     mcp.begin();  // Uses existing WebServer on port 80
+ *     mcpServer.begin();  // Uses existing WebServer on port 80
  *     // or
- *     mcp.begin(8080);  // Creates new WebServer on port 8080
+ *     mcpServer.begin(8080);  // Creates new WebServer on port 8080
+ *     // or
+ *     mcpServer.beginSecure(certPem, keyPem);  // HTTPS on port 443 (MCP_TLS=1)
  *   }
  *
  *   void loop() {
- *     mcp.handle();  // Process incoming requests
+ *     mcpServer.handle();  // Process incoming requests (and answer waiting
+ *                          // /api/spiffs/changes requests)
  *   }
  *
  * API Endpoints provided:
  *   GET  /api/spiffs/list?path=/     - List files in directory
  *   GET  /api/spiffs/read?path=/file - Read file content
+ *        [&offset=0&length=n]          (byte range; compressed files are
+ *                                      decompressed, or sent as gzip to
+ *                                      clients that accept it)
  *   POST /api/spiffs/write?path=/file - Write file (body = content)
+ *        [&compress=1][&append=1]      (compressed file, see McpZFile.h)
+ *   POST /api/spiffs/upload?dir=/www  - Write every file of a multipart/form-data
+ *                                      body, streamed (see McpUpload.h)
  *   DELETE /api/spiffs/delete?path=/file - Delete file
+ *   GET  /api/spiffs/changes?since=0&wait=25000 - Changes after seq since,
+ *                                      waiting up to wait ms for one
+ *                                      (see McpChanges.h)
  *   GET  /api/spiffs/info            - Get storage info
  *   GET  /api/device/info            - Get device information
  *   POST /api/device/restart         - Restart device
+ *   GET  /api/kv/get?ns=app&key=k    - Read a typed NVS value
+ *   POST /api/kv/set?ns=app&key=k&type=u32&value=1 - Write one (see McpKv.h)
+ *   DELETE /api/kv/delete?ns=app[&key=k] - Delete a key or a namespace
+ *   GET  /api/kv/list[?ns=app]       - List keys, types and values
+ *   GET  /api/trace                  - Span trace as Chrome trace JSON
+ *                                      (builds with MCP_TRACE=1, see McpTrace.h)
+ *   POST /api/profile/start?hz=100   - Start the sampling profiler
+ *   POST /api/profile/stop           - Stop it
+ *   GET  /api/profile/samples        - Drain samples (text)
+ *                                      (builds with MCP_PROFILE=1, see McpProfiler.h)
+ *   GET  /api/tls/stats              - Handshakes, resumption and request latency
+ *                                      of the HTTPS front (beginSecure(), builds
+ *                                      with MCP_TLS=1, see McpTls.h)
+ *   GET  /api/arena/stats            - Request arena use per route (see McpArena.h)
+ *   GET  /api/mem/stats              - Heap by capability (internal, DMA, PSRAM) and
+ *                                      buffer placement (see McpMem.h)
+ *   GET  /api/power/stats            - Wi-Fi power save mode and time in each state
+ *                                      (see McpPowerSave.h)
+ *
+ * Endpoint groups can be left out at compile time (-DMCP_KV=0, ...): see
+ * McpConfig.h.
  *
  * @author warusakudeveroper
  * @version 1.0.0
@@ -39,8 +72,15 @@
 
 #include <Arduino.h>
 #include <WebServer.h>
+#include "McpConfig.h"
+#if MCP_SPIFFS
 #include <SPIFFS.h>
 #include <FS.h>
+#endif
+
+// The Mcp*.h module headers are included by ArduinoMCP.cpp only: they
+// declare namespace mcp, which would clash with sketches that still name
+// their instance "mcp".
 
 // Forward declaration
 class ArduinoMCP;
@@ -68,7 +108,8 @@ public:
      * Call this if you already have a WebServer instance
      *
      * @param server Pointer to existing WebServer
-     * @param mountSpiffs Whether to mount SPIFFS (default: true)
+     * @param mountSpiffs Whether to mount SPIFFS (default: true; ignored
+     *                    without MCP_SPIFFS)
      * @return true if initialization successful
      */
     bool begin(WebServer* server, bool mountSpiffs = true);
@@ -78,11 +119,30 @@ public:
      * Creates internal WebServer instance
      *
      * @param port HTTP server port (default: 80)
-     * @param mountSpiffs Whether to mount SPIFFS (default: true)
+     * @param mountSpiffs Whether to mount SPIFFS (default: true; ignored
+     *                    without MCP_SPIFFS)
      * @return true if initialization successful
      */
     bool begin(uint16_t port = 80, bool mountSpiffs = true);
 
+#if MCP_TLS
+    /**
+     * Initialize with new WebServer behind HTTPS (see McpTls.h)
+     * The WebServer listens on 127.0.0.1:httpPort only; clients use
+     * https on port, with keep-alive and session resumption
+     *
+     * @param certPem Server certificate, PEM
+     * @param keyPem Its private key, PEM
+     * @param port HTTPS port (default: 443)
+     * @param httpPort Loopback port of the WebServer (default: 8080)
+     * @param mountSpiffs Whether to mount SPIFFS (default: true; ignored
+     *                    without MCP_SPIFFS)
+     * @return true if initialization successful
+     */
+    bool beginSecure(const char* certPem, const char* keyPem, uint16_t port = 443, uint16_t httpPort = 8080,
+                     bool mountSpiffs = true);
+#endif
+
     /**
      * Handle incoming HTTP requests
      * Call this in loop()
@@ -132,26 +192,73 @@ private:
     const char* _deviceName;
     const char* _deviceType;
 
+    bool mountFs(bool mountSpiffs);
+
     // Setup all API routes
     void setupRoutes();
+    void addRoute(const char* uri, HTTPMethod method, WebServer::THandlerFunction fn);
+    void addPreflight(const char* uri);
 
     // Add CORS headers to response
     void addCorsHeaders();
 
     // API Handlers
+#if MCP_SPIFFS
     void handleSpiffsList();
     void handleSpiffsRead();
     void handleSpiffsWrite();
     void handleSpiffsDelete();
     void handleSpiffsInfo();
+#endif
+#if MCP_UPLOAD
+    void handleSpiffsUpload();
+#endif
+#if MCP_CHANGES
+    void handleSpiffsChanges();
+#endif
+#if MCP_DEVICE
     void handleDeviceInfo();
     void handleDeviceRestart();
+#endif
+#if MCP_KV
+    void handleKvGet();
+    void handleKvSet();
+    void handleKvDelete();
+    void handleKvList();
+#endif
+#if MCP_TRACE
+    void handleTrace();
+#endif
+#if MCP_PROFILE
+    void handleProfileStart();
+    void handleProfileStop();
+    void handleProfileSamples();
+#endif
+#if MCP_TLS
+    void handleTlsStats();
+#endif
+#if MCP_ARENA_STATS
+    void handleArenaStats();
+#endif
+#if MCP_MEM_STATS
+    void handleMemStats();
+#endif
+#if MCP_POWERSAVE
+    void handlePowerStats();
+#endif
+#if MCP_CORS
     void handleOptions();
+#endif
+#if MCP_ZFILE
+    void sendCompressedFile(File& file, const char* contentType, size_t offset, size_t length, bool ranged);
+#endif
 
     // Utility functions
-    String getContentType(const String& filename);
-    void sendJsonResponse(int code, const String& json);
-    void sendJsonError(int code, const String& message);
+#if MCP_SPIFFS
+    const char* getContentType(const char* filename);
+#endif
+    void sendJsonResponse(int code, const char* json, size_t len);
+    void sendJsonError(int code, const char* message);
 };
 
 #endif // ARDUINO_MCP_H
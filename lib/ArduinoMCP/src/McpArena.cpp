@@ -0,0 +1,250 @@
+/**
+ * McpArena - per-request bump arena for ArduinoMCP handlers
+ * Implementation file
+ *
+ * @author warusakudeveroper
+ * @license MIT
+ */
+
+#include "McpArena.h"
+#include "McpEscape.h"
+#include "McpMem.h"
+
+#include <WebServer.h>
+
+#include <stdio.h>
+#include <string.h>
+
+namespace mcp {
+namespace arena {
+
+namespace {
+
+constexpr size_t kAlign = 8;
+constexpr uint8_t kNoRoute = 0xff;
+
+// Heap block taken when the arena is full; freed with its scope or mark
+struct Chunk {
+    Chunk* next;
+    size_t size;
+};
+constexpr size_t kChunkHead = (sizeof(Chunk) + kAlign - 1) & ~(kAlign - 1);
+
+struct Route {
+    const char* uri;
+    const char* method;
+    uint32_t requests;
+    uint32_t highWater;    // most arena bytes one request used
+    uint32_t overflows;    // requests that needed the heap too
+    uint32_t overflowMax;  // most heap bytes one of them took
+};
+
+uint8_t* block = nullptr;
+size_t cap = 0;
+size_t top = 0;
+bool inPsram = false;
+Chunk* overflow = nullptr;
+
+size_t peak = 0;           // of the running request
+size_t overflowBytes = 0;  // of the running request
+size_t highWaterAll = 0;
+
+Route routes[MCP_ARENA_ROUTES];
+uint8_t routeCount = 0;
+
+size_t aligned(size_t n) {
+    return (n + kAlign - 1) & ~(kAlign - 1);
+}
+
+// Free the overflow chunks taken after `until`
+void release(Chunk* until) {
+    while (overflow != until && overflow != nullptr) {
+        Chunk* next = overflow->next;
+        mem::free(overflow);
+        overflow = next;
+    }
+}
+
+bool inBlock(const void* p) {
+    return block != nullptr && p >= block && p < block + cap;
+}
+
+} // namespace
+
+bool begin(size_t bytes) {
+    if (block != nullptr) return true;
+    if (bytes == 0) return false;
+    bytes = aligned(bytes);
+    block = static_cast<uint8_t*>(mem::alloc(bytes));
+    if (block == nullptr) {
+        Serial.println("[MCP] arena: no memory, handlers use the heap");
+        return false;
+    }
+    inPsram = mem::inPsram(block);
+    cap = bytes;
+    top = 0;
+    return true;
+}
+
+void end() {
+    release(nullptr);
+    mem::free(block);
+    block = nullptr;
+    cap = top = 0;
+    inPsram = false;
+}
+
+void* alloc(size_t n) {
+    n = aligned(n ? n : 1);
+    if (block != nullptr && n <= cap - top) {
+        void* p = block + top;
+        top += n;
+        if (top > peak) peak = top;
+        return p;
+    }
+    Chunk* c = static_cast<Chunk*>(mem::alloc(kChunkHead + n));
+    if (c == nullptr) return nullptr;
+    c->next = overflow;
+    c->size = n;
+    overflow = c;
+    overflowBytes += n;
+    return reinterpret_cast<uint8_t*>(c) + kChunkHead;
+}
+
+char* copy(const char* s, size_t len) {
+    char* p = static_cast<char*>(alloc(len + 1));
+    if (p == nullptr) return nullptr;
+    memcpy(p, s, len);
+    p[len] = '\0';
+    return p;
+}
+
+const char* path(const String& path) {
+    const bool rooted = path.startsWith("/");
+    char* p = static_cast<char*>(alloc(path.length() + 2));
+    if (p == nullptr) return "/";
+    p[0] = '/';
+    memcpy(p + (rooted ? 0 : 1), path.c_str(), path.length() + 1);
+    return p;
+}
+
+uint8_t addRoute(const char* uri, const char* method) {
+    if (routeCount >= MCP_ARENA_ROUTES) return kNoRoute;
+    routes[routeCount] = Route{uri, method, 0, 0, 0, 0};
+    return routeCount++;
+}
+
+size_t used() {
+    return top;
+}
+
+Scope::Scope(uint8_t route) : _route(route) {
+    peak = top;
+    overflowBytes = 0;
+}
+
+Scope::~Scope() {
+    if (_route < routeCount) {
+        Route& r = routes[_route];
+        r.requests++;
+        if (peak > r.highWater) r.highWater = (uint32_t)peak;
+        if (overflowBytes) {
+            r.overflows++;
+            if (overflowBytes > r.overflowMax) r.overflowMax = (uint32_t)overflowBytes;
+        }
+    }
+    if (peak > highWaterAll) highWaterAll = peak;
+    release(nullptr);
+    top = 0;
+    peak = 0;
+    overflowBytes = 0;
+}
+
+Mark::Mark() : _used(top), _overflow(overflow) {}
+
+Mark::~Mark() {
+    release(static_cast<Chunk*>(_overflow));
+    top = _used;
+}
+
+bool Text::reserve(size_t capacity) {
+    if (capacity + 1 <= _cap) return true;
+    if (_failed) return false;
+    size_t want = capacity + 1;
+    if (want < _cap * 2) want = _cap * 2;
+    if (want < 32) want = 32;
+    want = aligned(want);
+    // On top of the block: grow in place
+    if (inBlock(_buf) && _buf + _cap == reinterpret_cast<char*>(block + top) &&
+        want - _cap <= cap - top) {
+        top += want - _cap;
+        if (top > peak) peak = top;
+        _cap = want;
+        return true;
+    }
+    char* p = static_cast<char*>(alloc(want));
+    if (p == nullptr) {
+        _failed = true;
+        return false;
+    }
+    if (_buf != nullptr) memcpy(p, _buf, _len + 1);
+    else p[0] = '\0';
+    _buf = p;
+    _cap = want;
+    return true;
+}
+
+Text& Text::append(const char* s, size_t n) {
+    if (!reserve(_len + n)) return *this;
+    memcpy(_buf + _len, s, n);
+    _len += n;
+    _buf[_len] = '\0';
+    return *this;
+}
+
+Text& Text::appendUInt(uint64_t v) {
+    char num[24];
+    int n = snprintf(num, sizeof(num), "%llu", (unsigned long long)v);
+    return append(num, (size_t)n);
+}
+
+Text& Text::appendInt(int64_t v) {
+    char num[24];
+    int n = snprintf(num, sizeof(num), "%lld", (long long)v);
+    return append(num, (size_t)n);
+}
+
+Text& Text::appendJson(const char* s, size_t n) {
+    const size_t escaped = escapedJsonLength(s, n);
+    if (!reserve(_len + escaped)) return *this;
+    EscapeResult r = escapeJson(_buf + _len, _cap - _len - 1, s, n);
+    _len += r.written;
+    _buf[_len] = '\0';
+    return *this;
+}
+
+void handleStats(WebServer& server) {
+    Text json(160 + routeCount * 112);
+    json.append("{\"ok\":true,\"bytes\":").appendUInt(cap);
+    json.append(",\"psram\":").append(inPsram ? "true" : "false");
+    json.append(",\"used\":").appendUInt(top);
+    json.append(",\"highWater\":").appendUInt(highWaterAll);
+    json.append(",\"routes\":[");
+    for (uint8_t i = 0; i < routeCount; i++) {
+        const Route& r = routes[i];
+        if (i) json.append(',');
+        json.append("{\"uri\":\"").appendJson(r.uri);
+        json.append("\",\"method\":\"").append(r.method);
+        json.append("\",\"requests\":").appendUInt(r.requests);
+        json.append(",\"highWater\":").appendUInt(r.highWater);
+        json.append(",\"overflows\":").appendUInt(r.overflows);
+        json.append(",\"overflowMax\":").appendUInt(r.overflowMax);
+        json.append('}');
+    }
+    json.append("]}");
+    server.sendHeader("Cache-Control", "no-store");
+    server.send_P(200, "application/json", json.c_str(), json.length());
+}
+
+} // namespace arena
+} // namespace mcp
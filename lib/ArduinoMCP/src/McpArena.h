@@ -0,0 +1,172 @@
+/**
+ * McpArena - per-request bump arena for ArduinoMCP handlers
+ *
+ * A handler's temporaries - the normalized path, the JSON answer, a file
+ * read for a response - live only until the response is sent, but as
+ * Strings they go through the general heap and leave holes between the
+ * long-lived blocks (sockets, SPIFFS caches, TLS contexts) allocated around
+ * them. Instead they come from one fixed block, allocated once in begin()
+ * (placed by McpMem.h: in PSRAM when the module has it), by bumping an
+ * offset; the whole block is released at once when the request ends:
+ *
+ *   mcp::arena::Text json;           // grows in place while it is on top
+ *   json.append("{\"ok\":true,\"path\":\"");
+ *   json.appendJson(path);
+ *   json.append("\"}");
+ *   server.send_P(200, "application/json", json.c_str(), json.length());
+ *
+ * ArduinoMCP wraps every route in a Scope, which resets the arena after the
+ * handler returns. When the block is full, allocations fall back to the
+ * heap; those blocks are freed with the scope and counted as overflows.
+ * Code that may run outside a request takes a Mark, which gives back what
+ * was allocated after it (arena and overflow) when it goes out of scope.
+ *
+ * GET /api/arena/stats reports, per route, the requests served and the
+ * largest arena use (high-water mark) and heap overflow of one request, so
+ * MCP_ARENA_BYTES can be sized from real traffic:
+ *
+ *   {"ok":true,"bytes":4096,"psram":false,"used":0,"highWater":2112,
+ *    "routes":[{"uri":"/api/spiffs/list","method":"GET","requests":40,
+ *               "highWater":1480,"overflows":0,"overflowMax":0}, ...]}
+ *
+ * Not thread-safe: allocate from the loop task (the WebServer's handlers).
+ *
+ * @author warusakudeveroper
+ * @license MIT
+ */
+
+#ifndef MCP_ARENA_H
+#define MCP_ARENA_H
+
+#include <Arduino.h>
+
+// Size of the block (0: every allocation goes to the heap)
+#ifndef MCP_ARENA_BYTES
+#define MCP_ARENA_BYTES 4096
+#endif
+
+// Routes with their own statistics
+#ifndef MCP_ARENA_ROUTES
+#define MCP_ARENA_ROUTES 32
+#endif
+
+class WebServer;
+
+namespace mcp {
+namespace arena {
+
+/**
+ * Allocate the block (McpMem.h places it)
+ *
+ * @return false when neither has MCP_ARENA_BYTES free (the heap is used)
+ */
+bool begin(size_t bytes = MCP_ARENA_BYTES);
+
+/**
+ * Free the block and any overflow
+ */
+void end();
+
+/**
+ * n bytes, 8-byte aligned; from the heap when the block is full
+ *
+ * @return nullptr only when the heap is exhausted too
+ */
+void* alloc(size_t n);
+
+/**
+ * Copy of s (len bytes) with a NUL after it
+ */
+char* copy(const char* s, size_t len);
+
+/**
+ * path as a file path: a leading '/' is added when it has none
+ */
+const char* path(const String& path);
+
+/**
+ * Register a route for statistics
+ *
+ * @return Its slot, or 0xff when all MCP_ARENA_ROUTES are taken
+ */
+uint8_t addRoute(const char* uri, const char* method);
+
+/**
+ * Bytes in use in the block
+ */
+size_t used();
+
+/**
+ * GET /api/arena/stats
+ */
+void handleStats(WebServer& server);
+
+/**
+ * A request: resets the arena and records its use for the route when it ends
+ */
+class Scope {
+public:
+    explicit Scope(uint8_t route);
+    ~Scope();
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+private:
+    uint8_t _route;
+};
+
+/**
+ * Gives back what was allocated after it when it goes out of scope
+ */
+class Mark {
+public:
+    Mark();
+    ~Mark();
+    Mark(const Mark&) = delete;
+    Mark& operator=(const Mark&) = delete;
+
+private:
+    size_t _used;
+    void* _overflow;
+};
+
+/**
+ * Growing text on the arena. It grows in place while it is the last
+ * allocation, and is moved (the old copy stays until the reset) otherwise.
+ * Always NUL-terminated; a failed allocation sets failed() and drops the
+ * rest.
+ */
+class Text {
+public:
+    Text() : _buf(nullptr), _len(0), _cap(0), _failed(false) {}
+    explicit Text(size_t capacity) : Text() { reserve(capacity); }
+    Text(const Text&) = delete;
+    Text& operator=(const Text&) = delete;
+
+    bool reserve(size_t capacity);
+    Text& append(const char* s, size_t n);
+    Text& append(const char* s) { return append(s, strlen(s)); }
+    Text& append(const String& s) { return append(s.c_str(), s.length()); }
+    Text& append(char c) { return append(&c, 1); }
+    Text& appendUInt(uint64_t v);
+    Text& appendInt(int64_t v);
+    // JSON string body (no quotes), escaped with McpEscape
+    Text& appendJson(const char* s, size_t n);
+    Text& appendJson(const char* s) { return appendJson(s, strlen(s)); }
+    Text& appendJson(const String& s) { return appendJson(s.c_str(), s.length()); }
+
+    const char* c_str() const { return _buf ? _buf : ""; }
+    size_t length() const { return _len; }
+    bool failed() const { return _failed; }
+
+private:
+    char* _buf;
+    size_t _len;
+    size_t _cap;
+    bool _failed;
+};
+
+} // namespace arena
+} // namespace mcp
+
+#endif // MCP_ARENA_H
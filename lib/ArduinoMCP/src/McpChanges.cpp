@@ -0,0 +1,191 @@
+/**
+ * McpChanges - filesystem change feed with long-poll watch
+ * Implementation file
+ *
+ * @author warusakudeveroper
+ * @license MIT
+ */
+
+#include "McpChanges.h"
+#include "McpEscape.h"
+
+#include <WebServer.h>
+#include <WiFiClient.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+namespace mcp {
+namespace changes {
+
+namespace {
+
+struct Event {
+    uint32_t seq;
+    uint32_t size;
+    uint32_t ms;
+    Op op;
+    char path[MCP_CHANGES_PATH];
+    char from[MCP_CHANGES_PATH];  // Rename only
+};
+
+struct Waiter {
+    WiFiClient client;
+    uint32_t since;
+    uint32_t deadline;
+    uint32_t parkedAt;
+    bool cors;
+    bool active;
+};
+
+Event ring[MCP_CHANGES_EVENTS];
+uint32_t last = 0;
+Waiter waiters[MCP_CHANGES_WAITERS];
+int waiting = 0;
+
+void copyPath(char* dst, const char* src) {
+    size_t n = src != nullptr ? strnlen(src, MCP_CHANGES_PATH - 1) : 0;
+    memcpy(dst, src, n);
+    dst[n] = '\0';
+}
+
+String body(uint32_t since) {
+    const uint32_t oldest = last >= MCP_CHANGES_EVENTS ? last - MCP_CHANGES_EVENTS + 1 : 1;
+    bool reset = false;
+    if (since > last) {
+        // seq restarted (reboot): everything still in the ring is new
+        since = 0;
+        reset = true;
+    }
+    if (since + 1 < oldest) {
+        reset = true;
+        since = oldest - 1;
+    }
+
+    String json;
+    json.reserve(48 + (last - since) * 96);
+    json += "{\"ok\":true,\"seq\":";
+    json += String(last);
+    json += ",\"reset\":";
+    json += reset ? "true" : "false";
+    json += ",\"events\":[";
+    for (uint32_t seq = since + 1; seq <= last; seq++) {
+        const Event& e = ring[seq % MCP_CHANGES_EVENTS];
+        if (seq != since + 1) json += ",";
+        json += "{\"seq\":";
+        json += String(e.seq);
+        json += ",\"op\":\"";
+        json += opName(e.op);
+        json += "\",\"path\":\"";
+        appendJsonEscaped(json, e.path, strlen(e.path));
+        if (e.op == Op::Rename) {
+            json += "\",\"from\":\"";
+            appendJsonEscaped(json, e.from, strlen(e.from));
+        }
+        json += "\",\"size\":";
+        json += String(e.size);
+        json += ",\"ms\":";
+        json += String(e.ms);
+        json += "}";
+    }
+    json += "]}";
+    return json;
+}
+
+// Answer a parked request on its own connection; the WebServer has long
+// finished with it, so the status line and headers are written here.
+void answer(Waiter& w) {
+    const String json = body(w.since);
+    String head = "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: ";
+    head += String(json.length());
+    if (w.cors) head += "\r\nAccess-Control-Allow-Origin: *";
+    head += "\r\nCache-Control: no-store\r\nConnection: close\r\n\r\n";
+    w.client.print(head);
+    w.client.print(json);
+    w.client.stop();
+    w.active = false;
+    waiting--;
+}
+
+} // namespace
+
+const char* opName(Op op) {
+    switch (op) {
+        case Op::Write: return "write";
+        case Op::Append: return "append";
+        case Op::Delete: return "delete";
+        case Op::Rename: return "rename";
+        case Op::Format: return "format";
+    }
+    return "?";
+}
+
+uint32_t record(Op op, const char* path, size_t size, const char* from) {
+    Event& e = ring[++last % MCP_CHANGES_EVENTS];
+    e.seq = last;
+    e.size = (uint32_t)size;
+    e.ms = millis();
+    e.op = op;
+    copyPath(e.path, path);
+    copyPath(e.from, op == Op::Rename ? from : nullptr);
+    return last;
+}
+
+uint32_t lastSeq() {
+    return last;
+}
+
+void poll() {
+    if (waiting == 0) return;
+    const uint32_t now = millis();
+    for (Waiter& w : waiters) {
+        if (!w.active) continue;
+        if (!w.client.connected()) {
+            // Client gave up (page closed, its own timeout)
+            w.client.stop();
+            w.active = false;
+            waiting--;
+        } else if (last != w.since || (int32_t)(now - w.deadline) >= 0) {
+            answer(w);
+        }
+    }
+}
+
+void handleGet(WebServer& server, bool cors) {
+    uint32_t since = strtoul(server.arg("since").c_str(), nullptr, 10);
+    // A new watcher starts at the current seq: it lists the directory itself,
+    // and an overrun ring would otherwise greet it with a reset.
+    if (since == 0) since = last;
+    uint32_t wait = strtoul(server.arg("wait").c_str(), nullptr, 10);
+    if (wait > MCP_CHANGES_MAX_WAIT) wait = MCP_CHANGES_MAX_WAIT;
+
+    if (since == last && wait > 0) {
+        Waiter* slot = nullptr;
+        for (Waiter& w : waiters) {
+            if (!w.active) {
+                slot = &w;
+                break;
+            }
+            if (slot == nullptr || (int32_t)(w.parkedAt - slot->parkedAt) < 0) slot = &w;
+        }
+        if (slot->active) answer(*slot);  // all busy: the oldest gets its (empty) answer now
+
+        slot->client = server.client();
+        if (slot->client.connected()) {
+            slot->since = since;
+            slot->parkedAt = millis();
+            slot->deadline = slot->parkedAt + wait;
+            slot->cors = cors;
+            slot->active = true;
+            waiting++;
+            return;  // no response now; poll() sends it
+        }
+        slot->client.stop();
+    }
+
+    server.sendHeader("Cache-Control", "no-store");
+    server.send(200, "application/json", body(since));
+}
+
+} // namespace changes
+} // namespace mcp
@@ -0,0 +1,109 @@
+/**
+ * McpChanges - filesystem change feed with long-poll watch
+ *
+ * The write and delete paths record one event per mutation (sequence number,
+ * operation, path, size) in a RAM ring of the last MCP_CHANGES_EVENTS events,
+ * so a file explorer can follow the filesystem instead of listing it again
+ * and again:
+ *
+ *   GET /api/spiffs/changes?since=12&wait=25000
+ *   {"ok":true,"seq":14,"reset":false,"events":[
+ *     {"seq":13,"op":"write","path":"/log.csv","size":120,"ms":81234},
+ *     {"seq":14,"op":"delete","path":"/old.csv","size":0,"ms":81301}]}
+ *
+ * A client starts with since=0 (or none), which means "from now": it gets
+ * the events recorded after its request and never a reset. Without events
+ * after `since` the request waits up to `wait` ms (at most
+ * MCP_CHANGES_MAX_WAIT) and answers as soon as one is recorded, with an empty
+ * list on timeout; the client then asks again with the returned seq. "reset"
+ * means events after `since` were lost (ring overrun, or seq restarted after
+ * a reboot): list the directory again.
+ *
+ * The WebServer runs one request at a time, so a waiting request does not
+ * block in its handler: the handler keeps a copy of the connection (the
+ * core's WiFiClient shares the socket) and returns without a response, and
+ * poll(), called from loop() after handleClient(), answers it later. Up to
+ * MCP_CHANGES_WAITERS requests wait at once; another one answers the oldest
+ * straight away.
+ *
+ * Sketches that change files themselves record that too:
+ *
+ *   log.close();
+ *   mcp::changes::record(mcp::changes::Op::Append, "/log.csv", log.rawBytes());
+ *   SPIFFS.rename("/a.txt", "/b.txt");
+ *   mcp::changes::record(mcp::changes::Op::Rename, "/b.txt", size, "/a.txt");
+ *
+ * Paths are kept up to MCP_CHANGES_PATH - 1 bytes (the SPIFFS name limit).
+ * Not thread-safe: record and poll from the loop task.
+ *
+ * @author warusakudeveroper
+ * @license MIT
+ */
+
+#ifndef MCP_CHANGES_H
+#define MCP_CHANGES_H
+
+#include <Arduino.h>
+
+// Events kept; older ones are overwritten
+#ifndef MCP_CHANGES_EVENTS
+#define MCP_CHANGES_EVENTS 32
+#endif
+
+// Requests that can wait at the same time
+#ifndef MCP_CHANGES_WAITERS
+#define MCP_CHANGES_WAITERS 2
+#endif
+
+// Upper bound for wait= (ms)
+#ifndef MCP_CHANGES_MAX_WAIT
+#define MCP_CHANGES_MAX_WAIT 30000
+#endif
+
+#define MCP_CHANGES_PATH 32
+
+class WebServer;
+
+namespace mcp {
+namespace changes {
+
+enum class Op : uint8_t { Write, Append, Delete, Rename, Format };
+
+/**
+ * "write", "append", "delete", "rename", "format"
+ */
+const char* opName(Op op);
+
+/**
+ * Record a mutation and wake the waiting requests on the next poll()
+ *
+ * @param size Bytes written (Write, Append) or the file's size (Rename); 0
+ *             otherwise
+ * @param from Old path (Rename only)
+ * @return The event's sequence number
+ */
+uint32_t record(Op op, const char* path, size_t size = 0, const char* from = nullptr);
+
+/**
+ * Sequence number of the last event (0: none since boot)
+ */
+uint32_t lastSeq();
+
+/**
+ * Answer waiting requests that have events or have timed out; call from
+ * loop() after handleClient()
+ */
+void poll();
+
+/**
+ * GET /api/spiffs/changes?since=<seq>&wait=<ms>
+ *
+ * @param cors Add Access-Control-Allow-Origin to a deferred answer (headers
+ *             queued with sendHeader() only reach an immediate one)
+ */
+void handleGet(WebServer& server, bool cors = false);
+
+} // namespace changes
+} // namespace mcp
+
+#endif // MCP_CHANGES_H
@@ -0,0 +1,56 @@
+/**
+ * McpChunkedPrint - Print adapter for streamed WebServer responses
+ *
+ * Collects output in a small buffer and hands it to
+ * WebServer::sendContent() whenever the buffer fills, so a handler can
+ * stream a large body without building it in RAM. Start the response with
+ * setContentLength(CONTENT_LENGTH_UNKNOWN) + send(code, type, ""), write,
+ * then flush().
+ *
+ * @author warusakudeveroper
+ * @license MIT
+ */
+
+#ifndef MCP_CHUNKED_PRINT_H
+#define MCP_CHUNKED_PRINT_H
+
+#include <Arduino.h>
+#include <WebServer.h>
+
+namespace mcp {
+
+class ChunkedPrint : public Print {
+public:
+    explicit ChunkedPrint(WebServer& server) : _server(server), _len(0) {}
+
+    size_t write(uint8_t c) override {
+        return write(&c, 1);
+    }
+
+    size_t write(const uint8_t* data, size_t size) override {
+        for (size_t done = 0; done < size;) {
+            size_t n = size - done;
+            if (n > sizeof(_buf) - _len) n = sizeof(_buf) - _len;
+            memcpy(_buf + _len, data + done, n);
+            _len += n;
+            done += n;
+            if (_len == sizeof(_buf)) flush();
+        }
+        return size;
+    }
+
+    void flush() override {
+        if (_len == 0) return;
+        _server.sendContent(_buf, _len);
+        _len = 0;
+    }
+
+private:
+    WebServer& _server;
+    char _buf[512];
+    size_t _len;
+};
+
+} // namespace mcp
+
+#endif // MCP_CHUNKED_PRINT_H
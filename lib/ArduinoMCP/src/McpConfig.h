@@ -0,0 +1,101 @@
+/**
+ * McpConfig - compile-time feature selection for ArduinoMCP
+ *
+ * Every endpoint group is built unless the build turns it off. A disabled
+ * group's routes, handlers and strings are not compiled, and the linker
+ * (--gc-sections, as in the ESP32 core's builds) drops the modules only it
+ * used, with their static buffers:
+ *
+ *   arduino-cli compile --build-property "build.extra_flags=-DMCP_KV=0 -DMCP_UPLOAD=0" ...
+ *   platformio.ini: build_flags = -DMCP_SPIFFS=0
+ *
+ *   MCP_SPIFFS   /api/spiffs/list, read, write, delete, info; SPIFFS
+ *                mount in begin() and the content-type table
+ *   MCP_ZFILE    compressed files in read / write / list (McpZFile, McpGzip,
+ *                McpInflate)                                 needs MCP_SPIFFS
+ *   MCP_UPLOAD   /api/spiffs/upload (McpUpload)              needs MCP_SPIFFS
+ *   MCP_CHANGES  /api/spiffs/changes and change recording
+ *                (McpChanges)                                needs MCP_SPIFFS
+ *   MCP_DEVICE   /api/device/info, restart
+ *   MCP_KV       /api/kv/get, set, delete, list (McpKv)
+ *   MCP_CORS     Access-Control-* headers and the OPTIONS routes
+ *   MCP_POWERSAVE  Wi-Fi power save off while requests are served, on
+ *                after MCP_PS_IDLE_MS idle, and /api/power/stats
+ *                (McpPowerSave)
+ *   MCP_TLS      beginSecure() and /api/tls/stats (McpTls); off by default:
+ *                needs a certificate and ~22 KB of heap per connection
+ *   MCP_ARENA_STATS  /api/arena/stats (request arena use per route; the
+ *                arena itself is always used)
+ *   MCP_MEM_STATS  /api/mem/stats (heap by capability and buffer placement;
+ *                the PSRAM placement itself is always used)
+ *
+ * The file features default to MCP_SPIFFS, so -DMCP_SPIFFS=0 turns them off
+ * too. MCP_TRACE and MCP_PROFILE (off by default) live in McpTrace.h and
+ * McpProfiler.h. Sizes per feature: make -C host size.
+ *
+ * @author warusakudeveroper
+ * @license MIT
+ */
+
+#ifndef MCP_CONFIG_H
+#define MCP_CONFIG_H
+
+#ifndef MCP_SPIFFS
+#define MCP_SPIFFS 1
+#endif
+
+#ifndef MCP_ZFILE
+#define MCP_ZFILE MCP_SPIFFS
+#endif
+
+#ifndef MCP_UPLOAD
+#define MCP_UPLOAD MCP_SPIFFS
+#endif
+
+#ifndef MCP_CHANGES
+#define MCP_CHANGES MCP_SPIFFS
+#endif
+
+#ifndef MCP_DEVICE
+#define MCP_DEVICE 1
+#endif
+
+#ifndef MCP_KV
+#define MCP_KV 1
+#endif
+
+#ifndef MCP_CORS
+#define MCP_CORS 1
+#endif
+
+#ifndef MCP_POWERSAVE
+#define MCP_POWERSAVE 1
+#endif
+
+#ifndef MCP_TLS
+#define MCP_TLS 0
+#endif
+
+#ifndef MCP_ARENA_STATS
+#define MCP_ARENA_STATS 1
+#endif
+
+#ifndef MCP_MEM_STATS
+#define MCP_MEM_STATS 1
+#endif
+
+// Defaults of the switches in McpTrace.h and McpProfiler.h, for code that
+// tests them without including those headers (ArduinoMCP.h)
+#ifndef MCP_TRACE
+#define MCP_TRACE 0
+#endif
+
+#ifndef MCP_PROFILE
+#define MCP_PROFILE 0
+#endif
+
+#if !MCP_SPIFFS && (MCP_ZFILE || MCP_UPLOAD || MCP_CHANGES)
+#error "MCP_ZFILE, MCP_UPLOAD and MCP_CHANGES need MCP_SPIFFS"
+#endif
+
+#endif // MCP_CONFIG_H
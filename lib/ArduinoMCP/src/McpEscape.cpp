@@ -0,0 +1,248 @@
+/**
+ * McpEscape - JSON / HTML escaping kernel
+ * Implementation file
+ *
+ * @author warusakudeveroper
+ * @license MIT
+ */
+
+#include "McpEscape.h"
+
+#include <string.h>
+
+namespace mcp {
+
+namespace {
+
+// Native word: 4 bytes on ESP32 (Xtensa / RISC-V), 8 bytes on 64-bit hosts.
+typedef uintptr_t Word;
+
+constexpr Word kOnes = ~Word(0) / 0xFF;   // 0x0101...01
+constexpr Word kHighs = kOnes * 0x80;     // 0x8080...80
+
+// Non-zero if any byte of x is < n (exact for 0 <= n <= 128).
+inline Word hasLess(Word x, uint8_t n) {
+    return (x - kOnes * n) & ~x & kHighs;
+}
+
+// Non-zero if any byte of x equals c.
+inline Word hasByte(Word x, uint8_t c) {
+    Word y = x ^ (kOnes * c);
+    return (y - kOnes) & ~y & kHighs;
+}
+
+inline Word loadWord(const char* p) {
+    Word w;
+    memcpy(&w, p, sizeof(w));  // unaligned-safe, compiles to a single load
+    return w;
+}
+
+// Every escape fits in 8 bytes, so each byte value maps to a fixed 8-byte
+// record: its output (the byte itself when clean) padded with zeros. Dense
+// input is then one table store per byte, without a branch on the byte.
+constexpr size_t kEscMax = 8;
+
+struct Esc {
+    char s[kEscMax];
+};
+
+constexpr char hexDigit(unsigned v) {
+    return static_cast<char>(v < 10 ? '0' + v : 'a' + v - 10);
+}
+
+constexpr Esc jsonEsc(unsigned c) {
+    return c == '"' ? Esc{{'\\', '"'}} : c == '\\' ? Esc{{'\\', '\\'}}
+         : c == '\b' ? Esc{{'\\', 'b'}} : c == '\f' ? Esc{{'\\', 'f'}}
+         : c == '\n' ? Esc{{'\\', 'n'}} : c == '\r' ? Esc{{'\\', 'r'}}
+         : c == '\t' ? Esc{{'\\', 't'}}
+         : c < 0x20 ? Esc{{'\\', 'u', '0', '0', hexDigit(c >> 4), hexDigit(c & 0x0F)}}
+         : Esc{{static_cast<char>(c)}};
+}
+
+constexpr Esc htmlEsc(unsigned c) {
+    return c == '&' ? Esc{{'&', 'a', 'm', 'p', ';'}} : c == '<' ? Esc{{'&', 'l', 't', ';'}}
+         : c == '>' ? Esc{{'&', 'g', 't', ';'}} : c == '"' ? Esc{{'&', 'q', 'u', 'o', 't', ';'}}
+         : c == '\'' ? Esc{{'&', '#', '3', '9', ';'}}
+         : (c == '\t' || c == '\n' || c == '\r') ? Esc{{static_cast<char>(c)}}
+         : (c < 0x20 || c == 0x7F) ? Esc{{'&', '#', 'x', 'F', 'F', 'F', 'D', ';'}}
+         : Esc{{static_cast<char>(c)}};
+}
+
+// Escaped length per byte value (1 = copied as-is).
+constexpr uint8_t jsonLen(unsigned c) {
+    return (c == '"' || c == '\\' || c == '\b' || c == '\f' ||
+            c == '\n' || c == '\r' || c == '\t') ? 2 : (c < 0x20 ? 6 : 1);
+}
+
+constexpr uint8_t htmlLen(unsigned c) {
+    return c == '&' ? 5 : c == '<' ? 4 : c == '>' ? 4 : c == '"' ? 6 : c == '\'' ? 5
+         : (c == '\t' || c == '\n' || c == '\r') ? 1
+         : (c < 0x20 || c == 0x7F) ? 8 : 1;
+}
+
+#define MCP_T4(f, b) f(b), f(b + 1), f(b + 2), f(b + 3)
+#define MCP_T16(f, b) MCP_T4(f, b), MCP_T4(f, b + 4), MCP_T4(f, b + 8), MCP_T4(f, b + 12)
+#define MCP_T64(f, b) MCP_T16(f, b), MCP_T16(f, b + 16), MCP_T16(f, b + 32), MCP_T16(f, b + 48)
+#define MCP_T256(f) MCP_T64(f, 0), MCP_T64(f, 64), MCP_T64(f, 128), MCP_T64(f, 192)
+
+const uint8_t kJsonLen[256] = {MCP_T256(jsonLen)};
+const uint8_t kHtmlLen[256] = {MCP_T256(htmlLen)};
+const Esc kJsonEsc[256] = {MCP_T256(jsonEsc)};
+const Esc kHtmlEsc[256] = {MCP_T256(htmlEsc)};
+
+#undef MCP_T256
+#undef MCP_T64
+#undef MCP_T16
+#undef MCP_T4
+
+struct JsonTraits {
+    static bool wordNeedsEscape(Word w) {
+        return (hasLess(w, 0x20) | hasByte(w, '"') | hasByte(w, '\\')) != 0;
+    }
+
+    static size_t encodedLength(uint8_t c) { return kJsonLen[c]; }
+
+    static const Esc& escaped(uint8_t c) { return kJsonEsc[c]; }
+};
+
+struct HtmlTraits {
+    static bool wordNeedsEscape(Word w) {
+        return (hasLess(w, 0x20) | hasByte(w, 0x7F) | hasByte(w, '&') |
+                hasByte(w, '<') | hasByte(w, '>') | hasByte(w, '"') |
+                hasByte(w, '\'')) != 0;
+    }
+
+    static size_t encodedLength(uint8_t c) { return kHtmlLen[c]; }
+
+    static const Esc& escaped(uint8_t c) { return kHtmlEsc[c]; }
+};
+
+// Index of the first byte at or after pos that needs escaping, or len.
+template <typename Traits>
+size_t scanClean(const char* src, size_t pos, size_t len) {
+    while (pos + sizeof(Word) <= len && !Traits::wordNeedsEscape(loadWord(src + pos))) {
+        pos += sizeof(Word);
+    }
+    while (pos < len && Traits::encodedLength(static_cast<uint8_t>(src[pos])) == 1) {
+        pos++;
+    }
+    return pos;
+}
+
+template <typename Traits>
+EscapeResult escapeImpl(char* dst, size_t cap, const char* src, size_t len) {
+    size_t in = 0;
+    size_t out = 0;
+
+    while (in < len) {
+        const bool wordAhead = in + sizeof(Word) <= len;
+
+        // A clean word ahead: take the whole clean run with one memcpy.
+        if (wordAhead && !Traits::wordNeedsEscape(loadWord(src + in))) {
+            size_t end = scanClean<Traits>(src, in + sizeof(Word), len);
+            size_t run = end - in;
+            if (run > cap - out) {
+                run = cap - out;
+                memcpy(dst + out, src + in, run);
+                return {out + run, in + run};
+            }
+            memcpy(dst + out, src + in, run);
+            out += run;
+            in = end;
+            continue;
+        }
+
+        // A word with escapes in it and room for its worst case: every byte
+        // is a fixed-size store of its table record. The zero padding after
+        // each sequence lands in space the next store or the caller owns.
+        if (wordAhead && cap - out >= sizeof(Word) * kEscMax) {
+            for (size_t i = 0; i < sizeof(Word); i++) {
+                const uint8_t c = static_cast<uint8_t>(src[in + i]);
+                memcpy(dst + out, Traits::escaped(c).s, kEscMax);
+                out += Traits::encodedLength(c);
+            }
+            in += sizeof(Word);
+            continue;
+        }
+
+        // Near the end of either buffer: one byte at a time, never writing
+        // past cap or splitting a sequence.
+        const uint8_t c = static_cast<uint8_t>(src[in]);
+        const size_t n = Traits::encodedLength(c);
+        if (n > cap - out) break;
+        memcpy(dst + out, Traits::escaped(c).s, n);
+        out += n;
+        in++;
+    }
+    return {out, in};
+}
+
+template <typename Traits>
+size_t lengthImpl(const char* src, size_t len) {
+    size_t total = len;
+    size_t pos = 0;
+    while ((pos = scanClean<Traits>(src, pos, len)) < len) {
+        total += Traits::encodedLength(static_cast<uint8_t>(src[pos])) - 1;
+        pos++;
+    }
+    return total;
+}
+
+#ifdef ARDUINO
+// Stack chunk used to move escaped bytes into a String without per-char appends.
+constexpr size_t kAppendChunk = 128;
+
+template <typename Traits>
+void appendImpl(String& out, const char* src, size_t len) {
+    out.reserve(out.length() + lengthImpl<Traits>(src, len));
+    char buf[kAppendChunk];
+    while (len > 0) {
+        EscapeResult r = escapeImpl<Traits>(buf, sizeof(buf), src, len);
+        out.concat(buf, r.written);
+        src += r.consumed;
+        len -= r.consumed;
+    }
+}
+#endif
+
+} // namespace
+
+EscapeResult escapeJson(char* dst, size_t cap, const char* src, size_t len) {
+    return escapeImpl<JsonTraits>(dst, cap, src, len);
+}
+
+EscapeResult escapeHtml(char* dst, size_t cap, const char* src, size_t len) {
+    return escapeImpl<HtmlTraits>(dst, cap, src, len);
+}
+
+size_t escapedJsonLength(const char* src, size_t len) {
+    return lengthImpl<JsonTraits>(src, len);
+}
+
+size_t escapedHtmlLength(const char* src, size_t len) {
+    return lengthImpl<HtmlTraits>(src, len);
+}
+
+#ifdef ARDUINO
+void appendJsonEscaped(String& out, const char* src, size_t len) {
+    appendImpl<JsonTraits>(out, src, len);
+}
+
+void appendHtmlEscaped(String& out, const char* src, size_t len) {
+    appendImpl<HtmlTraits>(out, src, len);
+}
+
+String jsonEscaped(const String& src) {
+    String out;
+    appendJsonEscaped(out, src);
+    return out;
+}
+
+String htmlEscaped(const String& src) {
+    String out;
+    appendHtmlEscaped(out, src);
+    return out;
+}
+#endif
+
+} // namespace mcp
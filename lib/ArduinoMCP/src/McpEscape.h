@@ -0,0 +1,116 @@
+/**
+ * McpEscape - JSON / HTML escaping kernel shared by ArduinoMCP and sketches
+ *
+ * The scanner reads the input one machine word at a time (SWAR) and tests
+ * every byte of the word at once for characters that need escaping. Clean
+ * runs are copied with a single memcpy into a caller-provided buffer, so
+ * typical text (file contents, SSIDs, reports) costs a few instructions per
+ * word instead of one String append per character. Words that do need
+ * escaping go through a 256-entry table of fixed 8-byte output records, one
+ * store per byte, so input dense with quotes or controls stays fast too.
+ *
+ * JSON rules (RFC 8259):
+ *   "  -> \"      \  -> \\
+ *   \b \f \n \r \t use their short forms
+ *   any other byte < 0x20 -> \u00XX
+ *
+ * HTML rules (text and quoted attribute values):
+ *   & -> &amp;   < -> &lt;   > -> &gt;   " -> &quot;   ' -> &#39;
+ *   \t \n \r are kept, other C0 controls and DEL -> &#xFFFD;
+ *
+ * Bytes >= 0x80 are passed through untouched in both modes, so UTF-8 input
+ * stays valid UTF-8.
+ *
+ * The raw-buffer API never splits an escape sequence: it stops before the
+ * first sequence that does not fit and reports how much input it consumed,
+ * which makes it usable as a streaming writer with a small stack buffer.
+ * Bytes of dst past the reported length (up to cap) may be overwritten.
+ *
+ * @author warusakudeveroper
+ * @license MIT
+ */
+
+#ifndef MCP_ESCAPE_H
+#define MCP_ESCAPE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#endif
+
+namespace mcp {
+
+/**
+ * Result of an escape call into a bounded buffer
+ */
+struct EscapeResult {
+    size_t written;   // bytes stored in dst (no NUL terminator is added)
+    size_t consumed;  // input bytes fully processed
+};
+
+/**
+ * Escape src as the body of a JSON string literal (no surrounding quotes)
+ *
+ * @param dst Output buffer
+ * @param cap Capacity of dst in bytes
+ * @param src Input bytes
+ * @param len Number of input bytes
+ * @return Bytes written and input consumed; consumed < len means dst is full
+ */
+EscapeResult escapeJson(char* dst, size_t cap, const char* src, size_t len);
+
+/**
+ * Escape src for HTML text or a quoted attribute value
+ *
+ * @param dst Output buffer
+ * @param cap Capacity of dst in bytes
+ * @param src Input bytes
+ * @param len Number of input bytes
+ * @return Bytes written and input consumed; consumed < len means dst is full
+ */
+EscapeResult escapeHtml(char* dst, size_t cap, const char* src, size_t len);
+
+/**
+ * Exact output size of escapeJson() for src (excluding any NUL)
+ */
+size_t escapedJsonLength(const char* src, size_t len);
+
+/**
+ * Exact output size of escapeHtml() for src (excluding any NUL)
+ */
+size_t escapedHtmlLength(const char* src, size_t len);
+
+#ifdef ARDUINO
+/**
+ * Append the JSON-escaped form of src to out
+ * Reserves the exact final size once, then appends in bulk chunks.
+ */
+void appendJsonEscaped(String& out, const char* src, size_t len);
+inline void appendJsonEscaped(String& out, const String& src) {
+    appendJsonEscaped(out, src.c_str(), src.length());
+}
+
+/**
+ * Append the HTML-escaped form of src to out
+ */
+void appendHtmlEscaped(String& out, const char* src, size_t len);
+inline void appendHtmlEscaped(String& out, const String& src) {
+    appendHtmlEscaped(out, src.c_str(), src.length());
+}
+
+/**
+ * Return the JSON-escaped form of src as a new String
+ */
+String jsonEscaped(const String& src);
+
+/**
+ * Return the HTML-escaped form of src as a new String
+ */
+String htmlEscaped(const String& src);
+#endif
+
+} // namespace mcp
+
+#endif // MCP_ESCAPE_H
@@ -0,0 +1,477 @@
+/**
+ * McpGzip - streaming deflate / gzip compressor
+ * Implementation file: fixed-window LZ77 + per-block Huffman deflate
+ *
+ * @author warusakudeveroper
+ * @license MIT
+ */
+
+#include "McpGzip.h"
+
+#include <esp_rom_crc.h>
+#include <esp_timer.h>
+
+namespace mcp {
+
+static const size_t kMinMatch = 3;
+static const size_t kMaxMatch = 258;
+
+// RFC 1951 3.2.5: length codes 257..285 and distance codes 0..29
+static const uint16_t kLenBase[29] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                      31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t kLenExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                      2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const uint16_t kDistBase[30] = {1,    2,    3,    4,    5,    7,     9,     13,    17,  25,
+                                       33,   49,   65,   97,   129,  193,   257,   385,   513, 769,
+                                       1025, 1537, 2049, 3073, 4097, 6145,  8193,  12289, 16385, 24577};
+static const uint8_t kDistExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+                                       6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+// Order in which the code length code lengths are sent (RFC 1951 3.2.7)
+static const uint8_t kClOrder[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+static_assert((MCP_GZIP_WINDOW & (MCP_GZIP_WINDOW - 1)) == 0, "MCP_GZIP_WINDOW must be a power of two");
+static_assert(MCP_GZIP_WINDOW > kMaxMatch && 2 * MCP_GZIP_WINDOW <= 0xFFFF, "MCP_GZIP_WINDOW out of range");
+static_assert(MCP_GZIP_BLOCK_SYMBOLS < 0xFFF0, "symbol frequencies are 16-bit");
+
+// Huffman codes are sent most significant bit first, everything else LSB first.
+static uint32_t reverseBits(uint32_t code, uint8_t count) {
+    uint32_t r = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        r = (r << 1) | (code & 1);
+        code >>= 1;
+    }
+    return r;
+}
+
+static inline uint32_t hash3(const uint8_t* p) {
+    return ((p[0] << 10) ^ (p[1] << 5) ^ p[2]) & ((1u << MCP_GZIP_HASH_BITS) - 1);
+}
+
+static int lengthCode(size_t len) {
+    int i = 28;
+    while (kLenBase[i] > len) i--;
+    return i;
+}
+
+static int distanceCode(size_t dist) {
+    int i = 29;
+    while (kDistBase[i] > dist) i--;
+    return i;
+}
+
+// Fixed literal/length code lengths (RFC 1951 3.2.6)
+static uint8_t fixedLitLength(int sym) {
+    return sym < 144 ? 8 : sym < 256 ? 9 : sym < 280 ? 7 : 8;
+}
+
+GzipStream::GzipStream()
+    : sink(nullptr), sinkCtx(nullptr), ok(false), format(Format::Gzip), winLen(0), pos(0), matchLen(0),
+      matchDist(0), literalPending(false), symCount(0), bitBuf(0), bitCount(0),
+      outLen(0), crc(0), inBytes(0), outBytes(0), cpuUs(0), sinkUs(0) {}
+
+void GzipStream::begin(Sink s, void* ctx, Format f) {
+    sink = s;
+    sinkCtx = ctx;
+    ok = true;
+    format = f;
+    memset(head, 0, sizeof(head));
+    memset(prev, 0, sizeof(prev));
+    winLen = pos = 0;
+    matchLen = matchDist = 0;
+    literalPending = false;
+    symCount = 0;
+    memset(litFreq, 0, sizeof(litFreq));
+    memset(distFreq, 0, sizeof(distFreq));
+    bitBuf = 0;
+    bitCount = 0;
+    outLen = 0;
+    crc = 0;
+    inBytes = outBytes = 0;
+    cpuUs = sinkUs = 0;
+    if (format == Format::Segment) return;
+
+    // ID1 ID2 CM=deflate FLG=0 MTIME=0 XFL=0 OS=unknown
+    static const uint8_t kHeader[10] = {0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 0xff};
+    memcpy(out, kHeader, sizeof(kHeader));
+    outLen = sizeof(kHeader);
+}
+
+bool GzipStream::write(const uint8_t* data, size_t len) {
+    const int64_t t0 = esp_timer_get_time();
+    const uint32_t sinkBefore = sinkUs;
+    crc = esp_rom_crc32_le(crc, data, len);
+    inBytes += len;
+    while (len > 0 && ok) {
+        if (winLen == sizeof(window)) slide();
+        size_t n = sizeof(window) - winLen;
+        if (n > len) n = len;
+        memcpy(window + winLen, data, n);
+        winLen += n;
+        data += n;
+        len -= n;
+        compress(false);
+    }
+    cpuUs += (uint32_t)(esp_timer_get_time() - t0) - (sinkUs - sinkBefore);
+    return ok;
+}
+
+bool GzipStream::finish() {
+    const int64_t t0 = esp_timer_get_time();
+    const uint32_t sinkBefore = sinkUs;
+    compress(true);
+    if (format == Format::Segment) {
+        if (symCount > 0) flushBlock(false);
+        putBits(0, 3);  // BFINAL = 0, BTYPE = 00 (stored), LEN = 0
+    } else {
+        flushBlock(true);
+    }
+    if (bitCount > 0) putByte((uint8_t)bitBuf);
+    bitBuf = 0;
+    bitCount = 0;
+    if (format == Format::Segment) {
+        static const uint8_t kEmptyStored[4] = {0x00, 0x00, 0xff, 0xff};
+        for (uint8_t b : kEmptyStored) putByte(b);
+    } else {
+        for (int i = 0; i < 4; i++) putByte((uint8_t)(crc >> (8 * i)));
+        for (int i = 0; i < 4; i++) putByte((uint8_t)(inBytes >> (8 * i)));
+    }
+    cpuUs += (uint32_t)(esp_timer_get_time() - t0) - (sinkUs - sinkBefore);
+    return emit(true);
+}
+
+// Drop the older half of the window; hash entries pointing there become empty.
+void GzipStream::slide() {
+    memmove(window, window + MCP_GZIP_WINDOW, MCP_GZIP_WINDOW);
+    winLen -= MCP_GZIP_WINDOW;
+    pos -= MCP_GZIP_WINDOW;
+    for (size_t i = 0; i < sizeof(head) / sizeof(head[0]); i++) {
+        head[i] = head[i] > MCP_GZIP_WINDOW ? head[i] - MCP_GZIP_WINDOW : 0;
+    }
+    for (size_t i = 0; i < MCP_GZIP_WINDOW; i++) {
+        prev[i] = prev[i] > MCP_GZIP_WINDOW ? prev[i] - MCP_GZIP_WINDOW : 0;
+    }
+}
+
+void GzipStream::insertHash(size_t at) {
+    const uint32_t h = hash3(window + at);
+    prev[at & (MCP_GZIP_WINDOW - 1)] = head[h];
+    head[h] = (uint16_t)(at + 1);
+}
+
+size_t GzipStream::longestMatch(size_t at, size_t maxLen, size_t& dist) {
+    size_t best = 0;
+    uint16_t cand = head[hash3(window + at)];
+    for (int chain = MCP_GZIP_MAX_CHAIN; cand != 0 && chain > 0; chain--) {
+        const size_t c = cand - 1;
+        if (c >= at || at - c > MCP_GZIP_WINDOW) break;
+        if (window[c + best] == window[at + best]) {
+            size_t len = 0;
+            while (len < maxLen && window[c + len] == window[at + len]) len++;
+            if (len > best) {
+                best = len;
+                dist = at - c;
+                if (len == maxLen) break;
+            }
+        }
+        const uint16_t next = prev[c & (MCP_GZIP_WINDOW - 1)];
+        if (next == 0 || next - 1u >= c) break;  // slot reused by a newer position
+        cand = next;
+    }
+    return best;
+}
+
+// Lazy parse (as zlib's deflate_slow): a match found at pos - 1 is only
+// taken if pos does not start a longer one, otherwise pos - 1 goes out as a
+// literal. Until the stream is finished, a full match length of lookahead is
+// kept so a match is never cut short by a write boundary.
+void GzipStream::compress(bool final) {
+    while (ok && pos < winLen && (final || winLen - pos >= kMaxMatch)) {
+        const size_t avail = winLen - pos;
+        const size_t prevLen = matchLen;
+        const size_t prevDist = matchDist;
+        matchLen = 0;
+        if (avail >= kMinMatch) {
+            if (prevLen < MCP_GZIP_LAZY_MAX) {
+                matchLen = longestMatch(pos, avail < kMaxMatch ? avail : kMaxMatch, matchDist);
+            }
+            insertHash(pos);
+        }
+        if (prevLen >= kMinMatch && matchLen <= prevLen) {
+            // Take the match at pos - 1; pos is hashed already.
+            recordMatch(prevLen, prevDist);
+            const size_t end = pos - 1 + prevLen;
+            for (size_t i = pos + 1; i < end && i + kMinMatch <= winLen; i++) insertHash(i);
+            pos = end;
+            matchLen = 0;
+            literalPending = false;
+        } else {
+            if (literalPending) recordLiteral(window[pos - 1]);
+            literalPending = true;
+            pos++;
+        }
+    }
+    if (final && literalPending) {
+        recordLiteral(window[pos - 1]);
+        literalPending = false;
+    }
+}
+
+void GzipStream::recordLiteral(uint8_t c) {
+    symValue[symCount] = c;
+    symDist[symCount] = 0;
+    litFreq[c]++;
+    if (++symCount == MCP_GZIP_BLOCK_SYMBOLS) flushBlock(false);
+}
+
+void GzipStream::recordMatch(size_t len, size_t dist) {
+    symValue[symCount] = (uint8_t)(len - kMinMatch);
+    symDist[symCount] = (uint16_t)dist;
+    litFreq[257 + lengthCode(len)]++;
+    distFreq[distanceCode(dist)]++;
+    if (++symCount == MCP_GZIP_BLOCK_SYMBOLS) flushBlock(false);
+}
+
+// Code lengths limited to maxBits for the symbols with a non-zero frequency:
+// Moffat & Katajainen's in-place minimum-redundancy lengths, then lengths
+// over the limit are folded back while keeping the Kraft sum exact (the
+// approach miniz uses). At least two symbols get a code, as zlib does, so
+// no decoder has to deal with a one-code tree.
+void GzipStream::buildLengths(const uint16_t* freq, int n, int maxBits, uint8_t* lengths) {
+    memset(lengths, 0, n);
+    int used = 0;
+    for (int i = 0; i < n; i++) {
+        if (freq[i]) sorted[used++] = {freq[i], (uint16_t)i};
+    }
+    for (int i = 0; used < 2; i++) {
+        if (!freq[i]) sorted[used++] = {1, (uint16_t)i};
+    }
+    for (int i = 1; i < used; i++) {
+        SymFreq v = sorted[i];
+        int j = i;
+        for (; j > 0 && sorted[j - 1].key > v.key; j--) sorted[j] = sorted[j - 1];
+        sorted[j] = v;
+    }
+
+    SymFreq* a = sorted;
+    a[0].key += a[1].key;
+    int root = 0;
+    int leaf = 2;
+    for (int next = 1; next < used - 1; next++) {
+        if (leaf >= used || a[root].key < a[leaf].key) {
+            a[next].key = a[root].key;
+            a[root++].key = (uint16_t)next;
+        } else {
+            a[next].key = a[leaf++].key;
+        }
+        if (leaf >= used || (root < next && a[root].key < a[leaf].key)) {
+            a[next].key = (uint16_t)(a[next].key + a[root].key);
+            a[root++].key = (uint16_t)next;
+        } else {
+            a[next].key = (uint16_t)(a[next].key + a[leaf++].key);
+        }
+    }
+    a[used - 2].key = 0;
+    for (int next = used - 3; next >= 0; next--) a[next].key = a[a[next].key].key + 1;
+    int avail = 1;
+    int depthUsed = 0;
+    int depth = 0;
+    root = used - 2;
+    int next = used - 1;
+    while (avail > 0) {
+        while (root >= 0 && (int)a[root].key == depth) {
+            depthUsed++;
+            root--;
+        }
+        while (avail > depthUsed) {
+            a[next--].key = (uint16_t)depth;
+            avail--;
+        }
+        avail = 2 * depthUsed;
+        depth++;
+        depthUsed = 0;
+    }
+
+    uint16_t count[33] = {0};
+    for (int i = 0; i < used; i++) count[a[i].key < 32 ? a[i].key : 32]++;
+    for (int i = maxBits + 1; i <= 32; i++) count[maxBits] += count[i];
+    uint32_t kraft = 0;
+    for (int i = maxBits; i > 0; i--) kraft += (uint32_t)count[i] << (maxBits - i);
+    while (kraft != (1u << maxBits)) {
+        count[maxBits]--;
+        for (int i = maxBits - 1; i > 0; i--) {
+            if (count[i]) {
+                count[i]--;
+                count[i + 1] += 2;
+                break;
+            }
+        }
+        kraft--;
+    }
+    // Rarest symbols first in `sorted`, so they take the longest codes.
+    int j = used;
+    for (int len = 1; len <= maxBits; len++) {
+        for (int c = count[len]; c > 0; c--) lengths[a[--j].sym] = (uint8_t)len;
+    }
+}
+
+// Canonical codes (RFC 1951 3.2.2), stored bit-reversed: Huffman codes go
+// out most significant bit first, everything else least significant first.
+void GzipStream::buildCodes(const uint8_t* lengths, int n, uint16_t* codes) {
+    uint16_t count[16] = {0};
+    uint16_t next[16];
+    for (int i = 0; i < n; i++) count[lengths[i]]++;
+    count[0] = 0;
+    uint16_t code = 0;
+    for (int len = 1; len < 16; len++) {
+        code = (uint16_t)((code + count[len - 1]) << 1);
+        next[len] = code;
+    }
+    for (int i = 0; i < n; i++) {
+        if (lengths[i]) codes[i] = (uint16_t)reverseBits(next[lengths[i]]++, lengths[i]);
+    }
+}
+
+// Writes the buffered symbols as one block: dynamic tables, or the fixed
+// ones when the table header would cost more than it saves.
+void GzipStream::flushBlock(bool final) {
+    litFreq[256]++;  // end of block
+    buildLengths(litFreq, kLitCodes, 15, litLen);
+    litLen[286] = litLen[287] = 0;
+    buildLengths(distFreq, kDistCodes, 15, distLen);
+
+    int hlit = kLitCodes;
+    while (hlit > 257 && litLen[hlit - 1] == 0) hlit--;
+    int hdist = kDistCodes;
+    while (hdist > 1 && distLen[hdist - 1] == 0) hdist--;
+
+    // Run-length code the lengths: 16 = repeat previous 3-6, 17 = 3-10 zeros,
+    // 18 = 11-138 zeros.
+    uint8_t lens[kLitCodes + kDistCodes];
+    memcpy(lens, litLen, hlit);
+    memcpy(lens + hlit, distLen, hdist);
+    const int total = hlit + hdist;
+    uint8_t rleSym[kLitCodes + kDistCodes];
+    uint8_t rleExtra[kLitCodes + kDistCodes];
+    int rleCount = 0;
+    uint16_t clFreq[19] = {0};
+    for (int i = 0; i < total;) {
+        const uint8_t v = lens[i];
+        int run = 1;
+        while (i + run < total && lens[i + run] == v) run++;
+        i += run;
+        if (v == 0) {
+            while (run >= 11) {
+                int r = run < 138 ? run : 138;
+                rleSym[rleCount] = 18;
+                rleExtra[rleCount++] = (uint8_t)(r - 11);
+                run -= r;
+            }
+            if (run >= 3) {
+                rleSym[rleCount] = 17;
+                rleExtra[rleCount++] = (uint8_t)(run - 3);
+                run = 0;
+            }
+        } else {
+            rleSym[rleCount++] = v;
+            run--;
+            while (run >= 3) {
+                int r = run < 6 ? run : 6;
+                rleSym[rleCount] = 16;
+                rleExtra[rleCount++] = (uint8_t)(r - 3);
+                run -= r;
+            }
+        }
+        while (run-- > 0) rleSym[rleCount++] = v;
+    }
+    for (int i = 0; i < rleCount; i++) clFreq[rleSym[i]]++;
+    uint8_t clLen[19];
+    uint16_t clCode[19];
+    buildLengths(clFreq, 19, 7, clLen);
+    int hclen = 19;
+    while (hclen > 4 && clLen[kClOrder[hclen - 1]] == 0) hclen--;
+
+    // Extra bits are the same either way and left out of the comparison.
+    uint32_t dynamicBits = 5 + 5 + 4 + 3 * hclen;
+    for (int i = 0; i < rleCount; i++) {
+        dynamicBits += clLen[rleSym[i]] + (rleSym[i] == 16 ? 2 : rleSym[i] == 17 ? 3 : rleSym[i] == 18 ? 7 : 0);
+    }
+    uint32_t fixedBits = 0;
+    for (int i = 0; i < kLitCodes; i++) {
+        dynamicBits += (uint32_t)litFreq[i] * litLen[i];
+        fixedBits += (uint32_t)litFreq[i] * fixedLitLength(i);
+    }
+    for (int i = 0; i < kDistCodes; i++) {
+        dynamicBits += (uint32_t)distFreq[i] * distLen[i];
+        fixedBits += (uint32_t)distFreq[i] * 5;
+    }
+
+    putBits(final ? 1 : 0, 1);
+    if (fixedBits <= dynamicBits) {
+        putBits(1, 2);  // BTYPE = 01, fixed tables
+        for (int i = 0; i < kFixedLitCodes; i++) litLen[i] = fixedLitLength(i);
+        for (int i = 0; i < kDistCodes; i++) distLen[i] = 5;
+    } else {
+        putBits(2, 2);  // BTYPE = 10, dynamic tables
+        putBits(hlit - 257, 5);
+        putBits(hdist - 1, 5);
+        putBits(hclen - 4, 4);
+        for (int i = 0; i < hclen; i++) putBits(clLen[kClOrder[i]], 3);
+        buildCodes(clLen, 19, clCode);
+        for (int i = 0; i < rleCount; i++) {
+            const uint8_t sym = rleSym[i];
+            putBits(clCode[sym], clLen[sym]);
+            if (sym == 16) putBits(rleExtra[i], 2);
+            else if (sym == 17) putBits(rleExtra[i], 3);
+            else if (sym == 18) putBits(rleExtra[i], 7);
+        }
+    }
+    buildCodes(litLen, kFixedLitCodes, litCode);
+    buildCodes(distLen, kDistCodes, distCode);
+
+    for (size_t i = 0; i < symCount; i++) {
+        if (symDist[i] == 0) {
+            putBits(litCode[symValue[i]], litLen[symValue[i]]);
+            continue;
+        }
+        const size_t len = symValue[i] + kMinMatch;
+        const int lc = lengthCode(len);
+        putBits(litCode[257 + lc], litLen[257 + lc]);
+        if (kLenExtra[lc]) putBits(len - kLenBase[lc], kLenExtra[lc]);
+        const int dc = distanceCode(symDist[i]);
+        putBits(distCode[dc], distLen[dc]);
+        if (kDistExtra[dc]) putBits(symDist[i] - kDistBase[dc], kDistExtra[dc]);
+    }
+    putBits(litCode[256], litLen[256]);
+
+    symCount = 0;
+    memset(litFreq, 0, sizeof(litFreq));
+    memset(distFreq, 0, sizeof(distFreq));
+}
+
+void GzipStream::putBits(uint32_t value, uint8_t count) {
+    bitBuf |= value << bitCount;
+    bitCount += count;
+    while (bitCount >= 8) {
+        putByte((uint8_t)bitBuf);
+        bitBuf >>= 8;
+        bitCount -= 8;
+    }
+}
+
+void GzipStream::putByte(uint8_t b) {
+    out[outLen++] = b;
+    if (outLen == sizeof(out)) emit(false);
+}
+
+bool GzipStream::emit(bool last) {
+    if (!ok) return false;
+    const int64_t t0 = esp_timer_get_time();
+    ok = sink(sinkCtx, out, outLen, last);
+    sinkUs += (uint32_t)(esp_timer_get_time() - t0);
+    outBytes += outLen;
+    outLen = 0;
+    return ok;
+}
+
+} // namespace mcp
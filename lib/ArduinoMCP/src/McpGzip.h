@@ -0,0 +1,127 @@
+/**
+ * McpGzip - streaming deflate / gzip compressor
+ *
+ * LZ77 with hash chains and lazy matching over a small sliding window; the
+ * matches and literals of up to MCP_GZIP_BLOCK_SYMBOLS go out as one deflate
+ * block with Huffman tables built for it (or the fixed tables when those
+ * come out smaller). No allocation: RAM is bounded by the window and the
+ * block buffer, about 11 KB with the defaults below. A 1-2 KB report body
+ * compresses to roughly 60 %.
+ *
+ * Two output formats:
+ *   Format::Gzip     one gzip (RFC 1952) member, e.g. a request body
+ *   Format::Segment  raw deflate (RFC 1951) without a final block, ended by
+ *                    an empty stored block (byte aligned, like zlib's
+ *                    Z_FULL_FLUSH). Nothing refers back across begin(), so
+ *                    each segment decodes on its own, and segments written
+ *                    one after another form one deflate stream; McpZFile
+ *                    stores file blocks this way.
+ *
+ * Compressed bytes are handed to a sink in pieces of up to MCP_GZIP_OUT_MAX
+ * bytes; the time spent compressing (sink excluded) is measured per stream.
+ *
+ * @author warusakudeveroper
+ * @license MIT
+ */
+
+#ifndef MCP_GZIP_H
+#define MCP_GZIP_H
+
+#include <Arduino.h>
+
+#ifndef MCP_GZIP_WINDOW
+#define MCP_GZIP_WINDOW 1024         // match distance limit; power of two
+#endif
+#define MCP_GZIP_HASH_BITS 9
+#define MCP_GZIP_MAX_CHAIN 16        // candidates tried per position
+#define MCP_GZIP_LAZY_MAX 32         // matches this long are taken without looking one byte ahead
+#define MCP_GZIP_BLOCK_SYMBOLS 1024  // literals + matches buffered per deflate block
+#define MCP_GZIP_OUT_MAX 256
+
+namespace mcp {
+
+class GzipStream {
+public:
+    // Receives compressed output; `last` is set on the final piece of a stream.
+    typedef bool (*Sink)(void* ctx, const uint8_t* data, size_t len, bool last);
+
+    GzipStream();
+
+    enum class Format : uint8_t { Gzip, Segment };
+
+    // Start a stream: writes the gzip header (nothing reaches the sink yet).
+    void begin(Sink sink, void* ctx, Format format = Format::Gzip);
+    bool write(const uint8_t* data, size_t len);
+    // Compress what is left and emit the last block and the trailer (the
+    // empty stored block for a segment).
+    bool finish();
+
+    size_t getInBytes() const { return inBytes; }
+    size_t getOutBytes() const { return outBytes; }
+    uint32_t getCpuUs() const { return cpuUs; }
+
+private:
+    static const int kLitCodes = 286;
+    static const int kDistCodes = 30;
+    static const int kFixedLitCodes = 288;  // the fixed table also numbers the two unused codes
+
+    void compress(bool final);
+    void slide();
+    void insertHash(size_t at);
+    size_t longestMatch(size_t at, size_t maxLen, size_t& dist);
+    void recordLiteral(uint8_t c);
+    void recordMatch(size_t len, size_t dist);
+    void flushBlock(bool final);
+    void buildLengths(const uint16_t* freq, int n, int maxBits, uint8_t* lengths);
+    static void buildCodes(const uint8_t* lengths, int n, uint16_t* codes);
+    void putBits(uint32_t value, uint8_t count);
+    void putByte(uint8_t b);
+    bool emit(bool last);
+
+    Sink sink;
+    void* sinkCtx;
+    bool ok;
+    Format format;
+
+    uint8_t window[2 * MCP_GZIP_WINDOW];
+    uint16_t head[1 << MCP_GZIP_HASH_BITS];  // window position + 1 of the newest string per hash; 0 = none
+    uint16_t prev[MCP_GZIP_WINDOW];          // older position + 1 with the same hash, by position
+    size_t winLen;
+    size_t pos;
+    size_t matchLen;       // match starting at pos - 1, decided at pos (lazy matching)
+    size_t matchDist;
+    bool literalPending;   // window[pos - 1] not recorded yet
+
+    // Current block: literal byte or match length - 3, and match distance (0 = literal)
+    uint8_t symValue[MCP_GZIP_BLOCK_SYMBOLS];
+    uint16_t symDist[MCP_GZIP_BLOCK_SYMBOLS];
+    size_t symCount;
+    uint16_t litFreq[kLitCodes];
+    uint16_t distFreq[kDistCodes];
+    // Tables of the block being written
+    uint8_t litLen[kFixedLitCodes];
+    uint16_t litCode[kFixedLitCodes];
+    uint8_t distLen[kDistCodes];
+    uint16_t distCode[kDistCodes];
+    // Huffman construction scratch: (frequency, symbol) sorted by frequency
+    struct SymFreq {
+        uint16_t key;
+        uint16_t sym;
+    };
+    SymFreq sorted[kLitCodes];
+
+    uint32_t bitBuf;
+    uint8_t bitCount;
+    uint8_t out[MCP_GZIP_OUT_MAX];
+    size_t outLen;
+
+    uint32_t crc;
+    size_t inBytes;
+    size_t outBytes;
+    uint32_t cpuUs;
+    uint32_t sinkUs;
+};
+
+} // namespace mcp
+
+#endif // MCP_GZIP_H
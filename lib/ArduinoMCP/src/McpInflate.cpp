@@ -0,0 +1,274 @@
+/**
+ * McpInflate - small raw deflate (RFC 1951) decoder
+ * Implementation file (structure after zlib's contrib/puff)
+ *
+ * @author warusakudeveroper
+ * @license MIT
+ */
+
+#include "McpInflate.h"
+
+#include <string.h>
+
+namespace mcp {
+
+namespace {
+
+constexpr int kMaxBits = 15;
+constexpr int kLitCodes = 288;  // fixed table numbers the two unused codes too
+constexpr int kDistCodes = 30;
+
+// RFC 1951 3.2.5
+const uint16_t kLenBase[29] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                               31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+const uint8_t kLenExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                               2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+const uint16_t kDistBase[30] = {1,    2,    3,    4,    5,    7,    9,    13,    17,    25,
+                                33,   49,   65,   97,   129,  193,  257,  385,   513,   769,
+                                1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+const uint8_t kDistExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+                                6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+const uint8_t kClOrder[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+// Canonical code: number of codes per length, symbols ordered by code
+struct Huffman {
+    uint16_t count[kMaxBits + 1];
+    uint16_t symbol[kLitCodes];
+};
+
+struct State {
+    const uint8_t* in;
+    size_t inLen;
+    size_t inPos;
+    uint32_t bitBuf;
+    int bitCount;
+    uint8_t* out;
+    size_t outCap;
+    size_t outPos;
+    InflateResult error;  // Ok until something fails
+
+    uint32_t bits(int need) {
+        while (bitCount < need) {
+            if (inPos == inLen) {
+                fail(InflateResult::Truncated);
+                return 0;
+            }
+            bitBuf |= (uint32_t)in[inPos++] << bitCount;
+            bitCount += 8;
+        }
+        const uint32_t v = bitBuf & ((1u << need) - 1);
+        bitBuf >>= need;
+        bitCount -= need;
+        return v;
+    }
+
+    void fail(InflateResult r) {
+        if (error == InflateResult::Ok) error = r;
+    }
+
+    bool atEnd() const { return inPos == inLen && bitCount == 0; }
+};
+
+// Codes of the given lengths; false if over-subscribed. Incomplete codes are
+// accepted (one-code distance trees are legal); decode() fails on the
+// unused codes.
+bool build(Huffman& h, const uint8_t* lengths, int n) {
+    memset(h.count, 0, sizeof(h.count));
+    for (int i = 0; i < n; i++) h.count[lengths[i]]++;
+    if (h.count[0] == n) return true;
+    int left = 1;
+    for (int len = 1; len <= kMaxBits; len++) {
+        left <<= 1;
+        left -= h.count[len];
+        if (left < 0) return false;
+    }
+    uint16_t offs[kMaxBits + 1];
+    offs[1] = 0;
+    for (int len = 1; len < kMaxBits; len++) offs[len + 1] = (uint16_t)(offs[len] + h.count[len]);
+    for (int i = 0; i < n; i++) {
+        if (lengths[i] != 0) h.symbol[offs[lengths[i]]++] = (uint16_t)i;
+    }
+    return true;
+}
+
+int decode(State& s, const Huffman& h) {
+    int code = 0;
+    int first = 0;
+    int index = 0;
+    for (int len = 1; len <= kMaxBits; len++) {
+        code |= (int)s.bits(1);
+        if (s.error != InflateResult::Ok) return -1;
+        const int count = h.count[len];
+        if (code - count < first) return h.symbol[index + (code - first)];
+        index += count;
+        first += count;
+        first <<= 1;
+        code <<= 1;
+    }
+    s.fail(InflateResult::BadData);
+    return -1;
+}
+
+void stored(State& s) {
+    s.bitBuf = 0;  // rest of the current byte
+    s.bitCount = 0;
+    if (s.inPos + 4 > s.inLen) {
+        s.fail(InflateResult::Truncated);
+        return;
+    }
+    const uint16_t len = (uint16_t)(s.in[s.inPos] | s.in[s.inPos + 1] << 8);
+    const uint16_t nlen = (uint16_t)(s.in[s.inPos + 2] | s.in[s.inPos + 3] << 8);
+    s.inPos += 4;
+    if (len != (uint16_t)~nlen) {
+        s.fail(InflateResult::BadData);
+        return;
+    }
+    if (s.inPos + len > s.inLen) {
+        s.fail(InflateResult::Truncated);
+        return;
+    }
+    if (s.outPos + len > s.outCap) {
+        s.fail(InflateResult::OutputFull);
+        return;
+    }
+    memcpy(s.out + s.outPos, s.in + s.inPos, len);
+    s.outPos += len;
+    s.inPos += len;
+}
+
+void codes(State& s, const Huffman& lencode, const Huffman& distcode) {
+    for (;;) {
+        int sym = decode(s, lencode);
+        if (sym < 0) return;
+        if (sym < 256) {
+            if (s.outPos == s.outCap) {
+                s.fail(InflateResult::OutputFull);
+                return;
+            }
+            s.out[s.outPos++] = (uint8_t)sym;
+            continue;
+        }
+        if (sym == 256) return;
+        sym -= 257;
+        if (sym >= 29) {
+            s.fail(InflateResult::BadData);
+            return;
+        }
+        const size_t len = kLenBase[sym] + s.bits(kLenExtra[sym]);
+        const int dsym = decode(s, distcode);
+        if (dsym < 0) return;
+        if (dsym >= kDistCodes) {
+            s.fail(InflateResult::BadData);
+            return;
+        }
+        const size_t dist = kDistBase[dsym] + s.bits(kDistExtra[dsym]);
+        if (s.error != InflateResult::Ok) return;
+        if (dist > s.outPos) {
+            s.fail(InflateResult::BadData);
+            return;
+        }
+        if (s.outPos + len > s.outCap) {
+            s.fail(InflateResult::OutputFull);
+            return;
+        }
+        // Byte by byte: the source may overlap what is being written.
+        for (size_t i = 0; i < len; i++, s.outPos++) s.out[s.outPos] = s.out[s.outPos - dist];
+    }
+}
+
+void fixed(State& s) {
+    Huffman lencode;
+    Huffman distcode;
+    uint8_t lengths[kLitCodes];
+    int i = 0;
+    for (; i < 144; i++) lengths[i] = 8;
+    for (; i < 256; i++) lengths[i] = 9;
+    for (; i < 280; i++) lengths[i] = 7;
+    for (; i < kLitCodes; i++) lengths[i] = 8;
+    build(lencode, lengths, kLitCodes);
+    memset(lengths, 5, kDistCodes);
+    build(distcode, lengths, kDistCodes);
+    codes(s, lencode, distcode);
+}
+
+void dynamic(State& s) {
+    const int nlen = (int)s.bits(5) + 257;
+    const int ndist = (int)s.bits(5) + 1;
+    const int ncode = (int)s.bits(4) + 4;
+    if (s.error != InflateResult::Ok) return;
+    if (nlen > 286 || ndist > kDistCodes) {
+        s.fail(InflateResult::BadData);
+        return;
+    }
+
+    uint8_t lengths[286 + kDistCodes];
+    memset(lengths, 0, 19);
+    for (int i = 0; i < ncode; i++) lengths[kClOrder[i]] = (uint8_t)s.bits(3);
+    Huffman lencode;
+    Huffman distcode;
+    if (s.error != InflateResult::Ok) return;
+    if (!build(lencode, lengths, 19)) {
+        s.fail(InflateResult::BadData);
+        return;
+    }
+
+    // Code length codes: 16 = repeat previous 3-6, 17 = 3-10 zeros, 18 = 11-138 zeros
+    for (int i = 0; i < nlen + ndist;) {
+        const int sym = decode(s, lencode);
+        if (sym < 0) return;
+        if (sym < 16) {
+            lengths[i++] = (uint8_t)sym;
+            continue;
+        }
+        uint8_t value = 0;
+        int repeat;
+        if (sym == 16) {
+            if (i == 0) {
+                s.fail(InflateResult::BadData);
+                return;
+            }
+            value = lengths[i - 1];
+            repeat = 3 + (int)s.bits(2);
+        } else if (sym == 17) {
+            repeat = 3 + (int)s.bits(3);
+        } else {
+            repeat = 11 + (int)s.bits(7);
+        }
+        if (s.error != InflateResult::Ok) return;
+        if (i + repeat > nlen + ndist) {
+            s.fail(InflateResult::BadData);
+            return;
+        }
+        while (repeat-- > 0) lengths[i++] = value;
+    }
+    if (lengths[256] == 0 || !build(lencode, lengths, nlen) || !build(distcode, lengths + nlen, ndist)) {
+        s.fail(InflateResult::BadData);
+        return;
+    }
+    codes(s, lencode, distcode);
+}
+
+} // namespace
+
+InflateResult inflateRaw(const uint8_t* in, size_t inLen, uint8_t* out, size_t outCap, size_t& outLen) {
+    State s = {in, inLen, 0, 0, 0, out, outCap, 0, InflateResult::Ok};
+    bool last = false;
+    while (!last && !s.atEnd() && s.error == InflateResult::Ok) {
+        last = s.bits(1) != 0;
+        const uint32_t type = s.bits(2);
+        if (s.error != InflateResult::Ok) break;
+        if (type == 0) {
+            stored(s);
+        } else if (type == 1) {
+            fixed(s);
+        } else if (type == 2) {
+            dynamic(s);
+        } else {
+            s.fail(InflateResult::BadData);
+        }
+    }
+    outLen = s.outPos;
+    return s.error;
+}
+
+} // namespace mcp
@@ -0,0 +1,41 @@
+/**
+ * McpInflate - small raw deflate (RFC 1951) decoder
+ *
+ * Decodes a deflate stream held in memory into a caller buffer that takes
+ * all of its output (no sliding window, so back references must stay inside
+ * that output). Meant for independently decodable pieces such as the
+ * segments McpGzip writes (Format::Segment) and McpZFile stores per block:
+ * decoding stops after a final block, or when the input ends on a block
+ * boundary.
+ *
+ * Huffman codes are decoded bit by bit over canonical code counts; the
+ * tables take about 1 KB of stack and nothing is allocated.
+ *
+ * @author warusakudeveroper
+ * @license MIT
+ */
+
+#ifndef MCP_INFLATE_H
+#define MCP_INFLATE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace mcp {
+
+enum class InflateResult : uint8_t {
+    Ok,
+    OutputFull,  // out is too small for the decoded data
+    Truncated,   // input ends inside a block
+    BadData,     // invalid block type, code or distance
+};
+
+/**
+ * Decode in[0, inLen) into out
+ * @param outLen Bytes written to out (also on failure)
+ */
+InflateResult inflateRaw(const uint8_t* in, size_t inLen, uint8_t* out, size_t outCap, size_t& outLen);
+
+} // namespace mcp
+
+#endif // MCP_INFLATE_H
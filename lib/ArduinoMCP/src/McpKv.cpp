@@ -0,0 +1,666 @@
+/**
+ * McpKv - typed key/value store on NVS for ArduinoMCP and sketches
+ * Implementation file
+ *
+ * @author warusakudeveroper
+ * @license MIT
+ */
+
+#include "McpKv.h"
+#include "McpArena.h"
+#include "McpChunkedPrint.h"
+#include "McpEscape.h"
+
+#include <WebServer.h>
+#include <esp_idf_version.h>
+#include <esp_timer.h>
+#include <nvs.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace mcp {
+namespace kv {
+
+namespace {
+
+struct Slot {
+    char ns[MCP_KV_NAME_MAX + 1];
+    nvs_handle_t handle;
+    bool open;
+    bool writable;
+    uint32_t lastUse;
+};
+
+Slot slots[MCP_KV_HANDLES];
+uint32_t useClock = 0;
+esp_err_t lastErr = ESP_OK;
+
+const char* const kTypeNames[] = {"i8", "u8", "i16", "u16", "i32", "u32", "i64", "u64", "str", "blob"};
+
+bool check(esp_err_t err) {
+    lastErr = err;
+    return err == ESP_OK;
+}
+
+bool validName(const char* name) {
+    return name != nullptr && name[0] != '\0' && strlen(name) <= MCP_KV_NAME_MAX;
+}
+
+// Open (or reuse) the handle of a namespace. A read-only open of a namespace
+// that was never written fails with ESP_ERR_NVS_NOT_FOUND, so reads do not
+// create it.
+bool handleFor(const char* ns, const char* key, bool write, nvs_handle_t& out) {
+    if (!validName(ns) || (key != nullptr && !validName(key))) {
+        lastErr = ESP_ERR_NVS_INVALID_NAME;
+        return false;
+    }
+    Slot* slot = nullptr;
+    for (Slot& s : slots) {
+        if (s.open && strcmp(s.ns, ns) == 0) {
+            if (!write || s.writable) {
+                s.lastUse = ++useClock;
+                out = s.handle;
+                return true;
+            }
+            slot = &s;  // reopen read-write
+            break;
+        }
+    }
+    if (slot == nullptr) {
+        slot = &slots[0];
+        for (Slot& s : slots) {
+            if (!s.open) {
+                slot = &s;
+                break;
+            }
+            if (s.lastUse < slot->lastUse) slot = &s;
+        }
+    }
+    if (slot->open) {
+        nvs_close(slot->handle);
+        slot->open = false;
+    }
+    if (!check(nvs_open(ns, write ? NVS_READWRITE : NVS_READONLY, &slot->handle))) return false;
+    strcpy(slot->ns, ns);
+    slot->open = true;
+    slot->writable = write;
+    slot->lastUse = ++useClock;
+    out = slot->handle;
+    return true;
+}
+
+template <typename T>
+bool setWith(esp_err_t (*setter)(nvs_handle_t, const char*, T), const char* ns, const char* key, T value) {
+    nvs_handle_t h;
+    if (!handleFor(ns, key, true, h)) return false;
+    return check(setter(h, key, value)) && check(nvs_commit(h));
+}
+
+template <typename T>
+bool getWith(esp_err_t (*getter)(nvs_handle_t, const char*, T*), const char* ns, const char* key, T& value) {
+    nvs_handle_t h;
+    if (!handleFor(ns, key, false, h)) return false;
+    return check(getter(h, key, &value));
+}
+
+// Integer entry widened to 64 bits (signed types sign-extended)
+bool getInteger(const char* ns, const char* key, Type type, uint64_t& value) {
+    switch (type) {
+        case Type::I8: {
+            int8_t v;
+            if (!getWith(nvs_get_i8, ns, key, v)) return false;
+            value = (uint64_t)(int64_t)v;
+            return true;
+        }
+        case Type::U8: {
+            uint8_t v;
+            if (!getWith(nvs_get_u8, ns, key, v)) return false;
+            value = v;
+            return true;
+        }
+        case Type::I16: {
+            int16_t v;
+            if (!getWith(nvs_get_i16, ns, key, v)) return false;
+            value = (uint64_t)(int64_t)v;
+            return true;
+        }
+        case Type::U16: {
+            uint16_t v;
+            if (!getWith(nvs_get_u16, ns, key, v)) return false;
+            value = v;
+            return true;
+        }
+        case Type::I32: {
+            int32_t v;
+            if (!getWith(nvs_get_i32, ns, key, v)) return false;
+            value = (uint64_t)(int64_t)v;
+            return true;
+        }
+        case Type::U32: {
+            uint32_t v;
+            if (!getWith(nvs_get_u32, ns, key, v)) return false;
+            value = v;
+            return true;
+        }
+        case Type::I64: {
+            int64_t v;
+            if (!getWith(nvs_get_i64, ns, key, v)) return false;
+            value = (uint64_t)v;
+            return true;
+        }
+        case Type::U64:
+            return getWith(nvs_get_u64, ns, key, value);
+        default:
+            lastErr = ESP_ERR_INVALID_ARG;
+            return false;
+    }
+}
+
+bool isSigned(Type type) {
+    return type == Type::I8 || type == Type::I16 || type == Type::I32 || type == Type::I64;
+}
+
+Type fromNvsType(nvs_type_t type) {
+    switch (type) {
+        case NVS_TYPE_I8: return Type::I8;
+        case NVS_TYPE_U8: return Type::U8;
+        case NVS_TYPE_I16: return Type::I16;
+        case NVS_TYPE_U16: return Type::U16;
+        case NVS_TYPE_I32: return Type::I32;
+        case NVS_TYPE_U32: return Type::U32;
+        case NVS_TYPE_I64: return Type::I64;
+        case NVS_TYPE_U64: return Type::U64;
+        case NVS_TYPE_STR: return Type::Str;
+        case NVS_TYPE_BLOB: return Type::Blob;
+        default: return Type::None;
+    }
+}
+
+// Length of a str (terminator included) or blob entry
+bool variableLength(const char* ns, const char* key, Type type, size_t& len) {
+    nvs_handle_t h;
+    if (!handleFor(ns, key, false, h)) return false;
+    len = 0;
+    return check(type == Type::Str ? nvs_get_str(h, key, nullptr, &len) : nvs_get_blob(h, key, nullptr, &len));
+}
+
+int hexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+int httpStatus(esp_err_t err) {
+    switch (err) {
+        case ESP_ERR_NVS_NOT_FOUND:
+            return 404;
+        case ESP_ERR_NVS_NOT_ENOUGH_SPACE:
+            return 507;
+        case ESP_ERR_INVALID_ARG:
+        case ESP_ERR_NVS_INVALID_NAME:
+        case ESP_ERR_NVS_KEY_TOO_LONG:
+        case ESP_ERR_NVS_VALUE_TOO_LONG:
+        case ESP_ERR_NVS_INVALID_LENGTH:
+        case ESP_ERR_NVS_TYPE_MISMATCH:
+            return 400;
+        default:
+            return 500;
+    }
+}
+
+void sendError(WebServer& server, int code, const char* message) {
+    String json = "{\"ok\":false,\"error\":\"";
+    json += message;
+    json += "\"}";
+    server.send(code, "application/json", json);
+}
+
+void sendNvsError(WebServer& server) {
+    String json = "{\"ok\":false,\"error\":\"";
+    json += esp_err_to_name(lastErr);
+    json += "\"}";
+    server.send(httpStatus(lastErr), "application/json", json);
+}
+
+// "ns":"...","key":"..." (names were validated, but may hold any character)
+void appendNames(String& json, const char* ns, const char* key) {
+    json += "\"ns\":\"";
+    appendJsonEscaped(json, ns, strlen(ns));
+    json += "\",\"key\":\"";
+    appendJsonEscaped(json, key, strlen(key));
+    json += "\"";
+}
+
+bool requireNames(WebServer& server, bool keyRequired) {
+    if (!server.hasArg("ns") || (keyRequired && !server.hasArg("key"))) {
+        sendError(server, 400, keyRequired ? "ns and key parameters required" : "ns parameter required");
+        return false;
+    }
+    return true;
+}
+
+struct ListContext {
+    Print* out;
+    size_t count;
+};
+
+bool writeListEntry(const Entry& e, void* ctx) {
+    ListContext& list = *static_cast<ListContext*>(ctx);
+    String json;
+    json.reserve(96);
+    json += list.count++ > 0 ? ",{" : "{";
+    appendNames(json, e.ns, e.key);
+    json += ",\"type\":\"";
+    json += typeName(e.type);
+    json += "\",";
+    size_t len;
+    if (e.type == Type::Blob) {
+        // Blobs can be large; /api/kv/get returns the bytes.
+        json += "\"size\":";
+        json += String((unsigned)(variableLength(e.ns, e.key, Type::Blob, len) ? len : 0));
+    } else {
+        json += "\"value\":";
+        if (!appendJsonValue(json, e.ns, e.key)) json += "null";
+    }
+    json += "}";
+    list.out->print(json);
+    return true;
+}
+
+} // namespace
+
+const char* typeName(Type type) {
+    return type < Type::None ? kTypeNames[(int)type] : "none";
+}
+
+Type typeFromName(const char* name) {
+    for (int i = 0; i < (int)Type::None; i++) {
+        if (name != nullptr && strcmp(name, kTypeNames[i]) == 0) return (Type)i;
+    }
+    return Type::None;
+}
+
+bool setI32(const char* ns, const char* key, int32_t value) {
+    return setWith(nvs_set_i32, ns, key, value);
+}
+
+bool setU32(const char* ns, const char* key, uint32_t value) {
+    return setWith(nvs_set_u32, ns, key, value);
+}
+
+bool setI64(const char* ns, const char* key, int64_t value) {
+    return setWith(nvs_set_i64, ns, key, value);
+}
+
+bool setU64(const char* ns, const char* key, uint64_t value) {
+    return setWith(nvs_set_u64, ns, key, value);
+}
+
+bool setBool(const char* ns, const char* key, bool value) {
+    return setWith(nvs_set_u8, ns, key, (uint8_t)(value ? 1 : 0));
+}
+
+bool setStr(const char* ns, const char* key, const char* value) {
+    nvs_handle_t h;
+    if (!handleFor(ns, key, true, h)) return false;
+    return check(nvs_set_str(h, key, value)) && check(nvs_commit(h));
+}
+
+bool setBlob(const char* ns, const char* key, const void* data, size_t len) {
+    nvs_handle_t h;
+    if (!handleFor(ns, key, true, h)) return false;
+    return check(nvs_set_blob(h, key, data, len)) && check(nvs_commit(h));
+}
+
+bool setText(const char* ns, const char* key, Type type, const char* text) {
+    if (type == Type::Str) return setStr(ns, key, text);
+    if (type == Type::Blob) {
+        size_t n = strlen(text);
+        if (n % 2 != 0) {
+            lastErr = ESP_ERR_INVALID_ARG;
+            return false;
+        }
+        arena::Mark mark;
+        uint8_t* bytes = (uint8_t*)arena::alloc(n / 2 + 1);
+        if (bytes == nullptr) {
+            lastErr = ESP_ERR_NO_MEM;
+            return false;
+        }
+        bool ok = true;
+        for (size_t i = 0; i < n && ok; i += 2) {
+            int hi = hexDigit(text[i]);
+            int lo = hexDigit(text[i + 1]);
+            ok = hi >= 0 && lo >= 0;
+            bytes[i / 2] = (uint8_t)(hi << 4 | lo);
+        }
+        if (ok) {
+            ok = setBlob(ns, key, bytes, n / 2);
+        } else {
+            lastErr = ESP_ERR_INVALID_ARG;
+        }
+        return ok;
+    }
+    if (type == Type::None || *text == '\0') {
+        lastErr = ESP_ERR_INVALID_ARG;
+        return false;
+    }
+
+    char* end = nullptr;
+    errno = 0;
+    int64_t s = 0;
+    uint64_t u = 0;
+    if (isSigned(type)) {
+        s = strtoll(text, &end, 10);
+    } else if (*text != '-') {
+        u = strtoull(text, &end, 10);
+    }
+    if (end == nullptr || *end != '\0' || errno == ERANGE) {
+        lastErr = ESP_ERR_INVALID_ARG;
+        return false;
+    }
+    bool inRange = true;
+    switch (type) {
+        case Type::I8: inRange = s >= INT8_MIN && s <= INT8_MAX; break;
+        case Type::U8: inRange = u <= UINT8_MAX; break;
+        case Type::I16: inRange = s >= INT16_MIN && s <= INT16_MAX; break;
+        case Type::U16: inRange = u <= UINT16_MAX; break;
+        case Type::I32: inRange = s >= INT32_MIN && s <= INT32_MAX; break;
+        case Type::U32: inRange = u <= UINT32_MAX; break;
+        default: break;
+    }
+    if (!inRange) {
+        lastErr = ESP_ERR_INVALID_ARG;
+        return false;
+    }
+    switch (type) {
+        case Type::I8: return setWith(nvs_set_i8, ns, key, (int8_t)s);
+        case Type::U8: return setWith(nvs_set_u8, ns, key, (uint8_t)u);
+        case Type::I16: return setWith(nvs_set_i16, ns, key, (int16_t)s);
+        case Type::U16: return setWith(nvs_set_u16, ns, key, (uint16_t)u);
+        case Type::I32: return setI32(ns, key, (int32_t)s);
+        case Type::U32: return setU32(ns, key, (uint32_t)u);
+        case Type::I64: return setI64(ns, key, s);
+        default: return setU64(ns, key, u);
+    }
+}
+
+int32_t getI32(const char* ns, const char* key, int32_t defaultValue) {
+    int32_t v;
+    return getWith(nvs_get_i32, ns, key, v) ? v : defaultValue;
+}
+
+uint32_t getU32(const char* ns, const char* key, uint32_t defaultValue) {
+    uint32_t v;
+    return getWith(nvs_get_u32, ns, key, v) ? v : defaultValue;
+}
+
+int64_t getI64(const char* ns, const char* key, int64_t defaultValue) {
+    int64_t v;
+    return getWith(nvs_get_i64, ns, key, v) ? v : defaultValue;
+}
+
+uint64_t getU64(const char* ns, const char* key, uint64_t defaultValue) {
+    uint64_t v;
+    return getWith(nvs_get_u64, ns, key, v) ? v : defaultValue;
+}
+
+bool getBool(const char* ns, const char* key, bool defaultValue) {
+    uint8_t v;
+    return getWith(nvs_get_u8, ns, key, v) ? v != 0 : defaultValue;
+}
+
+String getStr(const char* ns, const char* key, const String& defaultValue) {
+    size_t len;
+    if (!variableLength(ns, key, Type::Str, len)) return defaultValue;
+    arena::Mark mark;
+    char* buf = (char*)arena::alloc(len);
+    if (buf == nullptr) {
+        lastErr = ESP_ERR_NO_MEM;
+        return defaultValue;
+    }
+    nvs_handle_t h;
+    String value = defaultValue;
+    if (handleFor(ns, key, false, h) && check(nvs_get_str(h, key, buf, &len))) value = buf;
+    return value;
+}
+
+size_t getBlob(const char* ns, const char* key, void* buf, size_t maxLen) {
+    size_t len;
+    if (!variableLength(ns, key, Type::Blob, len)) return 0;
+    if (len > maxLen) {
+        lastErr = ESP_ERR_NVS_INVALID_LENGTH;
+        return 0;
+    }
+    nvs_handle_t h;
+    if (!handleFor(ns, key, false, h) || !check(nvs_get_blob(h, key, buf, &len))) return 0;
+    return len;
+}
+
+Type typeOf(const char* ns, const char* key) {
+    for (int i = 0; i < (int)Type::Str; i++) {
+        uint64_t v;
+        if (getInteger(ns, key, (Type)i, v)) return (Type)i;
+        if (lastErr != ESP_ERR_NVS_NOT_FOUND) return Type::None;  // bad name, namespace missing
+    }
+    size_t len;
+    if (variableLength(ns, key, Type::Str, len)) return Type::Str;
+    if (variableLength(ns, key, Type::Blob, len)) return Type::Blob;
+    return Type::None;
+}
+
+bool appendJsonValue(String& json, const char* ns, const char* key, Type* type) {
+    Type t = typeOf(ns, key);
+    if (type != nullptr) *type = t;
+    if (t == Type::None) return false;
+
+    char num[24];
+    if (t == Type::Str) {
+        String value = getStr(ns, key);
+        json += "\"";
+        appendJsonEscaped(json, value);
+        json += "\"";
+        return true;
+    }
+    if (t == Type::Blob) {
+        size_t len;
+        if (!variableLength(ns, key, Type::Blob, len)) return false;
+        arena::Mark mark;
+        uint8_t* bytes = (uint8_t*)arena::alloc(len);
+        if (bytes == nullptr) {
+            lastErr = ESP_ERR_NO_MEM;
+            return false;
+        }
+        bool ok = getBlob(ns, key, bytes, len) == len;
+        if (ok) {
+            json.reserve(json.length() + 2 * len + 2);
+            json += "\"";
+            for (size_t i = 0; i < len; i++) {
+                snprintf(num, sizeof(num), "%02x", bytes[i]);
+                json += num;
+            }
+            json += "\"";
+        }
+        return ok;
+    }
+    uint64_t v;
+    if (!getInteger(ns, key, t, v)) return false;
+    if (isSigned(t)) {
+        snprintf(num, sizeof(num), "%lld", (long long)(int64_t)v);
+    } else {
+        snprintf(num, sizeof(num), "%llu", (unsigned long long)v);
+    }
+    json += num;
+    return true;
+}
+
+bool remove(const char* ns, const char* key) {
+    nvs_handle_t h;
+    if (!handleFor(ns, key, true, h)) return false;
+    return check(nvs_erase_key(h, key)) && check(nvs_commit(h));
+}
+
+bool clear(const char* ns) {
+    nvs_handle_t h;
+    if (!handleFor(ns, nullptr, true, h)) return false;
+    return check(nvs_erase_all(h)) && check(nvs_commit(h));
+}
+
+size_t list(const char* ns, bool (*fn)(const Entry& entry, void* ctx), void* ctx) {
+    size_t visited = 0;
+    Entry e;
+    nvs_entry_info_t info;
+#if ESP_IDF_VERSION_MAJOR >= 5
+    nvs_iterator_t it = nullptr;
+    esp_err_t err = nvs_entry_find(NVS_DEFAULT_PART_NAME, ns, NVS_TYPE_ANY, &it);
+    while (err == ESP_OK) {
+        nvs_entry_info(it, &info);
+        snprintf(e.ns, sizeof(e.ns), "%s", info.namespace_name);
+        snprintf(e.key, sizeof(e.key), "%s", info.key);
+        e.type = fromNvsType(info.type);
+        visited++;
+        if (!fn(e, ctx)) break;
+        err = nvs_entry_next(&it);
+    }
+    nvs_release_iterator(it);
+#else
+    nvs_iterator_t it = nvs_entry_find(NVS_DEFAULT_PART_NAME, ns, NVS_TYPE_ANY);
+    while (it != nullptr) {
+        nvs_entry_info(it, &info);
+        snprintf(e.ns, sizeof(e.ns), "%s", info.namespace_name);
+        snprintf(e.key, sizeof(e.key), "%s", info.key);
+        e.type = fromNvsType(info.type);
+        visited++;
+        if (!fn(e, ctx)) {
+            nvs_release_iterator(it);
+            break;
+        }
+        it = nvs_entry_next(it);
+    }
+#endif
+    return visited;
+}
+
+bool stats(size_t& usedEntries, size_t& freeEntries, size_t& totalEntries) {
+    nvs_stats_t s;
+    if (!check(nvs_get_stats(NVS_DEFAULT_PART_NAME, &s))) return false;
+    usedEntries = s.used_entries;
+    freeEntries = s.free_entries;
+    totalEntries = s.total_entries;
+    return true;
+}
+
+esp_err_t lastError() {
+    return lastErr;
+}
+
+void closeAll() {
+    for (Slot& s : slots) {
+        if (s.open) nvs_close(s.handle);
+        s.open = false;
+    }
+}
+
+void handleGet(WebServer& server) {
+    if (!requireNames(server, true)) return;
+    String ns = server.arg("ns");
+    String key = server.arg("key");
+    String json = "{\"ok\":true,";
+    appendNames(json, ns.c_str(), key.c_str());
+    json += ",\"value\":";
+    Type type;
+    if (!appendJsonValue(json, ns.c_str(), key.c_str(), &type)) {
+        sendNvsError(server);
+        return;
+    }
+    json += ",\"type\":\"";
+    json += typeName(type);
+    json += "\"}";
+    server.send(200, "application/json", json);
+}
+
+void handleSet(WebServer& server) {
+    if (!requireNames(server, true)) return;
+    Type type = server.hasArg("type") ? typeFromName(server.arg("type").c_str()) : Type::Str;
+    if (type == Type::None) {
+        sendError(server, 400, "type must be i8, u8, i16, u16, i32, u32, i64, u64, str or blob");
+        return;
+    }
+    const char* source = server.hasArg("value") ? "value" : "plain";
+    if (!server.hasArg(source)) {
+        sendError(server, 400, "value parameter or body required");
+        return;
+    }
+    String ns = server.arg("ns");
+    String key = server.arg("key");
+    String value = server.arg(source);
+
+    int64_t t0 = esp_timer_get_time();
+    if (!setText(ns.c_str(), key.c_str(), type, value.c_str())) {
+        sendNvsError(server);
+        return;
+    }
+    int64_t us = esp_timer_get_time() - t0;
+
+    String json = "{\"ok\":true,";
+    appendNames(json, ns.c_str(), key.c_str());
+    json += ",\"type\":\"";
+    json += typeName(type);
+    json += "\",\"us\":";
+    json += String((long)us);
+    json += "}";
+    server.send(200, "application/json", json);
+}
+
+void handleDelete(WebServer& server) {
+    if (!requireNames(server, false)) return;
+    String ns = server.arg("ns");
+    String json = "{\"ok\":true,";
+    if (server.hasArg("key")) {
+        String key = server.arg("key");
+        if (!remove(ns.c_str(), key.c_str())) {
+            sendNvsError(server);
+            return;
+        }
+        appendNames(json, ns.c_str(), key.c_str());
+    } else {
+        if (!clear(ns.c_str())) {
+            sendNvsError(server);
+            return;
+        }
+        json += "\"ns\":\"";
+        appendJsonEscaped(json, ns);
+        json += "\"";
+    }
+    json += "}";
+    server.send(200, "application/json", json);
+}
+
+void handleList(WebServer& server) {
+    String ns = server.arg("ns");
+    if (ns.length() > 0 && !validName(ns.c_str())) {
+        sendError(server, 400, "ns must be 1-15 characters");
+        return;
+    }
+    server.sendHeader("Cache-Control", "no-store");
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, "application/json", "");
+    ChunkedPrint out(server);
+    out.print("{\"ok\":true,\"entries\":[");
+    ListContext ctx{&out, 0};
+    list(ns.length() > 0 ? ns.c_str() : nullptr, writeListEntry, &ctx);
+
+    char tail[96];
+    size_t used = 0, free = 0, total = 0;
+    stats(used, free, total);
+    snprintf(tail, sizeof(tail), "],\"count\":%u,\"usedEntries\":%u,\"freeEntries\":%u,\"totalEntries\":%u}",
+             (unsigned)ctx.count, (unsigned)used, (unsigned)free, (unsigned)total);
+    out.print(tail);
+    out.flush();
+}
+
+} // namespace kv
+} // namespace mcp
@@ -0,0 +1,139 @@
+/**
+ * McpKv - typed key/value store on NVS for ArduinoMCP and sketches
+ *
+ * Small hot values (counters, flags, last-seen state) belong in NVS rather
+ * than in SPIFFS files: an update is one entry write instead of a file
+ * create / truncate / page program cycle, and NVS spreads its writes over
+ * all of its pages. Values are typed (i8 .. u64, str, blob) and grouped in
+ * namespaces; namespace and key names are 1-15 characters (NVS limit).
+ *
+ *   uint32_t boots = mcp::kv::getU32("app", "boots") + 1;
+ *   mcp::kv::setU32("app", "boots", boots);
+ *
+ * Getters return the default when the key is missing or holds another type.
+ * Handles of the last MCP_KV_HANDLES namespaces stay open, so repeated
+ * updates skip nvs_open(). Not thread-safe: use it from one task (the loop
+ * task, where the WebServer handlers run as well).
+ *
+ * HTTP API (text form: integers in decimal, str as is, blob in hex):
+ *   GET    /api/kv/get?ns=app&key=boots
+ *          {"ok":true,"ns":"app","key":"boots","type":"u32","value":3}
+ *   POST   /api/kv/set?ns=app&key=boots&type=u32&value=4  (value may be the
+ *          body instead; type defaults to str)
+ *   DELETE /api/kv/delete?ns=app&key=boots  (without key: the whole namespace)
+ *   GET    /api/kv/list[?ns=app]  entries with types and values, NVS usage
+ *
+ * i64 / u64 values are JSON numbers; JavaScript reads them exactly only up
+ * to 2^53.
+ *
+ * @author warusakudeveroper
+ * @license MIT
+ */
+
+#ifndef MCP_KV_H
+#define MCP_KV_H
+
+#include <Arduino.h>
+#include <esp_err.h>
+
+// Namespaces whose NVS handle is kept open
+#ifndef MCP_KV_HANDLES
+#define MCP_KV_HANDLES 4
+#endif
+
+#define MCP_KV_NAME_MAX 15
+
+class WebServer;
+
+namespace mcp {
+namespace kv {
+
+enum class Type : uint8_t { I8, U8, I16, U16, I32, U32, I64, U64, Str, Blob, None };
+
+/**
+ * "i8" .. "u64", "str", "blob"; typeFromName() returns None if unknown
+ */
+const char* typeName(Type type);
+Type typeFromName(const char* name);
+
+bool setI32(const char* ns, const char* key, int32_t value);
+bool setU32(const char* ns, const char* key, uint32_t value);
+bool setI64(const char* ns, const char* key, int64_t value);
+bool setU64(const char* ns, const char* key, uint64_t value);
+bool setBool(const char* ns, const char* key, bool value);  // stored as u8
+bool setStr(const char* ns, const char* key, const char* value);
+bool setBlob(const char* ns, const char* key, const void* data, size_t len);
+
+/**
+ * Set from the text form (the HTTP API's); fails if it does not parse or
+ * is out of range for the type
+ */
+bool setText(const char* ns, const char* key, Type type, const char* text);
+
+int32_t getI32(const char* ns, const char* key, int32_t defaultValue = 0);
+uint32_t getU32(const char* ns, const char* key, uint32_t defaultValue = 0);
+int64_t getI64(const char* ns, const char* key, int64_t defaultValue = 0);
+uint64_t getU64(const char* ns, const char* key, uint64_t defaultValue = 0);
+bool getBool(const char* ns, const char* key, bool defaultValue = false);
+String getStr(const char* ns, const char* key, const String& defaultValue = String());
+
+/**
+ * Copy a blob into buf
+ * @return Its length; 0 if missing or longer than maxLen
+ */
+size_t getBlob(const char* ns, const char* key, void* buf, size_t maxLen);
+
+/**
+ * Type of the entry, None if there is none
+ */
+Type typeOf(const char* ns, const char* key);
+
+/**
+ * Append the value as JSON (number, string or hex string)
+ * @return false if the key does not exist
+ */
+bool appendJsonValue(String& json, const char* ns, const char* key, Type* type = nullptr);
+
+bool remove(const char* ns, const char* key);
+bool clear(const char* ns);
+
+struct Entry {
+    char ns[MCP_KV_NAME_MAX + 1];
+    char key[MCP_KV_NAME_MAX + 1];
+    Type type;
+};
+
+/**
+ * Visit the entries of one namespace (nullptr: all of them) until fn
+ * returns false
+ * @return Number of entries visited
+ */
+size_t list(const char* ns, bool (*fn)(const Entry& entry, void* ctx), void* ctx);
+
+/**
+ * NVS usage in 32-byte entries (whole partition)
+ */
+bool stats(size_t& usedEntries, size_t& freeEntries, size_t& totalEntries);
+
+/**
+ * esp_err_t of the last failed call (ESP_ERR_NVS_NOT_FOUND, ...)
+ */
+esp_err_t lastError();
+
+/**
+ * Close the cached handles
+ */
+void closeAll();
+
+/**
+ * Request handlers (routes above)
+ */
+void handleGet(WebServer& server);
+void handleSet(WebServer& server);
+void handleDelete(WebServer& server);
+void handleList(WebServer& server);
+
+} // namespace kv
+} // namespace mcp
+
+#endif // MCP_KV_H
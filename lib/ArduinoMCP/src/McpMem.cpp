@@ -0,0 +1,130 @@
+/**
+ * McpMem - buffer placement between internal RAM and PSRAM
+ * Implementation file
+ *
+ * @author warusakudeveroper
+ * @license MIT
+ */
+
+#include "McpMem.h"
+#include "McpArena.h"
+
+#include <WebServer.h>
+#include <esp_heap_caps.h>
+
+namespace mcp {
+namespace mem {
+
+namespace {
+
+// In front of every block: its size and where it went. 8 bytes, so the
+// block keeps the heap's alignment.
+struct Head {
+    uint32_t size;
+    uint32_t psram;
+};
+
+struct Usage {
+    uint32_t blocks;
+    uint32_t bytes;
+    uint32_t peak;
+};
+
+size_t threshold = MCP_PSRAM_THRESHOLD;
+int8_t hasPsram = -1;  // not asked yet
+Usage placed[2];       // internal, PSRAM
+uint32_t fallbacks = 0;
+uint32_t failures = 0;
+
+void* take(size_t n, bool spiram) {
+    return heap_caps_malloc(n, (spiram ? MALLOC_CAP_SPIRAM : MALLOC_CAP_INTERNAL) | MALLOC_CAP_8BIT);
+}
+
+void appendCaps(arena::Text& json, const char* name, uint32_t caps) {
+    json.append(",\"").append(name).append("\":{\"total\":").appendUInt(heap_caps_get_total_size(caps));
+    json.append(",\"free\":").appendUInt(heap_caps_get_free_size(caps));
+    json.append(",\"minFree\":").appendUInt(heap_caps_get_minimum_free_size(caps));
+    json.append(",\"largest\":").appendUInt(heap_caps_get_largest_free_block(caps));
+    json.append('}');
+}
+
+void appendUsage(arena::Text& json, const char* name, const Usage& u) {
+    json.append('"').append(name).append("\":{\"blocks\":").appendUInt(u.blocks);
+    json.append(",\"bytes\":").appendUInt(u.bytes);
+    json.append(",\"peak\":").appendUInt(u.peak);
+    json.append('}');
+}
+
+} // namespace
+
+bool begin(size_t bytes) {
+    threshold = bytes;
+#if MCP_PSRAM_MALLOC
+    if (psram() && threshold > 0) heap_caps_malloc_extmem_enable(threshold);
+#endif
+    return psram();
+}
+
+bool psram() {
+    if (hasPsram < 0) hasPsram = heap_caps_get_total_size(MALLOC_CAP_SPIRAM) > 0 ? 1 : 0;
+    return hasPsram == 1;
+}
+
+void* alloc(size_t n, Place place) {
+    const bool wantPsram = place == Place::Auto && threshold > 0 && n >= threshold && psram();
+    const size_t total = sizeof(Head) + n;
+    bool spiram = wantPsram;
+    void* raw = take(total, spiram);
+    if (raw == nullptr && place == Place::Auto && psram()) {
+        spiram = !spiram;
+        raw = take(total, spiram);
+        if (raw != nullptr) fallbacks++;
+    }
+    if (raw == nullptr) {
+        failures++;
+        return nullptr;
+    }
+    Head* h = static_cast<Head*>(raw);
+    h->size = (uint32_t)n;
+    h->psram = spiram ? 1 : 0;
+    Usage& u = placed[h->psram];
+    u.blocks++;
+    u.bytes += h->size;
+    if (u.bytes > u.peak) u.peak = u.bytes;
+    return h + 1;
+}
+
+void free(void* p) {
+    if (p == nullptr) return;
+    Head* h = static_cast<Head*>(p) - 1;
+    Usage& u = placed[h->psram];
+    u.blocks--;
+    u.bytes -= h->size;
+    heap_caps_free(h);
+}
+
+bool inPsram(const void* p) {
+    return p != nullptr && (static_cast<const Head*>(p) - 1)->psram != 0;
+}
+
+void handleStats(WebServer& server) {
+    arena::Mark mark;  // also served outside ArduinoMCP's request scopes
+    arena::Text json(512);
+    json.append("{\"ok\":true,\"psram\":").append(psram() ? "true" : "false");
+    json.append(",\"threshold\":").appendUInt(threshold);
+    appendCaps(json, "internal", MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    appendCaps(json, "dma", MALLOC_CAP_DMA);
+    appendCaps(json, "spiram", MALLOC_CAP_SPIRAM);
+    json.append(",\"placed\":{");
+    appendUsage(json, "internal", placed[0]);
+    json.append(',');
+    appendUsage(json, "spiram", placed[1]);
+    json.append(",\"fallbacks\":").appendUInt(fallbacks);
+    json.append(",\"failures\":").appendUInt(failures);
+    json.append("}}");
+    server.sendHeader("Cache-Control", "no-store");
+    server.send_P(200, "application/json", json.c_str(), json.length());
+}
+
+} // namespace mem
+} // namespace mcp
@@ -0,0 +1,106 @@
+/**
+ * McpMem - buffer placement between internal RAM and PSRAM
+ *
+ * On a WROVER module the 4 MB of PSRAM sit next to ~200 KB of internal
+ * DRAM, which the Wi-Fi driver, lwIP and mbedTLS need for themselves (DMA
+ * descriptors, record buffers, anything touched while the flash cache is
+ * off). A String or malloc() still takes internal RAM first, so a page of
+ * HTML or a file read into memory competes with the network stack.
+ *
+ * The library's large buffers therefore go through this module: blocks of
+ * MCP_PSRAM_THRESHOLD bytes or more are placed in PSRAM, smaller ones (and
+ * everything on a module without PSRAM) in internal RAM, and each falls back
+ * to the other when its own is full. Place::Internal keeps a buffer out of
+ * PSRAM (ISR, DMA, or flash-cache-disabled use).
+ *
+ * begin() also hands the threshold to heap_caps_malloc_extmem_enable(), so
+ * plain malloc / new / String allocations of that size - response JSON,
+ * HTML pages, the Wi-Fi scan result array - move to PSRAM as well. The Wi-Fi
+ * stack and mbedTLS (CONFIG_MBEDTLS_INTERNAL_MEM_ALLOC) ask for internal RAM
+ * explicitly and are not affected.
+ *
+ *   mcp::mem::begin();                          // first thing in setup()
+ *   uint8_t* buf = (uint8_t*)mcp::mem::alloc(8192);
+ *   ...
+ *   mcp::mem::free(buf);
+ *
+ * GET /api/mem/stats reports each capability class (internal, DMA-capable,
+ * PSRAM: total, free, low-water mark, largest block) and what this module
+ * has placed in each:
+ *
+ *   {"ok":true,"psram":true,"threshold":1024,
+ *    "internal":{"total":291000,"free":142000,"minFree":120000,"largest":110580},
+ *    "dma":{...},"spiram":{"total":4192139,"free":4170000,...},
+ *    "placed":{"internal":{"blocks":0,"bytes":0,"peak":512},
+ *              "spiram":{"blocks":2,"bytes":8200,"peak":21000},
+ *              "fallbacks":0,"failures":0}}
+ *
+ * The counters are updated without a lock; allocate from the loop task.
+ *
+ * @author warusakudeveroper
+ * @license MIT
+ */
+
+#ifndef MCP_MEM_H
+#define MCP_MEM_H
+
+#include <Arduino.h>
+
+// Blocks of this many bytes or more go to PSRAM (0: never)
+#ifndef MCP_PSRAM_THRESHOLD
+#define MCP_PSRAM_THRESHOLD 1024
+#endif
+
+// 1: begin() applies the threshold to malloc / new / String too
+#ifndef MCP_PSRAM_MALLOC
+#define MCP_PSRAM_MALLOC 1
+#endif
+
+class WebServer;
+
+namespace mcp {
+namespace mem {
+
+enum class Place : uint8_t {
+    Auto,      // by size: PSRAM from MCP_PSRAM_THRESHOLD up
+    Internal,  // internal RAM only
+};
+
+/**
+ * Set the threshold, and (MCP_PSRAM_MALLOC) apply it to malloc
+ *
+ * @return true when the module has PSRAM
+ */
+bool begin(size_t threshold = MCP_PSRAM_THRESHOLD);
+
+/**
+ * The module has PSRAM
+ */
+bool psram();
+
+/**
+ * n bytes, placed as described above
+ *
+ * @return nullptr when neither memory has n bytes in one block
+ */
+void* alloc(size_t n, Place place = Place::Auto);
+
+/**
+ * Free a block from alloc() (nullptr is ignored)
+ */
+void free(void* p);
+
+/**
+ * The block from alloc() is in PSRAM
+ */
+bool inPsram(const void* p);
+
+/**
+ * GET /api/mem/stats
+ */
+void handleStats(WebServer& server);
+
+} // namespace mem
+} // namespace mcp
+
+#endif // MCP_MEM_H
@@ -0,0 +1,210 @@
+/**
+ * McpPowerSave - Wi-Fi power save off while clients are active
+ * Implementation file
+ *
+ * @author warusakudeveroper
+ * @license MIT
+ */
+
+#include "McpPowerSave.h"
+#include "McpArena.h"
+
+#include <WebServer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+#include <stdio.h>
+
+namespace mcp {
+namespace powersave {
+
+namespace {
+
+constexpr uint32_t kCheckMs = 1000;  // how often poll() compares with the driver
+
+bool started = false;
+Mode current = Mode::Auto;
+uint32_t idle = MCP_PS_IDLE_MS;
+uint32_t lastActivity = 0;
+uint16_t holds = 0;
+bool isSaving = true;  // the driver's default in station mode
+uint32_t since = 0;    // millis() of the last switch
+uint32_t checkedAt = 0;
+Stats totals = {};
+
+// activity() also comes from the HTTPS front's task (McpTls.cpp) while
+// poll() and the Holds run in loop(): the state above and the switch itself
+// are changed under this mutex (not a spinlock: esp_wifi_set_ps() may block).
+SemaphoreHandle_t mutex = nullptr;
+
+class Guard {
+public:
+    Guard() { if (mutex) xSemaphoreTake(mutex, portMAX_DELAY); }
+    ~Guard() { if (mutex) xSemaphoreGive(mutex); }
+    Guard(const Guard&) = delete;
+    Guard& operator=(const Guard&) = delete;
+};
+
+bool wanted(uint32_t now) {
+    switch (current) {
+        case Mode::Latency: return false;
+        case Mode::Power: return true;
+        default: return holds == 0 && (uint32_t)(now - lastActivity) >= idle;
+    }
+}
+
+void account(uint32_t now) {
+    const uint32_t elapsed = now - since;
+    if (isSaving) totals.savingMs += elapsed;
+    else totals.awakeMs += elapsed;
+    since = now;
+}
+
+void apply(bool save, uint32_t now) {
+    if (save == isSaving) return;
+    // Fails until Wi-Fi is started; poll() tries again
+    if (esp_wifi_set_ps(save ? MCP_PS_SAVE : WIFI_PS_NONE) != ESP_OK) return;
+    account(now);
+    if (!save) totals.wakeups++;
+    isSaving = save;
+}
+
+void touch(uint32_t now) {
+    lastActivity = now;
+    if (current == Mode::Auto) apply(false, now);
+}
+
+} // namespace
+
+void begin(Mode mode, uint32_t idleMs) {
+    // Before any other task can call in: the HTTPS front starts after this
+    if (!mutex) mutex = xSemaphoreCreateMutex();
+    Guard guard;
+    const uint32_t now = millis();
+    current = mode;
+    idle = idleMs;
+    if (!started) {
+        wifi_ps_type_t ps;
+        isSaving = esp_wifi_get_ps(&ps) != ESP_OK || ps != WIFI_PS_NONE;
+        lastActivity = now - idleMs;
+        since = checkedAt = now;
+        totals = Stats{};
+        started = true;
+    }
+    apply(wanted(now), now);
+}
+
+bool running() {
+    return started;
+}
+
+void setMode(Mode mode) {
+    Guard guard;
+    current = mode;
+    if (started) apply(wanted(millis()), millis());
+}
+
+Mode mode() {
+    return current;
+}
+
+void setIdleMs(uint32_t idleMs) {
+    Guard guard;
+    idle = idleMs;
+}
+
+const char* modeName(Mode mode) {
+    switch (mode) {
+        case Mode::Latency: return "latency";
+        case Mode::Power: return "power";
+        default: return "auto";
+    }
+}
+
+bool parseMode(const char* name, Mode& out) {
+    if (strcmp(name, "auto") == 0) out = Mode::Auto;
+    else if (strcmp(name, "latency") == 0) out = Mode::Latency;
+    else if (strcmp(name, "power") == 0) out = Mode::Power;
+    else return false;
+    return true;
+}
+
+void activity() {
+    if (!started) return;
+    Guard guard;
+    touch(millis());
+}
+
+void poll() {
+    if (!started) return;
+    Guard guard;
+    const uint32_t now = millis();
+    apply(wanted(now), now);
+    if ((uint32_t)(now - checkedAt) < kCheckMs) return;
+    checkedAt = now;
+    // WiFi.mode() and reconnects reapply the library's own sleep setting
+    wifi_ps_type_t ps;
+    if (esp_wifi_get_ps(&ps) == ESP_OK && (ps != WIFI_PS_NONE) != isSaving) {
+        esp_wifi_set_ps(isSaving ? MCP_PS_SAVE : WIFI_PS_NONE);
+    }
+}
+
+bool saving() {
+    return isSaving;
+}
+
+Stats stats() {
+    Guard guard;
+    Stats s = totals;
+    if (started) {
+        const uint32_t elapsed = millis() - since;
+        if (isSaving) s.savingMs += elapsed;
+        else s.awakeMs += elapsed;
+    }
+    return s;
+}
+
+void handleStats(WebServer& server) {
+    arena::Mark mark;  // also served outside ArduinoMCP's request scopes
+    const Stats s = stats();
+    bool save;
+    uint32_t idleMs;
+    uint16_t held;
+    {
+        Guard guard;
+        save = isSaving;
+        idleMs = idle;
+        held = holds;
+    }
+    const uint64_t total = s.awakeMs + s.savingMs;
+    char ratio[16];
+    snprintf(ratio, sizeof(ratio), "%.3f", total ? (double)s.awakeMs / (double)total : 0.0);
+
+    arena::Text json(224);
+    json.append("{\"ok\":true,\"mode\":\"").append(modeName(current));
+    json.append("\",\"saving\":").append(save ? "true" : "false");
+    json.append(",\"idleMs\":").appendUInt(idleMs);
+    json.append(",\"awakeMs\":").appendUInt(s.awakeMs);
+    json.append(",\"savingMs\":").appendUInt(s.savingMs);
+    json.append(",\"awakeRatio\":").append(ratio);
+    json.append(",\"wakeups\":").appendUInt(s.wakeups);
+    json.append(",\"holds\":").appendUInt(held);
+    json.append('}');
+    server.sendHeader("Cache-Control", "no-store");
+    server.send_P(200, "application/json", json.c_str(), json.length());
+}
+
+Hold::Hold() {
+    Guard guard;
+    holds++;
+    if (started) touch(millis());
+}
+
+Hold::~Hold() {
+    Guard guard;
+    holds--;
+    lastActivity = millis();
+}
+
+} // namespace powersave
+} // namespace mcp
@@ -0,0 +1,132 @@
+/**
+ * McpPowerSave - Wi-Fi power save off while clients are active
+ *
+ * In the default modem sleep (WIFI_PS_MIN_MODEM) the station only listens
+ * at the AP's DTIM beacons, so a packet for the device waits for the next
+ * one: 100-300 ms before a request is even seen, and again for every TCP
+ * ACK of a large response. This module turns power save off while requests
+ * are being served and puts it back after MCP_PS_IDLE_MS without one:
+ *
+ *   mcp::powersave::begin(mcp::powersave::Mode::Auto);   // setup()
+ *   mcp::powersave::poll();                              // loop()
+ *
+ *   void handleStatus() {
+ *       mcp::powersave::Hold hold;   // power save off; the idle time starts
+ *       ...                          // when the last Hold is gone
+ *   }
+ *
+ * ArduinoMCP holds it around every route and upload chunk, starts it in
+ * begin() (Auto, unless the sketch started it first) and polls it in
+ * handle(); the HTTPS front counts new connections as activity. A long-poll
+ * waiting for a change does not hold it: the answer is sent by the device,
+ * and sending wakes the radio anyway.
+ *
+ * Modes: Auto as above; Latency keeps power save off; Power leaves it on
+ * (MCP_PS_SAVE) whatever the traffic. poll() also puts the wanted state
+ * back after the Wi-Fi library changed it (WiFi.mode(), reconnects).
+ *
+ * GET /api/power/stats reports the mode and the time spent in each state:
+ *
+ *   {"ok":true,"mode":"auto","saving":true,"idleMs":15000,"awakeMs":42310,
+ *    "savingMs":3571020,"awakeRatio":0.012,"wakeups":9,"holds":0}
+ *
+ * @author warusakudeveroper
+ * @license MIT
+ */
+
+#ifndef MCP_POWER_SAVE_H
+#define MCP_POWER_SAVE_H
+
+#include <Arduino.h>
+#include <esp_wifi.h>
+
+// Power save goes back on after this long without a request (ms)
+#ifndef MCP_PS_IDLE_MS
+#define MCP_PS_IDLE_MS 15000
+#endif
+
+// The power save type used while idle
+#ifndef MCP_PS_SAVE
+#define MCP_PS_SAVE WIFI_PS_MIN_MODEM
+#endif
+
+class WebServer;
+
+namespace mcp {
+namespace powersave {
+
+enum class Mode : uint8_t {
+    Auto,     // off while clients are active, on when idle
+    Latency,  // always off
+    Power,    // always on
+};
+
+struct Stats {
+    uint64_t awakeMs;   // power save off
+    uint64_t savingMs;  // power save on
+    uint32_t wakeups;   // switches from on to off
+};
+
+/**
+ * Start the policy (until then nothing changes the Wi-Fi setting)
+ */
+void begin(Mode mode = Mode::Auto, uint32_t idleMs = MCP_PS_IDLE_MS);
+
+bool running();
+
+void setMode(Mode mode);
+Mode mode();
+void setIdleMs(uint32_t idleMs);
+
+/**
+ * "auto", "latency", "power"
+ */
+const char* modeName(Mode mode);
+
+/**
+ * @return false for an unknown name (out unchanged)
+ */
+bool parseMode(const char* name, Mode& out);
+
+/**
+ * A client sent something: power save off (Auto), idle time restarts.
+ * Safe from any task (the HTTPS front calls it from its own); the state is
+ * behind a mutex created by begin().
+ */
+void activity();
+
+/**
+ * Apply the idle timeout; call from loop()
+ */
+void poll();
+
+/**
+ * Power save is on right now
+ */
+bool saving();
+
+/**
+ * Time in each state since begin(), including the current one
+ */
+Stats stats();
+
+/**
+ * GET /api/power/stats
+ */
+void handleStats(WebServer& server);
+
+/**
+ * A request or transfer in progress: power save stays off until it ends
+ */
+class Hold {
+public:
+    Hold();
+    ~Hold();
+    Hold(const Hold&) = delete;
+    Hold& operator=(const Hold&) = delete;
+};
+
+} // namespace powersave
+} // namespace mcp
+
+#endif // MCP_POWER_SAVE_H
@@ -0,0 +1,231 @@
+/**
+ * McpProfiler - statistical sampling profiler for ArduinoMCP and sketches
+ * Implementation file
+ *
+ * @author warusakudeveroper
+ * @license MIT
+ */
+
+#include "McpProfiler.h"
+
+#if MCP_PROFILE
+
+#include "McpChunkedPrint.h"
+
+#include <WebServer.h>
+#include <esp_debug_helpers.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#if defined(__XTENSA__)
+#include <freertos/xtensa_context.h>
+#elif defined(CONFIG_IDF_TARGET_ARCH_RISCV)
+#error "McpProfiler unwinds Xtensa stacks; RISC-V ESP32 targets are not supported"
+#endif
+
+#include <atomic>
+#include <stdio.h>
+#include <string.h>
+
+namespace mcp {
+namespace profiler {
+
+namespace {
+
+static_assert(MCP_PROFILE_SAMPLES > 0 && (MCP_PROFILE_SAMPLES & (MCP_PROFILE_SAMPLES - 1)) == 0,
+              "MCP_PROFILE_SAMPLES must be a power of two");
+
+constexpr uint32_t kMask = MCP_PROFILE_SAMPLES - 1;
+constexpr uint32_t kDefaultHz = 100;
+constexpr size_t kTaskName = 16;  // configMAX_TASK_NAME_LEN of the ESP32 core
+
+struct Sample {
+    // Copied in the interrupt: by the time drain() runs the task may have
+    // been deleted and its handle freed or reused.
+    char task[kTaskName];  // not terminated when it is kTaskName long
+    uint32_t depth;
+    uintptr_t pc[MCP_PROFILE_DEPTH];
+};
+
+// Single producer (the timer interrupt), single consumer (drain())
+Sample samples[MCP_PROFILE_SAMPLES];
+std::atomic<uint32_t> head;
+std::atomic<uint32_t> tail;
+std::atomic<uint32_t> taken;
+std::atomic<uint32_t> dropped;
+
+hw_timer_t* timer = nullptr;
+uint32_t rateHz = 0;
+int sampledCore = -1;
+
+// Return addresses point past the call; step back onto it so the line is
+// the call's. On Xtensa the top two bits hold the register window size.
+inline uintptr_t IRAM_ATTR callSite(uintptr_t ret) {
+#if defined(__XTENSA__)
+    if (ret & 0x80000000) ret = (ret & 0x3fffffff) | 0x40000000;
+    return ret - 3;
+#else
+    return ret - 1;
+#endif
+}
+
+// First frame of the interrupted code
+void IRAM_ATTR interruptedFrame(TaskHandle_t task, esp_backtrace_frame_t& frame) {
+#if defined(__XTENSA__)
+    // The level-1 interrupt entry saved the task's registers in an exception
+    // frame on its stack and left pxTopOfStack (first TCB field) on it.
+    const XtExcFrame* exc = *reinterpret_cast<XtExcFrame* const*>(task);
+    frame.pc = exc->pc;
+    frame.sp = exc->a1;
+    frame.next_pc = exc->a0;
+#else
+    // Host simulator: starts at the interrupted code when called from a timer
+    (void)task;
+    esp_backtrace_get_start(&frame.pc, &frame.sp, &frame.next_pc);
+#endif
+}
+
+void IRAM_ATTR onTimer() {
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    if (task == nullptr) return;
+    taken.fetch_add(1, std::memory_order_relaxed);
+    uint32_t h = head.load(std::memory_order_relaxed);
+    if (h - tail.load(std::memory_order_acquire) >= MCP_PROFILE_SAMPLES) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    Sample& s = samples[h & kMask];
+    esp_backtrace_frame_t frame;
+    memset(&frame, 0, sizeof(frame));
+    interruptedFrame(task, frame);
+    const char* name = pcTaskGetName(task);
+    size_t n = 0;
+    for (; n < kTaskName && name[n] != '\0'; n++) s.task[n] = name[n];
+    if (n < kTaskName) s.task[n] = '\0';
+    s.pc[0] = frame.pc;
+    uint32_t depth = 1;
+    while (depth < MCP_PROFILE_DEPTH && frame.next_pc != 0 && esp_backtrace_get_next_frame(&frame)) {
+        s.pc[depth++] = callSite(frame.pc);
+    }
+    s.depth = depth;
+    head.store(h + 1, std::memory_order_release);
+}
+
+void sendJson(WebServer& server, int code, const char* json) {
+    server.send(code, "application/json", json);
+}
+
+} // namespace
+
+bool start(uint32_t hz) {
+    if (hz == 0 || hz > MCP_PROFILE_MAX_HZ) return false;
+    stop();
+    tail.store(head.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    taken.store(0, std::memory_order_relaxed);
+    dropped.store(0, std::memory_order_relaxed);
+
+    // One tick per microsecond. The interrupt is allocated on, and samples,
+    // the calling core.
+#if ESP_ARDUINO_VERSION_MAJOR >= 3
+    // 3.x allocates a free timer itself (MCP_PROFILE_TIMER is not used)
+    timer = timerBegin(1000000);
+    if (timer == nullptr) return false;
+    timerAttachInterrupt(timer, onTimer);
+    timerAlarm(timer, 1000000 / hz, true, 0);
+#else
+    // 80 MHz APB / 80
+    timer = timerBegin(MCP_PROFILE_TIMER, 80, true);
+    if (timer == nullptr) return false;
+    timerAttachInterrupt(timer, onTimer, true);
+    timerAlarmWrite(timer, 1000000 / hz, true);
+    timerAlarmEnable(timer);
+#endif
+    rateHz = hz;
+    sampledCore = xPortGetCoreID();
+    return true;
+}
+
+void stop() {
+    if (timer == nullptr) return;
+#if ESP_ARDUINO_VERSION_MAJOR >= 3
+    timerStop(timer);
+#else
+    timerAlarmDisable(timer);
+#endif
+    timerDetachInterrupt(timer);
+    timerEnd(timer);
+    timer = nullptr;
+}
+
+bool isRunning() {
+    return timer != nullptr;
+}
+
+uint32_t sampleCount() {
+    return taken.load(std::memory_order_relaxed);
+}
+
+uint32_t droppedCount() {
+    return dropped.load(std::memory_order_relaxed);
+}
+
+size_t drain(Print& out) {
+    char line[64 + (2 * sizeof(uintptr_t) + 1) * MCP_PROFILE_DEPTH];
+    snprintf(line, sizeof(line), "# mcp-profile hz=%lu core=%d samples=%lu dropped=%lu\n",
+             static_cast<unsigned long>(rateHz), sampledCore, static_cast<unsigned long>(sampleCount()),
+             static_cast<unsigned long>(droppedCount()));
+    out.print(line);
+
+    size_t written = 0;
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    const uint32_t h = head.load(std::memory_order_acquire);
+    for (; t != h; t++) {
+        const Sample& s = samples[t & kMask];
+        int len = snprintf(line, sizeof(line), "%.*s", static_cast<int>(kTaskName), s.task);
+        for (int i = 0; i < len; i++) {
+            if (line[i] == ' ') line[i] = '_';  // the name is the first field
+        }
+        for (uint32_t i = 0; i < s.depth; i++) {
+            len += snprintf(line + len, sizeof(line) - len, " %lx", static_cast<unsigned long>(s.pc[i]));
+        }
+        line[len++] = '\n';
+        out.write(reinterpret_cast<const uint8_t*>(line), len);
+        tail.store(t + 1, std::memory_order_release);
+        written++;
+    }
+    return written;
+}
+
+void handleStart(WebServer& server) {
+    uint32_t hz = server.hasArg("hz") ? static_cast<uint32_t>(server.arg("hz").toInt()) : kDefaultHz;
+    if (!start(hz)) {
+        sendJson(server, 400, "{\"ok\":false,\"error\":\"hz must be 1-1000 (or no hardware timer is free)\"}");
+        return;
+    }
+    char json[64];
+    snprintf(json, sizeof(json), "{\"ok\":true,\"hz\":%lu,\"core\":%d}", static_cast<unsigned long>(hz),
+             sampledCore);
+    sendJson(server, 200, json);
+}
+
+void handleStop(WebServer& server) {
+    stop();
+    char json[80];
+    snprintf(json, sizeof(json), "{\"ok\":true,\"samples\":%lu,\"dropped\":%lu}",
+             static_cast<unsigned long>(sampleCount()), static_cast<unsigned long>(droppedCount()));
+    sendJson(server, 200, json);
+}
+
+void sendSamples(WebServer& server) {
+    server.sendHeader("Cache-Control", "no-store");
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, "text/plain", "");
+    ChunkedPrint out(server);
+    drain(out);
+    out.flush();
+}
+
+} // namespace profiler
+} // namespace mcp
+
+#endif // MCP_PROFILE
@@ -0,0 +1,108 @@
+/**
+ * McpProfiler - statistical sampling profiler for ArduinoMCP and sketches
+ *
+ * A hardware timer interrupts the core that called start() at a fixed rate;
+ * each tick records the interrupted program counter plus a short backtrace
+ * of the interrupted task (unwound from the exception frame the interrupt
+ * entry saved on its stack) into a fixed ring. The ring is drained as text
+ * over HTTP, one sample per line:
+ *
+ *   # mcp-profile hz=200 core=1 samples=1234 dropped=0
+ *   loopTask 400d5a1c 400d3b2f 400d1e07 ...
+ *
+ * and host/tools/mcp_profile.py symbolizes the addresses against the sketch
+ * ELF and draws a flamegraph. Samples that find the ring full are counted as
+ * dropped, never overwrite undrained ones; poll often enough for the rate
+ * (the ring holds MCP_PROFILE_SAMPLES).
+ *
+ * Only the sampled core is seen (start it from loop() / a handler to profile
+ * the loop task and everything it waits on). Code that runs with interrupts
+ * masked (critical sections) is attributed to where it unmasks them.
+ *
+ * Off unless the build defines MCP_PROFILE=1; Xtensa ESP32 targets only,
+ * Arduino-ESP32 2.x or 3.x (its timer API is picked by
+ * ESP_ARDUINO_VERSION_MAJOR).
+ *
+ *   arduino-cli compile --build-property "build.extra_flags=-DMCP_PROFILE=1" ...
+ *
+ * @author warusakudeveroper
+ * @license MIT
+ */
+
+#ifndef MCP_PROFILER_H
+#define MCP_PROFILER_H
+
+#ifndef MCP_PROFILE
+#define MCP_PROFILE 0
+#endif
+
+// Samples buffered between drains (power of two)
+#ifndef MCP_PROFILE_SAMPLES
+#define MCP_PROFILE_SAMPLES 256
+#endif
+
+// Frames per sample, interrupted PC included
+#ifndef MCP_PROFILE_DEPTH
+#define MCP_PROFILE_DEPTH 12
+#endif
+
+// Hardware timer used for sampling (0-3); 3 leaves the low ones to the sketch.
+// Arduino-ESP32 2.x only: 3.x allocates a free timer itself.
+#ifndef MCP_PROFILE_TIMER
+#define MCP_PROFILE_TIMER 3
+#endif
+
+#define MCP_PROFILE_MAX_HZ 1000
+
+#if MCP_PROFILE
+
+#include <Arduino.h>
+
+class WebServer;
+
+namespace mcp {
+namespace profiler {
+
+/**
+ * Start sampling the calling core (restarts with an empty ring if running)
+ *
+ * @param hz Samples per second, 1..MCP_PROFILE_MAX_HZ
+ * @return false if hz is out of range or no timer could be allocated
+ */
+bool start(uint32_t hz);
+
+/**
+ * Stop sampling; buffered samples stay until drained
+ */
+void stop();
+
+bool isRunning();
+
+/**
+ * Samples taken / dropped (ring full) since start()
+ */
+uint32_t sampleCount();
+uint32_t droppedCount();
+
+/**
+ * Write the buffered samples as text (format above) and remove them
+ * @return Number of samples written
+ */
+size_t drain(Print& out);
+
+/**
+ * Request handlers
+ *   POST /api/profile/start?hz=200 - start() (hz defaults to 100)
+ *   POST /api/profile/stop         - stop()
+ *   GET  /api/profile/samples      - drain(), chunked text/plain
+ */
+void handleStart(WebServer& server);
+void handleStop(WebServer& server);
+void sendSamples(WebServer& server);
+
+} // namespace profiler
+} // namespace mcp
+
+#endif // MCP_PROFILE
+
+#endif // MCP_PROFILER_H
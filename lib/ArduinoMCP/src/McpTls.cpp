@@ -0,0 +1,627 @@
+/**
+ * McpTls - HTTPS for ArduinoMCP with session resumption and keep-alive
+ * Implementation file
+ *
+ * @author warusakudeveroper
+ * @license MIT
+ */
+
+#include "McpConfig.h"
+
+#if MCP_TLS
+
+#include "McpTls.h"
+#if MCP_POWERSAVE
+#include "McpPowerSave.h"
+#endif
+
+#include <WebServer.h>
+#include <WiFi.h>
+
+#include "mbedtls/version.h"
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/entropy.h"
+#include "mbedtls/ssl.h"
+#include "mbedtls/ssl_cache.h"
+#include "mbedtls/ssl_ticket.h"
+
+#if MCP_TLS_TASK
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+namespace mcp {
+namespace tls {
+
+namespace {
+
+constexpr uint32_t kBucketMs[MCP_TLS_LATENCY_BUCKETS - 1] = {1, 2, 5, 10, 20, 50, 100,
+                                                             200, 500, 1000, 2000, 5000, 10000};
+constexpr uint32_t kWriteStallMs = 5000;  // a client that reads nothing for this long is dropped
+
+enum class State : uint8_t { Free, Handshake, ReadHead, Body, Response };
+enum class Resumed : uint8_t { None, Ticket, Cache };
+
+struct Conn {
+    State state;
+    Resumed resumed;
+    bool closeAfter;    // answer this request, then close
+    bool headDone;      // response head seen and passed on
+    WiFiClient client;  // TLS side
+    WiFiClient backend; // WebServer side, for one request
+    mbedtls_ssl_context ssl;
+    uint32_t since;     // handshake start, or request start
+    uint32_t lastIo;
+    uint32_t served;
+    size_t bodyLeft;    // request body still to pass on
+    String in;          // request bytes not yet passed on
+    String head;        // response head, until complete
+};
+
+mbedtls_entropy_context entropy;
+mbedtls_ctr_drbg_context drbg;
+mbedtls_x509_crt cert;
+mbedtls_pk_context key;
+mbedtls_ssl_config conf;
+#if defined(MBEDTLS_SSL_CACHE_C)
+mbedtls_ssl_cache_context cache;
+#endif
+#if defined(MBEDTLS_SSL_SESSION_TICKETS) && defined(MBEDTLS_SSL_TICKET_C)
+mbedtls_ssl_ticket_context ticket;
+#endif
+
+WiFiServer* listener = nullptr;
+uint16_t tlsPort = 0;
+uint16_t backendPort = 0;
+Stats counters;
+Conn conns[MCP_TLS_CONNECTIONS];
+Conn* handshaking = nullptr;  // the connection the session hooks run for
+uint8_t scratch[1024];
+
+#if MCP_TLS_TASK
+TaskHandle_t task = nullptr;
+volatile bool stopping = false;
+volatile bool taskDone = false;
+#endif
+
+// ---- Transport and session hooks ----
+
+int netSend(void* ctx, const unsigned char* buf, size_t len) {
+    WiFiClient* client = static_cast<WiFiClient*>(ctx);
+    if (!client->connected()) return MBEDTLS_ERR_NET_CONN_RESET;
+    size_t n = client->write(buf, len);
+    return n ? (int)n : MBEDTLS_ERR_SSL_WANT_WRITE;
+}
+
+int netRecv(void* ctx, unsigned char* buf, size_t len) {
+    WiFiClient* client = static_cast<WiFiClient*>(ctx);
+    int avail = client->available();
+    if (avail <= 0) return client->connected() ? MBEDTLS_ERR_SSL_WANT_READ : 0;
+    int n = client->read(buf, len < (size_t)avail ? len : (size_t)avail);
+    return n > 0 ? n : MBEDTLS_ERR_SSL_WANT_READ;
+}
+
+#if defined(MBEDTLS_SSL_CACHE_C)
+#if MBEDTLS_VERSION_MAJOR >= 3
+int cacheGet(void* data, const unsigned char* id, size_t idLen, mbedtls_ssl_session* session) {
+    int ret = mbedtls_ssl_cache_get(data, id, idLen, session);
+#else
+int cacheGet(void* data, mbedtls_ssl_session* session) {
+    int ret = mbedtls_ssl_cache_get(data, session);
+#endif
+    if (ret == 0 && handshaking) handshaking->resumed = Resumed::Cache;
+    return ret;
+}
+#endif
+
+#if defined(MBEDTLS_SSL_SESSION_TICKETS) && defined(MBEDTLS_SSL_TICKET_C)
+int ticketParse(void* data, mbedtls_ssl_session* session, unsigned char* buf, size_t len) {
+    int ret = mbedtls_ssl_ticket_parse(data, session, buf, len);
+    if (ret == 0 && handshaking) handshaking->resumed = Resumed::Ticket;
+    return ret;
+}
+#endif
+
+// ---- Connections ----
+
+void close(Conn& c, bool graceful) {
+    if (c.state == State::Free) return;
+    if (graceful && c.state != State::Handshake) mbedtls_ssl_close_notify(&c.ssl);
+    c.backend.stop();
+    c.client.stop();
+    mbedtls_ssl_free(&c.ssl);
+    c.in = String();
+    c.head = String();
+    c.state = State::Free;
+}
+
+// Whole buffer onto the TLS connection; false when the client is gone
+bool writeTls(Conn& c, const uint8_t* data, size_t len) {
+    uint32_t start = millis();
+    while (len > 0) {
+        int ret = mbedtls_ssl_write(&c.ssl, data, len);
+        if (ret > 0) {
+            data += ret;
+            len -= (size_t)ret;
+            start = millis();
+        } else if (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE) {
+            if (millis() - start > kWriteStallMs) return false;
+            delay(1);
+        } else {
+            return false;
+        }
+    }
+    c.lastIo = millis();
+    return true;
+}
+
+bool writeTls(Conn& c, const String& s) {
+    return writeTls(c, reinterpret_cast<const uint8_t*>(s.c_str()), s.length());
+}
+
+// An answer of the front's own, then close
+void fail(Conn& c, int code, const char* reason, const char* error) {
+    char json[96];
+    int n = snprintf(json, sizeof(json), "{\"ok\":false,\"error\":\"%s\"}", error);
+    char head[192];
+    int h = snprintf(head, sizeof(head),
+                     "HTTP/1.1 %d %s\r\nContent-Type: application/json\r\nContent-Length: %d\r\n"
+                     "Connection: close\r\n\r\n",
+                     code, reason, n);
+    if (writeTls(c, reinterpret_cast<const uint8_t*>(head), (size_t)h)) {
+        writeTls(c, reinterpret_cast<const uint8_t*>(json), (size_t)n);
+    }
+    close(c, true);
+}
+
+// Value of a header in a lower-cased head ("" when absent)
+String headerValue(const String& lower, const char* name) {
+    String key = "\r\n";
+    key += name;
+    key += ':';
+    int at = lower.indexOf(key);
+    if (at < 0) return String();
+    int from = at + key.length();
+    int to = lower.indexOf("\r\n", from);
+    String value = lower.substring(from, to < 0 ? lower.length() : to);
+    value.trim();
+    return value;
+}
+
+void recordRequest(Conn& c) {
+    uint32_t ms = millis() - c.since;
+    uint8_t b = 0;
+    while (b < MCP_TLS_LATENCY_BUCKETS - 1 && ms > kBucketMs[b]) b++;
+    counters.requestMs[b]++;
+    if (ms > counters.requestMsMax) counters.requestMsMax = ms;
+    counters.requests++;
+    if (c.served) counters.keepAliveRequests++;
+    c.served++;
+}
+
+void accept() {
+    if (!listener->hasClient()) return;
+    Conn* slot = nullptr;
+    for (Conn& c : conns) {
+        if (c.state == State::Free) {
+            slot = &c;
+            break;
+        }
+    }
+    if (!slot) {
+        // Idle keep-alive connections give way to new ones
+        for (Conn& c : conns) {
+            if (c.state == State::ReadHead && c.in.length() == 0 && c.served > 0 &&
+                (!slot || c.lastIo < slot->lastIo)) {
+                slot = &c;
+            }
+        }
+        if (!slot) return;  // stays in the backlog
+        if (slot->client.connected()) counters.evicted++;
+        close(*slot, true);
+    }
+    Conn& c = *slot;
+    c.client = listener->available();
+    if (!c.client) return;
+    counters.connections++;
+#if MCP_POWERSAVE
+    // The handshake's round trips should not wait for DTIM beacons
+    mcp::powersave::activity();
+#endif
+    mbedtls_ssl_init(&c.ssl);
+    if (mbedtls_ssl_setup(&c.ssl, &conf) != 0) {
+        mbedtls_ssl_free(&c.ssl);
+        c.client.stop();
+        counters.failedHandshakes++;
+        return;
+    }
+    mbedtls_ssl_set_bio(&c.ssl, &c.client, netSend, netRecv, nullptr);
+    c.state = State::Handshake;
+    c.resumed = Resumed::None;
+    c.served = 0;
+    c.since = c.lastIo = millis();
+}
+
+void stepHandshake(Conn& c) {
+    handshaking = &c;
+    int ret = mbedtls_ssl_handshake(&c.ssl);
+    handshaking = nullptr;
+    if (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE) {
+        if (millis() - c.since > MCP_TLS_HANDSHAKE_MS) {
+            counters.failedHandshakes++;
+            close(c, false);
+        }
+        return;
+    }
+    if (ret != 0) {
+        counters.failedHandshakes++;
+        close(c, false);
+        return;
+    }
+    uint32_t ms = millis() - c.since;
+    if (c.resumed == Resumed::None) {
+        counters.fullHandshakes++;
+        counters.fullMsTotal += ms;
+        if (ms > counters.fullMsMax) counters.fullMsMax = ms;
+    } else {
+        if (c.resumed == Resumed::Ticket) counters.resumedTicket++;
+        else counters.resumedCache++;
+        counters.resumedMsTotal += ms;
+        if (ms > counters.resumedMsMax) counters.resumedMsMax = ms;
+    }
+    c.state = State::ReadHead;
+    c.lastIo = millis();
+}
+
+// Decrypted request bytes into c.in; false when the connection ended
+bool readTls(Conn& c, size_t limit) {
+    while (c.in.length() < limit) {
+        size_t want = limit - c.in.length();
+        int ret = mbedtls_ssl_read(&c.ssl, scratch, want < sizeof(scratch) ? want : sizeof(scratch));
+        if (ret > 0) {
+            if (c.in.length() == 0 && c.state == State::ReadHead) c.since = millis();
+            c.in.concat(reinterpret_cast<const char*>(scratch), (unsigned int)ret);
+            c.lastIo = millis();
+            continue;
+        }
+        if (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE) return true;
+        close(c, ret == MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY);
+        return false;
+    }
+    return true;
+}
+
+bool polled() {
+#if MCP_TLS_TASK
+    return task == nullptr;
+#else
+    return true;
+#endif
+}
+
+void stepReadHead(Conn& c) {
+    // Past the head limit there is room for a body buffered in loop mode
+    const size_t limit = MCP_TLS_HEAD_MAX + (polled() ? MCP_TLS_POLL_REQUEST : 0);
+    if (!readTls(c, limit)) return;
+    if (c.in.length() == 0) {
+        if (millis() - c.lastIo > MCP_TLS_IDLE_MS) close(c, true);
+        return;
+    }
+    int end = c.in.indexOf("\r\n\r\n");
+    if (end < 0) {
+        if (c.in.length() >= MCP_TLS_HEAD_MAX) fail(c, 431, "Request Header Fields Too Large", "head too large");
+        return;
+    }
+    const size_t headLen = (size_t)end + 4;
+    String lower = c.in.substring(0, headLen);
+    lower.toLowerCase();
+    if (headerValue(lower, "transfer-encoding").length()) {
+        fail(c, 411, "Length Required", "chunked request body");
+        return;
+    }
+    const size_t bodyLen = (size_t)headerValue(lower, "content-length").toInt();
+    if (polled()) {
+        if (bodyLen > MCP_TLS_POLL_REQUEST) {
+            fail(c, 413, "Payload Too Large", "body too large");
+            return;
+        }
+        if (c.in.length() < headLen + bodyLen) return;  // rest of the body first
+    }
+    const int lineEnd = lower.indexOf("\r\n");
+    const bool http10 = lower.substring(0, lineEnd).endsWith("http/1.0");
+    const String connection = headerValue(lower, "connection");
+    c.closeAfter = connection.indexOf("close") >= 0 || (http10 && connection.indexOf("keep-alive") < 0);
+
+    if (!c.backend.connect(IPAddress(127, 0, 0, 1), backendPort)) {
+        fail(c, 502, "Bad Gateway", "server unavailable");
+        return;
+    }
+    const size_t bodyNow = c.in.length() - headLen < bodyLen ? c.in.length() - headLen : bodyLen;
+    c.backend.write(reinterpret_cast<const uint8_t*>(c.in.c_str()), headLen + bodyNow);
+    c.in.remove(0, headLen + bodyNow);  // pipelined requests stay
+    c.bodyLeft = bodyLen - bodyNow;
+    c.headDone = false;
+    c.head = String();
+    c.state = c.bodyLeft ? State::Body : State::Response;
+}
+
+void stepBody(Conn& c) {
+    if (!readTls(c, c.bodyLeft < sizeof(scratch) ? c.bodyLeft : sizeof(scratch))) return;
+    if (c.in.length()) {
+        c.backend.write(reinterpret_cast<const uint8_t*>(c.in.c_str()), c.in.length());
+        c.bodyLeft -= c.in.length();
+        c.in = String();
+        if (!c.bodyLeft) c.state = State::Response;
+    } else if (millis() - c.lastIo > MCP_TLS_BACKEND_MS) {
+        close(c, false);
+    }
+}
+
+// The WebServer closes every connection; its answer is re-marked keep-alive
+// when the client can find its end without the close
+void passHead(Conn& c) {
+    const int end = c.head.indexOf("\r\n\r\n");
+    String lower = c.head.substring(0, end + 2);
+    lower.toLowerCase();
+    const bool framed =
+        headerValue(lower, "content-length").length() || headerValue(lower, "transfer-encoding").indexOf("chunked") >= 0;
+    if (!framed) c.closeAfter = true;
+
+    String out;
+    out.reserve(c.head.length() + 16);
+    int from = 0;
+    while (from < end) {
+        int to = c.head.indexOf("\r\n", from);
+        if (!lower.substring(from, to).startsWith("connection:")) {
+            out.concat(c.head.c_str() + from, (unsigned int)(to - from));
+            out += "\r\n";
+        }
+        from = to + 2;
+    }
+    out += c.closeAfter ? "Connection: close\r\n\r\n" : "Connection: keep-alive\r\n\r\n";
+    out.concat(c.head.c_str() + end + 4, c.head.length() - end - 4);
+    c.head = String();
+    c.headDone = true;
+    if (!writeTls(c, out)) close(c, false);
+}
+
+void stepResponse(Conn& c) {
+    int avail;
+    while ((avail = c.backend.available()) > 0) {
+        int n = c.backend.read(scratch, (size_t)avail < sizeof(scratch) ? (size_t)avail : sizeof(scratch));
+        if (n <= 0) break;
+        c.lastIo = millis();
+        if (c.headDone) {
+            if (!writeTls(c, scratch, (size_t)n)) {
+                close(c, false);
+                return;
+            }
+            continue;
+        }
+        c.head.concat(reinterpret_cast<const char*>(scratch), (unsigned int)n);
+        if (c.head.indexOf("\r\n\r\n") >= 0) {
+            passHead(c);
+            if (c.state == State::Free) return;
+        } else if (c.head.length() > MCP_TLS_HEAD_MAX) {
+            // Passed on as it is, and the close ends it
+            c.closeAfter = true;
+            c.headDone = true;
+            if (!writeTls(c, c.head)) {
+                close(c, false);
+                return;
+            }
+            c.head = String();
+        }
+    }
+    if (c.backend.connected()) {
+        if (millis() - c.lastIo > MCP_TLS_BACKEND_MS) {
+            if (c.headDone) close(c, false);
+            else fail(c, 504, "Gateway Timeout", "no answer");
+        }
+        return;
+    }
+    c.backend.stop();
+    if (!c.headDone) {
+        fail(c, 502, "Bad Gateway", "no answer");
+        return;
+    }
+    recordRequest(c);
+    if (c.closeAfter) {
+        close(c, true);
+        return;
+    }
+    c.state = State::ReadHead;
+    c.since = c.lastIo = millis();  // a pipelined request starts now
+}
+
+void service() {
+    for (Conn& c : conns) {
+        switch (c.state) {
+            case State::Free: break;
+            case State::Handshake: stepHandshake(c); break;
+            case State::ReadHead: stepReadHead(c); break;
+            case State::Body: stepBody(c); break;
+            case State::Response: stepResponse(c); break;
+        }
+    }
+    accept();
+}
+
+#if MCP_TLS_TASK
+void taskMain(void*) {
+    while (!stopping) {
+        service();
+        delay(1);
+    }
+    taskDone = true;
+    vTaskDelete(nullptr);
+}
+#endif
+
+void freeContexts() {
+#if defined(MBEDTLS_SSL_SESSION_TICKETS) && defined(MBEDTLS_SSL_TICKET_C)
+    mbedtls_ssl_ticket_free(&ticket);
+#endif
+#if defined(MBEDTLS_SSL_CACHE_C)
+    mbedtls_ssl_cache_free(&cache);
+#endif
+    mbedtls_ssl_config_free(&conf);
+    mbedtls_pk_free(&key);
+    mbedtls_x509_crt_free(&cert);
+    mbedtls_ctr_drbg_free(&drbg);
+    mbedtls_entropy_free(&entropy);
+}
+
+} // namespace
+
+bool begin(uint16_t port, uint16_t backend, const char* certPem, const char* keyPem) {
+    end();
+    mbedtls_entropy_init(&entropy);
+    mbedtls_ctr_drbg_init(&drbg);
+    mbedtls_x509_crt_init(&cert);
+    mbedtls_pk_init(&key);
+    mbedtls_ssl_config_init(&conf);
+#if defined(MBEDTLS_SSL_CACHE_C)
+    mbedtls_ssl_cache_init(&cache);
+#endif
+#if defined(MBEDTLS_SSL_SESSION_TICKETS) && defined(MBEDTLS_SSL_TICKET_C)
+    mbedtls_ssl_ticket_init(&ticket);
+#endif
+
+    static const char kPers[] = "mcp_tls";
+    int ret = mbedtls_ctr_drbg_seed(&drbg, mbedtls_entropy_func, &entropy,
+                                    reinterpret_cast<const unsigned char*>(kPers), sizeof(kPers) - 1);
+    if (ret == 0) {
+        ret = mbedtls_x509_crt_parse(&cert, reinterpret_cast<const unsigned char*>(certPem), strlen(certPem) + 1);
+    }
+    if (ret == 0) {
+#if MBEDTLS_VERSION_MAJOR >= 3
+        ret = mbedtls_pk_parse_key(&key, reinterpret_cast<const unsigned char*>(keyPem), strlen(keyPem) + 1,
+                                   nullptr, 0, mbedtls_ctr_drbg_random, &drbg);
+#else
+        ret = mbedtls_pk_parse_key(&key, reinterpret_cast<const unsigned char*>(keyPem), strlen(keyPem) + 1,
+                                   nullptr, 0);
+#endif
+    }
+    if (ret == 0) {
+        ret = mbedtls_ssl_config_defaults(&conf, MBEDTLS_SSL_IS_SERVER, MBEDTLS_SSL_TRANSPORT_STREAM,
+                                          MBEDTLS_SSL_PRESET_DEFAULT);
+    }
+    if (ret == 0) {
+        mbedtls_ssl_conf_rng(&conf, mbedtls_ctr_drbg_random, &drbg);
+        ret = mbedtls_ssl_conf_own_cert(&conf, &cert, &key);
+    }
+#if defined(MBEDTLS_SSL_CACHE_C)
+    if (ret == 0) {
+        mbedtls_ssl_cache_set_timeout(&cache, MCP_TLS_SESSION_SECONDS);
+        mbedtls_ssl_cache_set_max_entries(&cache, MCP_TLS_CACHE_ENTRIES);
+        mbedtls_ssl_conf_session_cache(&conf, &cache, cacheGet, mbedtls_ssl_cache_set);
+    }
+#endif
+#if defined(MBEDTLS_SSL_SESSION_TICKETS) && defined(MBEDTLS_SSL_TICKET_C)
+    if (ret == 0) {
+        ret = mbedtls_ssl_ticket_setup(&ticket, mbedtls_ctr_drbg_random, &drbg, MBEDTLS_CIPHER_AES_256_GCM,
+                                       MCP_TLS_SESSION_SECONDS);
+    }
+    if (ret == 0) mbedtls_ssl_conf_session_tickets_cb(&conf, mbedtls_ssl_ticket_write, ticketParse, &ticket);
+#endif
+    if (ret != 0) {
+        Serial.printf("[MCP] TLS setup failed: -0x%04x\n", (unsigned)-ret);
+        freeContexts();
+        return false;
+    }
+
+    memset(&counters, 0, sizeof(counters));
+    tlsPort = port;
+    backendPort = backend;
+    listener = new WiFiServer(port, MCP_TLS_CONNECTIONS);
+    listener->begin();
+    listener->setNoDelay(true);
+
+#if MCP_TLS_TASK
+    stopping = false;
+    taskDone = false;
+    if (xTaskCreate(taskMain, "mcp_tls", MCP_TLS_TASK_STACK, nullptr, 1, &task) != pdPASS) {
+        task = nullptr;
+        Serial.println("[MCP] TLS task not created; served from handle()");
+    }
+#endif
+    Serial.printf("[MCP] HTTPS on port %u\n", port);
+    return true;
+}
+
+void end() {
+    if (!listener) return;
+#if MCP_TLS_TASK
+    if (task) {
+        stopping = true;
+        while (!taskDone) delay(1);
+        task = nullptr;
+    }
+#endif
+    for (Conn& c : conns) close(c, true);
+    listener->end();
+    delete listener;
+    listener = nullptr;
+    freeContexts();
+}
+
+void poll() {
+    if (listener && polled()) service();
+}
+
+bool running() { return listener != nullptr; }
+
+const Stats& stats() { return counters; }
+
+uint32_t requestPercentileMs(uint8_t pct) {
+    if (!counters.requests) return 0;
+    const uint64_t rank = ((uint64_t)counters.requests * pct + 99) / 100;
+    uint64_t seen = 0;
+    for (uint8_t b = 0; b < MCP_TLS_LATENCY_BUCKETS; b++) {
+        seen += counters.requestMs[b];
+        if (seen >= rank) {
+            return b < MCP_TLS_LATENCY_BUCKETS - 1 && kBucketMs[b] < counters.requestMsMax ? kBucketMs[b]
+                                                                                          : counters.requestMsMax;
+        }
+    }
+    return counters.requestMsMax;
+}
+
+void handleStats(WebServer& server) {
+    const Stats& s = counters;
+    uint8_t open = 0;
+    for (const Conn& c : conns) {
+        if (c.state != State::Free) open++;
+    }
+    const uint32_t resumed = s.resumedTicket + s.resumedCache;
+    const uint32_t total = s.fullHandshakes + resumed;
+    char ratio[16];
+    snprintf(ratio, sizeof(ratio), "%.3f", total ? (double)resumed / total : 0.0);
+
+    char json[640];
+    snprintf(json, sizeof(json),
+             "{\"ok\":true,\"port\":%u,\"mode\":\"%s\",\"connections\":%lu,\"open\":%u,"
+             "\"handshakes\":{\"full\":%lu,\"resumedTicket\":%lu,\"resumedCache\":%lu,\"failed\":%lu},"
+             "\"resumptionRatio\":%s,\"handshakeMs\":{\"fullAvg\":%lu,\"fullMax\":%lu,"
+             "\"resumedAvg\":%lu,\"resumedMax\":%lu},\"requests\":%lu,\"keepAliveRequests\":%lu,"
+             "\"evicted\":%lu,\"requestMs\":{\"p50\":%lu,\"p95\":%lu,\"p99\":%lu,\"max\":%lu}}",
+             tlsPort, polled() ? "loop" : "task", (unsigned long)s.connections, open,
+             (unsigned long)s.fullHandshakes, (unsigned long)s.resumedTicket, (unsigned long)s.resumedCache,
+             (unsigned long)s.failedHandshakes, ratio,
+             (unsigned long)(s.fullHandshakes ? s.fullMsTotal / s.fullHandshakes : 0), (unsigned long)s.fullMsMax,
+             (unsigned long)(resumed ? s.resumedMsTotal / resumed : 0), (unsigned long)s.resumedMsMax,
+             (unsigned long)s.requests, (unsigned long)s.keepAliveRequests, (unsigned long)s.evicted,
+             (unsigned long)requestPercentileMs(50), (unsigned long)requestPercentileMs(95),
+             (unsigned long)requestPercentileMs(99), (unsigned long)s.requestMsMax);
+    server.sendHeader("Cache-Control", "no-store");
+    server.send(200, "application/json", json);
+}
+
+} // namespace tls
+} // namespace mcp
+
+#endif // MCP_TLS
@@ -0,0 +1,175 @@
+/**
+ * McpTls - HTTPS for ArduinoMCP with session resumption and keep-alive
+ *
+ * ArduinoMCP::beginSecure() puts the WebServer on 127.0.0.1 and this front
+ * on the HTTPS port. The front terminates TLS 1.2 (mbedTLS), passes each
+ * request to the WebServer over loopback and sends the answer back on the
+ * same TLS connection, so every handler works unchanged and plain HTTP is
+ * not reachable from the network.
+ *
+ * A full handshake (ECDHE, plus an ECDSA signature with a P-256 key) takes
+ * ~150 ms of CPU at 240 MHz, and a connection's context ~22 KB of heap. A
+ * Console polling every few seconds must not pay that per request:
+ *
+ *   - keep-alive: a connection stays open between requests, for up to
+ *     MCP_TLS_IDLE_MS of silence. The WebServer answers every request with
+ *     "Connection: close"; the front re-marks the answer keep-alive when it
+ *     carries Content-Length or chunked framing.
+ *   - session tickets (RFC 5077, AES-256-GCM, key from the DRBG): a client
+ *     that reconnects resumes with an abbreviated handshake, and the device
+ *     keeps no state per client.
+ *   - a session-ID cache of MCP_TLS_CACHE_ENTRIES sessions, for clients
+ *     without ticket support.
+ *
+ * Both kinds of session stay valid for MCP_TLS_SESSION_SECONDS. Up to
+ * MCP_TLS_CONNECTIONS connections are served at once. When all are taken, a
+ * new one replaces the connection that has been idle the longest.
+ *
+ * GET /api/tls/stats reports handshakes (full, resumed from a ticket or the
+ * cache, failed), the resumption ratio, handshake times, keep-alive reuse
+ * and request latency: from the first request byte to the last response
+ * byte, as the upper bound of its bucket in a 1-2-5 histogram.
+ *
+ *   {"ok":true,"port":443,"mode":"task","connections":12,"open":1,
+ *    "handshakes":{"full":2,"resumedTicket":9,"resumedCache":1,"failed":0},
+ *    "resumptionRatio":0.833,"handshakeMs":{"fullAvg":151,"fullMax":163,
+ *    "resumedAvg":4,"resumedMax":6},"requests":240,"keepAliveRequests":228,
+ *    "evicted":0,"requestMs":{"p50":20,"p95":50,"p99":100,"max":87}}
+ *
+ * The front runs in its own task (MCP_TLS_TASK), so bodies stream through
+ * the loopback sockets while the loop task runs the WebServer. With
+ * MCP_TLS_TASK=0, or when the task cannot be created, ArduinoMCP::handle()
+ * runs the front instead. A request is then buffered whole before it is
+ * passed on, up to MCP_TLS_POLL_REQUEST bytes (413 above that). An answer
+ * has to fit lwIP's socket buffers (about 11 KB), because the sockets are
+ * only read when the WebServer has finished writing.
+ *
+ * Needs MCP_TLS=1 (McpConfig.h), and a certificate and key in PEM:
+ *
+ *   openssl req -x509 -newkey ec -pkeyopt ec_paramgen_curve:prime256v1 -nodes \
+ *       -days 3650 -subj /CN=esp32.local -keyout key.pem -out cert.pem
+ *
+ * @author warusakudeveroper
+ * @license MIT
+ */
+
+#ifndef MCP_TLS_H
+#define MCP_TLS_H
+
+#include <Arduino.h>
+
+// Connections served at once (each ~22 KB while open)
+#ifndef MCP_TLS_CONNECTIONS
+#define MCP_TLS_CONNECTIONS 2
+#endif
+
+// Sessions kept for ID-based resumption (~200 bytes each)
+#ifndef MCP_TLS_CACHE_ENTRIES
+#define MCP_TLS_CACHE_ENTRIES 8
+#endif
+
+// Lifetime of cached sessions and tickets (s)
+#ifndef MCP_TLS_SESSION_SECONDS
+#define MCP_TLS_SESSION_SECONDS 86400
+#endif
+
+// Idle keep-alive connections are closed after this (ms)
+#ifndef MCP_TLS_IDLE_MS
+#define MCP_TLS_IDLE_MS 30000
+#endif
+
+// Handshakes that take longer fail (ms)
+#ifndef MCP_TLS_HANDSHAKE_MS
+#define MCP_TLS_HANDSHAKE_MS 10000
+#endif
+
+// Longest wait for the WebServer's answer (ms); above MCP_CHANGES_MAX_WAIT
+// so long-polls get through
+#ifndef MCP_TLS_BACKEND_MS
+#define MCP_TLS_BACKEND_MS 35000
+#endif
+
+// Longest request head (431 above)
+#ifndef MCP_TLS_HEAD_MAX
+#define MCP_TLS_HEAD_MAX 2048
+#endif
+
+// 1: the front runs in its own task; 0: from ArduinoMCP::handle()
+#ifndef MCP_TLS_TASK
+#define MCP_TLS_TASK 1
+#endif
+
+#ifndef MCP_TLS_TASK_STACK
+#define MCP_TLS_TASK_STACK 8192
+#endif
+
+// Largest request when the front runs from handle()
+#ifndef MCP_TLS_POLL_REQUEST
+#define MCP_TLS_POLL_REQUEST 4096
+#endif
+
+#define MCP_TLS_LATENCY_BUCKETS 14
+
+class WebServer;
+
+namespace mcp {
+namespace tls {
+
+struct Stats {
+    uint32_t connections;        // accepted
+    uint32_t fullHandshakes;
+    uint32_t resumedTicket;
+    uint32_t resumedCache;
+    uint32_t failedHandshakes;   // alerts, timeouts, no memory for the context
+    uint32_t evicted;            // idle connections closed for a new one
+    uint32_t requests;           // answered
+    uint32_t keepAliveRequests;  // answered on a connection that had served one before
+    uint32_t fullMsTotal;
+    uint32_t fullMsMax;
+    uint32_t resumedMsTotal;
+    uint32_t resumedMsMax;
+    uint32_t requestMsMax;
+    uint32_t requestMs[MCP_TLS_LATENCY_BUCKETS];  // up to 1, 2, 5 ... 10000 ms, more
+};
+
+/**
+ * Start the front: TLS on port, requests passed to 127.0.0.1:backendPort
+ *
+ * @param certPem Server certificate (chain), PEM
+ * @param keyPem Its private key, PEM
+ * @return false when the certificate, key or heap do not allow it
+ */
+bool begin(uint16_t port, uint16_t backendPort, const char* certPem, const char* keyPem);
+
+/**
+ * Close all connections and free the TLS contexts
+ */
+void end();
+
+/**
+ * Serve connections when the front has no task of its own; call from
+ * loop() after handleClient()
+ */
+void poll();
+
+bool running();
+
+/**
+ * Counters since begin(); written by the front's task, read without a lock
+ */
+const Stats& stats();
+
+/**
+ * Upper bound (ms) of the bucket holding the pct-th percentile request
+ */
+uint32_t requestPercentileMs(uint8_t pct);
+
+/**
+ * GET /api/tls/stats
+ */
+void handleStats(WebServer& server);
+
+} // namespace tls
+} // namespace mcp
+
+#endif // MCP_TLS_H
@@ -0,0 +1,238 @@
+/**
+ * McpTrace - span tracing for ArduinoMCP and sketches
+ * Implementation file
+ *
+ * @author warusakudeveroper
+ * @license MIT
+ */
+
+#include "McpTrace.h"
+
+#if MCP_TRACE
+
+#include "McpChunkedPrint.h"
+#include "McpEscape.h"
+
+#include <WebServer.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <atomic>
+#include <stdio.h>
+#include <string.h>
+
+namespace mcp {
+namespace trace {
+
+namespace {
+
+static_assert(MCP_TRACE_EVENTS > 0 && (MCP_TRACE_EVENTS & (MCP_TRACE_EVENTS - 1)) == 0,
+              "MCP_TRACE_EVENTS must be a power of two");
+
+constexpr uint32_t kMask = MCP_TRACE_EVENTS - 1;
+constexpr size_t kMaxThreads = 16;  // tasks named in an export; the rest share tid 0
+
+struct Event {
+    std::atomic<uint32_t> seq;  // slot number + 1 once published, 0 while being written
+    uint32_t phaseValue;        // value << 8 | phase
+    int64_t ts;
+    const char* name;
+    TaskHandle_t task;
+};
+
+struct Ring {
+    std::atomic<uint32_t> head;   // slots claimed since boot
+    std::atomic<uint32_t> start;  // first slot not cleared
+    Event events[MCP_TRACE_EVENTS];
+};
+
+Ring rings[portNUM_PROCESSORS];
+
+struct Snapshot {
+    int64_t ts;
+    const char* name;
+    TaskHandle_t task;
+    int32_t value;
+    char phase;
+};
+
+// Copy slot n if it still holds that event: the sequence number must be the
+// same before and after the copy, otherwise a writer lapped the reader.
+bool readSlot(const Ring& ring, uint32_t n, Snapshot& out) {
+    const Event& e = ring.events[n & kMask];
+    if (e.seq.load(std::memory_order_acquire) != n + 1) return false;
+    uint32_t phaseValue = e.phaseValue;
+    out.ts = e.ts;
+    out.name = e.name;
+    out.task = e.task;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (e.seq.load(std::memory_order_relaxed) != n + 1) return false;
+    out.phase = static_cast<char>(phaseValue & 0xFF);
+    out.value = static_cast<int32_t>(phaseValue) >> 8;
+    return true;
+}
+
+// Oldest slot still in the ring and not cleared
+uint32_t firstSlot(const Ring& ring, uint32_t head) {
+    uint32_t from = ring.start.load(std::memory_order_relaxed);
+    return head - from > MCP_TRACE_EVENTS ? head - MCP_TRACE_EVENTS : from;
+}
+
+void writeEscaped(Print& out, const char* s) {
+    char buf[64];
+    size_t len = strlen(s);
+    while (len > 0) {
+        EscapeResult r = escapeJson(buf, sizeof(buf), s, len);
+        out.write(reinterpret_cast<const uint8_t*>(buf), r.written);
+        s += r.consumed;
+        len -= r.consumed;
+    }
+}
+
+class ThreadTable {
+public:
+    ThreadTable() : _count(0), _other(false) {}
+
+    int idOf(TaskHandle_t task) {
+        for (size_t i = 0; i < _count; i++) {
+            if (_tasks[i] == task) return static_cast<int>(i) + 1;
+        }
+        if (_count == kMaxThreads) {
+            _other = true;
+            return 0;
+        }
+        _tasks[_count++] = task;
+        return static_cast<int>(_count);
+    }
+
+    // "thread_name" metadata, named after the tasks as they are now
+    // (tasks that recorded events are expected to still exist)
+    void writeNames(Print& out) const {
+        for (size_t i = 0; i < _count; i++) {
+            writeName(out, static_cast<int>(i) + 1, pcTaskGetName(_tasks[i]));
+        }
+        if (_other) writeName(out, 0, "other tasks");
+    }
+
+private:
+    static void writeName(Print& out, int tid, const char* name) {
+        char line[80];
+        snprintf(line, sizeof(line), ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"",
+                 tid);
+        out.print(line);
+        writeEscaped(out, name);
+        out.print("\"}}");
+    }
+
+    TaskHandle_t _tasks[kMaxThreads];
+    size_t _count;
+    bool _other;
+};
+
+// Export everything up to the heads at the time of the call; the heads are
+// returned so that a following clear forgets exactly what was sent.
+size_t writeJson(Print& out, uint32_t heads[portNUM_PROCESSORS]) {
+    ThreadTable threads;
+    size_t written = 0;
+    uint32_t overwritten = 0;
+    char line[96];
+
+    out.print("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+              "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"ESP32\"}}");
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        const Ring& ring = rings[core];
+        uint32_t head = ring.head.load(std::memory_order_acquire);
+        uint32_t from = firstSlot(ring, head);
+        heads[core] = head;
+        overwritten += from - ring.start.load(std::memory_order_relaxed);
+        for (uint32_t n = from; n != head; n++) {
+            Snapshot ev;
+            if (!readSlot(ring, n, ev)) continue;
+            out.print(",\n{\"name\":\"");
+            writeEscaped(out, ev.name);
+            snprintf(line, sizeof(line), "\",\"ph\":\"%c\",\"ts\":%lld,\"pid\":1,\"tid\":%d", ev.phase,
+                     static_cast<long long>(ev.ts), threads.idOf(ev.task));
+            out.print(line);
+            if (ev.phase == 'i') {
+                snprintf(line, sizeof(line), ",\"s\":\"t\",\"args\":{\"value\":%ld}", static_cast<long>(ev.value));
+                out.print(line);
+            }
+            out.print('}');
+            written++;
+        }
+    }
+    threads.writeNames(out);
+    snprintf(line, sizeof(line), "\n],\"otherData\":{\"overwritten\":\"%lu\"}}\n",
+             static_cast<unsigned long>(overwritten));
+    out.print(line);
+    return written;
+}
+
+} // namespace
+
+void record(char phase, const char* name, int32_t value) {
+    int64_t ts = esp_timer_get_time();
+    Ring& ring = rings[xPortGetCoreID()];
+    uint32_t n = ring.head.fetch_add(1, std::memory_order_relaxed);
+    Event& e = ring.events[n & kMask];
+    e.seq.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    e.phaseValue = (static_cast<uint32_t>(value) << 8) | static_cast<uint8_t>(phase);
+    e.ts = ts;
+    e.name = name;
+    e.task = xTaskGetCurrentTaskHandle();
+    e.seq.store(n + 1, std::memory_order_release);
+}
+
+void clear() {
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        rings[core].start.store(rings[core].head.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+}
+
+uint32_t recordedCount() {
+    uint32_t total = 0;
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        total += rings[core].head.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+uint32_t overwrittenCount() {
+    uint32_t total = 0;
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        const Ring& ring = rings[core];
+        uint32_t head = ring.head.load(std::memory_order_relaxed);
+        total += firstSlot(ring, head) - ring.start.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+size_t writeChromeJson(Print& out) {
+    uint32_t heads[portNUM_PROCESSORS];
+    return writeJson(out, heads);
+}
+
+void sendChromeJson(WebServer& server) {
+    bool clearAfter = server.arg("clear") == "1";
+    server.sendHeader("Cache-Control", "no-store");
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, "application/json", "");
+
+    uint32_t heads[portNUM_PROCESSORS];
+    ChunkedPrint out(server);
+    writeJson(out, heads);
+    out.flush();
+
+    if (clearAfter) {
+        for (int core = 0; core < portNUM_PROCESSORS; core++) {
+            rings[core].start.store(heads[core], std::memory_order_relaxed);
+        }
+    }
+}
+
+} // namespace trace
+} // namespace mcp
+
+#endif // MCP_TRACE
@@ -0,0 +1,120 @@
+/**
+ * McpTrace - span tracing for ArduinoMCP and sketches
+ *
+ * Begin / end spans and instant events go into one ring buffer per CPU core,
+ * timestamped with esp_timer (microseconds since boot). Recording is
+ * lock-free: a writer claims a slot with an atomic increment on its own
+ * core's ring and publishes it with a sequence number, so tasks, the Wi-Fi
+ * event task and ISRs can all record without a mutex, and a reader copying
+ * the rings concurrently skips slots that are being rewritten. When a ring is
+ * full the oldest events are overwritten.
+ *
+ * The rings export as Chrome trace_event JSON (one thread per FreeRTOS task,
+ * named after it), which opens directly in https://ui.perfetto.dev or
+ * chrome://tracing.
+ *
+ * Tracing is off unless the build defines MCP_TRACE=1; then every macro
+ * below expands to nothing and no buffer exists:
+ *
+ *   arduino-cli compile --build-property "build.extra_flags=-DMCP_TRACE=1" ...
+ *
+ * Event names are stored by pointer: pass string literals (or other strings
+ * that live forever), never a temporary.
+ *
+ *   void handleFoo() {
+ *       MCP_TRACE_SCOPE("foo");            // span for the rest of the block
+ *       ...
+ *       MCP_TRACE_INSTANT("foo.retry", n);  // point event with a value
+ *   }
+ *
+ * @author warusakudeveroper
+ * @license MIT
+ */
+
+#ifndef MCP_TRACE_H
+#define MCP_TRACE_H
+
+#ifndef MCP_TRACE
+#define MCP_TRACE 0
+#endif
+
+// Events kept per core (power of two); 24 bytes each on the ESP32
+#ifndef MCP_TRACE_EVENTS
+#define MCP_TRACE_EVENTS 512
+#endif
+
+#if MCP_TRACE
+
+#include <Arduino.h>
+
+class WebServer;
+
+namespace mcp {
+namespace trace {
+
+/**
+ * Record one event on the calling core's ring
+ *
+ * @param phase 'B' (span begin), 'E' (span end) or 'i' (instant)
+ * @param name Event name; must outlive the trace (string literal)
+ * @param value Shown as args.value in the viewer (instants only; 24-bit range)
+ */
+void record(char phase, const char* name, int32_t value = 0);
+
+/**
+ * Span for the lifetime of the object (MCP_TRACE_SCOPE)
+ */
+class Span {
+public:
+    explicit Span(const char* name) : _name(name) { record('B', name); }
+    ~Span() { record('E', _name); }
+    Span(const Span&) = delete;
+    Span& operator=(const Span&) = delete;
+private:
+    const char* _name;
+};
+
+/**
+ * Forget all recorded events
+ */
+void clear();
+
+/**
+ * Events recorded since boot / overwritten since the last clear() before
+ * they could be exported
+ */
+uint32_t recordedCount();
+uint32_t overwrittenCount();
+
+/**
+ * Write the rings as Chrome trace_event JSON
+ * @return Number of events written
+ */
+size_t writeChromeJson(Print& out);
+
+/**
+ * Answer the current request with writeChromeJson() (chunked, no full copy
+ * in RAM). ?clear=1 then forgets the events that were sent.
+ */
+void sendChromeJson(WebServer& server);
+
+} // namespace trace
+} // namespace mcp
+
+#define MCP_TRACE_CONCAT2(a, b) a##b
+#define MCP_TRACE_CONCAT(a, b) MCP_TRACE_CONCAT2(a, b)
+#define MCP_TRACE_BEGIN(name) ::mcp::trace::record('B', (name))
+#define MCP_TRACE_END(name) ::mcp::trace::record('E', (name))
+#define MCP_TRACE_INSTANT(name, value) ::mcp::trace::record('i', (name), (int32_t)(value))
+#define MCP_TRACE_SCOPE(name) ::mcp::trace::Span MCP_TRACE_CONCAT(_mcpTraceSpan, __LINE__)(name)
+
+#else
+
+#define MCP_TRACE_BEGIN(name) ((void)0)
+#define MCP_TRACE_END(name) ((void)0)
+#define MCP_TRACE_INSTANT(name, value) ((void)0)
+#define MCP_TRACE_SCOPE(name) ((void)0)
+
+#endif // MCP_TRACE
+
+#endif // MCP_TRACE_H
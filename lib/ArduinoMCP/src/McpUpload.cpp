@@ -0,0 +1,170 @@
+/**
+ * McpUpload - many files in one multipart/form-data request
+ * Implementation file
+ *
+ * @author warusakudeveroper
+ * @license MIT
+ */
+
+#include "McpUpload.h"
+#include "McpChanges.h"
+#include "McpConfig.h"
+#include "McpEscape.h"
+
+#include <SPIFFS.h>
+#include <WebServer.h>
+
+#include <stdio.h>
+#include <string.h>
+
+namespace mcp {
+namespace upload {
+
+namespace {
+
+constexpr size_t kMaxPath = 31;  // SPIFFS object name limit
+
+struct Result {
+    char path[kMaxPath + 1];
+    uint32_t size;
+    const char* error;  // nullptr: written
+};
+
+// State of the request whose parts are arriving (parts come one at a time)
+Result results[MCP_UPLOAD_RESULTS];
+File file;
+char path[kMaxPath + 1];
+const char* partError;  // of the current part
+bool skipPart;          // empty file input: not a file
+bool active = false;
+uint32_t count;
+uint32_t written;
+uint32_t failed;
+uint32_t bytes;
+uint32_t startMs;
+
+void reset() {
+    if (file) file.close();
+    active = false;
+    count = written = failed = bytes = 0;
+}
+
+// dir + "/" + filename, without doubled slashes
+bool buildPath(const String& dir, const String& filename) {
+    String p = dir.startsWith("/") ? dir : "/" + dir;
+    if (!p.endsWith("/")) p += "/";
+    p += filename.startsWith("/") ? filename.substring(1) : filename;
+    if (p.length() > kMaxPath) {
+        snprintf(path, sizeof(path), "%s", p.c_str());  // truncated, for the result
+        return false;
+    }
+    memcpy(path, p.c_str(), p.length() + 1);
+    return true;
+}
+
+void fail(const char* message) {
+    partError = message;
+    if (file) {
+        file.close();
+        SPIFFS.remove(path);  // no partial files
+    }
+}
+
+void finishPart(size_t size) {
+    if (count < MCP_UPLOAD_RESULTS) {
+        Result& r = results[count];
+        memcpy(r.path, path, sizeof(r.path));
+        r.size = (uint32_t)size;
+        r.error = partError;
+    }
+    count++;
+    if (partError == nullptr) {
+        written++;
+        bytes += size;
+#if MCP_CHANGES
+        changes::record(changes::Op::Write, path, size);
+#endif
+    } else {
+        failed++;
+    }
+}
+
+} // namespace
+
+void handleData(WebServer& server) {
+    HTTPUpload& up = server.upload();
+    switch (up.status) {
+        case UPLOAD_FILE_START:
+            if (!active) {
+                reset();
+                active = true;
+                startMs = millis();
+            }
+            partError = nullptr;
+            skipPart = up.filename.length() == 0;
+            if (skipPart) break;
+            if (!buildPath(server.arg("dir"), up.filename)) {
+                partError = "Path too long";
+            } else if (!(file = SPIFFS.open(path, "w"))) {
+                partError = "Failed to create file";
+            }
+            break;
+        case UPLOAD_FILE_WRITE:
+            if (!skipPart && partError == nullptr && file.write(up.buf, up.currentSize) != up.currentSize) {
+                fail("Write failed (filesystem full?)");
+            }
+            break;
+        case UPLOAD_FILE_END:
+            if (skipPart) break;
+            if (partError == nullptr) file.close();
+            finishPart(up.totalSize);
+            break;
+        case UPLOAD_FILE_ABORTED:
+            // The request ends here; handleDone() is not called.
+            fail("Aborted");
+            reset();
+            break;
+    }
+}
+
+void handleDone(WebServer& server) {
+    if (!active || count == 0) {
+        reset();
+        server.send(400, "application/json", "{\"ok\":false,\"error\":\"No files (multipart/form-data expected)\"}");
+        return;
+    }
+
+    String json;
+    json.reserve(96 + (count < MCP_UPLOAD_RESULTS ? count : MCP_UPLOAD_RESULTS) * 64);
+    json += failed == 0 ? "{\"ok\":true,\"files\":[" : "{\"ok\":false,\"files\":[";
+    for (uint32_t i = 0; i < count && i < MCP_UPLOAD_RESULTS; i++) {
+        const Result& r = results[i];
+        json += i > 0 ? ",{\"path\":\"" : "{\"path\":\"";
+        appendJsonEscaped(json, r.path, strlen(r.path));
+        if (r.error == nullptr) {
+            json += "\",\"size\":";
+            json += String(r.size);
+            json += ",\"ok\":true}";
+        } else {
+            json += "\",\"ok\":false,\"error\":\"";
+            json += r.error;
+            json += "\"}";
+        }
+    }
+    json += "],\"count\":";
+    json += String(count);
+    json += ",\"written\":";
+    json += String(written);
+    json += ",\"failed\":";
+    json += String(failed);
+    json += ",\"bytes\":";
+    json += String(bytes);
+    json += ",\"ms\":";
+    json += String(millis() - startMs);
+    json += "}";
+    reset();
+    server.send(200, "application/json", json);
+}
+
+} // namespace upload
+} // namespace mcp
@@ -0,0 +1,61 @@
+/**
+ * McpUpload - many files in one multipart/form-data request
+ *
+ * Uploading a folder as one /api/spiffs/write request per file pays a TCP
+ * connect, request parse and response for every file. Here the browser (or
+ * curl) sends all of them in one multipart/form-data POST: the WebServer
+ * parses the body as it arrives and hands each file part to handleData() in
+ * HTTP_UPLOAD_BUFLEN chunks, which go straight into that part's file, so
+ * memory use does not depend on file or request size.
+ *
+ *   POST /api/spiffs/upload?dir=/www   (multipart, one part per file)
+ *   {"ok":true,"files":[{"path":"/www/index.html","size":1432,"ok":true},
+ *                       {"path":"/www/very/long/name.js","ok":false,"error":"Path too long"}],
+ *    "count":2,"written":1,"failed":1,"bytes":1432,"ms":180}
+ *
+ *   curl -F f1=@index.html -F f2=@app.js "http://esp32.local/api/spiffs/upload?dir=/www"
+ *
+ * A part's filename (a browser folder upload sends "folder/file") is
+ * appended to dir; existing files are replaced. A file that fails is removed
+ * and the rest still go through; "ok" is false if any failed. "files" lists
+ * the first MCP_UPLOAD_RESULTS files, the counters cover all of them. Files
+ * go to SPIFFS and are recorded in the change feed (McpChanges.h).
+ *
+ * Register both handlers on one route:
+ *   server.on("/api/spiffs/upload", HTTP_POST,
+ *             [] { mcp::upload::handleDone(server); },
+ *             [] { mcp::upload::handleData(server); });
+ *
+ * @author warusakudeveroper
+ * @license MIT
+ */
+
+#ifndef MCP_UPLOAD_H
+#define MCP_UPLOAD_H
+
+#include <Arduino.h>
+
+// Per-file results kept for the response
+#ifndef MCP_UPLOAD_RESULTS
+#define MCP_UPLOAD_RESULTS 16
+#endif
+
+class WebServer;
+
+namespace mcp {
+namespace upload {
+
+/**
+ * Upload callback: one call per chunk of each file part
+ */
+void handleData(WebServer& server);
+
+/**
+ * Request handler, after the last part: sends the results
+ */
+void handleDone(WebServer& server);
+
+} // namespace upload
+} // namespace mcp
+
+#endif // MCP_UPLOAD_H
@@ -0,0 +1,327 @@
+/**
+ * McpZFile - compressed files on SPIFFS (or any fs::FS)
+ * Implementation file
+ *
+ * @author warusakudeveroper
+ * @license MIT
+ */
+
+#include "McpZFile.h"
+#include "McpGzip.h"
+#include "McpInflate.h"
+#include "McpMem.h"
+
+#include <WebServer.h>
+#include <esp_rom_crc.h>
+
+#include <new>
+#include <stdlib.h>
+#include <string.h>
+
+namespace mcp {
+namespace zfile {
+
+namespace {
+
+static_assert(MCP_ZFILE_BLOCK >= 512 && MCP_ZFILE_BLOCK <= 32768, "MCP_ZFILE_BLOCK out of range");
+
+constexpr size_t kFileHeader = 8;
+constexpr size_t kBlockHeader = 8;
+constexpr size_t kStoredOverhead = 5;  // stored deflate block: type byte, LEN, NLEN
+const uint8_t kMagic[4] = {'M', 'C', 'Z', 1};
+
+struct BlockHeader {
+    uint16_t rawLen;
+    uint16_t segLen;
+    uint32_t crc;
+};
+
+uint16_t get16(const uint8_t* p) {
+    return (uint16_t)(p[0] | p[1] << 8);
+}
+
+void put16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+void put32(uint8_t* p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+bool readFileHeader(File& file, uint16_t& blockSize) {
+    uint8_t h[kFileHeader];
+    if (!file.seek(0) || file.read(h, sizeof(h)) != sizeof(h) || memcmp(h, kMagic, sizeof(kMagic)) != 0) {
+        file.seek(0);
+        return false;
+    }
+    blockSize = get16(h + 4);
+    return blockSize > 0 && blockSize <= 32768;
+}
+
+// Visits the complete blocks in order; torn is set when the file ends
+// inside one.
+class BlockWalker {
+public:
+    explicit BlockWalker(File& file) : torn(false), _file(file), _size(file.size()), _next(kFileHeader) {}
+
+    // Header of the next block and the file offset of its segment
+    bool next(BlockHeader& h, size_t& segmentAt) {
+        uint8_t b[kBlockHeader];
+        if (_next + kBlockHeader > _size || !_file.seek(_next) || _file.read(b, sizeof(b)) != sizeof(b)) {
+            torn = _next != _size;
+            return false;
+        }
+        h.rawLen = get16(b);
+        h.segLen = get16(b + 2);
+        h.crc = (uint32_t)b[4] | (uint32_t)b[5] << 8 | (uint32_t)b[6] << 16 | (uint32_t)b[7] << 24;
+        segmentAt = _next + kBlockHeader;
+        if (segmentAt + h.segLen > _size) {
+            torn = true;
+            return false;
+        }
+        _next = segmentAt + h.segLen;
+        return true;
+    }
+
+    size_t end() const { return _next; }
+
+    bool torn;
+
+private:
+    File& _file;
+    size_t _size;
+    size_t _next;
+};
+
+struct SegmentOut {
+    uint8_t* data;
+    size_t cap;
+    size_t len;
+};
+
+bool collectSegment(void* ctx, const uint8_t* data, size_t len, bool last) {
+    SegmentOut& out = *static_cast<SegmentOut*>(ctx);
+    if (out.len + len > out.cap) return false;  // no gain over a stored block
+    memcpy(out.data + out.len, data, len);
+    out.len += len;
+    return true;
+}
+
+} // namespace
+
+bool isCompressed(File& file) {
+    uint16_t blockSize;
+    const bool compressed = readFileHeader(file, blockSize);
+    file.seek(0);
+    return compressed;
+}
+
+bool stat(File& file, Info& info) {
+    memset(&info, 0, sizeof(info));
+    if (!readFileHeader(file, info.blockSize)) return false;
+    BlockWalker walk(file);
+    BlockHeader h;
+    size_t at;
+    while (walk.next(h, at)) {
+        info.rawSize += h.rawLen;
+        info.crc = h.crc;
+        info.blocks++;
+    }
+    info.storedSize = walk.end();
+    info.torn = walk.torn;
+    return true;
+}
+
+bool read(File& file, size_t offset, size_t length, Sink sink, void* ctx) {
+    uint16_t blockSize;
+    if (!readFileHeader(file, blockSize)) return false;
+    uint8_t* seg = (uint8_t*)mem::alloc(blockSize + kStoredOverhead);
+    uint8_t* raw = (uint8_t*)mem::alloc(blockSize);
+    bool ok = seg != nullptr && raw != nullptr;
+
+    const size_t end = length > SIZE_MAX - offset ? SIZE_MAX : offset + length;
+    size_t rawPos = 0;
+    uint32_t prevCrc = 0;
+    BlockWalker walk(file);
+    BlockHeader h;
+    size_t at;
+    while (ok && rawPos < end && walk.next(h, at)) {
+        const size_t blockEnd = rawPos + h.rawLen;
+        if (h.rawLen > blockSize || h.segLen > blockSize + kStoredOverhead) {
+            ok = false;
+            break;
+        }
+        if (blockEnd > offset) {
+            size_t got = 0;
+            ok = file.seek(at) && file.read(seg, h.segLen) == h.segLen &&
+                 inflateRaw(seg, h.segLen, raw, h.rawLen, got) == InflateResult::Ok && got == h.rawLen &&
+                 esp_rom_crc32_le(prevCrc, raw, h.rawLen) == h.crc;
+            if (ok) {
+                const size_t from = offset > rawPos ? offset - rawPos : 0;
+                const size_t to = end < blockEnd ? end - rawPos : h.rawLen;
+                ok = sink(ctx, raw + from, to - from);
+            }
+        }
+        prevCrc = h.crc;
+        rawPos = blockEnd;
+    }
+    mem::free(seg);
+    mem::free(raw);
+    return ok;
+}
+
+bool sendGzip(WebServer& server, File& file, const char* contentType) {
+    Info info;
+    if (!stat(file, info)) return false;
+
+    // ID1 ID2 CM=deflate FLG=0 MTIME=0 XFL=0 OS=unknown
+    static const uint8_t kGzipHeader[10] = {0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 0xff};
+    const size_t segments = info.storedSize - kFileHeader - kBlockHeader * info.blocks;
+    uint8_t trailer[10] = {0x03, 0x00};  // empty final block (fixed codes, end of block only)
+    put32(trailer + 2, info.crc);
+    put32(trailer + 6, (uint32_t)info.rawSize);
+
+    server.sendHeader("Content-Encoding", "gzip");
+    server.sendHeader("Vary", "Accept-Encoding");
+    server.setContentLength(sizeof(kGzipHeader) + segments + sizeof(trailer));
+    server.send(200, contentType, "");
+    server.sendContent((const char*)kGzipHeader, sizeof(kGzipHeader));
+
+    uint8_t buf[512];
+    BlockWalker walk(file);
+    BlockHeader h;
+    size_t at;
+    for (uint32_t i = 0; i < info.blocks && walk.next(h, at); i++) {
+        file.seek(at);
+        for (size_t left = h.segLen; left > 0;) {
+            const size_t n = file.read(buf, left < sizeof(buf) ? left : sizeof(buf));
+            if (n == 0) return false;  // Content-Length is already out; the client sees a short body
+            server.sendContent((const char*)buf, n);
+            left -= n;
+        }
+    }
+    server.sendContent((const char*)trailer, sizeof(trailer));
+    return true;
+}
+
+Writer::Writer()
+    : _open(false), _ok(false), _buf(nullptr), _len(0), _blockSize(MCP_ZFILE_BLOCK), _crc(0),
+      _rawBytes(0), _storedBytes(0) {}
+
+Writer::~Writer() {
+    close();
+}
+
+bool Writer::open(fs::FS& fs, const char* path, bool append) {
+    close();
+    _len = 0;
+    _crc = 0;
+    _rawBytes = _storedBytes = 0;
+    _blockSize = MCP_ZFILE_BLOCK;
+
+    if (append && fs.exists(path)) {
+        File existing = fs.open(path, FILE_READ);
+        Info info;
+        if (!existing || !stat(existing, info) || info.torn) return false;
+        existing.close();
+        _crc = info.crc;
+        if (info.blockSize < _blockSize) _blockSize = info.blockSize;  // readers size buffers by the header
+        _file = fs.open(path, FILE_APPEND);
+        if (!_file) return false;
+    } else {
+        _file = fs.open(path, FILE_WRITE);
+        if (!_file) return false;
+        uint8_t h[kFileHeader] = {0};
+        memcpy(h, kMagic, sizeof(kMagic));
+        put16(h + 4, _blockSize);
+        if (_file.write(h, sizeof(h)) != sizeof(h)) {
+            _file.close();
+            return false;
+        }
+        _storedBytes = sizeof(h);
+    }
+
+    _buf = (uint8_t*)mem::alloc(_blockSize);
+    if (_buf == nullptr) {
+        _file.close();
+        return false;
+    }
+    _open = true;
+    _ok = true;
+    return true;
+}
+
+size_t Writer::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t Writer::write(const uint8_t* data, size_t len) {
+    size_t done = 0;
+    while (_open && _ok && done < len) {
+        size_t n = _blockSize - _len;
+        if (n > len - done) n = len - done;
+        memcpy(_buf + _len, data + done, n);
+        _len += n;
+        done += n;
+        if (_len == _blockSize && !commit()) break;
+    }
+    return done;
+}
+
+bool Writer::commit() {
+    if (!_open || !_ok) return false;
+    if (_len == 0) return true;
+
+    const size_t cap = _len + kStoredOverhead;
+    uint8_t* block = (uint8_t*)mem::alloc(kBlockHeader + cap);
+    if (block == nullptr) return false;  // keep the data; a later commit may succeed
+
+    // Deflate; without memory for the compressor, or if it does not pay
+    // off, the block is stored.
+    SegmentOut out = {block + kBlockHeader, cap, 0};
+    bool deflated = false;
+    GzipStream* gz = new (std::nothrow) GzipStream();
+    if (gz != nullptr) {
+        gz->begin(collectSegment, &out, GzipStream::Format::Segment);
+        deflated = gz->write(_buf, _len) && gz->finish() && out.len < cap;
+        delete gz;
+    }
+    if (!deflated) {
+        uint8_t* p = block + kBlockHeader;
+        p[0] = 0;  // BFINAL = 0, BTYPE = 00
+        put16(p + 1, (uint16_t)_len);
+        put16(p + 3, (uint16_t)~_len);
+        memcpy(p + kStoredOverhead, _buf, _len);
+        out.len = cap;
+    }
+
+    const uint32_t crc = esp_rom_crc32_le(_crc, _buf, _len);
+    put16(block, (uint16_t)_len);
+    put16(block + 2, (uint16_t)out.len);
+    put32(block + 4, crc);
+    const size_t total = kBlockHeader + out.len;
+    _ok = _file.write(block, total) == total;
+    _file.flush();
+    mem::free(block);
+    if (!_ok) return false;
+
+    _crc = crc;
+    _rawBytes += _len;
+    _storedBytes += total;
+    _len = 0;
+    return true;
+}
+
+bool Writer::close() {
+    if (!_open) return true;
+    const bool ok = commit();
+    _file.close();
+    mem::free(_buf);
+    _buf = nullptr;
+    _open = false;
+    return ok;
+}
+
+} // namespace zfile
+} // namespace mcp
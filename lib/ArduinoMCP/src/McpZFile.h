@@ -0,0 +1,142 @@
+/**
+ * McpZFile - compressed files on SPIFFS (or any fs::FS)
+ *
+ * CSV and log files compress 5-10x with deflate. A compressed file is a
+ * sequence of blocks of up to MCP_ZFILE_BLOCK bytes, each stored as an
+ * independent deflate segment (McpGzip Format::Segment, or a stored block
+ * when the data does not compress), so:
+ *   - appending adds blocks at the end; nothing is rewritten
+ *   - a ranged read decodes only the blocks it overlaps
+ *   - the segments in order form one deflate stream, so the file goes out
+ *     as Content-Encoding: gzip with only a header and trailer added
+ *
+ * Layout (little endian):
+ *   "MCZ" 0x01, u16 block size, u16 0
+ *   per block: u16 raw length, u16 segment length, u32 CRC-32 of the file
+ *              contents up to the end of this block, segment bytes
+ * A block cut short by a reset is ignored by readers (Info::torn); appending
+ * to such a file fails until it is rewritten.
+ *
+ *   mcp::zfile::Writer log;
+ *   log.open(SPIFFS, "/data.csv", true);   // append, create if missing
+ *   log.printf("%lu,%d\n", millis(), rssi);  // buffered up to one block
+ *   log.close();                            // or commit() to write the block now
+ *
+ * RAM: the Writer holds one block buffer and, while writing a block, the
+ * compressor (~11 KB) and an output buffer; reads take about two blocks.
+ *
+ * @author warusakudeveroper
+ * @license MIT
+ */
+
+#ifndef MCP_ZFILE_H
+#define MCP_ZFILE_H
+
+#include <Arduino.h>
+#include <FS.h>
+
+// Uncompressed bytes per block (512 .. 32768). Larger blocks compress
+// better; smaller ones make ranged reads and partial appends cheaper.
+#ifndef MCP_ZFILE_BLOCK
+#define MCP_ZFILE_BLOCK 4096
+#endif
+
+class WebServer;
+
+namespace mcp {
+namespace zfile {
+
+struct Info {
+    size_t rawSize;     // decompressed length
+    size_t storedSize;  // bytes of complete blocks, header included
+    uint32_t blocks;
+    uint32_t crc;       // CRC-32 of the decompressed contents
+    uint16_t blockSize;
+    bool torn;          // trailing partial block (ignored)
+};
+
+/**
+ * Whether the file starts with the compressed-file header; the position is
+ * left at 0
+ */
+bool isCompressed(File& file);
+
+/**
+ * Sizes of a compressed file (walks the block headers)
+ * @return false if the file is not compressed
+ */
+bool stat(File& file, Info& info);
+
+/**
+ * Receives decompressed data; return false to stop
+ */
+typedef bool (*Sink)(void* ctx, const uint8_t* data, size_t len);
+
+/**
+ * Decompress [offset, offset + length) of the file into sink; length is
+ * clipped to the end of the file. Each block's CRC is checked.
+ * @return false if the file is not compressed, is corrupt, memory ran out
+ *         or the sink stopped
+ */
+bool read(File& file, size_t offset, size_t length, Sink sink, void* ctx);
+
+/**
+ * Send the whole file as a gzip response (Content-Encoding: gzip) without
+ * decompressing it; only the client must accept gzip
+ */
+bool sendGzip(WebServer& server, File& file, const char* contentType);
+
+/**
+ * Buffered writer; data reaches the file one compressed block at a time
+ */
+class Writer : public Print {
+public:
+    Writer();
+    ~Writer();
+    Writer(const Writer&) = delete;
+    Writer& operator=(const Writer&) = delete;
+
+    /**
+     * Start a new file, or append to an existing compressed one (a missing
+     * file is created)
+     * @return false if the file cannot be opened, or the file to append to
+     *         is not compressed or ends in a torn block
+     */
+    bool open(fs::FS& fs, const char* path, bool append = false);
+
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* data, size_t len) override;
+    using Print::write;
+
+    /**
+     * Compress and write the buffered data as a block now. Each commit
+     * ends a block, so committing often costs compression ratio.
+     */
+    bool commit();
+    void flush() override { commit(); }
+
+    /**
+     * Commit and close the file
+     */
+    bool close();
+
+    bool isOpen() const { return _open; }
+    size_t rawBytes() const { return _rawBytes; }        // written through this writer
+    size_t storedBytes() const { return _storedBytes; }  // file bytes added by it
+
+private:
+    File _file;
+    bool _open;
+    bool _ok;
+    uint8_t* _buf;
+    size_t _len;
+    uint16_t _blockSize;
+    uint32_t _crc;
+    size_t _rawBytes;
+    size_t _storedBytes;
+};
+
+} // namespace zfile
+} // namespace mcp
+
+#endif // MCP_ZFILE_H
@@ -0,0 +1,345 @@
+/**
+ * bootTimeline.cpp
+ * Boot timeline and reset history for aranea device
+ */
+
+#include "bootTimeline.h"
+#include "esp_system.h"
+#include <Preferences.h>
+#include <McpTrace.h>
+#include <time.h>
+
+#define BOOT_RTC_MAGIC 0xB0071E01
+#define BOOT_NVS_KEY "state"
+#define BOOT_NVS_VERSION 1
+#define BOOT_EPOCH_VALID 1600000000  // earlier wall clock = never synced
+
+// Global instance
+BootTimeline bootTimeline;
+
+// Kept in RTC slow memory across resets (except power loss) and deep sleep.
+struct BootRtc {
+  uint32_t magic;
+  bool finalized;       // current is a reset boot whose final record is in NVS
+  uint8_t historySlot;  // its NVS history slot
+  uint8_t wakeNext;
+  uint8_t wakeCount;
+  BootRecord current;
+  BootRecord wakes[BOOT_WAKE_HISTORY];
+  uint32_t resets[BOOT_REASON_SLOTS];  // since RTC memory was last lost
+};
+
+RTC_DATA_ATTR static BootRtc rtc;
+
+// Event names for the trace (stored by pointer)
+static const char* const kTraceNames[(int)BootPhase::Count] = {
+    "boot.appStart", "boot.spiffs", "boot.settings", "boot.wifiConnect",
+    "boot.ntp",      "boot.mdns",   "boot.firstReport"};
+
+static int reasonSlot(int reason) {
+  return reason >= 0 && reason < BOOT_REASON_SLOTS ? reason : ESP_RST_UNKNOWN;
+}
+
+static void pushWake(const BootRecord& r) {
+  rtc.wakes[rtc.wakeNext] = r;
+  rtc.wakeNext = (rtc.wakeNext + 1) % BOOT_WAKE_HISTORY;
+  if (rtc.wakeCount < BOOT_WAKE_HISTORY) rtc.wakeCount++;
+}
+
+BootTimeline::BootTimeline() : loaded(false), nvsOk(false) {
+  memset(&state, 0, sizeof(state));
+}
+
+void BootTimeline::begin() {
+  const uint32_t now = millis();
+  const int reason = (int)esp_reset_reason();
+
+  // RTC memory holds garbage after power-on; a brownout may or may not have
+  // kept it, the magic decides.
+  const bool rtcOk = rtc.magic == BOOT_RTC_MAGIC && reason != ESP_RST_POWERON;
+  if (!rtcOk) {
+    memset(&rtc, 0, sizeof(rtc));
+    rtc.magic = BOOT_RTC_MAGIC;
+    rtc.finalized = true;
+  }
+  const BootRecord previous = rtc.current;
+  const bool hasPrevious = rtcOk && previous.boot != 0;
+  rtc.resets[reasonSlot(reason)]++;
+
+  memset(&rtc.current, 0, sizeof(rtc.current));
+  rtc.current.resetReason = (uint8_t)reason;
+
+  if (reason == ESP_RST_DEEPSLEEP && hasPrevious) {
+    // Wake: RTC only. The only flash write is for a reset boot that went to
+    // sleep without reaching its first report.
+    if (previous.wake > 0) {
+      pushWake(previous);
+    } else if (!rtc.finalized) {
+      if (loadNvs() && state.history[rtc.historySlot].boot == previous.boot) {
+        state.history[rtc.historySlot] = previous;
+        saveNvs();
+      }
+      rtc.finalized = true;
+    }
+    rtc.current.boot = previous.boot;
+    rtc.current.wake = previous.wake + 1;
+    markAt(BootPhase::AppStart, now);
+    return;
+  }
+
+  // Reset boot: settle the previous record (how far it got and how long it
+  // lived) and add this one, in a single NVS write.
+  loadNvs();
+  if (hasPrevious) {
+    if (previous.wake > 0) {
+      pushWake(previous);
+    } else if (state.history[rtc.historySlot].boot == previous.boot) {
+      state.history[rtc.historySlot] = previous;
+    }
+  }
+  if (!nvsOk && hasPrevious) {
+    state.boots = previous.boot;  // keep numbering from RTC while NVS is unusable
+  }
+  state.boots++;
+  state.resets[reasonSlot(reason)]++;
+  rtc.current.boot = state.boots;
+  markAt(BootPhase::AppStart, now);
+
+  rtc.historySlot = state.next;
+  rtc.finalized = false;
+  state.history[state.next] = rtc.current;
+  state.next = (state.next + 1) % BOOT_HISTORY;
+  if (state.count < BOOT_HISTORY) state.count++;
+  saveNvs();
+
+  Serial.printf("[Boot] #%u (%s), resets: %u brownout, %u watchdog, %u panic%s\n", rtc.current.boot,
+                resetReasonName(reason), getResetCount(ESP_RST_BROWNOUT),
+                getResetCount(ESP_RST_INT_WDT) + getResetCount(ESP_RST_TASK_WDT) + getResetCount(ESP_RST_WDT),
+                getResetCount(ESP_RST_PANIC), nvsOk ? "" : " (NVS unavailable)");
+}
+
+bool BootTimeline::loadNvs() const {
+  if (loaded) return nvsOk;
+  loaded = true;
+  memset(&state, 0, sizeof(state));
+  Preferences prefs;
+  // Read-write: a read-only open fails until the namespace exists.
+  if (!prefs.begin(BOOT_NVS_NAMESPACE, false)) {
+    nvsOk = false;
+    return false;
+  }
+  nvsOk = true;
+  if (prefs.getBytesLength(BOOT_NVS_KEY) == sizeof(state)) {
+    prefs.getBytes(BOOT_NVS_KEY, &state, sizeof(state));
+  }
+  if (state.version != BOOT_NVS_VERSION || state.next >= BOOT_HISTORY) {
+    memset(&state, 0, sizeof(state));  // first boot or older layout
+  }
+  state.version = BOOT_NVS_VERSION;
+  prefs.end();
+  return true;
+}
+
+bool BootTimeline::saveNvs() {
+  if (!nvsOk) return false;
+  Preferences prefs;
+  if (!prefs.begin(BOOT_NVS_NAMESPACE, false)) return false;
+  bool ok = prefs.putBytes(BOOT_NVS_KEY, &state, sizeof(state)) == sizeof(state);
+  prefs.end();
+  if (!ok) Serial.println("[Boot] NVS write failed");
+  return ok;
+}
+
+void BootTimeline::markAt(BootPhase phase, uint32_t ms) {
+  const uint8_t bit = 1 << (int)phase;
+  if (rtc.current.reached & bit) return;
+  rtc.current.phaseMs[(int)phase] = ms;
+  rtc.current.reached |= bit;
+  rtc.current.lastSeenMs = ms;
+  MCP_TRACE_INSTANT(kTraceNames[(int)phase], ms);
+}
+
+void BootTimeline::mark(BootPhase phase) {
+  if (phase == BootPhase::FirstReport) {
+    completeReport(false);
+    return;
+  }
+  markAt(phase, millis());
+}
+
+void BootTimeline::completeReport(bool ok) {
+  if (reached(BootPhase::FirstReport)) return;
+  markAt(BootPhase::FirstReport, millis());
+  rtc.current.reportOk = ok;
+  time_t now = time(nullptr);
+  rtc.current.epoch = now > BOOT_EPOCH_VALID ? (uint32_t)now : 0;
+
+  if (rtc.current.wake == 0 && !rtc.finalized) {
+    if (loadNvs() && state.history[rtc.historySlot].boot == rtc.current.boot) {
+      state.history[rtc.historySlot] = rtc.current;
+      saveNvs();
+    }
+    rtc.finalized = true;
+  }
+  printRecord(Serial, rtc.current);
+}
+
+void BootTimeline::tick() {
+  rtc.current.lastSeenMs = millis();
+}
+
+bool BootTimeline::reached(BootPhase phase) const {
+  return rtc.current.reached & (1 << (int)phase);
+}
+
+const BootRecord& BootTimeline::current() const {
+  return rtc.current;
+}
+
+uint32_t BootTimeline::getResetCount(int reason) const {
+  loadNvs();
+  return state.resets[reasonSlot(reason)];
+}
+
+const char* BootTimeline::phaseName(BootPhase phase) {
+  switch (phase) {
+    case BootPhase::AppStart:
+      return "appStart";
+    case BootPhase::Spiffs:
+      return "spiffs";
+    case BootPhase::Settings:
+      return "settings";
+    case BootPhase::WifiConnect:
+      return "wifiConnect";
+    case BootPhase::Ntp:
+      return "ntp";
+    case BootPhase::Mdns:
+      return "mdns";
+    case BootPhase::FirstReport:
+      return "firstReport";
+    default:
+      return "?";
+  }
+}
+
+const char* BootTimeline::resetReasonName(int reason) {
+  switch (reason) {
+    case ESP_RST_POWERON:
+      return "poweron";
+    case ESP_RST_EXT:
+      return "ext";
+    case ESP_RST_SW:
+      return "sw";
+    case ESP_RST_PANIC:
+      return "panic";
+    case ESP_RST_INT_WDT:
+      return "int_wdt";
+    case ESP_RST_TASK_WDT:
+      return "task_wdt";
+    case ESP_RST_WDT:
+      return "wdt";
+    case ESP_RST_DEEPSLEEP:
+      return "deepsleep";
+    case ESP_RST_BROWNOUT:
+      return "brownout";
+    case ESP_RST_SDIO:
+      return "sdio";
+    case 11:  // ESP_RST_USB (IDF 5)
+      return "usb";
+    case 12:  // ESP_RST_JTAG
+      return "jtag";
+    case 13:  // ESP_RST_EFUSE
+      return "efuse";
+    case 14:  // ESP_RST_PWR_GLITCH
+      return "pwr_glitch";
+    case 15:  // ESP_RST_CPU_LOCKUP
+      return "cpu_lockup";
+    default:
+      return "unknown";
+  }
+}
+
+void BootTimeline::printRecord(Print& out, const BootRecord& r) const {
+  char line[160];
+  int len = snprintf(line, sizeof(line), "[Boot] #%u", r.boot);
+  if (r.wake > 0) len += snprintf(line + len, sizeof(line) - len, " wake %u", r.wake);
+  len += snprintf(line + len, sizeof(line) - len, " (%s):", resetReasonName(r.resetReason));
+  for (int i = 0; i < (int)BootPhase::Count && len < (int)sizeof(line); i++) {
+    if (!(r.reached & (1 << i))) continue;
+    len += snprintf(line + len, sizeof(line) - len, " %s=%u", phaseName((BootPhase)i), r.phaseMs[i]);
+  }
+  if (len < (int)sizeof(line)) snprintf(line + len, sizeof(line) - len, " ms%s", r.reportOk ? "" : " (report failed)");
+  out.println(line);
+}
+
+static void appendRecord(String& json, const BootRecord& r) {
+  char buf[96];
+  snprintf(buf, sizeof(buf), "{\"boot\":%u,\"wake\":%u,\"reset\":\"%s\",\"phasesMs\":{", r.boot, r.wake,
+           BootTimeline::resetReasonName(r.resetReason));
+  json += buf;
+  bool first = true;
+  for (int i = 0; i < (int)BootPhase::Count; i++) {
+    if (!(r.reached & (1 << i))) continue;
+    snprintf(buf, sizeof(buf), "%s\"%s\":%u", first ? "" : ",", BootTimeline::phaseName((BootPhase)i),
+             r.phaseMs[i]);
+    json += buf;
+    first = false;
+  }
+  snprintf(buf, sizeof(buf), "},\"reportOk\":%s,\"lastSeenMs\":%u,\"epoch\":%u}", r.reportOk ? "true" : "false",
+           r.lastSeenMs, r.epoch);
+  json += buf;
+}
+
+static void appendResets(String& json, const uint32_t* resets) {
+  json += "{";
+  bool first = true;
+  for (int i = 0; i < BOOT_REASON_SLOTS; i++) {
+    if (resets[i] == 0) continue;
+    if (!first) json += ",";
+    first = false;
+    json += "\"";
+    json += BootTimeline::resetReasonName(i);
+    json += "\":";
+    json += String(resets[i]);
+  }
+  json += "}";
+}
+
+String BootTimeline::toJson(int limit) const {
+  loadNvs();
+  String json;
+  json.reserve(512 + 200 * (BOOT_HISTORY + BOOT_WAKE_HISTORY));
+  json += "{\"nvs\":";
+  json += nvsOk ? "true" : "false";
+  json += ",\"boots\":";
+  json += String(state.boots);
+  json += ",\"brownouts\":";
+  json += String(state.resets[ESP_RST_BROWNOUT]);
+  json += ",\"watchdogs\":";
+  json += String(state.resets[ESP_RST_INT_WDT] + state.resets[ESP_RST_TASK_WDT] + state.resets[ESP_RST_WDT]);
+  json += ",\"panics\":";
+  json += String(state.resets[ESP_RST_PANIC]);
+  json += ",\"resets\":";
+  appendResets(json, state.resets);
+  json += ",\"resetsSinceRtcLost\":";
+  appendResets(json, rtc.resets);
+  json += ",\"current\":";
+  appendRecord(json, rtc.current);
+
+  // Newest first. The running reset boot is in NVS too; its live copy is
+  // "current".
+  json += ",\"history\":[";
+  int n = 0;
+  for (int i = 1; i <= state.count && n < limit; i++) {
+    const BootRecord& r = state.history[(state.next + BOOT_HISTORY - i) % BOOT_HISTORY];
+    if (n++ > 0) json += ",";
+    appendRecord(json, r.boot == rtc.current.boot && rtc.current.wake == 0 ? rtc.current : r);
+  }
+  json += "],\"wakes\":[";
+  for (int i = 1; i <= rtc.wakeCount; i++) {
+    if (i > 1) json += ",";
+    appendRecord(json, rtc.wakes[(rtc.wakeNext + BOOT_WAKE_HISTORY - i) % BOOT_WAKE_HISTORY]);
+  }
+  json += "]}";
+  return json;
+}
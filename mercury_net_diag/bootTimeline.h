@@ -0,0 +1,106 @@
+/**
+ * bootTimeline.h
+ * Boot timeline and reset history for aranea device.
+ * Marks when each startup phase finished, in esp_timer milliseconds (time
+ * since the app started: ROM and second-stage bootloader run before
+ * esp_timer and are not included; AppStart is the app init time before
+ * setup()). Each record also keeps the reset reason and how long the boot
+ * stayed alive.
+ *
+ * The running boot's record lives in RTC memory, so a boot that dies half way
+ * is still reported (from the next boot) with the phases it reached. Reset
+ * boots and the per-reason reset counters (brownout, watchdogs, panics...)
+ * are kept in NVS: one write when the boot starts, one when the first report
+ * is out. Deep-sleep wakes are only kept in RTC memory; they do not write
+ * flash.
+ */
+
+#ifndef BOOT_TIMELINE_H
+#define BOOT_TIMELINE_H
+
+#include <Arduino.h>
+
+// Reset boots kept in NVS
+#define BOOT_HISTORY 8
+// Deep-sleep wakes kept in RTC memory
+#define BOOT_WAKE_HISTORY 8
+// Reset counters by esp_reset_reason_t (higher reasons count as unknown)
+#define BOOT_REASON_SLOTS 16
+#define BOOT_NVS_NAMESPACE "boot"
+
+enum class BootPhase : uint8_t {
+  AppStart,     // setup() entered
+  Spiffs,       // SPIFFS mounted
+  Settings,     // settingMgr.begin() returned
+  WifiConnect,  // STA connected with an address
+  Ntp,          // time synced
+  Mdns,         // mDNS / NBNS responders started
+  FirstReport,  // first report delivered (or given up on)
+  Count
+};
+
+struct BootRecord {
+  uint32_t boot;            // reset boots since NVS was erased, from 1
+  uint32_t wake;            // deep-sleep wakes since that boot; 0 = the reset boot itself
+  uint8_t resetReason;      // esp_reset_reason_t that started it
+  uint8_t reached;          // bit per BootPhase
+  bool reportOk;            // first report delivered
+  uint8_t reserved;
+  uint32_t phaseMs[(int)BootPhase::Count];
+  uint32_t lastSeenMs;      // uptime when last seen running
+  uint32_t epoch;           // wall clock at the first report, 0 if not synced
+};
+
+class BootTimeline {
+public:
+  BootTimeline();
+
+  // Read the reset reason, settle the previous boot's record and start this
+  // one (marks AppStart). Call first thing in setup().
+  void begin();
+
+  // Record the first time a phase is reached in this boot; later calls are
+  // ignored.
+  void mark(BootPhase phase);
+  // Mark FirstReport: completes the record and, for a reset boot, writes it
+  // to NVS. Once per boot.
+  void completeReport(bool ok);
+
+  // Keep "last seen" current; cheap, call from loop().
+  void tick();
+
+  bool reached(BootPhase phase) const;
+  const BootRecord& current() const;
+  // Lifetime resets with this reason (NVS; read on first use after a wake)
+  uint32_t getResetCount(int reason) const;
+
+  static const char* phaseName(BootPhase phase);
+  static const char* resetReasonName(int reason);
+
+  void printRecord(Print& out, const BootRecord& r) const;
+  // Counters, this boot, the last `limit` reset boots and the recent wakes.
+  String toJson(int limit = BOOT_HISTORY) const;
+
+private:
+  // The NVS blob: lifetime counters and a ring of the last reset boots
+  struct NvsState {
+    uint16_t version;
+    uint8_t next;        // slot of the next reset boot
+    uint8_t count;
+    uint32_t boots;
+    uint32_t resets[BOOT_REASON_SLOTS];
+    BootRecord history[BOOT_HISTORY];
+  };
+
+  bool loadNvs() const;
+  bool saveNvs();
+  void markAt(BootPhase phase, uint32_t ms);
+
+  mutable NvsState state;
+  mutable bool loaded;
+  mutable bool nvsOk;
+};
+
+extern BootTimeline bootTimeline;
+
+#endif // BOOT_TIMELINE_H
@@ -0,0 +1,131 @@
+/**
+ * captivePortal.cpp
+ * AP+STA captive portal fallback for aranea device
+ */
+
+#include "captivePortal.h"
+
+// Global instance
+CaptivePortal captivePortal;
+
+CaptivePortal::CaptivePortal()
+    : active(false), forceRetry(false), startedMs(0), lastRetryMs(0),
+      backoffMs(PORTAL_RETRY_MIN_MS), retryCount(0) {}
+
+bool CaptivePortal::begin(const String& apSsid) {
+  if (active) {
+    return true;
+  }
+  // Keep STA enabled so background retries can run alongside the SoftAP.
+  WiFi.mode(WIFI_AP_STA);
+  const char* pass = strlen(PORTAL_AP_PASS) > 0 ? PORTAL_AP_PASS : nullptr;
+  if (!WiFi.softAP(apSsid.c_str(), pass, PORTAL_AP_CHANNEL)) {
+    Serial.println("[Portal] SoftAP start failed");
+    WiFi.mode(WIFI_STA);
+    return false;
+  }
+
+  // Resolve every name to the portal so any URL the phone opens lands here.
+  dns.setErrorReplyCode(DNSReplyCode::NoError);
+  if (!dns.start(PORTAL_DNS_PORT, "*", WiFi.softAPIP())) {
+    Serial.println("[Portal] DNS responder start failed");
+  }
+
+  ssid = apSsid;
+  active = true;
+  forceRetry = false;
+  startedMs = millis();
+  lastRetryMs = startedMs;
+  backoffMs = PORTAL_RETRY_MIN_MS;
+  retryCount = 0;
+  Serial.printf("[Portal] Started: SSID %s, http://%s/\n", ssid.c_str(),
+                WiFi.softAPIP().toString().c_str());
+  return true;
+}
+
+void CaptivePortal::end() {
+  if (!active) {
+    return;
+  }
+  dns.stop();
+  WiFi.softAPdisconnect(false);
+  WiFi.mode(WIFI_STA);
+  active = false;
+  Serial.printf("[Portal] Stopped after %lu ms, %u STA retries\n", millis() - startedMs, retryCount);
+}
+
+IPAddress CaptivePortal::getIp() const {
+  return active ? WiFi.softAPIP() : IPAddress();
+}
+
+void CaptivePortal::loop() {
+  if (active) {
+    dns.processNextRequest();
+  }
+}
+
+bool CaptivePortal::redirectIfForeign(WebServer& server) {
+  if (!active) {
+    return false;
+  }
+  const String portalHost = WiFi.softAPIP().toString();
+  const String host = server.hostHeader();
+  if (host.length() == 0 || host == portalHost || host.startsWith(portalHost + ":")) {
+    return false;
+  }
+  server.sendHeader("Location", "http://" + portalHost + "/", true);
+  server.sendHeader("Cache-Control", "no-cache");
+  server.send(302, "text/plain", "");
+  return true;
+}
+
+bool CaptivePortal::retryDue() const {
+  if (!active) {
+    return false;
+  }
+  if (forceRetry) {
+    return true;
+  }
+  const unsigned long since = millis() - lastRetryMs;
+  if (WiFi.softAPgetStationNum() > 0) {
+    return since >= PORTAL_RETRY_MAX_MS;
+  }
+  return since >= backoffMs;
+}
+
+void CaptivePortal::retryStarted() {
+  forceRetry = false;
+  retryCount++;
+  Serial.printf("[Portal] STA retry #%u\n", retryCount);
+}
+
+void CaptivePortal::retryFailed() {
+  lastRetryMs = millis();
+  backoffMs = backoffMs >= PORTAL_RETRY_MAX_MS / 2 ? PORTAL_RETRY_MAX_MS : backoffMs * 2;
+  Serial.printf("[Portal] STA retry failed; next in %lu s\n", backoffMs / 1000);
+}
+
+unsigned long CaptivePortal::getUptimeMs() const {
+  return active ? millis() - startedMs : 0;
+}
+
+String CaptivePortal::toJson() const {
+  String json = "{\"active\":";
+  json += active ? "true" : "false";
+  if (active) {
+    json += ",\"ssid\":\"";
+    json += ssid;
+    json += "\",\"ip\":\"";
+    json += WiFi.softAPIP().toString();
+    json += "\",\"uptimeMs\":";
+    json += String(getUptimeMs());
+    json += ",\"stations\":";
+    json += String(WiFi.softAPgetStationNum());
+  }
+  json += ",\"staRetries\":";
+  json += String(retryCount);
+  json += ",\"backoffMs\":";
+  json += String(backoffMs);
+  json += "}";
+  return json;
+}
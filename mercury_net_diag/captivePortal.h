@@ -0,0 +1,76 @@
+/**
+ * captivePortal.h
+ * AP+STA captive portal fallback for aranea device.
+ * When no configured SSID connects, a SoftAP with a wildcard DNS responder
+ * serves the settings page, while STA retries continue in the background with
+ * exponential backoff. The portal is torn down once STA connects.
+ */
+
+#ifndef CAPTIVE_PORTAL_H
+#define CAPTIVE_PORTAL_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <WebServer.h>
+#include <DNSServer.h>
+
+// SoftAP SSID is PORTAL_AP_PREFIX + last 3 MAC bytes; empty pass = open AP
+#define PORTAL_AP_PREFIX "aranea-setup-"
+#define PORTAL_AP_PASS ""
+#define PORTAL_AP_CHANNEL 1
+#define PORTAL_DNS_PORT 53
+
+// Background STA retry: first retry after PORTAL_RETRY_MIN_MS, doubling up to
+// PORTAL_RETRY_MAX_MS. Each SSID gets PORTAL_ATTEMPT_MS per retry.
+#define PORTAL_RETRY_MIN_MS 15000
+#define PORTAL_RETRY_MAX_MS 600000
+#define PORTAL_ATTEMPT_MS 10000
+
+class CaptivePortal {
+public:
+  CaptivePortal();
+
+  // Switch to AP+STA and start the SoftAP and DNS responder.
+  bool begin(const String& apSsid);
+  // Stop DNS and the SoftAP and go back to STA only.
+  void end();
+  bool isActive() const { return active; }
+  IPAddress getIp() const;
+  const String& getSsid() const { return ssid; }
+
+  // Answer pending DNS queries. Call from loop() while active.
+  void loop();
+
+  // OS connectivity checks ask for other hosts (connectivitycheck.gstatic.com,
+  // captive.apple.com, ...). Redirects those to the portal and returns true.
+  bool redirectIfForeign(WebServer& server);
+
+  // ---- Background STA retry ----
+  // A retry is due once the backoff has passed. While a phone is associated
+  // with the SoftAP retries wait up to PORTAL_RETRY_MAX_MS, because the STA
+  // scan makes the SoftAP change channel and drops it.
+  bool retryDue() const;
+  void retryStarted();
+  void retryFailed();
+  // Retry on the next loop() regardless of backoff (e.g. new credentials saved).
+  void retryNow() { forceRetry = true; }
+
+  unsigned long getBackoffMs() const { return backoffMs; }
+  uint32_t getRetryCount() const { return retryCount; }
+  unsigned long getUptimeMs() const;
+  String toJson() const;
+
+private:
+  DNSServer dns;
+  String ssid;
+  bool active;
+  bool forceRetry;
+  unsigned long startedMs;
+  unsigned long lastRetryMs;
+  unsigned long backoffMs;
+  uint32_t retryCount;
+};
+
+extern CaptivePortal captivePortal;
+
+#endif // CAPTIVE_PORTAL_H
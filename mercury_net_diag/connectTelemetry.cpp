@@ -0,0 +1,377 @@
+/**
+ * connectTelemetry.cpp
+ * Wi-Fi join phase telemetry for aranea device
+ */
+
+#include "connectTelemetry.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include <McpTrace.h>
+
+// Global instance
+ConnectTelemetry connectTelemetry;
+
+static JoinFailure failureFromReason(uint8_t reason) {
+  switch (reason) {
+    case WIFI_REASON_NO_AP_FOUND:
+    case 210:  // NO_AP_FOUND_W_COMPATIBLE_SECURITY (IDF 5)
+    case 211:  // NO_AP_FOUND_IN_AUTHMODE_THRESHOLD
+    case 212:  // NO_AP_FOUND_IN_RSSI_THRESHOLD
+      return JoinFailure::Scan;
+    case WIFI_REASON_AUTH_EXPIRE:
+    case WIFI_REASON_AUTH_FAIL:
+    case WIFI_REASON_NOT_AUTHED:
+      return JoinFailure::Auth;
+    case WIFI_REASON_ASSOC_EXPIRE:
+    case WIFI_REASON_ASSOC_TOOMANY:
+    case WIFI_REASON_NOT_ASSOCED:
+    case WIFI_REASON_ASSOC_FAIL:
+      return JoinFailure::Assoc;
+    case WIFI_REASON_MIC_FAILURE:
+    case WIFI_REASON_4WAY_HANDSHAKE_TIMEOUT:
+    case WIFI_REASON_802_1X_AUTH_FAILED:
+    case WIFI_REASON_HANDSHAKE_TIMEOUT:
+      return JoinFailure::Handshake;
+    default:
+      return JoinFailure::Other;
+  }
+}
+
+ConnectTelemetry::ConnectTelemetry()
+    : connectedAtUs(0), gotIpAtUs(0), pendingReasonCount(0), connectedChannel(0),
+      registered(false), active(false), linkUp(false), attemptStartUs(0), hasSuccess(false),
+      attemptCount(0), linkLosses(0) {
+  memset(&current, 0, sizeof(current));
+  memset(history, 0, sizeof(history));
+  memset(&lastOk, 0, sizeof(lastOk));
+  memset(failureCounts, 0, sizeof(failureCounts));
+  memset(stats, 0, sizeof(stats));
+  memset(reasonCodes, 0, sizeof(reasonCodes));
+  memset(reasonCounts, 0, sizeof(reasonCounts));
+}
+
+void ConnectTelemetry::begin() {
+  if (registered) {
+    return;
+  }
+  WiFi.onEvent(onWifiEvent);
+  registered = true;
+}
+
+void ConnectTelemetry::onWifiEvent(arduino_event_id_t event, arduino_event_info_t info) {
+  connectTelemetry.handleEvent(event, info);
+}
+
+// Runs on the Wi-Fi event task: only plain word stores into the pending
+// fields; everything else happens in endAttempt() on the loop task.
+void ConnectTelemetry::handleEvent(arduino_event_id_t event, const arduino_event_info_t& info) {
+  uint32_t at = (uint32_t)(esp_timer_get_time() - attemptStartUs);
+  if (at == 0) at = 1;  // 0 means "not reached"
+  switch (event) {
+    case ARDUINO_EVENT_WIFI_STA_CONNECTED:
+      MCP_TRACE_INSTANT("wifi.connected", info.wifi_sta_connected.channel);
+      linkUp = true;
+      if (!active) break;
+      for (int i = 0; i < 6; i++) connectedBssid[i] = info.wifi_sta_connected.bssid[i];
+      connectedChannel = info.wifi_sta_connected.channel;
+      connectedAtUs = at;
+      break;
+    case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+      MCP_TRACE_INSTANT("wifi.gotIp", 0);
+      if (active) gotIpAtUs = at;
+      break;
+    case ARDUINO_EVENT_WIFI_STA_DISCONNECTED: {
+      const uint8_t reason = info.wifi_sta_disconnected.reason;
+      MCP_TRACE_INSTANT("wifi.disconnected", reason);
+      if (reason == WIFI_REASON_ASSOC_LEAVE) {
+        linkUp = false;  // our own WiFi.disconnect()
+        break;
+      }
+      if (!active && linkUp) linkLosses++;
+      linkUp = false;
+      const uint8_t n = pendingReasonCount;
+      if (n < CONNECT_ATTEMPT_REASONS) pendingReasons[n] = reason;
+      if (n < 255) pendingReasonCount = n + 1;
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+void ConnectTelemetry::countReason(uint8_t reason) {
+  int slot = -1;
+  for (int i = 0; i < CONNECT_REASON_SLOTS; i++) {
+    if (reasonCounts[i] > 0 && reasonCodes[i] == reason) {
+      slot = i;
+      break;
+    }
+    if (slot < 0 && reasonCounts[i] == 0) slot = i;
+  }
+  if (slot < 0) return;  // table full: keep the codes already seen
+  reasonCodes[slot] = reason;
+  reasonCounts[slot]++;
+}
+
+void ConnectTelemetry::record(JoinPhase phase, uint32_t us) {
+  StageStats& s = stats[(int)phase];
+  s.count++;
+  s.totalUs += us;
+  s.lastUs = us;
+  if (us > s.maxUs) s.maxUs = us;
+  s.buckets[LatencyWatchdog::bucketIndex(us)]++;
+}
+
+void ConnectTelemetry::startAttempt(const char* label, bool hinted) {
+  // Reasons that arrived between attempts belong to link losses.
+  const uint8_t pending = pendingReasonCount;
+  for (uint8_t i = 0; i < pending && i < CONNECT_ATTEMPT_REASONS; i++) countReason(pendingReasons[i]);
+
+  memset(&current, 0, sizeof(current));
+  current.seq = ++attemptCount;
+  strncpy(current.label, label, sizeof(current.label) - 1);
+  current.hinted = hinted;
+  connectedAtUs = 0;
+  gotIpAtUs = 0;
+  pendingReasonCount = 0;
+  attemptStartUs = esp_timer_get_time();
+  active = true;
+}
+
+const JoinAttempt& ConnectTelemetry::endAttempt() {
+  if (!active) {
+    return current;
+  }
+  active = false;
+  const uint32_t endUs = (uint32_t)(esp_timer_get_time() - attemptStartUs);
+  const uint32_t linkUs = connectedAtUs;
+  const uint32_t ipUs = gotIpAtUs;
+
+  const uint8_t n = pendingReasonCount;
+  current.reasonCount = n < CONNECT_ATTEMPT_REASONS ? n : CONNECT_ATTEMPT_REASONS;
+  for (uint8_t i = 0; i < current.reasonCount; i++) {
+    current.reasons[i] = pendingReasons[i];
+    countReason(current.reasons[i]);
+  }
+  pendingReasonCount = 0;
+  for (int i = 0; i < 6; i++) current.bssid[i] = connectedBssid[i];
+  current.channel = connectedChannel;
+
+  current.success = ipUs != 0;
+  current.linkMs = linkUs / 1000;
+  if (current.success) {
+    // Static config: GOT_IP can be posted before STA_CONNECTED is handled.
+    const uint32_t linkEndUs = linkUs && linkUs <= ipUs ? linkUs : ipUs;
+    current.dhcpMs = (ipUs - linkEndUs) / 1000;
+    current.totalMs = ipUs / 1000;
+    record(JoinPhase::Link, linkEndUs);
+    record(JoinPhase::Dhcp, ipUs - linkEndUs);
+    record(JoinPhase::Total, ipUs);
+    current.failure = JoinFailure::None;
+  } else {
+    current.totalMs = endUs / 1000;
+    if (linkUs) {
+      record(JoinPhase::Link, linkUs);
+      current.failure = JoinFailure::Dhcp;
+    } else if (current.reasonCount > 0) {
+      current.failure = failureFromReason(current.reasons[current.reasonCount - 1]);
+    } else {
+      current.failure = JoinFailure::Timeout;
+    }
+  }
+  failureCounts[(int)current.failure]++;
+
+  history[(current.seq - 1) % CONNECT_HISTORY] = current;
+  if (current.success) {
+    lastOk = current;
+    hasSuccess = true;
+  }
+  printAttempt(Serial, current);
+  return current;
+}
+
+const JoinAttempt* ConnectTelemetry::lastAttempt() const {
+  if (attemptCount == 0 || (active && attemptCount == 1)) {
+    return nullptr;
+  }
+  const uint32_t seq = active ? attemptCount - 1 : attemptCount;
+  return &history[(seq - 1) % CONNECT_HISTORY];
+}
+
+const char* ConnectTelemetry::phaseName(JoinPhase phase) {
+  switch (phase) {
+    case JoinPhase::Link:
+      return "link";
+    case JoinPhase::Dhcp:
+      return "dhcp";
+    case JoinPhase::Total:
+      return "total";
+    default:
+      return "unknown";
+  }
+}
+
+const char* ConnectTelemetry::failureName(JoinFailure failure) {
+  switch (failure) {
+    case JoinFailure::None:
+      return "ok";
+    case JoinFailure::Scan:
+      return "scan";
+    case JoinFailure::Auth:
+      return "auth";
+    case JoinFailure::Assoc:
+      return "assoc";
+    case JoinFailure::Handshake:
+      return "handshake";
+    case JoinFailure::Dhcp:
+      return "dhcp";
+    case JoinFailure::Timeout:
+      return "timeout";
+    default:
+      return "other";
+  }
+}
+
+const char* ConnectTelemetry::reasonName(uint8_t reason) {
+  switch (reason) {
+    case WIFI_REASON_UNSPECIFIED:
+      return "UNSPECIFIED";
+    case WIFI_REASON_AUTH_EXPIRE:
+      return "AUTH_EXPIRE";
+    case WIFI_REASON_AUTH_LEAVE:
+      return "AUTH_LEAVE";
+    case WIFI_REASON_ASSOC_EXPIRE:
+      return "ASSOC_EXPIRE";
+    case WIFI_REASON_ASSOC_TOOMANY:
+      return "ASSOC_TOOMANY";
+    case WIFI_REASON_NOT_AUTHED:
+      return "NOT_AUTHED";
+    case WIFI_REASON_NOT_ASSOCED:
+      return "NOT_ASSOCED";
+    case WIFI_REASON_MIC_FAILURE:
+      return "MIC_FAILURE";
+    case WIFI_REASON_4WAY_HANDSHAKE_TIMEOUT:
+      return "4WAY_HANDSHAKE_TIMEOUT";
+    case WIFI_REASON_802_1X_AUTH_FAILED:
+      return "802_1X_AUTH_FAILED";
+    case WIFI_REASON_BEACON_TIMEOUT:
+      return "BEACON_TIMEOUT";
+    case WIFI_REASON_NO_AP_FOUND:
+      return "NO_AP_FOUND";
+    case WIFI_REASON_AUTH_FAIL:
+      return "AUTH_FAIL";
+    case WIFI_REASON_ASSOC_FAIL:
+      return "ASSOC_FAIL";
+    case WIFI_REASON_HANDSHAKE_TIMEOUT:
+      return "HANDSHAKE_TIMEOUT";
+    case WIFI_REASON_CONNECTION_FAIL:
+      return "CONNECTION_FAIL";
+    default:
+      return "OTHER";
+  }
+}
+
+void ConnectTelemetry::printAttempt(Print& out, const JoinAttempt& a) const {
+  char line[128];
+  if (a.success) {
+    snprintf(line, sizeof(line),
+             "[Connect] #%u %s%s ch%u: link %u ms + dhcp %u ms = %u ms",
+             a.seq, a.label, a.hinted ? " (hinted)" : "", a.channel, a.linkMs, a.dhcpMs, a.totalMs);
+  } else {
+    const uint8_t last = a.reasonCount ? a.reasons[a.reasonCount - 1] : 0;
+    snprintf(line, sizeof(line), "[Connect] #%u %s%s failed at %s after %u ms (reason %u %s, %u events)",
+             a.seq, a.label, a.hinted ? " (hinted)" : "", failureName(a.failure), a.totalMs, last,
+             a.reasonCount ? reasonName(last) : "-", a.reasonCount);
+  }
+  out.println(line);
+}
+
+void ConnectTelemetry::printSummary(Print& out) const {
+  char line[112];
+  snprintf(line, sizeof(line), "Joins: %u attempts, %u ok, %u link losses", attemptCount,
+           failureCounts[(int)JoinFailure::None], linkLosses);
+  out.println(line);
+  for (int i = 0; i < (int)JoinPhase::Count; i++) {
+    const StageStats& s = stats[i];
+    if (s.count == 0) continue;
+    snprintf(line, sizeof(line), "  %-6s n=%u avg=%u ms max=%u ms last=%u ms", phaseName((JoinPhase)i), s.count,
+             (uint32_t)(s.totalUs / s.count / 1000), s.maxUs / 1000, s.lastUs / 1000);
+    out.println(line);
+  }
+}
+
+static void appendAttempt(String& json, const JoinAttempt& a) {
+  char buf[200];
+  snprintf(buf, sizeof(buf),
+           "{\"seq\":%u,\"label\":\"%s\",\"hinted\":%s,\"ok\":%s,\"failedAt\":\"%s\","
+           "\"bssid\":\"%02X:%02X:%02X:%02X:%02X:%02X\",\"channel\":%u,"
+           "\"linkMs\":%u,\"dhcpMs\":%u,\"totalMs\":%u,\"reasons\":[",
+           a.seq, a.label, a.hinted ? "true" : "false", a.success ? "true" : "false",
+           a.success ? "" : ConnectTelemetry::failureName(a.failure), a.bssid[0], a.bssid[1], a.bssid[2],
+           a.bssid[3], a.bssid[4], a.bssid[5], a.channel, a.linkMs, a.dhcpMs, a.totalMs);
+  json += buf;
+  for (uint8_t i = 0; i < a.reasonCount; i++) {
+    if (i > 0) json += ",";
+    json += String(a.reasons[i]);
+  }
+  json += "]}";
+}
+
+String ConnectTelemetry::toJson() const {
+  String json;
+  json.reserve(1536);
+  json += "{\"attempts\":";
+  json += String(attemptCount);
+  json += ",\"linkLosses\":";
+  json += String(linkLosses);
+  json += ",\"failures\":{";
+  for (int i = 1; i <= (int)JoinFailure::Other; i++) {
+    if (i > 1) json += ",";
+    json += "\"";
+    json += failureName((JoinFailure)i);
+    json += "\":";
+    json += String(failureCounts[i]);
+  }
+  json += "},\"reasons\":{";
+  bool first = true;
+  for (int i = 0; i < CONNECT_REASON_SLOTS; i++) {
+    if (reasonCounts[i] == 0) continue;
+    if (!first) json += ",";
+    first = false;
+    json += "\"";
+    json += String(reasonCodes[i]);
+    json += " ";
+    json += reasonName(reasonCodes[i]);
+    json += "\":";
+    json += String(reasonCounts[i]);
+  }
+  json += "},\"phases\":{";
+  for (int i = 0; i < (int)JoinPhase::Count; i++) {
+    const StageStats& s = stats[i];
+    if (i > 0) json += ",";
+    json += "\"";
+    json += phaseName((JoinPhase)i);
+    json += "\":{\"count\":";
+    json += String(s.count);
+    json += ",\"avgMs\":";
+    json += String(s.count ? (uint32_t)(s.totalUs / s.count / 1000) : 0);
+    json += ",\"maxMs\":";
+    json += String(s.maxUs / 1000);
+    json += ",\"hist\":[";
+    for (int b = 0; b < WATCHDOG_BUCKETS; b++) {
+      if (b > 0) json += ",";
+      json += String(s.buckets[b]);
+    }
+    json += "]}";
+  }
+  json += "},\"recent\":[";
+  // Oldest first
+  const uint32_t done = active ? attemptCount - 1 : attemptCount;
+  const uint32_t from = done > CONNECT_HISTORY ? done - CONNECT_HISTORY + 1 : 1;
+  for (uint32_t seq = from; seq <= done; seq++) {
+    if (seq > from) json += ",";
+    appendAttempt(json, history[(seq - 1) % CONNECT_HISTORY]);
+  }
+  json += "]}";
+  return json;
+}
@@ -0,0 +1,121 @@
+/**
+ * connectTelemetry.h
+ * Wi-Fi join phase telemetry for aranea device.
+ * Timestamps the STA and IP events of every join attempt with esp_timer and
+ * keeps per-phase histograms, the disconnect reasons of each attempt and the
+ * phase a failed attempt stopped in.
+ *
+ * ESP-IDF posts no event between scan, authentication, association and the
+ * 4-way handshake: STA_CONNECTED arrives once the keys are installed. Those
+ * steps are timed together as "link"; on failure the disconnect reason
+ * tells which of them failed.
+ */
+
+#ifndef CONNECT_TELEMETRY_H
+#define CONNECT_TELEMETRY_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include "latencyWatchdog.h"
+
+// Join attempts kept for /api/status and the serial summary
+#define CONNECT_HISTORY 8
+// Disconnect reasons remembered per attempt
+#define CONNECT_ATTEMPT_REASONS 4
+// Distinct reason codes counted across attempts
+#define CONNECT_REASON_SLOTS 12
+
+enum class JoinPhase : uint8_t {
+  Link,   // WiFi.begin() -> STA_CONNECTED (scan + auth + assoc + 4-way handshake)
+  Dhcp,   // STA_CONNECTED -> GOT_IP (near zero with a static lease)
+  Total,  // WiFi.begin() -> GOT_IP
+  Count
+};
+
+// Where a failed attempt stopped
+enum class JoinFailure : uint8_t {
+  None,
+  Scan,       // SSID / BSSID not found
+  Auth,
+  Assoc,
+  Handshake,  // 4-way handshake: usually a wrong password
+  Dhcp,       // link up but no address
+  Timeout,    // no event at all within the attempt budget
+  Other
+};
+
+struct JoinAttempt {
+  uint32_t seq;
+  char label[8];              // credential label: main / alt / dev / fast
+  uint8_t bssid[6];           // from STA_CONNECTED (zero if never connected)
+  uint8_t channel;
+  bool hinted;                // BSSID / channel hint given, no scan
+  bool success;
+  JoinFailure failure;
+  uint32_t linkMs;            // 0 = not reached
+  uint32_t dhcpMs;
+  uint32_t totalMs;           // to GOT_IP, or to the end of a failed attempt
+  uint8_t reasons[CONNECT_ATTEMPT_REASONS];
+  uint8_t reasonCount;
+};
+
+class ConnectTelemetry {
+public:
+  ConnectTelemetry();
+
+  // Register the Wi-Fi event handler. Call once, before the first join.
+  void begin();
+
+  // Bracket one join attempt (WiFi.begin() up to success or giving up).
+  void startAttempt(const char* label, bool hinted = false);
+  const JoinAttempt& endAttempt();
+  bool inAttempt() const { return active; }
+
+  const JoinAttempt* lastAttempt() const;
+  const JoinAttempt* lastSuccess() const { return hasSuccess ? &lastOk : nullptr; }
+  const StageStats& getStats(JoinPhase phase) const { return stats[(int)phase]; }
+  uint32_t getAttemptCount() const { return attemptCount; }
+  uint32_t getLinkLossCount() const { return linkLosses; }
+
+  static const char* phaseName(JoinPhase phase);
+  static const char* failureName(JoinFailure failure);
+  static const char* reasonName(uint8_t reason);
+
+  void printAttempt(Print& out, const JoinAttempt& a) const;
+  void printSummary(Print& out) const;
+  String toJson() const;
+
+private:
+  static void onWifiEvent(arduino_event_id_t event, arduino_event_info_t info);
+  void handleEvent(arduino_event_id_t event, const arduino_event_info_t& info);
+  void countReason(uint8_t reason);
+  void record(JoinPhase phase, uint32_t us);
+
+  // Written from the Wi-Fi event task; 32-bit offsets from attemptStartUs so
+  // every store is a single word.
+  volatile uint32_t connectedAtUs;
+  volatile uint32_t gotIpAtUs;
+  volatile uint8_t pendingReasons[CONNECT_ATTEMPT_REASONS];
+  volatile uint8_t pendingReasonCount;
+  volatile uint8_t connectedBssid[6];
+  volatile uint8_t connectedChannel;
+
+  bool registered;
+  bool active;
+  bool linkUp;
+  int64_t attemptStartUs;
+  JoinAttempt current;
+  JoinAttempt history[CONNECT_HISTORY];
+  JoinAttempt lastOk;
+  bool hasSuccess;
+  uint32_t attemptCount;
+  uint32_t failureCounts[(int)JoinFailure::Other + 1];
+  uint32_t linkLosses;  // disconnects outside an attempt (beacon loss, AP kick, ...)
+  StageStats stats[(int)JoinPhase::Count];
+  uint8_t reasonCodes[CONNECT_REASON_SLOTS];
+  uint32_t reasonCounts[CONNECT_REASON_SLOTS];
+};
+
+extern ConnectTelemetry connectTelemetry;
+
+#endif // CONNECT_TELEMETRY_H
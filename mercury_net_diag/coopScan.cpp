@@ -0,0 +1,357 @@
+/**
+ * coopScan.cpp
+ * Cooperative AP scanning for aranea device
+ */
+
+#include "coopScan.h"
+
+// Global instance
+CoopScan coopScan;
+
+namespace {
+
+const uint8_t kMagic[3] = {'A', 'R', 0x01};
+const uint8_t kTypeHello = 'H';
+const uint8_t kTypeResults = 'R';
+const size_t kIdLen = 20;
+const size_t kHeaderLen = 4 + kIdLen;
+const size_t kApRecordMin = 6 + 1 + 1 + 1;  // bssid, rssi, auth, ssid length
+
+// Packets handled per loop() call; the rest waits in the socket
+const uint8_t kMaxPacketsPerLoop = 8;
+
+bool channelInMask(uint16_t mask, uint8_t ch) { return (mask >> ch) & 1; }
+
+// Peer IDs come from unauthenticated multicast and end up unescaped in the
+// /api/status JSON and the serial log, so only a LacisID's characters
+// (digits and the MAC's upper-case hex) are accepted.
+bool isLacisId(const uint8_t* id) {
+  for (size_t i = 0; i < kIdLen; i++) {
+    if (!((id[i] >= '0' && id[i] <= '9') || (id[i] >= 'A' && id[i] <= 'F'))) return false;
+  }
+  return true;
+}
+
+String channelList(uint16_t mask) {
+  String list = "[";
+  bool first = true;
+  for (uint8_t ch = 1; ch <= COOP_CHANNELS; ch++) {
+    if (!channelInMask(mask, ch)) continue;
+    if (!first) list += ",";
+    first = false;
+    list += String(ch);
+  }
+  return list + "]";
+}
+
+}  // namespace
+
+CoopScan::CoopScan()
+    : active(false), selfId(), peers(), peerCount(0), channels(), aps(), apTotal(0), scratch(), lastHelloMs(0),
+      sentPackets(0), receivedPackets(0), badPackets(0), channelsScanned(0), channelsReused(0) {}
+
+bool CoopScan::begin(const String& lacisId) {
+  end();
+  if (lacisId.length() != kIdLen) return false;
+  if (!udp.beginMulticast(IPAddress(COOP_GROUP), COOP_PORT)) {
+    Serial.println("[COOP] Cannot join the multicast group");
+    return false;
+  }
+  memcpy(selfId, lacisId.c_str(), kIdLen);
+  selfId[kIdLen] = '\0';
+  active = true;
+  sendHello();
+  Serial.printf("[COOP] Joined %s:%d as %s\n", IPAddress(COOP_GROUP).toString().c_str(), COOP_PORT, selfId);
+  return true;
+}
+
+void CoopScan::end() {
+  if (active) udp.stop();
+  active = false;
+  peerCount = 0;
+  apTotal = 0;
+  memset(channels, 0, sizeof(channels));
+}
+
+void CoopScan::sendHello() {
+  uint8_t pkt[kHeaderLen];
+  memcpy(pkt, kMagic, 3);
+  pkt[3] = kTypeHello;
+  memcpy(pkt + 4, selfId, kIdLen);
+  if (udp.beginMulticastPacket()) {
+    udp.write(pkt, sizeof(pkt));
+    if (udp.endPacket()) sentPackets++;
+  }
+  lastHelloMs = millis();
+}
+
+void CoopScan::loop() {
+  if (!active) return;
+  for (uint8_t i = 0; i < kMaxPacketsPerLoop; i++) {
+    int len = udp.parsePacket();
+    if (len <= 0) break;
+    uint8_t pkt[COOP_PACKET_MAX];
+    size_t n = udp.read(pkt, sizeof(pkt) < (size_t)len ? sizeof(pkt) : (size_t)len);
+    handlePacket(pkt, n);
+  }
+  dropStalePeers();
+  if (millis() - lastHelloMs >= COOP_HELLO_MS) sendHello();
+}
+
+CoopScan::Peer* CoopScan::touchPeer(const char* id) {
+  const unsigned long now = millis();
+  for (uint8_t i = 0; i < peerCount; i++) {
+    if (memcmp(peers[i].id, id, kIdLen) == 0) {
+      peers[i].lastSeenMs = now;
+      peers[i].packets++;
+      return &peers[i];
+    }
+  }
+  if (peerCount >= COOP_MAX_PEERS) return nullptr;
+  Peer& p = peers[peerCount++];
+  memcpy(p.id, id, kIdLen);
+  p.id[kIdLen] = '\0';
+  p.lastSeenMs = now;
+  p.packets = 1;
+  Serial.printf("[COOP] Peer %s joined (%u members)\n", p.id, memberCount());
+  // Answer a newcomer at once so it splits the band with us from its first
+  // scan instead of after our next periodic HELLO.
+  if (now - lastHelloMs > 1000) sendHello();
+  return &p;
+}
+
+void CoopScan::dropStalePeers() {
+  const unsigned long now = millis();
+  for (uint8_t i = 0; i < peerCount;) {
+    if (now - peers[i].lastSeenMs <= COOP_PEER_TIMEOUT_MS) {
+      i++;
+      continue;
+    }
+    Serial.printf("[COOP] Peer %s timed out\n", peers[i].id);
+    peers[i] = peers[--peerCount];
+  }
+}
+
+void CoopScan::handlePacket(const uint8_t* pkt, size_t len) {
+  if (len < kHeaderLen || memcmp(pkt, kMagic, 3) != 0 || (pkt[3] != kTypeHello && pkt[3] != kTypeResults) ||
+      !isLacisId(pkt + 4)) {
+    badPackets++;
+    return;
+  }
+  char id[kIdLen + 1];
+  memcpy(id, pkt + 4, kIdLen);
+  id[kIdLen] = '\0';
+  if (memcmp(id, selfId, kIdLen) == 0) return;  // our own, looped back
+  receivedPackets++;
+  touchPeer(id);
+  if (pkt[3] != kTypeResults) return;
+
+  // A section is stored once it has parsed whole; a truncated or malformed
+  // one ends the packet and leaves its channel as it was.
+  CoopAp* records = scratch;
+  size_t pos = kHeaderLen;
+  const unsigned long now = millis();
+  while (pos + 2 <= len) {
+    const uint8_t ch = pkt[pos];
+    const uint8_t count = pkt[pos + 1];
+    pos += 2;
+    if (ch < 1 || ch > COOP_CHANNELS) {
+      badPackets++;
+      return;
+    }
+    size_t stored = 0;
+    for (uint8_t k = 0; k < count; k++) {
+      if (pos + kApRecordMin > len) {
+        badPackets++;
+        return;
+      }
+      const uint8_t ssidLen = pkt[pos + 8];
+      if (ssidLen > 32 || pos + kApRecordMin + ssidLen > len) {
+        badPackets++;
+        return;
+      }
+      if (stored < COOP_MAX_APS) {
+        CoopAp& ap = records[stored++];
+        memcpy(ap.bssid, pkt + pos, 6);
+        ap.rssi = (int8_t)pkt[pos + 6];
+        ap.auth = pkt[pos + 7];
+        memcpy(ap.ssid, pkt + pos + kApRecordMin, ssidLen);
+        ap.ssid[ssidLen] = '\0';
+        ap.channel = ch;
+      }
+      pos += kApRecordMin + ssidLen;
+    }
+    storeChannel(ch, records, stored);
+    Channel& c = channels[ch];
+    c.valid = true;
+    c.self = false;
+    memcpy(c.by, id, kIdLen + 1);
+    c.atMs = now;
+  }
+  sortTable();
+}
+
+void CoopScan::storeChannel(uint8_t channel, const CoopAp* records, size_t count) {
+  size_t kept = 0;
+  for (size_t i = 0; i < apTotal; i++) {
+    if (aps[i].channel != channel) aps[kept++] = aps[i];
+  }
+  apTotal = kept;
+  // When the table is full a stronger AP replaces the weakest one
+  for (size_t i = 0; i < count; i++) {
+    if (apTotal < COOP_MAX_APS) {
+      aps[apTotal++] = records[i];
+      continue;
+    }
+    size_t weakest = 0;
+    for (size_t j = 1; j < apTotal; j++) {
+      if (aps[j].rssi < aps[weakest].rssi) weakest = j;
+    }
+    if (aps[weakest].rssi < records[i].rssi) aps[weakest] = records[i];
+  }
+}
+
+void CoopScan::sortTable() {
+  for (size_t i = 1; i < apTotal; i++) {
+    CoopAp ap = aps[i];
+    size_t j = i;
+    for (; j > 0 && aps[j - 1].rssi < ap.rssi; j--) aps[j] = aps[j - 1];
+    aps[j] = ap;
+  }
+}
+
+uint16_t CoopScan::shareMask() const {
+  // Our position among all members in LacisID order
+  uint8_t index = 0;
+  for (uint8_t i = 0; i < peerCount; i++) {
+    if (memcmp(peers[i].id, selfId, kIdLen) < 0) index++;
+  }
+  const uint8_t members = memberCount();
+  uint16_t mask = 0;
+  for (uint8_t ch = 1; ch <= COOP_CHANNELS; ch++) {
+    if ((ch - 1) % members == index) mask |= 1u << ch;
+  }
+  return mask;
+}
+
+uint8_t CoopScan::scan(uint32_t maxAgeMs) {
+  if (!active) return 0;
+  loop();  // results that came in since the last call
+  const unsigned long now = millis();
+  uint16_t todo = shareMask();
+  for (uint8_t ch = 1; ch <= COOP_CHANNELS; ch++) {
+    const Channel& c = channels[ch];
+    if (!c.valid || now - c.atMs > maxAgeMs) todo |= 1u << ch;
+  }
+
+  uint8_t scanned = 0;
+  CoopAp* records = scratch;
+  for (uint8_t ch = 1; ch <= COOP_CHANNELS; ch++) {
+    if (!channelInMask(todo, ch)) continue;
+    int16_t n = WiFi.scanNetworks(/*async=*/false, /*show_hidden=*/true, /*passive=*/false, COOP_SCAN_MS_PER_CHAN, ch);
+    size_t count = 0;
+    for (int16_t i = 0; i < n && count < COOP_MAX_APS; i++) {
+      const wifi_ap_record_t* rec = static_cast<const wifi_ap_record_t*>(WiFi.getScanInfoByIndex(i));
+      if (!rec) break;
+      CoopAp& ap = records[count++];
+      memcpy(ap.bssid, rec->bssid, 6);
+      memcpy(ap.ssid, rec->ssid, sizeof(ap.ssid));  // both 33 bytes, NUL-terminated
+      ap.ssid[32] = '\0';
+      ap.channel = ch;
+      ap.rssi = rec->rssi;
+      ap.auth = (uint8_t)rec->authmode;
+    }
+    WiFi.scanDelete();
+    // No result (n < 0) is shared as an empty channel as well; left out, it
+    // would look stale to every member and all of them would rescan it.
+    storeChannel(ch, records, count);
+    Channel& c = channels[ch];
+    c.valid = true;
+    c.self = true;
+    c.by[0] = '\0';
+    c.atMs = millis();
+    scanned++;
+  }
+  channelsScanned += scanned;
+  channelsReused += COOP_CHANNELS - scanned;
+  sendResults(todo);
+  sortTable();
+  return scanned;
+}
+
+void CoopScan::sendResults(uint16_t channelMask) {
+  uint8_t pkt[COOP_PACKET_MAX];
+  memcpy(pkt, kMagic, 3);
+  pkt[3] = kTypeResults;
+  memcpy(pkt + 4, selfId, kIdLen);
+  size_t len = kHeaderLen;
+
+  for (uint8_t ch = 1; ch <= COOP_CHANNELS; ch++) {
+    if (!channelInMask(channelMask, ch)) continue;
+    // A section never spans packets: flush first when it may not fit
+    size_t sectionMax = 2;
+    for (size_t i = 0; i < apTotal; i++) {
+      if (aps[i].channel == ch) sectionMax += kApRecordMin + strlen(aps[i].ssid);
+    }
+    if (len + sectionMax > sizeof(pkt) && len > kHeaderLen) {
+      if (udp.beginMulticastPacket()) {
+        udp.write(pkt, len);
+        if (udp.endPacket()) sentPackets++;
+      }
+      len = kHeaderLen;
+    }
+    const size_t countPos = len;
+    pkt[len++] = ch;
+    pkt[len++] = 0;
+    for (size_t i = 0; i < apTotal; i++) {
+      const CoopAp& ap = aps[i];
+      const size_t ssidLen = strlen(ap.ssid);
+      if (ap.channel != ch || len + kApRecordMin + ssidLen > sizeof(pkt) || pkt[countPos + 1] == 255) continue;
+      memcpy(pkt + len, ap.bssid, 6);
+      pkt[len + 6] = (uint8_t)ap.rssi;
+      pkt[len + 7] = ap.auth;
+      pkt[len + 8] = (uint8_t)ssidLen;
+      memcpy(pkt + len + kApRecordMin, ap.ssid, ssidLen);
+      len += kApRecordMin + ssidLen;
+      pkt[countPos + 1]++;
+    }
+  }
+  if (len > kHeaderLen && udp.beginMulticastPacket()) {
+    udp.write(pkt, len);
+    if (udp.endPacket()) sentPackets++;
+  }
+  lastHelloMs = millis();  // a result packet announces us as well
+}
+
+String CoopScan::toJson() const {
+  const unsigned long now = millis();
+  String json = "{\"active\":";
+  json += active ? "true" : "false";
+  if (!active) return json + "}";
+  json += ",\"members\":" + String(memberCount());
+  json += ",\"share\":" + channelList(shareMask());
+  json += ",\"peers\":[";
+  for (uint8_t i = 0; i < peerCount; i++) {
+    if (i > 0) json += ",";
+    json += "{\"id\":\"" + String(peers[i].id) + "\",\"ageMs\":" + String(now - peers[i].lastSeenMs);
+    json += ",\"packets\":" + String(peers[i].packets) + "}";
+  }
+  json += "],\"channels\":[";
+  for (uint8_t ch = 1; ch <= COOP_CHANNELS; ch++) {
+    if (ch > 1) json += ",";
+    const Channel& c = channels[ch];
+    if (!c.valid) {
+      json += "null";
+      continue;
+    }
+    json += "{\"ch\":" + String(ch) + ",\"ageMs\":" + String(now - c.atMs);
+    json += ",\"by\":\"" + String(c.self ? "self" : c.by) + "\"}";
+  }
+  json += "],\"aps\":" + String((unsigned)apTotal);
+  json += ",\"scanned\":" + String(channelsScanned);
+  json += ",\"reused\":" + String(channelsReused);
+  json += ",\"sent\":" + String(sentPackets);
+  json += ",\"received\":" + String(receivedPackets);
+  json += ",\"bad\":" + String(badPackets) + "}";
+  return json;
+}
@@ -0,0 +1,122 @@
+/**
+ * coopScan.h
+ * Cooperative AP scanning between aranea devices on the same LAN.
+ * A full-band scan keeps the radio off the AP's channel for ~4 s (13
+ * channels x 300 ms), once per report on every device. With this mode on,
+ * devices find each other over UDP multicast (a HELLO every COOP_HELLO_MS),
+ * split channels 1-13 between them by LacisID order - member i of n scans
+ * the channels c with (c - 1) % n == i - and multicast what they found, so
+ * each one assembles the whole band from its own share and the others'.
+ *
+ * Results are kept per channel with the time they arrived. A scan uses a
+ * peer's channel while it is younger than the given age and scans it itself
+ * otherwise, so a missing, silent or just-booted peer (or a lost packet)
+ * costs airtime, not coverage.
+ *
+ * Packets: "AR" 0x01, type ('H' hello / 'R' results), the 20-character
+ * LacisID, then for 'R' one section per channel: channel, AP count, and per
+ * AP BSSID[6], RSSI, auth mode, SSID length, SSID. Devices ignore their own
+ * packets (lwIP loops multicast back to the sender) and count packets whose
+ * ID has anything but digits and A-F as bad.
+ */
+
+#ifndef COOP_SCAN_H
+#define COOP_SCAN_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <WiFiUdp.h>
+
+// Multicast group and port shared by all devices of a site
+#define COOP_GROUP 239, 255, 77, 1
+#define COOP_PORT 47990
+
+// HELLO period; a peer is dropped after COOP_PEER_TIMEOUT_MS without a packet
+#define COOP_HELLO_MS 30000
+#define COOP_PEER_TIMEOUT_MS 95000
+
+#define COOP_MAX_PEERS 20
+#define COOP_MAX_APS 40      // merged table over all channels
+#define COOP_CHANNELS 13
+#define COOP_SCAN_MS_PER_CHAN 300  // as WiFi.scanNetworks() uses by default
+#define COOP_PACKET_MAX 1400
+
+struct CoopAp {
+  uint8_t bssid[6];
+  char ssid[33];
+  uint8_t channel;
+  int8_t rssi;
+  uint8_t auth;  // wifi_auth_mode_t
+};
+
+class CoopScan {
+public:
+  CoopScan();
+
+  // Join the group and announce this device. Call once the STA has an IP.
+  bool begin(const String& lacisId);
+  void end();
+  bool isActive() const { return active; }
+
+  // Take in HELLOs and results, send the periodic HELLO. Call from loop().
+  void loop();
+
+  // Scan this device's share plus every channel without a result younger
+  // than maxAgeMs, multicast what was scanned, and rebuild the merged table.
+  // Returns the number of channels scanned here.
+  uint8_t scan(uint32_t maxAgeMs);
+
+  // Merged table, strongest first
+  size_t apCount() const { return apTotal; }
+  const CoopAp& ap(size_t i) const { return aps[i]; }
+
+  uint8_t memberCount() const { return peerCount + 1; }
+  // Channels this device scans with the current members (bit c = channel c)
+  uint16_t shareMask() const;
+
+  String toJson() const;
+
+private:
+  struct Peer {
+    char id[21];
+    unsigned long lastSeenMs;
+    uint32_t packets;
+  };
+
+  struct Channel {
+    bool valid;
+    bool self;           // scanned here (else by `by`)
+    char by[21];
+    unsigned long atMs;  // millis() when scanned or received
+  };
+
+  WiFiUDP udp;
+  bool active;
+  char selfId[21];
+  Peer peers[COOP_MAX_PEERS];
+  uint8_t peerCount;
+  Channel channels[COOP_CHANNELS + 1];  // index = channel number
+  CoopAp aps[COOP_MAX_APS];
+  size_t apTotal;
+  CoopAp scratch[COOP_MAX_APS];  // one channel being parsed or scanned (off the loop task's stack)
+  unsigned long lastHelloMs;
+
+  uint32_t sentPackets;
+  uint32_t receivedPackets;
+  uint32_t badPackets;
+  uint32_t channelsScanned;  // by this device, since begin()
+  uint32_t channelsReused;   // taken from peers
+
+  void sendHello();
+  void handlePacket(const uint8_t* pkt, size_t len);
+  Peer* touchPeer(const char* id);
+  void dropStalePeers();
+  // Replace the APs of `channel` with records[0..count)
+  void storeChannel(uint8_t channel, const CoopAp* records, size_t count);
+  void sortTable();
+  void sendResults(uint16_t channelMask);
+};
+
+extern CoopScan coopScan;
+
+#endif // COOP_SCAN_H
@@ -0,0 +1,263 @@
+/**
+ * diagJobs.cpp
+ * On-demand diagnostics jobs for aranea device
+ */
+
+#include "diagJobs.h"
+
+// Global instance
+DiagJobs diagJobs;
+
+namespace {
+
+const char* const kTypeNames[] = {"scan", "probe", "dns"};
+
+uint8_t countBits(uint8_t mask) {
+  uint8_t n = 0;
+  for (; mask; mask &= mask - 1) n++;
+  return n;
+}
+
+DiagType lowestType(uint8_t mask) {
+  uint8_t t = 0;
+  while (!(mask & 1)) {
+    mask >>= 1;
+    t++;
+  }
+  return (DiagType)t;
+}
+
+String typesName(uint8_t types) {
+  if (types == DIAG_ALL) return "all";
+  String name;
+  for (uint8_t t = 0; t < (uint8_t)DiagType::Count; t++) {
+    if (!(types & (1u << t))) continue;
+    if (name.length() > 0) name += ",";
+    name += kTypeNames[t];
+  }
+  return name;
+}
+
+const char* stateName(DiagState state) {
+  switch (state) {
+    case DiagState::Queued:
+      return "queued";
+    case DiagState::Running:
+      return "running";
+    case DiagState::Done:
+      return "done";
+    default:
+      return "free";
+  }
+}
+
+}  // namespace
+
+DiagJobs::DiagJobs()
+    : jobs(), results(), step(nullptr), nextId(1), running(-1), current(DiagType::Scan), stepIndex(0),
+      typeStartMs(0), runs(0), cacheHits(0), coalesced(0), rejected(0) {}
+
+uint8_t DiagJobs::parseTypes(const String& name) {
+  if (name == "all") return DIAG_ALL;
+  // Also a comma-separated list: "scan,dns"
+  uint8_t types = 0;
+  int start = 0;
+  while (start <= (int)name.length()) {
+    int end = name.indexOf(',', start);
+    if (end < 0) end = name.length();
+    String part = name.substring(start, end);
+    uint8_t bit = 0;
+    for (uint8_t t = 0; t < (uint8_t)DiagType::Count; t++) {
+      if (part == kTypeNames[t]) bit = 1u << t;
+    }
+    if (bit == 0) return 0;
+    types |= bit;
+    start = end + 1;
+  }
+  return types;
+}
+
+const char* DiagJobs::typeName(DiagType type) {
+  return type < DiagType::Count ? kTypeNames[(int)type] : "?";
+}
+
+uint8_t DiagJobs::freshTypes(uint8_t types, uint32_t maxAgeMs) const {
+  if (maxAgeMs == 0) return 0;
+  const unsigned long now = millis();
+  uint8_t fresh = 0;
+  for (uint8_t t = 0; t < (uint8_t)DiagType::Count; t++) {
+    const Result& r = results[t];
+    if ((types & (1u << t)) && r.valid && now - r.atMs <= maxAgeMs) fresh |= 1u << t;
+  }
+  return fresh;
+}
+
+int DiagJobs::findJob(uint32_t id) const {
+  if (id == 0) return -1;
+  for (int i = 0; i < DIAG_JOBS; i++) {
+    if (jobs[i].state != DiagState::Free && jobs[i].id == id) return i;
+  }
+  return -1;
+}
+
+uint32_t DiagJobs::run(uint8_t types, uint32_t maxAgeMs, bool& attached) {
+  attached = false;
+  types &= DIAG_ALL;
+  if (types == 0) return 0;
+  const uint8_t fresh = freshTypes(types, maxAgeMs);
+
+  // The same work already queued or running: hand out that job.
+  if (fresh != types) {
+    for (Job& j : jobs) {
+      if ((j.state == DiagState::Queued || j.state == DiagState::Running) && j.types == types) {
+        j.attached++;
+        coalesced++;
+        attached = true;
+        return j.id;
+      }
+    }
+  }
+
+  // A free slot, else the oldest finished job.
+  int slot = -1;
+  for (int i = 0; i < DIAG_JOBS && slot < 0; i++) {
+    if (jobs[i].state == DiagState::Free) slot = i;
+  }
+  if (slot < 0) {
+    for (int i = 0; i < DIAG_JOBS; i++) {
+      if (jobs[i].state == DiagState::Done && (slot < 0 || jobs[i].id < jobs[slot].id)) slot = i;
+    }
+  }
+  if (slot < 0) {
+    rejected++;
+    return 0;
+  }
+
+  const unsigned long now = millis();
+  Job& j = jobs[slot];
+  j.id = nextId++;
+  if (nextId == 0) nextId = 1;
+  j.types = types;
+  j.pending = types & ~fresh;
+  j.cached = j.pending == 0;
+  j.state = j.cached ? DiagState::Done : DiagState::Queued;
+  j.maxAgeMs = maxAgeMs;
+  j.attached = 0;
+  j.createdMs = now;
+  j.doneMs = j.cached ? now : 0;
+  cacheHits += countBits(fresh);
+  return j.id;
+}
+
+bool DiagJobs::startNext() {
+  for (;;) {
+    int next = -1;
+    for (int i = 0; i < DIAG_JOBS; i++) {
+      if (jobs[i].state == DiagState::Queued && (next < 0 || jobs[i].id < jobs[next].id)) next = i;
+    }
+    if (next < 0) return false;
+
+    // What the jobs before this one did may be fresh enough now.
+    Job& j = jobs[next];
+    const uint8_t fresh = freshTypes(j.pending, j.maxAgeMs);
+    cacheHits += countBits(fresh);
+    j.pending &= ~fresh;
+    if (j.pending == 0) {
+      j.state = DiagState::Done;
+      j.doneMs = millis();
+      continue;
+    }
+    j.state = DiagState::Running;
+    running = next;
+    current = lowestType(j.pending);
+    stepIndex = 0;
+    typeStartMs = millis();
+    partial = "";
+    return true;
+  }
+}
+
+void DiagJobs::loop() {
+  if (step == nullptr) return;
+  if (running < 0 && !startNext()) return;
+
+  Job& j = jobs[running];
+  if (!step(current, stepIndex++, partial)) return;
+
+  Result& r = results[(int)current];
+  r.valid = true;
+  r.atMs = millis();
+  r.tookMs = r.atMs - typeStartMs;
+  r.json = partial;
+  partial = "";
+  runs++;
+
+  j.pending &= ~DIAG_BIT(current);
+  if (j.pending == 0) {
+    j.state = DiagState::Done;
+    j.doneMs = millis();
+    running = -1;
+    return;
+  }
+  current = lowestType(j.pending);
+  stepIndex = 0;
+  typeStartMs = millis();
+}
+
+bool DiagJobs::busy() const {
+  for (const Job& j : jobs) {
+    if (j.state == DiagState::Queued || j.state == DiagState::Running) return true;
+  }
+  return false;
+}
+
+DiagState DiagJobs::getState(uint32_t id) const {
+  int i = findJob(id);
+  return i < 0 ? DiagState::Free : jobs[i].state;
+}
+
+String DiagJobs::jobJson(uint32_t id) const {
+  int i = findJob(id);
+  if (i < 0) return "";
+  const Job& j = jobs[i];
+  const unsigned long now = millis();
+  String json = "{\"id\":" + String(j.id);
+  json += ",\"type\":\"" + typesName(j.types) + "\"";
+  json += ",\"state\":\"" + String(stateName(j.state)) + "\"";
+  json += ",\"cached\":" + String(j.cached ? "true" : "false");
+  json += ",\"attached\":" + String(j.attached);
+  json += ",\"ageMs\":" + String(now - j.createdMs);
+  if (j.state == DiagState::Done) json += ",\"tookMs\":" + String(j.doneMs - j.createdMs);
+  if (j.state == DiagState::Running) json += ",\"step\":\"" + String(typeName(current)) + "\"";
+  json += ",\"results\":{";
+  bool first = true;
+  for (uint8_t t = 0; t < (uint8_t)DiagType::Count; t++) {
+    const Result& r = results[t];
+    // Types of this job that are done (run by it, or fresh enough when it started)
+    if (!(j.types & (1u << t)) || (j.pending & (1u << t)) || !r.valid) continue;
+    if (!first) json += ",";
+    first = false;
+    json += "\"" + String(kTypeNames[t]) + "\":{\"ageMs\":" + String(now - r.atMs);
+    json += ",\"ms\":" + String(r.tookMs) + ",\"data\":" + r.json + "}";
+  }
+  json += "}}";
+  return json;
+}
+
+String DiagJobs::toJson() const {
+  const unsigned long now = millis();
+  String json = "{\"busy\":";
+  json += busy() ? "true" : "false";
+  json += ",\"runs\":" + String(runs);
+  json += ",\"cacheHits\":" + String(cacheHits);
+  json += ",\"coalesced\":" + String(coalesced);
+  json += ",\"rejected\":" + String(rejected);
+  json += ",\"ageMs\":{";
+  for (uint8_t t = 0; t < (uint8_t)DiagType::Count; t++) {
+    if (t > 0) json += ",";
+    const Result& r = results[t];
+    json += "\"" + String(kTypeNames[t]) + "\":" + (r.valid ? String(now - r.atMs) : String("null"));
+  }
+  json += "}}";
+  return json;
+}
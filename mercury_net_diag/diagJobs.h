@@ -0,0 +1,118 @@
+/**
+ * diagJobs.h
+ * On-demand diagnostics (AP scan, TCP probe, DNS lookup) for aranea device.
+ * /api/diag/run queues a job and answers with its id at once; loop() does
+ * the radio work one step per call (one probe target, one name, one poll of
+ * an async scan), so the web server keeps answering in between.
+ *
+ * Radio work is shared, not repeated:
+ *  - a request for the same types as a queued or running job gets that job's
+ *    id instead of a new one (coalescing);
+ *  - each type's last result is cached with its time. A request with maxAge
+ *    reuses results younger than that and only runs the rest; when nothing is
+ *    left the job is done when it is created. A queued job checks again when
+ *    it starts, so it skips what the job before it has just done.
+ *
+ * The work itself is the sketch's (probe targets, resolver names): it passes
+ * a step function to begin().
+ */
+
+#ifndef DIAG_JOBS_H
+#define DIAG_JOBS_H
+
+#include <Arduino.h>
+
+// Jobs remembered; the oldest finished one is reused for a new job
+#define DIAG_JOBS 4
+
+enum class DiagType : uint8_t {
+  Scan,   // AP scan
+  Probe,  // TCP reachability of the probe targets
+  Dns,    // name resolution
+  Count
+};
+
+// Bit of a type in a job's type mask
+#define DIAG_BIT(type) (1u << (uint8_t)(type))
+#define DIAG_ALL (DIAG_BIT(DiagType::Scan) | DIAG_BIT(DiagType::Probe) | DIAG_BIT(DiagType::Dns))
+
+enum class DiagState : uint8_t {
+  Free,
+  Queued,
+  Running,
+  Done
+};
+
+// One unit of work for `type` (step counts from 0 for each run). Appends the
+// type's JSON result to `result` and returns true once it is complete.
+typedef bool (*DiagStepFn)(DiagType type, uint16_t step, String& result);
+
+class DiagJobs {
+public:
+  DiagJobs();
+
+  void begin(DiagStepFn stepFn) { step = stepFn; }
+
+  // "scan", "probe", "dns" or "all" as a type mask; 0 = unknown
+  static uint8_t parseTypes(const String& name);
+  static const char* typeName(DiagType type);
+
+  // Queue a run of `types`, reusing cached results younger than maxAgeMs
+  // (0 = always run). Returns the job id, 0 when every slot holds a job
+  // that is not done. attached: an identical job was already in flight.
+  uint32_t run(uint8_t types, uint32_t maxAgeMs, bool& attached);
+
+  // Advance the running job by one step; start the next queued one.
+  void loop();
+  // A job is queued or running (the radio is in use).
+  bool busy() const;
+
+  DiagState getState(uint32_t id) const;
+  // The job with the results of its types so far; "" for an unknown id.
+  String jobJson(uint32_t id) const;
+  // Counters and cache ages for /api/status.
+  String toJson() const;
+
+private:
+  struct Job {
+    uint32_t id;
+    uint8_t types;      // asked for
+    uint8_t pending;    // still to run
+    DiagState state;
+    bool cached;        // done from the cache alone
+    uint32_t maxAgeMs;
+    uint16_t attached;  // requests coalesced into this job
+    unsigned long createdMs;
+    unsigned long doneMs;
+  };
+
+  struct Result {
+    bool valid;
+    unsigned long atMs;  // millis() when it completed
+    uint32_t tookMs;
+    String json;
+  };
+
+  Job jobs[DIAG_JOBS];
+  Result results[(int)DiagType::Count];
+  DiagStepFn step;
+  uint32_t nextId;
+  int8_t running;       // index in jobs, -1 = none
+  DiagType current;     // type the running job is on
+  uint16_t stepIndex;
+  unsigned long typeStartMs;
+  String partial;       // result of the type in progress
+
+  uint32_t runs;        // types actually run
+  uint32_t cacheHits;   // types served from the cache
+  uint32_t coalesced;
+  uint32_t rejected;
+
+  uint8_t freshTypes(uint8_t types, uint32_t maxAgeMs) const;
+  int findJob(uint32_t id) const;
+  bool startNext();
+};
+
+extern DiagJobs diagJobs;
+
+#endif // DIAG_JOBS_H
@@ -0,0 +1,201 @@
+/**
+ * latencyWatchdog.cpp
+ * Loop / handler latency watchdog for aranea device
+ */
+
+#include "latencyWatchdog.h"
+#include "esp_timer.h"
+#include <McpTrace.h>
+
+#define DEFAULT_BUDGET_MS 500
+
+// Global instance
+LatencyWatchdog latencyWatchdog;
+
+int LatencyWatchdog::bucketIndex(uint32_t us) {
+  uint32_t ms = us / 1000;
+  int idx = 0;
+  while (ms > 0 && idx < WATCHDOG_BUCKETS - 1) {
+    ms >>= 1;
+    idx++;
+  }
+  return idx;
+}
+
+// Stages also show up as trace spans (MCP_TRACE builds), except handleClient:
+// it runs every loop, mostly idle, and the HTTP handlers carry their own spans.
+LatencyWatchdog::Scope::Scope(Stage stage) : stage(stage), startUs(esp_timer_get_time()) {
+  if (stage != Stage::HandleClient) MCP_TRACE_BEGIN(stageName(stage));
+}
+
+LatencyWatchdog::Scope::~Scope() {
+  latencyWatchdog.record(stage, (uint32_t)(esp_timer_get_time() - startUs));
+  if (stage != Stage::HandleClient) MCP_TRACE_END(stageName(stage));
+}
+
+LatencyWatchdog::LatencyWatchdog()
+    : iterationStartUs(0), inIteration(false), budgetMs(DEFAULT_BUDGET_MS), overrunCount(0) {
+  memset(stats, 0, sizeof(stats));
+  memset(iterationUs, 0, sizeof(iterationUs));
+  memset(&lastOverrun, 0, sizeof(lastOverrun));
+  memset(&worstOverrun, 0, sizeof(worstOverrun));
+}
+
+void LatencyWatchdog::beginIteration() {
+  memset(iterationUs, 0, sizeof(iterationUs));
+  iterationStartUs = esp_timer_get_time();
+  inIteration = true;
+}
+
+void LatencyWatchdog::record(Stage stage, uint32_t us) {
+  StageStats& s = stats[(int)stage];
+  s.count++;
+  s.totalUs += us;
+  s.lastUs = us;
+  if (us > s.maxUs) s.maxUs = us;
+  s.buckets[bucketIndex(us)]++;
+  if (inIteration) iterationUs[(int)stage] += us;
+}
+
+bool LatencyWatchdog::endIteration() {
+  if (!inIteration) return false;
+  const uint32_t loopUs = (uint32_t)(esp_timer_get_time() - iterationStartUs);
+  inIteration = false;
+  record(Stage::Loop, loopUs);
+
+  const uint32_t loopMs = loopUs / 1000;
+  if (loopMs <= budgetMs) return false;
+
+  // Culprit: the stage with the most time this iteration; code outside any
+  // instrumented stage is reported as the loop itself ("untracked").
+  Stage culprit = Stage::Loop;
+  uint32_t culpritUs = 0;
+  uint32_t trackedUs = 0;
+  for (int i = 1; i < (int)Stage::Count; i++) {
+    trackedUs += iterationUs[i];
+    if (iterationUs[i] > culpritUs) {
+      culpritUs = iterationUs[i];
+      culprit = (Stage)i;
+    }
+  }
+  const uint32_t untrackedUs = loopUs > trackedUs ? loopUs - trackedUs : 0;
+  if (untrackedUs > culpritUs) {
+    culprit = Stage::Loop;
+    culpritUs = untrackedUs;
+  }
+
+  overrunCount++;
+  lastOverrun.atMs = millis();
+  lastOverrun.loopMs = loopMs;
+  lastOverrun.culprit = culprit;
+  lastOverrun.culpritMs = culpritUs / 1000;
+  if (loopMs >= worstOverrun.loopMs) worstOverrun = lastOverrun;
+
+  // Formatted on the stack: Print::printf allocates for lines over 64 bytes.
+  char line[112];
+  snprintf(line, sizeof(line), "[Watchdog] loop took %u ms (budget %u ms), culprit: %s %u ms",
+           loopMs, budgetMs, culprit == Stage::Loop ? "untracked" : stageName(culprit),
+           lastOverrun.culpritMs);
+  Serial.println(line);
+  return true;
+}
+
+const char* LatencyWatchdog::stageName(Stage stage) {
+  switch (stage) {
+    case Stage::Loop:
+      return "loop";
+    case Stage::HandleClient:
+      return "handleClient";
+    case Stage::WifiConnect:
+      return "wifiConnect";
+    case Stage::Scan:
+      return "scan";
+    case Stage::Probe:
+      return "probe";
+    case Stage::Post:
+      return "post";
+    case Stage::Ntp:
+      return "ntp";
+    default:
+      return "unknown";
+  }
+}
+
+void LatencyWatchdog::printSummary(Print& out) const {
+  char line[112];
+  snprintf(line, sizeof(line), "Latency (budget %u ms, overruns %u):", budgetMs, overrunCount);
+  out.println(line);
+  for (int i = 0; i < (int)Stage::Count; i++) {
+    const StageStats& s = stats[i];
+    if (s.count == 0) continue;
+    snprintf(line, sizeof(line), "  %-12s n=%u avg=%u ms max=%u ms last=%u ms", stageName((Stage)i),
+             s.count, (uint32_t)(s.totalUs / s.count / 1000), s.maxUs / 1000, s.lastUs / 1000);
+    out.println(line);
+  }
+  if (overrunCount > 0) {
+    snprintf(line, sizeof(line), "  last overrun: %u ms at %lu ms, culprit %s %u ms", lastOverrun.loopMs,
+             lastOverrun.atMs,
+             lastOverrun.culprit == Stage::Loop ? "untracked" : stageName(lastOverrun.culprit),
+             lastOverrun.culpritMs);
+    out.println(line);
+  }
+}
+
+static void appendOverrun(String& json, const char* key, const OverrunInfo& o) {
+  json += "\"";
+  json += key;
+  json += "\":{\"atMs\":";
+  json += String(o.atMs);
+  json += ",\"loopMs\":";
+  json += String(o.loopMs);
+  json += ",\"culprit\":\"";
+  json += o.culprit == Stage::Loop ? "untracked" : LatencyWatchdog::stageName(o.culprit);
+  json += "\",\"culpritMs\":";
+  json += String(o.culpritMs);
+  json += "}";
+}
+
+String LatencyWatchdog::toJson() const {
+  String json;
+  json.reserve(1024);
+  json += "{\"budgetMs\":";
+  json += String(budgetMs);
+  json += ",\"overruns\":";
+  json += String(overrunCount);
+  if (overrunCount > 0) {
+    json += ",";
+    appendOverrun(json, "lastOverrun", lastOverrun);
+    json += ",";
+    appendOverrun(json, "worstOverrun", worstOverrun);
+  }
+  json += ",\"bucketsMs\":[0,1";
+  for (int b = 2; b < WATCHDOG_BUCKETS; b++) {
+    json += ",";
+    json += String(1UL << (b - 1));
+  }
+  json += "],\"stages\":{";
+  bool first = true;
+  for (int i = 0; i < (int)Stage::Count; i++) {
+    const StageStats& s = stats[i];
+    if (!first) json += ",";
+    first = false;
+    json += "\"";
+    json += stageName((Stage)i);
+    json += "\":{\"count\":";
+    json += String(s.count);
+    json += ",\"avgMs\":";
+    json += String(s.count ? (uint32_t)(s.totalUs / s.count / 1000) : 0);
+    json += ",\"maxMs\":";
+    json += String(s.maxUs / 1000);
+    json += ",\"lastMs\":";
+    json += String(s.lastUs / 1000);
+    json += ",\"hist\":[";
+    for (int b = 0; b < WATCHDOG_BUCKETS; b++) {
+      if (b > 0) json += ",";
+      json += String(s.buckets[b]);
+    }
+    json += "]}";
+  }
+  json += "}}";
+  return json;
+}
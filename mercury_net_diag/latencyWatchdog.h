@@ -0,0 +1,91 @@
+/**
+ * latencyWatchdog.h
+ * Loop / handler latency watchdog for aranea device.
+ * Times loop() and the blocking stages inside it, keeps a log2 histogram per
+ * stage, and flags loop iterations that exceed a budget together with the
+ * stage that used most of the time.
+ */
+
+#ifndef LATENCY_WATCHDOG_H
+#define LATENCY_WATCHDOG_H
+
+#include <Arduino.h>
+
+// Histogram buckets: [0,1) [1,2) [2,4) ... [8192,16384) [16384,inf) ms
+#define WATCHDOG_BUCKETS 16
+
+enum class Stage : uint8_t {
+  Loop,          // one loop() iteration (excluding the trailing idle delay)
+  HandleClient,  // webServer.handleClient(), i.e. HTTP handlers
+  WifiConnect,   // (re)connect incl. fallback rounds
+  Scan,          // AP scan
+  Probe,         // TCP reachability probes
+  Post,          // webhook POST / PATCH or MQTT session incl. TLS
+  Ntp,           // NTP sync
+  Count
+};
+
+struct StageStats {
+  uint32_t count;
+  uint64_t totalUs;
+  uint32_t maxUs;
+  uint32_t lastUs;
+  uint32_t buckets[WATCHDOG_BUCKETS];
+};
+
+struct OverrunInfo {
+  unsigned long atMs;       // millis() when the iteration ended
+  uint32_t loopMs;          // iteration duration
+  Stage culprit;            // stage with the largest share (Loop = untracked code)
+  uint32_t culpritMs;
+};
+
+class LatencyWatchdog {
+public:
+  LatencyWatchdog();
+
+  // Times a stage for the lifetime of the object.
+  class Scope {
+  public:
+    explicit Scope(Stage stage);
+    ~Scope();
+  private:
+    Stage stage;
+    int64_t startUs;
+  };
+
+  void setBudgetMs(uint32_t ms) { budgetMs = ms; }
+  uint32_t getBudgetMs() const { return budgetMs; }
+
+  void beginIteration();
+  // Closes the loop() iteration; returns true if it went over budget.
+  bool endIteration();
+  void record(Stage stage, uint32_t us);
+
+  const StageStats& getStats(Stage stage) const { return stats[(int)stage]; }
+  uint32_t getOverrunCount() const { return overrunCount; }
+  const OverrunInfo& getLastOverrun() const { return lastOverrun; }
+  const OverrunInfo& getWorstOverrun() const { return worstOverrun; }
+
+  static const char* stageName(Stage stage);
+  // Histogram bucket for a duration; shared with other stage-timing modules.
+  static int bucketIndex(uint32_t us);
+
+  void printSummary(Print& out) const;
+  String toJson() const;
+
+private:
+  StageStats stats[(int)Stage::Count];
+  uint32_t iterationUs[(int)Stage::Count];  // per-stage time in the current iteration
+  int64_t iterationStartUs;
+  bool inIteration;
+  uint32_t budgetMs;
+  uint32_t overrunCount;
+  OverrunInfo lastOverrun;
+  OverrunInfo worstOverrun;
+};
+
+// Global instance
+extern LatencyWatchdog latencyWatchdog;
+
+#endif // LATENCY_WATCHDOG_H
@@ -7,6 +7,20 @@
  *   - SPIFFS-based settings management
  *   - HTTP server for configuration (smartphone-friendly)
  *   - Enhanced Discord message with ConnectionSummary
+ *   - Deep-sleep duty-cycle mode (fast reconnect from RTC cache, web UI on button wake)
+ *   - Loop/handler latency watchdog (per-stage histograms, over-budget culprit)
+ *   - Allocation-free periodic report path (static buffers, streamed webhook body)
+ *   - Captive-portal fallback (SoftAP + DNS) while STA retries in the background
+ *   - Per-attempt Wi-Fi join timing (link / DHCP) with disconnect reason codes
+ *   - MQTT mode: compact JSON snapshots over one persistent QoS1 session
+ *   - Optional gzip request bodies (streaming fixed-window deflate, chunked upload)
+ *   - Span tracing (MCP_TRACE=1 builds): GET /api/trace as Chrome trace JSON
+ *   - Sampling profiler (MCP_PROFILE=1 builds): /api/profile/start, stop, samples + flamegraph script
+ *   - Boot timeline (phase times, reset reasons, brownout / watchdog counters) in RTC + NVS: GET /api/boots
+ *   - Typed NVS key/value API for small hot values: /api/kv/get, set, delete, list
+ *   - Compressed files (McpZFile deflate blocks): /api/spiffs/write?compress=1[&append=1], read decompresses
+ *   - File change feed: GET /api/spiffs/changes?since=<seq>&wait=<ms> long-polls write / delete / format events
+ *   - Multi-file upload: POST /api/spiffs/upload?dir=/ (multipart/form-data, each part streamed to its file)
  * 
  * SETUP:
  *   1. Configure Discord webhook URL below
@@ -24,7 +38,28 @@
 #include "esp_wifi.h"
 #include "esp_mac.h"
 #include "esp_system.h"
+#include "esp_heap_caps.h"
+#include <lwip/sockets.h>
+#include <McpChanges.h>
+#include <McpEscape.h>
+#include <McpKv.h>
+#include <McpMem.h>
+#include <McpPowerSave.h>
+#include <McpProfiler.h>
+#include <McpTrace.h>
+#include <McpUpload.h>
+#include <McpZFile.h>
 #include "settingManager.h"
+#include "sleepManager.h"
+#include "latencyWatchdog.h"
+#include "reportBuffer.h"
+#include "webhookClient.h"
+#include "captivePortal.h"
+#include "connectTelemetry.h"
+#include "mqttClient.h"
+#include "bootTimeline.h"
+#include "diagJobs.h"
+#include "coopScan.h"
 
 // ============================================================
 // CONFIGURATION - aranea Device Settings
@@ -37,9 +72,7 @@ constexpr char kRegisterStatus[] = "Registered";
 // Discord webhook endpoint.
 // Create a webhook in Discord: Server Settings -> Integrations -> Webhooks
 constexpr char kWebhookUrl[] = "https://discord.com/api/webhooks/1446680031261622303/6oTaI_D2lBxNVpwFk_p5TfMkPi3SrVXE0l4U7TNWU9FbCNS7DqbG_yBC01ubDGxANlxn";
-constexpr char kWebhookUrlWait[] = "https://discord.com/api/webhooks/1446680031261622303/6oTaI_D2lBxNVpwFk_p5TfMkPi3SrVXE0l4U7TNWU9FbCNS7DqbG_yBC01ubDGxANlxn?wait=true";
-constexpr char kWebhookId[] = "1446680031261622303";
-constexpr char kWebhookToken[] = "6oTaI_D2lBxNVpwFk_p5TfMkPi3SrVXE0l4U7TNWU9FbCNS7DqbG_yBC01ubDGxANlxn";
+constexpr char kReportUsername[] = "ESP32 aranea Device";
 
 // Probe targets for reachability testing (customize for your network)
 struct ProbeTarget {
@@ -59,14 +92,19 @@ const ProbeTarget kTargets[] = {
 
 constexpr uint8_t kMaxConnectAttempts = 20;
 constexpr unsigned long kReconnectDelayMs = 1000;
+constexpr unsigned long kConnectPollMs = 20;               // WiFi.status() poll while joining.
 constexpr unsigned long kRegisteredInfoIntervalMs = 300000; // Print RegisteredInfo every 5 minutes.
 constexpr unsigned long kStatusPollMs = 5000;              // Serial print cadence.
-constexpr unsigned long kWifiRetryWaitMs = 600000;         // 10 minutes wait after 3 rounds fail.
-constexpr uint8_t kWifiRounds = 3;                         // Try each SSID 3 rounds before long wait.
+constexpr uint8_t kWifiRounds = 1;                         // Blocking rounds over all SSIDs before the captive portal.
+constexpr unsigned long kFastConnectTimeoutMs = 3000;      // Cached BSSID/channel join budget (deep sleep mode).
+constexpr uint8_t kDutyConnectAttempts = 8;                // Per-SSID attempts on a full connect in deep sleep mode.
 
 // Ports to scan on probe targets
 const int kPortsToScan[] = {80, 443, 22, 53};
 
+// Names the on-demand DNS diagnostic resolves (plus the MQTT broker when set)
+const char *const kDiagDnsHosts[] = {"discord.com", "pool.ntp.org", "time.google.com"};
+
 // ============================================================
 // GLOBAL STATE
 // ============================================================
@@ -79,24 +117,32 @@ unsigned long lastRegisteredInfoPrint = 0;
 bool timeSynced = false;
 String gHostname;
 String gLacisId;  // 20-digit unique ID: 0000{MAC(12digit)}0000
-String lastScanSummary;
-String lastProbeSummary;
 int currentWifiIndex = 0;
-int wifiRoundCount = 0;
-String currentConnectedSSID;
+int staRetryIndex = -1;            // Credential tried by the background STA retry, -1 = idle.
+unsigned long staRetryStartMs = 0;
+char currentConnectedSSID[33] = "";
 int currentRSSI = 0;
+unsigned long uiWindowEndMs = 0;  // Deep sleep mode: web UI stays up until this time.
+
+// Report path buffers. Static so a report cycle does not allocate; sized for
+// Discord's 2000 character message limit.
+StaticReportBuffer<512> scanSummary;
+StaticReportBuffer<640> probeSummary;
+StaticReportBuffer<2048> statusText;
+StaticReportBuffer<1024> serialText;
+WebhookClient webhook(secureClient);
+
+// MQTT mode (settings.mqttHost set): TLS reuses secureClient, the webhook is idle.
+WiFiClient mqttPlainClient;
+MqttClient mqtt(mqttPlainClient, secureClient);
+StaticReportBuffer<MQTT_PAYLOAD_MAX> snapshotJson;
+StaticReportBuffer<224> scanJson;
+StaticReportBuffer<256> probeJson;
 
 // ============================================================
 // UTILITY FUNCTIONS
 // ============================================================
 
-String macToString(const uint8_t *mac) {
-  char buf[18];
-  snprintf(buf, sizeof(buf), "%02X:%02X:%02X:%02X:%02X:%02X",
-           mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
-  return String(buf);
-}
-
 String macToHexString(const uint8_t *mac) {
   char buf[13];
   snprintf(buf, sizeof(buf), "%02X%02X%02X%02X%02X%02X",
@@ -119,31 +165,7 @@ String makeHostName(const uint8_t *mac) {
   return String(buf);
 }
 
-String jsonEscape(const String &in) {
-  String out;
-  out.reserve(in.length() + 8);
-  for (size_t i = 0; i < in.length(); ++i) {
-    char c = in.charAt(i);
-    switch (c) {
-      case '\\':
-        out += "\\\\";
-        break;
-      case '"':
-        out += "\\\"";
-        break;
-      case '\n':
-        out += "\\n";
-        break;
-      case '\r':
-        break;
-      default:
-        out += c;
-    }
-  }
-  return out;
-}
-
-String cipherToString(wifi_cipher_type_t cipher) {
+const char* cipherToString(wifi_cipher_type_t cipher) {
   switch (cipher) {
     case WIFI_CIPHER_TYPE_WEP40:
     case WIFI_CIPHER_TYPE_WEP104:
@@ -163,7 +185,7 @@ String cipherToString(wifi_cipher_type_t cipher) {
   }
 }
 
-String authModeToString(wifi_auth_mode_t auth) {
+const char* authModeToString(wifi_auth_mode_t auth) {
   switch (auth) {
     case WIFI_AUTH_OPEN:
       return "OPEN";
@@ -186,11 +208,11 @@ String authModeToString(wifi_auth_mode_t auth) {
   }
 }
 
-String encTypeToString(uint8_t enc) {
+const char* encTypeToString(uint8_t enc) {
   return authModeToString(static_cast<wifi_auth_mode_t>(enc));
 }
 
-String wifiStatusToString(wl_status_t s) {
+const char* wifiStatusToString(wl_status_t s) {
   switch (s) {
     case WL_IDLE_STATUS:
       return "IDLE";
@@ -211,7 +233,7 @@ String wifiStatusToString(wl_status_t s) {
   }
 }
 
-String wifiModeToString(wifi_mode_t m) {
+const char* wifiModeToString(wifi_mode_t m) {
   switch (m) {
     case WIFI_MODE_NULL:
       return "NULL";
@@ -227,12 +249,14 @@ String wifiModeToString(wifi_mode_t m) {
 }
 
 bool syncTimeWithNtp() {
+  LatencyWatchdog::Scope timing(Stage::Ntp);
   setenv("TZ", "JST-9", 1);  // Japan Standard Time
   tzset();
   configTime(0, 0, "pool.ntp.org", "time.google.com", "ntp.nict.jp");
   for (int i = 0; i < 20; ++i) {
     struct tm timeInfo;
     if (getLocalTime(&timeInfo, 200)) {
+      bootTimeline.mark(BootPhase::Ntp);
       return true;
     }
     delay(200);
@@ -240,36 +264,47 @@ bool syncTimeWithNtp() {
   return false;
 }
 
-String formatTimestamp() {
-  if (!timeSynced) {
-    return "not_synced";
-  }
+void addTimestamp(ReportBuffer &out) {
   struct tm timeInfo;
-  if (!getLocalTime(&timeInfo, 100)) {
-    return "not_synced";
+  if (!timeSynced || !getLocalTime(&timeInfo, 100)) {
+    out.add("not_synced");
+    return;
   }
   char buf[32];
   strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S%z", &timeInfo);
-  return String(buf);
+  out.add(buf);
 }
 
-String extractMessageId(const String &body) {
-  int pos = body.indexOf("\"id\":\"");
-  if (pos < 0) return "";
-  pos += 6;
-  int end = body.indexOf('"', pos);
-  if (end < 0) return "";
-  return body.substring(pos, end);
+// Broker settings and identity for MQTT mode (no-op when unchanged).
+void configureMqtt() {
+  const DeviceSettings &settings = settingMgr.getSettings();
+  mqtt.configure(settings.mqttHost.c_str(), settings.mqttPort, settings.mqttTls, settings.mqttUser.c_str(),
+                 settings.mqttPass.c_str(), gLacisId.c_str(), settings.mqttTopic.c_str(),
+                 MQTT_DEFAULT_KEEPALIVE_SEC);
 }
 
-String buildEditUrl(const String &messageId) {
-  String url = "https://discord.com/api/webhooks/";
-  url += kWebhookId;
-  url += "/";
-  url += kWebhookToken;
-  url += "/messages/";
-  url += messageId;
-  return url;
+// Cooperative scan on or off per the settings. Not in deep sleep mode: a
+// sleeping device neither hears the others' results nor answers their HELLOs.
+void configureCoopScan() {
+  const bool wanted = settingMgr.getCoopScan() && !settingMgr.getDeepSleep() && WiFi.status() == WL_CONNECTED;
+  if (wanted && !coopScan.isActive()) {
+    coopScan.begin(gLacisId);
+  } else if (!wanted && coopScan.isActive()) {
+    coopScan.end();
+  }
+}
+
+// Wi-Fi power save policy from the settings (started on the first call).
+void applyPowerSave() {
+  mcp::powersave::Mode mode = mcp::powersave::Mode::Auto;
+  mcp::powersave::parseMode(settingMgr.getPowerMode().c_str(), mode);
+  const uint32_t idleMs = settingMgr.getPsIdleSec() * 1000UL;
+  if (!mcp::powersave::running()) {
+    mcp::powersave::begin(mode, idleMs);
+    return;
+  }
+  mcp::powersave::setMode(mode);
+  mcp::powersave::setIdleMs(idleMs);
 }
 
 // ============================================================
@@ -402,6 +437,7 @@ const char* HTML_FOOTER = R"rawliteral(
 )rawliteral";
 
 void handleRoot() {
+  MCP_TRACE_SCOPE("http.root");
   wifi_ap_record_t apInfo{};
   esp_wifi_sta_get_ap_info(&apInfo);
   
@@ -412,12 +448,21 @@ void handleRoot() {
   html += "<div class='card'>";
   html += "<h2>📡 接続状態</h2>";
   html += "<div class='status-box'>";
-  html += "<p><strong>Location:</strong> " + settingMgr.getLocationName() + "</p>";
+  html += "<p><strong>Location:</strong> " + mcp::htmlEscaped(settingMgr.getLocationName()) + "</p>";
   html += "<p><strong>IP:</strong> " + WiFi.localIP().toString() + "</p>";
-  html += "<p><strong>SSID:</strong> " + WiFi.SSID() + "</p>";
+  html += "<p><strong>SSID:</strong> " + mcp::htmlEscaped(WiFi.SSID()) + "</p>";
   html += "<p><strong>RSSI:</strong> " + String(apInfo.rssi) + " dBm</p>";
   html += "<p><strong>LacisID:</strong> " + gLacisId + "</p>";
   html += "<p><strong>Uptime:</strong> " + String(millis() / 1000) + " sec</p>";
+  if (settingMgr.getDeepSleep()) {
+    long remaining = (long)(uiWindowEndMs - millis()) / 1000;
+    html += "<p><strong>Deep Sleep:</strong> wake=" + String(sleepMgr.wakeReasonString()) +
+            ", cycle " + String(sleepMgr.getState().cycle) + ", sleep in " + String(remaining > 0 ? remaining : 0) + " sec</p>";
+  }
+  if (captivePortal.isActive()) {
+    html += "<p><strong>Setup AP:</strong> " + mcp::htmlEscaped(captivePortal.getSsid()) +
+            " (WiFi未接続, 再試行 " + String(captivePortal.getRetryCount()) + " 回)</p>";
+  }
   html += "</div></div>";
   
   // Settings Form
@@ -427,28 +472,82 @@ void handleRoot() {
   html += "<div class='card'>";
   html += "<h2>⚙️ 基本設定</h2>";
   html += "<div class='form-group'><label>Location Name</label>";
-  html += "<input type='text' name='locationName' value='" + settingMgr.getLocationName() + "'></div>";
+  html += "<input type='text' name='locationName' value='" + mcp::htmlEscaped(settingMgr.getLocationName()) + "'></div>";
   html += "<div class='form-group'><label>Network Name (Omada等)</label>";
-  html += "<input type='text' name='networkName' value='" + settingMgr.getNetworkName() + "'></div>";
+  html += "<input type='text' name='networkName' value='" + mcp::htmlEscaped(settingMgr.getNetworkName()) + "'></div>";
   html += "<div class='form-group'><label>Check Interval (ms)</label>";
   html += "<input type='number' name='checkInterval' value='" + String(settingMgr.getCheckInterval()) + "'></div>";
+  html += "<div class='form-group'><label>Loop Budget (ms, 超過を記録)</label>";
+  html += "<input type='number' name='loopBudgetMs' value='" + String(settingMgr.getLoopBudgetMs()) + "'></div>";
+  html += "<div class='form-group'><label><input type='checkbox' name='webhookGzip' value='1' style='width:auto'";
+  if (settingMgr.getWebhookGzip()) html += " checked";
+  html += "> Webhook gzip (受信側が Content-Encoding: gzip 対応の場合のみ。拒否されたら非圧縮で再送)";
+  if (webhook.isGzipRejected()) html += " <span style='color:#c00'>⚠ 受信側が拒否: 非圧縮で送信中</span>";
+  html += "</label></div>";
+  html += "<div class='form-group'><label><input type='checkbox' name='coopScan' value='1' style='width:auto'";
+  if (settingMgr.getCoopScan()) html += " checked";
+  html += "> Cooperative Scan (同じLANの端末とチャネルを分担してスキャン)</label></div>";
+  html += "</div>";
+
+  // Power Settings
+  html += "<div class='card'>";
+  html += "<h2>🔋 省電力</h2>";
+  html += "<div class='form-group'><label><input type='checkbox' name='deepSleep' value='1' style='width:auto'";
+  if (settingMgr.getDeepSleep()) html += " checked";
+  html += "> Deep Sleep Mode (送信後スリープ)</label></div>";
+  html += "<div class='form-group'><label>UI Window (sec, ボタン起床後)</label>";
+  html += "<input type='number' name='uiWindowSec' value='" + String(settingMgr.getUiWindowSec()) + "'></div>";
+  html += "<div class='form-group'><label>Wi-Fi Power Save</label><select name='powerMode'>";
+  static const char* const kPowerModes[][2] = {
+    {"auto", "auto (アクセス中は応答優先)"}, {"latency", "latency (常時オフ)"}, {"power", "power (常時オン)"}};
+  for (const auto& m : kPowerModes) {
+    html += "<option value='" + String(m[0]) + "'";
+    if (settingMgr.getPowerMode() == m[0]) html += " selected";
+    html += ">" + String(m[1]) + "</option>";
+  }
+  html += "</select></div>";
+  html += "<div class='form-group'><label>Power Save Idle (sec, auto で再開まで)</label>";
+  html += "<input type='number' name='psIdleSec' value='" + String(settingMgr.getPsIdleSec()) + "'></div>";
+  html += "</div>";
+
+  // MQTT Settings
+  html += "<div class='card'>";
+  html += "<h2>📨 MQTT</h2>";
+  html += "<div class='form-group'><label>Broker Host (空欄でDiscord Webhook)</label>";
+  html += "<input type='text' name='mqttHost' value='" + mcp::htmlEscaped(settingMgr.getMqttHost()) + "'></div>";
+  html += "<div class='form-group'><label>Port</label>";
+  html += "<input type='number' name='mqttPort' value='" + String(settingMgr.getMqttPort()) + "'></div>";
+  html += "<div class='form-group'><label><input type='checkbox' name='mqttTls' value='1' style='width:auto'";
+  if (settingMgr.getMqttTls()) html += " checked";
+  html += "> TLS</label></div>";
+  html += "<div class='form-group'><label>User</label>";
+  html += "<input type='text' name='mqttUser' value='" + mcp::htmlEscaped(settingMgr.getMqttUser()) + "'></div>";
+  html += "<div class='form-group'><label>Password</label>";
+  html += "<input type='password' name='mqttPass' value='" + mcp::htmlEscaped(settingMgr.getMqttPass()) + "'></div>";
+  html += "<div class='form-group'><label>Topic Root (&lt;root&gt;/&lt;LacisID&gt;/status)</label>";
+  html += "<input type='text' name='mqttTopic' value='" + mcp::htmlEscaped(settingMgr.getMqttTopic()) + "'></div>";
+  if (mqtt.isEnabled()) {
+    html += "<div class='status-box'><p><strong>State:</strong> ";
+    html += mqtt.isConnected() ? "connected" : "disconnected";
+    html += ", queued " + String(mqtt.getQueued()) + "</p></div>";
+  }
   html += "</div>";
   
   // WiFi Settings
   html += "<div class='card'>";
   html += "<h2>📶 WiFi設定</h2>";
   html += "<div class='form-group'><label>Main SSID</label>";
-  html += "<input type='text' name='mainSSID' value='" + settingMgr.getMainSSID() + "'></div>";
+  html += "<input type='text' name='mainSSID' value='" + mcp::htmlEscaped(settingMgr.getMainSSID()) + "'></div>";
   html += "<div class='form-group'><label>Main Password</label>";
-  html += "<input type='password' name='mainPass' value='" + settingMgr.getMainPass() + "'></div>";
+  html += "<input type='password' name='mainPass' value='" + mcp::htmlEscaped(settingMgr.getMainPass()) + "'></div>";
   html += "<div class='form-group'><label>Alt SSID</label>";
-  html += "<input type='text' name='altSSID' value='" + settingMgr.getAltSSID() + "'></div>";
+  html += "<input type='text' name='altSSID' value='" + mcp::htmlEscaped(settingMgr.getAltSSID()) + "'></div>";
   html += "<div class='form-group'><label>Alt Password</label>";
-  html += "<input type='password' name='altPass' value='" + settingMgr.getAltPass() + "'></div>";
+  html += "<input type='password' name='altPass' value='" + mcp::htmlEscaped(settingMgr.getAltPass()) + "'></div>";
   html += "<div class='form-group'><label>Dev SSID</label>";
-  html += "<input type='text' name='devSSID' value='" + settingMgr.getDevSSID() + "'></div>";
+  html += "<input type='text' name='devSSID' value='" + mcp::htmlEscaped(settingMgr.getDevSSID()) + "'></div>";
   html += "<div class='form-group'><label>Dev Password</label>";
-  html += "<input type='password' name='devPass' value='" + settingMgr.getDevPass() + "'></div>";
+  html += "<input type='password' name='devPass' value='" + mcp::htmlEscaped(settingMgr.getDevPass()) + "'></div>";
   html += "</div>";
   
   // Endpoints
@@ -457,7 +556,7 @@ void handleRoot() {
   const auto& endpoints = settingMgr.getEndpoints();
   for (size_t i = 0; i < endpoints.size(); i++) {
     html += "<div class='endpoint-item'>";
-    html += "<input type='text' name='endpoint" + String(i) + "' value='" + endpoints[i] + "'>";
+    html += "<input type='text' name='endpoint" + String(i) + "' value='" + mcp::htmlEscaped(endpoints[i]) + "'>";
     html += "</div>";
   }
   if (endpoints.size() < MAX_ENDPOINTS) {
@@ -470,6 +569,23 @@ void handleRoot() {
   html += "<button type='submit' class='btn btn-primary'>💾 設定を保存</button>";
   html += "</form>";
   
+  // On-demand diagnostics: results reused for 30 s, polled until done
+  html += "<div class='card' style='margin-top:16px'>";
+  html += "<h2>🩺 診断</h2>";
+  html += "<div style='display:flex;gap:8px'>";
+  for (const char* type : {"scan", "probe", "dns", "all"}) {
+    html += "<button type='button' class='btn btn-secondary' onclick=\"diag('" + String(type) + "')\">" + String(type) + "</button>";
+  }
+  html += "</div><pre id='diag' style='white-space:pre-wrap;font-size:0.75rem;margin-top:8px'></pre>";
+  html += "<script>";
+  html += "function diag(t){var o=document.getElementById('diag');o.textContent=t+' ...';";
+  html += "function show(j){if(!j.ok){o.textContent=j.error;return;}";
+  html += "if(j.job.state!='done'){o.textContent=t+' '+j.job.state+' ...';";
+  html += "setTimeout(function(){fetch('/api/diag/job?id='+j.job.id).then(function(r){return r.json();}).then(show);},1000);return;}";
+  html += "o.textContent=JSON.stringify(j.job.results,null,1);}";
+  html += "fetch('/api/diag/run?type='+t+'&maxAge=30',{method:'POST'}).then(function(r){return r.json();}).then(show);}";
+  html += "</script></div>";
+
   // Reboot button
   html += "<form method='POST' action='/reboot'>";
   html += "<button type='submit' class='btn btn-danger' style='margin-top:16px'>🔄 再起動</button>";
@@ -485,6 +601,7 @@ void handleRoot() {
 }
 
 void handleSave() {
+  MCP_TRACE_SCOPE("http.save");
   Serial.println("[WebServer] Save request received");
 
   if (webServer.hasArg("locationName")) settingMgr.setLocationName(webServer.arg("locationName"));
@@ -498,6 +615,40 @@ void handleSave() {
   if (webServer.hasArg("checkInterval")) {
     settingMgr.setCheckInterval(webServer.arg("checkInterval").toInt());
   }
+  // Unchecked checkboxes are not submitted.
+  settingMgr.setDeepSleep(webServer.hasArg("deepSleep"));
+  settingMgr.setWebhookGzip(webServer.hasArg("webhookGzip"));
+  settingMgr.setCoopScan(webServer.hasArg("coopScan"));
+  configureCoopScan();
+  if (webServer.hasArg("uiWindowSec")) {
+    settingMgr.setUiWindowSec(webServer.arg("uiWindowSec").toInt());
+  }
+  if (webServer.hasArg("loopBudgetMs")) {
+    settingMgr.setLoopBudgetMs(webServer.arg("loopBudgetMs").toInt());
+    latencyWatchdog.setBudgetMs(settingMgr.getLoopBudgetMs());
+  }
+  if (webServer.hasArg("powerMode")) {
+    mcp::powersave::Mode mode;
+    if (mcp::powersave::parseMode(webServer.arg("powerMode").c_str(), mode)) {
+      settingMgr.setPowerMode(webServer.arg("powerMode"));
+    }
+  }
+  if (webServer.hasArg("psIdleSec")) {
+    long idle = webServer.arg("psIdleSec").toInt();
+    if (idle > 0) settingMgr.setPsIdleSec(idle);
+  }
+  applyPowerSave();
+  if (webServer.hasArg("mqttHost")) {
+    settingMgr.setMqttHost(webServer.arg("mqttHost"));
+    settingMgr.setMqttTls(webServer.hasArg("mqttTls"));
+    long port = webServer.arg("mqttPort").toInt();
+    settingMgr.setMqttPort(port > 0 && port < 65536 ? port : (settingMgr.getMqttTls() ? 8883 : 1883));
+    settingMgr.setMqttUser(webServer.arg("mqttUser"));
+    settingMgr.setMqttPass(webServer.arg("mqttPass"));
+    String topic = webServer.arg("mqttTopic");
+    settingMgr.setMqttTopic(topic.length() > 0 ? topic : String("aranea"));
+    configureMqtt();
+  }
 
   // Update existing endpoints
   settingMgr.clearEndpoints();
@@ -516,11 +667,24 @@ void handleSave() {
   bool saveSuccess = settingMgr.saveSettings();
   Serial.printf("[WebServer] Save result: %s\n", saveSuccess ? "SUCCESS" : "FAILED");
 
+  // New credentials from the portal: try them right away.
+  if (captivePortal.isActive()) {
+    captivePortal.retryNow();
+  }
+
+  // Keep the UI up for a full window after a save, before (re)entering deep sleep.
+  if (settingMgr.getDeepSleep()) {
+    uiWindowEndMs = millis() + settingMgr.getUiWindowSec() * 1000UL;
+  }
+
   String html = HTML_HEADER;
   html += "<h1>aranea Device</h1>";
   if (saveSuccess) {
     html += "<div class='msg msg-success'>設定を保存しました</div>";
-    html += "<p style='text-align:center;color:#aaa;margin:12px 0;'>Location: " + settingMgr.getLocationName() + "</p>";
+    html += "<p style='text-align:center;color:#aaa;margin:12px 0;'>Location: " + mcp::htmlEscaped(settingMgr.getLocationName()) + "</p>";
+    if (captivePortal.isActive()) {
+      html += "<p style='text-align:center;color:#aaa;'>新しい設定でWiFi接続を試行します。接続するとこのAPは停止します。</p>";
+    }
   } else {
     html += "<div class='msg msg-error'>保存に失敗しました</div>";
     html += "<p style='text-align:center;color:#e74c3c;'>SPIFFSへの書き込みエラー</p>";
@@ -578,14 +742,84 @@ void handleReset() {
 }
 
 void handleApi() {
+  MCP_TRACE_SCOPE("http.settings");
   webServer.send(200, "application/json", settingMgr.toJson());
 }
 
+void handleStatus() {
+  MCP_TRACE_SCOPE("http.status");
+  String json = "{";
+  json += "\"lacisId\":\"" + gLacisId + "\",";
+  json += "\"ip\":\"" + WiFi.localIP().toString() + "\",";
+  json += "\"ssid\":\"";
+  mcp::appendJsonEscaped(json, WiFi.SSID());
+  json += "\",";
+  json += "\"rssi\":" + String(WiFi.RSSI()) + ",";
+  json += "\"uptimeMs\":" + String(millis()) + ",";
+  json += "\"freeHeap\":" + String(ESP.getFreeHeap()) + ",";
+  json += "\"freePsram\":" + String(ESP.getFreePsram()) + ",";
+  json += "\"latency\":" + latencyWatchdog.toJson() + ",";
+  json += "\"portal\":" + captivePortal.toJson() + ",";
+  json += "\"connect\":" + connectTelemetry.toJson() + ",";
+  json += "\"mqtt\":" + mqtt.toJson() + ",";
+  json += "\"diag\":" + diagJobs.toJson() + ",";
+  json += "\"coop\":" + coopScan.toJson();
+  json += "}";
+  webServer.send(200, "application/json", json);
+}
+
+// POST /api/diag/run?type=scan|probe|dns|all&maxAge=SEC - queue a
+// diagnostic (or join the identical one in flight). 202 with the job while
+// it runs, 200 when cached results younger than maxAge covered it.
+void handleDiagRun() {
+  MCP_TRACE_SCOPE("http.diagRun");
+  const uint8_t types = DiagJobs::parseTypes(webServer.hasArg("type") ? webServer.arg("type") : String("all"));
+  if (types == 0) {
+    webServer.send(400, "application/json", "{\"ok\":false,\"error\":\"type must be scan, probe, dns or all\"}");
+    return;
+  }
+  const long maxAgeSec = webServer.hasArg("maxAge") ? webServer.arg("maxAge").toInt() : 0;
+  bool attached = false;
+  const uint32_t id = diagJobs.run(types, maxAgeSec > 0 ? (uint32_t)maxAgeSec * 1000UL : 0, attached);
+  if (id == 0) {
+    webServer.sendHeader("Retry-After", "5");
+    webServer.send(503, "application/json", "{\"ok\":false,\"error\":\"all diagnostic jobs are in progress\"}");
+    return;
+  }
+  const bool done = diagJobs.getState(id) == DiagState::Done;
+  String json = "{\"ok\":true,\"coalesced\":";
+  json += attached ? "true" : "false";
+  json += ",\"job\":" + diagJobs.jobJson(id) + "}";
+  if (!done) webServer.sendHeader("Location", "/api/diag/job?id=" + String(id));
+  webServer.sendHeader("Cache-Control", "no-store");
+  webServer.send(done ? 200 : 202, "application/json", json);
+}
+
+// GET /api/diag/job?id=N - state of a job, with the results of its types so far
+void handleDiagJob() {
+  MCP_TRACE_SCOPE("http.diagJob");
+  String job = diagJobs.jobJson(strtoul(webServer.arg("id").c_str(), nullptr, 10));
+  if (job.length() == 0) {
+    webServer.send(404, "application/json", "{\"ok\":false,\"error\":\"unknown job\"}");
+    return;
+  }
+  webServer.sendHeader("Cache-Control", "no-store");
+  webServer.send(200, "application/json", "{\"ok\":true,\"job\":" + job + "}");
+}
+
+// GET /api/boots?n=8 - boot timelines and reset counters
+void handleBoots() {
+  MCP_TRACE_SCOPE("http.boots");
+  int limit = webServer.hasArg("n") ? webServer.arg("n").toInt() : BOOT_HISTORY;
+  webServer.send(200, "application/json", bootTimeline.toJson(limit));
+}
+
 // ============================================================
 // SPIFFS FILE API
 // ============================================================
 
 void handleSpiffsList() {
+  MCP_TRACE_SCOPE("http.spiffs.list");
   Serial.println("[SPIFFS API] List request");
 
   String json = "{\"success\":true,\"files\":[";
@@ -599,8 +833,9 @@ void handleSpiffsList() {
   File file = root.openNextFile();
   while (file) {
     if (!first) json += ",";
-    json += "{\"name\":\"" + String(file.name()) + "\",";
-    json += "\"size\":" + String(file.size()) + ",";
+    json += "{\"name\":\"";
+    mcp::appendJsonEscaped(json, file.name(), strlen(file.name()));
+    json += "\",\"size\":" + String(file.size()) + ",";
     json += "\"isDir\":" + String(file.isDirectory() ? "true" : "false") + "}";
     first = false;
     file = root.openNextFile();
@@ -611,6 +846,7 @@ void handleSpiffsList() {
 }
 
 void handleSpiffsRead() {
+  MCP_TRACE_SCOPE("http.spiffs.read");
   if (!webServer.hasArg("path")) {
     webServer.send(400, "application/json", "{\"success\":false,\"error\":\"Missing path parameter\"}");
     return;
@@ -632,18 +868,37 @@ void handleSpiffsRead() {
     return;
   }
 
-  String content = file.readString();
+  // Compressed files (McpZFile) are returned decompressed
+  String content;
+  bool compressed = mcp::zfile::isCompressed(file);
+  if (compressed) {
+    bool ok = mcp::zfile::read(file, 0, SIZE_MAX, [](void* ctx, const uint8_t* data, size_t len) {
+      return static_cast<String*>(ctx)->concat(reinterpret_cast<const char*>(data), len);
+    }, &content);
+    if (!ok) {
+      file.close();
+      webServer.send(500, "application/json", "{\"success\":false,\"error\":\"Corrupt compressed file\"}");
+      return;
+    }
+  } else {
+    content = file.readString();
+  }
   file.close();
 
   // Return as JSON with base64 or raw text
-  String json = "{\"success\":true,\"path\":\"" + path + "\",";
-  json += "\"size\":" + String(content.length()) + ",";
-  json += "\"content\":\"" + jsonEscape(content) + "\"}";
+  String json = "{\"success\":true,\"path\":\"";
+  mcp::appendJsonEscaped(json, path);
+  json += "\",\"size\":" + String(content.length()) + ",";
+  if (compressed) json += "\"compressed\":true,";
+  json += "\"content\":\"";
+  mcp::appendJsonEscaped(json, content);
+  json += "\"}";
 
   webServer.send(200, "application/json", json);
 }
 
 void handleSpiffsWrite() {
+  MCP_TRACE_SCOPE("http.spiffs.write");
   if (!webServer.hasArg("path") || !webServer.hasArg("content")) {
     webServer.send(400, "application/json", "{\"success\":false,\"error\":\"Missing path or content parameter\"}");
     return;
@@ -655,21 +910,50 @@ void handleSpiffsWrite() {
 
   Serial.printf("[SPIFFS API] Write request: %s (%d bytes)\n", path.c_str(), content.length());
 
-  File file = SPIFFS.open(path, "w");
-  if (!file) {
-    webServer.send(500, "application/json", "{\"success\":false,\"error\":\"Failed to create file\"}");
-    return;
+  // compress=1: McpZFile (deflated blocks); append=1 adds to a file of either kind
+  bool append = webServer.arg("append") == "1";
+  bool compress = webServer.arg("compress") == "1";
+  if (append && SPIFFS.exists(path)) {
+    File existing = SPIFFS.open(path, "r");
+    compress = existing && mcp::zfile::isCompressed(existing);
+    existing.close();
   }
 
-  size_t written = file.print(content);
-  file.close();
+  size_t written = 0;
+  if (compress) {
+    mcp::zfile::Writer writer;
+    if (!writer.open(SPIFFS, path.c_str(), append)) {
+      webServer.send(500, "application/json", "{\"success\":false,\"error\":\"Failed to open compressed file\"}");
+      return;
+    }
+    writer.print(content);
+    bool ok = writer.close();
+    written = writer.rawBytes();
+    Serial.printf("[SPIFFS API] Compressed %u -> %u bytes\n", (unsigned)written, (unsigned)writer.storedBytes());
+    if (!ok) {
+      webServer.send(500, "application/json", "{\"success\":false,\"error\":\"Failed to write file\"}");
+      return;
+    }
+  } else {
+    File file = SPIFFS.open(path, append ? "a" : "w");
+    if (!file) {
+      webServer.send(500, "application/json", "{\"success\":false,\"error\":\"Failed to create file\"}");
+      return;
+    }
+    written = file.print(content);
+    file.close();
+  }
+  mcp::changes::record(append ? mcp::changes::Op::Append : mcp::changes::Op::Write, path.c_str(), written);
 
-  String json = "{\"success\":true,\"path\":\"" + path + "\",\"written\":" + String(written) + "}";
+  String json = "{\"success\":true,\"path\":\"";
+  mcp::appendJsonEscaped(json, path);
+  json += "\",\"written\":" + String(written) + "}";
   webServer.send(200, "application/json", json);
-  Serial.printf("[SPIFFS API] Write complete: %d bytes\n", written);
+  Serial.printf("[SPIFFS API] Write complete: %u bytes\n", (unsigned)written);
 }
 
 void handleSpiffsDelete() {
+  MCP_TRACE_SCOPE("http.spiffs.delete");
   if (!webServer.hasArg("path")) {
     webServer.send(400, "application/json", "{\"success\":false,\"error\":\"Missing path parameter\"}");
     return;
@@ -687,7 +971,11 @@ void handleSpiffsDelete() {
 
   bool success = SPIFFS.remove(path);
   if (success) {
-    webServer.send(200, "application/json", "{\"success\":true,\"deleted\":\"" + path + "\"}");
+    mcp::changes::record(mcp::changes::Op::Delete, path.c_str());
+    String json = "{\"success\":true,\"deleted\":\"";
+    mcp::appendJsonEscaped(json, path);
+    json += "\"}";
+    webServer.send(200, "application/json", json);
     Serial.printf("[SPIFFS API] Deleted: %s\n", path.c_str());
   } else {
     webServer.send(500, "application/json", "{\"success\":false,\"error\":\"Failed to delete file\"}");
@@ -695,6 +983,7 @@ void handleSpiffsDelete() {
 }
 
 void handleSpiffsInfo() {
+  MCP_TRACE_SCOPE("http.spiffs.info");
   Serial.println("[SPIFFS API] Info request");
 
   size_t totalBytes = SPIFFS.totalBytes();
@@ -711,6 +1000,7 @@ void handleSpiffsInfo() {
 }
 
 void handleSpiffsFormat() {
+  MCP_TRACE_SCOPE("http.spiffs.format");
   // Require confirmation parameter for safety
   if (!webServer.hasArg("confirm") || webServer.arg("confirm") != "yes") {
     webServer.send(400, "application/json", "{\"success\":false,\"error\":\"Add confirm=yes parameter to format\"}");
@@ -721,6 +1011,7 @@ void handleSpiffsFormat() {
 
   bool success = SPIFFS.format();
   if (success) {
+    mcp::changes::record(mcp::changes::Op::Format, "/");
     // Recreate default config after format
     settingMgr.resetToDefaults();
     webServer.send(200, "application/json", "{\"success\":true,\"message\":\"SPIFFS formatted, defaults restored\"}");
@@ -730,20 +1021,67 @@ void handleSpiffsFormat() {
   }
 }
 
+void handleNotFound() {
+  if (captivePortal.redirectIfForeign(webServer)) {
+    return;
+  }
+  webServer.send(404, "text/plain", "Not found");
+}
+
+// Wi-Fi power save stays off while the handler runs; with "auto" it comes
+// back psIdleSec after the last request (McpPowerSave.h).
+WebServer::THandlerFunction held(WebServer::THandlerFunction fn) {
+  return [fn] {
+    mcp::powersave::Hold hold;
+    fn();
+  };
+}
+
 void setupWebServer() {
-  webServer.on("/", HTTP_GET, handleRoot);
-  webServer.on("/save", HTTP_POST, handleSave);
-  webServer.on("/reboot", HTTP_POST, handleReboot);
-  webServer.on("/reset", HTTP_POST, handleReset);
-  webServer.on("/api/settings", HTTP_GET, handleApi);
+  // Called on every (re)connect and when the portal starts; register once.
+  static bool started = false;
+  if (started) {
+    return;
+  }
+  started = true;
+
+  webServer.on("/", HTTP_GET, held(handleRoot));
+  webServer.on("/save", HTTP_POST, held(handleSave));
+  webServer.on("/reboot", HTTP_POST, held(handleReboot));
+  webServer.on("/reset", HTTP_POST, held(handleReset));
+  webServer.on("/api/settings", HTTP_GET, held(handleApi));
+  webServer.on("/api/status", HTTP_GET, held(handleStatus));
+  webServer.on("/api/boots", HTTP_GET, held(handleBoots));
+  webServer.on("/api/diag/run", HTTP_POST, held(handleDiagRun));
+  webServer.on("/api/diag/job", HTTP_GET, held(handleDiagJob));
 
   // SPIFFS File API
-  webServer.on("/api/spiffs/list", HTTP_GET, handleSpiffsList);
-  webServer.on("/api/spiffs/read", HTTP_GET, handleSpiffsRead);
-  webServer.on("/api/spiffs/write", HTTP_POST, handleSpiffsWrite);
-  webServer.on("/api/spiffs/delete", HTTP_POST, handleSpiffsDelete);
-  webServer.on("/api/spiffs/info", HTTP_GET, handleSpiffsInfo);
-  webServer.on("/api/spiffs/format", HTTP_POST, handleSpiffsFormat);
+  webServer.on("/api/spiffs/list", HTTP_GET, held(handleSpiffsList));
+  webServer.on("/api/spiffs/read", HTTP_GET, held(handleSpiffsRead));
+  webServer.on("/api/spiffs/write", HTTP_POST, held(handleSpiffsWrite));
+  webServer.on("/api/spiffs/upload", HTTP_POST, held([] { mcp::upload::handleDone(webServer); }),
+               held([] { mcp::upload::handleData(webServer); }));
+  webServer.on("/api/spiffs/delete", HTTP_POST, held(handleSpiffsDelete));
+  webServer.on("/api/spiffs/changes", HTTP_GET, held([] { mcp::changes::handleGet(webServer); }));
+  webServer.on("/api/spiffs/info", HTTP_GET, held(handleSpiffsInfo));
+  webServer.on("/api/spiffs/format", HTTP_POST, held(handleSpiffsFormat));
+
+  // NVS key/value API
+  webServer.on("/api/kv/get", HTTP_GET, held([] { mcp::kv::handleGet(webServer); }));
+  webServer.on("/api/kv/set", HTTP_POST, held([] { mcp::kv::handleSet(webServer); }));
+  webServer.on("/api/kv/delete", HTTP_DELETE, held([] { mcp::kv::handleDelete(webServer); }));
+  webServer.on("/api/kv/list", HTTP_GET, held([] { mcp::kv::handleList(webServer); }));
+  webServer.on("/api/mem/stats", HTTP_GET, held([] { mcp::mem::handleStats(webServer); }));
+  webServer.on("/api/power/stats", HTTP_GET, held([] { mcp::powersave::handleStats(webServer); }));
+#if MCP_TRACE
+  webServer.on("/api/trace", HTTP_GET, held([] { mcp::trace::sendChromeJson(webServer); }));
+#endif
+#if MCP_PROFILE
+  webServer.on("/api/profile/start", HTTP_POST, held([] { mcp::profiler::handleStart(webServer); }));
+  webServer.on("/api/profile/stop", HTTP_POST, held([] { mcp::profiler::handleStop(webServer); }));
+  webServer.on("/api/profile/samples", HTTP_GET, held([] { mcp::profiler::sendSamples(webServer); }));
+#endif
+  webServer.onNotFound(held(handleNotFound));
 
   webServer.begin();
   Serial.println("[WebServer] HTTP server started on port 80");
@@ -754,126 +1092,473 @@ void setupWebServer() {
 // REGISTERED INFO OUTPUT
 // ============================================================
 
-String buildRegisteredInfoString() {
-  // Format: ::RegisteredInfo::["LacisID:xxx","RegisterStatus:xxx","cic:xxx","mainssid:xxx",...]
-  String info = "::RegisteredInfo::[";
-  info += "\"LacisID:" + gLacisId + "\",";
-  info += "\"RegisterStatus:" + String(kRegisterStatus) + "\",";
-  info += "\"cic:" + String(kCic) + "\",";
-  info += "\"mainssid:" + settingMgr.getMainSSID() + "\",";
-  info += "\"mainpass:" + settingMgr.getMainPass() + "\",";
-  info += "\"altssid:" + settingMgr.getAltSSID() + "\",";
-  info += "\"altpass:" + settingMgr.getAltPass() + "\",";
-  info += "\"devssid:" + settingMgr.getDevSSID() + "\",";
-  info += "\"devpass:" + settingMgr.getDevPass() + "\"";
-  info += "]";
-  return info;
-}
-
 void printRegisteredInfo() {
-  Serial.println(buildRegisteredInfoString());
+  // Format: ::RegisteredInfo::["LacisID:xxx","RegisterStatus:xxx","cic:xxx","mainssid:xxx",...]
+  // Written piecewise so the periodic print does not build a String.
+  const DeviceSettings &s = settingMgr.getSettings();
+  const char *fields[][2] = {
+    {"LacisID", gLacisId.c_str()},
+    {"RegisterStatus", kRegisterStatus},
+    {"cic", kCic},
+    {"mainssid", s.mainSSID.c_str()},
+    {"mainpass", s.mainPass.c_str()},
+    {"altssid", s.altSSID.c_str()},
+    {"altpass", s.altPass.c_str()},
+    {"devssid", s.devSSID.c_str()},
+    {"devpass", s.devPass.c_str()},
+  };
+  Serial.print("::RegisteredInfo::[");
+  for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+    if (i > 0) Serial.print(",");
+    Serial.print("\"");
+    Serial.print(fields[i][0]);
+    Serial.print(":");
+    Serial.print(fields[i][1]);
+    Serial.print("\"");
+  }
+  Serial.println("]");
 }
 
 // ============================================================
 // NETWORK DIAGNOSTICS
 // ============================================================
-
-String buildScanSummary(const String &currentSsid, const uint8_t *currentBssid, uint32_t &scanTimeMs) {
+//
+// The periodic path below (scan, probe, report, post) writes into the static
+// report buffers and streams the webhook body, so a steady-state cycle makes
+// no heap allocations outside the Wi-Fi and TLS stacks.
+
+// json (optional): compact [["ssid",ch,rssi],...] for the MQTT snapshot.
+void buildScanSummary(ReportBuffer &out, const uint8_t *currentBssid, uint32_t &scanTimeMs,
+                      ReportBuffer *json = nullptr) {
+  out.clear();
+  if (json) {
+    json->clear();
+    json->add('[');
+  }
+  // Cooperative: this device's channels plus what the peers sent. Their
+  // results are used for up to 1.5 report intervals, so a peer on the same
+  // schedule always has a fresh enough share.
+  const bool coop = coopScan.isActive();
   const unsigned long tScanStart = millis();
-  int16_t n = WiFi.scanNetworks(/*async=*/false, /*show_hidden=*/true);
+  int16_t n;
+  uint8_t coopChannels = 0;
+  {
+    LatencyWatchdog::Scope timing(Stage::Scan);
+    if (coop) {
+      coopChannels = coopScan.scan(settingMgr.getCheckInterval() * 3 / 2);
+      n = coopScan.apCount();
+    } else {
+      n = WiFi.scanNetworks(/*async=*/false, /*show_hidden=*/true);
+    }
+  }
   const unsigned long tScanEnd = millis();
   scanTimeMs = tScanEnd - tScanStart;
   if (n <= 0) {
-    return "AP Scan: no networks found";
+    out.add("AP Scan: no networks found");
+    if (json) json->add(']');
+    if (!coop) WiFi.scanDelete();
+    return;
   }
 
-  // WiFi.scanNetworks returns sorted by RSSI desc on ESP32.
-  String out = "AP Scan (top 5):\n";
+  // WiFi.scanNetworks returns sorted by RSSI desc on ESP32; so is the coop table.
+  if (coop) {
+    out.addf("AP Scan (top 5, %u devices, %u/13 ch here):\n", coopScan.memberCount(), coopChannels);
+  } else {
+    out.add("AP Scan (top 5):\n");
+  }
   for (int i = 0; i < n && i < 5; ++i) {
-    String ssid = WiFi.SSID(i);
-    String bssidStr = macToString(WiFi.BSSID(i));
-    bool isCurrent = (ssid == currentSsid) && (bssidStr == macToString(currentBssid));
-    int32_t rssi = WiFi.RSSI(i);
-    uint8_t enc = WiFi.encryptionType(i);
-    int32_t chan = WiFi.channel(i);
-    out += "- ";
-    if (isCurrent) out += "[CONNECTED] ";
-    out += ssid;
-    out += " (ch";
-    out += chan;
-    out += ", ";
-    out += rssi;
-    out += " dBm, ";
-    out += encTypeToString(enc);
-    out += ")\n";
-  }
-  return out;
+    const uint8_t *bssid;
+    const char *ssid;
+    int channel;
+    int rssi;
+    wifi_auth_mode_t auth;
+    if (coop) {
+      const CoopAp &ap = coopScan.ap(i);
+      bssid = ap.bssid;
+      ssid = ap.ssid;
+      channel = ap.channel;
+      rssi = ap.rssi;
+      auth = (wifi_auth_mode_t)ap.auth;
+    } else {
+      const wifi_ap_record_t *ap = static_cast<const wifi_ap_record_t *>(WiFi.getScanInfoByIndex(i));
+      if (!ap) break;
+      bssid = ap->bssid;
+      ssid = reinterpret_cast<const char *>(ap->ssid);
+      channel = ap->primary;
+      rssi = ap->rssi;
+      auth = ap->authmode;
+    }
+    bool isCurrent = memcmp(bssid, currentBssid, 6) == 0;
+    out.add("- ");
+    if (isCurrent) out.add("[CONNECTED] ");
+    out.add(ssid);
+    out.addf(" (ch%d, %d dBm, %s)\n", channel, rssi, authModeToString(auth));
+    if (json) {
+      json->add(i > 0 ? ",[\"" : "[\"");
+      json->addJsonEscaped(ssid);
+      json->addf("\",%d,%d]", channel, rssi);
+    }
+  }
+  if (json) json->add(']');
+  // The result array is allocated by the WiFi library on SCAN_DONE; release it
+  // now rather than at the next scan so it is not in the way of the TLS handshake.
+  if (!coop) WiFi.scanDelete();
+}
+
+// TCP connect with timeout on a raw lwIP socket (WiFiClient allocates a socket
+// handle and an RX buffer on every connect).
+bool tcpConnect(const IPAddress &ip, uint16_t port, uint32_t timeoutMs) {
+  MCP_TRACE_SCOPE("tcpConnect");
+  int fd = lwip_socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  if (fd < 0) return false;
+  lwip_fcntl(fd, F_SETFL, lwip_fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = (uint32_t)ip;
+
+  bool ok = false;
+  if (lwip_connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0) {
+    ok = true;
+  } else if (errno == EINPROGRESS) {
+    fd_set wfds;
+    FD_ZERO(&wfds);
+    FD_SET(fd, &wfds);
+    struct timeval tv;
+    tv.tv_sec = timeoutMs / 1000;
+    tv.tv_usec = (timeoutMs % 1000) * 1000;
+    if (lwip_select(fd + 1, nullptr, &wfds, nullptr, &tv) > 0) {
+      int err = 0;
+      socklen_t len = sizeof(err);
+      lwip_getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len);
+      ok = err == 0;
+    }
+  }
+  lwip_close(fd);
+  return ok;
 }
 
-String probeTarget(const ProbeTarget &t, uint32_t &elapsedMs) {
+// json (optional): compact ["label",pingMs|-1,[open ports]] for the MQTT snapshot.
+void probeTarget(ReportBuffer &out, const ProbeTarget &t, uint32_t &elapsedMs, ReportBuffer *json = nullptr) {
+  MCP_TRACE_SCOPE(t.label);
   const unsigned long tStart = millis();
+  IPAddress ip;
+  ip.fromString(t.ip);
+
   // "Ping" via TCP connect to port 80 to approximate reachability.
-  WiFiClient client;
-  bool pingOk = false;
-  unsigned long pingTime = 0;
   const unsigned long tPingStart = millis();
-  if (client.connect(t.ip, 80, 800)) {
-    pingOk = true;
-    pingTime = millis() - tPingStart;
-    client.stop();
-  } else {
-    pingTime = millis() - tPingStart;
-  }
+  bool pingOk = tcpConnect(ip, 80, 800);
+  unsigned long pingTime = millis() - tPingStart;
 
-  String result = "- ";
-  result += t.label;
-  result += " (";
-  result += t.ip;
-  result += "): ";
-  result += pingOk ? "ping ok " : "ping fail ";
-  result += String(pingTime);
-  result += "ms; ports: ";
+  out.addf("- %s (%s): %s%lums; ports: ", t.label, t.ip, pingOk ? "ping ok " : "ping fail ", pingTime);
+  if (json) json->addf("[\"%s\",%ld,[", t.label, pingOk ? (long)pingTime : -1L);
 
   bool first = true;
+  bool firstOpen = true;
   for (int port : kPortsToScan) {
-    WiFiClient pc;
-    bool open = pc.connect(t.ip, port, 500);
-    pc.stop();
-    if (!first) result += ", ";
-    result += String(port);
-    result += open ? "=open" : "=closed";
+    bool open = tcpConnect(ip, port, 500);
+    out.addf("%s%d=%s", first ? "" : ", ", port, open ? "open" : "closed");
     first = false;
+    if (json && open) {
+      json->addf("%s%d", firstOpen ? "" : ",", port);
+      firstOpen = false;
+    }
   }
+  if (json) json->add("]]");
 
   elapsedMs = millis() - tStart;
-  result += " (elapsed ";
-  result += elapsedMs;
-  result += "ms)";
-  return result;
+  out.addf(" (elapsed %ums)", elapsedMs);
 }
 
-String buildProbeSummary(uint32_t &probeTimeMs) {
+void buildProbeSummary(ReportBuffer &out, uint32_t &probeTimeMs, ReportBuffer *json = nullptr) {
+  LatencyWatchdog::Scope timing(Stage::Probe);
   const unsigned long tStart = millis();
-  String out = "Reachability (TCP probe):\n";
+  out.clear();
+  out.add("Reachability (TCP probe):\n");
+  if (json) {
+    json->clear();
+    json->add('[');
+  }
   for (size_t i = 0; i < sizeof(kTargets) / sizeof(kTargets[0]); ++i) {
     uint32_t elapsed = 0;
-    out += probeTarget(kTargets[i], elapsed);
-    out += "\n";
+    if (json && i > 0) json->add(',');
+    probeTarget(out, kTargets[i], elapsed, json);
+    out.add('\n');
   }
+  if (json) json->add(']');
   probeTimeMs = millis() - tStart;
-  return out;
 }
 
-void printAndSendStatus(bool forceSend = false) {
+// ---- On-demand diagnostics (diagJobs.h) ----
+// One step per loop(): the scan runs async and is polled, the probe does one
+// target and the DNS check one name per step.
+
+bool diagScanStep(uint16_t step, String &out) {
+  if (step == 0) {
+    if (WiFi.scanNetworks(/*async=*/true, /*show_hidden=*/true) != WIFI_SCAN_FAILED) return false;
+    out += "[]";
+    return true;
+  }
+  const int16_t n = WiFi.scanComplete();
+  if (n == WIFI_SCAN_RUNNING) return false;
+  out += '[';
+  for (int i = 0; i < n; ++i) {
+    const wifi_ap_record_t *ap = static_cast<const wifi_ap_record_t *>(WiFi.getScanInfoByIndex(i));
+    if (!ap) break;
+    out += i > 0 ? ",{\"ssid\":\"" : "{\"ssid\":\"";
+    mcp::appendJsonEscaped(out, reinterpret_cast<const char *>(ap->ssid), strlen(reinterpret_cast<const char *>(ap->ssid)));
+    char bssid[18];
+    snprintf(bssid, sizeof(bssid), "%02X:%02X:%02X:%02X:%02X:%02X", ap->bssid[0], ap->bssid[1], ap->bssid[2],
+             ap->bssid[3], ap->bssid[4], ap->bssid[5]);
+    out += "\",\"bssid\":\"" + String(bssid);
+    out += "\",\"ch\":" + String(ap->primary) + ",\"rssi\":" + String(ap->rssi);
+    out += ",\"auth\":\"" + String(authModeToString(ap->authmode)) + "\"}";
+  }
+  out += ']';
+  WiFi.scanDelete();
+  return true;
+}
+
+bool diagProbeStep(uint16_t step, String &out) {
+  LatencyWatchdog::Scope timing(Stage::Probe);
+  const size_t count = sizeof(kTargets) / sizeof(kTargets[0]);
+  const ProbeTarget &t = kTargets[step];
+  IPAddress ip;
+  ip.fromString(t.ip);
+  const unsigned long tPing = millis();
+  const bool pingOk = tcpConnect(ip, 80, 800);
+  const unsigned long pingMs = millis() - tPing;
+  out += step == 0 ? "[" : ",";
+  out += "{\"label\":\"" + String(t.label) + "\",\"ip\":\"" + String(t.ip) + "\",\"pingMs\":";
+  out += pingOk ? String(pingMs) : String("null");
+  out += ",\"open\":[";
+  bool first = true;
+  for (int port : kPortsToScan) {
+    if (!tcpConnect(ip, port, 500)) continue;
+    if (!first) out += ',';
+    out += String(port);
+    first = false;
+  }
+  out += "]}";
+  if (step + 1u < count) return false;
+  out += ']';
+  return true;
+}
+
+bool diagDnsStep(uint16_t step, String &out) {
+  const size_t fixed = sizeof(kDiagDnsHosts) / sizeof(kDiagDnsHosts[0]);
+  const String &broker = settingMgr.getSettings().mqttHost;
+  const size_t count = fixed + (broker.length() > 0 ? 1 : 0);
+  const char *host = step < fixed ? kDiagDnsHosts[step] : broker.c_str();
+  IPAddress ip;
+  const unsigned long tStart = millis();
+  const bool ok = WiFi.hostByName(host, ip) == 1;
+  const unsigned long ms = millis() - tStart;
+  out += step == 0 ? "[{\"host\":\"" : ",{\"host\":\"";
+  mcp::appendJsonEscaped(out, host, strlen(host));
+  out += "\",\"ip\":";
+  out += ok ? "\"" + ip.toString() + "\"" : String("null");
+  out += ",\"ms\":" + String(ms) + "}";
+  if (step + 1u < count) return false;
+  out += ']';
+  return true;
+}
+
+bool diagStep(DiagType type, uint16_t step, String &out) {
+  switch (type) {
+    case DiagType::Scan:
+      return diagScanStep(step, out);
+    case DiagType::Probe:
+      return diagProbeStep(step, out);
+    default:
+      return diagDnsStep(step, out);
+  }
+}
+
+void printStatus(const wifi_ap_record_t &apInfo, const uint8_t *macSta, const uint8_t *macBt,
+                 unsigned long now) {
+  IPAddress ip = WiFi.localIP();
+  ReportBuffer &out = serialText;
+  out.clear();
+  out.add("---- Network Status ----\n");
+  out.add("Timestamp: ");
+  addTimestamp(out);
+  out.addf("\nLacisID: %s\n", gLacisId.c_str());
+  out.addf("Location: %s\n", settingMgr.getSettings().locationName.c_str());
+  out.addf("Hostname: %s\n", WiFi.getHostname() ? WiFi.getHostname() : "");
+  out.addf("Status: %s\n", wifiStatusToString(WiFi.status()));
+  out.addf("Mode: %s\n", wifiModeToString(WiFi.getMode()));
+  out.addf("SSID: %s\n", reinterpret_cast<const char *>(apInfo.ssid));
+  out.add("BSSID: ");
+  out.addMac(apInfo.bssid);
+  out.addf("\nChannel: %d\n", apInfo.primary);
+  out.addf("RSSI: %d dBm\n", apInfo.rssi);
+  out.addf("Auth: %s\n", authModeToString(apInfo.authmode));
+  out.addf("Pairwise cipher: %s\n", cipherToString(apInfo.pairwise_cipher));
+  out.addf("Group cipher: %s\n", cipherToString(apInfo.group_cipher));
+  out.addf("TX power: %d dBm\n", WiFi.getTxPower());
+  out.add("IP: ");
+  out.addIp(ip);
+  out.add("\nGateway: ");
+  out.addIp(WiFi.gatewayIP());
+  out.add("\nSubnet: ");
+  out.addIp(WiFi.subnetMask());
+  out.add("\nDNS0: ");
+  out.addIp(WiFi.dnsIP());
+  out.add("\nDNS1: ");
+  out.addIp(WiFi.dnsIP(1));
+  out.add("\nBroadcast: ");
+  out.addIp(WiFi.broadcastIP());
+  out.add("\nMAC (WiFi STA): ");
+  out.addMac(macSta);
+  out.add("\nMAC (BT): ");
+  out.addMac(macBt);
+  out.addf("\nFree heap: %u\n", ESP.getFreeHeap());
+  out.addf("Largest free block: %u\n", (unsigned)heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+  out.addf("Uptime ms: %lu\n", now);
+  out.add("SettingURL: http://");
+  out.addIp(ip);
+  out.add("/\n");
+  Serial.write(reinterpret_cast<const uint8_t *>(out.c_str()), out.length());
+  latencyWatchdog.printSummary(Serial);
+  connectTelemetry.printSummary(Serial);
+  Serial.println("------------------------");
+}
+
+// Build the Discord report (ConnectionSummary + Detail + scan/probe + timing).
+void buildStatusText(ReportBuffer &out, const wifi_ap_record_t &apInfo, const uint8_t *macSta,
+                     unsigned long now, uint32_t scanTimeMs, uint32_t probeTimeMs) {
+  IPAddress ip = WiFi.localIP();
+  const DeviceSettings &settings = settingMgr.getSettings();
+  const char *ssid = reinterpret_cast<const char *>(apInfo.ssid);
+  out.clear();
+
+  // ConnectionSummary (ぱっと見でわかるサマリー)
+  out.add("# ConnectionSummary\n");
+  out.addf("**Location:%s**\n", settings.locationName.c_str());
+  out.add("**IP:");
+  out.addIp(ip);
+  out.addf("**\n**%s/rssi:%d**\n", ssid, apInfo.rssi);
+  out.add("SettingURL: http://");
+  out.addIp(ip);
+  out.add("/\n\n");
+
+  // Detail (詳細情報)
+  out.add("# Detail\n---\n");
+  out.addf("LacisID: %s\n", gLacisId.c_str());
+  out.add("Timestamp: ");
+  addTimestamp(out);
+  out.addf("\nHostname: %s\n", WiFi.getHostname() ? WiFi.getHostname() : "");
+  out.add("BSSID: ");
+  out.addMac(apInfo.bssid);
+  out.addf(" / Ch:%d\n", apInfo.primary);
+  out.addf("Auth: %s\n", authModeToString(apInfo.authmode));
+  out.add("IP/GW: ");
+  out.addIp(ip);
+  out.add(" / ");
+  out.addIp(WiFi.gatewayIP());
+  out.add("\nSubnet: ");
+  out.addIp(WiFi.subnetMask());
+  out.add(" / DNS: ");
+  out.addIp(WiFi.dnsIP());
+  out.add("\nMAC: ");
+  out.addMac(macSta);
+  out.addf("\nHeap: %u (max blk %u) / Up: %lus\n\n", ESP.getFreeHeap(),
+           (unsigned)heap_caps_get_largest_free_block(MALLOC_CAP_8BIT), now / 1000);
+
+  // AP Scan Summary (トップ5に制限)
+  out.add(scanSummary.c_str(), scanSummary.length());
+  out.add('\n');
+
+  // Reachability Probe Summary
+  out.add(probeSummary.c_str(), probeSummary.length());
+
+  // Timing section
+  out.add("--- Timing ---\n");
+  out.addf("Scan:%ums Probe:%ums\n", scanTimeMs, probeTimeMs);
+  if (const JoinAttempt* join = connectTelemetry.lastSuccess()) {
+    out.addf("Join:%s Link:%ums DHCP:%ums Attempts:%u\n", join->label, join->linkMs, join->dhcpMs,
+             connectTelemetry.getAttemptCount());
+  }
+  if (settings.deepSleep) {
+    const RtcState &rtc = sleepMgr.getState();
+    out.addf("Wake:%s Cycle:%u Connect:%ums(%s)\n", sleepMgr.wakeReasonString(), rtc.cycle,
+             sleepMgr.getConnectMs(), sleepMgr.wasFastConnect() ? "fast" : "full");
+    out.addf("Awake:%ums PrevWakeToSleep:%ums FastFail:%u\n", sleepMgr.awakeMs(),
+             rtc.lastWakeToSleepMs, rtc.fastConnectFails);
+  }
+}
+
+// MQTT snapshot: one compact JSON object per report, short keys.
+void buildSnapshotJson(ReportBuffer &out, const wifi_ap_record_t &apInfo, unsigned long now,
+                       uint32_t scanTimeMs, uint32_t probeTimeMs) {
+  out.clear();
+  out.add("{\"ts\":\"");
+  addTimestamp(out);
+  out.addf("\",\"up\":%lu,\"loc\":\"", now / 1000);
+  out.addJsonEscaped(settingMgr.getSettings().locationName.c_str());
+  out.add("\",\"ssid\":\"");
+  out.addJsonEscaped(reinterpret_cast<const char *>(apInfo.ssid));
+  out.add("\",\"bssid\":\"");
+  out.addMac(apInfo.bssid);
+  out.addf("\",\"ch\":%d,\"rssi\":%d,\"ip\":\"", apInfo.primary, apInfo.rssi);
+  out.addIp(WiFi.localIP());
+  out.addf("\",\"heap\":%u,\"blk\":%u,\"scanMs\":%u,\"probeMs\":%u", ESP.getFreeHeap(),
+           (unsigned)heap_caps_get_largest_free_block(MALLOC_CAP_8BIT), scanTimeMs, probeTimeMs);
+  if (const JoinAttempt *join = connectTelemetry.lastSuccess()) {
+    out.addf(",\"join\":[\"%s\",%u,%u]", join->label, join->linkMs, join->dhcpMs);
+  }
+  if (settingMgr.getDeepSleep()) {
+    out.addf(",\"cycle\":%u,\"connectMs\":%u", sleepMgr.getState().cycle, sleepMgr.getConnectMs());
+  }
+  out.add(",\"aps\":");
+  out.add(scanJson.c_str(), scanJson.length());
+  out.add(",\"probe\":");
+  out.add(probeJson.c_str(), probeJson.length());
+  out.add('}');
+}
+
+// MQTT mode: queue the snapshot on <root>/<LacisID>/status. In deep sleep
+// mode wait for the PUBACK; the socket dies with the sleep, so the broker
+// publishes the "online"=0 will while the device is asleep.
+bool publishSnapshot(const wifi_ap_record_t &apInfo, unsigned long now, uint32_t scanTimeMs,
+                     uint32_t probeTimeMs) {
+  buildSnapshotJson(snapshotJson, apInfo, now, scanTimeMs, probeTimeMs);
+  if (snapshotJson.truncated()) {
+    Serial.println("[MQTT] Snapshot truncated");
+  }
+  LatencyWatchdog::Scope postTiming(Stage::Post);
+  mqtt.publish("status", snapshotJson.c_str(), snapshotJson.length());
+  if (!settingMgr.getDeepSleep()) {
+    return true;
+  }
+  bool acked = mqtt.flush(MQTT_TIMEOUT_MS);
+  Serial.printf("[MQTT] Snapshot %s\n", acked ? "acknowledged" : "not acknowledged");
+  return acked;
+}
+
+// Compression of the last webhook request body (gzip mode only).
+void printPostCompression() {
+  if (!webhook.wasCompressed() || webhook.getBodyBytes() == 0) return;
+  Serial.printf("[Webhook] gzip body %u -> %u bytes (%u%%), deflate %lu us\n", (unsigned)webhook.getBodyBytes(),
+                (unsigned)webhook.getWireBytes(), (unsigned)(webhook.getWireBytes() * 100 / webhook.getBodyBytes()),
+                (unsigned long)webhook.getDeflateUs());
+}
+
+// Returns true when a webhook post was made and accepted (2xx), or the MQTT
+// snapshot was queued (acknowledged, in deep sleep mode).
+bool printAndSendStatus(bool forceSend = false) {
   const unsigned long tStart = millis();
   if (WiFi.status() != WL_CONNECTED) {
     Serial.println("WiFi not connected; skipping status post.");
-    return;
+    return false;
   }
 
   wifi_ap_record_t apInfo{};
   esp_wifi_sta_get_ap_info(&apInfo);
-  currentConnectedSSID = WiFi.SSID();
+  memcpy(currentConnectedSSID, apInfo.ssid, sizeof(currentConnectedSSID));
   currentRSSI = apInfo.rssi;
 
   uint8_t macSta[6];
@@ -881,50 +1566,10 @@ void printAndSendStatus(bool forceSend = false) {
   uint8_t macBt[6];
   esp_read_mac(macBt, ESP_MAC_BT);
 
-  IPAddress ip = WiFi.localIP();
-  IPAddress gw = WiFi.gatewayIP();
-  IPAddress sn = WiFi.subnetMask();
-  IPAddress dns = WiFi.dnsIP();
-  IPAddress bcast = WiFi.broadcastIP();
-  IPAddress dns1 = WiFi.dnsIP(1);
-  String hostname = WiFi.getHostname() ? WiFi.getHostname() : "";
-
-  // AP scan + probe targets (timed)
-  uint32_t scanTimeMs = 0;
-  uint32_t probeTimeMs = 0;
-  lastScanSummary = buildScanSummary(WiFi.SSID(), apInfo.bssid, scanTimeMs);
-  lastProbeSummary = buildProbeSummary(probeTimeMs);
-
   unsigned long now = millis();
   if (now - lastStatusPrint >= kStatusPollMs || forceSend) {
     lastStatusPrint = now;
-    Serial.println("---- Network Status ----");
-    Serial.printf("Timestamp: %s\n", formatTimestamp().c_str());
-    Serial.printf("LacisID: %s\n", gLacisId.c_str());
-    Serial.printf("Location: %s\n", settingMgr.getLocationName().c_str());
-    Serial.printf("Hostname: %s\n", hostname.c_str());
-    Serial.printf("Status: %s\n", wifiStatusToString(WiFi.status()).c_str());
-    Serial.printf("Mode: %s\n", wifiModeToString(WiFi.getMode()).c_str());
-    Serial.printf("SSID: %s\n", WiFi.SSID().c_str());
-    Serial.printf("BSSID: %s\n", macToString(apInfo.bssid).c_str());
-    Serial.printf("Channel: %d\n", apInfo.primary);
-    Serial.printf("RSSI: %d dBm\n", apInfo.rssi);
-    Serial.printf("Auth: %s\n", authModeToString(apInfo.authmode).c_str());
-    Serial.printf("Pairwise cipher: %s\n", cipherToString(apInfo.pairwise_cipher).c_str());
-    Serial.printf("Group cipher: %s\n", cipherToString(apInfo.group_cipher).c_str());
-    Serial.printf("TX power: %d dBm\n", WiFi.getTxPower());
-    Serial.printf("IP: %s\n", ip.toString().c_str());
-    Serial.printf("Gateway: %s\n", gw.toString().c_str());
-    Serial.printf("Subnet: %s\n", sn.toString().c_str());
-    Serial.printf("DNS0: %s\n", dns.toString().c_str());
-    Serial.printf("DNS1: %s\n", dns1.toString().c_str());
-    Serial.printf("Broadcast: %s\n", bcast.toString().c_str());
-    Serial.printf("MAC (WiFi STA): %s\n", macToString(macSta).c_str());
-    Serial.printf("MAC (BT): %s\n", macToString(macBt).c_str());
-    Serial.printf("Free heap: %u\n", ESP.getFreeHeap());
-    Serial.printf("Uptime ms: %lu\n", now);
-    Serial.printf("SettingURL: http://%s/\n", ip.toString().c_str());
-    Serial.println("------------------------");
+    printStatus(apInfo, macSta, macBt, now);
   }
 
   // Print RegisteredInfo every 5 minutes
@@ -936,133 +1581,206 @@ void printAndSendStatus(bool forceSend = false) {
   // Use checkInterval from settings
   unsigned long postInterval = settingMgr.getCheckInterval();
   if (!forceSend && (now - lastPost) < postInterval) {
-    return;
+    return false;
   }
   lastPost = now;
 
-  // Build status text with ConnectionSummary at the top
-  // 仕様書通りのフォーマット (Discord 2000文字制限に注意)
-  String statusText;
-  statusText.reserve(2000);
-  
-  // ConnectionSummary (ぱっと見でわかるサマリー)
-  statusText += "# ConnectionSummary\n";
-  statusText += "**Location:" + settingMgr.getLocationName() + "**\n";
-  statusText += "**IP:" + ip.toString() + "**\n";
-  statusText += "**" + WiFi.SSID() + "/rssi:" + String(apInfo.rssi) + "**\n";
-  statusText += "SettingURL: http://" + ip.toString() + "/\n\n";
-  
-  // Detail (詳細情報)
-  statusText += "# Detail\n---\n";
-  statusText += "LacisID: " + gLacisId + "\n";
-  statusText += "Timestamp: " + formatTimestamp() + "\n";
-  statusText += "Hostname: " + hostname + "\n";
-  statusText += "BSSID: " + macToString(apInfo.bssid) + " / Ch:" + String(apInfo.primary) + "\n";
-  statusText += "Auth: " + authModeToString(apInfo.authmode) + "\n";
-  statusText += "IP/GW: " + ip.toString() + " / " + gw.toString() + "\n";
-  statusText += "Subnet: " + sn.toString() + " / DNS: " + dns.toString() + "\n";
-  statusText += "MAC: " + macToString(macSta) + "\n";
-  statusText += "Heap: " + String(ESP.getFreeHeap()) + " / Up: " + String(now/1000) + "s\n";
-  statusText += "\n";
-  
-  // AP Scan Summary (トップ5に制限)
-  statusText += lastScanSummary + "\n";
-  
-  // Reachability Probe Summary
-  statusText += lastProbeSummary;
-
-  // Timing section
-  const unsigned long tInfoDone = millis();
-  statusText += "--- Timing ---\n";
-  statusText += "Scan:" + String(scanTimeMs) + "ms Probe:" + String(probeTimeMs) + "ms\n";
-  
-  String combinedPlaceholder = statusText;
+  // AP scan + probe targets (timed); only needed for the report.
+  uint32_t scanTimeMs = 0;
+  uint32_t probeTimeMs = 0;
+  const bool useMqtt = mqtt.isEnabled();
+  buildScanSummary(scanSummary, apInfo.bssid, scanTimeMs, useMqtt ? &scanJson : nullptr);
+  buildProbeSummary(probeSummary, probeTimeMs, useMqtt ? &probeJson : nullptr);
+  if (useMqtt) {
+    return publishSnapshot(apInfo, now, scanTimeMs, probeTimeMs);
+  }
 
-  String payload = "{";
-  payload += "\"username\":\"ESP32 aranea Device\",";
-  payload += "\"content\":\"" + jsonEscape(combinedPlaceholder) + "\",";
-  payload += "\"allowed_mentions\":{\"parse\":[]}";
-  payload += "}";
-  const unsigned long tPayloadBuilt = millis();
+  // 仕様書通りのフォーマット (Discord 2000文字制限に注意)
+  buildStatusText(statusText, apInfo, macSta, now, scanTimeMs, probeTimeMs);
 
   secureClient.setInsecure();  // Discord uses valid certs; skip validation for brevity.
-
-  HTTPClient http;
-  if (http.begin(secureClient, kWebhookUrlWait)) {
-    http.addHeader("Content-Type", "application/json");
-    const unsigned long tPostStart = millis();
-    int code = http.POST(payload);
-    const unsigned long tPostEnd = millis();
-    const unsigned long tTotal = tPostEnd - tStart;
-
-    String resp = http.getString();
-    Serial.printf("Webhook POST response code: %d\n", code);
-    Serial.printf("Webhook response body: %s\n", resp.c_str());
-    String messageId = extractMessageId(resp);
-    http.end();
-
-    // Build final message with real timings.
-    String combinedFinal = statusText + "---\nPost: " + String(tTotal) + "ms";
-    String finalPayload = "{";
-    finalPayload += "\"username\":\"ESP32 aranea Device\",";
-    finalPayload += "\"content\":\"" + jsonEscape(combinedFinal) + "\",";
-    finalPayload += "\"allowed_mentions\":{\"parse\":[]}";
-    finalPayload += "}";
-
-    if (messageId.length() > 0 && http.begin(secureClient, buildEditUrl(messageId))) {
-      http.addHeader("Content-Type", "application/json");
-      code = http.PATCH(finalPayload);
-      String resp2 = http.getString();
+  webhook.setGzip(settingMgr.getWebhookGzip());
+
+  LatencyWatchdog::Scope postTiming(Stage::Post);
+  bool posted = false;
+  int code = webhook.postMessage(kWebhookUrl, kReportUsername, statusText.c_str(), statusText.length());
+  const unsigned long tTotal = millis() - tStart;
+  Serial.printf("Webhook POST response code: %d\n", code);
+  Serial.print("Webhook response body: ");
+  Serial.println(webhook.getResponseSnippet());
+  printPostCompression();
+  posted = code >= 200 && code < 300;
+
+  if (code > 0) {
+    // Final message with real timings: same text plus the post time.
+    statusText.addf("---\nPost: %lums", tTotal);
+    if (webhook.wasCompressed()) {
+      statusText.addf(" (gzip %u->%uB, %luus)", (unsigned)webhook.getBodyBytes(), (unsigned)webhook.getWireBytes(),
+                      (unsigned long)webhook.getDeflateUs());
+    }
+    const char *messageId = webhook.getMessageId();
+    if (messageId[0] != '\0') {
+      code = webhook.editMessage(kWebhookUrl, messageId, kReportUsername, statusText.c_str(), statusText.length());
       Serial.printf("Webhook PATCH response code: %d\n", code);
-      Serial.printf("Webhook PATCH body: %s\n", resp2.c_str());
-      http.end();
+      Serial.print("Webhook PATCH body: ");
+      Serial.println(webhook.getResponseSnippet());
+      printPostCompression();
     } else {
       // Fallback: post a second message with final timings.
-      if (http.begin(secureClient, kWebhookUrl)) {
-        http.addHeader("Content-Type", "application/json");
-        code = http.POST(finalPayload);
-        String resp2 = http.getString();
-        Serial.printf("Webhook POST (fallback) code: %d\n", code);
-        Serial.printf("Webhook POST (fallback) body: %s\n", resp2.c_str());
-        http.end();
-      }
+      code = webhook.postMessage(kWebhookUrl, kReportUsername, statusText.c_str(), statusText.length());
+      Serial.printf("Webhook POST (fallback) code: %d\n", code);
+      Serial.print("Webhook POST (fallback) body: ");
+      Serial.println(webhook.getResponseSnippet());
+      printPostCompression();
     }
   } else {
-    Serial.println("Failed to begin HTTP connection to webhook.");
+    Serial.println("Failed to connect to webhook.");
   }
+  // Release the TLS session between reports; it is not reused 10 minutes later.
+  webhook.stop();
+  return posted;
 }
 
 // ============================================================
 // WIFI CONNECTION WITH FALLBACK
 // ============================================================
 
-bool tryConnectWifi(const String& ssid, const String& password, const String& label) {
+bool tryConnectWifi(const String& ssid, const String& password, const String& label,
+                    uint8_t maxAttempts = kMaxConnectAttempts) {
   Serial.printf("Trying SSID [%s]: %s\n", label.c_str(), ssid.c_str());
   
   WiFi.disconnect(true);
   delay(200);
+  connectTelemetry.startAttempt(label.c_str());
   WiFi.begin(ssid.c_str(), password.c_str());
   
+  // Poll finely so the join time is not rounded up to kReconnectDelayMs;
+  // status is still printed once per kReconnectDelayMs.
+  const unsigned long tStart = millis();
   uint8_t attempts = 0;
-  while (WiFi.status() != WL_CONNECTED && attempts < kMaxConnectAttempts) {
-    attempts++;
-    Serial.printf("  Attempt %u/%u; status=%d\n", attempts, kMaxConnectAttempts, WiFi.status());
-    delay(kReconnectDelayMs);
+  while (WiFi.status() != WL_CONNECTED && attempts < maxAttempts) {
+    if (millis() - tStart >= (attempts + 1) * kReconnectDelayMs) {
+      attempts++;
+      Serial.printf("  Attempt %u/%u; status=%d\n", attempts, maxAttempts, WiFi.status());
+    }
+    delay(kConnectPollMs);
   }
   
+  connectTelemetry.endAttempt();
   return WiFi.status() == WL_CONNECTED;
 }
 
-void connectWifi() {
-  WiFi.mode(WIFI_STA);
-  WiFi.disconnect(true);
-  delay(200);
+// WiFi credentials from settings, in fallback order: main -> alt -> dev
+struct WifiCred {
+  String ssid;
+  String pass;
+  String label;
+};
+
+WifiCred getWifiCred(int index) {
+  switch (index) {
+    case 0:
+      return {settingMgr.getMainSSID(), settingMgr.getMainPass(), "main"};
+    case 1:
+      return {settingMgr.getAltSSID(), settingMgr.getAltPass(), "alt"};
+    default:
+      return {settingMgr.getDevSSID(), settingMgr.getDevPass(), "dev"};
+  }
+}
 
+void initDeviceIdentity() {
   // Generate LacisID from MAC
   uint8_t macSta[6];
   esp_efuse_mac_get_default(macSta);
   gLacisId = generateLacisId(macSta);
   gHostname = makeHostName(macSta);
+  configureMqtt();  // client id is the LacisID
+}
+
+// Services, NTP and the first report once STA is up.
+void onWifiConnected() {
+  bootTimeline.mark(BootPhase::WifiConnect);
+  if (!MDNS.begin(gHostname.c_str())) {
+    Serial.println("mDNS start failed");
+  } else {
+    MDNS.addService("http", "tcp", 80);
+  }
+  NBNS.begin(gHostname.c_str());
+  bootTimeline.mark(BootPhase::Mdns);
+
+  // Start HTTP server
+  setupWebServer();
+
+  // NTP sync once per connect.
+  timeSynced = syncTimeWithNtp();
+
+  // Rejoin the scan group (the membership does not survive a reconnect)
+  coopScan.end();
+  configureCoopScan();
+
+  // Print RegisteredInfo and send status
+  printRegisteredInfo();
+  bootTimeline.completeReport(printAndSendStatus(true));
+}
+
+void startCaptivePortal() {
+  if (captivePortal.begin(PORTAL_AP_PREFIX + gHostname.substring(gHostname.length() - 6))) {
+    setupWebServer();
+  }
+}
+
+// Background STA retry while the portal is up. One SSID attempt at a time,
+// polled from loop() so DNS and HTTP keep being served.
+void serviceStaRetry() {
+  if (WiFi.status() == WL_CONNECTED) {
+    connectTelemetry.endAttempt();
+    Serial.printf("WiFi connected via [%s] after %u background retries\n",
+                  getWifiCred(currentWifiIndex).label.c_str(), captivePortal.getRetryCount());
+    staRetryIndex = -1;
+    captivePortal.end();
+    onWifiConnected();
+    return;
+  }
+
+  int next;
+  if (staRetryIndex < 0) {
+    if (!captivePortal.retryDue()) {
+      return;
+    }
+    captivePortal.retryStarted();
+    next = 0;
+  } else if (millis() - staRetryStartMs < PORTAL_ATTEMPT_MS) {
+    return;
+  } else {
+    connectTelemetry.endAttempt();
+    next = staRetryIndex + 1;
+  }
+
+  for (; next < 3; next++) {
+    WifiCred cred = getWifiCred(next);
+    if (cred.ssid.length() == 0) continue;
+    Serial.printf("Background retry SSID [%s]: %s\n", cred.label.c_str(), cred.ssid.c_str());
+    WiFi.disconnect(false);  // keep the SoftAP up
+    connectTelemetry.startAttempt(cred.label.c_str());
+    WiFi.begin(cred.ssid.c_str(), cred.pass.c_str());
+    staRetryIndex = next;
+    currentWifiIndex = next;
+    staRetryStartMs = millis();
+    return;
+  }
+
+  // Every SSID failed this round.
+  WiFi.disconnect(false);
+  staRetryIndex = -1;
+  captivePortal.retryFailed();
+}
+
+void connectWifi() {
+  WiFi.mode(WIFI_STA);
+  WiFi.disconnect(true);
+  delay(200);
+
+  initDeviceIdentity();
   WiFi.setHostname(gHostname.c_str());
   
   Serial.println("========================================");
@@ -1075,62 +1793,183 @@ void connectWifi() {
   // Print RegisteredInfo at startup
   printRegisteredInfo();
   
-  // WiFi credentials from settings
-  struct WifiCred {
-    String ssid;
-    String pass;
-    String label;
-  };
+  WifiCred creds[3] = {getWifiCred(0), getWifiCred(1), getWifiCred(2)};
   
-  WifiCred creds[3] = {
-    {settingMgr.getMainSSID(), settingMgr.getMainPass(), "main"},
-    {settingMgr.getAltSSID(), settingMgr.getAltPass(), "alt"},
-    {settingMgr.getDevSSID(), settingMgr.getDevPass(), "dev"}
-  };
-  
-  // Try connecting with fallback: main -> alt -> dev, 3 rounds
-  bool connected = false;
+  {
+    // Connect rounds count as the wifiConnect stage.
+    LatencyWatchdog::Scope timing(Stage::WifiConnect);
+    // Try connecting with fallback: main -> alt -> dev
+    bool connected = false;
   
-  for (int round = 0; round < kWifiRounds && !connected; round++) {
-    Serial.printf("\n--- WiFi Connection Round %d/%d ---\n", round + 1, kWifiRounds);
+    for (int round = 0; round < kWifiRounds && !connected; round++) {
+      Serial.printf("\n--- WiFi Connection Round %d/%d ---\n", round + 1, kWifiRounds);
     
-    for (int i = 0; i < 3 && !connected; i++) {
-      if (creds[i].ssid.length() > 0) {
-        connected = tryConnectWifi(creds[i].ssid, creds[i].pass, creds[i].label);
-        if (connected) {
-          currentWifiIndex = i;
-          Serial.printf("WiFi connected via [%s]!\n", creds[i].label.c_str());
-          break;
+      for (int i = 0; i < 3 && !connected; i++) {
+        if (creds[i].ssid.length() > 0) {
+          connected = tryConnectWifi(creds[i].ssid, creds[i].pass, creds[i].label);
+          if (connected) {
+            currentWifiIndex = i;
+            Serial.printf("WiFi connected via [%s]!\n", creds[i].label.c_str());
+            break;
+          }
         }
       }
     }
-  }
   
+    if (!connected) {
+      Serial.println("All WiFi attempts failed. Starting setup AP; retrying in the background.");
+      // Print RegisteredInfo even on failure
+      printRegisteredInfo();
+      startCaptivePortal();
+      return;
+    }
+  }
+
+  onWifiConnected();
+}
+
+// ============================================================
+// DEEP SLEEP DUTY CYCLE
+// ============================================================
+
+// Remember the AP and lease we are connected to, for the next wake.
+void cacheConnectedAp(int credIndex, bool fromDhcp) {
+  wifi_ap_record_t apInfo{};
+  if (esp_wifi_sta_get_ap_info(&apInfo) != ESP_OK) {
+    return;
+  }
+  sleepMgr.saveAp(credIndex, apInfo.bssid, apInfo.primary,
+                  WiFi.localIP(), WiFi.gatewayIP(), WiFi.subnetMask(),
+                  WiFi.dnsIP(0), WiFi.dnsIP(1), fromDhcp);
+}
+
+// Join the AP cached in RTC memory: the BSSID/channel hint skips the
+// all-channel scan, and while the lease is fresh a static config skips DHCP.
+bool fastConnectWifi() {
+  if (!sleepMgr.hasCachedAp()) {
+    return false;
+  }
+  const RtcState& rtc = sleepMgr.getState();
+  WifiCred cred = getWifiCred(rtc.credIndex);
+  if (cred.ssid.length() == 0) {
+    sleepMgr.invalidateAp();
+    return false;
+  }
+
+  const bool reuseLease = sleepMgr.canReuseLease();
+  if (reuseLease) {
+    WiFi.config(IPAddress(rtc.ip), IPAddress(rtc.gateway), IPAddress(rtc.subnet),
+                IPAddress(rtc.dns0), IPAddress(rtc.dns1));
+  }
+  Serial.printf("Fast connect [%s]: %s ch%u%s\n", cred.label.c_str(), cred.ssid.c_str(),
+                rtc.channel, reuseLease ? " (cached lease)" : "");
+  connectTelemetry.startAttempt("fast", true);
+  WiFi.begin(cred.ssid.c_str(), cred.pass.c_str(), rtc.channel, rtc.bssid);
+
+  const unsigned long tStart = millis();
+  while (WiFi.status() != WL_CONNECTED && millis() - tStart < kFastConnectTimeoutMs) {
+    delay(10);
+  }
+  connectTelemetry.endAttempt();
+  if (WiFi.status() != WL_CONNECTED) {
+    Serial.println("Fast connect failed; falling back to full connect.");
+    WiFi.disconnect(true);
+    if (reuseLease) {
+      WiFi.config(IPAddress(), IPAddress(), IPAddress());  // back to DHCP
+    }
+    sleepMgr.invalidateAp();
+    sleepMgr.recordFastConnectFailure();
+    return false;
+  }
+
+  currentWifiIndex = rtc.credIndex;
+  cacheConnectedAp(currentWifiIndex, !reuseLease);
+  return true;
+}
+
+// One pass over main -> alt -> dev with a short per-SSID budget.
+bool fullConnectWifiOnce() {
+  for (int i = 0; i < 3; i++) {
+    WifiCred cred = getWifiCred(i);
+    if (cred.ssid.length() == 0) continue;
+    if (tryConnectWifi(cred.ssid, cred.pass, cred.label, kDutyConnectAttempts)) {
+      currentWifiIndex = i;
+      cacheConnectedAp(i, true);
+      return true;
+    }
+  }
+  return false;
+}
+
+// Wake -> connect -> report -> deep sleep. After a button wake (or cold boot)
+// the web UI stays up for uiWindowSec first; loop() puts the device to sleep.
+void startDutyCycle() {
+  const bool uiWake = sleepMgr.getWakeReason() != WakeReason::Timer;
+  const unsigned long intervalMs = settingMgr.getCheckInterval();
+
+  initDeviceIdentity();
+  WiFi.persistent(false);  // No NVS writes on every wake.
+  WiFi.mode(WIFI_STA);
+  WiFi.setHostname(gHostname.c_str());
+
+  const unsigned long tConnect = millis();
+  bool fast;
+  bool connected;
+  {
+    LatencyWatchdog::Scope timing(Stage::WifiConnect);
+    fast = fastConnectWifi();
+    connected = fast || fullConnectWifiOnce();
+  }
+  sleepMgr.recordConnect(millis() - tConnect, fast);
+
   if (!connected) {
-    Serial.println("All WiFi attempts failed. Waiting 10 minutes before retry...");
-    // Print RegisteredInfo even on failure
     printRegisteredInfo();
-    delay(kWifiRetryWaitMs);
-    return;
+    if (uiWake) {
+      // Someone is on site: offer the setup AP for the UI window instead of
+      // going straight back to sleep with bad credentials.
+      Serial.println("All WiFi attempts failed; setup AP open for the UI window.");
+      startCaptivePortal();
+      uiWindowEndMs = millis() + settingMgr.getUiWindowSec() * 1000UL;
+      return;
+    }
+    Serial.println("All WiFi attempts failed; sleeping until the next slot.");
+    sleepMgr.sleepUntilNextSlot(intervalMs);
   }
+  bootTimeline.mark(BootPhase::WifiConnect);
+  Serial.printf("WiFi connected via [%s] in %u ms (%s)\n", getWifiCred(currentWifiIndex).label.c_str(),
+                sleepMgr.getConnectMs(), fast ? "fast" : "full");
 
-  // Successfully connected
-  if (!MDNS.begin(gHostname.c_str())) {
-    Serial.println("mDNS start failed");
-  } else {
-    MDNS.addService("http", "tcp", 80);
+  // The RTC keeps wall-clock time through deep sleep; NTP only occasionally.
+  if (sleepMgr.needsTimeSync()) {
+    if (syncTimeWithNtp()) sleepMgr.markTimeSynced();
   }
-  NBNS.begin(gHostname.c_str());
+  timeSynced = sleepMgr.isTimeSynced();
 
-  // Start HTTP server
-  setupWebServer();
+  if (uiWake) {
+    if (!MDNS.begin(gHostname.c_str())) {
+      Serial.println("mDNS start failed");
+    } else {
+      MDNS.addService("http", "tcp", 80);
+    }
+    NBNS.begin(gHostname.c_str());
+    bootTimeline.mark(BootPhase::Mdns);
+    setupWebServer();
+    printRegisteredInfo();
+  }
 
-  // NTP sync once per connect.
-  timeSynced = syncTimeWithNtp();
+  bool posted = printAndSendStatus(true);
+  bootTimeline.completeReport(posted);
+  if (!posted && fast && sleepMgr.canReuseLease()) {
+    // A stale lease can look connected but not route; use DHCP next time.
+    sleepMgr.invalidateAp();
+  }
 
-  // Print RegisteredInfo and send status
-  printRegisteredInfo();
-  printAndSendStatus(true);
+  if (!uiWake) {
+    sleepMgr.sleepUntilNextSlot(intervalMs);
+  }
+  uiWindowEndMs = millis() + settingMgr.getUiWindowSec() * 1000UL;
+  Serial.printf("Web UI open for %lu sec: http://%s/\n", settingMgr.getUiWindowSec(),
+                WiFi.localIP().toString().c_str());
 }
 
 // ============================================================
@@ -1139,28 +1978,88 @@ void connectWifi() {
 
 void setup() {
   Serial.begin(115200);
-  delay(500);
+  // Before the first large allocation: on a WROVER, buffers and Strings of
+  // MCP_PSRAM_THRESHOLD bytes or more go to PSRAM from here on.
+  mcp::mem::begin();
+  bootTimeline.begin();
+  sleepMgr.begin();
+  if (sleepMgr.getWakeReason() != WakeReason::Timer) {
+    delay(500);
+  }
   
   // Initialize SPIFFS and load settings
   if (!settingMgr.begin()) {
     Serial.println("Settings initialization failed!");
     // Continue anyway with defaults
   }
+  bootTimeline.mark(BootPhase::Settings);
+  latencyWatchdog.setBudgetMs(settingMgr.getLoopBudgetMs());
+  applyPowerSave();
+  diagJobs.begin(diagStep);
+  connectTelemetry.begin();
   
+  if (settingMgr.getDeepSleep()) {
+    startDutyCycle();
+    return;
+  }
   connectWifi();
 }
 
 void loop() {
+  latencyWatchdog.beginIteration();
+  bootTimeline.tick();
+
   // Handle HTTP requests
-  webServer.handleClient();
+  {
+    LatencyWatchdog::Scope timing(Stage::HandleClient);
+    webServer.handleClient();
+    mcp::changes::poll();  // answer /api/spiffs/changes waiters
+    mcp::powersave::poll();
+  }
+  diagJobs.loop();  // one step of an on-demand diagnostic, if one is queued
+
+  if (settingMgr.getDeepSleep()) {
+    captivePortal.loop();
+    mqtt.loop();
+    latencyWatchdog.endIteration();
+    // Deep sleep mode only gets here while the web UI window is open.
+    if ((long)(millis() - uiWindowEndMs) >= 0) {
+      sleepMgr.sleepUntilNextSlot(settingMgr.getCheckInterval());
+    }
+    delay(2);
+    return;
+  }
   
+  if (captivePortal.isActive()) {
+    captivePortal.loop();
+    serviceStaRetry();
+    latencyWatchdog.endIteration();
+    delay(10);  // Keep DNS / HTTP responsive for the phone on the portal.
+    return;
+  }
+
   if (WiFi.status() != WL_CONNECTED) {
+    mqtt.loop();  // closes the MQTT socket; the outbox is kept for the reconnect
     connectWifi();
+    latencyWatchdog.endIteration();
     delay(1000);
     return;
   }
 
-  // Refresh AP info and send periodically.
-  printAndSendStatus();
-  delay(1000);
+  // Keep the MQTT session alive (connect, acks, pings); no-op in webhook mode.
+  {
+    LatencyWatchdog::Scope timing(Stage::Post);
+    mqtt.loop();
+  }
+  coopScan.loop();  // peers' HELLOs and scan results
+
+  // Refresh AP info and send periodically. Not while an on-demand diagnostic
+  // runs: its async scan would make the report's scan fail.
+  if (!diagJobs.busy()) {
+    printAndSendStatus();
+  }
+  // The idle delay below is deliberate and not counted against the budget;
+  // short while a diagnostic has steps left.
+  latencyWatchdog.endIteration();
+  delay(diagJobs.busy() ? 10 : 1000);
 }
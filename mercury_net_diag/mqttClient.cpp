@@ -0,0 +1,462 @@
+/**
+ * mqttClient.cpp
+ * Minimal MQTT 3.1.1 QoS1 publisher for aranea device
+ */
+
+#include "mqttClient.h"
+#include <McpTrace.h>
+
+// Packet types (fixed header, high nibble)
+#define MQTT_CONNECT 0x10
+#define MQTT_CONNACK 0x20
+#define MQTT_PUBLISH 0x30
+#define MQTT_PUBACK 0x40
+#define MQTT_PINGREQ 0xC0
+#define MQTT_PINGRESP 0xD0
+#define MQTT_DISCONNECT 0xE0
+
+// CONNECT flags
+#define MQTT_FLAG_USER 0x80
+#define MQTT_FLAG_PASS 0x40
+#define MQTT_FLAG_WILL_RETAIN 0x20
+#define MQTT_FLAG_WILL_QOS1 0x08
+#define MQTT_FLAG_WILL 0x04
+
+static const char kOnlineTopic[] = "online";
+
+static void copyField(char* dst, size_t cap, const char* src) {
+  strncpy(dst, src ? src : "", cap - 1);
+  dst[cap - 1] = '\0';
+}
+
+MqttClient::MqttClient(WiFiClient& plain, WiFiClientSecure& secure)
+    : plain(plain), secure(secure), port(MQTT_DEFAULT_PORT), tls(false),
+      keepAliveSec(MQTT_DEFAULT_KEEPALIVE_SEC), connected(false), sessionPresent(false),
+      nextAttemptMs(0), backoffMs(MQTT_RETRY_MIN_MS), lastTxMs(0), pingSentMs(0), nextPacketId(1),
+      head(0), count(0), txLen(0), rxHeader(0), rxRemaining(0), rxMultiplier(1), rxStage(0),
+      rxBodyLen(0), connects(0), connectFailures(0), published(0), acked(0), resent(0),
+      dropped(0), lastAckMs(0), maxAckMs(0), lastBatch(0) {
+  host[0] = user[0] = pass[0] = clientId[0] = topicRoot[0] = '\0';
+}
+
+void MqttClient::configure(const char* newHost, uint16_t newPort, bool newTls, const char* newUser,
+                           const char* newPass, const char* newClientId, const char* newRoot,
+                           uint16_t newKeepAliveSec) {
+  if (newPort == 0) newPort = newTls ? MQTT_DEFAULT_TLS_PORT : MQTT_DEFAULT_PORT;
+  if (newKeepAliveSec == 0) newKeepAliveSec = MQTT_DEFAULT_KEEPALIVE_SEC;
+  const bool changed = strcmp(host, newHost ? newHost : "") != 0 || port != newPort || tls != newTls ||
+                       strcmp(user, newUser ? newUser : "") != 0 || strcmp(pass, newPass ? newPass : "") != 0 ||
+                       strcmp(clientId, newClientId ? newClientId : "") != 0 ||
+                       strcmp(topicRoot, newRoot ? newRoot : "") != 0 || keepAliveSec != newKeepAliveSec;
+  if (!changed) {
+    return;
+  }
+  if (connected) {
+    disconnect();
+  }
+  copyField(host, sizeof(host), newHost);
+  copyField(user, sizeof(user), newUser);
+  copyField(pass, sizeof(pass), newPass);
+  copyField(clientId, sizeof(clientId), newClientId);
+  copyField(topicRoot, sizeof(topicRoot), newRoot);
+  port = newPort;
+  tls = newTls;
+  keepAliveSec = newKeepAliveSec;
+  nextAttemptMs = millis();
+  backoffMs = MQTT_RETRY_MIN_MS;
+}
+
+size_t MqttClient::topicFor(const char* subtopic, char* out, size_t cap) const {
+  int n = snprintf(out, cap, "%s/%s/%s", topicRoot, clientId, subtopic);
+  return n < 0 ? 0 : ((size_t)n < cap ? (size_t)n : cap - 1);
+}
+
+// ---- Outbox ----
+
+void MqttClient::publish(const char* subtopic, const char* payload, size_t len) {
+  if (count == MQTT_QUEUE_SLOTS) {
+    // Oldest first: a newer snapshot supersedes it. A late PUBACK for it is ignored.
+    head = (head + 1) % MQTT_QUEUE_SLOTS;
+    count--;
+    dropped++;
+  }
+  Slot& s = slotAt(count);
+  count++;
+  s.state = SlotState::Queued;
+  s.packetId = 0;
+  if (len > MQTT_PAYLOAD_MAX) len = MQTT_PAYLOAD_MAX;
+  s.len = len;
+  memcpy(s.payload, payload, len);
+  copyField(s.subtopic, sizeof(s.subtopic), subtopic);
+  s.queuedMs = millis();
+  s.sentMs = 0;
+  if (connected) {
+    sendPending();
+  }
+}
+
+void MqttClient::onPuback(uint16_t packetId) {
+  for (size_t i = 0; i < count; i++) {
+    Slot& s = slotAt(i);
+    if (s.state == SlotState::InFlight && s.packetId == packetId) {
+      s.state = SlotState::Acked;
+      acked++;
+      lastAckMs = millis() - s.sentMs;
+      MCP_TRACE_INSTANT("mqtt.puback", lastAckMs);
+      if (lastAckMs > maxAckMs) maxAckMs = lastAckMs;
+      break;
+    }
+  }
+  popAcked();
+}
+
+void MqttClient::popAcked() {
+  while (count > 0 && slotAt(0).state == SlotState::Acked) {
+    head = (head + 1) % MQTT_QUEUE_SLOTS;
+    count--;
+  }
+}
+
+// Writes every message not acknowledged yet in one burst: after a reconnect
+// that is the whole outbox (unacked ones again, with DUP), otherwise just the
+// newly queued one. Acks are collected by loop().
+void MqttClient::sendPending() {
+  char topic[96];
+  uint32_t batch = 0;
+  const unsigned long now = millis();
+  for (size_t i = 0; i < count; i++) {
+    Slot& s = slotAt(i);
+    if (s.state == SlotState::Acked || (s.state == SlotState::InFlight && s.sentMs != 0)) continue;
+    const bool dup = s.state == SlotState::InFlight;
+    if (!dup) {
+      s.packetId = nextPacketId;
+      nextPacketId = nextPacketId == 0xFFFF ? 1 : nextPacketId + 1;
+    }
+    topicFor(s.subtopic, topic, sizeof(topic));
+    if (!writePublish(topic, s.payload, s.len, s.packetId, dup, false)) {
+      close("write failed");
+      return;
+    }
+    s.state = SlotState::InFlight;
+    s.sentMs = now;
+    if (dup) resent++;
+    else published++;
+    batch++;
+  }
+  if (batch > 0) {
+    if (!flushTx()) {
+      close("write failed");
+      return;
+    }
+    lastBatch = batch;
+    MCP_TRACE_INSTANT("mqtt.batch", batch);
+  }
+}
+
+// ---- Connection ----
+
+bool MqttClient::open() {
+  MCP_TRACE_SCOPE("mqtt.connect");  // TCP (+ TLS), CONNECT / CONNACK
+  WiFiClient& client = transport();
+  if (tls) {
+    secure.setInsecure();  // Same as the webhook path: no CA pinning on the device.
+  }
+  if (!client.connect(host, port)) {
+    return false;
+  }
+  txLen = 0;
+  rxStage = 0;
+
+  char willTopic[96];
+  const size_t willTopicLen = topicFor(kOnlineTopic, willTopic, sizeof(willTopic));
+  const size_t idLen = strlen(clientId);
+  const size_t userLen = strlen(user);
+  const size_t passLen = strlen(pass);
+
+  uint8_t flags = MQTT_FLAG_WILL | MQTT_FLAG_WILL_QOS1 | MQTT_FLAG_WILL_RETAIN;  // clean session off
+  size_t remaining = 10 + 2 + idLen + 2 + willTopicLen + 2 + 1;
+  if (userLen > 0) {
+    flags |= MQTT_FLAG_USER;
+    remaining += 2 + userLen;
+    if (passLen > 0) {
+      flags |= MQTT_FLAG_PASS;
+      remaining += 2 + passLen;
+    }
+  }
+  const uint8_t variable[] = {0x00, 0x04, 'M', 'Q', 'T', 'T', 0x04, flags,
+                              (uint8_t)(keepAliveSec >> 8), (uint8_t)keepAliveSec};
+  bool ok = writeHeader(MQTT_CONNECT, remaining) && write(variable, sizeof(variable)) &&
+            writeString(clientId, idLen) && writeString(willTopic, willTopicLen) && writeString("0", 1);
+  if (ok && userLen > 0) ok = writeString(user, userLen);
+  if (ok && userLen > 0 && passLen > 0) ok = writeString(pass, passLen);
+  ok = ok && flushTx() && readConnack();
+  if (!ok) {
+    client.stop();
+    return false;
+  }
+  connected = true;
+  pingSentMs = 0;
+
+  // Messages written before the drop but never acked go out again with DUP.
+  for (size_t i = 0; i < count; i++) {
+    if (slotAt(i).state == SlotState::InFlight) slotAt(i).sentMs = 0;
+  }
+  return true;
+}
+
+bool MqttClient::readConnack() {
+  const unsigned long deadline = millis() + MQTT_TIMEOUT_MS;
+  WiFiClient& client = transport();
+  uint8_t resp[4];
+  size_t got = 0;
+  while (got < sizeof(resp)) {
+    if (client.available() > 0) {
+      int n = client.read(resp + got, sizeof(resp) - got);
+      if (n > 0) {
+        got += n;
+        continue;
+      }
+    }
+    if (!client.connected() || (long)(millis() - deadline) >= 0) {
+      Serial.println("[MQTT] No CONNACK");
+      return false;
+    }
+    delay(2);
+  }
+  if (resp[0] != MQTT_CONNACK || resp[1] != 0x02) {
+    Serial.println("[MQTT] Unexpected reply to CONNECT");
+    return false;
+  }
+  if (resp[3] != 0) {
+    Serial.printf("[MQTT] Connection refused, code %u\n", resp[3]);
+    return false;
+  }
+  sessionPresent = resp[2] & 0x01;
+  return true;
+}
+
+void MqttClient::close(const char* why) {
+  if (connected) {
+    Serial.printf("[MQTT] Disconnected (%s), %u queued\n", why, (unsigned)count);
+  }
+  transport().stop();
+  connected = false;
+  txLen = 0;
+  rxStage = 0;
+  pingSentMs = 0;
+  nextAttemptMs = millis() + backoffMs;
+}
+
+void MqttClient::disconnect() {
+  if (connected) {
+    writeHeader(MQTT_DISCONNECT, 0);
+    flushTx();
+    transport().stop();
+    connected = false;
+    Serial.println("[MQTT] Disconnected");
+  }
+  txLen = 0;
+  rxStage = 0;
+}
+
+void MqttClient::loop() {
+  if (!isEnabled()) {
+    return;
+  }
+  if (WiFi.status() != WL_CONNECTED) {
+    // The socket does not survive the link; reconnect as soon as it is back.
+    if (connected) close("link down");
+    nextAttemptMs = millis();
+    return;
+  }
+
+  if (!connected) {
+    if ((long)(millis() - nextAttemptMs) < 0) {
+      return;
+    }
+    const unsigned long tStart = millis();
+    if (!open()) {
+      connectFailures++;
+      Serial.printf("[MQTT] Connect to %s:%u failed; retry in %lu s\n", host, port, backoffMs / 1000);
+      nextAttemptMs = millis() + backoffMs;
+      backoffMs = backoffMs >= MQTT_RETRY_MAX_MS / 2 ? MQTT_RETRY_MAX_MS : backoffMs * 2;
+      return;
+    }
+    connects++;
+    backoffMs = MQTT_RETRY_MIN_MS;
+    char topic[96];
+    topicFor(kOnlineTopic, topic, sizeof(topic));
+    if (!writePublish(topic, "1", 1, 0, false, true)) {
+      close("write failed");
+      return;
+    }
+    lastBatch = 0;
+    sendPending();  // the outbox goes out in the same burst as the online flag
+    if (!connected) return;
+    if (!flushTx()) {
+      close("write failed");
+      return;
+    }
+    Serial.printf("[MQTT] Connected to %s:%u%s in %lu ms (session %s), %u queued sent\n", host, port,
+                  tls ? " (TLS)" : "", millis() - tStart, sessionPresent ? "resumed" : "new",
+                  (unsigned)lastBatch);
+  }
+
+  poll();
+  if (!connected) return;
+
+  const unsigned long now = millis();
+  if (pingSentMs != 0 && now - pingSentMs >= MQTT_TIMEOUT_MS) {
+    close("no PINGRESP");
+    return;
+  }
+  for (size_t i = 0; i < count; i++) {
+    const Slot& s = slotAt(i);
+    if (s.state == SlotState::InFlight && s.sentMs != 0 && now - s.sentMs >= MQTT_TIMEOUT_MS) {
+      close("no PUBACK");
+      return;
+    }
+  }
+  if (pingSentMs == 0 && now - lastTxMs >= (unsigned long)keepAliveSec * 1000UL) {
+    if (!writeHeader(MQTT_PINGREQ, 0) || !flushTx()) {
+      close("write failed");
+      return;
+    }
+    pingSentMs = now;
+  }
+}
+
+bool MqttClient::flush(unsigned long timeoutMs) {
+  const unsigned long tStart = millis();
+  for (;;) {
+    loop();
+    if (count == 0) return true;
+    if (millis() - tStart >= timeoutMs) return false;
+    delay(5);
+  }
+}
+
+// ---- Wire format ----
+
+bool MqttClient::write(const void* data, size_t len) {
+  const uint8_t* p = static_cast<const uint8_t*>(data);
+  while (len > 0) {
+    size_t n = sizeof(txBuf) - txLen;
+    if (n > len) n = len;
+    memcpy(txBuf + txLen, p, n);
+    txLen += n;
+    p += n;
+    len -= n;
+    if (txLen == sizeof(txBuf) && !flushTx()) return false;
+  }
+  return true;
+}
+
+bool MqttClient::flushTx() {
+  if (txLen == 0) return true;
+  size_t sent = transport().write(txBuf, txLen);
+  bool ok = sent == txLen;
+  txLen = 0;
+  lastTxMs = millis();
+  return ok;
+}
+
+bool MqttClient::writeHeader(uint8_t type, size_t remaining) {
+  uint8_t header[5];
+  size_t n = 0;
+  header[n++] = type;
+  do {
+    uint8_t digit = remaining % 128;
+    remaining /= 128;
+    if (remaining > 0) digit |= 0x80;
+    header[n++] = digit;
+  } while (remaining > 0 && n < sizeof(header));
+  return write(header, n);
+}
+
+bool MqttClient::writeString(const char* s, size_t len) {
+  const uint8_t prefix[2] = {(uint8_t)(len >> 8), (uint8_t)len};
+  return write(prefix, 2) && write(s, len);
+}
+
+bool MqttClient::writePublish(const char* topic, const char* payload, size_t len, uint16_t packetId,
+                              bool dup, bool retain) {
+  const size_t topicLen = strlen(topic);
+  const bool qos1 = packetId != 0;
+  uint8_t type = MQTT_PUBLISH | (dup ? 0x08 : 0) | (qos1 ? 0x02 : 0) | (retain ? 0x01 : 0);
+  const uint8_t id[2] = {(uint8_t)(packetId >> 8), (uint8_t)packetId};
+  return writeHeader(type, 2 + topicLen + (qos1 ? 2 : 0) + len) && writeString(topic, topicLen) &&
+         (!qos1 || write(id, 2)) && write(payload, len);
+}
+
+// Reads whatever has arrived without waiting.
+void MqttClient::poll() {
+  WiFiClient& client = transport();
+  uint8_t buf[32];
+  for (;;) {
+    if (!client.connected()) {
+      close("closed by broker");
+      return;
+    }
+    if (client.available() <= 0) return;
+    int n = client.read(buf, sizeof(buf));
+    if (n <= 0) return;
+    for (int i = 0; i < n; i++) {
+      const uint8_t c = buf[i];
+      if (rxStage == 0) {
+        rxHeader = c;
+        rxRemaining = 0;
+        rxMultiplier = 1;
+        rxBodyLen = 0;
+        rxStage = 1;
+      } else if (rxStage == 1) {
+        rxRemaining += (c & 0x7F) * rxMultiplier;
+        rxMultiplier *= 128;
+        if ((c & 0x80) == 0) {
+          if (rxRemaining == 0) {
+            handlePacket();
+            rxStage = 0;
+          } else {
+            rxStage = 2;
+          }
+        }
+      } else {
+        if (rxBodyLen < sizeof(rxBody)) rxBody[rxBodyLen] = c;
+        rxBodyLen = rxBodyLen < 255 ? rxBodyLen + 1 : rxBodyLen;
+        if (--rxRemaining == 0) {
+          handlePacket();
+          rxStage = 0;
+        }
+      }
+      if (!connected) return;
+    }
+  }
+}
+
+void MqttClient::handlePacket() {
+  switch (rxHeader & 0xF0) {
+    case MQTT_PUBACK:
+      if (rxBodyLen >= 2) onPuback(((uint16_t)rxBody[0] << 8) | rxBody[1]);
+      break;
+    case MQTT_PINGRESP:
+      pingSentMs = 0;
+      break;
+    default:
+      break;  // nothing subscribed; ignore
+  }
+}
+
+String MqttClient::toJson() const {
+  char buf[400];
+  unsigned long oldestMs = 0;
+  if (count > 0) oldestMs = millis() - slotAt(0).queuedMs;
+  snprintf(buf, sizeof(buf),
+           "{\"enabled\":%s,\"connected\":%s,\"host\":\"%s\",\"port\":%u,\"tls\":%s,"
+           "\"sessionPresent\":%s,\"queued\":%u,\"oldestQueuedMs\":%lu,\"connects\":%u,"
+           "\"connectFailures\":%u,\"published\":%u,\"acked\":%u,\"resent\":%u,\"dropped\":%u,"
+           "\"lastBatch\":%u,\"lastAckMs\":%u,\"maxAckMs\":%u}",
+           isEnabled() ? "true" : "false", connected ? "true" : "false", host, port, tls ? "true" : "false",
+           sessionPresent ? "true" : "false", (unsigned)count, oldestMs, connects, connectFailures, published,
+           acked, resent, dropped, lastBatch, lastAckMs, maxAckMs);
+  return String(buf);
+}
@@ -0,0 +1,137 @@
+/**
+ * mqttClient.h
+ * Minimal MQTT 3.1.1 publisher for aranea device telemetry.
+ * Keeps one long-lived connection (plain or TLS) with a persistent session
+ * (clean session off, client id = LacisID) and keepalive pings. Messages are
+ * QoS1 and go through a fixed outbox: they stay there until the broker's
+ * PUBACK arrives, so a link or broker outage only delays them. On reconnect
+ * the whole outbox is written back-to-back (unacked ones with DUP set) and
+ * the acks are collected afterwards. No heap allocations after connect.
+ *
+ * Topics: <root>/<clientId>/<subtopic>; <root>/<clientId>/online is a
+ * retained "1", with a retained "0" as the will.
+ */
+
+#ifndef MQTT_CLIENT_H
+#define MQTT_CLIENT_H
+
+#include <Arduino.h>
+#include <WiFiClient.h>
+#include <WiFiClientSecure.h>
+
+#define MQTT_DEFAULT_PORT 1883
+#define MQTT_DEFAULT_TLS_PORT 8883
+#define MQTT_DEFAULT_KEEPALIVE_SEC 60
+#define MQTT_TIMEOUT_MS 10000         // CONNACK / PINGRESP / PUBACK wait before the connection is dropped
+#define MQTT_RETRY_MIN_MS 2000        // reconnect backoff, doubling up to MQTT_RETRY_MAX_MS
+#define MQTT_RETRY_MAX_MS 120000
+
+// Outbox: MQTT_QUEUE_SLOTS messages of up to MQTT_PAYLOAD_MAX bytes. When it
+// is full the oldest message is dropped.
+#define MQTT_QUEUE_SLOTS 8
+#define MQTT_PAYLOAD_MAX 768
+#define MQTT_SUBTOPIC_MAX 16
+
+class MqttClient {
+public:
+  MqttClient(WiFiClient& plain, WiFiClientSecure& secure);
+
+  // Broker and identity. An empty host disables MQTT. A change of settings
+  // closes the current connection; the outbox is kept.
+  void configure(const char* host, uint16_t port, bool tls, const char* user, const char* pass,
+                 const char* clientId, const char* topicRoot, uint16_t keepAliveSec);
+  bool isEnabled() const { return host[0] != '\0'; }
+  bool isConnected() const { return connected; }
+
+  // Queue a QoS1 message; sent right away when connected. Never blocks on
+  // the network and never fails: a full outbox drops its oldest message.
+  void publish(const char* subtopic, const char* payload, size_t len);
+
+  // Connect when due, read acks, send keepalive pings. Call from loop().
+  void loop();
+  // Run loop() until the outbox is empty or timeoutMs passed (before deep sleep).
+  bool flush(unsigned long timeoutMs);
+  // Send DISCONNECT (the broker discards the will) and close.
+  void disconnect();
+
+  size_t getQueued() const { return count; }
+  String toJson() const;
+
+private:
+  enum class SlotState : uint8_t { Queued, InFlight, Acked };
+  struct Slot {
+    SlotState state;
+    uint16_t packetId;
+    uint16_t len;
+    uint32_t queuedMs;
+    uint32_t sentMs;
+    char subtopic[MQTT_SUBTOPIC_MAX];
+    char payload[MQTT_PAYLOAD_MAX];
+  };
+
+  WiFiClient& transport() { return tls ? (WiFiClient&)secure : plain; }
+  bool open();
+  void close(const char* why);
+  bool readConnack();
+  void sendPending();
+  bool writePublish(const char* topic, const char* payload, size_t len, uint16_t packetId,
+                    bool dup, bool retain);
+  bool writeHeader(uint8_t type, size_t remaining);
+  bool writeString(const char* s, size_t len);
+  bool write(const void* data, size_t len);
+  bool flushTx();
+  void poll();
+  void handlePacket();
+  void onPuback(uint16_t packetId);
+  void popAcked();
+  Slot& slotAt(size_t i) { return slots[(head + i) % MQTT_QUEUE_SLOTS]; }
+  const Slot& slotAt(size_t i) const { return slots[(head + i) % MQTT_QUEUE_SLOTS]; }
+  size_t topicFor(const char* subtopic, char* out, size_t cap) const;
+
+  WiFiClient& plain;
+  WiFiClientSecure& secure;
+
+  char host[64];
+  uint16_t port;
+  bool tls;
+  char user[32];
+  char pass[64];
+  char clientId[24];
+  char topicRoot[32];
+  uint16_t keepAliveSec;
+
+  bool connected;
+  bool sessionPresent;
+  unsigned long nextAttemptMs;
+  unsigned long backoffMs;
+  unsigned long lastTxMs;
+  unsigned long pingSentMs;  // 0 = no ping outstanding
+  uint16_t nextPacketId;
+
+  Slot slots[MQTT_QUEUE_SLOTS];
+  size_t head;
+  size_t count;
+
+  uint8_t txBuf[512];
+  size_t txLen;
+  // Incoming packet: only CONNACK / PUBACK / PINGRESP are expected (no
+  // subscriptions); anything longer than rxBody is skipped.
+  uint8_t rxHeader;
+  uint32_t rxRemaining;
+  uint32_t rxMultiplier;
+  uint8_t rxStage;  // 0 = header, 1 = length, 2 = body
+  uint8_t rxBody[4];
+  uint8_t rxBodyLen;
+
+  uint32_t connects;
+  uint32_t connectFailures;
+  uint32_t published;
+  uint32_t acked;
+  uint32_t resent;
+  uint32_t dropped;
+  uint32_t lastAckMs;   // publish -> PUBACK of the latest ack
+  uint32_t maxAckMs;
+  uint32_t lastBatch;   // messages written in one burst after the latest CONNACK
+};
+
+#endif // MQTT_CLIENT_H
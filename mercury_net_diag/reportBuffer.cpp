@@ -0,0 +1,79 @@
+/**
+ * reportBuffer.cpp
+ * Fixed-capacity text buffer for the periodic report path
+ */
+
+#include "reportBuffer.h"
+#include <McpEscape.h>
+#include <stdarg.h>
+
+ReportBuffer::ReportBuffer(char* storage, size_t capacity)
+    : buf(storage), cap(capacity), len(0), overflow(false) {
+  buf[0] = '\0';
+}
+
+void ReportBuffer::clear() {
+  len = 0;
+  overflow = false;
+  buf[0] = '\0';
+}
+
+void ReportBuffer::add(const char* text, size_t n) {
+  size_t room = cap - 1 - len;
+  if (n > room) {
+    n = room;
+    overflow = true;
+  }
+  memcpy(buf + len, text, n);
+  len += n;
+  buf[len] = '\0';
+}
+
+void ReportBuffer::add(const char* text) {
+  add(text, strlen(text));
+}
+
+void ReportBuffer::add(char c) {
+  add(&c, 1);
+}
+
+void ReportBuffer::addf(const char* format, ...) {
+  size_t room = cap - len;
+  va_list args;
+  va_start(args, format);
+  int n = vsnprintf(buf + len, room, format, args);
+  va_end(args);
+  if (n < 0) {
+    buf[len] = '\0';
+    return;
+  }
+  if ((size_t)n >= room) {
+    n = room - 1;
+    overflow = true;
+  }
+  len += n;
+}
+
+void ReportBuffer::addIp(const IPAddress& ip) {
+  addf("%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+}
+
+void ReportBuffer::addMac(const uint8_t* mac) {
+  addf("%02X:%02X:%02X:%02X:%02X:%02X", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+}
+
+void ReportBuffer::addJsonEscaped(const char* text) {
+  const size_t n = strlen(text);
+  mcp::EscapeResult r = mcp::escapeJson(buf + len, cap - 1 - len, text, n);
+  len += r.written;
+  buf[len] = '\0';
+  if (r.consumed < n) overflow = true;
+}
+
+void ReportBuffer::truncate(size_t length) {
+  if (length < len) {
+    len = length;
+    buf[len] = '\0';
+    overflow = false;
+  }
+}
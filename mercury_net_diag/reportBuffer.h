@@ -0,0 +1,53 @@
+/**
+ * reportBuffer.h
+ * Fixed-capacity text buffer for the periodic report path.
+ * Wraps caller-owned (usually static) storage; appends that do not fit are
+ * truncated instead of growing, so building a report never touches the heap.
+ */
+
+#ifndef REPORT_BUFFER_H
+#define REPORT_BUFFER_H
+
+#include <Arduino.h>
+#include <IPAddress.h>
+
+class ReportBuffer {
+public:
+  ReportBuffer(char* storage, size_t capacity);
+
+  void clear();
+  void add(const char* text);
+  void add(const char* text, size_t len);
+  void add(char c);
+  void addf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+  void addIp(const IPAddress& ip);
+  void addMac(const uint8_t* mac);
+  // Body of a JSON string literal (no quotes added).
+  void addJsonEscaped(const char* text);
+
+  const char* c_str() const { return buf; }
+  size_t length() const { return len; }
+  size_t capacity() const { return cap - 1; }
+  bool truncated() const { return overflow; }
+
+  // Drop everything after `length` (for re-using a prefix between posts).
+  void truncate(size_t length);
+
+private:
+  char* buf;
+  size_t cap;
+  size_t len;
+  bool overflow;
+};
+
+// Backing storage and a buffer over it in one object, for static instances.
+template <size_t N>
+class StaticReportBuffer : public ReportBuffer {
+public:
+  StaticReportBuffer() : ReportBuffer(storage, N) {}
+
+private:
+  char storage[N];
+};
+
+#endif // REPORT_BUFFER_H
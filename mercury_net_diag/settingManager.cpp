@@ -4,7 +4,9 @@
  */
 
 #include "settingManager.h"
+#include "bootTimeline.h"
 #include <SPIFFS.h>
+#include <McpEscape.h>
 
 #define CONFIG_FILE "/config.json"
 
@@ -26,6 +28,19 @@ void SettingManager::setDefaults() {
   settings.devSSID = "fgop";
   settings.devPass = "tetrad12345@@@";
   settings.checkInterval = 600000;  // 10 minutes default
+  settings.deepSleep = false;
+  settings.uiWindowSec = 180;       // 3 minutes default
+  settings.loopBudgetMs = 500;
+  settings.webhookGzip = false;
+  settings.coopScan = false;
+  settings.powerMode = "auto";
+  settings.psIdleSec = 15;
+  settings.mqttHost = "";
+  settings.mqttPort = 1883;
+  settings.mqttTls = false;
+  settings.mqttUser = "";
+  settings.mqttPass = "";
+  settings.mqttTopic = "aranea";
   settings.endpoints.clear();
 }
 
@@ -37,6 +52,7 @@ bool SettingManager::begin() {
   }
   
   Serial.println("[SettingManager] SPIFFS mounted successfully");
+  bootTimeline.mark(BootPhase::Spiffs);
   
   if (isFirstBoot()) {
     Serial.println("[SettingManager] First boot detected, creating default config...");
@@ -105,6 +121,19 @@ void SettingManager::setAltPass(const String& value) { settings.altPass = value;
 void SettingManager::setDevSSID(const String& value) { settings.devSSID = value; }
 void SettingManager::setDevPass(const String& value) { settings.devPass = value; }
 void SettingManager::setCheckInterval(unsigned long value) { settings.checkInterval = value; }
+void SettingManager::setDeepSleep(bool value) { settings.deepSleep = value; }
+void SettingManager::setUiWindowSec(unsigned long value) { settings.uiWindowSec = value; }
+void SettingManager::setLoopBudgetMs(unsigned long value) { settings.loopBudgetMs = value; }
+void SettingManager::setWebhookGzip(bool value) { settings.webhookGzip = value; }
+void SettingManager::setCoopScan(bool value) { settings.coopScan = value; }
+void SettingManager::setPowerMode(const String& value) { settings.powerMode = value; }
+void SettingManager::setPsIdleSec(unsigned long value) { settings.psIdleSec = value; }
+void SettingManager::setMqttHost(const String& value) { settings.mqttHost = value; }
+void SettingManager::setMqttPort(unsigned long value) { settings.mqttPort = value; }
+void SettingManager::setMqttTls(bool value) { settings.mqttTls = value; }
+void SettingManager::setMqttUser(const String& value) { settings.mqttUser = value; }
+void SettingManager::setMqttPass(const String& value) { settings.mqttPass = value; }
+void SettingManager::setMqttTopic(const String& value) { settings.mqttTopic = value; }
 
 bool SettingManager::addEndpoint(const String& url) {
   if (settings.endpoints.size() >= MAX_ENDPOINTS) {
@@ -126,38 +155,47 @@ void SettingManager::clearEndpoints() {
   settings.endpoints.clear();
 }
 
-String SettingManager::escapeJson(const String& str) const {
-  String out;
-  out.reserve(str.length() + 8);
-  for (size_t i = 0; i < str.length(); i++) {
-    char c = str.charAt(i);
-    switch (c) {
-      case '\\': out += "\\\\"; break;
-      case '"': out += "\\\""; break;
-      case '\n': out += "\\n"; break;
-      case '\r': out += "\\r"; break;
-      case '\t': out += "\\t"; break;
-      default: out += c;
-    }
-  }
-  return out;
-}
-
 String SettingManager::toJson() const {
-  String json = "{";
-  json += "\"locationName\":\"" + escapeJson(settings.locationName) + "\",";
-  json += "\"networkName\":\"" + escapeJson(settings.networkName) + "\",";
-  json += "\"mainSSID\":\"" + escapeJson(settings.mainSSID) + "\",";
-  json += "\"mainPass\":\"" + escapeJson(settings.mainPass) + "\",";
-  json += "\"altSSID\":\"" + escapeJson(settings.altSSID) + "\",";
-  json += "\"altPass\":\"" + escapeJson(settings.altPass) + "\",";
-  json += "\"devSSID\":\"" + escapeJson(settings.devSSID) + "\",";
-  json += "\"devPass\":\"" + escapeJson(settings.devPass) + "\",";
+  // Appends "key":"<escaped value>", straight into json (no per-field temporaries).
+  String json;
+  json.reserve(256);
+  auto addString = [&json](const char* key, const String& value) {
+    json += "\"";
+    json += key;
+    json += "\":\"";
+    mcp::appendJsonEscaped(json, value);
+    json += "\",";
+  };
+
+  json += "{";
+  addString("locationName", settings.locationName);
+  addString("networkName", settings.networkName);
+  addString("mainSSID", settings.mainSSID);
+  addString("mainPass", settings.mainPass);
+  addString("altSSID", settings.altSSID);
+  addString("altPass", settings.altPass);
+  addString("devSSID", settings.devSSID);
+  addString("devPass", settings.devPass);
   json += "\"checkInterval\":" + String(settings.checkInterval) + ",";
+  json += "\"deepSleep\":" + String(settings.deepSleep ? "true" : "false") + ",";
+  json += "\"uiWindowSec\":" + String(settings.uiWindowSec) + ",";
+  json += "\"loopBudgetMs\":" + String(settings.loopBudgetMs) + ",";
+  json += "\"webhookGzip\":" + String(settings.webhookGzip ? "true" : "false") + ",";
+  json += "\"coopScan\":" + String(settings.coopScan ? "true" : "false") + ",";
+  addString("powerMode", settings.powerMode);
+  json += "\"psIdleSec\":" + String(settings.psIdleSec) + ",";
+  addString("mqttHost", settings.mqttHost);
+  json += "\"mqttPort\":" + String(settings.mqttPort) + ",";
+  json += "\"mqttTls\":" + String(settings.mqttTls ? "true" : "false") + ",";
+  addString("mqttUser", settings.mqttUser);
+  addString("mqttPass", settings.mqttPass);
+  addString("mqttTopic", settings.mqttTopic);
   json += "\"endpoints\":[";
   for (size_t i = 0; i < settings.endpoints.size(); i++) {
     if (i > 0) json += ",";
-    json += "\"" + escapeJson(settings.endpoints[i]) + "\"";
+    json += "\"";
+    mcp::appendJsonEscaped(json, settings.endpoints[i]);
+    json += "\"";
   }
   json += "]}";
   return json;
@@ -212,6 +250,27 @@ bool SettingManager::fromJson(const String& json) {
   
   long interval = extractNumber("checkInterval");
   settings.checkInterval = (interval > 0) ? interval : 600000;
+
+  settings.deepSleep = json.indexOf("\"deepSleep\":true") >= 0;
+  long uiWindow = extractNumber("uiWindowSec");
+  settings.uiWindowSec = (uiWindow > 0) ? uiWindow : 180;
+  long loopBudget = extractNumber("loopBudgetMs");
+  settings.loopBudgetMs = (loopBudget > 0) ? loopBudget : 500;
+  settings.webhookGzip = json.indexOf("\"webhookGzip\":true") >= 0;
+  settings.coopScan = json.indexOf("\"coopScan\":true") >= 0;
+  settings.powerMode = extractString("powerMode");
+  if (settings.powerMode.isEmpty()) settings.powerMode = "auto";
+  long psIdle = extractNumber("psIdleSec");
+  settings.psIdleSec = (psIdle > 0) ? psIdle : 15;
+
+  settings.mqttHost = extractString("mqttHost");
+  long mqttPort = extractNumber("mqttPort");
+  settings.mqttTls = json.indexOf("\"mqttTls\":true") >= 0;
+  settings.mqttPort = (mqttPort > 0 && mqttPort < 65536) ? mqttPort : (settings.mqttTls ? 8883 : 1883);
+  settings.mqttUser = extractString("mqttUser");
+  settings.mqttPass = extractString("mqttPass");
+  settings.mqttTopic = extractString("mqttTopic");
+  if (settings.mqttTopic.isEmpty()) settings.mqttTopic = "aranea";
   
   // Parse endpoints array
   settings.endpoints.clear();
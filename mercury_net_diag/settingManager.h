@@ -22,6 +22,19 @@ struct DeviceSettings {
   String devSSID;
   String devPass;
   unsigned long checkInterval;
+  bool deepSleep;              // duty-cycle mode: report, then deep-sleep until the next slot
+  unsigned long uiWindowSec;   // web UI stays up this long after a button wake / cold boot
+  unsigned long loopBudgetMs;  // loop() iterations longer than this are flagged by the latency watchdog
+  bool webhookGzip;            // gzip request bodies; only for endpoints that accept Content-Encoding
+  bool coopScan;               // split the AP scan with other devices on the LAN (see coopScan.h)
+  String powerMode;            // Wi-Fi power save: "auto" (off while clients are active), "latency", "power"
+  unsigned long psIdleSec;     // auto: power save back on after this long without a request
+  String mqttHost;             // MQTT broker; empty = report to the Discord webhook
+  unsigned long mqttPort;
+  bool mqttTls;
+  String mqttUser;
+  String mqttPass;
+  String mqttTopic;            // topic root: <mqttTopic>/<LacisID>/...
   std::vector<String> endpoints;
 };
 
@@ -55,6 +68,19 @@ public:
   String getDevSSID() const { return settings.devSSID; }
   String getDevPass() const { return settings.devPass; }
   unsigned long getCheckInterval() const { return settings.checkInterval; }
+  bool getDeepSleep() const { return settings.deepSleep; }
+  unsigned long getUiWindowSec() const { return settings.uiWindowSec; }
+  unsigned long getLoopBudgetMs() const { return settings.loopBudgetMs; }
+  bool getWebhookGzip() const { return settings.webhookGzip; }
+  bool getCoopScan() const { return settings.coopScan; }
+  String getPowerMode() const { return settings.powerMode; }
+  unsigned long getPsIdleSec() const { return settings.psIdleSec; }
+  String getMqttHost() const { return settings.mqttHost; }
+  unsigned long getMqttPort() const { return settings.mqttPort; }
+  bool getMqttTls() const { return settings.mqttTls; }
+  String getMqttUser() const { return settings.mqttUser; }
+  String getMqttPass() const { return settings.mqttPass; }
+  String getMqttTopic() const { return settings.mqttTopic; }
   const std::vector<String>& getEndpoints() const { return settings.endpoints; }
   
   // Setters
@@ -67,6 +93,19 @@ public:
   void setDevSSID(const String& value);
   void setDevPass(const String& value);
   void setCheckInterval(unsigned long value);
+  void setDeepSleep(bool value);
+  void setUiWindowSec(unsigned long value);
+  void setLoopBudgetMs(unsigned long value);
+  void setWebhookGzip(bool value);
+  void setCoopScan(bool value);
+  void setPowerMode(const String& value);
+  void setPsIdleSec(unsigned long value);
+  void setMqttHost(const String& value);
+  void setMqttPort(unsigned long value);
+  void setMqttTls(bool value);
+  void setMqttUser(const String& value);
+  void setMqttPass(const String& value);
+  void setMqttTopic(const String& value);
   
   // Endpoint management
   bool addEndpoint(const String& url);
@@ -84,7 +123,6 @@ private:
   bool initialized;
   
   void setDefaults();
-  String escapeJson(const String& str) const;
 };
 
 // Global instance
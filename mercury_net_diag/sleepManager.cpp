@@ -0,0 +1,133 @@
+/**
+ * sleepManager.cpp
+ * Deep-sleep duty cycle support for aranea device
+ */
+
+#include "sleepManager.h"
+#include "esp_sleep.h"
+#include "esp_timer.h"
+
+#define RTC_STATE_MAGIC 0xA7A2EA01
+#define MIN_SLEEP_MS 1000
+
+// Global instance
+SleepManager sleepMgr;
+
+RTC_DATA_ATTR static RtcState rtcState;
+
+SleepManager::SleepManager()
+    : wakeReason(WakeReason::ColdBoot), connectMs(0), fastConnect(false) {}
+
+void SleepManager::begin() {
+  esp_sleep_wakeup_cause_t cause = esp_sleep_get_wakeup_cause();
+  switch (cause) {
+    case ESP_SLEEP_WAKEUP_TIMER:
+      wakeReason = WakeReason::Timer;
+      break;
+    case ESP_SLEEP_WAKEUP_EXT0:
+      wakeReason = WakeReason::Button;
+      break;
+    default:
+      wakeReason = WakeReason::ColdBoot;
+      break;
+  }
+
+  // RTC memory holds garbage after power-on and is only meaningful after a
+  // deep-sleep wake.
+  if (wakeReason == WakeReason::ColdBoot || rtcState.magic != RTC_STATE_MAGIC) {
+    memset(&rtcState, 0, sizeof(rtcState));
+    rtcState.magic = RTC_STATE_MAGIC;
+  }
+
+  Serial.printf("[SleepManager] Wake: %s, cycle %u, cached AP: %s\n",
+                wakeReasonString(), rtcState.cycle, rtcState.apValid ? "yes" : "no");
+}
+
+const char* SleepManager::wakeReasonString() const {
+  switch (wakeReason) {
+    case WakeReason::Timer:
+      return "timer";
+    case WakeReason::Button:
+      return "button";
+    default:
+      return "cold boot";
+  }
+}
+
+const RtcState& SleepManager::getState() const {
+  return rtcState;
+}
+
+bool SleepManager::hasCachedAp() const {
+  return rtcState.apValid;
+}
+
+bool SleepManager::canReuseLease() const {
+  return rtcState.apValid && rtcState.ip != 0 && rtcState.leaseUses < LEASE_REUSE_MAX;
+}
+
+void SleepManager::saveAp(uint8_t credIndex, const uint8_t* bssid, uint8_t channel,
+                          IPAddress ip, IPAddress gateway, IPAddress subnet,
+                          IPAddress dns0, IPAddress dns1, bool fromDhcp) {
+  rtcState.apValid = true;
+  rtcState.credIndex = credIndex;
+  memcpy(rtcState.bssid, bssid, sizeof(rtcState.bssid));
+  rtcState.channel = channel;
+  rtcState.ip = (uint32_t)ip;
+  rtcState.gateway = (uint32_t)gateway;
+  rtcState.subnet = (uint32_t)subnet;
+  rtcState.dns0 = (uint32_t)dns0;
+  rtcState.dns1 = (uint32_t)dns1;
+  rtcState.leaseUses = fromDhcp ? 0 : rtcState.leaseUses + 1;
+}
+
+void SleepManager::invalidateAp() {
+  rtcState.apValid = false;
+  rtcState.ip = 0;
+  rtcState.leaseUses = 0;
+}
+
+void SleepManager::recordConnect(uint32_t ms, bool fast) {
+  connectMs = ms;
+  fastConnect = fast;
+}
+
+void SleepManager::recordFastConnectFailure() {
+  rtcState.fastConnectFails++;
+}
+
+bool SleepManager::needsTimeSync() const {
+  return !rtcState.timeSynced || (rtcState.cycle - rtcState.ntpCycle) >= NTP_RESYNC_CYCLES;
+}
+
+void SleepManager::markTimeSynced() {
+  rtcState.timeSynced = true;
+  rtcState.ntpCycle = rtcState.cycle;
+}
+
+bool SleepManager::isTimeSynced() const {
+  return rtcState.timeSynced;
+}
+
+uint32_t SleepManager::awakeMs() const {
+  return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+void SleepManager::sleepUntilNextSlot(unsigned long intervalMs) {
+  const uint32_t awake = awakeMs();
+  // The slot started when we woke, so the time spent awake is part of it.
+  unsigned long sleepMs = (intervalMs > awake + MIN_SLEEP_MS) ? intervalMs - awake : MIN_SLEEP_MS;
+
+  rtcState.cycle++;
+  rtcState.lastWakeToSleepMs = awake;
+  rtcState.lastConnectMs = connectMs;
+  rtcState.lastConnectFast = fastConnect;
+
+  Serial.printf("[SleepManager] Cycle %u done: wake-to-sleep %u ms (connect %u ms, %s); sleeping %lu s\n",
+                rtcState.cycle, awake, connectMs, fastConnect ? "fast" : "full", sleepMs / 1000);
+  Serial.flush();
+
+  esp_sleep_enable_timer_wakeup((uint64_t)sleepMs * 1000ULL);
+  esp_sleep_enable_ext0_wakeup((gpio_num_t)WAKE_BUTTON_PIN, 0);
+  esp_deep_sleep_start();
+}
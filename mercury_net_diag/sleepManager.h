@@ -0,0 +1,103 @@
+/**
+ * sleepManager.h
+ * Deep-sleep duty cycle support for aranea device:
+ * RTC-retained AP/lease cache for fast reconnect, wake reason, slot scheduling
+ * and wake-to-sleep timing.
+ */
+
+#ifndef SLEEP_MANAGER_H
+#define SLEEP_MANAGER_H
+
+#include <Arduino.h>
+#include <IPAddress.h>
+
+// Button used to wake the device and open the web UI window (BOOT button, active low)
+#define WAKE_BUTTON_PIN 0
+
+// Reuse a cached DHCP lease (static config) for at most this many wakes,
+// then run DHCP once to refresh it.
+#define LEASE_REUSE_MAX 12
+
+// Re-sync NTP every this many cycles (the RTC keeps time during deep sleep)
+#define NTP_RESYNC_CYCLES 144
+
+enum class WakeReason {
+  ColdBoot,  // power-on, reset, ESP.restart()
+  Timer,     // scheduled report slot
+  Button     // user pressed the wake button
+};
+
+// Kept in RTC slow memory across deep sleep. Contents are only trusted after a
+// deep-sleep wake with a matching magic/version.
+struct RtcState {
+  uint32_t magic;
+  uint32_t cycle;             // completed duty cycles since cold boot
+  // Cached AP and lease for fast reconnect
+  bool apValid;
+  uint8_t credIndex;          // 0=main, 1=alt, 2=dev
+  uint8_t bssid[6];
+  uint8_t channel;
+  uint32_t ip;
+  uint32_t gateway;
+  uint32_t subnet;
+  uint32_t dns0;
+  uint32_t dns1;
+  uint8_t leaseUses;          // wakes since the lease came from DHCP
+  // Time
+  bool timeSynced;
+  uint32_t ntpCycle;          // cycle of the last NTP sync
+  // Timing of the previous cycle (reported in the next one)
+  uint32_t lastWakeToSleepMs;
+  uint32_t lastConnectMs;
+  bool lastConnectFast;
+  uint32_t fastConnectFails;
+};
+
+class SleepManager {
+public:
+  SleepManager();
+
+  // Evaluate wake cause and validate RTC state. Call first thing in setup().
+  void begin();
+
+  WakeReason getWakeReason() const { return wakeReason; }
+  const char* wakeReasonString() const;
+  const RtcState& getState() const;
+
+  // ---- AP / lease cache ----
+  bool hasCachedAp() const;
+  bool canReuseLease() const;
+  void saveAp(uint8_t credIndex, const uint8_t* bssid, uint8_t channel,
+              IPAddress ip, IPAddress gateway, IPAddress subnet,
+              IPAddress dns0, IPAddress dns1, bool fromDhcp);
+  void invalidateAp();
+
+  // ---- Connect timing ----
+  void recordConnect(uint32_t connectMs, bool fast);
+  void recordFastConnectFailure();
+  uint32_t getConnectMs() const { return connectMs; }
+  bool wasFastConnect() const { return fastConnect; }
+
+  // ---- NTP ----
+  bool needsTimeSync() const;
+  void markTimeSynced();
+  bool isTimeSynced() const;
+
+  // Milliseconds since this wake (esp_timer starts at boot; ROM/bootloader time
+  // before app start is not included).
+  uint32_t awakeMs() const;
+
+  // Persist state to RTC memory and deep-sleep until the next report slot.
+  // The wake button is armed as an additional wake source. Does not return.
+  void sleepUntilNextSlot(unsigned long intervalMs);
+
+private:
+  WakeReason wakeReason;
+  uint32_t connectMs;
+  bool fastConnect;
+};
+
+// Global instance
+extern SleepManager sleepMgr;
+
+#endif // SLEEP_MANAGER_H
@@ -0,0 +1,347 @@
+/**
+ * webhookClient.cpp
+ * Minimal streaming HTTP/1.1 client for the Discord webhook
+ */
+
+#include "webhookClient.h"
+#include <McpEscape.h>
+#include <McpTrace.h>
+#include <new>
+
+static const char kBodyUsername[] = "{\"username\":\"";
+static const char kBodyContent[] = "\",\"content\":\"";
+static const char kBodyTail[] = "\",\"allowed_mentions\":{\"parse\":[]}}";
+static const char kIdPattern[] = "\"id\":\"";
+
+// Splits "https://host/path" in place. Only https is supported.
+static bool splitUrl(const char* url, const char*& host, size_t& hostLen, const char*& path) {
+  static const char kScheme[] = "https://";
+  if (strncmp(url, kScheme, sizeof(kScheme) - 1) != 0) return false;
+  host = url + sizeof(kScheme) - 1;
+  path = strchr(host, '/');
+  if (!path) return false;
+  hostLen = path - host;
+  return hostLen > 0;
+}
+
+static bool startsWithIgnoreCase(const char* s, const char* prefix) {
+  while (*prefix) {
+    if (tolower((unsigned char)*s++) != *prefix++) return false;
+  }
+  return true;
+}
+
+WebhookClient::WebhookClient(WiFiClientSecure& client)
+    : client(client), keepAlive(false), txLen(0), gzip(false), gzipRejected(false), deflating(false), compressed(false),
+      deflater(nullptr), wireLen(0), bodyBytes(0), wireBytes(0), deflateUs(0), rxPos(0), rxLen(0),
+      snippetLen(0), idMatch(0), idCapturing(false), idLen(0) {
+  connectedHost[0] = '\0';
+  messageId[0] = '\0';
+  snippet[0] = '\0';
+}
+
+int WebhookClient::postMessage(const char* webhookUrl, const char* username,
+                               const char* content, size_t contentLen) {
+  return request("POST", webhookUrl, "?wait=true", username, content, contentLen);
+}
+
+int WebhookClient::editMessage(const char* webhookUrl, const char* id, const char* username,
+                               const char* content, size_t contentLen) {
+  char suffix[48];
+  snprintf(suffix, sizeof(suffix), "/messages/%s", id);
+  return request("PATCH", webhookUrl, suffix, username, content, contentLen);
+}
+
+void WebhookClient::stop() {
+  client.stop();
+  connectedHost[0] = '\0';
+  keepAlive = false;
+  rxPos = rxLen = 0;
+  txLen = wireLen = 0;
+  deflating = false;
+}
+
+bool WebhookClient::connectTo(const char* host, size_t hostLen) {
+  if (hostLen >= sizeof(connectedHost)) return false;
+  if (keepAlive && client.connected() && strncmp(connectedHost, host, hostLen) == 0 &&
+      connectedHost[hostLen] == '\0') {
+    return true;
+  }
+  stop();
+  memcpy(connectedHost, host, hostLen);
+  connectedHost[hostLen] = '\0';
+  MCP_TRACE_SCOPE("webhook.connect");  // TCP + TLS handshake
+  if (!client.connect(connectedHost, 443)) {
+    connectedHost[0] = '\0';
+    return false;
+  }
+  return true;
+}
+
+bool WebhookClient::flush() {
+  if (txLen == 0) return true;
+  bool ok = deflating ? deflater->write(txBuf, txLen) : client.write(txBuf, txLen) == txLen;
+  txLen = 0;
+  return ok;
+}
+
+bool WebhookClient::onDeflated(void* ctx, const uint8_t* data, size_t len, bool last) {
+  return static_cast<WebhookClient*>(ctx)->writeChunk(data, len, last);
+}
+
+// One chunk per deflater output piece ("%03x" covers MCP_GZIP_OUT_MAX); the last
+// one carries the terminating zero-size chunk and sends everything.
+bool WebhookClient::writeChunk(const uint8_t* data, size_t len, bool last) {
+  static_assert(MCP_GZIP_OUT_MAX <= 0xFFF, "chunk size must fit three hex digits");
+  static const char kLastChunk[] = "0\r\n\r\n";
+  const size_t need = 5 + len + 2 + (last ? sizeof(kLastChunk) - 1 : 0);
+  if (wireLen + need > sizeof(wireBuf) && !sendWire()) return false;
+  if (len > 0) {
+    wireLen += snprintf(reinterpret_cast<char*>(wireBuf) + wireLen, 6, "%03x\r\n", (unsigned)len);
+    memcpy(wireBuf + wireLen, data, len);
+    wireLen += len;
+    wireBuf[wireLen++] = '\r';
+    wireBuf[wireLen++] = '\n';
+  }
+  if (last) {
+    memcpy(wireBuf + wireLen, kLastChunk, sizeof(kLastChunk) - 1);
+    wireLen += sizeof(kLastChunk) - 1;
+  }
+  return !last || sendWire();
+}
+
+bool WebhookClient::sendWire() {
+  size_t sent = client.write(wireBuf, wireLen);
+  bool ok = sent == wireLen;
+  wireLen = 0;
+  return ok;
+}
+
+bool WebhookClient::write(const char* data, size_t len) {
+  while (len > 0) {
+    size_t n = sizeof(txBuf) - txLen;
+    if (n > len) n = len;
+    memcpy(txBuf + txLen, data, n);
+    txLen += n;
+    data += n;
+    len -= n;
+    if (txLen == sizeof(txBuf) && !flush()) return false;
+  }
+  return true;
+}
+
+bool WebhookClient::writeEscaped(const char* data, size_t len) {
+  while (len > 0) {
+    if (txLen == sizeof(txBuf) && !flush()) return false;
+    mcp::EscapeResult r = mcp::escapeJson(reinterpret_cast<char*>(txBuf) + txLen,
+                                          sizeof(txBuf) - txLen, data, len);
+    if (r.consumed == 0 && !flush()) return false;  // escape sequence did not fit
+    txLen += r.written;
+    data += r.consumed;
+    len -= r.consumed;
+  }
+  return true;
+}
+
+int WebhookClient::request(const char* method, const char* webhookUrl, const char* pathSuffix,
+                           const char* username, const char* content, size_t contentLen) {
+  MCP_TRACE_SCOPE("webhook.request");
+  messageId[0] = '\0';
+  snippet[0] = '\0';
+  snippetLen = 0;
+  bodyBytes = wireBytes = 0;
+  deflateUs = 0;
+  compressed = false;
+
+  // Before the TLS session exists, so it does not land between its buffers.
+  const bool useGzip = gzip && !gzipRejected;
+  if (useGzip && !deflater) {
+    deflater = new (std::nothrow) mcp::GzipStream();
+    if (!deflater) Serial.println("[Webhook] No memory for gzip; sending uncompressed");
+  }
+
+  const char* host;
+  size_t hostLen;
+  const char* path;
+  if (!splitUrl(webhookUrl, host, hostLen, path)) return WEBHOOK_ERR_URL;
+  if (!connectTo(host, hostLen)) return WEBHOOK_ERR_CONNECT;
+
+  const size_t usernameLen = strlen(username);
+  const size_t bodyLen = (sizeof(kBodyUsername) - 1) + mcp::escapedJsonLength(username, usernameLen) +
+                         (sizeof(kBodyContent) - 1) + mcp::escapedJsonLength(content, contentLen) +
+                         (sizeof(kBodyTail) - 1);
+
+  char head[96];
+  int n = snprintf(head, sizeof(head), "%s ", method);
+  bool ok = write(head, n) && write(path, strlen(path)) && write(pathSuffix, strlen(pathSuffix));
+  n = snprintf(head, sizeof(head), " HTTP/1.1\r\nHost: %s\r\n", connectedHost);
+  ok = ok && write(head, n);
+  compressed = useGzip && deflater;
+  if (compressed) {
+    n = snprintf(head, sizeof(head),
+                 "Content-Type: application/json\r\nContent-Encoding: gzip\r\nTransfer-Encoding: chunked\r\n\r\n");
+  } else {
+    n = snprintf(head, sizeof(head),
+                 "Content-Type: application/json\r\nContent-Length: %u\r\n\r\n", (unsigned)bodyLen);
+  }
+  ok = ok && write(head, n);
+  if (ok && compressed) {
+    // The head waits in wireBuf for the first chunk; the body goes to the deflater.
+    memcpy(wireBuf, txBuf, txLen);
+    wireLen = txLen;
+    txLen = 0;
+    deflating = true;
+    deflater->begin(onDeflated, this);
+  }
+
+  MCP_TRACE_BEGIN("webhook.send");
+  ok = ok && write(kBodyUsername, sizeof(kBodyUsername) - 1) && writeEscaped(username, usernameLen) &&
+       write(kBodyContent, sizeof(kBodyContent) - 1) && writeEscaped(content, contentLen) &&
+       write(kBodyTail, sizeof(kBodyTail) - 1) && flush();
+  bodyBytes = bodyLen;
+  wireBytes = bodyLen;
+  if (deflating) {
+    ok = ok && deflater->finish();
+    deflating = false;
+    wireBytes = deflater->getOutBytes();
+    deflateUs = deflater->getCpuUs();
+    MCP_TRACE_INSTANT("webhook.deflateUs", deflateUs);
+  }
+  MCP_TRACE_END("webhook.send");
+  if (!ok) {
+    stop();
+    return WEBHOOK_ERR_WRITE;
+  }
+
+  MCP_TRACE_BEGIN("webhook.response");
+  int status = readResponse();
+  MCP_TRACE_END("webhook.response");
+  if (status < 0 || !keepAlive) stop();
+  if (compressed && (status == 400 || status == 415)) {
+    // The endpoint does not take compressed bodies (Discord answers 400): send
+    // this request again as is, and the following ones too.
+    Serial.printf("[Webhook] gzip body rejected (HTTP %d); sending uncompressed\n", status);
+    gzipRejected = true;
+    delete deflater;
+    deflater = nullptr;
+    return request(method, webhookUrl, pathSuffix, username, content, contentLen);
+  }
+  return status;
+}
+
+int WebhookClient::readByte(unsigned long deadline) {
+  while (rxPos == rxLen) {
+    int avail = client.available();
+    if (avail > 0) {
+      int got = client.read(rxBuf, sizeof(rxBuf));
+      if (got > 0) {
+        rxPos = 0;
+        rxLen = got;
+        break;
+      }
+    }
+    if (!client.connected() || (long)(millis() - deadline) >= 0) return -1;
+    delay(2);
+  }
+  return rxBuf[rxPos++];
+}
+
+bool WebhookClient::readLine(char* line, size_t cap, unsigned long deadline) {
+  size_t len = 0;
+  for (;;) {
+    int c = readByte(deadline);
+    if (c < 0) return false;
+    if (c == '\n') break;
+    if (c != '\r' && len + 1 < cap) line[len++] = (char)c;
+  }
+  line[len] = '\0';
+  return true;
+}
+
+void WebhookClient::consumeBody(uint8_t c) {
+  if (snippetLen < WEBHOOK_SNIPPET_LEN) {
+    snippet[snippetLen++] = (char)c;
+    snippet[snippetLen] = '\0';
+  }
+
+  // First "id":"<digits>" in the body is the message id (same rule as before).
+  if (messageId[0] != '\0' && !idCapturing) return;
+  if (idCapturing) {
+    if (c == '"' || idLen + 1 >= sizeof(messageId)) {
+      idCapturing = false;
+      messageId[idLen] = '\0';
+    } else {
+      messageId[idLen++] = (char)c;
+    }
+    return;
+  }
+  if (c == (uint8_t)kIdPattern[idMatch]) {
+    idMatch++;
+    if (kIdPattern[idMatch] == '\0') {
+      idCapturing = true;
+      idLen = 0;
+      idMatch = 0;
+    }
+  } else {
+    idMatch = (c == '"') ? 1 : 0;
+  }
+}
+
+int WebhookClient::readResponse() {
+  const unsigned long deadline = millis() + WEBHOOK_TIMEOUT_MS;
+  char line[128];
+
+  if (!readLine(line, sizeof(line), deadline)) return WEBHOOK_ERR_RESPONSE;
+  const char* sp = strchr(line, ' ');
+  if (strncmp(line, "HTTP/1.", 7) != 0 || !sp) return WEBHOOK_ERR_RESPONSE;
+  const int status = atoi(sp + 1);
+  keepAlive = line[7] == '1';
+
+  long contentLength = -1;
+  bool chunked = false;
+  for (;;) {
+    if (!readLine(line, sizeof(line), deadline)) return WEBHOOK_ERR_RESPONSE;
+    if (line[0] == '\0') break;
+    if (startsWithIgnoreCase(line, "content-length:")) {
+      contentLength = atol(line + 15);
+    } else if (startsWithIgnoreCase(line, "transfer-encoding:")) {
+      chunked = strstr(line, "chunked") != nullptr;
+    } else if (startsWithIgnoreCase(line, "connection:")) {
+      keepAlive = strstr(line, "close") == nullptr;
+    }
+  }
+
+  idMatch = 0;
+  idCapturing = false;
+  idLen = 0;
+
+  if (chunked) {
+    for (;;) {
+      if (!readLine(line, sizeof(line), deadline)) return WEBHOOK_ERR_RESPONSE;
+      long size = strtol(line, nullptr, 16);
+      if (size <= 0) {
+        readLine(line, sizeof(line), deadline);  // trailer terminator
+        break;
+      }
+      for (long i = 0; i < size; i++) {
+        int c = readByte(deadline);
+        if (c < 0) return WEBHOOK_ERR_RESPONSE;
+        consumeBody((uint8_t)c);
+      }
+      if (!readLine(line, sizeof(line), deadline)) return WEBHOOK_ERR_RESPONSE;
+    }
+  } else if (contentLength >= 0) {
+    for (long i = 0; i < contentLength; i++) {
+      int c = readByte(deadline);
+      if (c < 0) return WEBHOOK_ERR_RESPONSE;
+      consumeBody((uint8_t)c);
+    }
+  } else {
+    // No framing: body runs until the server closes.
+    keepAlive = false;
+    int c;
+    while ((c = readByte(deadline)) >= 0) consumeBody((uint8_t)c);
+  }
+  if (idCapturing) messageId[0] = '\0';  // truncated id
+  return status;
+}
@@ -0,0 +1,115 @@
+/**
+ * webhookClient.h
+ * Minimal HTTP/1.1 client for the Discord webhook over a caller-owned TLS
+ * client. The JSON body is streamed (content escaped on the fly, length
+ * computed up front) and the response is scanned in place, so posting a
+ * report makes no heap allocations outside the TLS stack.
+ * POST and the follow-up PATCH share one keep-alive connection.
+ *
+ * With setGzip(true) the body is deflated on the fly (mcp::GzipStream) and sent
+ * as "Content-Encoding: gzip" with chunked framing, since the compressed
+ * length is not known up front. Only for endpoints that accept compressed
+ * request bodies; Discord does not. An endpoint that answers a compressed body
+ * with 400 or 415 gets the same request again uncompressed, and later requests
+ * go out uncompressed until gzip is switched off and on again (isGzipRejected()).
+ * The compressor (~11 KB) is allocated by the first compressed request and
+ * kept, so later posts stay allocation-free and devices without gzip do not
+ * pay for it; it is released when the endpoint rejects gzip.
+ */
+
+#ifndef WEBHOOK_CLIENT_H
+#define WEBHOOK_CLIENT_H
+
+#include <Arduino.h>
+#include <WiFiClientSecure.h>
+#include <McpGzip.h>
+
+#define WEBHOOK_TIMEOUT_MS 10000
+#define WEBHOOK_SNIPPET_LEN 160
+
+// Transport errors (HTTP status codes are positive)
+#define WEBHOOK_ERR_URL -1
+#define WEBHOOK_ERR_CONNECT -2
+#define WEBHOOK_ERR_WRITE -3
+#define WEBHOOK_ERR_RESPONSE -4
+
+class WebhookClient {
+public:
+  explicit WebhookClient(WiFiClientSecure& client);
+
+  // POST a new message (?wait=true so the response carries the message id).
+  int postMessage(const char* webhookUrl, const char* username, const char* content, size_t contentLen);
+  // PATCH the content of a message posted earlier.
+  int editMessage(const char* webhookUrl, const char* messageId, const char* username,
+                  const char* content, size_t contentLen);
+
+  // From the last response: message id ("" if none) and the start of the body.
+  const char* getMessageId() const { return messageId; }
+  const char* getResponseSnippet() const { return snippet; }
+
+  // Compress request bodies (Content-Encoding: gzip). Turning it on again
+  // clears isGzipRejected().
+  void setGzip(bool on) {
+    if (on && !gzip) gzipRejected = false;
+    gzip = on;
+  }
+  bool getGzip() const { return gzip; }
+  // The endpoint refused a compressed body; requests are sent uncompressed.
+  bool isGzipRejected() const { return gzipRejected; }
+  // From the last request: whether the body was compressed, its JSON size,
+  // bytes sent for it (without chunk framing) and the CPU time deflating.
+  bool wasCompressed() const { return compressed; }
+  size_t getBodyBytes() const { return bodyBytes; }
+  size_t getWireBytes() const { return wireBytes; }
+  uint32_t getDeflateUs() const { return deflateUs; }
+
+  // Close the connection and release the TLS session.
+  void stop();
+
+private:
+  int request(const char* method, const char* webhookUrl, const char* pathSuffix,
+              const char* username, const char* content, size_t contentLen);
+  bool connectTo(const char* host, size_t hostLen);
+  bool write(const char* data, size_t len);
+  bool writeEscaped(const char* data, size_t len);
+  bool flush();
+  static bool onDeflated(void* ctx, const uint8_t* data, size_t len, bool last);
+  bool writeChunk(const uint8_t* data, size_t len, bool last);
+  bool sendWire();
+  int readByte(unsigned long deadline);
+  bool readLine(char* line, size_t cap, unsigned long deadline);
+  int readResponse();
+  void consumeBody(uint8_t c);
+
+  WiFiClientSecure& client;
+  char connectedHost[64];
+  bool keepAlive;
+
+  uint8_t txBuf[512];
+  size_t txLen;
+
+  // gzip mode: txBuf collects JSON for the deflater, whose output is framed
+  // as chunks in wireBuf (the request head goes out with the first chunk).
+  bool gzip;
+  bool gzipRejected;
+  bool deflating;
+  bool compressed;
+  mcp::GzipStream* deflater;
+  uint8_t wireBuf[640];
+  size_t wireLen;
+  size_t bodyBytes;
+  size_t wireBytes;
+  uint32_t deflateUs;
+  uint8_t rxBuf[256];
+  size_t rxPos;
+  size_t rxLen;
+
+  char messageId[24];
+  char snippet[WEBHOOK_SNIPPET_LEN + 1];
+  size_t snippetLen;
+  uint8_t idMatch;     // progress through "id":" in the body
+  bool idCapturing;
+  size_t idLen;
+};
+
+#endif // WEBHOOK_CLIENT_H